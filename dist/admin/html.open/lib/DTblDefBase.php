@@ -450,11 +450,15 @@ class DTblDefBase
             self::NewBoolAttr('enableDynGzipCompress', DMsg::ALbl('l_enabledyngzipcompress'), false),
             self::NewIntAttr('gzipCompressLevel', DMsg::ALbl('l_gzipcompresslevel'), true, 1, 9),
            // self::NewIntAttr('enableBrCompress', DMsg::ALbl('l_brcompresslevel'), true, 0, 6),
+            self::NewBoolAttr('enableZstdCompress', DMsg::ALbl('l_enablezstdcompress')),
+            self::NewIntAttr('zstdCompressLevel', DMsg::ALbl('l_zstdcompresslevel'), true, 1, 19),
             // static
             self::NewBoolAttr('gzipAutoUpdateStatic', DMsg::ALbl('l_gzipautoupdatestatic')),
             self::NewIntAttr('gzipStaticCompressLevel', DMsg::ALbl('l_gzipstaticcompresslevel'), true, 1, 9),
             self::NewIntAttr('brStaticCompressLevel', DMsg::ALbl('l_brstaticcompresslevel'), true, 1, 11),
+            self::NewIntAttr('zstdStaticCompressLevel', DMsg::ALbl('l_zstdstaticcompresslevel'), true, 1, 19),
             self::NewTextAttr('gzipCacheDir', DMsg::ALbl('l_gzipcachedir'), 'cust'),
+            self::NewTextAttr('gzipPrewarmDir', DMsg::ALbl('l_gzipprewarmdir'), 'cust'),
             self::NewIntAttr('gzipMaxFileSize', DMsg::ALbl('l_gzipmaxfilesize'), true, '1K'),
             self::NewIntAttr('gzipMinFileSize', DMsg::ALbl('l_gzipminfilesize'), true, 200)
         );
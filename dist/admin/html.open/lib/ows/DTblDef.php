@@ -82,6 +82,7 @@ class DTblDef extends DTblDefBase
 				self::NewCustFlagAttr('group', null, (DAttr::BM_HIDE | DAttr::BM_NOEDIT), false),
 				$this->_attrs['priority']->dup(null, null, 'serverPriority'),
 				DTblDefBase::NewIntAttr('cpuAffinity', DMsg::ALbl('l_cpuaffinity'), true, 1),
+				self::NewBoolAttr('reusePort', DMsg::ALbl('l_reuseport')),
 				DTblDefBase::NewSelAttr( 'enableLVE', DMsg::ALbl('l_enablelve'),
 						array( 0=>DMsg::ALbl('o_disabled'), 1=>"LVE", 2=>"CageFS", 3=>DMsg::ALbl('o_cagefswithoutsuexec') ) ),
 				self::NewIntAttr('inMemBufSize', DMsg::ALbl('l_inmembufsize'), false, 0),
@@ -244,6 +245,15 @@ class DTblDef extends DTblDefBase
 	{
 		$attrs = array(
             self::NewTextAttr('shmDefaultDir', DMsg::ALbl('l_shmDefaultDir'), 'cust'),
+            self::NewSelAttr('accessLogWriter', DMsg::ALbl('l_accessLogWriter'),
+                    array('0' => DMsg::ALbl('o_off'), '1' => DMsg::ALbl('o_dropwhenfull'), '2' => DMsg::ALbl('o_blockthendrop'))),
+            self::NewIntAttr('accessLogWriterChunks', DMsg::ALbl('l_accessLogWriterChunks'), true, 16, 4096),
+            self::NewIntAttr('authVerifyCacheTimeout', DMsg::ALbl('l_authVerifyCacheTimeout'), true, 0, 3600),
+            self::NewIntAttr('authVerifyWorkers', DMsg::ALbl('l_authVerifyWorkers'), true, 0, 32),
+            self::NewIntAttr('rewriteCacheSize', DMsg::ALbl('l_rewriteCacheSize'), true, 0, 1000000),
+            self::NewIntAttr('statCacheSize', DMsg::ALbl('l_statCacheSize'), true, 0, 1000000),
+            self::NewIntAttr('statCacheTimeout', DMsg::ALbl('l_statCacheTimeout'), true, 0, 3600),
+            self::NewIntAttr('lsapiShmRingSize', DMsg::ALbl('l_lsapiShmRingSize'), true, 0, 67108864),
 			);
 
 		$this->_tblDef[$id] = DTbl::NewRegular($id, DMsg::ALbl('l_tuningos'), $attrs);
@@ -269,6 +279,9 @@ class DTblDef extends DTblDefBase
 		$attrs = array(
 			self::NewBoolAttr('sslStrongDhKey', DMsg::ALbl('l_sslStrongDhKey')),
 			self::NewBoolAttr('sslEnableMultiCerts', DMsg::ALbl('l_sslEnableMultiCerts')),
+			self::NewBoolAttr('sslKtls', DMsg::ALbl('l_sslKtls')),
+			self::NewIntAttr('sslCtxCacheSize', DMsg::ALbl('l_sslCtxCacheSize'), true, 0, 1000000),
+			self::NewIntAttr('sslCtxIdleTimeout', DMsg::ALbl('l_sslCtxIdleTimeout'), true, 120, 86400),
             $this->_attrs['sslSessionCache'],
             self::NewIntAttr('sslSessionCacheSize', DMsg::ALbl('l_sslSessionCacheSize'), true, 512),
             self::NewIntAttr('sslSessionCacheTimeout', DMsg::ALbl('l_sslSessionCacheTimeout'), true, 10, 1000000),
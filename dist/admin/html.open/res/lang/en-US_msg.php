@@ -125,6 +125,8 @@ $_gmsg['l_accessdeny'] = 'Denied List';
 $_gmsg['l_accessdenydir'] = 'Access Denied Directories';
 $_gmsg['l_accessfilename'] = 'Access File Name';
 $_gmsg['l_accesslog'] = 'Access Log';
+$_gmsg['l_accessLogWriter'] = 'Access Log Writer Thread';
+$_gmsg['l_accessLogWriterChunks'] = 'Access Log Writer Queue Chunks';
 $_gmsg['l_action'] = 'Actions';
 $_gmsg['l_adddefaultcharset'] = 'Add Default Charset';
 $_gmsg['l_address'] = 'Address';
@@ -156,6 +158,8 @@ $_gmsg['l_apptype'] = 'Application Type';
 $_gmsg['l_authname'] = 'Authentication Name';
 $_gmsg['l_authorizer'] = 'Authorizer';
 $_gmsg['l_authrealm'] = 'Authentication Realm';
+$_gmsg['l_authVerifyCacheTimeout'] = 'Verified Password Cache Timeout (secs)';
+$_gmsg['l_authVerifyWorkers'] = 'Password Verify Threads';
 $_gmsg['l_autoLoadRewriteHtaccess'] = 'Auto Load from .htaccess';
 $_gmsg['l_autofix503'] = 'Auto Fix 503 Error';
 $_gmsg['l_autoindex'] = 'Auto Index';
@@ -244,6 +248,7 @@ $_gmsg['l_enablecoredump'] = 'Enable Core Dump';
 $_gmsg['l_enabled'] = 'Enabled';
 $_gmsg['l_enabledhe'] = 'Enable DH Key Exchange';
 $_gmsg['l_enabledyngzipcompress'] = 'Enable GZIP Dynamic Compression';
+$_gmsg['l_enablezstdcompress'] = 'Enable Zstd Compression';
 $_gmsg['l_enableecdhe'] = 'Enable ECDH Key Exchange';
 $_gmsg['l_enablequic'] = 'Enable QUIC';
 $_gmsg['l_enableexpires'] = 'Enable Expires';
@@ -305,8 +310,10 @@ $_gmsg['l_gzipbr'] = 'GZIP/Brotli Compression';
 $_gmsg['l_gzipautoupdatestatic'] = 'Auto Update Static File';
 $_gmsg['l_gzipcachedir'] = 'Static Cache Directory';
 $_gmsg['l_gzipcompresslevel'] = 'GZIP Compression Level (Dynamic Content)';
+$_gmsg['l_zstdcompresslevel'] = 'Zstd Compression Level (Dynamic Content)';
 $_gmsg['l_gzipmaxfilesize'] = 'Max Static File Size (bytes)';
 $_gmsg['l_gzipminfilesize'] = 'Min Static File Size (bytes)';
+$_gmsg['l_gzipprewarmdir'] = 'Pre-warm Directory';
 $_gmsg['l_handlername'] = 'Handler Name';
 $_gmsg['l_handlertype'] = 'Handler Type';
 $_gmsg['l_hardlimit'] = 'Connection Hard Limit';
@@ -341,6 +348,7 @@ $_gmsg['l_logformat'] = 'Log Format';
 $_gmsg['l_loggeraddress'] = 'Address for remote logger (Optional)';
 $_gmsg['l_logheaders'] = 'Log Headers';
 $_gmsg['l_loglevel'] = 'Log Level';
+$_gmsg['l_lsapiShmRingSize'] = 'LSAPI Shared Memory Ring Size (bytes)';
 $_gmsg['l_lsapiapp'] = 'LSAPI App';
 $_gmsg['l_lsrecaptcha'] = 'LS reCAPTCHA';
 $_gmsg['l_mappedlisteners'] = 'Mapped Listeners';
@@ -436,7 +444,9 @@ $_gmsg['l_restrictedpermissionmask'] = 'Restricted Permission Mask';
 $_gmsg['l_restrictedscriptpermissionmask'] = 'Script Restricted Permission Mask';
 $_gmsg['l_retrytimeout'] = 'Retry Timeout (secs)';
 $_gmsg['l_retypepass'] = 'Retype Password';
+$_gmsg['l_reuseport'] = 'Per Worker Listener Sockets';
 $_gmsg['l_rewritebase'] = 'Rewrite Base';
+$_gmsg['l_rewriteCacheSize'] = 'Rewrite Result Cache Size';
 $_gmsg['l_rewritecontrol'] = 'Rewrite Control';
 $_gmsg['l_rewritedocrootrules'] = 'Document Root Rewrite Rules';
 $_gmsg['l_rewriteinherit'] = 'Rewrite Inherit';
@@ -475,7 +485,10 @@ $_gmsg['l_sndbufsize'] = 'Send Buffer Size (bytes)';
 $_gmsg['l_softlimit'] = 'Connection Soft Limit';
 $_gmsg['l_ssl'] = 'SSL Private Key & Certificate';
 $_gmsg['l_sslConnLimit'] = 'SSL Connection Limit';
+$_gmsg['l_sslCtxCacheSize'] = 'On-Demand Certificate Cache Size';
+$_gmsg['l_sslCtxIdleTimeout'] = 'On-Demand Certificate Idle Timeout (secs)';
 $_gmsg['l_sslEnableMultiCerts'] = 'Enable Multiple SSL Certificates';
+$_gmsg['l_sslKtls'] = 'Enable Kernel TLS';
 $_gmsg['l_sslSessionCache'] = 'Enable Session Cache';
 $_gmsg['l_sslSessionCacheSize'] = 'Session Cache Size (bytes)';
 $_gmsg['l_sslSessionCacheTimeout'] = 'Session Cache Timeout (secs)';
@@ -485,9 +498,12 @@ $_gmsg['l_sslSessionTickets'] = 'Enable Session Tickets';
 $_gmsg['l_sslStrongDhKey'] = 'SSL Strong DH Key';
 $_gmsg['l_sslprotocol'] = 'SSL Protocol';
 $_gmsg['l_startupfile'] = 'Startup File';
+$_gmsg['l_statCacheSize'] = 'File Metadata Cache Size';
+$_gmsg['l_statCacheTimeout'] = 'File Metadata Cache Timeout (secs)';
 $_gmsg['l_statDir'] = 'Statistics Output Directory';
 $_gmsg['l_gzipstaticcompresslevel'] = 'GZIP Compression Level (Static File)';
 $_gmsg['l_brstaticcompresslevel'] = 'Brotli Compression Level (Static File)';
+$_gmsg['l_zstdstaticcompresslevel'] = 'Zstd Compression Level (Static File)';
 $_gmsg['l_staticreqpersec'] = 'Static Requests/second';
 $_gmsg['l_statuscode'] = 'Status Code';
 $_gmsg['l_storagepath'] = 'Storage Path';
@@ -588,6 +604,8 @@ $_gmsg['o_none'] = 'None';
 $_gmsg['o_notset'] = 'Not Set';
 $_gmsg['o_on'] = 'On';
 $_gmsg['o_off'] = 'Off';
+$_gmsg['o_dropwhenfull'] = 'Drop When Full';
+$_gmsg['o_blockthendrop'] = 'Wait 10 ms, Then Drop';
 $_gmsg['o_overridecpanelrestartscript'] = 'Override cPanel restart HTTPD script';
 $_gmsg['o_ownlogfile'] = 'Own Log File';
 $_gmsg['o_sameasserver'] = 'Same as Server';
@@ -14,6 +14,8 @@ $_tipsdb['CPUSoftLimit'] = new DAttrHelp("CPU Soft Limit (sec)", 'Specifies CPU
 
 $_tipsdb['DHParam'] = new DAttrHelp("DH Parameter", 'Specifies the location of the Diffie-Hellman parameter file necessary for DH key exchange.', '', 'Filename which can be an absolute path or a relative path to $SERVER_ROOT.', '');
 
+$_tipsdb['enableZstdCompress'] = new DAttrHelp("Enable Zstd Compression", 'Enables Zstandard (zstd) compression for static and dynamic responses when the client accepts it. zstd is preferred over Brotli and GZIP since it compresses about as well as Brotli at a fraction of the CPU cost. Static files get a &quot;.zst&quot; copy in &quot;Static Cache Directory&quot;.<br/><br/>This setting will only take effect when &quot;Enable Compression&quot; is enabled and the server is built with zstd support. Dynamic responses are only compressed when &quot;Enable GZIP Dynamic Compression&quot; is enabled.<br/><br/>Default value: Yes', '', 'Select from radio box', '');
+
 $_tipsdb['GroupDBLocation'] = new DAttrHelp("Group DB Location", 'Specifies the location of the group database.<br/>Group information can be set either in the user database or in this standalone group DB. For user authentication, the user DB will be checked first. If the user DB also contains group information, then the group DB will not be checked.<br/><br/>For the DB type Password File, the group DB location should be the path to the flat file containing group definitions. You can edit this file through the WebAdmin console by clicking on the filename.<br/><br/>Each line of a group file should contain a groupname followed by a colon, followed by space delimited group of usernames. Example:<br/><blockquote><code>testgroup: user1 user2 user3</code></blockquote><br/>For the DB type LDAP, the group DB location should be the LDAP URL to query for group information. For each valid group, one and only one record should be returned in the LDAP search request based on this URL and the group name specified in &quot;Require (Authorized Users/Groups)&quot;. &quot;$k&quot; must be specified in the filter part of the URL and it will be replaced with the group name. The name of the attribute that specifies members in this group is specified by the &quot;Group Member Attribute&quot;.<br/><br/>Example: If objectClass posixGroup is being used to store group information. The following URL could be used:<br/><blockquote><code>ldap://localhost/ou=GroupDB,dc=example,dc=com???(&(objectClass=*)(cn=$k))</code></blockquote>', ' It is recommended to store a group file outside the document tree. If it has to be placed inside document tree, simply name it with a leading &quot;.ht&quot; like .htgroup, to prevent the file being served as a static file.  LiteSpeed Web Server does not serve files prefixed with &quot;.ht&quot;.', 'Filename which can be an absolute path or a relative path to $SERVER_ROOT, $VH_ROOT.', '');
 
 $_tipsdb['HANDLER_RESTART'] = new DAttrHelp("Hook::HANDLER_RESTART Priority", 'Sets the priority for this module callback within the HTTP Handler Restart Hook.<br/>   The HTTP Handler Restart Hook is triggered when the web server needs to discard the current response and start processing from beginning, for example, when an internal redirect has been requested.<br/><br/>It will only take effect if the module has a hook point here. If it is not set, the priority will be the default value defined in the module.', '', 'Integer value from -6000 to 6000. Lower value means higher priority.', '');
@@ -76,6 +78,10 @@ $_tipsdb['accessDenied'] = new DAttrHelp("Access Denied", 'Specifies which IPs o
 
 $_tipsdb['accessDenyDir'] = new DAttrHelp("Access Denied Directories", 'Specifies directories that should be blocked from access. Add directories that contain sensitive data to this list to prevent accidentally exposing sensitive files to clients. Append a &quot;*&quot; to the path to include all sub-directories. If both &quot;Follow Symbolic Link&quot; and &quot;Check Symbolic Link&quot; are enabled, symbolic links will be checked against the denied directories.', ' Of critical importance: This setting only prevents serving static files from these directories. This does not prevent exposure by external scripts such as PHP/Ruby/CGI.', 'Comma-delimited list of directories', '');
 
+$_tipsdb['accessLogWriter'] = new DAttrHelp("Access Log Writer Thread", 'Specifies whether each worker writes access logs from a dedicated thread. The event loop hands buffered log entries to the thread over a lock-free queue, so a slow disk does not stall connections. &quot;Drop When Full&quot; discards entries while all queue chunks are in use and logs how many were dropped. &quot;Wait 10 ms, Then Drop&quot; makes the worker wait for the writer first, for at most 10 ms so a stuck disk cannot stall connections; if the writer is still stuck, entries are dropped without waiting until it catches up. Either way only whole entries are dropped. Piped loggers are not affected. Default is &quot;Off&quot;.', '', 'Select from drop down list', '');
+
+$_tipsdb['accessLogWriterChunks'] = new DAttrHelp("Access Log Writer Queue Chunks", 'Specifies the maximum number of 16KB chunks each worker may have queued for the access log writer thread before &quot;Access Log Writer Thread&quot; drops or waits. Default is 128.', '', 'Integer number between 16 and 4096', '');
+
 $_tipsdb['accessLog_bytesLog'] = new DAttrHelp("Bytes Log", 'Specifies the path to the bandwidth bytes log file. When specified, a cPanel compatible bandwidth log will be created. This will log  the total bytes transferred for a request including both the request and reply bodies.', ' Put the log file on a separate disk.', 'Filename which can be an absolute path or a relative path to $SERVER_ROOT.', '');
 
 $_tipsdb['accessLog_compressArchive'] = new DAttrHelp("Compress Archive", 'Specifies whether to compress rotated log files in order to save disk space.', 'Log files are highly compressible and this is recommended to reduce disk usage for old logs.', 'Select from radio box', '');
@@ -122,6 +128,10 @@ $_tipsdb['as_startupfile'] = new DAttrHelp("Startup File", 'The location of file
 
 $_tipsdb['authName'] = new DAttrHelp("Authentication Name", 'Specifies an alternative name for the authorization realm for the current context. If not specified, the original realm name will be used. The authentication name is displayed on the browser&#039;s login pop-up.', '', '', '');
 
+$_tipsdb['authVerifyCacheTimeout'] = new DAttrHelp("Verified Password Cache Timeout (secs)", 'Specifies how long, in seconds, a successful password check against a slow crypt hash (such as bcrypt or SHA-crypt) is remembered. Remembered checks are keyed by a keyed hash of the user name, password and stored hash, so a changed password or user file invalidates them. Set to 0 to disable the cache. Default value is 60.', '', 'Integer number', '');
+
+$_tipsdb['authVerifyWorkers'] = new DAttrHelp("Password Verify Threads", 'Specifies the number of worker threads per server process used to verify passwords stored as slow crypt hashes, so that basic authentication does not block the event loop. Set to 0 to verify passwords in the event loop. Default value is 2.', '', 'Integer number', '');
+
 $_tipsdb['autoFix503'] = new DAttrHelp("Auto Fix 503 Error", 'Specifies whether to try to fix the &quot;503 Service Unavailable&quot; error by restarting the server gracefully. A &quot;503&quot; error is usually caused by malfunctioning external applications and a web server restart can often fix the error temporarily. If enabled, the server will restart automatically whenever there are more than 30 &quot;503&quot; errors within a 30 seconds span. This feature is enabled by default.', '', 'Select from radio box', '');
 
 $_tipsdb['autoIndex'] = new DAttrHelp("Auto Index", 'Specifies whether to generate a directory index on the fly when index files listed in &quot;Index Files&quot; are not available in a directory. This option is customizable at the virtual host and context level, and is inherited along the directory tree until it is explicitly overridden. You can customize the generated index page. Please check online wiki How-tos.', ' It is recommended to turn off Auto Index wherever possible to prevent revealing confidential data.', 'Select from radio box', '');
@@ -312,6 +322,8 @@ $_tipsdb['gzipMaxFileSize'] = new DAttrHelp("Max Static File Size (bytes)", 'Spe
 
 $_tipsdb['gzipMinFileSize'] = new DAttrHelp("Min Static File Size (bytes)", 'Specifies the minimum size of a static file for which the server will create a corresponding compressed file.<br/><br/>Default value: 200', 'It is not necessary to compress very small files as the bandwidth saving is negligible.', 'Number in bytes not less than 200.', '');
 
+$_tipsdb['gzipPrewarmDir'] = new DAttrHelp("Pre-warm Directory", 'Specifies a directory whose compressible static files will be compressed in the background when the server starts, so that the compressed copies are already in &quot;Static Cache Directory&quot; before the first request arrives. Files already compressed and up to date are skipped.<br/><br/>This setting will only take effect when &quot;Auto Update Static File&quot; is enabled.', '', 'Absolute path or path relative to $SERVER_ROOT.', '');
+
 $_tipsdb['gzipStaticCompressLevel'] = new DAttrHelp("GZIP Compression Level (Static File)", 'Specifies the level of GZIP compression applied to static files. Ranges from 1 (lowest) to 9 (highest).<br/><br/>This setting will only take effect when &quot;Enable Compression&quot; and &quot;Auto Update Static File&quot; are enabled.<br/><br/>Default value: 6', '', 'Number between 1 and 9.', '');
 
 $_tipsdb['hardLimit'] = new DAttrHelp("Connection Hard Limit", 'Specifies the maximum number of allowed concurrent connections from a single IP address. This limit is always enforced and a client will never be able to exceed this limit. HTTP/1.0 clients usually try to set up as many connections as they need to download embedded content at the same time. This limit should be set high enough so that HTTP/1.0 clients can still access the site. Use &quot;Connection Soft Limit&quot; to set the desired connection limit.<br/><br/>The recommended limit is between 20 and 50 depending on the content of your web page and your traffic load.', ' A lower number will enable serving more distinct clients.<br/> Trusted IPs or sub-networks are not affected.<br/> Set to a high value when you are performing benchmark tests with a large number of concurrent client machines.', 'Integer number', '');
@@ -384,6 +396,8 @@ $_tipsdb['log_rollingSize'] = new DAttrHelp("Rolling Size (bytes)", 'Specifies w
 
 $_tipsdb['lsapiContext'] = new DAttrHelp("LiteSpeed SAPI Context", 'External applications cannot be used directly. They must be either configured as a script handler or mapped to a URL through a context. An LiteSpeed SAPI Context will associate a URI with an LSAPI (LiteSpeed Server Application Programming Interface) application. Currently PHP, Ruby and Python have LSAPI modules. LSAPI, as it is developed specifically for LiteSpeed web server, is the most efficient way to communicate with LiteSpeed web server.', '', '', '');
 
+$_tipsdb['lsapiShmRingSize'] = new DAttrHelp("LSAPI Shared Memory Ring Size (bytes)", 'Specifies the size of each of the two shared memory rings used to pass request and response data to LSAPI applications connected through a UNIX domain socket. When set, an LSAPI application that supports it is switched to the shared memory transport after its first request, and the socket is only used for wake-up notifications. Applications without support keep using the socket. The value is rounded up to a power of 2, with a minimum of 64K. Set to 0 to disable. Default value is 0.', ' A ring large enough to hold a typical response, for example 256K, avoids most wake-ups.', 'Integer number', '');
+
 $_tipsdb['lsapiapp'] = new DAttrHelp("LiteSpeed SAPI App", 'Specifies the name of the LiteSpeed SAPI application to be connected to this context. This application must be defined in the &quot;External Apps&quot; section at the server or virtual host level.', '', 'Select from drop down list', '');
 
 $_tipsdb['lsrecaptcha'] = new DAttrHelp("reCaptcha Protection", 'reCaptcha Protection is a service provided as a way to mitigate heavy server load. reCaptcha Protection will activate after one of the below situations is hit. Once active, all requests by NON TRUSTED(as configured) clients will be redirected to a reCAPTCHA validation page. After validation, the client will be redirected to their desired page.<br/><br/>The following situations will activate reCaptcha Protection:<br/>1. The server or vhost concurrent requests count passes the configured connection limit.<br/>2. Anti-DDoS is enabled and a client is hitting a url in a suspicious manner. The client will redirect to reCAPTCHA first instead of getting denied when triggered.<br/>3. WP Brute Force protection is enabled and action is set to &#039;Captcha or Drop’. When a brute force attack is detected, the client will redirect to reCAPTCHA first. After max tries is reached, the connection will be dropped, as per the ‘drop’ option.<br/>4. A new rewrite rule environment is provided to activate reCAPTCHA via RewriteRules. &#039;verifycaptcha&#039; can be set to redirect clients to reCAPTCHA. A special value &#039;: deny&#039; can be set to deny the client if it failed too many times. For example, [E=verifycaptcha] will always redirect to reCAPTCHA until verified. [E=verifycaptcha: deny] will redirect to reCAPTCHA until Max Tries is hit, after which the client will be denied.', '', '', '');
@@ -554,8 +568,12 @@ $_tipsdb['restrictedScriptPermissionMask'] = new DAttrHelp("Script Restricted Pe
 
 $_tipsdb['retryTimeout'] = new DAttrHelp("Retry Timeout (secs)", 'Specifies the period of time that the server waits before retrying an external application that had a prior communication problem.', '', 'Integer number', '');
 
+$_tipsdb['reusePort'] = new DAttrHelp("Per Worker Listener Sockets", 'Specifies whether each server process accepts connections from its own SO_REUSEPORT listener socket instead of all processes sharing one socket. The kernel spreads new connections evenly among the sockets, so a process only wakes up for its own connections. When CPU Affinity is set, the socket also prefers connections received on the CPU of its process.<br/><br/>The sockets are kept by the main process. Connections queued for a process that exits are accepted by the process started in its place, and the sockets are passed to the new server instance on graceful restart. When the number of processes is lowered, connections queued on the sockets no longer in use are reset, unless net.ipv4.tcp_migrate_req is enabled. Turning this on for an existing listener requires a full server restart.<br/><br/>Default value: No', '', 'Select from radio box', '');
+
 $_tipsdb['rewriteBase'] = new DAttrHelp("Rewrite Base", 'Specifies the base URL for rewrite rules.', '', 'URL', '');
 
+$_tipsdb['rewriteCacheSize'] = new DAttrHelp("Rewrite Result Cache Size", 'Specifies the number of entries in the per-process cache of rewrite rule set results. A rule set whose outcome only depends on the request URI, query string and request headers is evaluated once per distinct input and the result is reused for later requests. Rule sets that test files, time, environment variables or random maps, and any rule set with rewrite logging enabled, are always evaluated. Hits and misses are reported per virtual host in the real-time statistics. Set to 0 to disable the cache. Default value is 2048.', '', 'Integer number', '');
+
 $_tipsdb['rewriteInherit'] = new DAttrHelp("Rewrite Inherit", 'Specifies whether to inherit rewrite rules from parent contexts. If rewrite is enabled and not inherited, rewrite base and rewrite rules defined in this context will be used.', '', 'Select from radio box', '');
 
 $_tipsdb['rewriteLogLevel'] = new DAttrHelp("Log Level", 'Specifies the level of detail of the rewrite engine&#039;s debug output. This value ranges from 0 - 9. 0 disables logging. 9 produces the most detailed log. The server and virtual host&#039;s error log &quot;Log Level&quot;  must be set to at least INFO for this option to take effect. This is useful when testing rewrite rules.', '', 'Integer number', '');
@@ -604,8 +622,14 @@ $_tipsdb['softLimit'] = new DAttrHelp("Connection Soft Limit", 'Specifies the so
 
 $_tipsdb['sslCert'] = new DAttrHelp("SSL Private Key & Certificate", 'Every SSL listener requires a paired SSL private key and SSL certificate. Multiple SSL listeners can share the same key and certificate.<br/><br/>You can generate SSL private keys yourself using an SSL software package, such as OpenSSL. SSL certificates can also be purchased from an authorized certificate issuer like VeriSign or Thawte. You can also sign the certificate yourself. Self-signed certificates will not be trusted by web browsers and should not be used on public websites containing critical data. However, a self-signed certificate is good enough for internal use, e.g. for encrypting traffic to LiteSpeed Web Server&#039;s WebAdmin Console.', '', '', '');
 
+$_tipsdb['sslCtxCacheSize'] = new DAttrHelp("On-Demand Certificate Cache Size", 'When set above 0, virtual host SSL certificates are no longer loaded at startup. Each worker loads a certificate on the first handshake that asks for its domain and releases the least recently used ones when more than this many are loaded. This is a soft limit: a certificate used within the last 2 minutes is never released, so a burst of handshakes for many domains can keep more than this many loaded for up to 2 minutes. Useful on servers with many SSL virtual hosts, where loading all certificates slows down start up and takes a lot of memory. Listener certificates are always loaded at startup. Default is 0 (load all at startup).', '', 'Integer number', '');
+
+$_tipsdb['sslCtxIdleTimeout'] = new DAttrHelp("On-Demand Certificate Idle Timeout (secs)", 'Specifies how long a certificate loaded on demand stays loaded without being used. Only takes effect when &quot;On-Demand Certificate Cache Size&quot; is set above 0. Default is 600.', '', 'Integer number', '');
+
 $_tipsdb['sslEnableMultiCerts'] = new DAttrHelp("Enable Multiple SSL Certificates", 'Allows listeners/vhosts to set multiple SSL certificates.  If multiple certificates are enabled, the certificates/keys are expected to follow a naming scheme.  If the cert is named server.crt, other possible cert names are server.crt.rsa, server.crt.dsa, server.crt.ecc. If &quot;Not Set&quot;, defaults to &quot;No&quot;.', '', 'Select from radio box', '');
 
+$_tipsdb['sslKtls'] = new DAttrHelp("Enable Kernel TLS", 'Specifies whether to hand the encryption of HTTPS responses to the kernel (kTLS) once the SSL handshake is done. Static files sent over HTTP/1.1 with TLS can then use sendfile(). Only AES-GCM and CHACHA20-POLY1305 ciphers with TLS 1.2 or 1.3 are supported. Connections fall back to regular SSL when the cipher or the kernel does not support kTLS. Default is &quot;No&quot;.', '', 'radio', '');
+
 $_tipsdb['sslOCSP'] = new DAttrHelp("OCSP Stapling", 'Online Certificate Status Protocol (OCSP) is a more efficient method of checking whether a digital certificate is valid. It works by communicating with another server — the OCSP responder — to get verification that the certificate is valid instead of checking through certificate revocation lists (CRL).<br/><br/>OCSP stapling is a further improvement on this protocol, allowing the server to check with the OCSP responder at regular intervals instead of every time a certificate is requested. See the <a href=&quot;http://en.wikipedia.org/wiki/OCSP_Stapling&quot;>OCSP Wikipedia page</a> for more details.', '', '', '');
 
 $_tipsdb['sslProtocol'] = new DAttrHelp("Protocol Version", 'Specifies which version of the SSL protocol will be used. You can choose from SSL v3.0 and TLS v1.0. Since OpenSSL 1.0.1, TLS v1.1, TLS v1.2 are also supported. TLS v1.3 is also supported via BoringSSL.', 'Leaving this field blank will enable TLS v1.0, TLS v1.1, and TLS v1.2 by default. TLS v1.3 requires BoringSSL and will also be enabled if the underlying SSL library supports it.', '', '');
@@ -626,6 +650,10 @@ $_tipsdb['sslSessionTickets'] = new DAttrHelp("Enable Session Tickets", 'Enables
 
 $_tipsdb['sslStrongDhKey'] = new DAttrHelp("SSL Strong DH Key", 'Specifies whether to use 2048 or 1024 bit DH keys for SSL handshakes. If set to &quot;Yes&quot;, 2048 bit DH keys will be used for 2048 bit SSL keys and certificates. 1024 bit DH keys will still be used in other situations. Default is &quot;Yes&quot;.<br/><br/>Earlier versions of Java do not support DH key size higher than 1024 bits. If Java client compatibility is required, this should be set to &quot;No&quot;.', '', 'radio', '');
 
+$_tipsdb['statCacheSize'] = new DAttrHelp("File Metadata Cache Size", 'Specifies the number of entries in the per-process cache of file status lookups made while mapping a request to a file, including lookups of missing files and of directory index files. Cached entries are dropped when inotify reports a change in their directory, so a static file can be served without a stat() call. Directories on network file systems such as NFS, and files reached through a symbolic link, are not watched; their entries expire after &quot;File Metadata Cache Timeout&quot;. Set to 0 to disable the cache. Default value is 0.', '', 'Integer number', '');
+
+$_tipsdb['statCacheTimeout'] = new DAttrHelp("File Metadata Cache Timeout (secs)", 'Specifies how long a cached file status stays valid when its directory cannot be watched for changes, for example on NFS. Set to 0 to only cache entries in watched directories. Default value is 1.', '', 'Integer number', '');
+
 $_tipsdb['statDir'] = new DAttrHelp("Statistics Output Directory", 'The directory where the Real-Time Stats report file will be written. The default directory is <b>/tmp/lshttpd/</b> .', 'During server operation, the .rtreport file will be written to every second. To avoid unnecessary disk writes, set this to a RAM Disk.<br/>The .rtreport file can be used with 3rd party monitoring software to track server health.', 'Absolute path', '');
 
 $_tipsdb['staticReqPerSec'] = new DAttrHelp("Static Requests/Second", 'Specifies the maximum number of requests to static content coming from a single IP address that can be processed in a single second regardless of the number of connections established.<br/><br/>When this limit is reached, all future requests are tar-pitted until the next second. Request limits for dynamically generated content are independent of this limit. Per-client request limits can be set at server- or virtual host-level. Virtual host-level settings override server-level settings.', ' Trusted IPs or sub-networks are not affected.', 'Integer number', '');
@@ -736,6 +764,10 @@ $_tipsdb['wsgiDefaults'] = new DAttrHelp("Python WSGI Default Settings", 'Defaul
 
 $_tipsdb['wsuri'] = new DAttrHelp("URI", 'Specifies the URI(s) that will use this WebSocket backend. Traffic to  this URI will only be forwarded to the WebSocket backend when it contains  a WebSocket upgrade request. <br/><br/>Traffic without this upgrade request will automatically be forwarded to the  Context that this URI belongs to. If no Context exists for this URI,  LSWS will treat this traffic as though it is accessing a static context with  the location $DOC_ROOT/URI.', '', 'A plain URI (starting with &quot;/&quot;). If the URI ends with a &quot;/&quot;,  then this WebSocket backend will include all sub-URIs under this URI.', 'Using the WebSocket proxy in conjunction with a Context  allows you to serve different kinds of traffic in different ways  on the same page, thus optimizing performance. You can send WebSocket  traffic to the WebSocket backend, while setting up a static context so  that LSWS can serve the page&#039;s static content, or an LSAPI context so LSWS  will serve PHP content (both of which LSWS does more efficiently  than the WebSocket backend).');
 
+$_tipsdb['zstdCompressLevel'] = new DAttrHelp("Zstd Compression Level (Dynamic Content)", 'Specifies the level of zstd compression applied to dynamic content. Ranges from 1 (lowest) to 19 (highest).<br/><br/>This setting will only take effect when &quot;Enable Zstd Compression&quot; and &quot;Enable GZIP Dynamic Compression&quot; are enabled.<br/><br/>Default value: 3', ' Levels above 9 use considerably more memory and CPU cycles for a small gain.', 'Number between 1 and 19.', '');
+
+$_tipsdb['zstdStaticCompressLevel'] = new DAttrHelp("Zstd Compression Level (Static File)", 'Specifies the level of zstd compression applied to static files. Ranges from 1 (lowest) to 19 (highest).<br/><br/>This setting will only take effect when &quot;Enable Zstd Compression&quot; and &quot;Auto Update Static File&quot; are enabled.<br/><br/>Default value: 12', '', 'Number between 1 and 19.', '');
+
 
 $_tipsdb['EDTP:UDBgroup'] = array('If you enter group information here, the group DB will not be checked.','You can enter multiple groups, use comma to separate. Space will be treated as part of a group name.');
 
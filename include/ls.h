@@ -1298,6 +1298,7 @@ enum LSI_COMPRESS_METHOD
     LSI_NO_COMPRESS = 0,
     LSI_GZIP_COMPRESS,
     LSI_BR_COMPRESS,
+    LSI_ZSTD_COMPRESS,
 };
 
 
@@ -0,0 +1,1308 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "iouring.h"
+
+#ifdef LS_HAS_IO_URING
+
+#include <util/objarray.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup     425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter     426
+#endif
+
+#define IOU_SQ_ENTRIES          1024
+#define IOU_CQ_ENTRIES          (IOU_SQ_ENTRIES * 8)
+#define IOU_RESULT_BATCH        64
+#define IOU_IO_BUF_SIZE         16384
+#define IOU_MAX_FREE_BUFS       256
+#define IOU_IOV_MAX             32
+//a removed fd gets this long to take the data still queued for it
+#define IOU_ORPHAN_TIMEOUT      30
+
+//user_data of requests whose completion is not interesting, POLL_REMOVE.
+#define IOU_IGNORE              0ULL
+
+//single shot poll checking if a reactor left the fd ready
+#define IOU_RECHECK             0x80000000ULL
+
+//read ahead and queued write of a reactor, tagged with FdState::m_iIoGen
+#define IOU_READ                0x40000000ULL
+#define IOU_WRITE               0x20000000ULL
+
+#define IOU_USER_DATA(fd, gen)  (((uint64_t)(gen) << 32) | (uint32_t)(fd))
+#define IOU_USER_FD(ud)         ((int)((ud) & 0x1fffffff))
+
+#define IOF_READING             1   //READ request in flight
+#define IOF_WRITING             2   //WRITE request in flight
+#define IOF_SHUTDOWN            4   //shutdown(SHUT_WR) once the queue is out
+#define IOF_OUT_HELD            8   //POLLOUT held back while the queue is busy
+#define IOF_PENDING             16  //listed in m_pPending
+#define IOF_QUEUED              32  //listed in m_pWrites
+#define IOU_USER_GEN(ud)        ((uint32_t)((ud) >> 32))
+
+
+IoUring::IoUring()
+    : m_fd(-1)
+    , m_pSqHead(NULL)
+    , m_pSqTail(NULL)
+    , m_pSqArray(NULL)
+    , m_iSqMask(0)
+    , m_iSqEntries(0)
+    , m_iSqPending(0)
+    , m_pSqes(NULL)
+    , m_pCqHead(NULL)
+    , m_pCqTail(NULL)
+    , m_iCqMask(0)
+    , m_pCqes(NULL)
+    , m_pSqRing(MAP_FAILED)
+    , m_iSqRingSize(0)
+    , m_pCqRing(MAP_FAILED)
+    , m_iCqRingSize(0)
+    , m_iSqesSize(0)
+    , m_pFdStates(NULL)
+    , m_iFdStateCap(0)
+    , m_iDeferredNext(0)
+{
+    setFLTag(O_NONBLOCK | O_RDWR);
+    m_pUpdates = new TObjArray<int>();
+    m_pUpdates->setCapacity(100);
+    m_pRearms = new TObjArray<int>();
+    m_pRearms->setCapacity(100);
+    m_pRechecks = new TObjArray<int>();
+    m_pRechecks->setCapacity(100);
+    m_pWrites = new TObjArray<int>();
+    m_pWrites->setCapacity(100);
+    m_pPending = new TObjArray<int>();
+    m_pPending->setCapacity(100);
+    m_pFreeBufs = new TObjArray<char *>();
+    m_pFreeBufs->setCapacity(16);
+    m_pOrphans = new TObjArray<Orphan>();
+    m_pOrphans->setCapacity(4);
+    m_pDeferred = new TObjArray<struct io_uring_cqe>();
+    m_pDeferred->setCapacity(16);
+}
+
+
+IoUring::~IoUring()
+{
+    releaseRing();
+    if (m_pFdStates)
+    {
+        for (unsigned i = 0; i < m_iFdStateCap; ++i)
+        {
+            if (m_pFdStates[i].m_pReadBuf)
+                free(m_pFdStates[i].m_pReadBuf);
+            if (m_pFdStates[i].m_pWriteBuf)
+                free(m_pFdStates[i].m_pWriteBuf);
+        }
+        free(m_pFdStates);
+    }
+    if (m_pOrphans)
+    {
+        for (Orphan *p = m_pOrphans->begin(); p < m_pOrphans->end(); ++p)
+        {
+            if (p->m_fd != -1)
+                close(p->m_fd);
+            free(p->m_pBuf);
+        }
+        delete m_pOrphans;
+    }
+    if (m_pFreeBufs)
+    {
+        for (char **p = m_pFreeBufs->begin(); p < m_pFreeBufs->end(); ++p)
+            free(*p);
+        delete m_pFreeBufs;
+    }
+    if (m_pWrites)
+        delete m_pWrites;
+    if (m_pPending)
+        delete m_pPending;
+    if (m_pDeferred)
+        delete m_pDeferred;
+    if (m_pUpdates)
+        delete m_pUpdates;
+    if (m_pRearms)
+        delete m_pRearms;
+    if (m_pRechecks)
+        delete m_pRechecks;
+}
+
+
+void IoUring::releaseRing()
+{
+    if (m_pSqes)
+        munmap(m_pSqes, m_iSqesSize);
+    if ((m_pCqRing != MAP_FAILED) && (m_pCqRing != m_pSqRing))
+        munmap(m_pCqRing, m_iCqRingSize);
+    if (m_pSqRing != MAP_FAILED)
+        munmap(m_pSqRing, m_iSqRingSize);
+    if (m_fd != -1)
+        close(m_fd);
+    m_pSqes = NULL;
+    m_pSqRing = m_pCqRing = MAP_FAILED;
+    m_fd = -1;
+}
+
+
+int IoUring::setupRing(int entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = IOU_CQ_ENTRIES;
+    m_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (m_fd == -1)
+        return LS_FAIL;
+    ::fcntl(m_fd, F_SETFD, FD_CLOEXEC);
+
+    //NODROP: completions are never lost when the CQ ring overflows.
+    //EXT_ARG: io_uring_enter() takes a timeout, no extra TIMEOUT request.
+    //RSRC_TAGS: no flag tells about multishot poll, it came with 5.13
+    //together with this one.
+    unsigned required = IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG
+                        | IORING_FEAT_RSRC_TAGS;
+    if ((params.features & required) != required)
+    {
+        releaseRing();
+        errno = ENOSYS;
+        return LS_FAIL;
+    }
+
+    m_iSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_iCqRingSize = params.cq_off.cqes
+                    + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (m_iCqRingSize > m_iSqRingSize)
+            m_iSqRingSize = m_iCqRingSize;
+        m_iCqRingSize = m_iSqRingSize;
+    }
+    m_pSqRing = mmap(NULL, m_iSqRingSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+    if (m_pSqRing == MAP_FAILED)
+    {
+        releaseRing();
+        return LS_FAIL;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        m_pCqRing = m_pSqRing;
+    else
+    {
+        m_pCqRing = mmap(NULL, m_iCqRingSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_pCqRing == MAP_FAILED)
+        {
+            releaseRing();
+            return LS_FAIL;
+        }
+    }
+    m_iSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_pSqes = (struct io_uring_sqe *)mmap(NULL, m_iSqesSize,
+                                          PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE, m_fd,
+                                          IORING_OFF_SQES);
+    if (m_pSqes == MAP_FAILED)
+    {
+        m_pSqes = NULL;
+        releaseRing();
+        return LS_FAIL;
+    }
+
+    char *pSq = (char *)m_pSqRing;
+    m_pSqHead  = (unsigned *)(pSq + params.sq_off.head);
+    m_pSqTail  = (unsigned *)(pSq + params.sq_off.tail);
+    m_pSqArray = (unsigned *)(pSq + params.sq_off.array);
+    m_iSqMask  = *(unsigned *)(pSq + params.sq_off.ring_mask);
+    m_iSqEntries = *(unsigned *)(pSq + params.sq_off.ring_entries);
+
+    char *pCq = (char *)m_pCqRing;
+    m_pCqHead  = (unsigned *)(pCq + params.cq_off.head);
+    m_pCqTail  = (unsigned *)(pCq + params.cq_off.tail);
+    m_pCqes    = (struct io_uring_cqe *)(pCq + params.cq_off.cqes);
+    m_iCqMask  = *(unsigned *)(pCq + params.cq_off.ring_mask);
+    m_iSqPending = 0;
+    return LS_OK;
+}
+
+
+int IoUring::init(int capacity)
+{
+    if (m_reactorIndex.allocate(capacity) == -1)
+        return LS_FAIL;
+    releaseRing();
+    if (setupRing(IOU_SQ_ENTRIES) == LS_FAIL)
+        return LS_FAIL;
+    if (getFdState(capacity - 1) == NULL)
+        return LS_FAIL;
+    return LS_OK;
+}
+
+
+int IoUring::isSupported()
+{
+    IoUring ring;
+    return ring.setupRing(8) == LS_OK;
+}
+
+
+IoUring::FdState *IoUring::getFdState(int fd)
+{
+    if ((unsigned)fd >= m_iFdStateCap)
+    {
+        if ((unsigned)fd > MAX_FDINDEX)
+            return NULL;
+        unsigned new_cap = m_iFdStateCap * 2;
+        if (new_cap <= (unsigned)fd)
+            new_cap = fd + 1;
+        FdState *pStates = (FdState *)realloc(m_pFdStates,
+                                              new_cap * sizeof(FdState));
+        if (!pStates)
+            return NULL;
+        memset(pStates + m_iFdStateCap, 0,
+               (new_cap - m_iFdStateCap) * sizeof(FdState));
+        m_pFdStates = pStates;
+        m_iFdStateCap = new_cap;
+    }
+    return &m_pFdStates[fd];
+}
+
+
+struct io_uring_sqe *IoUring::getSqe()
+{
+    unsigned tail = *m_pSqTail;
+    if (tail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE) >= m_iSqEntries)
+    {
+        //ring is full, flush what we have without waiting.
+        submit(0, 0);
+        if (tail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE) >= m_iSqEntries)
+            return NULL;
+    }
+    unsigned idx = tail & m_iSqMask;
+    struct io_uring_sqe *pSqe = &m_pSqes[idx];
+    memset(pSqe, 0, sizeof(*pSqe));
+    m_pSqArray[idx] = idx;
+    //No SQPOLL thread, the kernel only looks at the ring inside
+    //io_uring_enter(), the entry is filled in before that.
+    __atomic_store_n(m_pSqTail, tail + 1, __ATOMIC_RELEASE);
+    ++m_iSqPending;
+    return pSqe;
+}
+
+
+int IoUring::submit(int waitNr, int iTimeoutMilliSec)
+{
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    unsigned flags = 0;
+    void *pArg = NULL;
+    size_t argSize = 0;
+
+    if (waitNr)
+    {
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        memset(&arg, 0, sizeof(arg));
+        if (iTimeoutMilliSec >= 0)
+        {
+            ts.tv_sec = iTimeoutMilliSec / 1000;
+            ts.tv_nsec = (iTimeoutMilliSec % 1000) * 1000000;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+        pArg = &arg;
+        argSize = sizeof(arg);
+    }
+    else if (!m_iSqPending)
+        return 0;
+    int ret = syscall(__NR_io_uring_enter, m_fd, m_iSqPending, waitNr, flags,
+                      pArg, argSize);
+    m_iSqPending = *m_pSqTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+    if ((ret == -1) && (errno == ETIME))
+        ret = 0;
+    return ret;
+}
+
+
+static void setPollMask(struct io_uring_sqe *pSqe, short mask)
+{
+#if __BYTE_ORDER == __BIG_ENDIAN
+    pSqe->poll32_events = ((uint32_t)(unsigned short)mask) << 16;
+#else
+    pSqe->poll32_events = (unsigned short)mask;
+#endif
+}
+
+
+static void removePoll(struct io_uring_sqe *pSqe, uint64_t ud)
+{
+    pSqe->opcode = IORING_OP_POLL_REMOVE;
+    pSqe->fd = -1;
+    pSqe->addr = ud;
+    pSqe->user_data = IOU_IGNORE;
+}
+
+
+short IoUring::armMask(const FdState *pState, short mask) const
+{
+    //what a short write left in the queue waits for the fd to take more
+    if (pState->m_pWriteBuf && !(pState->m_iIoFlags & IOF_WRITING))
+        mask |= POLLOUT;
+    return mask;
+}
+
+
+void IoUring::arm(int fd, FdState *pState, short mask)
+{
+    struct io_uring_sqe *pSqe = getSqe();
+    if (!pSqe)
+        return;
+    if (++pState->m_iGeneration == 0)
+        pState->m_iGeneration = 1;
+    pSqe->opcode = IORING_OP_POLL_ADD;
+    pSqe->fd = fd;
+    pSqe->len = IORING_POLL_ADD_MULTI;
+    setPollMask(pSqe, mask);
+    pSqe->user_data = IOU_USER_DATA(fd, pState->m_iGeneration);
+    pState->m_iArmedMask = mask;
+    pState->m_iArmed = 1;
+}
+
+
+/**
+ * Single shot poll linked to a zero timeout, it completes with the events
+ * if the fd is ready when submitted, or with -ECANCELED right after.
+ */
+void IoUring::recheck(int fd, FdState *pState, short mask)
+{
+    static struct __kernel_timespec s_zero = { 0, 0 };
+    struct io_uring_sqe *pSqe;
+    if (m_iSqEntries - (*m_pSqTail
+                        - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE)) < 2)
+        submit(0, 0);
+    if ((pSqe = getSqe()) == NULL)
+        return;
+    pSqe->opcode = IORING_OP_POLL_ADD;
+    pSqe->fd = fd;
+    pSqe->flags = IOSQE_IO_LINK;
+    setPollMask(pSqe, mask);
+    pSqe->user_data = IOU_USER_DATA(fd, pState->m_iGeneration) | IOU_RECHECK;
+    pState->m_iRecheck = 1;
+    if ((pSqe = getSqe()) == NULL)
+        return;
+    pSqe->opcode = IORING_OP_LINK_TIMEOUT;
+    pSqe->fd = -1;
+    pSqe->addr = (uint64_t)(uintptr_t)&s_zero;
+    pSqe->len = 1;
+    pSqe->user_data = IOU_IGNORE;
+}
+
+
+void IoUring::disarm(int fd, FdState *pState)
+{
+    struct io_uring_sqe *pSqe;
+    uint64_t ud = IOU_USER_DATA(fd, pState->m_iGeneration);
+    if (pState->m_iArmed)
+    {
+        if ((pSqe = getSqe()) != NULL)
+            removePoll(pSqe, ud);
+        pState->m_iArmed = 0;
+    }
+    if (pState->m_iRecheck)
+    {
+        if ((pSqe = getSqe()) != NULL)
+            removePoll(pSqe, ud | IOU_RECHECK);
+        pState->m_iRecheck = 0;
+    }
+    //completion of the old request, if any, will not match any more.
+    if (++pState->m_iGeneration == 0)
+        pState->m_iGeneration = 1;
+}
+
+
+int IoUring::add(EventReactor *pHandler, short mask)
+{
+    int fd = pHandler->getfd();
+    if (fd == -1)
+        return LS_FAIL;
+    FdState *pState = getFdState(fd);
+    if (!pState || (m_reactorIndex.set(fd, pHandler) == LS_FAIL))
+        return LS_FAIL;
+    m_reactorIndex.setUpdateFlags(fd, 0);
+    pHandler->setPollfd();
+    pHandler->setMask2(mask);
+    pHandler->clearRevent();
+    disarm(fd, pState);
+    //whatever is left belongs to a closed fd of the same number
+    releaseIo(fd, pState, 0);
+    arm(fd, pState, mask);
+    if (!pState->m_iArmed)
+        return LS_FAIL;
+    pHandler->updateEventSet();
+    return 0;
+}
+
+
+int IoUring::remove(EventReactor *pHandler)
+{
+    int fd = pHandler->getfd();
+    if (fd == -1)
+        return LS_OK;
+    if (fd <= (int)m_reactorIndex.getUsed())
+    {
+        pHandler->clearRevent();
+        pHandler->updateEventSet();
+        m_reactorIndex.set(fd, NULL);
+    }
+    if ((unsigned)fd < m_iFdStateCap)
+    {
+        disarm(fd, &m_pFdStates[fd]);
+        releaseIo(fd, &m_pFdStates[fd], 1);
+    }
+    return LS_OK;
+}
+
+
+int IoUring::updateEvents(EventReactor *pHandler, short mask)
+{
+    int fd = pHandler->getfd();
+    if (fd == -1)
+        return LS_OK;
+    assert(pHandler == m_reactorIndex.get(fd));
+    pHandler->setMask2(mask);
+    requestUpdate(fd);
+    return LS_OK;
+}
+
+
+void IoUring::requestUpdate(int fd)
+{
+    if (!(m_reactorIndex.getUpdateFlags(fd) & ERF_UPDATE))
+    {
+        m_reactorIndex.setUpdateFlags(fd, ERF_UPDATE);
+        appendFd(m_pUpdates, fd);
+    }
+}
+
+
+void IoUring::appendFd(TObjArray<int> *pArray, int fd)
+{
+    if (pArray->getSize() >= pArray->getCapacity())
+        pArray->guarantee(pArray->getCapacity() << 1);
+    int *p = pArray->getNew();
+    *p = fd;
+}
+
+
+void IoUring::applyEvents()
+{
+    int *p = m_pUpdates->begin();
+    int *pEnd = m_pUpdates->end();
+    while (p < pEnd)
+    {
+        int fd = *p++;
+        EventReactor *pReactor = m_reactorIndex.get(fd);
+        m_reactorIndex.setUpdateFlags(fd, 0);
+        if (!pReactor)
+            continue;
+        FdState *pState = &m_pFdStates[fd];
+        short mask = armMask(pState, pReactor->getEvents());
+        //a poll that has fired will be re-armed with the new mask anyway.
+        if (pState->m_iArmed && (pState->m_iArmedMask != mask))
+        {
+            disarm(fd, pState);
+            arm(fd, pState, mask);
+        }
+        pReactor->updateEventSet();
+    }
+    m_pUpdates->clear();
+}
+
+
+void IoUring::applyRearms()
+{
+    int *p = m_pRearms->begin();
+    int *pEnd = m_pRearms->end();
+    while (p < pEnd)
+    {
+        int fd = *p++;
+        EventReactor *pReactor = m_reactorIndex.get(fd);
+        if (!pReactor || (pReactor->getfd() != fd))
+            continue;
+        FdState *pState = &m_pFdStates[fd];
+        if (!pState->m_iArmed)
+        {
+            arm(fd, pState, armMask(pState, pReactor->getEvents()));
+            pReactor->updateEventSet();
+        }
+    }
+    m_pRearms->clear();
+}
+
+
+void IoUring::applyRechecks()
+{
+    int *p = m_pRechecks->begin();
+    int *pEnd = m_pRechecks->end();
+    while (p < pEnd)
+    {
+        int fd = *p++;
+        EventReactor *pReactor = m_reactorIndex.get(fd);
+        if (!pReactor || (pReactor->getfd() != fd))
+            continue;
+        FdState *pState = &m_pFdStates[fd];
+        //a poll armed in this loop checks the readiness by itself.
+        if (pState->m_iArmed && !pState->m_iRecheck
+            && (pState->m_iArmedMask
+                == armMask(pState, pReactor->getEvents())))
+            recheck(fd, pState, pReactor->getEvents());
+    }
+    m_pRechecks->clear();
+}
+
+
+void IoUring::applyWrites()
+{
+    int *p = m_pWrites->begin();
+    int *pEnd = m_pWrites->end();
+    while (p < pEnd)
+    {
+        int fd = *p++;
+        FdState *pState = &m_pFdStates[fd];
+        pState->m_iIoFlags &= ~IOF_QUEUED;
+        if (!pState->m_pWriteBuf || (pState->m_iIoFlags & IOF_WRITING))
+            continue;
+        struct io_uring_sqe *pSqe = getSqe();
+        if (!pSqe)
+        {
+            //written once POLLOUT comes
+            requestUpdate(fd);
+            continue;
+        }
+        pSqe->opcode = IORING_OP_WRITE;
+        pSqe->fd = fd;
+        pSqe->off = (uint64_t)-1;
+        pSqe->addr = (uint64_t)(uintptr_t)(pState->m_pWriteBuf
+                                           + pState->m_iWriteOff);
+        pSqe->len = pState->m_iWriteLen - pState->m_iWriteOff;
+        pSqe->user_data = IOU_USER_DATA(fd, pState->m_iIoGen) | IOU_WRITE;
+        pState->m_iIoFlags |= IOF_WRITING;
+    }
+    m_pWrites->clear();
+}
+
+
+int IoUring::waitAndProcessEvents(int iTimeoutMilliSec)
+{
+    applyRearms();
+    applyEvents();
+    applyRechecks();
+    applyWrites();
+    int waitNr = (iTimeoutMilliSec != 0) && (m_pPending->getSize() == 0)
+                 && (*m_pCqHead == __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE));
+    int ret = submit(waitNr, iTimeoutMilliSec);
+    if ((ret == -1) && (errno != EBUSY))
+        return ret;
+    ret = processCompletions();
+    return ret + dispatchPending();
+}
+
+
+int IoUring::processCompletions()
+{
+    Result results[IOU_RESULT_BATCH];
+    int total = 0;
+
+    while (1)
+    {
+        unsigned head = *m_pCqHead;
+        unsigned tail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+        int n = 0;
+        while (n < IOU_RESULT_BATCH)
+        {
+            const struct io_uring_cqe *pCqe;
+            //completions put aside by reapIo() come before the ring
+            if (m_iDeferredNext < m_pDeferred->getSize())
+                pCqe = m_pDeferred->getObj(m_iDeferredNext++);
+            else if (head != tail)
+                pCqe = &m_pCqes[head++ & m_iCqMask];
+            else
+                break;
+            uint64_t ud = pCqe->user_data;
+            int res = pCqe->res;
+            unsigned flags = pCqe->flags;
+            if (ud == IOU_IGNORE)
+                continue;
+            if (ud & (IOU_READ | IOU_WRITE))
+            {
+                onIoDone(ud, res);
+                continue;
+            }
+            int fd = IOU_USER_FD(ud);
+            if (((unsigned)fd >= m_iFdStateCap)
+                || (m_pFdStates[fd].m_iGeneration != IOU_USER_GEN(ud)))
+                continue;
+            EventReactor *pReactor = m_reactorIndex.get(fd);
+            if (ud & IOU_RECHECK)
+                m_pFdStates[fd].m_iRecheck = 0;
+            else if (!(flags & IORING_CQE_F_MORE))
+            {
+                //the kernel has terminated the multishot poll.
+                m_pFdStates[fd].m_iArmed = 0;
+                if (pReactor && (pReactor->getfd() == fd))
+                    appendFd(m_pRearms, fd);
+            }
+            if (!pReactor || (pReactor->getfd() != fd))
+                continue;
+            if (res == -ECANCELED)
+                continue;
+            results[n].m_fd = fd;
+            results[n].m_iGen = IOU_USER_GEN(ud);
+            results[n].m_iEvents = (res < 0) ? POLLERR : (short)res;
+            pReactor->assignRevent(results[n].m_iEvents);
+            ++n;
+        }
+        __atomic_store_n(m_pCqHead, head, __ATOMIC_RELEASE);
+        if (m_iDeferredNext >= m_pDeferred->getSize())
+        {
+            m_pDeferred->clear();
+            m_iDeferredNext = 0;
+        }
+        if (n == 0)
+            break;
+
+        //one io_uring_enter() reads all the fds of the batch
+        if (queueReads(results, n) > 0)
+        {
+            submit(0, 0);
+            reapIo();
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            int fd = results[i].m_fd;
+            //skip reactors removed or replaced by an earlier handler.
+            if (m_pFdStates[fd].m_iGeneration != results[i].m_iGen)
+                continue;
+            EventReactor *pReactor = m_reactorIndex.get(fd);
+            if (!pReactor
+                || (pReactor->getAssignedRevent() != results[i].m_iEvents))
+                continue;
+            short events = filterEvents(fd, &m_pFdStates[fd],
+                                        results[i].m_iEvents);
+            if (!events)
+                continue;
+            if (events & POLLHUP)
+                pReactor->incHupCounter();
+            pReactor->assignRevent(events);
+            pReactor->handleEvents(events);
+            if ((m_pFdStates[fd].m_iGeneration == results[i].m_iGen)
+                && (m_reactorIndex.get(fd) == pReactor))
+            {
+                //not drained down to EAGAIN, may still be ready.
+                if (pReactor->getAssignedRevent() & pReactor->getEvents()
+                    & (POLLIN | POLLOUT))
+                    appendFd(m_pRechecks, fd);
+                checkLeftover(fd, pReactor);
+            }
+        }
+        total += n;
+    }
+    return total;
+}
+
+
+char *IoUring::getBuf()
+{
+    if (m_pFreeBufs->getSize() > 0)
+    {
+        char *pBuf = *(m_pFreeBufs->end() - 1);
+        m_pFreeBufs->pop();
+        return pBuf;
+    }
+    return (char *)malloc(IOU_IO_BUF_SIZE);
+}
+
+
+void IoUring::recycleBuf(char *pBuf)
+{
+    if (m_pFreeBufs->getSize() < IOU_MAX_FREE_BUFS)
+        *m_pFreeBufs->getNew() = pBuf;
+    else
+        free(pBuf);
+}
+
+
+void IoUring::queueWrite(int fd, FdState *pState)
+{
+    if (!(pState->m_iIoFlags & IOF_QUEUED))
+    {
+        pState->m_iIoFlags |= IOF_QUEUED;
+        appendFd(m_pWrites, fd);
+    }
+}
+
+
+void IoUring::addPending(int fd, FdState *pState)
+{
+    if (!(pState->m_iIoFlags & IOF_PENDING))
+    {
+        pState->m_iIoFlags |= IOF_PENDING;
+        appendFd(m_pPending, fd);
+    }
+}
+
+
+int IoUring::queueReads(const Result *pResults, int n)
+{
+    int count = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (!(pResults[i].m_iEvents & POLLIN))
+            continue;
+        int fd = pResults[i].m_fd;
+        FdState *pState = &m_pFdStates[fd];
+        if (!pState->m_iRingIo || pState->m_pReadBuf)
+            continue;
+        EventReactor *pReactor = m_reactorIndex.get(fd);
+        if (!pReactor || !(pReactor->getEvents() & POLLIN))
+            continue;
+        char *pBuf = getBuf();
+        if (!pBuf)
+            break;
+        struct io_uring_sqe *pSqe = getSqe();
+        if (!pSqe)
+        {
+            recycleBuf(pBuf);
+            break;
+        }
+        pSqe->opcode = IORING_OP_READ;
+        pSqe->fd = fd;
+        pSqe->off = (uint64_t)-1;
+        pSqe->addr = (uint64_t)(uintptr_t)pBuf;
+        pSqe->len = IOU_IO_BUF_SIZE;
+        pSqe->user_data = IOU_USER_DATA(fd, pState->m_iIoGen) | IOU_READ;
+        pState->m_pReadBuf = pBuf;
+        pState->m_iReadOff = 0;
+        pState->m_iReadLen = 0;
+        pState->m_iIoFlags |= IOF_READING;
+        ++count;
+    }
+    return count;
+}
+
+
+/**
+ * The fds are non-blocking, a READ or WRITE completes inside the
+ * io_uring_enter() that submits it. Their completions are taken right
+ * away, the others are put aside for processCompletions().
+ */
+void IoUring::reapIo()
+{
+    unsigned head = *m_pCqHead;
+    unsigned tail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+    while (head != tail)
+    {
+        const struct io_uring_cqe *pCqe = &m_pCqes[head++ & m_iCqMask];
+        if (pCqe->user_data & (IOU_READ | IOU_WRITE))
+            onIoDone(pCqe->user_data, pCqe->res);
+        else if (pCqe->user_data != IOU_IGNORE)
+            memcpy(m_pDeferred->getNew(), pCqe, sizeof(*pCqe));
+    }
+    __atomic_store_n(m_pCqHead, head, __ATOMIC_RELEASE);
+}
+
+
+void IoUring::onIoDone(uint64_t ud, int res)
+{
+    for (Orphan *p = m_pOrphans->begin(); p < m_pOrphans->end(); ++p)
+    {
+        if (p->m_ud == ud)
+        {
+            onOrphanDone(p, res);
+            return;
+        }
+    }
+    int fd = IOU_USER_FD(ud);
+    if ((unsigned)fd >= m_iFdStateCap)
+        return;
+    FdState *pState = &m_pFdStates[fd];
+    if (pState->m_iIoGen != IOU_USER_GEN(ud))
+        return;
+    if (ud & IOU_READ)
+    {
+        pState->m_iIoFlags &= ~IOF_READING;
+        if ((res == -EAGAIN) || (res == -EINTR) || (res == -ECANCELED))
+        {
+            recycleBuf(pState->m_pReadBuf);
+            pState->m_pReadBuf = NULL;
+            return;
+        }
+        //0 for end of stream, -errno for an error, both handed to read()
+        pState->m_iReadOff = 0;
+        pState->m_iReadLen = res;
+        //nothing to do if the reactor takes it in this batch already
+        addPending(fd, pState);
+        return;
+    }
+
+    pState->m_iIoFlags &= ~IOF_WRITING;
+    if (res > 0)
+        pState->m_iWriteOff += res;
+    else if (res && (res != -EAGAIN) && (res != -EINTR))
+        pState->m_iWriteErr = -res;
+    if (pState->m_iWriteErr || (pState->m_iWriteOff >= pState->m_iWriteLen))
+        onWriteDone(fd, pState);
+    else
+        //the fd is full, the rest goes with the next POLLOUT
+        requestUpdate(fd);
+}
+
+
+void IoUring::onWriteDone(int fd, FdState *pState)
+{
+    recycleBuf(pState->m_pWriteBuf);
+    pState->m_pWriteBuf = NULL;
+    if (pState->m_iIoFlags & IOF_SHUTDOWN)
+    {
+        pState->m_iIoFlags &= ~IOF_SHUTDOWN;
+        if (!pState->m_iWriteErr)
+            ::shutdown(fd, SHUT_WR);
+    }
+    if (pState->m_iIoFlags & IOF_OUT_HELD)
+        addPending(fd, pState);
+    //the POLLOUT armed for the queue is not needed any more
+    requestUpdate(fd);
+}
+
+
+short IoUring::filterEvents(int fd, FdState *pState, short events)
+{
+    if ((events & POLLOUT) && pState->m_pWriteBuf)
+    {
+        //the queue goes first, the reactor gets POLLOUT after it
+        if (!(pState->m_iIoFlags & IOF_WRITING))
+            queueWrite(fd, pState);
+        pState->m_iIoFlags |= IOF_OUT_HELD;
+        events &= ~POLLOUT;
+    }
+    return events;
+}
+
+
+void IoUring::checkLeftover(int fd, EventReactor *pReactor)
+{
+    if (((unsigned)fd >= m_iFdStateCap)
+        || (m_reactorIndex.get(fd) != pReactor))
+        return;
+    FdState *pState = &m_pFdStates[fd];
+    //read ahead the reactor has not taken yet, the fd will not tell
+    if (pState->m_pReadBuf && !(pState->m_iIoFlags & IOF_READING)
+        && (pReactor->getEvents() & POLLIN))
+        addPending(fd, pState);
+}
+
+
+int IoUring::dispatchPending()
+{
+    int n = m_pPending->getSize();
+    int count = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        int fd = *m_pPending->getObj(i);
+        FdState *pState = &m_pFdStates[fd];
+        pState->m_iIoFlags &= ~IOF_PENDING;
+        EventReactor *pReactor = m_reactorIndex.get(fd);
+        if (!pReactor || (pReactor->getfd() != fd))
+            continue;
+        short events = 0;
+        if (pState->m_pReadBuf && !(pState->m_iIoFlags & IOF_READING))
+            events |= POLLIN;
+        if ((pState->m_iIoFlags & IOF_OUT_HELD) && !pState->m_pWriteBuf)
+        {
+            pState->m_iIoFlags &= ~IOF_OUT_HELD;
+            events |= POLLOUT;
+        }
+        events &= pReactor->getEvents();
+        if (!events)
+            continue;
+        uint32_t gen = pState->m_iIoGen;
+        pReactor->assignRevent(events);
+        pReactor->handleEvents(events);
+        ++count;
+        if (m_pFdStates[fd].m_iIoGen == gen)
+            checkLeftover(fd, pReactor);
+    }
+    int left = m_pPending->getSize() - n;
+    if (left > 0)
+        memmove(m_pPending->begin(), m_pPending->begin() + n,
+                left * sizeof(int));
+    m_pPending->setSize(left);
+    return count;
+}
+
+
+/**
+ * Called when the fd is removed or taken by a new reactor. Requests in
+ * flight keep their buffers as orphans. On remove() the fd is still open
+ * and queued data is written, what the fd does not take right away goes
+ * to a dup of it that is closed once the data is out.
+ */
+void IoUring::releaseIo(int fd, FdState *pState, int flush)
+{
+    Orphan orphan;
+    orphan.m_fd = -1;
+    if (pState->m_pReadBuf)
+    {
+        if (pState->m_iIoFlags & IOF_READING)
+        {
+            orphan.m_ud = IOU_USER_DATA(fd, pState->m_iIoGen) | IOU_READ;
+            orphan.m_pBuf = pState->m_pReadBuf;
+            orphan.m_iOff = orphan.m_iLen = 0;
+            *m_pOrphans->getNew() = orphan;
+        }
+        else
+            recycleBuf(pState->m_pReadBuf);
+        pState->m_pReadBuf = NULL;
+    }
+    if (pState->m_pWriteBuf)
+    {
+        int writing = pState->m_iIoFlags & IOF_WRITING;
+        orphan.m_ud = IOU_USER_DATA(fd, pState->m_iIoGen) | IOU_WRITE;
+        orphan.m_pBuf = pState->m_pWriteBuf;
+        orphan.m_iOff = pState->m_iWriteOff;
+        orphan.m_iLen = pState->m_iWriteLen;
+        pState->m_pWriteBuf = NULL;
+        if (flush && !writing && !pState->m_iWriteErr)
+        {
+            int ret = ::write(fd, orphan.m_pBuf + orphan.m_iOff,
+                              orphan.m_iLen - orphan.m_iOff);
+            if (ret > 0)
+                orphan.m_iOff += ret;
+            else if ((ret == -1) && (errno != EAGAIN) && (errno != EINTR))
+                orphan.m_iOff = orphan.m_iLen;
+        }
+        if (flush && !pState->m_iWriteErr && (orphan.m_iOff < orphan.m_iLen))
+            orphan.m_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (writing || (orphan.m_fd != -1))
+        {
+            Orphan *pOrphan = m_pOrphans->getNew();
+            *pOrphan = orphan;
+            if (!writing && (sendOrphan(pOrphan) == LS_FAIL))
+                onOrphanDone(pOrphan, 0);
+        }
+        else
+            recycleBuf(orphan.m_pBuf);
+    }
+    pState->m_iIoFlags = 0;
+    pState->m_iRingIo = 0;
+    pState->m_iWriteErr = 0;
+    ++pState->m_iIoGen;
+}
+
+
+int IoUring::sendOrphan(Orphan *pOrphan)
+{
+    static struct __kernel_timespec s_timeout = { IOU_ORPHAN_TIMEOUT, 0 };
+    struct io_uring_sqe *pSqe;
+    if (m_iSqEntries - (*m_pSqTail
+                        - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE)) < 2)
+        submit(0, 0);
+    if ((pSqe = getSqe()) == NULL)
+        return LS_FAIL;
+    //no MSG_DONTWAIT, the kernel waits for the socket to take it
+    pOrphan->m_ud = IOU_USER_DATA(pOrphan->m_fd, 0) | IOU_WRITE;
+    pSqe->opcode = IORING_OP_SEND;
+    pSqe->fd = pOrphan->m_fd;
+    pSqe->flags = IOSQE_IO_LINK;
+    pSqe->addr = (uint64_t)(uintptr_t)(pOrphan->m_pBuf + pOrphan->m_iOff);
+    pSqe->len = pOrphan->m_iLen - pOrphan->m_iOff;
+    pSqe->msg_flags = MSG_NOSIGNAL;
+    pSqe->user_data = pOrphan->m_ud;
+    if ((pSqe = getSqe()) == NULL)
+        return LS_OK;
+    pSqe->opcode = IORING_OP_LINK_TIMEOUT;
+    pSqe->fd = -1;
+    pSqe->addr = (uint64_t)(uintptr_t)&s_timeout;
+    pSqe->len = 1;
+    pSqe->user_data = IOU_IGNORE;
+    return LS_OK;
+}
+
+
+void IoUring::onOrphanDone(Orphan *pOrphan, int res)
+{
+    if (res > 0)
+        pOrphan->m_iOff += res;
+    if ((pOrphan->m_fd != -1) && (pOrphan->m_iOff < pOrphan->m_iLen)
+        && ((res > 0) || (res == -EAGAIN) || (res == -EINTR))
+        && (sendOrphan(pOrphan) == LS_OK))
+        return;
+    if (pOrphan->m_fd != -1)
+        ::close(pOrphan->m_fd);
+    recycleBuf(pOrphan->m_pBuf);
+    *pOrphan = *(m_pOrphans->end() - 1);
+    m_pOrphans->pop();
+}
+
+
+int IoUring::read(EventReactor *pHandler, char *pBuf, int size)
+{
+    int fd = pHandler->getfd();
+    if (((unsigned)fd >= m_iFdStateCap) || (m_reactorIndex.get(fd) != pHandler))
+        return ::read(fd, pBuf, size);
+    FdState *pState = &m_pFdStates[fd];
+    pState->m_iRingIo = 1;
+    if (!pState->m_pReadBuf)
+        return ::read(fd, pBuf, size);
+    if (pState->m_iIoFlags & IOF_READING)
+    {
+        //the data is on its way to the buffer, must not get ahead of it.
+        errno = EAGAIN;
+        return -1;
+    }
+    int len = pState->m_iReadLen;
+    if (len <= 0)
+    {
+        recycleBuf(pState->m_pReadBuf);
+        pState->m_pReadBuf = NULL;
+        if (len == 0)
+            return 0;
+        errno = -len;
+        return -1;
+    }
+    len -= pState->m_iReadOff;
+    if (len > size)
+        len = size;
+    memmove(pBuf, pState->m_pReadBuf + pState->m_iReadOff, len);
+    pState->m_iReadOff += len;
+    if (pState->m_iReadOff < pState->m_iReadLen)
+        return len;
+    int full = (pState->m_iReadLen == IOU_IO_BUF_SIZE);
+    recycleBuf(pState->m_pReadBuf);
+    pState->m_pReadBuf = NULL;
+    //the read ahead stopped at the end of the buffer, there may be more.
+    if (full && (len < size))
+    {
+        int ret = ::read(fd, pBuf + len, size - len);
+        if (ret > 0)
+            len += ret;
+    }
+    return len;
+}
+
+
+int IoUring::writev(EventReactor *pHandler, const struct iovec *vec,
+                    int count)
+{
+    int fd = pHandler->getfd();
+    if (((unsigned)fd >= m_iFdStateCap) || (m_reactorIndex.get(fd) != pHandler))
+        return ::writev(fd, vec, count);
+    FdState *pState = &m_pFdStates[fd];
+    if (pState->m_iWriteErr)
+    {
+        errno = pState->m_iWriteErr;
+        return -1;
+    }
+    int i, total = 0;
+    for (i = 0; i < count; ++i)
+        total += vec[i].iov_len;
+    if (total <= 0)
+        return 0;
+    char *pBuf = pState->m_pWriteBuf;
+    if (pBuf)
+    {
+        if (pState->m_iIoFlags & IOF_WRITING)
+        {
+            pState->m_iIoFlags |= IOF_OUT_HELD;
+            errno = EAGAIN;
+            return -1;
+        }
+        if (pState->m_iWriteOff > 0)
+        {
+            pState->m_iWriteLen -= pState->m_iWriteOff;
+            memmove(pBuf, pBuf + pState->m_iWriteOff, pState->m_iWriteLen);
+            pState->m_iWriteOff = 0;
+        }
+    }
+    else if ((total <= IOU_IO_BUF_SIZE) && ((pBuf = getBuf()) != NULL))
+    {
+        pState->m_pWriteBuf = pBuf;
+        pState->m_iWriteOff = 0;
+        pState->m_iWriteLen = 0;
+    }
+    else
+        return ::writev(fd, vec, count);
+
+    if (total <= IOU_IO_BUF_SIZE - pState->m_iWriteLen)
+    {
+        for (i = 0; i < count; ++i)
+        {
+            memmove(pBuf + pState->m_iWriteLen, vec[i].iov_base,
+                    vec[i].iov_len);
+            pState->m_iWriteLen += vec[i].iov_len;
+        }
+        queueWrite(fd, pState);
+        return total;
+    }
+
+    //too much to queue, the queue and the new data in one writev()
+    int queued = pState->m_iWriteLen;
+    int ret;
+    if (count < IOU_IOV_MAX)
+    {
+        struct iovec iov[IOU_IOV_MAX];
+        iov[0].iov_base = pBuf;
+        iov[0].iov_len = queued;
+        memmove(&iov[1], vec, count * sizeof(struct iovec));
+        ret = ::writev(fd, iov, count + 1);
+    }
+    else
+        ret = ::write(fd, pBuf, queued);
+    if (ret == -1)
+    {
+        if ((errno != EAGAIN) && (errno != EINTR))
+        {
+            pState->m_iWriteErr = errno;
+            onWriteDone(fd, pState);
+            errno = pState->m_iWriteErr;
+            return -1;
+        }
+        ret = 0;
+    }
+    if (ret < queued)
+    {
+        pState->m_iWriteOff = ret;
+        pState->m_iIoFlags |= IOF_OUT_HELD;
+        requestUpdate(fd);
+        errno = EAGAIN;
+        return -1;
+    }
+    onWriteDone(fd, pState);
+    if (count >= IOU_IOV_MAX)
+        return ::writev(fd, vec, count);
+    return ret - queued;
+}
+
+
+int IoUring::flushWrite(EventReactor *pHandler)
+{
+    int fd = pHandler->getfd();
+    if (((unsigned)fd >= m_iFdStateCap) || (m_reactorIndex.get(fd) != pHandler)
+        || !m_pFdStates[fd].m_pWriteBuf)
+        return LS_OK;
+    FdState *pState = &m_pFdStates[fd];
+    if (!(pState->m_iIoFlags & IOF_WRITING))
+    {
+        int ret = ::write(fd, pState->m_pWriteBuf + pState->m_iWriteOff,
+                          pState->m_iWriteLen - pState->m_iWriteOff);
+        if (ret > 0)
+            pState->m_iWriteOff += ret;
+        else if ((ret == -1) && (errno != EAGAIN) && (errno != EINTR))
+            pState->m_iWriteErr = errno;
+        if (pState->m_iWriteErr
+            || (pState->m_iWriteOff >= pState->m_iWriteLen))
+        {
+            onWriteDone(fd, pState);
+            if (!pState->m_iWriteErr)
+                return LS_OK;
+            errno = pState->m_iWriteErr;
+            return LS_FAIL;
+        }
+        requestUpdate(fd);
+    }
+    pState->m_iIoFlags |= IOF_OUT_HELD;
+    errno = EAGAIN;
+    return LS_FAIL;
+}
+
+
+int IoUring::shutdownWrite(EventReactor *pHandler)
+{
+    int fd = pHandler->getfd();
+    if (((unsigned)fd < m_iFdStateCap) && (m_reactorIndex.get(fd) == pHandler)
+        && m_pFdStates[fd].m_pWriteBuf)
+    {
+        //done once the queue is written
+        m_pFdStates[fd].m_iIoFlags |= IOF_SHUTDOWN;
+        return LS_OK;
+    }
+    return ::shutdown(fd, SHUT_WR);
+}
+
+
+void IoUring::timerExecute()
+{
+    m_reactorIndex.timerExec();
+}
+
+
+void IoUring::continueRead(EventReactor *pHandler)
+{
+    if (!(pHandler->getEvents() & POLLIN))
+    {
+        addEvent(pHandler, POLLIN);
+        checkLeftover(pHandler->getfd(), pHandler);
+    }
+}
+
+
+void IoUring::suspendRead(EventReactor *pHandler)
+{
+    if (pHandler->getEvents() & POLLIN)
+        removeEvent(pHandler, POLLIN);
+}
+
+
+void IoUring::continueWrite(EventReactor *pHandler)
+{
+    if (!(pHandler->getEvents() & POLLOUT))
+        addEvent(pHandler, POLLOUT);
+}
+
+
+void IoUring::suspendWrite(EventReactor *pHandler)
+{
+    if (pHandler->getEvents() & POLLOUT)
+        removeEvent(pHandler, POLLOUT);
+}
+
+
+void IoUring::switchWriteToRead(EventReactor *pHandler)
+{
+    setEvents(pHandler, POLLIN | POLLHUP | POLLERR);
+}
+
+
+void IoUring::switchReadToWrite(EventReactor *pHandler)
+{
+    setEvents(pHandler, POLLOUT | POLLHUP | POLLERR);
+}
+
+#endif //LS_HAS_IO_URING
@@ -0,0 +1,232 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef IOURING_H
+#define IOURING_H
+
+#if defined(linux) || defined(__linux) || defined(__linux__) || defined(__gnu_linux__)
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+//older kernel headers lack the timeout argument of io_uring_enter() and
+//multishot poll, both are required.
+#if defined(IORING_FEAT_EXT_ARG) && defined(IORING_POLL_ADD_MULTI) \
+    && defined(IORING_FEAT_RSRC_TAGS)
+#define LS_HAS_IO_URING 1
+#endif
+#endif
+#endif
+#endif
+
+#ifdef LS_HAS_IO_URING
+
+#include <edio/multiplexer.h>
+#include <edio/reactorindex.h>
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+  * Multiplexer built on io_uring poll requests.
+  *
+  * Every registered fd has one multishot POLL_ADD request in flight, it
+  * stays armed across events. Changes of the event mask, new registrations
+  * and the few re-arms needed are queued in the submission ring and handed
+  * to the kernel together with the wait for completions, so one loop of
+  * the event dispatcher costs a single io_uring_enter() no matter how many
+  * reactors changed state.
+  *
+  * A multishot poll only reports new readiness, while the reactors expect
+  * the level triggered behavior of epoll. A reactor that ran into EAGAIN
+  * clears the event from its revents, one that did not may have data left,
+  * so a single shot POLL_ADD with a zero linked timeout is queued for it,
+  * which tells right away whether the fd is still ready.
+  *
+  * Reactors doing their plain socket I/O through read() and writev() get it
+  * batched as well. The fds reported readable in a batch of completions
+  * are read ahead with one READ request each, all submitted together before
+  * the reactors are called, read() then hands out the data. Small writes
+  * are copied to a queue and go out as WRITE requests with the next wait,
+  * a reactor finding the queue busy gets EAGAIN and its POLLOUT once the
+  * queue is written. flushWrite() and shutdownWrite() keep sendfile() and
+  * the shutdown in order with the queued data, remove() hands data still
+  * queued to a dup of the socket that is closed once it is written.
+  */
+struct io_uring_sqe;
+struct io_uring_cqe;
+template< typename T >
+class TObjArray;
+
+
+class IoUring : public Multiplexer
+{
+    struct FdState
+    {
+        uint32_t    m_iGeneration;
+        short       m_iArmedMask;
+        char        m_iArmed;
+        char        m_iRecheck;
+        //bumped when the fd changes hands, tags READ and WRITE requests.
+        uint32_t    m_iIoGen;
+        short       m_iIoFlags;
+        char        m_iRingIo;
+        char        m_iReserved;
+        char       *m_pReadBuf;
+        int         m_iReadOff;
+        int         m_iReadLen;
+        char       *m_pWriteBuf;
+        int         m_iWriteOff;
+        int         m_iWriteLen;
+        int         m_iWriteErr;
+    };
+
+    struct Result
+    {
+        int         m_fd;
+        uint32_t    m_iGen;
+        short       m_iEvents;
+    };
+
+    //queued data of a removed fd, written and freed once its request is done
+    struct Orphan
+    {
+        uint64_t    m_ud;
+        char       *m_pBuf;
+        int         m_fd;
+        int         m_iOff;
+        int         m_iLen;
+    };
+
+    int                 m_fd;
+    unsigned           *m_pSqHead;
+    unsigned           *m_pSqTail;
+    unsigned           *m_pSqArray;
+    unsigned            m_iSqMask;
+    unsigned            m_iSqEntries;
+    unsigned            m_iSqPending;
+    struct io_uring_sqe *m_pSqes;
+    unsigned           *m_pCqHead;
+    unsigned           *m_pCqTail;
+    unsigned            m_iCqMask;
+    struct io_uring_cqe *m_pCqes;
+
+    void               *m_pSqRing;
+    size_t              m_iSqRingSize;
+    void               *m_pCqRing;
+    size_t              m_iCqRingSize;
+    size_t              m_iSqesSize;
+
+    ReactorIndex        m_reactorIndex;
+    FdState            *m_pFdStates;
+    unsigned            m_iFdStateCap;
+    TObjArray<int>     *m_pUpdates;
+    TObjArray<int>     *m_pRearms;
+    TObjArray<int>     *m_pRechecks;
+    TObjArray<int>     *m_pWrites;
+    TObjArray<int>     *m_pPending;
+    TObjArray<char *>  *m_pFreeBufs;
+    TObjArray<Orphan>  *m_pOrphans;
+    TObjArray<struct io_uring_cqe> *m_pDeferred;
+    int                 m_iDeferredNext;
+
+    int  setupRing(int entries);
+    void releaseRing();
+    FdState *getFdState(int fd);
+    struct io_uring_sqe *getSqe();
+    int  submit(int waitNr, int iTimeoutMilliSec);
+
+    short armMask(const FdState *pState, short mask) const;
+    void arm(int fd, FdState *pState, short mask);
+    void recheck(int fd, FdState *pState, short mask);
+    void disarm(int fd, FdState *pState);
+    int  updateEvents(EventReactor *pHandler, short mask);
+
+    void addEvent(EventReactor *pHandler, short mask)
+    {
+        pHandler->orMask2(mask);
+        updateEvents(pHandler, pHandler->getEvents());
+    }
+    void removeEvent(EventReactor *pHandler, short mask)
+    {
+        pHandler->andMask2(~mask);
+        updateEvents(pHandler, pHandler->getEvents());
+    }
+    void setEvents(EventReactor *pHandler, short mask)
+    {
+        if (pHandler->getEvents() != mask)
+        {
+            pHandler->setMask2(mask);
+            updateEvents(pHandler, mask);
+        }
+    }
+
+    void appendFd(TObjArray<int> *pArray, int fd);
+    void applyEvents();
+    void applyRearms();
+    void applyRechecks();
+    void applyWrites();
+    int  processCompletions();
+
+    char *getBuf();
+    void recycleBuf(char *pBuf);
+    void requestUpdate(int fd);
+    void queueWrite(int fd, FdState *pState);
+    void addPending(int fd, FdState *pState);
+    int  queueReads(const Result *pResults, int n);
+    void reapIo();
+    void onIoDone(uint64_t ud, int res);
+    void onWriteDone(int fd, FdState *pState);
+    short filterEvents(int fd, FdState *pState, short events);
+    void checkLeftover(int fd, EventReactor *pReactor);
+    int  dispatchPending();
+    void releaseIo(int fd, FdState *pState, int flush);
+    int  sendOrphan(Orphan *pOrphan);
+    void onOrphanDone(Orphan *pOrphan, int res);
+
+public:
+    IoUring();
+    ~IoUring();
+    virtual int getHandle() const   {   return m_fd;    }
+    virtual int init(int capacity = DEFAULT_CAPACITY);
+    virtual int add(EventReactor *pHandler, short mask);
+    virtual int remove(EventReactor *pHandler);
+    virtual int waitAndProcessEvents(int iTimeoutMilliSec);
+    virtual void timerExecute();
+    virtual void setPriHandler(EventReactor::pri_handler handler) {};
+
+    virtual void continueRead(EventReactor *pHandler);
+    virtual void suspendRead(EventReactor *pHandler);
+    virtual void continueWrite(EventReactor *pHandler);
+    virtual void suspendWrite(EventReactor *pHandler);
+    virtual void switchWriteToRead(EventReactor *pHandler);
+    virtual void switchReadToWrite(EventReactor *pHandler);
+
+    virtual int read(EventReactor *pHandler, char *pBuf, int size);
+    virtual int writev(EventReactor *pHandler, const struct iovec *vec,
+                       int count);
+    virtual int flushWrite(EventReactor *pHandler);
+    virtual int shutdownWrite(EventReactor *pHandler);
+
+    static int isSupported();
+
+    LS_NO_COPY_ASSIGN(IoUring);
+
+};
+
+#endif //LS_HAS_IO_URING
+
+#endif
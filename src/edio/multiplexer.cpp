@@ -18,6 +18,9 @@
 #include <edio/multiplexer.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 Multiplexer::Multiplexer()
     : m_iFLTag(O_NONBLOCK | O_RDWR)
@@ -51,3 +54,13 @@ void Multiplexer::modEvent(EventReactor *pHandler, short mask,
 }
 
 
+int Multiplexer::read(EventReactor *pHandler, char *pBuf, int size)
+{   return ::read(pHandler->getfd(), pBuf, size);    }
+
+int Multiplexer::writev(EventReactor *pHandler, const struct iovec *vec,
+                        int count)
+{   return ::writev(pHandler->getfd(), vec, count);  }
+
+int Multiplexer::shutdownWrite(EventReactor *pHandler)
+{   return ::shutdown(pHandler->getfd(), SHUT_WR);   }
+
@@ -22,6 +22,8 @@
 
 #include <edio/eventreactor.h>
 
+struct iovec;
+
 class Multiplexer
 {
     int m_iFLTag;
@@ -49,6 +51,15 @@ public:
     virtual void switchReadToWrite(EventReactor *pHandler);
     virtual void modEvent(EventReactor *pHandler, short mask, int add_remove);
 
+    //Plain socket I/O of a reactor, a direct syscall by default. A
+    //multiplexer may read ahead and queue writes to batch them.
+    virtual int read(EventReactor *pHandler, char *pBuf, int size);
+    virtual int writev(EventReactor *pHandler, const struct iovec *vec,
+                       int count);
+    //returns LS_FAIL with EAGAIN while queued writes are not out yet.
+    virtual int flushWrite(EventReactor *pHandler)  {   return LS_OK;   }
+    virtual int shutdownWrite(EventReactor *pHandler);
+
     int  getFLTag() const   {   return m_iFLTag;        }
     void setFLTag(int tag)  {   m_iFLTag = tag;         }
 
@@ -19,6 +19,7 @@
 
 #include <edio/devpoller.h>
 #include <edio/epoll.h>
+#include <edio/iouring.h>
 #include <edio/kqueuer.h>
 #include <edio/poller.h>
 #include <edio/rtsigio.h>
@@ -34,6 +35,7 @@ static const char *s_sType[MultiplexerFactory::BEST + 1] =
     "kqueue",
     "rtsig",
     "epoll",
+    "iouring",
     "best"
 };
 
@@ -54,7 +56,8 @@ int MultiplexerFactory::getType(const char *pType)
             if (strcasecmp(pType, s_sType[i]) == 0)
                 break;
         }
-        i = BEST;
+        if (i > BEST)
+            i = BEST;
     }
     if (i == BEST)
     {
@@ -75,6 +78,14 @@ int MultiplexerFactory::getType(const char *pType)
 }
 
 
+const char *MultiplexerFactory::getTypeName(int type)
+{
+    if ((type < 0) || (type > BEST))
+        type = BEST;
+    return s_sType[type];
+}
+
+
 Multiplexer *MultiplexerFactory::getNew(int type)
 {
     switch (type)
@@ -88,6 +99,10 @@ Multiplexer *MultiplexerFactory::getNew(int type)
     case BEST:
     case EPOLL:
         return new epoll();
+#ifdef LS_HAS_IO_URING
+    case IO_URING:
+        return new IoUring();
+#endif
 #endif
 
 #if defined(sun) || defined(__sun)
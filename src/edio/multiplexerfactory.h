@@ -42,9 +42,11 @@ public:
         KQUEUE,
         RT_SIG,
         EPOLL,
+        IO_URING,
         BEST
     };
     static int getType(const char *pType);
+    static const char *getTypeName(int type);
     static Multiplexer *getNew(int type);
     static void recycle(Multiplexer *ptr);
 
@@ -18,6 +18,7 @@
 #include "localworkerconfig.h"
 #include "localworker.h"
 #include "registry/extappregistry.h"
+#include <extensions/lsapi/lsapiconfig.h>
 
 #include <http/httpserverconfig.h>
 #include <http/serverprocessconfig.h>
@@ -44,6 +45,7 @@ LocalWorkerConfig::LocalWorkerConfig(const char *pName)
     , m_iPriority(0)
     , m_iRunOnStartUp(0)
     , m_umask(ServerProcessConfig::getInstance().getUMask())
+    , m_iPhpHandler(0)
 {
 }
 
@@ -54,6 +56,7 @@ LocalWorkerConfig::LocalWorkerConfig()
     , m_iInstances(1)
     , m_iPriority(0)
     , m_iRunOnStartUp(0)
+    , m_iPhpHandler(0)
 {
 }
 
@@ -70,6 +73,7 @@ LocalWorkerConfig::LocalWorkerConfig(const LocalWorkerConfig &rhs)
     m_iPriority = rhs.m_iPriority;
     m_rlimits = rhs.m_rlimits;
     m_iRunOnStartUp = rhs.m_iRunOnStartUp;
+    m_iPhpHandler = rhs.m_iPhpHandler;
 
 }
 
@@ -173,7 +177,13 @@ int LocalWorkerConfig::checkExtAppSelfManagedAndFixEnv(int maxIdleTime)
                           (maxIdleTime > DETACH_MODE_MIN_MAX_IDLE)
                           ? maxIdleTime : DETACH_MODE_MIN_MAX_IDLE);
     }
-    
+
+    //lets a LSAPI backend advertise the shared memory transport, the
+    //registry marks LSAPI apps with setPhpHandler()
+    if (isPhpHandler() && (LsapiConfig::getShmRingSize() > 0)
+        && (pEnv->find("LSAPI_SHM_TRANSPORT") == NULL))
+        pEnv->add("LSAPI_SHM_TRANSPORT=1");
+
     pEnv->add(0, 0, 0, 0);
     return selfManaged;
 }
@@ -17,6 +17,9 @@
 *****************************************************************************/
 #include "lsapiconfig.h"
 
+int LsapiConfig::s_iShmRingSize = 0;
+
+
 LsapiConfig::LsapiConfig(const char *pName)
     : LocalWorkerConfig(pName)
 {
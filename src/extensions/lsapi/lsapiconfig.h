@@ -30,6 +30,13 @@ public:
     LsapiConfig();
 
     ~LsapiConfig();
+
+    //0 disables the shared memory transport
+    static void setShmRingSize(int size)    {   s_iShmRingSize = size;  }
+    static int  getShmRingSize()            {   return s_iShmRingSize;  }
+
+private:
+    static int  s_iShmRingSize;
 };
 
 #endif
@@ -18,6 +18,7 @@
 #include "lsapiconn.h"
 #include "lsapiworker.h"
 #include "lsapiconfig.h"
+#include "lsapishm.h"
 
 #include <extensions/localworker.h>
 #include <extensions/registry/extappregistry.h>
@@ -32,8 +33,10 @@
 #include <http/httpstatuscode.h>
 #include <log4cxx/logger.h>
 #include <util/datetime.h>
+#include <util/fdpass.h>
 
 #include <fcntl.h>
+#include <string.h>
 #include <sys/socket.h>
 
 //#define DBG_LSAPI
@@ -64,6 +67,9 @@ LsapiConn::LsapiConn()
     , m_lReqSentTime(0)
     , m_lsreq(&m_iovec)
     , m_respState(LSAPI_CONN_IDLE)
+    , m_pShm(NULL)
+    , m_iShmState(LSAPI_SHM_NONE)
+    , m_iShmFlags(0)
 
 {
 }
@@ -71,11 +77,13 @@ LsapiConn::LsapiConn()
 
 LsapiConn::~LsapiConn()
 {
+    releaseShm();
 }
 
 
 void LsapiConn::init(int fd, Multiplexer *pMplx)
 {
+    releaseShm();
     EdStream::init(fd, pMplx, POLLIN | POLLOUT | POLLHUP | POLLERR);
     reset();
 
@@ -129,6 +137,7 @@ int LsapiConn::connect(Multiplexer *pMplx)
 int LsapiConn::close()
 {
     ExtConn::close();
+    releaseShm();
     if (m_pid > 0)
     {
         ((LsapiWorker *)getWorker())->moveToStopList(m_pid);
@@ -140,6 +149,12 @@ int LsapiConn::close()
 
 int LsapiConn::doWrite()
 {
+    if (m_iShmFlags & LSAPI_SHM_KICK)
+    {
+        m_iShmFlags &= ~LSAPI_SHM_KICK;
+        if (doRead() == LS_FAIL)
+            return LS_FAIL;
+    }
     if (getConnector())
     {
         int state = getConnector()->getState();
@@ -167,8 +182,11 @@ int LsapiConn::doWrite()
 
 int LsapiConn::sendReqHeader()
 {
-    int ret = m_lsreq.buildReq(getConnector()->getHttpSession(),
-                               &m_iTotalPending);
+    int ret;
+    if ((m_iShmState == LSAPI_SHM_AVAILABLE) && (startShm() == LS_FAIL))
+        return LS_FAIL;
+    ret = m_lsreq.buildReq(getConnector()->getHttpSession(),
+                           &m_iTotalPending);
     if (ret)
     {
         LS_INFO(this, "Failed to build LSAPI request header, "
@@ -305,6 +323,9 @@ int  LsapiConn::flush()
                 m_iovec.finish(ret);
                 return 1;
             }
+            //a full ring is not an error, the doorbell resumes writing
+            if ((ret == 0) && m_pShm)
+                return 1;
             return LS_FAIL;
         }
     }
@@ -316,6 +337,12 @@ int LsapiConn::doRead()
 {
     LS_DBG_L(this, "LsapiConn::doRead()");
     int ret;
+    int closed = 0;
+    if (m_pShm)
+    {
+        closed = (drainDoorbell() == LS_FAIL);
+        m_iShmFlags |= LSAPI_SHM_IN_READ;
+    }
     ret = processResp();
 //    if ( m_respState )
 //        ret = processResp();
@@ -339,6 +366,21 @@ int LsapiConn::doRead()
             getConnector()->endResponse(0, 0);
         }
     }
+    if (m_pShm)
+    {
+        m_iShmFlags &= ~LSAPI_SHM_IN_READ;
+        //data left, or a corrupted ring that fails the next read
+        if (m_pShm->getRespRing().getDataLen() != 0)
+        {
+            if ((ret != LS_FAIL) && (getEvents() & POLLIN))
+                kickShmRead();
+        }
+        else if (closed)
+        {
+            errno = ECONNRESET;
+            return LS_FAIL;
+        }
+    }
     return ret;
 }
 
@@ -355,6 +397,7 @@ const char *s_packetName[] =
     "LSAPI_REQ_RECEIVED",
     "LSAPI_CONN_CLOSE",
     "LSAPI_INTERNAL_ERROR",
+    "LSAPI_SHM_SUPPORTED",
 };
 
 
@@ -363,7 +406,7 @@ inline int verifyPacketHeader(struct lsapi_packet_header *pHeader)
     if ((LSAPI_VERSION_B0 != pHeader->m_versionB0) ||
         (LSAPI_VERSION_B1 != pHeader->m_versionB1) ||
         (LSAPI_RESP_HEADER > pHeader->m_type) ||
-        (LSAPI_INTERNAL_ERROR < pHeader->m_type))
+        (LSAPI_SHM_SUPPORTED < pHeader->m_type))
         return LS_FAIL;
     if (LSAPI_ENDIAN != (pHeader->m_flag & LSAPI_ENDIAN_BIT))
     {
@@ -450,6 +493,9 @@ int LsapiConn::processPacketHeader(char *pBuf, int len)
         case LSAPI_CONN_CLOSE:
             markToClose();
             return 0;
+        case LSAPI_SHM_SUPPORTED:
+            shmSupported();
+            break;
         }
     }
     return len;
@@ -637,6 +683,9 @@ int LsapiConn::processResp()
                     case LSAPI_CONN_CLOSE:
                         markToClose();
                         return 0;
+                    case LSAPI_SHM_SUPPORTED:
+                        shmSupported();
+                        break;
                     }
                 }
             }
@@ -784,7 +833,7 @@ int LsapiConn::processRespHeader()
     {
         while (m_iPacketLeft > 0)
         {
-            len = ExtConn::read(m_pRespHeader, m_pRespHeaderBufEnd - m_pRespHeader);
+            len = read(m_pRespHeader, m_pRespHeaderBufEnd - m_pRespHeader);
             LS_DBG_M(this, "Process response header %d bytes", len);
             if (len > 0)
             {
@@ -1164,6 +1213,207 @@ int LsapiConn::onTimer()
 }
 
 
+void LsapiConn::shmSupported()
+{
+    if ((LsapiConfig::getShmRingSize() > 0)
+        && (m_iShmState == LSAPI_SHM_NONE))
+    {
+        LS_DBG_L(this, "[LSAPI] backend supports shared memory transport.");
+        m_iShmState = LSAPI_SHM_AVAILABLE;
+    }
+}
+
+
+/**
+ * Offers a shared memory segment to the backend, between two requests so
+ * that the socket has nothing else in flight. The backend switches as soon
+ * as it reads the offer, so the request that follows already goes through
+ * the ring. Returns LS_FAIL only if the socket stream got broken; any
+ * other failure keeps the connection on the socket protocol.
+ */
+int LsapiConn::startShm()
+{
+    struct lsapi_shm_offer offer;
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    m_iShmState = LSAPI_SHM_NONE;
+    if ((getsockname(getfd(), (struct sockaddr *)&addr, &len) == -1)
+        || (addr.ss_family != AF_UNIX))
+        return LS_OK;
+
+    LsapiShm *pShm = new LsapiShm();
+    int fd = pShm->create(LsapiConfig::getShmRingSize());
+    if (fd == -1)
+    {
+        LS_NOTICE(this, "[LSAPI] failed to create shared memory: %s.",
+                  strerror(errno));
+        delete pShm;
+        return LS_OK;
+    }
+    pShm->buildOffer(&offer);
+    int ret = FDPass::writeFd(getfd(), &offer, sizeof(offer), fd);
+    ::close(fd);
+    if (ret != (int)sizeof(offer))
+    {
+        delete pShm;
+        if (ret > 0)
+        {
+            errno = EIO;
+            return LS_FAIL;
+        }
+        return LS_OK;
+    }
+    m_pShm = pShm;
+    m_iShmState = LSAPI_SHM_ACTIVE;
+    LS_DBG_L(this, "[LSAPI] switched to shared memory transport.");
+    return LS_OK;
+}
+
+
+void LsapiConn::releaseShm()
+{
+    if (m_pShm)
+    {
+        delete m_pShm;
+        m_pShm = NULL;
+    }
+    m_iShmState = LSAPI_SHM_NONE;
+    m_iShmFlags = 0;
+}
+
+
+void LsapiConn::ringDoorbell()
+{
+    ExtConn::write("", 1);
+}
+
+
+/**
+ * Discards the doorbells, they only tell to look at the rings. Returns
+ * LS_FAIL once the backend has closed the socket.
+ */
+int LsapiConn::drainDoorbell()
+{
+    char achBuf[256];
+    int ret;
+    while ((ret = ExtConn::read(achBuf, sizeof(achBuf)))
+           == (int)sizeof(achBuf))
+        ;
+    //a corrupted ring resumes writing as well, the write fails then
+    if ((m_iShmFlags & LSAPI_SHM_WAIT_SPACE)
+        && (m_pShm->getReqRing().getSpace() != 0))
+    {
+        m_iShmFlags &= ~LSAPI_SHM_WAIT_SPACE;
+        ExtConn::continueWrite();
+    }
+    return (ret == -1) ? LS_FAIL : LS_OK;
+}
+
+
+/**
+ * The backend moved a ring position out of range, which is a protocol
+ * error; the connection is closed rather than trusting the ring.
+ */
+int LsapiConn::shmRingError()
+{
+    LS_WARN(this, "LSAPI shared memory ring is corrupted, close "
+            "connection.");
+    errno = EIO;
+    return LS_FAIL;
+}
+
+
+/**
+ * Data left in the response ring raises no event on the socket. As the
+ * socket is always writable, a write event is used to come back to it
+ * from the event loop.
+ */
+void LsapiConn::kickShmRead()
+{
+    m_iShmFlags |= LSAPI_SHM_KICK;
+    ExtConn::continueWrite();
+}
+
+
+int LsapiConn::read(char *pBuf, int size)
+{
+    if (!m_pShm)
+        return ExtConn::read(pBuf, size);
+    LsapiShmRing &ring = m_pShm->getRespRing();
+    int ret = ring.read(pBuf, size);
+    if (ret == LS_FAIL)
+        return shmRingError();
+    if (ring.needWakeProducer())
+        ringDoorbell();
+    return ret;
+}
+
+
+int LsapiConn::write(const char *pBuf, int len)
+{
+    if (!m_pShm)
+        return ExtConn::write(pBuf, len);
+    LsapiShmRing &ring = m_pShm->getReqRing();
+    //a packet header is never split
+    int space = ring.getSpace();
+    if (space == LS_FAIL)
+        return shmRingError();
+    if (space < len)
+        return 0;
+    int ret = ring.write(pBuf, len);
+    if (ret == LS_FAIL)
+        return shmRingError();
+    if (ring.needWakeConsumer())
+        ringDoorbell();
+    return ret;
+}
+
+
+int LsapiConn::writev(IOVec &vector)
+{
+    if (!m_pShm)
+        return ExtConn::writev(vector);
+    LsapiShmRing &ring = m_pShm->getReqRing();
+    int ret = ring.writev(vector.get(), vector.len());
+    if (ret == LS_FAIL)
+        return shmRingError();
+    if (ring.needWakeConsumer())
+        ringDoorbell();
+    if (ret < vector.bytes())
+    {
+        m_iShmFlags |= LSAPI_SHM_WAIT_SPACE;
+        suspendWrite();
+    }
+    return ret;
+}
+
+
+void LsapiConn::continueRead()
+{
+    ExtConn::continueRead();
+    if (m_pShm && !(m_iShmFlags & LSAPI_SHM_IN_READ)
+        && (m_pShm->getRespRing().getDataLen() != 0))
+        kickShmRead();
+}
+
+
+void LsapiConn::continueWrite()
+{
+    //wait for the backend to make room in the ring
+    if (m_iShmFlags & LSAPI_SHM_WAIT_SPACE)
+        return;
+    ExtConn::continueWrite();
+}
+
+
+void LsapiConn::suspendWrite()
+{
+    if (m_iShmFlags & LSAPI_SHM_KICK)
+        return;
+    ExtConn::suspendWrite();
+}
+
+
 bool LsapiConn::wantRead()
 {
     return false;
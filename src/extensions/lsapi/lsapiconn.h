@@ -33,6 +33,18 @@
 #define LSAPI_CONN_READ_RESP_BODY   5
 #define LSAPI_CONN_END_RESP         6
 
+//m_iShmState
+#define LSAPI_SHM_NONE              0
+#define LSAPI_SHM_AVAILABLE         1
+#define LSAPI_SHM_ACTIVE            2
+
+//m_iShmFlags
+#define LSAPI_SHM_WAIT_SPACE        1
+#define LSAPI_SHM_KICK              2
+#define LSAPI_SHM_IN_READ           4
+
+class LsapiShm;
+
 class LsapiConn: public ExtConn
     , public HttpExtProcessor
 {
@@ -54,6 +66,9 @@ class LsapiConn: public ExtConn
     struct lsapi_packet_header  m_respHeader;
     struct lsapi_resp_info      m_respInfo;
     char                        m_respBuf[4096];
+    LsapiShm                   *m_pShm;
+    short                       m_iShmState;
+    short                       m_iShmFlags;
 
 
     int     processPacketHeader(char *pBuf, int len);
@@ -68,6 +83,19 @@ class LsapiConn: public ExtConn
     int     readStderrStream();
     int     readNotifyStream();
 
+    void    shmSupported();
+    int     startShm();
+    void    releaseShm();
+    void    ringDoorbell();
+    int     drainDoorbell();
+    int     shmRingError();
+    void    kickShmRead();
+    int     read(char *pBuf, int size);
+    int     write(const char *pBuf, int len);
+    int     writev(IOVec &vector);
+    int     writev(IOVec &vector, int total)
+    {   return writev(vector);  }
+
 protected:
     virtual int doRead();
     virtual int doWrite();
@@ -92,6 +120,10 @@ public:
     virtual bool wantRead();
     virtual bool wantWrite();
 
+    virtual void continueRead();
+    virtual void continueWrite();
+    virtual void suspendWrite();
+
     virtual void abort();
     virtual int  begin();
     virtual int  beginReqBody();
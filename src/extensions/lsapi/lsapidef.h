@@ -79,6 +79,8 @@ extern "C" {
 #define LSAPI_REQ_RECEIVED          7
 #define LSAPI_CONN_CLOSE            8
 #define LSAPI_INTERNAL_ERROR        9
+#define LSAPI_SHM_SUPPORTED         10
+#define LSAPI_SHM_OFFER             11
 
 
 #define LSAPI_MAX_HEADER_LEN        65535
@@ -150,6 +152,35 @@ extern "C" {
         struct  lsapi_resp_info      m_respInfo;
     };
 
+// Shared memory transport
+//
+// A backend started with LSAPI_SHM_TRANSPORT=1 in its environment may send
+// a header only LSAPI_SHM_SUPPORTED packet on a Unix domain socket
+// connection. Before a later request on that connection the server sends
+// LSAPI_SHM_OFFER with a memory file descriptor attached (SCM_RIGHTS).
+// The memory holds two struct lsapi_shm_ring_ctrl, request ring first,
+// followed by the data of the request ring and of the response ring.
+// From then on both sides exchange the usual packet stream through the
+// rings; the socket only carries single byte doorbells, sent when the
+// other side has set m_waitData or m_waitSpace.
+
+    struct lsapi_shm_ring_ctrl
+    {
+        volatile uint32_t m_head;       //bytes ever written, producer only
+        volatile uint32_t m_waitData;   //consumer found the ring empty
+        char    m_pad0[56];
+        volatile uint32_t m_tail;       //bytes ever read, consumer only
+        volatile uint32_t m_waitSpace;  //producer found the ring full
+        char    m_pad1[56];
+    };
+
+    struct lsapi_shm_offer
+    {
+        struct lsapi_packet_header m_pktHeader;
+        int32_t m_ringSize;     //data bytes of each ring, a power of 2
+        int32_t m_dataOff;      //offset of the request ring data
+    };
+
 #if defined (c_plusplus) || defined (__cplusplus)
 }
 #endif
@@ -0,0 +1,315 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "lsapishm.h"
+#include "lsapireq.h"
+
+#include <lsr/ls_atomic.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+
+#define LSAPI_SHM_DATA_OFF  (2 * sizeof(struct lsapi_shm_ring_ctrl))
+
+
+void LsapiShmRing::publishHead(uint32_t head)
+{
+    ls_barrier();
+    m_pCtrl->m_head = head;
+    ls_barrier();
+}
+
+
+void LsapiShmRing::publishTail(uint32_t tail)
+{
+    ls_barrier();
+    m_pCtrl->m_tail = tail;
+    ls_barrier();
+}
+
+
+/**
+ * Returns the bytes in the ring, computed from the local position and the
+ * peer's published one.
+ */
+int LsapiShmRing::getDataLen()
+{
+    if (m_iCorrupted)
+        return LS_FAIL;
+    uint32_t len = m_iProducer ? m_iPos - m_pCtrl->m_tail
+                               : m_pCtrl->m_head - m_iPos;
+    if (len > (uint32_t)m_iSize)
+    {
+        m_iCorrupted = 1;
+        return LS_FAIL;
+    }
+    return (int)len;
+}
+
+
+int LsapiShmRing::getSpace()
+{
+    int len = getDataLen();
+    if (len == LS_FAIL)
+        return LS_FAIL;
+    return m_iSize - len;
+}
+
+
+int LsapiShmRing::write(const char *pBuf, int len)
+{
+    struct iovec iov;
+    iov.iov_base = (void *)pBuf;
+    iov.iov_len = len;
+    return writev(&iov, 1);
+}
+
+
+/**
+ * Copies as much as fits. Returns less than requested only after the
+ * copied part has been published and m_waitSpace has been set and checked
+ * against the consumer's progress. Returns LS_FAIL if the ring is
+ * corrupted.
+ */
+int LsapiShmRing::writev(const struct iovec *iov, int count)
+{
+    int total = 0;
+    const struct iovec *pEnd = iov + count;
+    for (; iov < pEnd; ++iov)
+    {
+        const char *p = (const char *)iov->iov_base;
+        int len = iov->iov_len;
+        while (len > 0)
+        {
+            int space = getSpace();
+            if (space == LS_FAIL)
+                return LS_FAIL;
+            if (space == 0)
+            {
+                publishHead(m_iPos);
+                if (m_pCtrl->m_waitSpace)
+                    return total;
+                m_pCtrl->m_waitSpace = 1;
+                ls_barrier();
+                continue;
+            }
+            ls_barrier();
+            int n = (len < space) ? len : space;
+            int off = m_iPos & (m_iSize - 1);
+            int first = m_iSize - off;
+            if (first >= n)
+                memcpy(m_pData + off, p, n);
+            else
+            {
+                memcpy(m_pData + off, p, first);
+                memcpy(m_pData, p + first, n - first);
+            }
+            m_iPos += n;
+            p += n;
+            len -= n;
+            total += n;
+        }
+    }
+    publishHead(m_iPos);
+    return total;
+}
+
+
+/**
+ * Returns 1 if the consumer is waiting for data and has to be notified;
+ * the flag is cleared so that it is notified once.
+ */
+int LsapiShmRing::needWakeConsumer()
+{
+    if (!m_pCtrl->m_waitData || m_iPos == m_pCtrl->m_tail)
+        return 0;
+    m_pCtrl->m_waitData = 0;
+    ls_barrier();
+    return 1;
+}
+
+
+int LsapiShmRing::read(char *pBuf, int len)
+{
+    int total = 0;
+    while (total < len)
+    {
+        int avail = getDataLen();
+        if (avail == LS_FAIL)
+            return LS_FAIL;
+        if (avail == 0)
+        {
+            if (m_pCtrl->m_waitData)
+                break;
+            publishTail(m_iPos);
+            m_pCtrl->m_waitData = 1;
+            ls_barrier();
+            continue;
+        }
+        ls_barrier();
+        int n = (len - total < avail) ? len - total : avail;
+        int off = m_iPos & (m_iSize - 1);
+        int first = m_iSize - off;
+        if (first >= n)
+            memcpy(pBuf + total, m_pData + off, n);
+        else
+        {
+            memcpy(pBuf + total, m_pData + off, first);
+            memcpy(pBuf + total + first, m_pData, n - first);
+        }
+        m_iPos += n;
+        total += n;
+    }
+    publishTail(m_iPos);
+    return total;
+}
+
+
+int LsapiShmRing::needWakeProducer()
+{
+    if (!m_pCtrl->m_waitSpace || getSpace() <= 0)
+        return 0;
+    m_pCtrl->m_waitSpace = 0;
+    ls_barrier();
+    return 1;
+}
+
+
+LsapiShm::LsapiShm()
+    : m_pMap(NULL)
+    , m_iMapSize(0)
+    , m_iRingSize(0)
+{
+}
+
+
+LsapiShm::~LsapiShm()
+{
+    release();
+}
+
+
+void LsapiShm::release()
+{
+    if (m_pMap)
+    {
+        munmap(m_pMap, m_iMapSize);
+        m_pMap = NULL;
+    }
+    m_iMapSize = 0;
+    m_iRingSize = 0;
+}
+
+
+static int createMemFd()
+{
+    int fd = -1;
+#if defined(__linux__) && defined(SYS_memfd_create)
+    fd = syscall(SYS_memfd_create, "lsapi-shm", 1 /*MFD_CLOEXEC*/);
+    if (fd != -1)
+        return fd;
+#endif
+    char achName[] = "/dev/shm/lsapi-shm.XXXXXX";
+    fd = mkstemp(achName);
+    if (fd != -1)
+    {
+        unlink(achName);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    return fd;
+}
+
+
+int LsapiShm::map(int fd, int ringSize, int isServer)
+{
+    size_t size = LSAPI_SHM_DATA_OFF + 2 * (size_t)ringSize;
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        return LS_FAIL;
+    m_pMap = (char *)p;
+    m_iMapSize = size;
+    m_iRingSize = ringSize;
+    struct lsapi_shm_ring_ctrl *pCtrl = (struct lsapi_shm_ring_ctrl *)p;
+    m_reqRing.init(pCtrl, m_pMap + LSAPI_SHM_DATA_OFF, ringSize, isServer);
+    m_respRing.init(pCtrl + 1, m_pMap + LSAPI_SHM_DATA_OFF + ringSize,
+                    ringSize, !isServer);
+    return LS_OK;
+}
+
+
+/**
+ * Creates the memory of a connection, the size is rounded up to a power
+ * of 2. The caller passes the returned descriptor on and closes it.
+ */
+int LsapiShm::create(int ringSize)
+{
+    int size = LSAPI_SHM_MIN_RING_SIZE;
+    while (size < ringSize && size < (1 << 30))
+        size <<= 1;
+    release();
+    int fd = createMemFd();
+    if (fd == -1)
+        return LS_FAIL;
+    if ((ftruncate(fd, LSAPI_SHM_DATA_OFF + 2 * (off_t)size) == -1)
+        || (map(fd, size, 1) == LS_FAIL))
+    {
+        close(fd);
+        return LS_FAIL;
+    }
+    memset(m_pMap, 0, LSAPI_SHM_DATA_OFF);
+    //both sides start out waiting, the first packet rings the doorbell
+    ((struct lsapi_shm_ring_ctrl *)m_pMap)[0].m_waitData = 1;
+    ((struct lsapi_shm_ring_ctrl *)m_pMap)[1].m_waitData = 1;
+    return fd;
+}
+
+
+int LsapiShm::attach(int fd, const struct lsapi_shm_offer *pOffer)
+{
+    struct stat st;
+    int size = pOffer->m_ringSize;
+    release();
+    if ((size < LSAPI_SHM_MIN_RING_SIZE) || (size & (size - 1))
+        || (pOffer->m_dataOff != (int)LSAPI_SHM_DATA_OFF)
+        || (fstat(fd, &st) == -1)
+        || (st.st_size < (off_t)(LSAPI_SHM_DATA_OFF + 2 * (off_t)size)))
+    {
+        errno = EINVAL;
+        return LS_FAIL;
+    }
+    return map(fd, size, 0);
+}
+
+
+void LsapiShm::buildOffer(struct lsapi_shm_offer *pOffer) const
+{
+    LsapiReq::buildPacketHeader(&pOffer->m_pktHeader, LSAPI_SHM_OFFER,
+                                sizeof(struct lsapi_shm_offer));
+    pOffer->m_ringSize = m_iRingSize;
+    pOffer->m_dataOff = LSAPI_SHM_DATA_OFF;
+}
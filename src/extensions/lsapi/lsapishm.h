@@ -0,0 +1,121 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef LSAPISHM_H
+#define LSAPISHM_H
+
+#include "lsapidef.h"
+
+#include <lsdef.h>
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+#define LSAPI_SHM_MIN_RING_SIZE     (64 * 1024)
+
+
+/**
+ * One direction of the shared memory transport, a single producer, single
+ * consumer byte ring. A short write or read leaves the matching wait flag
+ * set, so the other side rings the doorbell once it has made progress.
+ *
+ * Each side keeps its own position locally and only publishes it; the
+ * peer's position is checked before use. A ring whose peer position is
+ * more than the ring size away is corrupted, all further calls fail.
+ */
+class LsapiShmRing
+{
+public:
+    LsapiShmRing()
+        : m_pCtrl(NULL)
+        , m_pData(NULL)
+        , m_iSize(0)
+        , m_iPos(0)
+        , m_iProducer(0)
+        , m_iCorrupted(0)
+    {}
+
+    void init(struct lsapi_shm_ring_ctrl *pCtrl, char *pData, int size,
+              int isProducer)
+    {
+        m_pCtrl = pCtrl;
+        m_pData = pData;
+        m_iSize = size;
+        m_iPos = 0;
+        m_iProducer = isProducer;
+        m_iCorrupted = 0;
+    }
+
+    //LS_FAIL if the ring is corrupted
+    int getDataLen();
+    int getSpace();
+    bool isCorrupted() const    {   return m_iCorrupted;    }
+
+    //producer side
+    int write(const char *pBuf, int len);
+    int writev(const struct iovec *iov, int count);
+    int needWakeConsumer();
+
+    //consumer side
+    int read(char *pBuf, int len);
+    int needWakeProducer();
+
+private:
+    void publishHead(uint32_t head);
+    void publishTail(uint32_t tail);
+
+    struct lsapi_shm_ring_ctrl *m_pCtrl;
+    char                       *m_pData;
+    int                         m_iSize;
+    uint32_t                    m_iPos;     //head or tail, own side
+    char                        m_iProducer;
+    char                        m_iCorrupted;
+
+    LS_NO_COPY_ASSIGN(LsapiShmRing);
+};
+
+
+class LsapiShm
+{
+public:
+    LsapiShm();
+    ~LsapiShm();
+
+    //server side, returns the descriptor to pass to the backend
+    int create(int ringSize);
+    //backend side
+    int attach(int fd, const struct lsapi_shm_offer *pOffer);
+    void release();
+
+    void buildOffer(struct lsapi_shm_offer *pOffer) const;
+
+    LsapiShmRing &getReqRing()      {   return m_reqRing;   }
+    LsapiShmRing &getRespRing()     {   return m_respRing;  }
+
+private:
+    int  map(int fd, int ringSize, int isServer);
+
+    char           *m_pMap;
+    size_t          m_iMapSize;
+    int             m_iRingSize;
+    LsapiShmRing    m_reqRing;
+    LsapiShmRing    m_respRing;
+
+    LS_NO_COPY_ASSIGN(LsapiShm);
+};
+
+#endif // LSAPISHM_H
@@ -17,6 +17,7 @@
 *****************************************************************************/
 #include "accesslog.h"
 
+#include <http/accesslogwriter.h>
 #include <http/httpreq.h>
 #include <http/httpresp.h>
 #include <http/httpsession.h>
@@ -331,7 +332,7 @@ int AccessLog::appendStrNoQuote(char *pBuf, int len, int escape, const char *pSr
                     || (pLogger->m_buf.available() <= srcLen + 100)))
     {
         pLogger->flush();
-        pLogger->m_pAppender->append(pSrc, srcLen);
+        pLogger->writeDirect(pSrc, srcLen);
         return LS_FAIL;
     }
     else
@@ -502,6 +503,7 @@ AccessLog::AccessLog()
     : m_pAppender(NULL)
     , m_pManager(NULL)
     , m_pCustomFormat(NULL)
+    , m_pWriterTarget(NULL)
     , m_iAsync(1)
     , m_iPipedLog(0)
     , m_iAccessLogHeader(LOG_REFERER | LOG_USERAGENT)
@@ -514,6 +516,7 @@ AccessLog::AccessLog(const char *pPath)
     : m_pAppender(NULL)
     , m_pManager(NULL)
     , m_pCustomFormat(NULL)
+    , m_pWriterTarget(NULL)
     , m_iAsync(1)
     , m_iPipedLog(0)
     , m_iAccessLogHeader(LOG_REFERER | LOG_USERAGENT)
@@ -582,6 +585,7 @@ int AccessLog::init(const char *pName, int pipe)
                 return 0;
         }
         m_pAppender = LOG4CXX_NS::Appender::getAppender(pName);
+        m_pWriterTarget = NULL;
         if (!m_pAppender)
             return LS_FAIL;
         ret = m_pAppender->open();
@@ -664,7 +668,7 @@ void AccessLog::log(HttpSession *pSession)
     if ((n > 4096) || (m_buf.available() < 100 + n))
     {
         flush();
-        m_pAppender->append(pOrgReqLine, n);
+        writeDirect(pOrgReqLine, n);
     }
     else
         m_buf.append_unsafe(pOrgReqLine, n);
@@ -711,7 +715,7 @@ int AccessLog::appendStr(const char *pStr, int len)
         if ((len > 4096) || (m_buf.available() <= len + 2))
         {
             flush();
-            m_pAppender->append(pStr, len);
+            writeDirect(pStr, len);
         }
         else
             m_buf.append_unsafe(pStr, len);
@@ -723,12 +727,40 @@ int AccessLog::appendStr(const char *pStr, int len)
 }
 
 
+AlwTarget *AccessLog::getWriterTarget()
+{
+    if (m_iPipedLog || !AccessLogWriter::getInstance().isRunning())
+        return NULL;
+    if (!m_pWriterTarget)
+        m_pWriterTarget = AccessLogWriter::getInstance().getTarget(
+                              m_pAppender->getName(), m_pAppender->getFlock());
+    return m_pWriterTarget;
+}
+
+
+void AccessLog::writeDirect(const char *pBuf, int len)
+{
+    AlwTarget *pTarget = getWriterTarget();
+    if (pTarget)
+        AccessLogWriter::getInstance().submit(pTarget, pBuf, len);
+    else
+        m_pAppender->append(pBuf, len);
+}
+
+
 void AccessLog::flush()
 {
     if (m_buf.size())
     {
-        m_pAppender->append(m_buf.begin(), m_buf.size());
-        m_pAppender->flush();
+        AlwTarget *pTarget = getWriterTarget();
+        if (pTarget)
+            AccessLogWriter::getInstance().submit(pTarget, m_buf.begin(),
+                                                  m_buf.size());
+        else
+        {
+            m_pAppender->append(m_buf.begin(), m_buf.size());
+            m_pAppender->flush();
+        }
         m_buf.clear();
     }
 }
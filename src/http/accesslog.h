@@ -41,11 +41,13 @@ END_LOG4CXX_NS
 
 class CustomFormat;
 class HttpSession;
+struct AlwTarget;
 class AccessLog
 {
     LOG4CXX_NS::Appender         *m_pAppender;
     LOG4CXX_NS::AppenderManager *m_pManager;
     CustomFormat                 *m_pCustomFormat;
+    AlwTarget                    *m_pWriterTarget;
 
     short   m_iAsync;
     short   m_iPipedLog;
@@ -53,6 +55,8 @@ class AccessLog
     AutoBuf m_buf;
 
     int appendStr(const char *pStr, int len);
+    AlwTarget *getWriterTarget();
+    void writeDirect(const char *pBuf, int len);
     static int appendStrNoQuote(char *pBuf, int len, int escape, const char *pSrc,
                                 int srcLen, AccessLog *pLogger);
     void customLog(HttpSession *pSession, CustomFormat *pLogFmt);
@@ -81,7 +85,8 @@ public:
     short isPipedLog()  const               {   return m_iPipedLog;        }
 
     LOG4CXX_NS::Appender *getAppender() const      {   return m_pAppender; }
-    void setAppender(LOG4CXX_NS::Appender *p)    {   m_pAppender = p;    }
+    void setAppender(LOG4CXX_NS::Appender *p)
+    {   m_pAppender = p;    m_pWriterTarget = NULL;     }
 
     char getCompress() const;
     const char *getLogPath() const;
@@ -0,0 +1,415 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "accesslogwriter.h"
+
+#include <log4cxx/logger.h>
+#include <lsr/ls_atomic.h>
+#include <lsr/ls_fileio.h>
+#include <lsr/ls_lfqueue.h>
+#include <lsr/ls_lfstack.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+LS_SINGLETON(AccessLogWriter);
+
+int AccessLogWriter::s_iMode = AccessLogWriter::MODE_OFF;
+int AccessLogWriter::s_iMaxChunks = ALW_DEFAULT_MAX_CHUNKS;
+
+
+AccessLogWriter::AccessLogWriter()
+    : m_pQueue(ls_lfqueue_new())
+    , m_pFree(ls_lfstack_new())
+    , m_pTargets(NULL)
+    , m_iAllocated(0)
+    , m_iRunning(0)
+    , m_iStalled(0)
+    , m_iDropped(0)
+    , m_iDroppedReported(0)
+    , m_iWriteErrors(0)
+{
+    m_stopNode.next = NULL;
+}
+
+
+AccessLogWriter::~AccessLogWriter()
+{
+    ls_lfnodei_t *pNode;
+    stop();
+    while ((pNode = ls_lfstack_pop(m_pFree)) != NULL)
+        delete (Chunk *)pNode;
+    ls_lfstack_delete(m_pFree);
+    ls_lfqueue_delete(m_pQueue);
+    while (m_pTargets)
+    {
+        AlwTarget *pNext = m_pTargets->m_pNext;
+        if (m_pTargets->m_fd != -1)
+            ls_fio_close(m_pTargets->m_fd);
+        free(m_pTargets->m_pPath);
+        delete m_pTargets;
+        m_pTargets = pNext;
+    }
+}
+
+
+int AccessLogWriter::start()
+{
+    if ((s_iMode == MODE_OFF) || m_iRunning)
+        return LS_OK;
+    if (!m_pQueue || !m_pFree)
+        return LS_FAIL;
+    //signals are for the event loop
+    sigfillset(&m_sigs);
+    blockSigs(&m_sigs);
+    if (Thread::start(NULL) != 0)
+    {
+        LS_ERROR("[AccessLogWriter] Failed to start writer thread, "
+                 "access logs are written from the event loop.");
+        return LS_FAIL;
+    }
+    m_iRunning = 1;
+    LS_DBG_L("[AccessLogWriter] Writer thread started, %s when %d chunks "
+             "are in flight.", (s_iMode == MODE_BLOCK_THEN_DROP) ? "block then drop" : "drop",
+             s_iMaxChunks);
+    return LS_OK;
+}
+
+
+void AccessLogWriter::stop()
+{
+    if (!m_iRunning)
+        return;
+    m_iRunning = 0;
+    //everything queued before the marker is written before the thread exits
+    ls_lfqueue_put(m_pQueue, &m_stopNode);
+    join(NULL);
+    onTimer();
+}
+
+
+AlwTarget *AccessLogWriter::getTarget(const char *pPath, int flock)
+{
+    AlwTarget *pTarget;
+    for (pTarget = m_pTargets; pTarget; pTarget = pTarget->m_pNext)
+    {
+        if (strcmp(pTarget->m_pPath, pPath) == 0)
+            return pTarget;
+    }
+    pTarget = new AlwTarget;
+    pTarget->m_pPath = strdup(pPath);
+    pTarget->m_fd = -1;
+    pTarget->m_iFlock = flock;
+    pTarget->m_ino = 0;
+    pTarget->m_pNext = m_pTargets;
+    //the writer thread walks this list when checking for rotated files
+    (void)ls_atomic_setptr(&m_pTargets, pTarget);
+    return pTarget;
+}
+
+
+AccessLogWriter::Chunk *AccessLogWriter::getChunk()
+{
+    Chunk *pChunk = (Chunk *)ls_lfstack_pop(m_pFree);
+    if (pChunk)
+    {
+        m_iStalled = 0;
+        return pChunk;
+    }
+    if (m_iAllocated < s_iMaxChunks)
+    {
+        ++m_iAllocated;
+        pChunk = new Chunk;
+        pChunk->m_node.next = NULL;
+        return pChunk;
+    }
+    if ((s_iMode != MODE_BLOCK_THEN_DROP) || m_iStalled)
+        return NULL;
+    for (int waited = 0; waited < ALW_BLOCK_WAIT_USEC; waited += 100)
+    {
+        usleep(100);
+        if ((pChunk = (Chunk *)ls_lfstack_pop(m_pFree)) != NULL)
+            return pChunk;
+    }
+    LS_WARN("[AccessLogWriter] Log writer has not freed a chunk in %d ms, "
+            "dropping access log entries until it catches up.",
+            ALW_BLOCK_WAIT_USEC / 1000);
+    m_iStalled = 1;
+    return NULL;
+}
+
+
+void AccessLogWriter::recycle(Chunk *pChunk)
+{
+    ls_lfstack_push(m_pFree, &pChunk->m_node);
+}
+
+
+/**
+ * Queues whole lines, len may span several chunks when it is a single
+ * line. Every chunk is reserved first, either all of them are queued or
+ * none.
+ */
+int AccessLogWriter::queueLines(AlwTarget *pTarget, const char *pBuf,
+                                int len)
+{
+    Chunk *pHead = NULL;
+    Chunk *pChunk;
+    int n;
+    for (n = len; n > 0; n -= ALW_CHUNK_SIZE)
+    {
+        if ((pChunk = getChunk()) == NULL)
+        {
+            while ((pChunk = pHead) != NULL)
+            {
+                pHead = (Chunk *)pChunk->m_node.next;
+                recycle(pChunk);
+            }
+            return LS_FAIL;
+        }
+        pChunk->m_node.next = pHead ? &pHead->m_node : NULL;
+        pHead = pChunk;
+    }
+    while ((pChunk = pHead) != NULL)
+    {
+        pHead = (Chunk *)pChunk->m_node.next;
+        n = (len > ALW_CHUNK_SIZE) ? ALW_CHUNK_SIZE : len;
+        memcpy(pChunk->m_achBuf, pBuf, n);
+        pChunk->m_iLen = n;
+        pChunk->m_pTarget = pTarget;
+        pChunk->m_node.next = NULL;
+        ls_lfqueue_put(m_pQueue, &pChunk->m_node);
+        pBuf += n;
+        len -= n;
+    }
+    return LS_OK;
+}
+
+
+int AccessLogWriter::submit(AlwTarget *pTarget, const char *pBuf, int len)
+{
+    const char *pEnd = pBuf + len;
+    const char *pCut;
+    while (pBuf < pEnd)
+    {
+        //cut after the last line that fits, or after a long line
+        pCut = pEnd;
+        if (pEnd - pBuf > ALW_CHUNK_SIZE)
+        {
+            pCut = pBuf + ALW_CHUNK_SIZE;
+            while ((pCut > pBuf) && (*(pCut - 1) != '\n'))
+                --pCut;
+            if (pCut == pBuf)
+            {
+                pCut = (const char *)memchr(pBuf + ALW_CHUNK_SIZE, '\n',
+                                            pEnd - pBuf - ALW_CHUNK_SIZE);
+                pCut = pCut ? pCut + 1 : pEnd;
+            }
+        }
+        if (queueLines(pTarget, pBuf, pCut - pBuf) != LS_OK)
+        {
+            while ((pBuf = (const char *)memchr(pBuf, '\n', pEnd - pBuf))
+                   != NULL)
+            {
+                ++m_iDropped;
+                ++pBuf;
+            }
+            return LS_FAIL;
+        }
+        pBuf = pCut;
+    }
+    return LS_OK;
+}
+
+
+void AccessLogWriter::onTimer()
+{
+    long dropped = m_iDropped - m_iDroppedReported;
+    if (dropped > 0)
+    {
+        LS_WARN("[AccessLogWriter] Log writer fell behind, dropped %ld "
+                "access log entries, %ld in total.", dropped, m_iDropped);
+        m_iDroppedReported = m_iDropped;
+    }
+}
+
+
+ls_lfnodei_t *AccessLogWriter::waitNode()
+{
+#if defined(linux) || defined(__linux) || defined(__linux__) || defined(__gnu_linux__)
+    struct timespec timeout;
+    timeout.tv_sec = 1;
+    timeout.tv_nsec = 0;
+    return ls_lfqueue_timedget(m_pQueue, &timeout);
+#else
+    ls_lfnodei_t *pNode = ls_lfqueue_get(m_pQueue);
+    if (!pNode)
+        usleep(10000);
+    return pNode;
+#endif
+}
+
+
+void AccessLogWriter::writeTarget(AlwTarget *pTarget, struct iovec *pIov,
+                                  int count)
+{
+    struct flock lock;
+    int ret;
+    if (pTarget->m_fd == -1)
+    {
+        struct stat st;
+        pTarget->m_fd = ls_fio_open(pTarget->m_pPath,
+                                    O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (pTarget->m_fd == -1)
+        {
+            ls_atomic_add(&m_iWriteErrors, 1);
+            return;
+        }
+        fcntl(pTarget->m_fd, F_SETFD, FD_CLOEXEC);
+        if (fstat(pTarget->m_fd, &st) != -1)
+            pTarget->m_ino = st.st_ino;
+    }
+    if (pTarget->m_iFlock)
+    {
+        lock.l_type = F_WRLCK;
+        lock.l_start = 0;
+        lock.l_whence = SEEK_SET;
+        lock.l_len = 1;
+        fcntl(pTarget->m_fd, F_SETLK, &lock);
+    }
+    while (count > 0)
+    {
+        ret = ::writev(pTarget->m_fd, pIov, count);
+        if (ret == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            ls_atomic_add(&m_iWriteErrors, 1);
+            break;
+        }
+        while ((count > 0) && ((size_t)ret >= pIov->iov_len))
+        {
+            ret -= pIov->iov_len;
+            ++pIov;
+            --count;
+        }
+        if (count > 0)
+        {
+            pIov->iov_base = (char *)pIov->iov_base + ret;
+            pIov->iov_len -= ret;
+        }
+    }
+    if (pTarget->m_iFlock)
+    {
+        lock.l_type = F_UNLCK;
+        fcntl(pTarget->m_fd, F_SETLK, &lock);
+    }
+}
+
+
+void AccessLogWriter::writeBatch(Chunk **pBatch, int count)
+{
+    struct iovec iov[ALW_MAX_BATCH];
+    Chunk *pSame[ALW_MAX_BATCH];
+    AlwTarget *pTarget;
+    int i, j, n;
+    for (i = 0; i < count; ++i)
+    {
+        if (!pBatch[i])
+            continue;
+        //gather every later chunk of the same file, order within a file
+        //is kept while different files may be interleaved in the queue
+        pTarget = pBatch[i]->m_pTarget;
+        n = 0;
+        for (j = i; j < count; ++j)
+        {
+            if (pBatch[j] && pBatch[j]->m_pTarget == pTarget)
+            {
+                iov[n].iov_base = pBatch[j]->m_achBuf;
+                iov[n].iov_len = pBatch[j]->m_iLen;
+                pSame[n++] = pBatch[j];
+                pBatch[j] = NULL;
+            }
+        }
+        writeTarget(pTarget, iov, n);
+        for (j = 0; j < n; ++j)
+            recycle(pSame[j]);
+    }
+}
+
+
+void AccessLogWriter::checkTargets()
+{
+    struct stat st;
+    AlwTarget *pTarget;
+    ls_atomic_load(pTarget, &m_pTargets);
+    for (; pTarget; pTarget = pTarget->m_pNext)
+    {
+        if (pTarget->m_fd == -1)
+            continue;
+        //the main process renames the file on rotation
+        if ((ls_fio_stat(pTarget->m_pPath, &st) != -1)
+            && (st.st_ino != pTarget->m_ino))
+        {
+            ls_fio_close(pTarget->m_fd);
+            pTarget->m_fd = -1;
+        }
+    }
+}
+
+
+void *AccessLogWriter::thr_main(void *arg)
+{
+    Chunk *pBatch[ALW_MAX_BATCH];
+    ls_lfnodei_t *pNode;
+    time_t lastCheck = time(NULL);
+    time_t now;
+    int count;
+    int stop = 0;
+    while (!stop)
+    {
+        count = 0;
+        pNode = waitNode();
+        while (pNode)
+        {
+            if (pNode == &m_stopNode)
+            {
+                stop = 1;
+                break;
+            }
+            pBatch[count++] = (Chunk *)pNode;
+            if (count == ALW_MAX_BATCH)
+                break;
+            pNode = ls_lfqueue_get(m_pQueue);
+        }
+        if (count > 0)
+            writeBatch(pBatch, count);
+        now = time(NULL);
+        if (now != lastCheck)
+        {
+            checkTargets();
+            lastCheck = now;
+        }
+    }
+    return NULL;
+}
+
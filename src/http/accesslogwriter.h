@@ -0,0 +1,138 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef ACCESSLOGWRITER_H
+#define ACCESSLOGWRITER_H
+
+#include <lsdef.h>
+#include <lsr/ls_node.h>
+#include <thread/thread.h>
+#include <util/tsingleton.h>
+
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define ALW_CHUNK_SIZE          16384
+#define ALW_MAX_BATCH           64
+#define ALW_DEFAULT_MAX_CHUNKS  128
+#define ALW_BLOCK_WAIT_USEC     10000
+
+typedef struct ls_lfqueue_s ls_lfqueue_t;
+typedef struct ls_lfstack_s ls_lfstack_t;
+
+/**
+ * One log file as seen by the writer thread. Every AccessLog pointing at
+ * the same path shares the target, so their entries land in one writev().
+ * The fd belongs to the writer thread only.
+ */
+struct AlwTarget
+{
+    AlwTarget  *m_pNext;
+    char       *m_pPath;
+    int         m_fd;
+    int         m_iFlock;
+    ino_t       m_ino;
+};
+
+
+/**
+ * Writes access log entries from a dedicated thread so a slow disk never
+ * stalls the event loop. AccessLog::flush() copies its buffer into a chunk
+ * and puts it on a lock-free queue, the writer drains the queue and
+ * coalesces consecutive chunks of the same file into one writev().
+ *
+ * A chunk only holds whole lines, a line longer than a chunk gets all of
+ * its chunks reserved before any is queued, so a dropped entry never
+ * leaves a partial line in the file.
+ *
+ * Chunks come from a bounded free list. When all of them are in flight the
+ * producer either drops the entry and counts it, or waits for the writer,
+ * depending on the configured policy. The wait is bounded, the event loop
+ * must not hang on a stuck disk; once it expires, entries are dropped
+ * without waiting until the writer hands a chunk back.
+ */
+class AccessLogWriter : public Thread, public TSingleton<AccessLogWriter>
+{
+    friend class TSingleton<AccessLogWriter>;
+
+public:
+    enum
+    {
+        MODE_OFF,
+        MODE_DROP,
+        MODE_BLOCK_THEN_DROP
+    };
+
+    static void setMode(int mode)           {   s_iMode = mode;         }
+    static int  getMode()                   {   return s_iMode;         }
+    static void setMaxChunks(int n)         {   s_iMaxChunks = n;       }
+
+    /** Starts the writer thread, must be called after fork(). */
+    int start();
+    /** Writes out everything queued so far and joins the thread. */
+    void stop();
+    bool isRunning() const                  {   return m_iRunning;      }
+
+    AlwTarget *getTarget(const char *pPath, int flock);
+    int submit(AlwTarget *pTarget, const char *pBuf, int len);
+
+    long getDropped() const                 {   return m_iDropped;      }
+    long getWriteErrors() const             {   return m_iWriteErrors;  }
+    void onTimer();
+
+private:
+    struct Chunk
+    {
+        ls_lfnodei_t    m_node;
+        AlwTarget      *m_pTarget;
+        int             m_iLen;
+        char            m_achBuf[ALW_CHUNK_SIZE];
+    };
+
+    ls_lfqueue_t   *m_pQueue;
+    ls_lfstack_t   *m_pFree;
+    ls_lfnodei_t    m_stopNode;
+    sigset_t        m_sigs;
+    AlwTarget      *m_pTargets;
+    int             m_iAllocated;
+    int             m_iRunning;
+    int             m_iStalled;
+    long            m_iDropped;
+    long            m_iDroppedReported;
+    long            m_iWriteErrors;
+
+    static int      s_iMode;
+    static int      s_iMaxChunks;
+
+    AccessLogWriter();
+    ~AccessLogWriter();
+
+    Chunk *getChunk();
+    void recycle(Chunk *pChunk);
+    int queueLines(AlwTarget *pTarget, const char *pBuf, int len);
+    ls_lfnodei_t *waitNode();
+    void writeBatch(Chunk **pBatch, int count);
+    void writeTarget(AlwTarget *pTarget, struct iovec *pIov, int count);
+    void checkTargets();
+
+    virtual void *thr_main(void *arg);
+
+    LS_NO_COPY_ASSIGN(AccessLogWriter);
+};
+
+#endif //ACCESSLOGWRITER_H
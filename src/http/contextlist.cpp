@@ -19,12 +19,16 @@
 
 #include <lsdef.h>
 #include <http/httpcontext.h>
+#include <http/urimatch.h>
+#include <util/regexfilter.h>
 
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 
 ContextList::ContextList()
     : TPointerList< HttpContext >(4)
+    , m_pFilter(NULL)
 {
     m_sTags.prealloc(capacity());
     memset(m_sTags.buf(), 0, capacity());
@@ -48,6 +52,17 @@ void ContextList::release()
             delete(*iter);
     }
     clear();
+    releaseFilter();
+}
+
+
+void ContextList::releaseFilter()
+{
+    if (m_pFilter)
+    {
+        delete m_pFilter;
+        m_pFilter = NULL;
+    }
 }
 
 
@@ -66,6 +81,7 @@ int ContextList::add(HttpContext *pContext, int release)
     }
     push_back(pContext);
     m_sTags.buf()[n] = release;
+    releaseFilter();
     return 0;
 }
 
@@ -101,5 +117,38 @@ void ContextList::releaseUnused(long curTime, long timeout)
         else
             ++iter;
     }
+    releaseFilter();
+}
+
+
+/**
+ * Builds the filter that lets HttpContext::match() and matchFilesContext()
+ * skip regex contexts whose required literal is not in the subject. Must be
+ * called again after the list changes, which drops the filter.
+ */
+int ContextList::buildFilter()
+{
+    releaseFilter();
+    int count = size();
+    if (count < CONTEXT_FILTER_MIN_CONTEXTS)
+        return 0;
+    const char **pPatterns = (const char **)malloc(count * sizeof(char *));
+    if (!pPatterns)
+        return LS_FAIL;
+    for (int i = 0; i < count; ++i)
+    {
+        const URIMatch *pMatch = (*this)[i]->getURIMatch();
+        pPatterns[i] = pMatch ? pMatch->getPattern() : NULL;
+    }
+    RegexFilter *pFilter = new RegexFilter();
+    int literals = pFilter ? pFilter->build(pPatterns, count) : LS_FAIL;
+    free(pPatterns);
+    if (literals <= 0)
+    {
+        delete pFilter;
+        return literals;
+    }
+    m_pFilter = pFilter;
+    return literals;
 }
 
@@ -23,7 +23,11 @@
 #include <util/autostr.h>
 #include <util/gpointerlist.h>
 
+//regex context lists shorter than this are matched one by one
+#define CONTEXT_FILTER_MIN_CONTEXTS 4
+
 class HttpContext;
+class RegexFilter;
 class ContextMatchList : public TPointerList< HttpContext >
 {
 public:
@@ -35,8 +39,10 @@ public:
 class ContextList : public TPointerList< HttpContext >
 {
     AutoStr     m_sTags;
+    RegexFilter *m_pFilter;
     ContextList(const ContextList &rhs);
     void operator=(const ContextList &rhs);
+    void releaseFilter();
 public:
     ContextList();
     ~ContextList();
@@ -44,6 +50,8 @@ public:
     int add(HttpContext *pContext, int release);
     int merge(const ContextList *rhs, int release);
     void releaseUnused(long curTime, long timeout);
+    int buildFilter();
+    const RegexFilter *getFilter() const   {   return m_pFilter;   }
 };
 
 
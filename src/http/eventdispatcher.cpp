@@ -50,12 +50,8 @@ EventDispatcher::~EventDispatcher()
 }
 
 
-int EventDispatcher::init(const char *pType)
+static int newMultiplexer()
 {
-    if (MultiplexerFactory::getMultiplexer())
-        return 0;
-    MultiplexerFactory::s_iMultiplexerType = MultiplexerFactory::getType(
-                pType);
     Multiplexer *pMultiplexer =
         MultiplexerFactory::getNew(MultiplexerFactory::s_iMultiplexerType);
     if (pMultiplexer != NULL)
@@ -67,8 +63,34 @@ int EventDispatcher::init(const char *pType)
             //CallbackQueue::getInstance().initNotifier(pMultiplexer);
             return 0;
         }
+        MultiplexerFactory::recycle(pMultiplexer);
     }
-    return LS_FAIL;
+    //a configured type this platform cannot provide falls back to the
+    //platform default, as it did before the type was honored
+    int best = MultiplexerFactory::getType(NULL);
+    int type = MultiplexerFactory::s_iMultiplexerType;
+    if (type == best)
+        return LS_FAIL;
+    if (type == MultiplexerFactory::IO_URING)
+        LS_NOTICE("io_uring is not usable on this kernel: %s, "
+                  "falling back to %s.", strerror(errno),
+                  MultiplexerFactory::getTypeName(best));
+    else
+        LS_NOTICE("Event dispatcher %s is not available on this platform, "
+                  "falling back to %s.", MultiplexerFactory::getTypeName(type),
+                  MultiplexerFactory::getTypeName(best));
+    MultiplexerFactory::s_iMultiplexerType = best;
+    return newMultiplexer();
+}
+
+
+int EventDispatcher::init(const char *pType)
+{
+    if (MultiplexerFactory::getMultiplexer())
+        return 0;
+    MultiplexerFactory::s_iMultiplexerType = MultiplexerFactory::getType(
+                pType);
+    return newMultiplexer();
 }
 
 
@@ -77,19 +99,8 @@ int EventDispatcher::reinit()
     if (!MultiplexerFactory::getMultiplexer())
         return LS_FAIL;
     MultiplexerFactory::recycle(MultiplexerFactory::getMultiplexer());
-    Multiplexer *pMultiplexer =
-        MultiplexerFactory::getNew(MultiplexerFactory::s_iMultiplexerType);
-    if (pMultiplexer != NULL)
-    {
-        if (!pMultiplexer->init(DEFAULT_INIT_POLL_SIZE))
-        {
-            MultiplexerFactory::setMultiplexer(pMultiplexer);
-            pMultiplexer->setPriHandler(highPriorityTask);
-            //CallbackQueue::getInstance().initNotifier(pMultiplexer);
-            return 0;
-        }
-    }
-    return LS_FAIL;
+    MultiplexerFactory::setMultiplexer(NULL);
+    return newMultiplexer();
 }
 
 
@@ -0,0 +1,283 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "headerscanner.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HDR_SCAN_X86
+#include <immintrin.h>
+#endif
+
+
+#define HDR_SCAN_BLOCK      64
+#define HDR_SCAN_BATCH      16
+
+
+//Fills 3 masks per 64-byte block: line feeds, colons and illegal characters
+typedef void (*scan_fn)(const char *p, int blocks, uint64_t *pMasks);
+
+
+static void scanScalar(const char *p, int blocks, uint64_t *pMasks)
+{
+    for (; blocks > 0; --blocks, p += HDR_SCAN_BLOCK, pMasks += 3)
+    {
+        uint64_t lf = 0, colon = 0, bad = 0;
+        for (int i = 0; i < HDR_SCAN_BLOCK; ++i)
+        {
+            unsigned char ch = p[i];
+            if (ch == '\n')
+                lf |= 1ULL << i;
+            else if (ch == ':')
+                colon |= 1ULL << i;
+            else if ((ch < 0x20 && ch != '\t' && ch != '\r') || ch == 0x7f)
+                bad |= 1ULL << i;
+        }
+        pMasks[0] = lf;
+        pMasks[1] = colon;
+        pMasks[2] = bad;
+    }
+}
+
+
+#ifdef HDR_SCAN_X86
+
+__attribute__((target("sse2")))
+static void scanSse2(const char *p, int blocks, uint64_t *pMasks)
+{
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    const __m128i ctl = _mm_set1_epi8(0x1f);
+    for (; blocks > 0; --blocks, p += HDR_SCAN_BLOCK, pMasks += 3)
+    {
+        uint64_t masks[3] = { 0, 0, 0 };
+        for (int i = 0; i < HDR_SCAN_BLOCK; i += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+            __m128i isLf = _mm_cmpeq_epi8(v, lf);
+            __m128i isCtl = _mm_cmpeq_epi8(_mm_max_epu8(v, ctl), ctl);
+            __m128i isOk = _mm_or_si128(isLf, _mm_or_si128(
+                                            _mm_cmpeq_epi8(v, tab),
+                                            _mm_cmpeq_epi8(v, cr)));
+            __m128i isBad = _mm_or_si128(_mm_andnot_si128(isOk, isCtl),
+                                         _mm_cmpeq_epi8(v, del));
+            masks[0] |= (uint64_t)_mm_movemask_epi8(isLf) << i;
+            masks[1] |= (uint64_t)_mm_movemask_epi8(
+                            _mm_cmpeq_epi8(v, colon)) << i;
+            masks[2] |= (uint64_t)_mm_movemask_epi8(isBad) << i;
+        }
+        memcpy(pMasks, masks, sizeof(masks));
+    }
+}
+
+
+__attribute__((target("avx2")))
+static void scanAvx2(const char *p, int blocks, uint64_t *pMasks)
+{
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    const __m256i ctl = _mm256_set1_epi8(0x1f);
+    for (; blocks > 0; --blocks, p += HDR_SCAN_BLOCK, pMasks += 3)
+    {
+        uint64_t masks[3] = { 0, 0, 0 };
+        for (int i = 0; i < HDR_SCAN_BLOCK; i += 32)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+            __m256i isLf = _mm256_cmpeq_epi8(v, lf);
+            __m256i isCtl = _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctl), ctl);
+            __m256i isOk = _mm256_or_si256(isLf, _mm256_or_si256(
+                                               _mm256_cmpeq_epi8(v, tab),
+                                               _mm256_cmpeq_epi8(v, cr)));
+            __m256i isBad = _mm256_or_si256(_mm256_andnot_si256(isOk, isCtl),
+                                            _mm256_cmpeq_epi8(v, del));
+            masks[0] |= (uint64_t)(uint32_t)_mm256_movemask_epi8(isLf) << i;
+            masks[1] |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                            _mm256_cmpeq_epi8(v, colon)) << i;
+            masks[2] |= (uint64_t)(uint32_t)_mm256_movemask_epi8(isBad) << i;
+        }
+        memcpy(pMasks, masks, sizeof(masks));
+    }
+}
+
+#endif
+
+
+static int isSupported(int impl)
+{
+    switch (impl)
+    {
+    case HeaderScanner::SCAN_SCALAR:
+        return 1;
+#ifdef HDR_SCAN_X86
+    case HeaderScanner::SCAN_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case HeaderScanner::SCAN_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return 0;
+    }
+}
+
+
+static scan_fn implToFn(int impl)
+{
+    switch (impl)
+    {
+#ifdef HDR_SCAN_X86
+    case HeaderScanner::SCAN_SSE2:
+        return scanSse2;
+    case HeaderScanner::SCAN_AVX2:
+        return scanAvx2;
+#endif
+    default:
+        return scanScalar;
+    }
+}
+
+
+static int detectImpl()
+{
+    if (isSupported(HeaderScanner::SCAN_AVX2))
+        return HeaderScanner::SCAN_AVX2;
+    if (isSupported(HeaderScanner::SCAN_SSE2))
+        return HeaderScanner::SCAN_SSE2;
+    return HeaderScanner::SCAN_SCALAR;
+}
+
+
+static int s_iImpl = detectImpl();
+static scan_fn s_scan = implToFn(s_iImpl);
+
+
+int HeaderScanner::getImpl()
+{
+    return s_iImpl;
+}
+
+
+/**
+ * Forces one implementation, for tests and benchmarks.
+ * Returns -1 if the CPU does not support it.
+ */
+int HeaderScanner::setImpl(int impl)
+{
+    if (!isSupported(impl))
+        return LS_FAIL;
+    s_iImpl = impl;
+    s_scan = implToFn(impl);
+    return LS_OK;
+}
+
+
+const char *HeaderScanner::getImplName(int impl)
+{
+    static const char *s_pNames[] = { "scalar", "sse2", "avx2" };
+    if (impl < SCAN_SCALAR || impl > SCAN_AVX2)
+        return "unknown";
+    return s_pNames[impl];
+}
+
+
+//bits of mask above pos
+static inline uint64_t above(uint64_t mask, int pos)
+{
+    return (pos == 63) ? 0 : mask & (~0ULL << (pos + 1));
+}
+
+
+int HeaderScanner::scan(const char *pBegin, const char *pEnd,
+                        hdr_line_t *pLines, int maxLines)
+{
+    uint64_t masks[HDR_SCAN_BATCH * 3];
+    const char *pBatch = pBegin;
+    const char *pLine = pBegin;
+    const char *pColon = NULL;
+    int n = 0;
+
+    if (maxLines <= 0)
+        return 0;
+    while (pBatch < pEnd)
+    {
+        long left = pEnd - pBatch;
+        int blocks = left / HDR_SCAN_BLOCK;
+        if (blocks >= HDR_SCAN_BATCH)
+            blocks = HDR_SCAN_BATCH;
+        else
+        {
+            //Never read past the end of the buffer, pad the last block
+            char achBuf[HDR_SCAN_BLOCK];
+            int rest = left - blocks * HDR_SCAN_BLOCK;
+            if (rest > 0)
+            {
+                memcpy(achBuf, pBatch + blocks * HDR_SCAN_BLOCK, rest);
+                memset(achBuf + rest, ' ', HDR_SCAN_BLOCK - rest);
+                (*s_scan)(achBuf, 1, &masks[blocks * 3]);
+            }
+        }
+        if (blocks > 0)
+            (*s_scan)(pBatch, blocks, masks);
+        if (blocks < HDR_SCAN_BATCH && left > blocks * HDR_SCAN_BLOCK)
+            ++blocks;
+
+        for (int b = 0; b < blocks; ++b, pBatch += HDR_SCAN_BLOCK)
+        {
+            uint64_t lf = masks[b * 3];
+            uint64_t colon = masks[b * 3 + 1];
+            uint64_t bad = masks[b * 3 + 2];
+            uint64_t stop = lf | bad;
+
+            //first colon of a line that started in an earlier block
+            if (!pColon && colon
+                && (!stop || (colon & ((stop & (0 - stop)) - 1))))
+                pColon = pBatch + __builtin_ctzll(colon);
+            while (stop)
+            {
+                int pos = __builtin_ctzll(stop);
+                const char *p = pBatch + pos;
+                pLines[n].end = p - pBegin;
+                if ((bad >> pos) & 1)
+                {
+                    pLines[n].colon = HDR_LINE_ILLEGAL;
+                    return n + 1;
+                }
+                pLines[n].colon = pColon ? pColon - pBegin : HDR_LINE_NO_COLON;
+                ++n;
+                if (n >= maxLines || (p == pLine + 1 && *pLine == '\r'))
+                    return n;
+                pLine = p + 1;
+
+                stop &= stop - 1;
+                colon = above(colon, pos);
+                uint64_t inLine = colon;
+                if (stop)
+                    inLine &= (stop & (0 - stop)) - 1;
+                pColon = inLine ? pBatch + __builtin_ctzll(inLine) : NULL;
+            }
+        }
+    }
+    return n;
+}
@@ -0,0 +1,73 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef HEADERSCANNER_H
+#define HEADERSCANNER_H
+
+
+#include <lsdef.h>
+#include <inttypes.h>
+
+#define HDR_LINE_NO_COLON   (-1)
+#define HDR_LINE_ILLEGAL    (-2)
+
+/**
+ * One line found by HeaderScanner::scan(), offsets are relative to the
+ * start of the scan. end is the offset of the '\n', colon the offset of
+ * the first ':' or HDR_LINE_NO_COLON. When colon is HDR_LINE_ILLEGAL the
+ * scan stopped at an illegal character and end is its offset.
+ */
+typedef struct hdr_line_s
+{
+    int32_t colon;
+    int32_t end;
+} hdr_line_t;
+
+
+/**
+ * Splits an HTTP/1.x header block into lines in one pass.
+ *
+ * The block is classified 64 bytes at a time, with AVX2 or SSE2 when the
+ * CPU has them and byte by byte otherwise, into bitmasks of line feeds,
+ * colons and characters a header may not contain (controls other than HT,
+ * CR and LF, and DEL). The lines are then read off the bitmasks, so no
+ * byte is looked at twice.
+ */
+class HeaderScanner
+{
+public:
+    enum
+    {
+        SCAN_SCALAR,
+        SCAN_SSE2,
+        SCAN_AVX2,
+    };
+
+    /**
+     * Stores up to maxLines complete lines of [pBegin, pEnd) in pLines and
+     * returns how many. Stops after the blank line ending the header, at
+     * an illegal character, or when maxLines are found.
+     */
+    static int scan(const char *pBegin, const char *pEnd, hdr_line_t *pLines,
+                    int maxLines);
+
+    static int getImpl();
+    static int setImpl(int impl);
+    static const char *getImplName(int impl);
+};
+
+#endif
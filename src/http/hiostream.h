@@ -79,6 +79,7 @@ enum HiosProtocol
 #define HIO_FLAG_DELAY_FLUSH        (1<<18)
 #define HIO_FLAG_PRI_SET            (1<<19)
 #define HIO_FLAG_ALTSVC_SENT        (1<<20)
+#define HIO_FLAG_INCREMENTAL        (1<<21)
 
 
 #define HIO_EOR                     1
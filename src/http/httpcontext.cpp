@@ -39,6 +39,7 @@
 #include <main/configctx.h>
 #include <util/accesscontrol.h>
 #include <util/pool.h>
+#include <util/regexfilter.h>
 #include <util/stringlist.h>
 #include <util/stringtool.h>
 #include <util/xmlnode.h>
@@ -284,13 +285,18 @@ const HttpContext *HttpContext::matchFilesContext(const char *pFile,
         int len) const
 {
     //if ( !m_pInternal ||!m_pInternal->m_pFilesMatchList)
-    if (!m_pInternal->m_pFilesMatchList)
+    const ContextList *pList = m_pInternal->m_pFilesMatchList;
+    if (!pList)
         return NULL;
-    ContextList::iterator iter;
-    for (iter = m_pInternal->m_pFilesMatchList->begin();
-         iter != m_pInternal->m_pFilesMatchList->end();
-         ++iter)
-    {
+    unsigned char achSeen[REGEX_FILTER_MAX_LITERALS / 8];
+    const RegexFilter *pFilter = pList->getFilter();
+    if (pFilter)
+        pFilter->scan(pFile, len, achSeen);
+    ContextList::const_iterator iter;
+    for (iter = pList->begin(); iter != pList->end(); ++iter)
+    {
+        if (pFilter && !pFilter->mayMatch(iter - pList->begin(), achSeen))
+            continue;
         if ((*iter)->matchFiles(pFile, len) == 1)
             return *iter;
     }
@@ -766,6 +772,7 @@ void HttpContext::inherit(const HttpContext *pRootContext)
         for (iter = m_pMatchList->begin(); iter != m_pMatchList->end(); ++iter)
             (*iter)->inherit(pRootContext);
     }
+    buildMatchFilters();
 
     if (m_pParent->isRailsContext())
         setRailsContext();
@@ -784,6 +791,16 @@ void HttpContext::matchListInherit(const HttpContext *pRootContext) const
         for (iter = m_pMatchList->begin(); iter != m_pMatchList->end(); ++iter)
             (*iter)->inherit(pRootContext);
     }
+    buildMatchFilters();
+}
+
+
+void HttpContext::buildMatchFilters() const
+{
+    if (m_pMatchList)
+        m_pMatchList->buildFilter();
+    if ((m_iConfigBits & BIT_FILES_MATCH) && m_pInternal->m_pFilesMatchList)
+        m_pInternal->m_pFilesMatchList->buildFilter();
 }
 
 
@@ -809,9 +826,16 @@ const HttpContext *HttpContext::match(const char *pURI, int iURILen,
     //if ( !m_pMatchList || m_iFilesMatchCtx)
     if (!m_pMatchList)
         return NULL;
+    unsigned char achSeen[REGEX_FILTER_MAX_LITERALS / 8];
+    const RegexFilter *pFilter = m_pMatchList->getFilter();
+    if (pFilter)
+        pFilter->scan(pURI, iURILen, achSeen);
     ContextList::iterator iter;
     for (iter = m_pMatchList->begin(); iter != m_pMatchList->end(); ++iter)
     {
+        if (pFilter
+            && !pFilter->mayMatch(iter - m_pMatchList->begin(), achSeen))
+            continue;
         if ((*iter)->getURIMatch()->match(pURI, iURILen, pBuf, bufLen) == 0)
             return *iter;
     }
@@ -1293,7 +1317,10 @@ int HttpContext::configRewriteRule(const RewriteMapList *pMapList,
         RewriteRule::setLogger(NULL, TmpLogId::getLogId());
         if (RewriteEngine::parseRules(pRule, pRuleList,
                                       pMapList, this) == 0)
+        {
+            pRuleList->compile();
             setRewriteRules(pRuleList);
+        }
         else
             delete pRuleList;
     }
@@ -333,6 +333,7 @@ public:
 
     void inherit(const HttpContext *pRootContext);
     void matchListInherit(const HttpContext *pRootContext) const;
+    void buildMatchFilters() const;
 
     HttpMime *getMIME()            {   return m_pInternal->m_pMIME;}
     const HttpMime *getMIME() const {   return m_pInternal->m_pMIME;}
@@ -26,6 +26,7 @@
 #include <http/httpserverconfig.h>
 #include <http/httpsession.h>
 #include <http/httpstatuscode.h>
+#include <http/shmmetrics.h>
 #include <http/stderrlogger.h>
 #include <log4cxx/logger.h>
 #include <util/gzipbuf.h>
@@ -179,6 +180,7 @@ int HttpExtConnector::parseHeader(const char *&pBuf, int &len, int proxy)
 
 int  HttpExtConnector::respHeaderDone()
 {
+    ShmMetrics::addBackendWait(getType(), m_pSession->getElapsedUs());
     m_pSession->testContentType();
     int ret = m_pSession->respHeaderDone();
     if (m_iRespState & HEC_RESP_AUTHORIZED)
@@ -24,6 +24,7 @@
 #include <http/clientinfo.h>
 #include <http/connlimitctrl.h>
 #include <http/httpresourcemanager.h>
+#include <http/httpserverconfig.h>
 #include <http/httpvhost.h>
 #include <http/ntwkiolink.h>
 #include <http/smartsettings.h>
@@ -65,6 +66,9 @@ HttpListener::HttpListener(const char *pName, const char *pAddr)
     , m_iSendZconf(0)
     , m_iBinding(0xffffffff)
     , m_pAdcPortList(NULL)
+    , m_pReusePortFds(NULL)
+    , m_iReusePortSlots(0)
+    , m_iReusePortReady(0)
 {
     m_pMapVHost->setAddrStr(pAddr);
 }
@@ -79,6 +83,9 @@ HttpListener::HttpListener()
     , m_iSendZconf(0)
     , m_iBinding(0xffffffff)
     , m_pAdcPortList(NULL)
+    , m_pReusePortFds(NULL)
+    , m_iReusePortSlots(0)
+    , m_iReusePortReady(0)
 {
 }
 
@@ -92,6 +99,7 @@ HttpListener::~HttpListener()
         delete m_pSubIpMap;
     if (m_pAdcPortList)
         delete m_pAdcPortList;
+    closeReusePortFds();
 }
 
 
@@ -196,7 +204,8 @@ int HttpListener::start()
         return errno;
     int fd;
     int ret = CoreSocket::listen(addr, SmartSettings::getSockBacklog(), &fd,
-                                 m_iSockSendBufSize, m_iSockRecvBufSize);
+                                 m_iSockSendBufSize, m_iSockRecvBufSize,
+                                 HttpServerConfig::getInstance().getReusePort());
     if (ret != 0)
         return ret;
     return setSockAttr(fd, addr);
@@ -206,6 +215,15 @@ int HttpListener::start()
 int HttpListener::setSockAttr(int fd, GSockAddr &addr)
 {
     setfd(fd);
+    initSockOpts(fd);
+    m_pMapVHost->setPort(addr.getPort());
+    return MultiplexerFactory::getMultiplexer()->add(this,
+            POLLIN | POLLHUP | POLLERR);
+}
+
+
+void HttpListener::initSockOpts(int fd)
+{
     ::fcntl(fd, F_SETFD, FD_CLOEXEC);
     ::fcntl(fd, F_SETFL, MultiplexerFactory::getMultiplexer()->getFLTag());
     int nodelay = 1;
@@ -217,7 +235,6 @@ int HttpListener::setSockAttr(int fd, GSockAddr &addr)
 
     //int tos = IPTOS_THROUGHPUT;
     //setsockopt( fd, IPPROTO_IP, IP_TOS, &tos, sizeof( tos ));
-    m_pMapVHost->setPort(addr.getPort());
 
 #ifdef SO_ACCEPTFILTER
     /*
@@ -233,9 +250,206 @@ int HttpListener::setSockAttr(int fd, GSockAddr &addr)
                       strerror(errno));
     }
 #endif
+}
 
-    return MultiplexerFactory::getMultiplexer()->add(this,
-            POLLIN | POLLHUP | POLLERR);
+
+int HttpListener::newReusePortSock()
+{
+    GSockAddr addr;
+    int fd;
+    if (addr.set(getAddrStr(), 0))
+        return LS_FAIL;
+    int ret = CoreSocket::listen(addr, SmartSettings::getSockBacklog(), &fd,
+                                 m_iSockSendBufSize, m_iSockRecvBufSize, 1);
+    if (ret != 0)
+    {
+        errno = ret;
+        return LS_FAIL;
+    }
+    initSockOpts(fd);
+    return fd;
+}
+
+
+void HttpListener::closeReusePortFds()
+{
+    if (!m_pReusePortFds)
+        return;
+    for (int i = 0; i < m_iReusePortSlots; ++i)
+    {
+        if ((m_pReusePortFds[i] != -1) && (m_pReusePortFds[i] != getfd()))
+            close(m_pReusePortFds[i]);
+    }
+    free(m_pReusePortFds);
+    m_pReusePortFds = NULL;
+    m_iReusePortSlots = 0;
+    m_iReusePortReady = 0;
+}
+
+
+/**
+ * Recovered socket bound to the same address as this listener, it is the
+ * SO_REUSEPORT socket of a worker passed over by a graceful restart.
+ */
+int HttpListener::addReusePortFd(int fd)
+{
+    int *pFds = (int *)realloc(m_pReusePortFds,
+                               (m_iReusePortSlots + 1) * sizeof(int));
+    if (!pFds)
+        return LS_FAIL;
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    pFds[m_iReusePortSlots++] = fd;
+    m_pReusePortFds = pFds;
+    m_iReusePortReady = 0;
+    return 0;
+}
+
+
+/**
+ * Lays out one slot per worker. The first worker bound to this listener
+ * takes the primary socket, the other bound workers take the sockets held
+ * so far, in order, so the sockets recovered from a graceful restart go
+ * to the new workers with the same numbers.
+ */
+int HttpListener::layoutReusePort(int iWorkers)
+{
+    int *pOld = m_pReusePortFds;
+    int  nOld = m_iReusePortSlots;
+    int  iOld = 0;
+    int  primary = 0;
+    int  i, fd;
+
+    int *pSlots = (int *)malloc(iWorkers * sizeof(int));
+    if (!pSlots)
+        return LS_FAIL;
+    for (i = 0; i < iWorkers; ++i)
+    {
+        pSlots[i] = -1;
+        if (!(m_iBinding & (1L << i)))
+            continue;
+        if (!primary)
+        {
+            pSlots[i] = getfd();
+            primary = 1;
+            continue;
+        }
+        fd = -1;
+        while ((iOld < nOld) && (fd == -1))
+        {
+            fd = pOld[iOld++];
+            if (fd == getfd())
+                fd = -1;
+        }
+        pSlots[i] = fd;
+    }
+    //No worker is left to accept on these. Closing a SO_REUSEPORT socket
+    //resets the connections queued on it, unless net.ipv4.tcp_migrate_req
+    //is enabled to move them to the remaining sockets of the group.
+    while (iOld < nOld)
+    {
+        fd = pOld[iOld++];
+        if ((fd != -1) && (fd != getfd()))
+            close(fd);
+    }
+    if (pOld)
+        free(pOld);
+    m_pReusePortFds = pSlots;
+    m_iReusePortSlots = iWorkers;
+    m_iReusePortReady = 1;
+    return 0;
+}
+
+
+/**
+ * Called in the main process before forking worker iProcNo, make sure it
+ * has a SO_REUSEPORT socket of its own. The main process keeps every
+ * socket open, so the connections queued for a worker that exits are
+ * accepted by its replacement, which takes over the same socket, and the
+ * sockets are passed to the new instance on graceful restart.
+ * iWorkers <= 1 goes back to one socket shared by all workers.
+ */
+int HttpListener::setupReusePort(int iWorkers, int iProcNo)
+{
+    int flag = 0;
+    int fd;
+
+    if ((iWorkers <= 1) || (m_iAdmin) || (getfd() == -1))
+    {
+        closeReusePortFds();
+        return 0;
+    }
+#ifdef SO_REUSEPORT
+    socklen_t len = sizeof(flag);
+    if (getsockopt(getfd(), SOL_SOCKET, SO_REUSEPORT, &flag, &len) != 0)
+        flag = 0;
+#endif
+    if (!flag)
+    {
+        LS_NOTICE(this, "Listener socket was created without SO_REUSEPORT, "
+                  "full server restart is required to enable reusePort.");
+        closeReusePortFds();
+        return 0;
+    }
+    if (((m_iReusePortSlots != iWorkers) || !m_iReusePortReady)
+        && (layoutReusePort(iWorkers) == LS_FAIL))
+        return LS_FAIL;
+    if ((iProcNo < 1) || (iProcNo > iWorkers)
+        || (m_pReusePortFds[iProcNo - 1] != -1)
+        || !(m_iBinding & (1L << (iProcNo - 1))))
+        return 0;
+    if ((fd = newReusePortSock()) == -1)
+    {
+        LS_ERROR(this, "Failed to create SO_REUSEPORT socket for "
+                 "worker #%d: %s, fall back to shared listener socket.",
+                 iProcNo, strerror(errno));
+        return LS_FAIL;
+    }
+    m_pReusePortFds[iProcNo - 1] = fd;
+    LS_DBG_L(this, "Created SO_REUSEPORT socket %d for worker #%d.", fd,
+             iProcNo);
+    return 0;
+}
+
+
+/**
+ * Called in a newly forked worker, switch to the socket reserved for this
+ * worker by setupReusePort() and close the copies belonging to others.
+ * Without a socket of its own, the worker keeps the shared one.
+ */
+void HttpListener::useReusePortSock(int iProcNo, int iIncomingCpu)
+{
+    int fd = -1;
+    if (!m_pReusePortFds)
+        return;
+    if ((iProcNo > 0) && (iProcNo <= m_iReusePortSlots))
+    {
+        fd = m_pReusePortFds[iProcNo - 1];
+        m_pReusePortFds[iProcNo - 1] = -1;
+    }
+    closeReusePortFds();
+    if ((fd == -1) || (getfd() == -1))
+        return;
+    if (fd != getfd())
+    {
+        int registered = !MultiplexerFactory::s_iMultiplexerType;
+        if (registered)
+            MultiplexerFactory::getMultiplexer()->remove(this);
+        close(getfd());
+        setfd(fd);
+        if (registered)
+            MultiplexerFactory::getMultiplexer()->add(this,
+                    POLLIN | POLLHUP | POLLERR);
+    }
+#ifdef SO_INCOMING_CPU
+    //Let the kernel prefer the socket of the worker running on the CPU
+    //that received the SYN.
+    if ((iIncomingCpu >= 0) && (setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU,
+                                           &iIncomingCpu, sizeof(int)) != 0))
+        LS_DBG_L(this, "Failed to set SO_INCOMING_CPU to %d: %s",
+                 iIncomingCpu, strerror(errno));
+#endif
+    LS_DBG_L(this, "Worker #%d accepts on SO_REUSEPORT socket %d.",
+             iProcNo, fd);
 }
 
 
@@ -266,6 +480,7 @@ int HttpListener::stop()
     if (getfd() != -1)
     {
         LS_INFO("Stop listener %s.", getAddrStr());
+        closeReusePortFds();
         MultiplexerFactory::getMultiplexer()->remove(this);
         close(getfd());
         setfd(-1);
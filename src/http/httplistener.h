@@ -56,6 +56,12 @@ class HttpListener : public EventReactor, public LogSession
     IolinkSessionHooks  m_iolinkSessionHooks;
     AutoStr            *m_pAdcPortList;
 
+    //per worker SO_REUSEPORT sockets kept by the main process, indexed by
+    //process number - 1, the primary socket getfd() is one of them.
+    int                *m_pReusePortFds;
+    short               m_iReusePortSlots;
+    short               m_iReusePortReady;
+
     HttpListener(const HttpListener &rhs);
     void operator=(const HttpListener &rhs);
     int addConnection(struct conn_data *pCur, int *iCount);
@@ -64,6 +70,10 @@ class HttpListener : public EventReactor, public LogSession
                      struct conn_data *pEnd, int *iCount);
     int checkAccess(struct conn_data *pData);
     int setSockAttr(int fd, GSockAddr &addr);
+    void initSockOpts(int fd);
+    int newReusePortSock();
+    void closeReusePortFds();
+    int layoutReusePort(int iWorkers);
     VHostMap *getSubMap(int fd);
 
 
@@ -141,6 +151,12 @@ public:
     int setConnInfo(ConnInfo *pInfo, struct conn_data *pCur);
 
     int enableQuic();
+
+    int setupReusePort(int iWorkers, int iProcNo);
+    int addReusePortFd(int fd);
+    void useReusePortSock(int iProcNo, int iIncomingCpu);
+    int getReusePortSlots() const       {   return m_iReusePortSlots;   }
+    int getReusePortFd(int slot) const  {   return m_pReusePortFds[slot];   }
 };
 
 #endif
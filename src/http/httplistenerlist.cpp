@@ -22,6 +22,7 @@
 
 #include <socket/gsockaddr.h>
 #include <assert.h>
+#include <netinet/in.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/socket.h>
@@ -208,17 +209,42 @@ void HttpListenerList::passListeners()
 {
     int startfd = 1000;
     int count = 0;
+    int extra = 0;
     int sort = 0;
+    int fd;
     for (iterator iter = begin(); iter != end(); ++iter)
     {
         if ((*iter)->getfd() >= 1000)
             sort = 1;
         if ((*iter)->getfd() != -1)
             ++count;
+        for (int i = 0; i < (*iter)->getReusePortSlots(); ++i)
+        {
+            fd = (*iter)->getReusePortFd(i);
+            if ((fd != -1) && (fd != (*iter)->getfd()))
+                ++extra;
+        }
     }
-    close(startfd + count);
+    close(startfd + count + extra);
     if (sort)
         this->sort(compare_fd);
+    //SO_REUSEPORT sockets of workers follow the primary listener sockets in
+    //worker order, recvListeners() attaches them back to the listener with
+    //the same address.
+    extra = 0;
+    for (iterator iter = begin(); iter != end(); ++iter)
+    {
+        for (int i = 0; i < (*iter)->getReusePortSlots(); ++i)
+        {
+            fd = (*iter)->getReusePortFd(i);
+            if ((fd == -1) || (fd == (*iter)->getfd()))
+                continue;
+            LS_NOTICE("Pass SO_REUSEPORT socket of listener %s, copy fd %d to %d.",
+                      (*iter)->getAddrStr(), fd, startfd + count + extra);
+            dup2(fd, startfd + count + extra);
+            ++extra;
+        }
+    }
     for (iterator iter = end() - 1; iter >= begin(); --iter)
     {
         if ((*iter)->getfd() != -1)
@@ -232,6 +258,29 @@ void HttpListenerList::passListeners()
 }
 
 
+static HttpListener *findSameAddr(HttpListenerList *pList,
+                                  const struct sockaddr *pAddr)
+{
+    char        achSockAddr[128];
+    socklen_t   len;
+    struct sockaddr *pListenAddr = (struct sockaddr *)achSockAddr;
+    for (HttpListenerList::iterator iter = pList->begin();
+         iter != pList->end(); ++iter)
+    {
+        len = 128;
+        if (((*iter)->getfd() == -1)
+            || (getsockname((*iter)->getfd(), pListenAddr, &len) == -1))
+            continue;
+        if ((pListenAddr->sa_family == pAddr->sa_family)
+            && (GSockAddr::compareAddr(pListenAddr, pAddr) == 0)
+            && (((const struct sockaddr_in *)pListenAddr)->sin_port
+                == ((const struct sockaddr_in *)pAddr)->sin_port))
+            return *iter;
+    }
+    return NULL;
+}
+
+
 void HttpListenerList::recvListeners()
 {
     int         startfd = 1000;
@@ -258,10 +307,21 @@ void HttpListenerList::recvListeners()
         if (pAddr->sa_family != PF_UNIX)
         {
             int fd = dup(startfd);
-            HttpListener *pListener = new HttpListener();
-            pListener->assign(fd, pAddr);
-            push_back(pListener);
-            sort(s_compare);
+            HttpListener *pListener = findSameAddr(this, pAddr);
+            if (pListener)
+            {
+                LS_NOTICE("Recovering SO_REUSEPORT socket of listener [%s].",
+                          pListener->getAddrStr());
+                if (pListener->addReusePortFd(fd) == -1)
+                    close(fd);
+            }
+            else
+            {
+                pListener = new HttpListener();
+                pListener->assign(fd, pAddr);
+                push_back(pListener);
+                sort(s_compare);
+            }
         }
         close(startfd);
         ++startfd;
@@ -270,6 +330,13 @@ void HttpListenerList::recvListeners()
 
 
 
+void HttpListenerList::setupReusePort(int iWorkers, int iProcNo)
+{
+    for (iterator iter = begin(); iter != end(); ++iter)
+        (*iter)->setupReusePort(iWorkers, iProcNo);
+}
+
+
 void HttpListenerList::moveNonExist(HttpListenerList &rhs)
 {
     for (iterator iter = rhs.begin(); iter != rhs.end();)
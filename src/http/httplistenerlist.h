@@ -58,6 +58,7 @@ public:
     int  saveInUseListnersTo(HttpListenerList &rhs);
     void passListeners();
     void recvListeners();
+    void setupReusePort(int iWorkers, int iProcNo);
 };
 
 
@@ -785,6 +785,24 @@ char HttpMime::compressible(const char *pMIME) const
 }
 
 
+/**
+ * Adds the suffixes mapped to a compressible MIME type to pList, sorted,
+ * for work done outside of the event loop thread.
+ */
+int HttpMime::getCompressibleSuffixes(StringList *pList) const
+{
+    MIMESuffixMap::iterator iter;
+    for (iter = m_pSuffixMap->begin(); iter != m_pSuffixMap->end();
+         iter = m_pSuffixMap->next(iter))
+    {
+        const MimeSetting *pSetting = iter.second()->getSetting();
+        if (pSetting && pSetting->getExpires()->compressible())
+            pList->add(iter.first());
+    }
+    pList->sort();
+    return pList->size();
+}
+
 int HttpMime::inherit(HttpMime *pParent, int existedOnly)
 {
     if (!pParent)
@@ -122,6 +122,7 @@ public:
 
     static void releaseMIMEList();
     char compressible(const char *pMIME) const;
+    int getCompressibleSuffixes(StringList *pList) const;
     static void setCompressible(MimeSetting *pSetting, void *pValue);
     static void setExpire(MimeSetting *pSetting, void *pValue);
     static void setHandler(MimeSetting *pSetting, void *pValue);
@@ -0,0 +1,276 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "httppriority.h"
+
+#include <spdy/unpackedheaders.h>
+
+#include <limits.h>
+#include <string.h>
+#include <strings.h>
+
+
+static inline int isKeyChar(char ch)
+{
+    return (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9')
+           || ch == '_' || ch == '-' || ch == '.' || ch == '*';
+}
+
+
+static inline int isDigit(char ch)
+{
+    return ch >= '0' && ch <= '9';
+}
+
+
+static inline int isAlpha(char ch)
+{
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
+
+
+static inline int isTokenChar(char ch)
+{
+    return isAlpha(ch) || isDigit(ch)
+           || (ch && strchr("!#$%&'*+-.^_`|~:/", ch));
+}
+
+
+static const char *skipSp(const char *p, const char *pEnd)
+{
+    while (p < pEnd && *p == ' ')
+        ++p;
+    return p;
+}
+
+
+static const char *skipOws(const char *p, const char *pEnd)
+{
+    while (p < pEnd && (*p == ' ' || *p == '\t'))
+        ++p;
+    return p;
+}
+
+
+static const char *parseKey(const char *p, const char *pEnd)
+{
+    if (p >= pEnd || !((*p >= 'a' && *p <= 'z') || *p == '*'))
+        return NULL;
+    while (++p < pEnd && isKeyChar(*p))
+        ;
+    return p;
+}
+
+
+//integer or decimal, *pValue is set for an integer only
+static const char *parseNumber(const char *p, const char *pEnd, int *pValue)
+{
+    int neg = 0, digits = 0;
+    long value = 0;
+    if (p < pEnd && *p == '-')
+    {
+        neg = 1;
+        ++p;
+    }
+    for (; p < pEnd && isDigit(*p); ++p)
+    {
+        if (++digits > 15)
+            return NULL;
+        value = value * 10 + *p - '0';
+    }
+    if (!digits)
+        return NULL;
+    if (p < pEnd && *p == '.')
+    {
+        if (digits > 12)
+            return NULL;
+        const char *pFrac = ++p;
+        while (p < pEnd && isDigit(*p) && p - pFrac < 3)
+            ++p;
+        if (p == pFrac || (p < pEnd && isDigit(*p)))
+            return NULL;
+        return p;
+    }
+    if (value > 0xffff || value < 0)
+        value = 0xffff;
+    *pValue = neg ? -(int)value : (int)value;
+    return p;
+}
+
+
+/**
+ * Skips one bare item. Sets *pType to 'i' for an integer stored in
+ * *pValue, 'b' for a boolean stored in *pValue, 0 for anything else.
+ */
+static const char *parseBareItem(const char *p, const char *pEnd,
+                                 int *pType, int *pValue)
+{
+    *pType = 0;
+    if (p >= pEnd)
+        return NULL;
+    if (*p == '-' || isDigit(*p))
+    {
+        *pValue = INT_MIN;
+        p = parseNumber(p, pEnd, pValue);
+        if (p && *pValue != INT_MIN)
+            *pType = 'i';
+        return p;
+    }
+    switch (*p)
+    {
+    case '"':
+        while (++p < pEnd)
+        {
+            if (*p == '\\')
+            {
+                if (++p >= pEnd || (*p != '"' && *p != '\\'))
+                    return NULL;
+            }
+            else if (*p == '"')
+                return p + 1;
+            else if ((unsigned char)*p < 0x20 || (unsigned char)*p >= 0x7f)
+                return NULL;
+        }
+        return NULL;
+    case ':':
+        while (++p < pEnd && (isAlpha(*p) || isDigit(*p) || *p == '+'
+                              || *p == '/' || *p == '='))
+            ;
+        return (p < pEnd && *p == ':') ? p + 1 : NULL;
+    case '?':
+        if (p + 1 >= pEnd || (p[1] != '0' && p[1] != '1'))
+            return NULL;
+        *pType = 'b';
+        *pValue = p[1] - '0';
+        return p + 2;
+    default:
+        if (!isAlpha(*p) && *p != '*')
+            return NULL;
+        while (++p < pEnd && isTokenChar(*p))
+            ;
+        return p;
+    }
+}
+
+
+static const char *skipParams(const char *p, const char *pEnd)
+{
+    int type, value;
+    while (p && p < pEnd && *p == ';')
+    {
+        p = parseKey(skipSp(p + 1, pEnd), pEnd);
+        if (p && p < pEnd && *p == '=')
+            p = parseBareItem(p + 1, pEnd, &type, &value);
+    }
+    return p;
+}
+
+
+static const char *skipInnerList(const char *p, const char *pEnd)
+{
+    int type, value;
+    ++p;
+    while (p)
+    {
+        p = skipSp(p, pEnd);
+        if (p >= pEnd)
+            return NULL;
+        if (*p == ')')
+            return skipParams(p + 1, pEnd);
+        p = skipParams(parseBareItem(p, pEnd, &type, &value), pEnd);
+        if (p && p < pEnd && *p != ' ' && *p != ')')
+            return NULL;
+    }
+    return NULL;
+}
+
+
+int HttpPriority::parse(const char *pBegin, const char *pEnd, int *pUrgency,
+                        int *pIncremental)
+{
+    int urgency = *pUrgency;
+    int incremental = *pIncremental;
+    const char *p = skipSp(pBegin, pEnd);
+    while (p < pEnd && pEnd[-1] == ' ')
+        --pEnd;
+
+    while (p < pEnd)
+    {
+        const char *pKey = p;
+        int type = 'b', value = 1;
+        p = parseKey(p, pEnd);
+        if (!p)
+            return LS_FAIL;
+        int keyLen = p - pKey;
+        if (p < pEnd && *p == '=')
+        {
+            if (++p < pEnd && *p == '(')
+            {
+                type = 0;
+                p = skipInnerList(p, pEnd);
+            }
+            else
+                p = skipParams(parseBareItem(p, pEnd, &type, &value), pEnd);
+        }
+        else
+            p = skipParams(p, pEnd);
+        if (!p)
+            return LS_FAIL;
+
+        if (keyLen == 1 && *pKey == 'u')
+        {
+            if (type == 'i' && value >= 0 && value <= HTTP_PRI_URGENCY_MAX)
+                urgency = value;
+        }
+        else if (keyLen == 1 && *pKey == 'i')
+        {
+            if (type == 'b')
+                incremental = value;
+        }
+
+        p = skipOws(p, pEnd);
+        if (p >= pEnd)
+            break;
+        if (*p != ',')
+            return LS_FAIL;
+        p = skipOws(p + 1, pEnd);
+        if (p >= pEnd)
+            return LS_FAIL;
+    }
+    *pUrgency = urgency;
+    *pIncremental = incremental;
+    return LS_OK;
+}
+
+
+int HttpPriority::parse(const UnpackedHeaders *pHeaders, int *pUrgency,
+                        int *pIncremental)
+{
+    const char *pBuf = pHeaders->getBuf()->begin();
+    int found = 0;
+    for (const req_header_entry *p = pHeaders->getEntryBegin();
+         p < pHeaders->getEntryEnd(); ++p)
+    {
+        if (p->name_len != 8
+            || strncasecmp(pBuf + p->name_offset, "priority", 8) != 0)
+            continue;
+        const char *pVal = pBuf + p->name_offset + p->name_len + 2;
+        if (parse(pVal, pVal + p->val_len, pUrgency, pIncremental) == LS_OK)
+            found = 1;
+    }
+    return found;
+}
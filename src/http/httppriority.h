@@ -0,0 +1,60 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef HTTPPRIORITY_H
+#define HTTPPRIORITY_H
+
+
+#include <lsdef.h>
+
+#define HTTP_PRI_URGENCY_DEFAULT    3
+#define HTTP_PRI_URGENCY_MAX        7
+
+class UnpackedHeaders;
+
+
+/**
+ * RFC 9218 extensible priorities, as carried by the Priority request
+ * header and the HTTP/2 PRIORITY_UPDATE frame.
+ *
+ * The urgency, 0 to 7 with 0 the most urgent, maps one to one to the
+ * HIO_PRIORITY_* levels of a stream. Streams of the same urgency that are
+ * not incremental are sent one after another in stream ID order, the
+ * incremental ones share the bandwidth left in a round robin.
+ */
+class HttpPriority
+{
+public:
+    /**
+     * Parses a Priority field value, a structured field dictionary, and
+     * updates *pUrgency and *pIncremental with the "u" and "i" members it
+     * has. Unknown members and parameters are skipped, out of range values
+     * are ignored. Returns LS_FAIL and changes nothing if the value is not
+     * a valid dictionary.
+     */
+    static int parse(const char *pBegin, const char *pEnd, int *pUrgency,
+                     int *pIncremental);
+
+    /**
+     * Applies the Priority headers of a request, returns 1 if there was a
+     * valid one, 0 otherwise.
+     */
+    static int parse(const UnpackedHeaders *pHeaders, int *pUrgency,
+                     int *pIncremental);
+};
+
+#endif
@@ -20,6 +20,7 @@
 #include <http/accesscache.h>
 #include <http/denieddir.h>
 #include <http/handlertype.h>
+#include <http/headerscanner.h>
 #include <http/hotlinkctrl.h>
 #include <http/htauth.h>
 #include <http/httpcontext.h>
@@ -34,6 +35,7 @@
 #include <http/recaptcha.h>
 #include <http/requestvars.h>
 #include <http/serverprocessconfig.h>
+#include <http/statcache.h>
 #include <http/vhostmap.h>
 #include <http/httprespheaders.h>
 
@@ -791,6 +793,8 @@ void HttpReq::setScriptNameLen(int n)
 }
 
 
+#define HDR_SCAN_LINES  64
+
 int HttpReq::processHeaderLines()
 {
     const char *pBEnd = m_headerBuf.end();
@@ -799,80 +803,120 @@ int HttpReq::processHeaderLines()
     const char *pLineBegin  = m_headerBuf.begin() + m_iReqHeaderBufFinished;
     const char *pTemp = NULL;
     const char *pTemp1 = NULL;
+    const char *pScan;
+    const char *pIllegal = NULL;
     key_value_pair *pCurHeader = NULL;
     bool headerfinished = false;
+    hdr_line_t lines[HDR_SCAN_LINES];
+    int n, i;
     int index;
     int ret = 0;
 
     m_upgradeProto = UPD_PROTO_NONE; //0;
-    while ((pLineEnd  = (const char *)memchr(pLineBegin, '\n',
-                        pBEnd - pLineBegin)) != NULL)
+    while (1)
     {
-        pMark = (const char *)memchr(pLineBegin, ':', pLineEnd - pLineBegin);
-        if (pMark != NULL)
+        pScan = pLineBegin;
+        n = HeaderScanner::scan(pScan, pBEnd, lines, HDR_SCAN_LINES);
+        if (n == 0)
+            break;
+        for (i = 0; i < n; )
         {
-            while (1)
+            if (lines[i].colon == HDR_LINE_ILLEGAL)
+            {
+                pIllegal = pScan + lines[i].end;
+                break;
+            }
+            pLineEnd = pScan + lines[i].end;
+            pMark = (lines[i].colon >= 0) ? pScan + lines[i].colon : NULL;
+            ++i;
+            if (pMark != NULL)
             {
-                if (pLineEnd + 1 >= pBEnd)
+                while (1)
                 {
-                    m_iReqHeaderBufFinished = pLineBegin - m_headerBuf.begin();
-                    return 1;
+                    if (pLineEnd + 1 >= pBEnd)
+                    {
+                        m_iReqHeaderBufFinished = pLineBegin - m_headerBuf.begin();
+                        return 1;
+                    }
+                    if ((*(pLineEnd + 1) == ' ') || (*(pLineEnd + 1) == '\t'))
+                    {
+                        *((char *)pLineEnd) = ' ';
+                        if (*(pLineEnd - 1) == '\r')
+                            *((char *)pLineEnd - 1) = ' ';
+                    }
+                    else
+                        break;
+                    if (i >= n)
+                    {
+                        //the continuation line is beyond this batch of lines
+                        if (n < HDR_SCAN_LINES)
+                            return 1;
+                        pScan = pLineEnd + 1;
+                        n = HeaderScanner::scan(pScan, pBEnd, lines,
+                                                HDR_SCAN_LINES);
+                        i = 0;
+                        if (n == 0)
+                            return 1;
+                    }
+                    if (lines[i].colon == HDR_LINE_ILLEGAL)
+                    {
+                        pIllegal = pScan + lines[i].end;
+                        break;
+                    }
+                    pLineEnd = pScan + lines[i++].end;
                 }
-                if ((*(pLineEnd + 1) == ' ') || (*(pLineEnd + 1) == '\t'))
+                if (pIllegal)
+                    break;
+                pTemp = pMark + 1;
+                pTemp1 = pLineEnd;
+                skipSpaceBothSide(pTemp, pTemp1);
+                if (strncmp(pTemp, "() {", 4) == 0)
                 {
-                    *((char *)pLineEnd) = ' ';
-                    if (*(pLineEnd - 1) == '\r')
-                        *((char *)pLineEnd - 1) = ' ';
+                    LS_INFO(getLogSession(), "Status 400: CVE-2014-6271, "
+                            "CVE-2014-7169 signature detected in request header!");
+                    return SC_400;
+                }
+                index = HttpHeader::getIndex(pLineBegin);
+                if (index < HttpHeader::H_TE)
+                {
+                    m_commonHeaderLen[ index ] = pTemp1 - pTemp;
+                    m_commonHeaderOffset[index] = pTemp - m_headerBuf.begin();
+                    ret = processHeader(index);
+                }
+                else if (index == HttpHeader::H_HEADER_END)
+                {
+                    pCurHeader = newUnknownHeader();
+                    pCurHeader->keyOff = pLineBegin - m_headerBuf.begin();
+                    pCurHeader->keyLen = skipSpace(pMark, pLineBegin) - pLineBegin;
+                    pCurHeader->valOff = pTemp - m_headerBuf.begin();
+                    pCurHeader->valLen = pTemp1 - pTemp;
+                    ret = processUnknownHeader(pCurHeader, pLineBegin, pTemp);
                 }
                 else
-                    break;
-                pLineEnd  = (const char *)memchr(pLineEnd, '\n', pBEnd - pLineEnd);
-                if (pLineEnd == NULL)
-                    return 1;
-                else
-                    continue;
-            }
-            pTemp = pMark + 1;
-            pTemp1 = pLineEnd;
-            skipSpaceBothSide(pTemp, pTemp1);
-            if (strncmp(pTemp, "() {", 4) == 0)
-            {
-                LS_INFO(getLogSession(), "Status 400: CVE-2014-6271, "
-                        "CVE-2014-7169 signature detected in request header!");
-                return SC_400;
-            }
-            index = HttpHeader::getIndex(pLineBegin);
-            if (index < HttpHeader::H_TE)
-            {
-                m_commonHeaderLen[ index ] = pTemp1 - pTemp;
-                m_commonHeaderOffset[index] = pTemp - m_headerBuf.begin();
-                ret = processHeader(index);
-            }
-            else if (index == HttpHeader::H_HEADER_END)
-            {
-                pCurHeader = newUnknownHeader();
-                pCurHeader->keyOff = pLineBegin - m_headerBuf.begin();
-                pCurHeader->keyLen = skipSpace(pMark, pLineBegin) - pLineBegin;
-                pCurHeader->valOff = pTemp - m_headerBuf.begin();
-                pCurHeader->valLen = pTemp1 - pTemp;
-                ret = processUnknownHeader(pCurHeader, pLineBegin, pTemp);
+                {
+                    m_otherHeaderLen[ index - HttpHeader::H_TE] = pTemp1 - pTemp;
+                    m_otherHeaderOffset[index - HttpHeader::H_TE] = pTemp - m_headerBuf.begin();
+                    ret = processHeader(index);
+                }
+
+                if (ret != 0)
+                    return ret;
             }
-            else
+            pLineBegin = pLineEnd + 1;
+            if ((*(pLineEnd - 1) == '\r') && (*(pLineEnd - 2) == '\n'))
             {
-                m_otherHeaderLen[ index - HttpHeader::H_TE] = pTemp1 - pTemp;
-                m_otherHeaderOffset[index - HttpHeader::H_TE] = pTemp - m_headerBuf.begin();
-                ret = processHeader(index);
+                headerfinished = true;
+                break;
             }
-
-            if (ret != 0)
-                return ret;
         }
-        pLineBegin = pLineEnd + 1;
-        if ((*(pLineEnd - 1) == '\r') && (*(pLineEnd - 2) == '\n'))
-        {
-            headerfinished = true;
+        if (headerfinished || pIllegal || n < HDR_SCAN_LINES)
             break;
-        }
+    }
+    if (pIllegal)
+    {
+        LS_INFO(getLogSession(), "Status 400: illegal character 0x%02x in "
+                "request header!", (unsigned char)*pIllegal);
+        return SC_400;
     }
     m_iReqHeaderBufFinished = pLineBegin - m_headerBuf.begin();
     if (headerfinished)
@@ -992,6 +1036,11 @@ int HttpReq::processHeader(int index)
             if (strcasestr(pCur, "br") != NULL)
                 m_iAcceptBr = REQ_BR_ACCEPT |
                                 HttpServerConfig::getInstance().getBrCompress();
+            if ((m_commonHeaderLen[ index ] >= 4)
+                && (strcasestr(pCur, "zstd") != NULL))
+                m_iAcceptZstd = REQ_ZSTD_ACCEPT |
+                    (HttpServerConfig::getInstance().getZstdCompress() ?
+                     ZSTD_ENABLED : 0);
             *((char *)pBEnd) = ch;
         }
         break;
@@ -1195,6 +1244,9 @@ int HttpReq::processNewReqData(const struct sockaddr *pAddr)
 
     if (!m_pVHost->enableBr())
         andBr(~BR_ENABLED);
+
+    if (!m_pVHost->enableGzip())
+        andZstd(~ZSTD_ENABLED);
     AccessCache *pAccessCache = m_pVHost->getAccessCache();
     if (pAccessCache)
     {
@@ -2175,7 +2227,7 @@ int HttpReq::processPath(const char *pURI, int uriLen, char *pBuf,
                 if (n > l)
                     continue;
                 memcpy(p, (*iter)->c_str(), n);
-                if (ls_fio_stat(pBuf, &m_fileStat) != -1)
+                if (StatCache::cachedStat(pBuf, &m_fileStat) != -1)
                 {
                     p += n - 1;
                     l = 0;
@@ -3049,7 +3101,7 @@ int HttpReq::fileStat(const char *pPath, struct stat *st)
     if (strcmp(pPath, m_lastStatPath.c_str()) != 0)
     {
         m_lastStatPath.setStr(pPath);
-        m_lastStatRes = ls_fio_stat(pPath, &m_lastStat);
+        m_lastStatRes = StatCache::cachedStat(pPath, &m_lastStat);
         if (m_lastStatRes == -1)
         {
             m_lastStatRes = errno;
@@ -26,7 +26,7 @@
 #define LSI_RSP_BODY_SIZE_UNKNOWN (-2)
 
 class AutoStr2;
-class GzipBuf;
+class Compressor;
 class ExpiresCtrl;
 class HttpReq;
 class VMemBuf;
@@ -43,7 +43,7 @@ private:
     off_t           m_lEntityFinished;
 
     VMemBuf        *m_pRespBodyBuf;
-    GzipBuf        *m_pGzipBuf;
+    Compressor     *m_pGzipBuf;
 
     HttpResp(const HttpResp &rhs);
     void operator=(const HttpResp &rhs);
@@ -82,8 +82,8 @@ public:
     void setRespBodyBuf(VMemBuf *pBuf)    {   m_pRespBodyBuf = pBuf;  }
     void resetRespBody();
 
-    GzipBuf *getGzipBuf() const            {   return m_pGzipBuf;      }
-    void setGzipBuf(GzipBuf *pGzip)      {   m_pGzipBuf = pGzip;     }
+    Compressor *getGzipBuf() const         {   return m_pGzipBuf;      }
+    void setGzipBuf(Compressor *pGzip)   {   m_pGzipBuf = pGzip;     }
 
     HttpRespHeaders &getRespHeaders()
     {   return m_respHeaders;  }
@@ -111,6 +111,11 @@ public:
         m_respHeaders.addBrotliEncodingHeader();
     }
 
+    void addZstdEncodingHeader()
+    {
+        m_respHeaders.addZstdEncodingHeader();
+    }
+
     void appendChunked()
     {
         m_respHeaders.appendChunked();
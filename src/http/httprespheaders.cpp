@@ -25,6 +25,8 @@
 #include <spdy/lshpack.h>
 #include <util/datetime.h>
 #include <util/iovec.h>
+#include <lsr/ls_xpool.h>
+#include <lsr/xxhash.h>
 #include <ctype.h>
 
 
@@ -51,6 +53,7 @@ int             HttpRespHeaders::s_commonHeadersCount = 2;
 http_header_t       HttpRespHeaders::s_commonHeaders[2];
 http_header_t       HttpRespHeaders::s_gzipHeaders;
 http_header_t       HttpRespHeaders::s_brHeaders;
+http_header_t       HttpRespHeaders::s_zstdHeaders;
 http_header_t       HttpRespHeaders::s_varyHeaders;
 http_header_t       HttpRespHeaders::s_keepaliveHeader;
 http_header_t       HttpRespHeaders::s_chunkedHeader;
@@ -110,6 +113,8 @@ HttpRespHeaders::HttpRespHeaders(ls_xpool_t *pool)
     , m_aKVPairs()
     , m_iHttpCode(SC_200)
     , m_hLastHeaderKVPairIndex(0) // NOTICE: set to 0 first so reset works.
+    , m_pHpackBlock(NULL)
+    , m_iHpackMask(0)
 {
     m_pool = pool;
     incKVPairs(16); //init 16 kvpair spaces
@@ -142,6 +147,12 @@ void HttpRespHeaders::reset2()
 
 void HttpRespHeaders::reset()
 {
+    if (m_pHpackBlock)
+    {
+        ls_xpool_free(m_pool, m_pHpackBlock);
+        m_pHpackBlock = NULL;
+        m_iHpackMask = 0;
+    }
     if (m_hLastHeaderKVPairIndex == -1 && m_buf.size() == 0)
         return ;
 
@@ -176,6 +187,11 @@ void HttpRespHeaders::updateEtag(int compress_type)
             *pUpdate++ = 'g';
             *pUpdate++ = 'z';
         }
+        else if (compress_type == 3)
+        {
+            *pUpdate++ = 'z';
+            *pUpdate++ = 's';
+        }
         else
         {
             *pUpdate++ = 'b';
@@ -1035,6 +1051,11 @@ void HttpRespHeaders::buildCommonHeaders()
     HttpRespHeaders::s_brHeaders.val      = "br";
     HttpRespHeaders::s_brHeaders.valLen   = 2;
 
+    HttpRespHeaders::s_zstdHeaders.index    =
+        HttpRespHeaders::H_CONTENT_ENCODING;
+    HttpRespHeaders::s_zstdHeaders.val      = "zstd";
+    HttpRespHeaders::s_zstdHeaders.valLen   = 4;
+
     HttpRespHeaders::s_varyHeaders.index    = HttpRespHeaders::H_VARY;
     HttpRespHeaders::s_varyHeaders.val      = "Accept-Encoding";
     HttpRespHeaders::s_varyHeaders.valLen   = 15;
@@ -1105,6 +1126,57 @@ void HttpRespHeaders::dropConnectionHeaders()
 }
 
 
+void HttpRespHeaders::setHpackBlock(const char *pBlock, int len,
+                                    uint32_t mask, uint32_t hash)
+{
+    if (m_pHpackBlock)
+        ls_xpool_free(m_pool, m_pHpackBlock);
+    m_iHpackMask = 0;
+    m_pHpackBlock = (char *)ls_xpool_alloc(m_pool, len);
+    if (!m_pHpackBlock)
+        return;
+    memcpy(m_pHpackBlock, pBlock, len);
+    m_iHpackLen = len;
+    m_iHpackMask = mask;
+    m_iHpackHash = hash;
+}
+
+
+/**
+ * Returns NULL if any header of the block was changed, removed or got a
+ * second line after the block was attached.
+ */
+const char *HttpRespHeaders::getHpackBlock(int *pLen, uint32_t *pMask) const
+{
+    if (!m_pHpackBlock)
+        return NULL;
+    uint32_t hash = 0;
+    uint32_t mask = m_iHpackMask;
+    while (mask)
+    {
+        int index = __builtin_ctz(mask);
+        mask &= mask - 1;
+        if (m_KVPairindex[index] == 0xff)
+            return NULL;
+        resp_kvpair *pKv = getKvPair(m_KVPairindex[index]);
+        if (pKv->keyLen == 0 || pKv->next_index != 0)
+            return NULL;
+        hash = hashValue(hash, getVal(pKv), pKv->valLen);
+    }
+    if (hash != m_iHpackHash)
+        return NULL;
+    *pLen = m_iHpackLen;
+    *pMask = m_iHpackMask;
+    return m_pHpackBlock;
+}
+
+
+uint32_t HttpRespHeaders::hashValue(uint32_t hash, const char *pVal, int len)
+{
+    return XXH32(pVal, len, hash);
+}
+
+
 int HttpRespHeaders::toHpackIdx(int index)
 {
     static int lookup[] =
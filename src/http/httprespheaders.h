@@ -206,7 +206,14 @@ public:
         updateEtag(2);
     }
 
-    //compress_type 0: no gzip, 1:gzip, 2: br
+    void addZstdEncodingHeader()
+    {
+        add(&s_zstdHeaders, 1);
+        add(&s_varyHeaders, 1, LSI_HEADEROP_APPEND);
+        updateEtag(3);
+    }
+
+    //compress_type 0: no gzip, 1:gzip, 2: br, 3: zstd
     void updateEtag(int compress_type);
 
     void appendChunked()
@@ -232,6 +239,17 @@ public:
 
     static int toHpackIdx(int index);
 
+    /**
+     * Attaches HPACK literals, built without encoder state, for the
+     * headers whose INDEX bits are set in mask. hash chains hashValue()
+     * over their values in INDEX order. HTTP/2 sends the block in place
+     * of those headers while their values still hash the same.
+     */
+    void setHpackBlock(const char *pBlock, int len, uint32_t mask,
+                       uint32_t hash);
+    const char *getHpackBlock(int *pLen, uint32_t *pMask) const;
+    static uint32_t hashValue(uint32_t hash, const char *pVal, int len);
+
 public:
     static const char *m_sPresetHeaders[H_HEADER_END];
     static int m_iPresetHeaderLen[H_HEADER_END];
@@ -249,6 +267,10 @@ private:
     short           m_iHeaderUniqueCount;
     short           m_hLastHeaderKVPairIndex;
     int             m_iHeadersTotalLen;
+    char           *m_pHpackBlock;
+    uint32_t        m_iHpackMask;
+    uint32_t        m_iHpackHash;
+    int             m_iHpackLen;
 
     unsigned char   m_isFinalize;
     char            m_iHttpVersion;
@@ -285,6 +307,7 @@ private:
     static http_header_t   s_commonHeaders[2];
     static http_header_t   s_gzipHeaders;
     static http_header_t   s_brHeaders;
+    static http_header_t   s_zstdHeaders;
     static http_header_t   s_varyHeaders;
     static http_header_t   s_keepaliveHeader;
     static http_header_t   s_chunkedHeader;
@@ -42,6 +42,8 @@ HttpServerConfig::HttpServerConfig()
     , m_iDynGzipCompress(0)
     , m_iCompressLevel(4)
     , m_iBrCompress(0)
+    , m_iZstdCompress(0)
+    , m_iZstdCompressLevel(3)
     , m_iEnableLve(0)
     , m_iMaxFcgiInstances(2000)
     , m_iMaxTempFileSize(10240)
@@ -53,6 +55,7 @@ HttpServerConfig::HttpServerConfig()
     , m_iDirForbiddenBits(000)   //S_IWOTH | S_IWGRP )
     , m_iRestartTimeout(300)
     , m_nCpuAffinity(0)
+    , m_iReusePort(0)
     , m_iDnsLookup(1)
     , m_iUseProxyHeader(0)
     , m_iEnableH2c(0)
@@ -46,6 +46,8 @@ class HttpServerConfig : public TSingleton<HttpServerConfig>
     int8_t          m_iDynGzipCompress;
     int8_t          m_iCompressLevel;
     int8_t          m_iBrCompress;
+    int8_t          m_iZstdCompress;
+    int8_t          m_iZstdCompressLevel;
     int8_t          m_iEnableLve;
 
     int32_t         m_iCheckDeniedSymLink;
@@ -61,6 +63,7 @@ class HttpServerConfig : public TSingleton<HttpServerConfig>
     int32_t         m_iDirForbiddenBits;
     int32_t         m_iRestartTimeout;
     int32_t         m_nCpuAffinity;
+    int32_t         m_iReusePort;
 
     int             m_iDnsLookup;
     int             m_iUseProxyHeader;
@@ -127,6 +130,14 @@ public:
     {   m_iBrCompress = compress;     }
     int8_t  getBrCompress() const           {   return m_iBrCompress;       }
 
+    void setZstdCompress(int32_t compress)
+    {   m_iZstdCompress = compress;   }
+    int8_t  getZstdCompress() const         {   return m_iZstdCompress;     }
+
+    void setZstdCompressLevel(int32_t level)
+    {   m_iZstdCompressLevel = level;   }
+    int8_t  getZstdCompressLevel() const    {   return m_iZstdCompressLevel;    }
+
     void setDebugLevel(int32_t level);
 
 
@@ -198,6 +209,9 @@ public:
     int getCpuAffinity() const              {   return m_nCpuAffinity;      }
     void setCpuAffinity( int count)         {   m_nCpuAffinity = count;     }
 
+    int getReusePort() const                {   return m_iReusePort;        }
+    void setReusePort(int val)              {   m_iReusePort = val;         }
+
 };
 
 LS_SINGLETON_DECL(HttpServerConfig);
@@ -44,6 +44,7 @@
 #include <http/reqhandler.h>
 #include <http/rewriteengine.h>
 #include <http/serverprocessconfig.h>
+#include <http/shmmetrics.h>
 #include <http/smartsettings.h>
 #include <http/staticfilecache.h>
 #include <http/staticfilecachedata.h>
@@ -69,6 +70,7 @@
 #include <util/accessdef.h>
 #include <util/datetime.h>
 #include <util/gzipbuf.h>
+#include <util/zstdbuf.h>
 #include <util/httputil.h>
 #include <util/vmembuf.h>
 #include <util/blockbuf.h>
@@ -161,6 +163,7 @@ HttpSession::HttpSession()
     , m_iVHostAccess(0)
     , m_lockMtHolder(0)
     , m_pAiosfcb(NULL)
+    , m_pAuthTask(NULL)
     , m_sn(1)
     , m_pReqParser(NULL)
     , m_sessSeq(ls_atomic_add_fetch(&s_m_sessSeq, 1)) // ok to overflow / wrap around
@@ -399,6 +402,15 @@ const char * HttpSession::buildLogId()
 void HttpSession::logAccess(int cancelled)
 {
     HttpVHost *pVHost = (HttpVHost *) m_request.getVHost();
+    if (ShmMetrics::isEnabled() && (m_iFlag & HSF_SUB_SESSION) == 0
+        && m_request.getStatus() == HttpReq::HEADER_OK)
+    {
+        const HttpHandler *pHandler = m_request.getHttpHandler();
+        ShmMetrics::addRequest(
+            pVHost ? pVHost->getMetricsId() : ShmMetrics::VHOST_OTHER,
+            pHandler ? pHandler->getType() : HandlerType::HT_END,
+            getElapsedUs(), getResp()->getTotalLen());
+    }
     if (pVHost)
     {
         pVHost->decRef();
@@ -422,6 +434,13 @@ void HttpSession::logAccess(int cancelled)
 }
 
 
+long long HttpSession::getElapsedUs() const
+{
+    return (long long)(DateTime::s_curTime - m_lReqTime) * 1000000
+           + DateTime::s_curTimeUs - m_iReqTimeUs;
+}
+
+
 void HttpSession::incReqProcessed()
 {
     if (m_iFlag & HSF_SUB_SESSION)
@@ -1574,6 +1593,57 @@ int HttpSession::runExtAuthorizer(const HttpHandler *pHandler)
 }
 
 
+/**
+ * Called when a password verification handed to a worker thread by
+ * UserDir::authenticate() is done, picks up where processContextAuth()
+ * suspended the request.
+ */
+void HttpSession::authVerified(int ret)
+{
+    AAAData aaa;
+    int     satisfyAny;
+
+    cancelAuthVerify();
+    clearFlag(HSF_SUSPENDED);
+    if (!testFlag(HSF_REQ_BODY_DONE))
+        getStream()->wantRead(1);
+    if (ret)
+        LS_INFO(getLogSession(), "User '%s' failed to authenticate.",
+                m_request.getAuthUser());
+    else
+    {
+        LS_DBG_H(getLogSession(), "User '%s' authenticated.",
+                 m_request.getAuthUser());
+        addEnv("HttpAuth", 8, "1", 1);
+        m_request.getAAAData(aaa, satisfyAny);
+        if (aaa.m_pAuthorizer)
+            ret = runExtAuthorizer(aaa.m_pAuthorizer);
+        else
+        {
+            setProcessState(HSPS_HKPT_HTTP_AUTH);
+            smProcessReq();
+            return;
+        }
+    }
+    if (ret > 0)
+    {
+        setProcessState(HSPS_HTTP_ERROR);
+        if (getStream()->getState() < HIOS_SHUTDOWN)
+            httpError(ret);
+    }
+}
+
+
+void HttpSession::cancelAuthVerify()
+{
+    if (m_pAuthTask)
+    {
+        UserDir::releaseVerify(m_pAuthTask);
+        m_pAuthTask = NULL;
+    }
+}
+
+
 void HttpSession::authorized()
 {
     if (m_pHandler && cleanUpHandler(HSPS_HKPT_HTTP_AUTH) == LS_AGAIN)
@@ -2439,7 +2509,10 @@ int HttpSession::assignHandler(const HttpHandler *pHandler)
                 lockAddOrReplaceFrom(':', pType);
             }
             if (!HttpServerConfig::getInstance().getDynGzipCompress())
+            {
                 m_request.andGzip(~GZIP_ENABLED);
+                m_request.andZstd(~ZSTD_ENABLED);
+            }
             //m_response.reset();
             break;
         }
@@ -2898,6 +2971,7 @@ void HttpSession::releaseSsiRuntime()
 
 void HttpSession::releaseResources()
 {
+    cancelAuthVerify();
     if (m_pHandler)
     {
         if (cleanUpHandler(HSPS_RELEASE_RESOURCE))
@@ -2996,6 +3070,7 @@ void HttpSession::closeSession()
 
 void HttpSession::recycle()
 {
+    cancelAuthVerify();
     LS_DBG_M(getLogSession(), "calling removeSessionCb on this %p\n", this);
     EvtcbQue::getInstance().removeSessionCb(this);
 
@@ -3492,7 +3567,17 @@ int HttpSession::setupGzipFilter()
     else
         clearFlag(HSF_RESP_BODY_GZIPCOMPRESSED);
 
-    if (gz == GZIP_REQUIRED)
+    //a zstd body is not compressed again, and there is no zstd decoder
+    //for hooks needing the plain body.
+    if (m_request.zstdAcceptable() & UPSTREAM_ZSTD)
+        return 0;
+
+    //zstd is only done in the response body buffer, a hook that needs
+    //the plain body falls back to the gzip filter below.
+    int useZstd = (m_request.zstdAcceptable() == ZSTD_REQUIRED)
+                  && !(gz & (GZIP_OFF | UPSTREAM_GZIP | UPSTREAM_DEFLATE))
+                  && !hkptNogzip;
+    if (gz == GZIP_REQUIRED || useZstd)
     {
         if (!hkptNogzip)
         {
@@ -3501,7 +3586,7 @@ int HttpSession::setupGzipFilter()
             if (m_response.getContentLen() > 200 ||
                 m_response.getContentLen() < 0)
             {
-                if (setupGzipBuf() == -1)
+                if (setupGzipBuf(useZstd) == -1)
                     return LS_FAIL;
             }
         }
@@ -3519,42 +3604,72 @@ int HttpSession::setupGzipFilter()
 }
 
 
-int HttpSession::setupGzipBuf()
+int HttpSession::setupGzipBuf(int useZstd)
 {
     if (getRespBodyBuf())
     {
-        LS_DBG_L(getLogSession(), "GZIP the response body in the buffer.");
+        LS_DBG_L(getLogSession(), "%s the response body in the buffer.",
+                 useZstd ? "ZSTD" : "GZIP");
         if (getGzipBuf())
         {
             if (getGzipBuf()->isStreamStarted())
             {
                 getGzipBuf()->endStream();
-                LS_DBG_M(getLogSession(), "setupGzipBuf() end GZIP stream.\n");
+                LS_DBG_M(getLogSession(), "setupGzipBuf() end compression stream.\n");
             }
+#ifdef USE_ZSTD
+            if ((dynamic_cast<ZstdBuf *>(getGzipBuf()) != NULL) != (useZstd != 0))
+                releaseGzipBuf();
+#endif
         }
 
-        if (!getGzipBuf())
-            setGzipBuf(HttpResourceManager::getInstance().getGzipBuf());
+        int level;
+#ifdef USE_ZSTD
+        if (useZstd)
+        {
+            if (!getGzipBuf())
+                setGzipBuf(HttpResourceManager::getInstance().getZstdBuf());
+            level = HttpServerConfig::getInstance().getZstdCompressLevel();
+        }
+        else
+#endif
+        {
+            useZstd = 0;
+            if (!getGzipBuf())
+                setGzipBuf(HttpResourceManager::getInstance().getGzipBuf());
+            level = HttpServerConfig::getInstance().getCompressLevel();
+        }
         if (getGzipBuf())
         {
             getGzipBuf()->setCompressCache(getRespBodyBuf());
-            if ((getGzipBuf()->init(GzipBuf::COMPRESSOR_COMPRESS,
-                                  HttpServerConfig::getInstance().getCompressLevel()) == 0) &&
+            if ((getGzipBuf()->init(Compressor::COMPRESSOR_COMPRESS,
+                                    level) == 0) &&
                 (getGzipBuf()->beginStream() == 0))
             {
-                LS_DBG_M(getLogSession(), "setupGzipBuf() begin GZIP stream.\n");
+                LS_DBG_M(getLogSession(), "setupGzipBuf() begin %s stream.\n",
+                         useZstd ? "ZSTD" : "GZIP");
                 m_response.setContentLen(LSI_RSP_BODY_SIZE_UNKNOWN);
-                m_response.addGzipEncodingHeader();
-                m_request.orGzip(UPSTREAM_GZIP);
-                setFlag(HSF_RESP_BODY_GZIPCOMPRESSED);
+                if (useZstd)
+                {
+                    m_response.addZstdEncodingHeader();
+                    m_request.orZstd(UPSTREAM_ZSTD);
+                    setFlag(HSF_RESP_BODY_ZSTDCOMPRESSED);
+                }
+                else
+                {
+                    m_response.addGzipEncodingHeader();
+                    m_request.orGzip(UPSTREAM_GZIP);
+                    setFlag(HSF_RESP_BODY_GZIPCOMPRESSED);
+                }
                 return 0;
             }
             else
             {
                 LS_ERROR(getLogSession(), "Ran out of swapping space while "
-                         "initializing GZIP stream!");
+                         "initializing %s stream!", useZstd ? "ZSTD" : "GZIP");
                 delete getGzipBuf();
-                clearFlag(HSF_RESP_BODY_GZIPCOMPRESSED);
+                clearFlag(HSF_RESP_BODY_GZIPCOMPRESSED
+                          | HSF_RESP_BODY_ZSTDCOMPRESSED);
                 setGzipBuf(NULL);
             }
         }
@@ -3565,13 +3680,19 @@ int HttpSession::setupGzipBuf()
 
 void HttpSession::releaseGzipBuf()
 {
-    GzipBuf *pGzipBuf = getGzipBuf();
+    Compressor *pGzipBuf = getGzipBuf();
     if (pGzipBuf)
     {
+#ifdef USE_ZSTD
+        ZstdBuf *pZstdBuf = dynamic_cast<ZstdBuf *>(pGzipBuf);
+        if (pZstdBuf)
+            HttpResourceManager::getInstance().recycle(pZstdBuf);
+        else
+#endif
         if (pGzipBuf->getType() == GzipBuf::COMPRESSOR_COMPRESS)
-            HttpResourceManager::getInstance().recycle(pGzipBuf);
+            HttpResourceManager::getInstance().recycle((GzipBuf *)pGzipBuf);
         else
-            HttpResourceManager::getInstance().recycleGunzip(pGzipBuf);
+            HttpResourceManager::getInstance().recycleGunzip((GzipBuf *)pGzipBuf);
         setGzipBuf(NULL);
     }
 }
@@ -4470,6 +4591,12 @@ int HttpSession::sendRespHeaders()
         return 1;
     }
     setFlag(HSF_RESP_HEADER_SENT);
+    if (ShmMetrics::isEnabled() && !(m_iFlag & HSF_SUB_SESSION))
+    {
+        HttpVHost *pVHost = (HttpVHost *) m_request.getVHost();
+        ShmMetrics::addTtfb(pVHost ? pVHost->getMetricsId()
+                                   : ShmMetrics::VHOST_OTHER, getElapsedUs());
+    }
 
     if (LS_LOG_ENABLED(LOG4CXX_NS::Level::DBG_HIGH))
         m_response.getRespHeaders().dump(getLogSession(), 1);
@@ -4875,7 +5002,9 @@ int HttpSession::sendStaticFileEx(SendFileInfo *pData)
 #if !defined( NO_SENDFILE )
     int fd = pData->getfd();
     int iModeSF = HttpServerConfig::getInstance().getUseSendfile();
-    if (iModeSF && fd != -1 && !isHttps() && !getStream()->isSpdy()
+    if (iModeSF && fd != -1
+        && (!isHttps() || getStream()->isSendfileAvail())
+        && !getStream()->isSpdy()
         && (!getGzipBuf() ||
             (pData->getECache() == pData->getFileData()->getGzip())))
     {
@@ -5099,7 +5228,8 @@ void HttpSession::testContentType()
     if (!pValue)
         return;
     const MimeSetting *pMIME = NULL;
-    int canCompress = pReq->gzipAcceptable() | pReq->brAcceptable();
+    int canCompress = pReq->gzipAcceptable() | pReq->brAcceptable()
+                      | pReq->zstdAcceptable();
     HttpContext *pContext = &(pReq->getVHost()->getRootContext());
     const ExpiresCtrl *pExpireDefault = pReq->shouldAddExpires();
     int enbale = pContext->getExpires().isEnabled();
@@ -5125,6 +5255,7 @@ void HttpSession::testContentType()
     {
         pReq->andGzip(~GZIP_ENABLED);
         pReq->andBr(~BR_ENABLED);
+        pReq->andZstd(~ZSTD_ENABLED);
     }
 
     if (pReq->isKeepAlive())
@@ -5147,7 +5278,8 @@ int HttpSession::updateContentCompressible()
 {
     int compressible = 0;
     if ((m_request.gzipAcceptable() == GZIP_REQUIRED)
-        || (m_request.brAcceptable() == BR_REQUIRED))
+        || (m_request.brAcceptable() == BR_REQUIRED)
+        || (m_request.zstdAcceptable() == ZSTD_REQUIRED))
     {
         int len;
         char *pContentType = (char *)m_response.getRespHeaders().getHeader(
@@ -5163,6 +5295,7 @@ int HttpSession::updateContentCompressible()
         {
             m_request.andGzip(~GZIP_ENABLED);
             m_request.andBr(~BR_ENABLED);
+            m_request.andZstd(~ZSTD_ENABLED);
         }
     }
     return compressible;
@@ -5175,6 +5308,15 @@ int HttpSession::contentEncodingFixup()
     int requireChunk = 0;
     const char *pContentEncoding = m_response.getRespHeaders().getHeader(
                                        HttpRespHeaders::H_CONTENT_ENCODING, &len);
+    if (pContentEncoding && (m_request.zstdAcceptable() & UPSTREAM_ZSTD))
+    {
+        //our own zstd only goes to a client accepting it, a backend's
+        //cannot be decoded by the gzip filter and goes out as it is.
+        if (!(m_request.zstdAcceptable() & REQ_ZSTD_ACCEPT))
+            LS_DBG_L(getLogSession(), "zstd response body, client does not "
+                     "accept zstd.");
+        return 0;
+    }
     if ((!(m_request.gzipAcceptable() & REQ_GZIP_ACCEPT))
         && (!(m_request.brAcceptable() & REQ_BR_ACCEPT)))
     {
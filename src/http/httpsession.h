@@ -41,7 +41,7 @@ class ChunkInputStream;
 class ChunkOutputStream;
 class ExtWorker;
 class VMemBuf;
-class GzipBuf;
+class Compressor;
 class SsiBlock;
 class SsiRuntime;
 class SsiScript;
@@ -49,6 +49,7 @@ class SsiStack;
 class LsiApiHooks;
 class Aiosfcb;
 class ReqParser;
+struct ls_offload;
 class CallbackLinkedObj;
 class MtSessData;
 class MtParamUriQs;
@@ -155,6 +156,7 @@ enum HSPState
 #define HSF_SUSPENDED               (1<<20)
 
 #define HSF_RESUME_SSI              (1<<21)
+#define HSF_RESP_BODY_ZSTDCOMPRESSED    (1<<22)
 
 #define HSF_CHUNK_CLOSED            (1<<23)
 
@@ -237,6 +239,7 @@ class HttpSession
 
     AioReq                m_aioReq;
     Aiosfcb              *m_pAiosfcb;
+    struct ls_offload    *m_pAuthTask;
 
     uint32_t              m_sn;
     ReqParser            *m_pReqParser;
@@ -410,6 +413,7 @@ private:
     int processURI(int resume);
     int checkAuthentication(const HTAuth *pHTAuth,
                             const AuthRequired *pRequired, int resume);
+    void cancelAuthVerify();
 
     void logAccess(int cancelled);
     void incReqProcessed();
@@ -538,6 +542,7 @@ public:
 
     long getReqTime() const {   return m_lReqTime;  }
     int32_t getReqTimeUs() const    {   return m_iReqTimeUs;    }
+    long long getElapsedUs() const;
 
     int writeRespBodyDirect(const char *pBuf, int size);
     int writeRespBody(const char *pBuf, int len);
@@ -580,6 +585,8 @@ public:
 
     //void resumeAuthentication();
     void authorized();
+    void setAuthTask(struct ls_offload *pTask)  {   m_pAuthTask = pTask;    }
+    void authVerified(int ret);
 
     void addEnv(const char *pKey, int keyLen, const char *pValue, long valLen);
 
@@ -630,10 +637,10 @@ public:
 
     int useGzip();
     int setupGzipFilter();
-    int setupGzipBuf();
+    int setupGzipBuf(int useZstd);
     void releaseGzipBuf();
-    GzipBuf *getGzipBuf() const     {   return getResp()->getGzipBuf();     }
-    void setGzipBuf(GzipBuf *pGzip) {   getResp()->setGzipBuf(pGzip);       }
+    Compressor *getGzipBuf() const  {   return getResp()->getGzipBuf();     }
+    void setGzipBuf(Compressor *pGzip) {   getResp()->setGzipBuf(pGzip);    }
 
     int execExtCmd(const char *pCmd, int len, int mode = HSF_EXEC_EXT_CMD);
 
@@ -34,8 +34,10 @@
 #include <http/rewriterule.h>
 #include <http/rewritemap.h>
 #include <http/serverprocessconfig.h>
+#include <http/shmmetrics.h>
 #include <http/userdir.h>
 #include <http/staticfilecachedata.h>
+#include <http/vhostsslcache.h>
 #include <log4cxx/appender.h>
 #include <log4cxx/layout.h>
 #include <log4cxx/logger.h>
@@ -242,6 +244,7 @@ HttpVHost::HttpVHost(const char *pHostName)
     , m_pBytesLog(NULL)
     , m_iMaxKeepAliveRequests(100)
     , m_iSmartKeepAlive(0)
+    , m_iMetricsId(-1)
     , m_iFeatures(VH_ENABLE | VH_SERVER_ENABLE |
                   VH_ENABLE_SCRIPT | LS_ALWAYS_FOLLOW |
                   VH_GZIP)
@@ -258,6 +261,7 @@ HttpVHost::HttpVHost(const char *pHostName)
     , m_iGlobalMatchContext(1)
     , m_pRewriteMaps(NULL)
     , m_pSSLCtx(NULL)
+    , m_pLazySslCtx(NULL)
     , m_pSSITagConfig(NULL)
     , m_pRecaptcha(NULL)
     , m_PhpXmlNodeSSize(0)
@@ -301,6 +305,7 @@ HttpVHost::~HttpVHost()
         delete m_pAwstats;
     if (m_pSSLCtx)
         delete m_pSSLCtx;
+    setLazySslContext(NULL);
     m_pUrlStxFileHash->release_objects();
     delete m_pUrlStxFileHash;
     m_pUrlIdHash->release_objects();
@@ -309,6 +314,14 @@ HttpVHost::~HttpVHost()
 }
 
 
+int HttpVHost::getMetricsId()
+{
+    if (m_iMetricsId < 0)
+        m_iMetricsId = ShmMetrics::getVHostId(getName());
+    return m_iMetricsId;
+}
+
+
 int HttpVHost::setDocRoot(const char *psRoot)
 {
     assert(psRoot != NULL);
@@ -760,6 +773,33 @@ void HttpVHost::setSslContext(SslContext *pCtx)
 }
 
 
+void HttpVHost::setLazySslContext(LazySslContext *pLazy)
+{
+    if (pLazy == m_pLazySslCtx)
+        return;
+    if (m_pLazySslCtx)
+    {
+        VHostSslCache::getInstance().remove(m_pLazySslCtx);
+        delete m_pLazySslCtx;
+    }
+    m_pLazySslCtx = pLazy;
+}
+
+
+/**
+ * Returns the SslContext for a handshake, loading it through the
+ * VHostSslCache if the vhost certificate is loaded on demand.
+ */
+SslContext *HttpVHost::loadSslContext()
+{
+    if (m_pSSLCtx)
+        return m_pSSLCtx;
+    if (m_pLazySslCtx)
+        return VHostSslCache::getInstance().get(m_pLazySslCtx);
+    return NULL;
+}
+
+
 HTAuth *HttpVHost::configAuthRealm(HttpContext *pContext,
                                    const char *pRealmName)
 {
@@ -3219,9 +3259,20 @@ int HttpVHost::config(const XmlNode *pVhConfNode, int is_uid_set)
                                         p0, "enableQuic", 0, 1, 1);
 
         ConfigCtx currentCtx("ssl");
-        SslContext *pSSLCtx = ConfigCtx::getCurConfigCtx()->newSSLContext(p0, getName(), NULL);
-        if (pSSLCtx)
-            setSslContext(pSSLCtx);
+        if (VHostSslCache::isEnabled())
+        {
+            LazySslContext *pLazy =
+                ConfigCtx::getCurConfigCtx()->newLazySSLContext(p0, getName());
+            if (pLazy)
+                setLazySslContext(pLazy);
+        }
+        else
+        {
+            SslContext *pSSLCtx = ConfigCtx::getCurConfigCtx()->newSSLContext(
+                                      p0, getName(), NULL);
+            if (pSSLCtx)
+                setSslContext(pSSLCtx);
+        }
     }
     setFeature(VH_QUIC_LISTENER, enabledQuic);
 
@@ -84,6 +84,7 @@ class HttpHandler;
 class HttpMime;
 class HttpServerImpl;
 class HttpSession;
+class LazySslContext;
 class LocalWorker;
 class LocalWorkerConfig;
 class LsiApiHooks;
@@ -156,6 +157,7 @@ private:
 
     int16_t             m_iMaxKeepAliveRequests;
     int16_t             m_iSmartKeepAlive;
+    int16_t             m_iMetricsId;
 
     int                 m_iFeatures;
 
@@ -183,6 +185,7 @@ private:
     AutoStr2            m_sChroot;
     RewriteMapList     *m_pRewriteMaps;
     SslContext         *m_pSSLCtx;
+    LazySslContext     *m_pLazySslCtx;
     SsiTagConfig       *m_pSSITagConfig;
     LsiModuleData       m_moduleData;
     Recaptcha          *m_pRecaptcha;
@@ -221,6 +224,7 @@ public:
 //     void setIndexFileList(StringList * p)   {   m_rootContext.setIndexFileList( p );    }
 
     ReqStats *getReqStats()                {   return &m_reqStats;         }
+    int getMetricsId();
 
 
 //    int  setCustomErrUrls(int statusCode, const char* url)
@@ -445,6 +449,11 @@ public:
     SslContext *getSslContext() const
     {   return m_pSSLCtx;           }
 
+    void setLazySslContext(LazySslContext *pLazy);
+    LazySslContext *getLazySslContext() const
+    {   return m_pLazySslCtx;       }
+    SslContext *loadSslContext();
+
     HTAuth *configAuthRealm(HttpContext *pContext,
                             const char *pRealmName);
     int configContextAuth(HttpContext *pContext,
@@ -69,10 +69,14 @@ class HttpVHostMapImpl: public HashStringMap<HttpVHost *>
         {
             iter.second()->getReqStats()->finalizeRpt();
             int len = ls_snprintf(achBuf, 1024, "REQ_RATE [%s]: "
-                                  "REQ_PROCESSING: %d, REQ_PER_SEC: %d, TOT_REQS: %d\n",
+                                  "REQ_PROCESSING: %d, REQ_PER_SEC: %d, TOT_REQS: %d, "
+                                  "TOT_REWRITE_CACHE_HITS: %d, "
+                                  "TOT_REWRITE_CACHE_MISSES: %d\n",
                                   iter.first(), iter.second()->getRef(),
                                   iter.second()->getReqStats()->getRPS(),
-                                  iter.second()->getReqStats()->getTotal());
+                                  iter.second()->getReqStats()->getTotal(),
+                                  iter.second()->getReqStats()->getRewriteHits(),
+                                  iter.second()->getReqStats()->getRewriteMisses());
             iter.second()->getReqStats()->reset();
             if (::write(fd, achBuf, len) != len)
                 return LS_FAIL;
@@ -559,6 +559,29 @@ int NtwkIOLink::writevExSSL(LsiSession *pOS, const iovec *vector,
     int bufSize;
     int written;
 
+    if (pThis->m_ssl.isKtlsTx())
+    {
+        //kernel builds the records, no need to coalesce small buffers.
+        int finished;
+        ret = pThis->getSSL()->writev(vector, count, &finished);
+        LS_DBG_L(pThis, "kTLS writev() return %d!", ret);
+        if (ret > 0)
+        {
+            pThis->bytesSent(ret);
+            HttpStats::incSSLBytesWritten(ret);
+            pThis->setActiveTime(DateTime::s_curTime);
+            if (!finished)
+                pThis->updateSSLEvent();
+        }
+        else if ((ret == -1) && (pThis->getState() != HIOS_SHUTDOWN))
+        {
+            LS_DBG_L(pThis, "kTLS writev() failed: %s", strerror(errno));
+            pThis->setState(HIOS_CLOSING);
+            return LS_FAIL;
+        }
+        return ret;
+    }
+
     char *pBufEnd;
     char *pCurEnd;
     char achBuf[4096];
@@ -850,7 +873,7 @@ int NtwkIOLink::shutdown()
         shutdownSsl();
     LS_DBG_L(this, "Shutting down out-bound socket ...");
 
-    ::shutdown(getfd(), SHUT_WR);
+    MultiplexerFactory::getMultiplexer()->shutdownWrite(this);
     return 0;
 }
 
@@ -1051,7 +1074,7 @@ int NtwkIOLink::readEx(LsiSession *pIS, char *pBuf, int size)
     NtwkIOLink *pThis = static_cast<NtwkIOLink *>(pIS);
     int ret;
     assert(pBuf);
-    ret = ::read(pThis->getfd(), pBuf, size);
+    ret = MultiplexerFactory::getMultiplexer()->read(pThis, pBuf, size);
     ret = pThis->checkReadRet(ret, size);
 //    if ( ret > 0 )
 //        ::write( 1, pBuf, ret );
@@ -1069,6 +1092,9 @@ off_t NtwkIOLink::sendfileSetUp(off_t size)
         if (m_iHeaderToSend > 0)
             return 0;
     }
+    //data queued by the multiplexer goes out before the file
+    if (MultiplexerFactory::getMultiplexer()->flushWrite(this) == LS_FAIL)
+        return 0;
     ThrottleControl *pCtrl = getThrottleCtrl();
 
     if (pCtrl && !pCtrl->getThrottleOut()->isUnlimited())
@@ -1184,7 +1210,8 @@ int NtwkIOLink::aiosendfiledone(Aiosfcb *cb)
 int NtwkIOLink::writevEx(LsiSession *pOS, const iovec *vector, int count)
 {
     NtwkIOLink *pThis = static_cast<NtwkIOLink *>(pOS);
-    int len = ::writev(pThis->getfd(), vector, count);
+    int len = MultiplexerFactory::getMultiplexer()->writev(pThis, vector,
+              count);
     len = pThis->checkWriteRet(len);
     //if (pThis->wantWrite() && pThis->m_hasBufferedData)
     //    MultiplexerFactory::getMultiplexer()->continueWrite( pThis );
@@ -1373,7 +1400,7 @@ int NtwkIOLink::readExT(LsiSession *pIS, char *pBuf, int size)
     if (size > iQuota)
         size = iQuota;
     assert(pBuf);
-    int ret = ::read(pThis->getfd(), pBuf, size);
+    int ret = MultiplexerFactory::getMultiplexer()->read(pThis, pBuf, size);
     ret = pThis->checkReadRet(ret, size);
     if (ret > 0)
     {
@@ -1412,10 +1439,12 @@ int NtwkIOLink::writevExT(LsiSession *pOS, const iovec *vector, int count)
         IOVec iov;
         iov.append(vector, count);
         total = iov.shrinkTo(Quota, Quota >> 3);
-        len = ::writev(pThis->getfd(), iov.begin(), iov.len());
+        len = MultiplexerFactory::getMultiplexer()->writev(pThis, iov.begin(),
+                iov.len());
     }
     else
-        len = ::writev(pThis->getfd(), vector, count);
+        len = MultiplexerFactory::getMultiplexer()->writev(pThis, vector,
+                count);
 
     len = pThis->checkWriteRet(len);
     if (Quota - len < 10)
@@ -1652,6 +1681,18 @@ void NtwkIOLink::handle_acceptSSL_EIO_Err()
 
 void NtwkIOLink::enableTlsAccel()
 {
+    if (m_ssl.enableKtlsTx())
+    {
+        //HTTP/2 keeps sending DATA frames from its own buffer.
+        if (m_ssl.getSpdyVersion() == HIOS_PROTO_HTTP)
+        {
+            LS_DBG_L(this, "[SSL] kTLS TX enabled, use sendfile().");
+            setFlag(HIO_FLAG_SENDFILE, 1);
+        }
+        else
+            LS_DBG_L(this, "[SSL] kTLS TX enabled.");
+        return;
+    }
     m_ssl.setWriteBuffering(1);
 }
 
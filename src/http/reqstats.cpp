@@ -20,6 +20,8 @@
 ReqStats::ReqStats()
     : m_iReqPerSec(0)
     , m_iTotalReqs(0)
+    , m_iRewriteHits(0)
+    , m_iRewriteMisses(0)
 {
 }
 
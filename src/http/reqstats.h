@@ -24,6 +24,8 @@ class ReqStats
 {
     int     m_iReqPerSec;
     int     m_iTotalReqs;
+    int     m_iRewriteHits;
+    int     m_iRewriteMisses;
 
 
     ReqStats(const ReqStats &rhs);
@@ -36,6 +38,10 @@ public:
     int  getTotal() const   {   return m_iTotalReqs;    }
     void reset()            {   m_iReqPerSec = 0;       }
     void resetTotal()       {   m_iTotalReqs = 0;       }
+    void incRewriteHit()    {   ++m_iRewriteHits;       }
+    void incRewriteMiss()   {   ++m_iRewriteMisses;     }
+    int  getRewriteHits() const     {   return m_iRewriteHits;      }
+    int  getRewriteMisses() const   {   return m_iRewriteMisses;    }
     void finalizeRpt();
 
 };
@@ -28,6 +28,8 @@
 #include <http/rewritemap.h>
 #include <http/rewriterule.h>
 #include <http/rewriterulelist.h>
+#include <http/httpvhost.h>
+#include <http/reqstats.h>
 #include <log4cxx/logger.h>
 #include <lsr/ls_fileio.h>
 #include <util/accessdef.h>
@@ -49,8 +51,13 @@
 
 LS_SINGLETON(RewriteEngine);
 
+int RewriteEngine::s_iMemoSize = 2048;
+
 
 RewriteEngine::RewriteEngine()
+    : m_pScannedList(NULL)
+    , m_iMemoRedirStatus(-1)
+    , m_iMemoCtxState(0)
 {
 }
 
@@ -672,12 +679,35 @@ int RewriteEngine::processCond(const RewriteCond *pCond,
 }
 
 
+/**
+ * Returns 0 if the prefilter of the rule's list did not see the literal the
+ * rule pattern requires in the current URI, so the pattern cannot match.
+ */
+int RewriteEngine::mayMatch(const RewriteRule *pRule)
+{
+    const RewriteRuleList *pList = pRule->getPrefilter();
+    if (!pList)
+        return 1;
+    if (pList != m_pScannedList)
+    {
+        pList->scanLiterals(m_pSourceURL, m_sourceURLLen, m_achLiteralSeen);
+        m_pScannedList = pList;
+    }
+    int id = pRule->getLiteralId();
+    return RegexFilter::isSeen(id, m_achLiteralSeen);
+}
+
+
 int RewriteEngine::processRule(const RewriteRule *pRule,
                                HttpSession *pSession, AutoStr2 &cacheCtlStr)
 {
+    int ret;
     m_ruleMatches = 0;
-    int ret = pRule->getRegex()->exec(m_pSourceURL, m_sourceURLLen, 0,
+    if (mayMatch(pRule))
+        ret = pRule->getRegex()->exec(m_pSourceURL, m_sourceURLLen, 0,
                                       0, m_ruleVec, MAX_REWRITE_MATCH * 3);
+    else
+        ret = PCRE_ERROR_NOMATCH;
     if (m_logLevel > 1)
         LS_INFO(pSession->getLogSession(),
                 "[REWRITE] Rule: Match '%s' with pattern '%s', result: %d",
@@ -769,6 +799,7 @@ int RewriteEngine::processQueryString(HttpSession *pSession, int flag)
         m_qsLen = 0;
         m_qsBuf[m_qsLen] = 0;
         pSession->getReq()->orContextState(REWRITE_QSD);
+        m_iMemoCtxState |= REWRITE_QSD;
     }
     if (!pBuf)
         return 0;
@@ -935,8 +966,8 @@ int RewriteEngine::expandEnv(const RewriteRule *pRule,
                                 LS_INFO(pSession->getLogSession(),
                                         "[REWRITE] set cache vary value: '%s'",
                                         pValue);
-                            RequestVars::setEnv(pSession, "LSCACHE_VARY_VALUE", 
-                                                18, pValue, pValEnd - pValue);
+                            setEnv(pSession, "LSCACHE_VARY_VALUE", 18,
+                                   pValue, pValEnd - pValue);
                             //recover the pValue which need "vary="
                             pValue -= 5;
                         }
@@ -953,15 +984,15 @@ int RewriteEngine::expandEnv(const RewriteRule *pRule,
                         if (m_logLevel > 4)
                             LS_INFO(pSession->getLogSession(),
                                     "[REWRITE] set cache vary on: '%s'", pValue);
-                        RequestVars::setEnv(pSession, "LSCACHE_VARY_COOKIE", 19,
-                                            pValue, pValEnd - pValue);
+                        setEnv(pSession, "LSCACHE_VARY_COOKIE", 19,
+                               pValue, pValEnd - pValue);
                     }
                 }
                 
                 if (needSet)
                 {
-                    RequestVars::setEnv(pSession, pKey, pKeyEnd - pKey, pValue,
-                                        pValEnd - pValue);
+                    setEnv(pSession, pKey, pKeyEnd - pKey, pValue,
+                           pValEnd - pValue);
                     if (m_logLevel > 4)
                         LS_INFO(pSession->getLogSession(),
                                 "[REWRITE] add ENV: '%s:%s' ", pKey, pValue);
@@ -975,6 +1006,35 @@ int RewriteEngine::expandEnv(const RewriteRule *pRule,
 }
 
 
+static void appendEnvRecord(AutoBuf &buf, const char *pData, int len)
+{
+    buf.append((const char *)&len, sizeof(int));
+    buf.append(pData, len);
+}
+
+
+//sets an env variable for the request and records it for the memo
+void RewriteEngine::setEnv(HttpSession *pSession, const char *pKey,
+                           int keyLen, const char *pValue, int valLen)
+{
+    RequestVars::setEnv(pSession, pKey, keyLen, pValue, valLen);
+    appendEnvRecord(m_memoEnv, pKey, keyLen);
+    appendEnvRecord(m_memoEnv, pValue, valLen);
+}
+
+
+void RewriteEngine::addRedirectStatus(HttpSession *pSession, int code)
+{
+    const char *pCode;
+    if (!code)
+        pCode = "200";
+    else
+        pCode = HttpStatusCode::getInstance().getCodeString(code) + 1;
+    pSession->getReq()->addEnv("REDIRECT_STATUS", 15, pCode, 3);
+    m_iMemoRedirStatus = code;
+}
+
+
 int RewriteEngine::processRewrite(const RewriteRule *pRule,
                                   HttpSession *pSession, AutoStr2 &cacheCtlStr)
 {
@@ -1021,17 +1081,12 @@ int RewriteEngine::processRewrite(const RewriteRule *pRule,
         m_orgSourceURLLen = m_sourceURLLen;
         m_pSourceURL = pBuf;
         m_sourceURLLen = len;
+        m_pScannedList = NULL;
         m_iScriptLen = -1;
         m_iPathInfoLen = 0;
         if (flag & (RULE_FLAG_WITHQS | RULE_FLAG_QSDISCARD))
             processQueryString(pSession, flag);
-        const char *pCode;
-        if (!m_statusCode)
-            pCode = "200";
-        else
-            pCode = HttpStatusCode::getInstance().getCodeString(m_statusCode)
-                    + 1;
-        pSession->getReq()->addEnv("REDIRECT_STATUS", 15, pCode, 3);
+        addRedirectStatus(pSession, m_statusCode);
     }
     else if (m_logLevel > 0)
         LS_INFO(pSession->getLogSession(), "[REWRITE] No substition");
@@ -1089,6 +1144,235 @@ const RewriteRule *RewriteEngine::getNextRule(const RewriteRule *pRule,
 }
 
 
+//what the rule loop left behind, followed by the URL, the URL it was
+//rewritten from, the query string, the env variables set and the
+//cache-control value
+typedef struct rewrite_memo_state_s
+{
+    int                 m_iRuleIndex;   //-1 if the loop ran off the end
+    int                 m_iRuleFlag;
+    int                 m_iLoopCount;
+    int                 m_rewritten;
+    int                 m_flag;
+    int                 m_action;
+    int                 m_statusCode;
+    int                 m_iRedirStatus;
+    int                 m_iCtxState;
+    int                 m_urlLen;       //-1 if not rewritten
+    int                 m_orgURLLen;    //-1 if the URL the set started with
+    int                 m_qsLen;        //-1 if not changed
+    int                 m_envLen;
+    int                 m_cacheCtlLen;
+} rewrite_memo_state_t;
+
+
+/**
+ * A rule set can be memoized if none of its rules reads an input that is
+ * not part of the key, see RewriteRuleList::analyzeInputs(), and it does
+ * not continue into rules inherited from a parent context. Rewrite logging
+ * bypasses the memo so that every evaluation shows up in the log.
+ */
+int RewriteEngine::isMemoizable(const RewriteRuleList *pRuleList,
+                                const HttpContext *pContext,
+                                const HttpContext *pRootContext)
+{
+    if (!pRuleList || !pRuleList->isMemoizable() || m_logLevel > 0)
+        return 0;
+    if (m_memo.getSize() != s_iMemoSize)
+        m_memo.setSize(s_iMemoSize);
+    if (!m_memo.getSize())
+        return 0;
+    return getNextRule(pRuleList->getLastRule(), pContext,
+                       pRootContext) == NULL;
+}
+
+
+static char *appendKey(char *p, const char *pEnd, const void *pData, int len)
+{
+    if (!p || p + sizeof(int) + len > pEnd)
+        return NULL;
+    memcpy(p, &len, sizeof(int));
+    p += sizeof(int);
+    memcpy(p, pData, len);
+    return p + len;
+}
+
+
+/**
+ * Builds the key of a memoizable rule set from the serial of the rule list,
+ * the request URI, the URI the rules see, the query string, the rewrite
+ * base and the value of every variable the rules read. The serial changes
+ * whenever a list is compiled, entries of a released or reloaded list can
+ * never be hit again. Returns the length, 0 if too long.
+ */
+int RewriteEngine::buildMemoKey(const RewriteRuleList *pRuleList,
+                                HttpSession *pSession, char *pKey)
+{
+    HttpReq *pReq = pSession->getReq();
+    const char *pEnd = pKey + REWRITE_MEMO_MAX_KEY;
+    uint32_t serial = pRuleList->getSerial();
+    char *p = appendKey(pKey, pEnd, &serial, sizeof(serial));
+    p = appendKey(p, pEnd, pReq->getURI(), pReq->getURILen());
+    p = appendKey(p, pEnd, m_pSourceURL, m_sourceURLLen);
+    p = appendKey(p, pEnd, m_pQS, m_qsLen);
+    if (m_pBase)
+        p = appendKey(p, pEnd, m_pBase->c_str(), m_pBase->len());
+    else
+        p = appendKey(p, pEnd, "", 0);
+    for (int i = 0; p && i < pRuleList->getKeyItemCount(); ++i)
+    {
+        char *pValue = m_pCondBuf;
+        int len = getSubstValue(pRuleList->getKeyItem(i), pSession, pValue,
+                                REWRITE_BUF_SIZE);
+        p = appendKey(p, pEnd, pValue, len);
+    }
+    return p ? p - pKey : 0;
+}
+
+
+/**
+ * Puts the engine into the state the rule loop ended with when it was run
+ * for the same key, and replays what the rules did to the request.
+ */
+int RewriteEngine::restoreMemo(const char *pKey, int keyLen, uint64_t hash,
+                               const RewriteRuleList *pRuleList,
+                               HttpSession *pSession,
+                               const RewriteRule *&pRule, int &flag,
+                               int &loopCount, AutoStr2 &cacheCtlStr)
+{
+    int dataLen;
+    rewrite_memo_state_t st;
+    const char *pData = m_memo.find(pKey, keyLen, hash, dataLen);
+    if (!pData)
+        return 0;
+    memcpy(&st, pData, sizeof(st));
+    pData += sizeof(st);
+    pRule = NULL;
+    if (st.m_iRuleIndex >= 0)
+    {
+        pRule = pRuleList->begin();
+        for (int i = 0; pRule && i < st.m_iRuleIndex; ++i)
+            pRule = (const RewriteRule *)pRule->next();
+    }
+    flag = st.m_iRuleFlag;
+    loopCount = st.m_iLoopCount;
+    m_rewritten = st.m_rewritten;
+    m_flag = st.m_flag;
+    m_action = st.m_action;
+    m_statusCode = st.m_statusCode;
+    if (st.m_urlLen >= 0)
+    {
+        memcpy(m_pDestURL, pData, st.m_urlLen + 1);
+        pData += st.m_urlLen + 1;
+        if (st.m_orgURLLen >= 0)
+        {
+            memcpy(m_pFreeBuf, pData, st.m_orgURLLen + 1);
+            pData += st.m_orgURLLen + 1;
+            m_pOrgSourceURL = m_pFreeBuf;
+            m_orgSourceURLLen = st.m_orgURLLen;
+        }
+        m_pSourceURL = m_pDestURL;
+        m_sourceURLLen = st.m_urlLen;
+        m_pScannedList = NULL;
+    }
+    if (st.m_qsLen >= 0)
+    {
+        memcpy(m_qsBuf, pData, st.m_qsLen + 1);
+        pData += st.m_qsLen + 1;
+        m_pQS = m_qsBuf;
+        m_qsLen = st.m_qsLen;
+    }
+    const char *pEnvEnd = pData + st.m_envLen;
+    while (pData < pEnvEnd)
+    {
+        int len, valLen;
+        const char *pEnvKey;
+        memcpy(&len, pData, sizeof(int));
+        pEnvKey = pData + sizeof(int);
+        pData = pEnvKey + len;
+        memcpy(&valLen, pData, sizeof(int));
+        pData += sizeof(int);
+        RequestVars::setEnv(pSession, pEnvKey, len, pData, valLen);
+        pData += valLen;
+    }
+    if (st.m_cacheCtlLen > 0)
+        cacheCtlStr.setStr(pData, st.m_cacheCtlLen);
+    if (st.m_iRedirStatus != -1)
+        addRedirectStatus(pSession, st.m_iRedirStatus);
+    if (st.m_iCtxState)
+        pSession->getReq()->orContextState(st.m_iCtxState);
+    return 1;
+}
+
+
+void RewriteEngine::storeMemo(const char *pKey, int keyLen, uint64_t hash,
+                              const RewriteRuleList *pRuleList,
+                              const RewriteRule *pRule, int flag,
+                              int loopCount, const char *pSourceURL,
+                              const AutoStr2 &cacheCtlStr)
+{
+    char achData[REWRITE_MEMO_MAX_DATA];
+    rewrite_memo_state_t st;
+    char *p = achData + sizeof(st);
+    const char *pEnd = achData + sizeof(achData);
+    st.m_iRuleIndex = -1;
+    if (pRule)
+    {
+        const RewriteRule *pCur = pRuleList->begin();
+        for (st.m_iRuleIndex = 0; pCur && pCur != pRule; ++st.m_iRuleIndex)
+            pCur = (const RewriteRule *)pCur->next();
+        if (!pCur)
+            return;
+    }
+    st.m_iRuleFlag = flag;
+    st.m_iLoopCount = loopCount;
+    st.m_rewritten = m_rewritten;
+    st.m_flag = m_flag;
+    st.m_action = m_action;
+    st.m_statusCode = m_statusCode;
+    st.m_iRedirStatus = m_iMemoRedirStatus;
+    st.m_iCtxState = m_iMemoCtxState;
+    st.m_urlLen = st.m_orgURLLen = st.m_qsLen = -1;
+    if (m_rewritten & 2)
+    {
+        if (p + m_sourceURLLen + 1 > pEnd)
+            return;
+        memcpy(p, m_pSourceURL, m_sourceURLLen);
+        p += m_sourceURLLen;
+        *p++ = 0;
+        st.m_urlLen = m_sourceURLLen;
+        if (m_pOrgSourceURL != pSourceURL)
+        {
+            if (p + m_orgSourceURLLen + 1 > pEnd)
+                return;
+            memcpy(p, m_pOrgSourceURL, m_orgSourceURLLen);
+            p += m_orgSourceURLLen;
+            *p++ = 0;
+            st.m_orgURLLen = m_orgSourceURLLen;
+        }
+    }
+    if (m_pQS == m_qsBuf)
+    {
+        if (p + m_qsLen + 1 > pEnd)
+            return;
+        memcpy(p, m_pQS, m_qsLen);
+        p += m_qsLen;
+        *p++ = 0;
+        st.m_qsLen = m_qsLen;
+    }
+    st.m_envLen = m_memoEnv.size();
+    st.m_cacheCtlLen = cacheCtlStr.len();
+    if (p + st.m_envLen + st.m_cacheCtlLen > pEnd)
+        return;
+    memcpy(p, m_memoEnv.begin(), st.m_envLen);
+    p += st.m_envLen;
+    memcpy(p, cacheCtlStr.c_str(), st.m_cacheCtlLen);
+    p += st.m_cacheCtlLen;
+    memcpy(achData, &st, sizeof(st));
+    m_memo.store(pKey, keyLen, hash, achData, p - achData);
+}
+
+
 int RewriteEngine::processRuleSet(const RewriteRuleList *pRuleList,
                                   HttpSession *pSession,
                                   const HttpContext *pContext, const HttpContext *pRootContext)
@@ -1169,6 +1453,7 @@ int RewriteEngine::processRuleSet(const RewriteRuleList *pRuleList,
 
     m_pOrgSourceURL = m_pSourceURL;
     m_orgSourceURLLen = m_sourceURLLen;
+    m_pScannedList = NULL;
 
     m_condMatches = 0;
     m_pDestURLLen = 0;
@@ -1178,9 +1463,33 @@ int RewriteEngine::processRuleSet(const RewriteRuleList *pRuleList,
     m_action   = RULE_ACTION_NONE;
     m_flag     = 0;
     m_statusCode = 0;
+    m_iMemoRedirStatus = -1;
+    m_iMemoCtxState = 0;
+    m_memoEnv.clear();
     AutoStr2 cacheCtlStr = "";
-    
-    
+
+    char achMemoKey[REWRITE_MEMO_MAX_KEY];
+    int memoKeyLen = 0;
+    uint64_t memoHash = 0;
+    const char *pStartURL = m_pSourceURL;
+    if (isMemoizable(pRuleList, pContext, pRootContext))
+        memoKeyLen = buildMemoKey(pRuleList, pSession, achMemoKey);
+    if (memoKeyLen > 0)
+    {
+        HttpVHost *pVHost = pReq->getVHost();
+        memoHash = RewriteMemo::hashKey(achMemoKey, memoKeyLen);
+        if (restoreMemo(achMemoKey, memoKeyLen, memoHash, pRuleList,
+                        pSession, pRule, flag, loopCount, cacheCtlStr))
+        {
+            if (pVHost)
+                pVHost->getReqStats()->incRewriteHit();
+            memoKeyLen = 0;
+            goto RULES_DONE;
+        }
+        if (pVHost)
+            pVHost->getReqStats()->incRewriteMiss();
+    }
+
     while (pRule)
     {
         flag = pRule->getFlag();
@@ -1216,6 +1525,7 @@ int RewriteEngine::processRuleSet(const RewriteRuleList *pRuleList,
                     LS_INFO(pSession->getLogSession(),
                             "[REWRITE] End rewrite!");
                 pSession->getReq()->orContextState(SKIP_REWRITE);
+                m_iMemoCtxState |= SKIP_REWRITE;
             }
             break;
         }
@@ -1251,7 +1561,17 @@ NEXT_RULE:
             --n;
         }
     }
-    
+
+RULES_DONE:
+    //only the first pass is a function of the key, going back to the rules
+    //after a redirect loop is detected depends on the redirect history
+    if (memoKeyLen > 0)
+    {
+        storeMemo(achMemoKey, memoKeyLen, memoHash, pRuleList, pRule, flag,
+                  loopCount, pStartURL, cacheCtlStr);
+        memoKeyLen = 0;
+    }
+
     if (cacheCtlStr.len() > 0)
     {
         if (m_logLevel > 4)
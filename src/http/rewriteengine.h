@@ -22,6 +22,9 @@
 
 #include <lsdef.h>
 #include <http/httpdefs.h>
+#include <http/rewritememo.h>
+#include <http/rewriterulelist.h>
+#include <util/autobuf.h>
 #include <util/tsingleton.h>
 
 #include <sys/stat.h>
@@ -32,7 +35,6 @@
 class AutoStr2;
 class RewriteCond;
 class RewriteRule;
-class RewriteRuleList;
 class RewriteMapList;
 class RewriteSubstItem;
 class RewriteSubstFormat;
@@ -80,6 +82,18 @@ class RewriteEngine : public TSingleton<RewriteEngine>
     char            m_rewriteBuf[3][REWRITE_BUF_SIZE];
     char            m_qsBuf[REWRITE_BUF_SIZE];
 
+    //prefilter literals present in m_pSourceURL, valid for m_pScannedList
+    const RewriteRuleList *m_pScannedList;
+    unsigned char   m_achLiteralSeen[REGEX_FILTER_MAX_LITERALS / 8];
+
+    RewriteMemo     m_memo;
+    //side effects of the rules on the request, replayed on a memo hit
+    int             m_iMemoRedirStatus;
+    int             m_iMemoCtxState;
+    AutoBuf         m_memoEnv;
+
+    static int      s_iMemoSize;
+
     RewriteEngine();
 
     int processQueryString(HttpSession *pSession, int flag);
@@ -91,6 +105,23 @@ class RewriteEngine : public TSingleton<RewriteEngine>
     char *buildString(const RewriteSubstFormat *pFormat, HttpSession *pSession,
                       char *pBuf, int &len, int esc_uri = 0, int noDupSlash = 0);
     int processCond(const RewriteCond *pCond, HttpSession *pSession);
+    int mayMatch(const RewriteRule *pRule);
+    void addRedirectStatus(HttpSession *pSession, int code);
+    int isMemoizable(const RewriteRuleList *pRuleList,
+                     const HttpContext *pContext,
+                     const HttpContext *pRootContext);
+    int buildMemoKey(const RewriteRuleList *pRuleList, HttpSession *pSession,
+                     char *pKey);
+    int restoreMemo(const char *pKey, int keyLen, uint64_t hash,
+                    const RewriteRuleList *pRuleList, HttpSession *pSession,
+                    const RewriteRule *&pRule, int &flag, int &loopCount,
+                    AutoStr2 &cacheCtlStr);
+    void storeMemo(const char *pKey, int keyLen, uint64_t hash,
+                   const RewriteRuleList *pRuleList, const RewriteRule *pRule,
+                   int flag, int loopCount, const char *pSourceURL,
+                   const AutoStr2 &cacheCtlStr);
+    void setEnv(HttpSession *pSession, const char *pKey, int keyLen,
+                const char *pValue, int valLen);
     int processRule(const RewriteRule *pRule, HttpSession *pSession,
                     AutoStr2 &cacheCtlStr);
     int processRewrite(const RewriteRule *pRule, HttpSession *pSession,
@@ -108,6 +139,7 @@ public:
                                HttpContext *pContext);
     static int parseRules(char *&pRules, RewriteRuleList *pRuleList,
                           const RewriteMapList *pMapList, HttpContext *pContext);
+    static void setMemoSize(int slots)  {   s_iMemoSize = slots;    }
     int processRuleSet(const RewriteRuleList *pRuleList, HttpSession *pSession,
                        const HttpContext *pContext, const HttpContext *pRootContext);
     const char *getResultURI()     {   return m_pSourceURL;    }
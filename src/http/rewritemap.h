@@ -83,6 +83,7 @@ public:
 
     void setName(const char *pName)  {   m_sName.setStr(pName);    }
     const char *getName() const        {   return m_sName.c_str();     }
+    int getType() const                {   return m_type;              }
 
     int parseType_Source(const char *pSource);
     int lookup(const char *pKey, int keyLen, char *pValue, int valLen);
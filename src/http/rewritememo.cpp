@@ -0,0 +1,136 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "rewritememo.h"
+
+#include <lsr/xxhash.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef struct memo_entry_s
+{
+    uint64_t    m_hash;
+    int         m_keyLen;
+    int         m_dataLen;
+    char        m_achBuf[1];    //key followed by data
+} memo_entry_t;
+
+
+RewriteMemo::RewriteMemo()
+    : m_pSlots(NULL)
+    , m_iSlots(0)
+    , m_iCount(0)
+{
+}
+
+
+RewriteMemo::~RewriteMemo()
+{
+    clear();
+    if (m_pSlots)
+        free(m_pSlots);
+}
+
+
+uint64_t RewriteMemo::hashKey(const char *pKey, int keyLen)
+{
+    return XXH64(pKey, keyLen, 0);
+}
+
+
+/**
+ * Sets the number of slots, rounded down to a power of 2; 0 disables the
+ * cache. Cached results are dropped.
+ */
+int RewriteMemo::setSize(int slots)
+{
+    int n = 1;
+    clear();
+    if (m_pSlots)
+    {
+        free(m_pSlots);
+        m_pSlots = NULL;
+    }
+    m_iSlots = 0;
+    if (slots <= 0)
+        return LS_OK;
+    while (n * 2 <= slots)
+        n *= 2;
+    m_pSlots = (memo_entry_t **)calloc(n, sizeof(memo_entry_t *));
+    if (!m_pSlots)
+        return LS_FAIL;
+    m_iSlots = n;
+    return LS_OK;
+}
+
+
+const char *RewriteMemo::find(const char *pKey, int keyLen, uint64_t hash,
+                              int &dataLen) const
+{
+    if (!m_iSlots)
+        return NULL;
+    memo_entry_t *pEntry = m_pSlots[hash & (m_iSlots - 1)];
+    if (!pEntry || pEntry->m_hash != hash || pEntry->m_keyLen != keyLen
+        || memcmp(pEntry->m_achBuf, pKey, keyLen) != 0)
+        return NULL;
+    dataLen = pEntry->m_dataLen;
+    return pEntry->m_achBuf + keyLen;
+}
+
+
+int RewriteMemo::store(const char *pKey, int keyLen, uint64_t hash,
+                       const char *pData, int dataLen)
+{
+    if (!m_iSlots || keyLen > REWRITE_MEMO_MAX_KEY
+        || dataLen > REWRITE_MEMO_MAX_DATA)
+        return LS_FAIL;
+    memo_entry_t **pSlot = &m_pSlots[hash & (m_iSlots - 1)];
+    memo_entry_t *pEntry = *pSlot;
+    if (!pEntry || pEntry->m_keyLen + pEntry->m_dataLen < keyLen + dataLen)
+    {
+        pEntry = (memo_entry_t *)realloc(pEntry, sizeof(memo_entry_t)
+                                         + keyLen + dataLen);
+        if (!pEntry)
+            return LS_FAIL;
+        if (!*pSlot)
+            ++m_iCount;
+        *pSlot = pEntry;
+    }
+    pEntry->m_hash = hash;
+    pEntry->m_keyLen = keyLen;
+    pEntry->m_dataLen = dataLen;
+    memcpy(pEntry->m_achBuf, pKey, keyLen);
+    memcpy(pEntry->m_achBuf + keyLen, pData, dataLen);
+    return LS_OK;
+}
+
+
+void RewriteMemo::clear()
+{
+    for (int i = 0; i < m_iSlots; ++i)
+    {
+        if (m_pSlots[i])
+        {
+            free(m_pSlots[i]);
+            m_pSlots[i] = NULL;
+        }
+    }
+    m_iCount = 0;
+}
+
@@ -0,0 +1,63 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef REWRITEMEMO_H
+#define REWRITEMEMO_H
+
+#include <lsdef.h>
+
+#include <inttypes.h>
+
+//entries with a longer key or result are not cached
+#define REWRITE_MEMO_MAX_KEY    2048
+#define REWRITE_MEMO_MAX_DATA   8192
+
+
+/**
+ * A size-bounded cache of rewrite results, keyed on everything a rule set
+ * reads. It is direct mapped: a new result replaces whatever was stored in
+ * its slot, so the number of entries never exceeds the number of slots.
+ * Each worker process has its own, no locking.
+ */
+class RewriteMemo
+{
+public:
+    RewriteMemo();
+    ~RewriteMemo();
+
+    static uint64_t hashKey(const char *pKey, int keyLen);
+
+    int  setSize(int slots);
+    int  getSize() const        {   return m_iSlots;    }
+    int  getCount() const       {   return m_iCount;    }
+
+    //returns the stored result, its length in dataLen, NULL on a miss
+    const char *find(const char *pKey, int keyLen, uint64_t hash,
+                     int &dataLen) const;
+    int  store(const char *pKey, int keyLen, uint64_t hash,
+               const char *pData, int dataLen);
+    void clear();
+
+private:
+    struct memo_entry_s   **m_pSlots;
+    int                     m_iSlots;
+    int                     m_iCount;
+
+    LS_NO_COPY_ASSIGN(RewriteMemo);
+};
+
+#endif // REWRITEMEMO_H
@@ -562,6 +562,8 @@ RewriteRule::RewriteRule()
     , m_flag(0)
     , m_statusCode(0)
     , m_skipRules(0)
+    , m_pPrefilter(NULL)
+    , m_iLiteral(-1)
 {
 }
 
@@ -577,6 +579,8 @@ RewriteRule::RewriteRule(const RewriteRule &rhs)
     , m_skipRules(rhs.m_skipRules)
     , m_env(rhs.m_env)
     , m_pattern(rhs.m_pattern)
+    , m_pPrefilter(NULL)
+    , m_iLiteral(-1)
 {
     compilePattern();
 }
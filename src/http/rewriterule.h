@@ -81,6 +81,7 @@ END_LOG4CXX_NS
 
 class RewriteMap;
 class RewriteMapList;
+class RewriteRuleList;
 class MapRefItem;
 
 
@@ -191,6 +192,8 @@ class RewriteRule : public LinkedObj
     int                         m_skipRules;
     TLinkList<RewriteSubstFormat> m_env;
     AutoStr                     m_pattern;
+    const RewriteRuleList      *m_pPrefilter;
+    int                         m_iLiteral;
 
 
     int parseRuleSubst(const char *&pRuleStr, const char *pEnd,
@@ -221,6 +224,14 @@ public:
     const TLinkList<RewriteSubstFormat> *getEnv() const
     {   return &m_env;      }
     const char *getPattern() const {   return m_pattern.c_str();   }
+
+    //the list whose prefilter tells if the literal required by the
+    //pattern is in the URI, NULL if the pattern has to be run regardless
+    const RewriteRuleList *getPrefilter() const {   return m_pPrefilter;    }
+    int     getLiteralId() const        {   return m_iLiteral;              }
+    void    setLiteral(const RewriteRuleList *pList, int id)
+    {   m_pPrefilter = pList;   m_iLiteral = id;    }
+
     int parseCookieAction(const char *pRuleStr, const char *pEnd);
     static void setLogger(LOG4CXX_NS::Logger *pLogger, const char *pId);
     static void error(const char *pError);
@@ -18,11 +18,259 @@
 #include "rewriterulelist.h"
 #include "rewriterule.h"
 
+#include <lsdef.h>
+#include <http/requestvars.h>
+#include <http/rewritemap.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+
+uint32_t RewriteRuleList::s_iSerial = 0;
+
+
 RewriteRuleList::RewriteRuleList()
+    : m_pPrefilter(NULL)
+    , m_pKeyItems(NULL)
+    , m_iKeyItems(0)
+    , m_iMemoizable(0)
+    , m_pLastRule(NULL)
+    , m_iSerial(++s_iSerial)
 {}
 
 RewriteRuleList::~RewriteRuleList()
 {
     release_objects();
+    if (m_pPrefilter)
+        delete m_pPrefilter;
+    if (m_pKeyItems)
+        free(m_pKeyItems);
+}
+
+
+/**
+ * Prepares a parsed rule list for request processing, must be called once
+ * all rules are added.
+ */
+int RewriteRuleList::compile()
+{
+    m_iSerial = ++s_iSerial;
+    buildPrefilter();
+    analyzeInputs();
+    return 0;
+}
+
+
+//1 if a variable can be part of a memo key, 0 if a rule set reading it has
+//to be evaluated every time, -1 if it is not a request input
+static int memoInput(int type)
+{
+    if (type < REF_STRING)
+        return 1;
+    switch (type)
+    {
+    case REF_STRING:
+    case REF_RULE_SUBSTR:
+    case REF_COND_SUBSTR:
+        return -1;
+    case REF_ENV:
+    case REF_HTTP_HEADER:
+    case REF_REMOTE_ADDR:
+    case REF_REMOTE_HOST:
+    case REF_REMOTE_USER:
+    case REF_REMOTE_IDENT:
+    case REF_REQ_METHOD:
+    case REF_QUERY_STRING:
+    case REF_AUTH_TYPE:
+    case REF_REQ_URI:
+    case REF_DOC_ROOT:
+    case REF_SERVER_ADMIN:
+    case REF_SERVER_NAME:
+    case REF_SERVER_ADDR:
+    case REF_SERVER_PORT:
+    case REF_SERVER_PROTO:
+    case REF_SERVER_SOFT:
+    case REF_API_VERSION:
+    case REF_REQ_LINE:
+    case REF_IS_SUBREQ:
+    case REF_CUR_REWRITE_URI:
+    case REF_ORG_REQ_URI:
+    case REF_ORG_QS:
+    case REF_HTTPS:
+    case REF_PID:
+    case REF_CUR_URI:
+    case REF_VH_CNAME:
+    case REF_COOKIE_VAL:
+    case REF_QS_UNESCAPED:
+        return 1;
+    default:
+        //time, file system, connection and response variables
+        return 0;
+    }
+}
+
+
+static int sameInput(const RewriteSubstItem *p1, const RewriteSubstItem *p2)
+{
+    if (p1->getType() != p2->getType())
+        return 0;
+    if (p1->getType() == REF_ENV || p1->getType() == REF_HTTP_HEADER)
+        return strcasecmp(p1->getStr()->c_str(), p2->getStr()->c_str()) == 0;
+    return 1;
 }
 
+
+int RewriteRuleList::addKeyItems(const RewriteSubstFormat *pFormat,
+                                 int &maxItems)
+{
+    if (!pFormat)
+        return LS_OK;
+    for (const RewriteSubstItem *pItem = pFormat->begin(); pItem;
+         pItem = (const RewriteSubstItem *)pItem->next())
+    {
+        if (pItem->getType() == REF_MAP)
+        {
+            const MapRefItem *pRef = pItem->getMapRef();
+            if (pRef->getMap()->getType() == RewriteMap::TYPE_RND
+                || pRef->getMap()->getType() == RewriteMap::TYPE_PRG
+                || addKeyItems(pRef->getKeyFormat(), maxItems) == LS_FAIL
+                || addKeyItems(pRef->getDefaultFormat(), maxItems) == LS_FAIL)
+                return LS_FAIL;
+            continue;
+        }
+        int ret = memoInput(pItem->getType());
+        if (ret == 0)
+            return LS_FAIL;
+        if (ret == -1)
+            continue;
+        int i;
+        for (i = 0; i < m_iKeyItems; ++i)
+            if (sameInput(m_pKeyItems[i], pItem))
+                break;
+        if (i < m_iKeyItems)
+            continue;
+        if (m_iKeyItems == maxItems)
+        {
+            maxItems = maxItems ? maxItems * 2 : 8;
+            const RewriteSubstItem **pItems = (const RewriteSubstItem **)
+                realloc(m_pKeyItems, maxItems * sizeof(RewriteSubstItem *));
+            if (!pItems)
+                return LS_FAIL;
+            m_pKeyItems = pItems;
+        }
+        m_pKeyItems[m_iKeyItems++] = pItem;
+    }
+    return LS_OK;
+}
+
+
+/**
+ * Finds out whether the result of the rule set is a function of the URI,
+ * the query string and the variables it reads, and collects the latter.
+ * Env values are part of the result, the engine records and replays them.
+ * Rules setting cookies, a forced type or a proxy host, conditions testing
+ * the file system, and time or RND/PRG map lookups make the set not
+ * memoizable.
+ */
+int RewriteRuleList::analyzeInputs()
+{
+    int maxItems = 0;
+    m_iMemoizable = 0;
+    m_iKeyItems = 0;
+    m_pLastRule = NULL;
+    for (RewriteRule *pRule = begin(); pRule;
+         pRule = (RewriteRule *)pRule->next())
+    {
+        m_pLastRule = pRule;
+        if (pRule->getMimeType()
+            || addKeyItems(pRule->getTargetFmt(), maxItems) == LS_FAIL)
+            return 0;
+        for (const RewriteSubstFormat *pEnv = pRule->getEnv()->begin(); pEnv;
+             pEnv = (const RewriteSubstFormat *)pEnv->next())
+        {
+            //Proxy-Host changes the request host
+            if (pEnv->isCookie() || pRule->getAction() == RULE_ACTION_PROXY
+                || addKeyItems(pEnv, maxItems) == LS_FAIL)
+                return 0;
+        }
+        for (const RewriteCond *pCond = pRule->getFirstCond(); pCond;
+             pCond = (const RewriteCond *)pCond->next())
+        {
+            switch (pCond->getOpcode())
+            {
+            case COND_OP_REGEX:
+            case COND_OP_LESS:
+            case COND_OP_GREATER:
+            case COND_OP_EQ:
+                break;
+            default:
+                return 0;
+            }
+            if (addKeyItems(pCond->getTestStringFormat(), maxItems) == LS_FAIL)
+                return 0;
+        }
+    }
+    m_iMemoizable = (m_pLastRule != NULL);
+    return m_iMemoizable;
+}
+
+
+/**
+ * Builds a RegexFilter over the rule patterns and tells every rule with a
+ * required literal which one to check before running its pattern.
+ */
+int RewriteRuleList::buildPrefilter()
+{
+    RewriteRule *pRule;
+    int count = 0;
+    for (pRule = begin(); pRule; pRule = (RewriteRule *)pRule->next())
+    {
+        pRule->setLiteral(NULL, -1);
+        ++count;
+    }
+    if (m_pPrefilter)
+    {
+        delete m_pPrefilter;
+        m_pPrefilter = NULL;
+    }
+    if (count < REWRITE_PREFILTER_MIN_RULES)
+        return 0;
+
+    const char **pPatterns = (const char **)malloc(count * sizeof(char *));
+    if (!pPatterns)
+        return LS_FAIL;
+    int n = 0;
+    for (pRule = begin(); pRule; pRule = (RewriteRule *)pRule->next())
+        pPatterns[n++] = pRule->getPattern();
+    RegexFilter *pFilter = new RegexFilter();
+    int literals = pFilter ? pFilter->build(pPatterns, count) : LS_FAIL;
+    free(pPatterns);
+    if (literals <= 0)
+    {
+        delete pFilter;
+        return literals;
+    }
+    m_pPrefilter = pFilter;
+    n = 0;
+    for (pRule = begin(); pRule; pRule = (RewriteRule *)pRule->next())
+    {
+        int id = pFilter->getLiteralId(n++);
+        if (id != -1)
+            pRule->setLiteral(this, id);
+    }
+    return literals;
+}
+
+
+/**
+ * Sets the bit of every prefilter literal found in the URI, pSeen must
+ * hold REGEX_FILTER_MAX_LITERALS bits.
+ */
+void RewriteRuleList::scanLiterals(const char *pURI, int len,
+                                   unsigned char *pSeen) const
+{
+    if (m_pPrefilter)
+        m_pPrefilter->scan(pURI, len, pSeen);
+    else
+        memset(pSeen, 0, REGEX_FILTER_MAX_LITERALS / 8);
+}
@@ -20,14 +20,52 @@
 
 
 
+#include <util/regexfilter.h>
 #include <util/tlinklist.h>
 
+#include <inttypes.h>
+
+#define REWRITE_PREFILTER_MIN_RULES 4
+
 class RewriteRule;
+class RewriteSubstFormat;
+class RewriteSubstItem;
 class RewriteRuleList : public TLinkList< RewriteRule >
 {
+    RegexFilter *m_pPrefilter;
+
+    //inputs a memoizable rule set reads besides the URI and query string
+    const RewriteSubstItem **m_pKeyItems;
+    int     m_iKeyItems;
+    int     m_iMemoizable;
+    const RewriteRule *m_pLastRule;
+    //changes every time the list is compiled, memo keys refer to it
+    uint32_t m_iSerial;
+
+    static uint32_t s_iSerial;
+
+    int addKeyItems(const RewriteSubstFormat *pFormat, int &maxItems);
+    int analyzeInputs();
+
+    RewriteRuleList(const RewriteRuleList &rhs);
+    void operator=(const RewriteRuleList &rhs);
 public:
     RewriteRuleList();
     ~RewriteRuleList();
+
+    int compile();
+
+    int isMemoizable() const    {   return m_iMemoizable;   }
+    int getKeyItemCount() const {   return m_iKeyItems;     }
+    const RewriteSubstItem *getKeyItem(int i) const
+    {   return m_pKeyItems[i];  }
+    const RewriteRule *getLastRule() const  {   return m_pLastRule; }
+    uint32_t getSerial() const  {   return m_iSerial;       }
+
+    int buildPrefilter();
+    int hasPrefilter() const    {   return m_pPrefilter != NULL;    }
+    void scanLiterals(const char *pURI, int len,
+                      unsigned char *pSeen) const;
 };
 
 #endif
@@ -101,13 +101,10 @@ int SendFileInfo::readyCacheData(char compress, char mode)
     
     if ((compress) && (m_pFileData->getMimeType()->getExpires()->compressible()))
     {
-        ret = m_pFileData->readyCompressed(mode);
-        if (ret == 0)
+        FileCacheDataEx *pCompressed = m_pFileData->readyCompressed(mode);
+        if (pCompressed)
         {
-            if ((mode & SFCD_MODE_BROTLI) && (m_pFileData->getBrotli() != NULL))
-                setECache(m_pFileData->getBrotli());
-            else
-                setECache(m_pFileData->getGzip());
+            setECache(pCompressed);
             return 0;
         }
     }
@@ -0,0 +1,481 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "shmmetrics.h"
+
+#include <log4cxx/logger.h>
+#include <lsr/ls_atomic.h>
+#include <util/autobuf.h>
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+enum
+{
+    NAME_EMPTY,
+    NAME_WRITING,
+    NAME_READY,
+};
+
+typedef struct metrics_name_s
+{
+    int32_t     state;
+    char        name[METRICS_VHOST_NAME_LEN];
+} metrics_name_t;
+
+struct metrics_shm_s
+{
+    int32_t         slots;
+    int32_t         unused;
+    metrics_name_t  names[METRICS_MAX_VHOSTS];
+    metrics_slot_t  slot[1];
+};
+
+
+metrics_shm_t  *ShmMetrics::s_pShm = NULL;
+metrics_slot_t *ShmMetrics::s_pSlot = NULL;
+
+
+//A slot has a single writer, a plain store is enough for readers
+static inline void metricsAdd(uint64_t *p, uint64_t n)
+{
+    __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + n,
+                     __ATOMIC_RELAXED);
+}
+
+
+static inline uint64_t metricsGet(const uint64_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+
+static void histAdd(metrics_hist_t *pHist, long long us)
+{
+    if (us < 0)
+        us = 0;
+    metricsAdd(&pHist->buckets[ShmMetrics::getBucket(us)], 1);
+    metricsAdd(&pHist->sumUs, us);
+}
+
+
+/**
+ * Maps all slots in one anonymous shared mapping, must be called before
+ * the workers fork. Slot 0 is used until setSlot() is called.
+ */
+int ShmMetrics::init(int iSlots)
+{
+    if (s_pShm)
+        return LS_OK;
+    if (iSlots < 1)
+        iSlots = 1;
+    size_t size = sizeof(metrics_shm_t) + (iSlots - 1) * sizeof(metrics_slot_t);
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_ANON | MAP_SHARED, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        LS_ERROR("[METRICS] Failed to map %zu bytes of shared memory.", size);
+        return LS_FAIL;
+    }
+    s_pShm = (metrics_shm_t *)p;
+    s_pShm->slots = iSlots;
+    s_pSlot = &s_pShm->slot[0];
+    return LS_OK;
+}
+
+
+void ShmMetrics::setSlot(int iSlot)
+{
+    if (!s_pShm)
+        return;
+    if (iSlot < 0 || iSlot >= s_pShm->slots)
+        iSlot = 0;
+    s_pSlot = &s_pShm->slot[iSlot];
+}
+
+
+/**
+ * Returns the id shared by all workers for a vhost name, adding it to
+ * the name table on first use.
+ */
+int ShmMetrics::getVHostId(const char *pName)
+{
+    if (!s_pShm || !pName)
+        return VHOST_OTHER;
+    for (int i = 1; i < METRICS_MAX_VHOSTS; ++i)
+    {
+        metrics_name_t *pEntry = &s_pShm->names[i];
+        int state = __atomic_load_n(&pEntry->state, __ATOMIC_ACQUIRE);
+        if (state == NAME_EMPTY)
+        {
+            if (!ls_atomic_casint(&pEntry->state, NAME_EMPTY, NAME_WRITING))
+            {
+                --i;
+                continue;
+            }
+            strncpy(pEntry->name, pName, METRICS_VHOST_NAME_LEN - 1);
+            __atomic_store_n(&pEntry->state, NAME_READY, __ATOMIC_RELEASE);
+            return i;
+        }
+        for (int spin = 0; state == NAME_WRITING && spin < 1000; ++spin)
+        {
+            sched_yield();
+            state = __atomic_load_n(&pEntry->state, __ATOMIC_ACQUIRE);
+        }
+        if (state == NAME_READY
+            && strncmp(pEntry->name, pName, METRICS_VHOST_NAME_LEN - 1) == 0)
+            return i;
+    }
+    return VHOST_OTHER;
+}
+
+
+void ShmMetrics::addRequest(int vhostId, int handlerType, long long us,
+                            long long bytesOut)
+{
+    if (!s_pSlot)
+        return;
+    if (vhostId < 0 || vhostId >= METRICS_MAX_VHOSTS)
+        vhostId = VHOST_OTHER;
+    metrics_vhost_t *pVHost = &s_pSlot->vhosts[vhostId];
+    metricsAdd(&pVHost->requests, 1);
+    metricsAdd(&pVHost->bytesOut, bytesOut);
+    histAdd(&pVHost->latency, us);
+
+    if (handlerType < 0 || handlerType > HandlerType::HT_END)
+        handlerType = HandlerType::HT_END;
+    metrics_handler_t *pHandler = &s_pSlot->handlers[handlerType];
+    metricsAdd(&pHandler->requests, 1);
+    histAdd(&pHandler->latency, us);
+}
+
+
+void ShmMetrics::addTtfb(int vhostId, long long us)
+{
+    if (!s_pSlot)
+        return;
+    if (vhostId < 0 || vhostId >= METRICS_MAX_VHOSTS)
+        vhostId = VHOST_OTHER;
+    histAdd(&s_pSlot->vhosts[vhostId].ttfb, us);
+}
+
+
+void ShmMetrics::addBackendWait(int handlerType, long long us)
+{
+    if (!s_pSlot)
+        return;
+    if (handlerType < 0 || handlerType > HandlerType::HT_END)
+        handlerType = HandlerType::HT_END;
+    histAdd(&s_pSlot->handlers[handlerType].backendWait, us);
+}
+
+
+void ShmMetrics::incCache(int which)
+{
+    if (!s_pSlot || which < CACHE_HIT || which > CACHE_STORE)
+        return;
+    metricsAdd(&s_pSlot->cache[which], 1);
+}
+
+
+void ShmMetrics::incTlsCtx(int which)
+{
+    if (!s_pSlot || which < TLS_CTX_HIT || which > TLS_CTX_FAIL)
+        return;
+    metricsAdd(&s_pSlot->tlsCtx[which], 1);
+}
+
+
+void ShmMetrics::addTlsCtxBuild(long long us)
+{
+    if (!s_pSlot)
+        return;
+    histAdd(&s_pSlot->tlsCtxBuild, us);
+}
+
+
+int ShmMetrics::getBucket(long long us)
+{
+    if (us < (1LL << METRICS_HIST_MIN_SHIFT))
+        return 0;
+    int e = 63 - __builtin_clzll(us);
+    if (e >= METRICS_HIST_MAX_SHIFT)
+        return METRICS_HIST_BUCKETS - 1;
+    int sub = (us >> (e - METRICS_HIST_SUB_BITS))
+              & ((1 << METRICS_HIST_SUB_BITS) - 1);
+    return 1 + ((e - METRICS_HIST_MIN_SHIFT) << METRICS_HIST_SUB_BITS) + sub;
+}
+
+
+/**
+ * Returns the exclusive upper bound of a bucket in microseconds, -1 for
+ * the last one, which has none.
+ */
+long long ShmMetrics::getBucketBound(int bucket)
+{
+    if (bucket <= 0)
+        return 1LL << METRICS_HIST_MIN_SHIFT;
+    if (bucket >= METRICS_HIST_BUCKETS - 1)
+        return -1;
+    --bucket;
+    int e = METRICS_HIST_MIN_SHIFT + (bucket >> METRICS_HIST_SUB_BITS);
+    int sub = bucket & ((1 << METRICS_HIST_SUB_BITS) - 1);
+    return (long long)((1 << METRICS_HIST_SUB_BITS) + sub + 1)
+           << (e - METRICS_HIST_SUB_BITS);
+}
+
+
+static void histMerge(metrics_hist_t *pDest, const metrics_hist_t *pSrc)
+{
+    for (int i = 0; i < METRICS_HIST_BUCKETS; ++i)
+        pDest->buckets[i] += metricsGet(&pSrc->buckets[i]);
+    pDest->sumUs += metricsGet(&pSrc->sumUs);
+}
+
+
+static void slotMerge(metrics_slot_t *pDest, const metrics_slot_t *pSrc)
+{
+    for (int i = 0; i < METRICS_MAX_VHOSTS; ++i)
+    {
+        const metrics_vhost_t *pVHost = &pSrc->vhosts[i];
+        if (!metricsGet(&pVHost->requests))
+            continue;
+        pDest->vhosts[i].requests += metricsGet(&pVHost->requests);
+        pDest->vhosts[i].bytesOut += metricsGet(&pVHost->bytesOut);
+        histMerge(&pDest->vhosts[i].latency, &pVHost->latency);
+        histMerge(&pDest->vhosts[i].ttfb, &pVHost->ttfb);
+    }
+    for (int i = 0; i <= HandlerType::HT_END; ++i)
+    {
+        const metrics_handler_t *pHandler = &pSrc->handlers[i];
+        pDest->handlers[i].requests += metricsGet(&pHandler->requests);
+        histMerge(&pDest->handlers[i].latency, &pHandler->latency);
+        histMerge(&pDest->handlers[i].backendWait, &pHandler->backendWait);
+    }
+    for (int i = 0; i < 3; ++i)
+        pDest->cache[i] += metricsGet(&pSrc->cache[i]);
+    for (int i = 0; i < 4; ++i)
+        pDest->tlsCtx[i] += metricsGet(&pSrc->tlsCtx[i]);
+    histMerge(&pDest->tlsCtxBuild, &pSrc->tlsCtxBuild);
+}
+
+
+static void appendHeader(AutoBuf *pBuf, const char *pName, const char *pType,
+                         const char *pHelp)
+{
+    char achBuf[256];
+    int len = snprintf(achBuf, sizeof(achBuf), "# HELP %s %s\n# TYPE %s %s\n",
+                       pName, pHelp, pName, pType);
+    pBuf->append(achBuf, len);
+}
+
+
+static void appendHist(AutoBuf *pBuf, const char *pName, const char *pLabel,
+                       const metrics_hist_t *pHist)
+{
+    char achBuf[512];
+    uint64_t count = 0;
+    const char *pSep = ",";
+    int len;
+    if (!pLabel)
+        pLabel = pSep = "";
+    for (int i = 0; i < METRICS_HIST_BUCKETS; ++i)
+    {
+        count += pHist->buckets[i];
+        long long bound = ShmMetrics::getBucketBound(i);
+        if (bound < 0)
+            len = snprintf(achBuf, sizeof(achBuf),
+                           "%s_bucket{%s%sle=\"+Inf\"} %llu\n", pName, pLabel,
+                           pSep, (unsigned long long)count);
+        else
+            len = snprintf(achBuf, sizeof(achBuf),
+                           "%s_bucket{%s%sle=\"%lld.%06lld\"} %llu\n", pName,
+                           pLabel, pSep, bound / 1000000, bound % 1000000,
+                           (unsigned long long)count);
+        pBuf->append(achBuf, len);
+    }
+    if (*pLabel)
+        len = snprintf(achBuf, sizeof(achBuf),
+                       "%s_sum{%s} %llu.%06llu\n%s_count{%s} %llu\n",
+                       pName, pLabel,
+                       (unsigned long long)pHist->sumUs / 1000000,
+                       (unsigned long long)pHist->sumUs % 1000000,
+                       pName, pLabel, (unsigned long long)count);
+    else
+        len = snprintf(achBuf, sizeof(achBuf),
+                       "%s_sum %llu.%06llu\n%s_count %llu\n", pName,
+                       (unsigned long long)pHist->sumUs / 1000000,
+                       (unsigned long long)pHist->sumUs % 1000000,
+                       pName, (unsigned long long)count);
+    pBuf->append(achBuf, len);
+}
+
+
+static int buildLabel(char *pBuf, int size, const char *pName,
+                      const char *pValue)
+{
+    char *p = pBuf;
+    char *pEnd = pBuf + size - 2;
+    p += snprintf(p, pEnd - p, "%s=\"", pName);
+    for (; *pValue && p < pEnd - 1; ++pValue)
+    {
+        if (*pValue == '"' || *pValue == '\\')
+            *p++ = '\\';
+        *p++ = *pValue;
+    }
+    *p++ = '"';
+    *p = 0;
+    return p - pBuf;
+}
+
+
+static void appendCounter(AutoBuf *pBuf, const char *pName,
+                          const char *pLabel, uint64_t val)
+{
+    char achBuf[512];
+    int len;
+    if (pLabel)
+        len = snprintf(achBuf, sizeof(achBuf), "%s{%s} %llu\n", pName, pLabel,
+                       (unsigned long long)val);
+    else
+        len = snprintf(achBuf, sizeof(achBuf), "%s %llu\n", pName,
+                       (unsigned long long)val);
+    pBuf->append(achBuf, len);
+}
+
+
+/**
+ * Appends the sum of all slots in the Prometheus text format. Only
+ * vhosts and handlers that served requests are listed.
+ */
+int ShmMetrics::writePrometheus(AutoBuf *pBuf)
+{
+    char achLabels[METRICS_MAX_VHOSTS][METRICS_VHOST_NAME_LEN * 2 + 16];
+    char achHandlers[HandlerType::HT_END + 1][32];
+    if (!s_pShm)
+        return LS_FAIL;
+    metrics_slot_t *pSum = (metrics_slot_t *)calloc(1, sizeof(metrics_slot_t));
+    if (!pSum)
+        return LS_FAIL;
+    for (int i = 0; i < s_pShm->slots; ++i)
+        slotMerge(pSum, &s_pShm->slot[i]);
+
+    for (int i = 0; i < METRICS_MAX_VHOSTS; ++i)
+    {
+        const char *pName = "_other";
+        if (i != VHOST_OTHER && __atomic_load_n(&s_pShm->names[i].state,
+                                                __ATOMIC_ACQUIRE) == NAME_READY)
+            pName = s_pShm->names[i].name;
+        buildLabel(achLabels[i], sizeof(achLabels[i]), "vhost", pName);
+    }
+    for (int i = 0; i <= HandlerType::HT_END; ++i)
+        buildLabel(achHandlers[i], sizeof(achHandlers[i]), "handler",
+                   (i < HandlerType::HT_END)
+                   ? HandlerType::getHandlerTypeString(i) : "none");
+
+    appendHeader(pBuf, "litespeed_requests_total", "counter",
+                 "Requests completed, by virtual host.");
+    for (int i = 0; i < METRICS_MAX_VHOSTS; ++i)
+        if (pSum->vhosts[i].requests)
+            appendCounter(pBuf, "litespeed_requests_total", achLabels[i],
+                          pSum->vhosts[i].requests);
+
+    appendHeader(pBuf, "litespeed_response_bytes_total", "counter",
+                 "Response bytes sent, headers included.");
+    for (int i = 0; i < METRICS_MAX_VHOSTS; ++i)
+        if (pSum->vhosts[i].requests)
+            appendCounter(pBuf, "litespeed_response_bytes_total",
+                          achLabels[i], pSum->vhosts[i].bytesOut);
+
+    appendHeader(pBuf, "litespeed_request_duration_seconds", "histogram",
+                 "Time from request header received to response done.");
+    for (int i = 0; i < METRICS_MAX_VHOSTS; ++i)
+        if (pSum->vhosts[i].requests)
+            appendHist(pBuf, "litespeed_request_duration_seconds",
+                       achLabels[i], &pSum->vhosts[i].latency);
+
+    appendHeader(pBuf, "litespeed_ttfb_seconds", "histogram",
+                 "Time from request header received to response header sent.");
+    for (int i = 0; i < METRICS_MAX_VHOSTS; ++i)
+        if (pSum->vhosts[i].requests)
+            appendHist(pBuf, "litespeed_ttfb_seconds", achLabels[i],
+                       &pSum->vhosts[i].ttfb);
+
+    appendHeader(pBuf, "litespeed_handler_requests_total", "counter",
+                 "Requests completed, by handler type.");
+    for (int i = 0; i <= HandlerType::HT_END; ++i)
+        if (pSum->handlers[i].requests)
+            appendCounter(pBuf, "litespeed_handler_requests_total",
+                          achHandlers[i], pSum->handlers[i].requests);
+
+    appendHeader(pBuf, "litespeed_handler_request_duration_seconds",
+                 "histogram", "Request duration, by handler type.");
+    for (int i = 0; i <= HandlerType::HT_END; ++i)
+        if (pSum->handlers[i].requests)
+            appendHist(pBuf, "litespeed_handler_request_duration_seconds",
+                       achHandlers[i], &pSum->handlers[i].latency);
+
+    appendHeader(pBuf, "litespeed_backend_wait_seconds", "histogram",
+                 "Time until the external app returned the response header.");
+    for (int i = 0; i < HandlerType::HT_END; ++i)
+        if (pSum->handlers[i].backendWait.sumUs
+            || pSum->handlers[i].backendWait.buckets[0])
+            appendHist(pBuf, "litespeed_backend_wait_seconds",
+                       achHandlers[i], &pSum->handlers[i].backendWait);
+
+    static const char *s_pCache[3][2] =
+    {
+        { "litespeed_cache_hits_total", "Requests served from the cache." },
+        { "litespeed_cache_misses_total", "Cacheable requests not in cache." },
+        { "litespeed_cache_stores_total", "Responses stored in the cache." },
+    };
+    for (int i = 0; i < 3; ++i)
+    {
+        appendHeader(pBuf, s_pCache[i][0], "counter", s_pCache[i][1]);
+        appendCounter(pBuf, s_pCache[i][0], NULL, pSum->cache[i]);
+    }
+
+    //every on demand load starts with a miss, none without lazy loading
+    if (pSum->tlsCtx[TLS_CTX_MISS])
+    {
+        static const char *s_pTlsCtx[4][2] =
+        {
+            { "litespeed_tls_ctx_hits_total",
+              "SNI lookups served by a loaded TLS context." },
+            { "litespeed_tls_ctx_misses_total",
+              "SNI lookups that had to load a TLS context." },
+            { "litespeed_tls_ctx_evictions_total",
+              "TLS contexts released as idle or over the limit." },
+            { "litespeed_tls_ctx_failures_total",
+              "TLS contexts that failed to load." },
+        };
+        for (int i = 0; i < 4; ++i)
+        {
+            appendHeader(pBuf, s_pTlsCtx[i][0], "counter", s_pTlsCtx[i][1]);
+            appendCounter(pBuf, s_pTlsCtx[i][0], NULL, pSum->tlsCtx[i]);
+        }
+        appendHeader(pBuf, "litespeed_tls_ctx_load_seconds", "histogram",
+                     "Time to load a TLS context on demand.");
+        appendHist(pBuf, "litespeed_tls_ctx_load_seconds", NULL,
+                   &pSum->tlsCtxBuild);
+    }
+    free(pSum);
+    return LS_OK;
+}
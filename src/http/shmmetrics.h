@@ -0,0 +1,127 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef SHMMETRICS_H
+#define SHMMETRICS_H
+
+#include <lsdef.h>
+#include <http/handlertype.h>
+
+#include <stdint.h>
+
+#define METRICS_MAX_VHOSTS      256
+#define METRICS_VHOST_NAME_LEN  64
+
+//log-linear buckets, 2 per power of 2 from 16us to ~18 minutes
+#define METRICS_HIST_MIN_SHIFT  4
+#define METRICS_HIST_MAX_SHIFT  30
+#define METRICS_HIST_SUB_BITS   1
+#define METRICS_HIST_BUCKETS    (2 + ((METRICS_HIST_MAX_SHIFT \
+                                 - METRICS_HIST_MIN_SHIFT) << METRICS_HIST_SUB_BITS))
+
+class AutoBuf;
+
+typedef struct metrics_hist_s
+{
+    uint64_t    buckets[METRICS_HIST_BUCKETS];
+    uint64_t    sumUs;
+} metrics_hist_t;
+
+typedef struct metrics_vhost_s
+{
+    uint64_t        requests;
+    uint64_t        bytesOut;
+    metrics_hist_t  latency;
+    metrics_hist_t  ttfb;
+} metrics_vhost_t;
+
+typedef struct metrics_handler_s
+{
+    uint64_t        requests;
+    metrics_hist_t  latency;
+    metrics_hist_t  backendWait;
+} metrics_handler_t;
+
+typedef struct metrics_slot_s
+{
+    metrics_vhost_t     vhosts[METRICS_MAX_VHOSTS];
+    //the last one is for requests never assigned a handler
+    metrics_handler_t   handlers[HandlerType::HT_END + 1];
+    uint64_t            cache[3];
+    uint64_t            tlsCtx[4];
+    metrics_hist_t      tlsCtxBuild;
+} metrics_slot_t;
+
+typedef struct metrics_shm_s metrics_shm_t;
+
+
+/**
+ * Request metrics in a shared memory segment mapped before the workers
+ * fork. Each worker owns one slot and is its only writer, so updates are
+ * plain relaxed stores without locks. Any worker can serve /metrics by
+ * adding up all slots, the event loops of the others are not involved.
+ */
+class ShmMetrics
+{
+public:
+    enum
+    {
+        CACHE_HIT,
+        CACHE_MISS,
+        CACHE_STORE,
+    };
+
+    enum
+    {
+        TLS_CTX_HIT,
+        TLS_CTX_MISS,
+        TLS_CTX_EVICT,
+        TLS_CTX_FAIL,
+    };
+
+    //vhost id of requests without a vhost, or over METRICS_MAX_VHOSTS
+    enum {  VHOST_OTHER = 0 };
+
+    static int  init(int iSlots);
+    static void setSlot(int iSlot);
+    static int  isEnabled()     {   return s_pSlot != NULL;     }
+
+    static int  getVHostId(const char *pName);
+
+    static void addRequest(int vhostId, int handlerType, long long us,
+                           long long bytesOut);
+    static void addTtfb(int vhostId, long long us);
+    static void addBackendWait(int handlerType, long long us);
+    static void incCache(int which);
+    static void incTlsCtx(int which);
+    static void addTlsCtxBuild(long long us);
+
+    static int  writePrometheus(AutoBuf *pBuf);
+
+    static int  getBucket(long long us);
+    static long long getBucketBound(int bucket);
+
+private:
+    static metrics_shm_t   *s_pShm;
+    static metrics_slot_t  *s_pSlot;
+
+    ShmMetrics();
+    ~ShmMetrics();
+    LS_NO_COPY_ASSIGN(ShmMetrics);
+};
+
+#endif // SHMMETRICS_H
@@ -0,0 +1,473 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "statcache.h"
+
+#include <edio/multiplexer.h>
+#include <edio/multiplexerfactory.h>
+#include <log4cxx/logger.h>
+#include <lsr/xxhash.h>
+#include <util/datetime.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(linux) || defined(__linux) || defined(__linux__) || defined(__gnu_linux__)
+#include <sys/inotify.h>
+#include <sys/vfs.h>
+#define STAT_CACHE_INOTIFY
+#endif
+
+
+LS_SINGLETON(StatCache);
+
+int     StatCache::s_iSize = 0;
+int     StatCache::s_iTimeout = 1;
+pid_t   StatCache::s_pid = 0;
+
+
+typedef struct stat_entry_s
+{
+    uint64_t        m_hash;
+    time_t          m_expire;       //0: valid until an inotify event
+    int             m_err;          //0, ENOENT or ENOTDIR
+    int             m_pathLen;
+    struct stat     m_st;
+    char            m_achPath[1];
+} stat_entry_t;
+
+
+typedef struct stat_watch_s
+{
+    int             m_wd;           //-1: not watchable, use timeout
+    int             m_dirLen;
+    char            m_achDir[1];
+} stat_watch_t;
+
+
+#ifdef STAT_CACHE_INOTIFY
+
+#define STAT_WATCH_MASK (IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE \
+                         | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO \
+                         | IN_DELETE_SELF | IN_MOVE_SELF)
+
+static int isNetworkFs(long type)
+{
+    switch ((unsigned int)type)
+    {
+    case 0x6969:        //NFS
+    case 0x517B:        //SMB
+    case 0xFF534D42:    //CIFS
+    case 0xFE534D42:    //SMB2
+    case 0x65735546:    //FUSE
+    case 0x00C36400:    //CEPH
+        return 1;
+    }
+    return 0;
+}
+
+#endif
+
+
+StatCache::StatCache()
+    : m_pSlots(NULL)
+    , m_iSlots(0)
+    , m_iCount(0)
+    , m_pid(-1)
+    , m_watchByWd(13, NULL, NULL)
+{
+}
+
+
+StatCache::~StatCache()
+{
+    reset();
+}
+
+
+static int matchTree(const char *pPath, int pathLen, const char *pDir,
+                     int dirLen)
+{
+    if (dirLen == 1)    //root directory
+        return 1;
+    return (pathLen >= dirLen && memcmp(pPath, pDir, dirLen) == 0
+            && (pathLen == dirLen || pPath[dirLen] == '/'));
+}
+
+
+/**
+ * Drops everything, including the inotify instance; the next lookup
+ * starts over with the current size.
+ */
+void StatCache::reset()
+{
+    HashStringMap<stat_watch_t *>::iterator iter;
+    clear();
+    if (m_pSlots)
+    {
+        free(m_pSlots);
+        m_pSlots = NULL;
+    }
+    m_iSlots = 0;
+    for (iter = m_watchByDir.begin(); iter != m_watchByDir.end();
+         iter = m_watchByDir.next(iter))
+        free(iter.second());
+    m_watchByDir.clear();
+    m_watchByWd.clear();
+    if (getfd() != -1)
+    {
+        //an instance inherited over fork() is registered with the parent
+        if (MultiplexerFactory::getMultiplexer() && m_pid == s_pid)
+            MultiplexerFactory::getMultiplexer()->remove(this);
+        close(getfd());
+        setfd(-1);
+    }
+    m_pid = -1;
+}
+
+
+/**
+ * Sets up the cache on first use in a process. A worker inherits nothing
+ * usable from its parent: the inotify instance would be shared with it.
+ */
+int StatCache::init()
+{
+    if (m_pid == s_pid && m_iSlots)
+        return LS_OK;
+    reset();
+    int n = 1;
+    while (n * 2 <= s_iSize)
+        n *= 2;
+    m_pSlots = (stat_entry_t **)calloc(n, sizeof(stat_entry_t *));
+    if (!m_pSlots)
+        return LS_FAIL;
+    m_iSlots = n;
+    m_pid = s_pid;
+#ifdef STAT_CACHE_INOTIFY
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd == -1)
+    {
+        LS_NOTICE("[StatCache] inotify_init1() failed: %s, cached entries "
+                  "expire after %d seconds.", strerror(errno), s_iTimeout);
+        return LS_OK;
+    }
+    setfd(fd);
+    Multiplexer *pMultiplexer = MultiplexerFactory::getMultiplexer();
+    if (pMultiplexer)
+        pMultiplexer->add(this, POLLIN | POLLHUP | POLLERR);
+#endif
+    return LS_OK;
+}
+
+
+void StatCache::clear()
+{
+    for (int i = 0; i < m_iSlots; ++i)
+    {
+        if (m_pSlots[i])
+        {
+            free(m_pSlots[i]);
+            m_pSlots[i] = NULL;
+        }
+    }
+    m_iCount = 0;
+}
+
+
+void StatCache::invalidate(const char *pPath, int len)
+{
+    if (!m_iSlots)
+        return;
+    uint64_t hash = XXH64(pPath, len, 0);
+    stat_entry_t **pSlot = &m_pSlots[hash & (m_iSlots - 1)];
+    stat_entry_t *pEntry = *pSlot;
+    if (pEntry && pEntry->m_hash == hash && pEntry->m_pathLen == len
+        && memcmp(pEntry->m_achPath, pPath, len) == 0)
+    {
+        free(pEntry);
+        *pSlot = NULL;
+        --m_iCount;
+    }
+}
+
+
+/**
+ * Drops the entries for a directory and everything below it, and stops
+ * watching its subdirectories. Used when a directory is removed, renamed
+ * or replaced, which is rare enough to afford a full scan.
+ */
+void StatCache::invalidateTree(const char *pDir, int len)
+{
+    char achDir[STAT_CACHE_MAX_PATH];
+    if (len >= STAT_CACHE_MAX_PATH)
+    {
+        clear();
+        return;
+    }
+    //pDir may belong to a watch released below
+    memmove(achDir, pDir, len);
+    achDir[len] = 0;
+    for (int i = 0; i < m_iSlots; ++i)
+    {
+        stat_entry_t *pEntry = m_pSlots[i];
+        if (pEntry && matchTree(pEntry->m_achPath, pEntry->m_pathLen,
+                                achDir, len))
+        {
+            free(pEntry);
+            m_pSlots[i] = NULL;
+            --m_iCount;
+        }
+    }
+    HashStringMap<stat_watch_t *>::iterator iter = m_watchByDir.begin();
+    while (iter != m_watchByDir.end())
+    {
+        HashStringMap<stat_watch_t *>::iterator next = m_watchByDir.next(iter);
+        stat_watch_t *pWatch = iter.second();
+        if (matchTree(pWatch->m_achDir, pWatch->m_dirLen, achDir, len))
+        {
+            m_watchByDir.erase(iter);
+            releaseWatch(pWatch);
+        }
+        iter = next;
+    }
+}
+
+
+void StatCache::releaseWatch(stat_watch_t *pWatch)
+{
+#ifdef STAT_CACHE_INOTIFY
+    if (pWatch->m_wd != -1)
+    {
+        THash<stat_watch_t *>::iterator iter
+            = m_watchByWd.find((void *)(long)pWatch->m_wd);
+        if (iter != m_watchByWd.end())
+            m_watchByWd.erase(iter);
+        inotify_rm_watch(getfd(), pWatch->m_wd);
+    }
+#endif
+    free(pWatch);
+}
+
+
+/**
+ * Returns the watch covering the entries of a directory, NULL if they
+ * have to expire by timeout. The parents of a watched directory are
+ * watched too, so that renaming any of them is noticed.
+ */
+stat_watch_t *StatCache::getWatch(char *pDir, int len)
+{
+    char ch = pDir[len];
+    pDir[len] = 0;
+    HashStringMap<stat_watch_t *>::iterator iter = m_watchByDir.find(pDir);
+    pDir[len] = ch;
+    if (iter != m_watchByDir.end())
+        return iter.second();
+    if (getfd() == -1 || (int)m_watchByDir.size() >= STAT_CACHE_MAX_WATCHES)
+        return NULL;
+    if (len > 1)
+    {
+        int parentLen = len - 1;
+        while (parentLen > 0 && pDir[parentLen] != '/')
+            --parentLen;
+        stat_watch_t *pParent = getWatch(pDir, parentLen ? parentLen : 1);
+        if (!pParent || pParent->m_wd == -1)
+            return pParent;
+    }
+    return addWatch(pDir, len);
+}
+
+
+stat_watch_t *StatCache::addWatch(char *pDir, int len)
+{
+    int wd = -1;
+#ifdef STAT_CACHE_INOTIFY
+    struct statfs fs;
+    char ch = pDir[len];
+    pDir[len] = 0;
+    if (statfs(pDir, &fs) != 0 || !isNetworkFs(fs.f_type))
+        wd = inotify_add_watch(getfd(), pDir, STAT_WATCH_MASK);
+    else
+        wd = -2;
+    pDir[len] = ch;
+    //a directory reached by two paths shares one watch, do not cache both
+    if (wd == -1 || (wd >= 0 && m_watchByWd.find((void *)(long)wd)
+                                != m_watchByWd.end()))
+        return NULL;
+    if (wd == -2)
+        wd = -1;
+#endif
+    stat_watch_t *pWatch = (stat_watch_t *)malloc(sizeof(stat_watch_t) + len);
+    if (!pWatch)
+        return NULL;
+    pWatch->m_wd = wd;
+    pWatch->m_dirLen = len;
+    memmove(pWatch->m_achDir, pDir, len);
+    pWatch->m_achDir[len] = 0;
+    m_watchByDir.insert(pWatch->m_achDir, pWatch);
+    if (wd != -1)
+        m_watchByWd.insert((void *)(long)wd, pWatch);
+    return pWatch;
+}
+
+
+int StatCache::lookup(const char *pPath, struct stat *st)
+{
+    char achDir[STAT_CACHE_MAX_PATH];
+    int len = strlen(pPath);
+    if (len >= STAT_CACHE_MAX_PATH || *pPath != '/' || init() != LS_OK)
+        return ls_fio_stat(pPath, st);
+
+    uint64_t hash = XXH64(pPath, len, 0);
+    stat_entry_t **pSlot = &m_pSlots[hash & (m_iSlots - 1)];
+    stat_entry_t *pEntry = *pSlot;
+    if (pEntry && pEntry->m_hash == hash && pEntry->m_pathLen == len
+        && memcmp(pEntry->m_achPath, pPath, len) == 0
+        && (!pEntry->m_expire || pEntry->m_expire > DateTime::s_curTime))
+    {
+        if (pEntry->m_err)
+        {
+            errno = pEntry->m_err;
+            return -1;
+        }
+        memmove(st, &pEntry->m_st, sizeof(struct stat));
+        return 0;
+    }
+
+    //watch before stat, a change in between must not be missed
+    const char *pSlash = (const char *)memrchr(pPath, '/', len);
+    int dirLen = pSlash - pPath;
+    if (dirLen == 0)
+        dirLen = 1;
+    memmove(achDir, pPath, dirLen);
+    stat_watch_t *pWatch = getWatch(achDir, dirLen);
+
+    int ret = lstat(pPath, st);
+    if (ret == 0 && S_ISLNK(st->st_mode))
+    {
+        //the target may live in a directory that is not watched
+        pWatch = NULL;
+        ret = ls_fio_stat(pPath, st);
+    }
+    int err = (ret == -1) ? errno : 0;
+    time_t expire = 0;
+    if (!pWatch || pWatch->m_wd == -1)
+        expire = DateTime::s_curTime + s_iTimeout;
+    if ((err && err != ENOENT && err != ENOTDIR)
+        || (expire && s_iTimeout <= 0))
+    {
+        errno = err;
+        return ret;
+    }
+
+    pEntry = *pSlot;
+    if (!pEntry || pEntry->m_pathLen < len)
+    {
+        pEntry = (stat_entry_t *)realloc(pEntry, sizeof(stat_entry_t) + len);
+        if (!pEntry)
+        {
+            errno = err;
+            return ret;
+        }
+        if (!*pSlot)
+            ++m_iCount;
+        *pSlot = pEntry;
+    }
+    pEntry->m_hash = hash;
+    pEntry->m_expire = expire;
+    pEntry->m_err = err;
+    pEntry->m_pathLen = len;
+    if (!err)
+        memmove(&pEntry->m_st, st, sizeof(struct stat));
+    memmove(pEntry->m_achPath, pPath, len + 1);
+    errno = err;
+    return ret;
+}
+
+
+void StatCache::processEvent(const struct inotify_event *pEvent)
+{
+#ifdef STAT_CACHE_INOTIFY
+    char achPath[STAT_CACHE_MAX_PATH];
+    if (pEvent->mask & IN_Q_OVERFLOW)
+    {
+        clear();
+        return;
+    }
+    THash<stat_watch_t *>::iterator iter
+        = m_watchByWd.find((void *)(long)pEvent->wd);
+    if (iter == m_watchByWd.end())
+        return;
+    stat_watch_t *pWatch = iter.second();
+    if (pEvent->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED
+                        | IN_UNMOUNT))
+    {
+        invalidateTree(pWatch->m_achDir, pWatch->m_dirLen);
+        return;
+    }
+    //the directory's own mtime changed as well
+    invalidate(pWatch->m_achDir, pWatch->m_dirLen);
+    if (!pEvent->len)
+        return;
+    int dirLen = (pWatch->m_dirLen == 1) ? 0 : pWatch->m_dirLen;
+    int nameLen = strlen(pEvent->name);
+    if (dirLen + 1 + nameLen >= STAT_CACHE_MAX_PATH)
+        return;
+    memmove(achPath, pWatch->m_achDir, dirLen);
+    achPath[dirLen] = '/';
+    memmove(achPath + dirLen + 1, pEvent->name, nameLen + 1);
+    int len = dirLen + 1 + nameLen;
+    invalidate(achPath, len);
+    if ((pEvent->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+        && ((pEvent->mask & IN_ISDIR)
+            || m_watchByDir.find(achPath) != m_watchByDir.end()))
+        invalidateTree(achPath, len);
+#endif
+}
+
+
+int StatCache::handleEvents(short event)
+{
+#ifdef STAT_CACHE_INOTIFY
+    char achBuf[8192] __attribute__((aligned(__alignof__(struct inotify_event))));
+    if (event & POLLIN)
+    {
+        int len;
+        while ((len = ::read(getfd(), achBuf, sizeof(achBuf))) > 0)
+        {
+            const char *p = achBuf;
+            const char *pEnd = achBuf + len;
+            while (p < pEnd)
+            {
+                const struct inotify_event *pEvent
+                    = (const struct inotify_event *)p;
+                processEvent(pEvent);
+                p += sizeof(struct inotify_event) + pEvent->len;
+            }
+        }
+    }
+    if (event & (POLLHUP | POLLERR))
+    {
+        LS_ERROR("[StatCache] inotify error, cache disabled.");
+        s_iSize = 0;
+        reset();
+    }
+#endif
+    return 0;
+}
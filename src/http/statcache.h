@@ -0,0 +1,102 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef STATCACHE_H
+#define STATCACHE_H
+
+#include <lsdef.h>
+#include <edio/eventreactor.h>
+#include <lsr/ls_fileio.h>
+#include <util/ghash.h>
+#include <util/hashstringmap.h>
+#include <util/tsingleton.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+//longer paths are not cached
+#define STAT_CACHE_MAX_PATH     1024
+//directories beyond this are not watched, their entries expire by timeout
+#define STAT_CACHE_MAX_WATCHES  8192
+
+typedef struct stat_entry_s stat_entry_t;
+typedef struct stat_watch_s stat_watch_t;
+
+
+/**
+ * Per-worker cache of stat() results, including "not found" answers.
+ * Entries in a directory with an inotify watch stay valid until an event
+ * on that directory, or on one of its parents, drops them. Directories
+ * that cannot be watched (network file systems, inotify unavailable or
+ * out of watches) and symbolic links fall back to a short timeout.
+ */
+class StatCache : public EventReactor, public TSingleton<StatCache>
+{
+    friend class TSingleton<StatCache>;
+public:
+    ~StatCache();
+
+    static void setSize(int slots)      {   s_iSize = slots;        }
+    static int  getSize()               {   return s_iSize;         }
+    static void setTimeout(int secs)    {   s_iTimeout = secs;      }
+    static void setpid(pid_t pid)       {   s_pid = pid;            }
+
+    //same contract as stat(2): 0, or -1 with errno set
+    static int cachedStat(const char *pPath, struct stat *st)
+    {
+        if (s_iSize <= 0)
+            return ls_fio_stat(pPath, st);
+        return getInstance().lookup(pPath, st);
+    }
+
+    int  lookup(const char *pPath, struct stat *st);
+    void invalidate(const char *pPath, int len);
+    void invalidateTree(const char *pDir, int len);
+    void clear();
+
+    int  getCount() const               {   return m_iCount;        }
+    int  getWatchCount() const          {   return m_watchByDir.size(); }
+
+    virtual int handleEvents(short event);
+
+private:
+    StatCache();
+
+    int  init();
+    void reset();
+    stat_watch_t *getWatch(char *pDir, int len);
+    stat_watch_t *addWatch(char *pDir, int len);
+    void releaseWatch(stat_watch_t *pWatch);
+    void processEvent(const struct inotify_event *pEvent);
+
+    stat_entry_t              **m_pSlots;
+    int                         m_iSlots;
+    int                         m_iCount;
+    pid_t                       m_pid;
+    HashStringMap<stat_watch_t *> m_watchByDir;
+    THash<stat_watch_t *>       m_watchByWd;
+
+    static int      s_iSize;
+    static int      s_iTimeout;
+    static pid_t    s_pid;
+
+    LS_NO_COPY_ASSIGN(StatCache);
+};
+
+LS_SINGLETON_DECL(StatCache);
+
+#endif // STATCACHE_H
@@ -17,24 +17,33 @@
 *****************************************************************************/
 #include <http/staticfilecachedata.h>
 #include <main/httpserver.h>
+#include <edio/multiplexerfactory.h>
+#include <http/expiresctrl.h>
 #include <http/httpcontext.h>
 #include <http/httpheader.h>
 #include <http/httpmime.h>
 #include <http/httpreq.h>
+#include <http/httprespheaders.h>
+#include <http/httpserverconfig.h>
 #include <http/httpstatuscode.h>
 #include <log4cxx/logger.h>
 #include <lsiapi/lsiapi.h>
 #include <lsr/ls_fileio.h>
+#include <lsr/ls_offload.h>
 #include <lsr/ls_strtool.h>
+#include <spdy/lshpack.h>
 #include <ssi/ssiscript.h>
 #include <util/datetime.h>
 #include <util/brotlibuf.h>
 #include <util/gzipbuf.h>
+#include <util/stringlist.h>
 #include <util/stringtool.h>
 #include <util/vmembuf.h>
+#include <util/zstdbuf.h>
 
 #include <openssl/md5.h>
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
@@ -63,8 +72,26 @@ static int      s_iMaxFileSize          = 1024 * 1024;
 static int      s_iMinFileSize          = 300;
 
 static int      s_iBrCompressLevel    = 6;
+static int      s_iZstdCompressLevel  = 12;
+
+//Suffixes of the compressed copies, indexed by SFCD_COMPRESS_xxx.
+static const char s_compressSuffix[SFCD_COMPRESS_TYPES][5] =
+{   ".lsz", ".lsb", ".zst"  };
+
+//Encodings in order of preference when several are acceptable; zstd is
+//about as compact as brotli and the cheapest to create and to decode.
+static const char s_compressOrder[SFCD_COMPRESS_TYPES] =
+{   SFCD_COMPRESS_ZSTD, SFCD_COMPRESS_BROTLI, SFCD_COMPRESS_GZIP    };
 
 static const char *s_compressCachePath = DEFAULT_TMP_DIR;
+static const char *s_compressPrewarmDir = NULL;
+
+#define SFCD_COMPRESS_WORKERS       1
+#define SFCD_MAX_PENDING_COMPRESS   64
+#define SFCD_MAX_PATH_LEN           4096
+
+static struct Offloader *s_pCompressOffloader = NULL;
+static int      s_iPendingCompress      = 0;
 
 
 
@@ -271,7 +298,7 @@ const char *FileCacheDataEx::getCacheData(
 StaticFileCacheData::StaticFileCacheData()
 {
     memset(&m_pMimeType, 0,
-           (char *)(&m_pBrotli + 1) - (char *)&m_pMimeType);
+           (char *)(&m_pZstd + 1) - (char *)&m_pMimeType);
 }
 
 
@@ -282,6 +309,8 @@ StaticFileCacheData::~StaticFileCacheData()
         delete m_pGzip;
     if (m_pBrotli)
         delete m_pBrotli;
+    if (m_pZstd)
+        delete m_pZstd;
     if (m_pSSIScript)
         delete m_pSSIScript;
 }
@@ -445,10 +474,98 @@ int StaticFileCacheData::buildFixedHeaders(int etag)
     m_sHeaders.setLen(p - m_sHeaders.buf());
     m_iValidateHeaderLen = (m_iETagLen ? (6 + m_iETagLen + 2) : 0) + 15 + 2 +
                            RFC_1123_TIME_LEN ;
+    const char *pLastMod = m_sHeaders.buf() + m_iValidateHeaderLen
+                           - RFC_1123_TIME_LEN - 2;
+    const char *pContentType = pLastMod + RFC_1123_TIME_LEN + 2 + 14;
+    return buildHpackHeaders(pContentType, p - 2 - pContentType, pLastMod);
+}
+
+
+static unsigned char *appendLiteral(unsigned char *p, unsigned char *pEnd,
+                                    int index, const char *pVal, int len)
+{
+    lshpack_header_t hdr;
+    hdr.name.iov_base = NULL;
+    hdr.name.iov_len = 0;
+    hdr.value.iov_base = (char *)pVal;
+    hdr.value.iov_len = len;
+    return lshpack_enc_encode_literal(p, pEnd,
+                                      HttpRespHeaders::toHpackIdx(index), &hdr);
+}
+
+
+/**
+ * The HTTP/2 form of the fixed headers, ETag, Content-Type, Last-Modified
+ * and Accept-Ranges as literals without indexing, so that one copy serves
+ * all connections.
+ */
+int StaticFileCacheData::buildHpackHeaders(const char *pContentType,
+                                           int ctLen, const char *pLastMod)
+{
+    int size = m_iETagLen + ctLen + RFC_1123_TIME_LEN + 5 + 4 * 6;
+    if (!m_sHpackHeaders.prealloc(size))
+        return SC_500;
+    unsigned char *pBegin = (unsigned char *)m_sHpackHeaders.buf();
+    unsigned char *pEnd = pBegin + size;
+    unsigned char *p = pBegin;
+    if (m_iETagLen)
+        p = appendLiteral(p, pEnd, HttpRespHeaders::H_ETAG, m_pETag,
+                          m_iETagLen);
+    m_iHpackETagLen = p - pBegin;
+    p = appendLiteral(p, pEnd, HttpRespHeaders::H_CONTENT_TYPE,
+                      pContentType, ctLen);
+    p = appendLiteral(p, pEnd, HttpRespHeaders::H_LAST_MODIFIED, pLastMod,
+                      RFC_1123_TIME_LEN);
+    unsigned char *pRange = p;
+    p = appendLiteral(p, pEnd, HttpRespHeaders::H_ACCEPT_RANGES, "bytes", 5);
+    m_iHpackRangeLen = p - pRange;
+    m_sHpackHeaders.setLen(p - pBegin);
     return 0;
 }
 
 
+/**
+ * Attaches the HTTP/2 block matching the headers buildStaticFileHeaders()
+ * adds. Compressed copies change the ETag, it is left out for them.
+ */
+void StaticFileCacheData::attachHpackHeaders(HttpRespHeaders *pHeaders,
+        int withETag, int withAcceptRange) const
+{
+    const char *pBlock = m_sHpackHeaders.c_str();
+    int len = m_sHpackHeaders.len();
+    uint32_t mask = (1 << HttpRespHeaders::H_CONTENT_TYPE)
+                    | (1 << HttpRespHeaders::H_LAST_MODIFIED);
+    uint32_t hash = 0;
+    if (withAcceptRange)
+    {
+        mask |= 1 << HttpRespHeaders::H_ACCEPT_RANGES;
+        hash = HttpRespHeaders::hashValue(hash, "bytes", 5);
+    }
+    else
+        len -= m_iHpackRangeLen;
+
+    //hashed in HttpRespHeaders::INDEX order
+    const char *pLastMod = m_sHeaders.c_str() + m_iValidateHeaderLen
+                           - RFC_1123_TIME_LEN - 2;
+    const char *pContentType = pLastMod + RFC_1123_TIME_LEN + 2 + 14;
+    hash = HttpRespHeaders::hashValue(hash, pContentType,
+                                      m_sHeaders.c_str() + m_sHeaders.len()
+                                      - 2 - pContentType);
+    if (withETag && m_iETagLen)
+    {
+        mask |= 1 << HttpRespHeaders::H_ETAG;
+        hash = HttpRespHeaders::hashValue(hash, m_pETag, m_iETagLen);
+    }
+    else
+    {
+        pBlock += m_iHpackETagLen;
+        len -= m_iHpackETagLen;
+    }
+    hash = HttpRespHeaders::hashValue(hash, pLastMod, RFC_1123_TIME_LEN);
+    pHeaders->setHpackBlock(pBlock, len, mask, hash);
+}
+
+
 int  FileCacheDataEx::buildCLHeader(bool gziped)
 {
     int size = 40;
@@ -529,7 +646,228 @@ static int createLockFile(const char *pReal, char *p)
 }
 
 
-int StaticFileCacheData::tryCreateCompressed(char useBrotli)
+static long compressFileTo(const char *pSrc, const char *pDest,
+                           char type, off_t size, time_t tmLastMod);
+static int buildCompressedBasePath(const char *pReal, int len,
+                                   char *pBuf, int bufLen);
+
+
+typedef struct sfcd_compress_task
+{
+    ls_offload_t    m_header;
+    char           *m_pSrc;
+    char           *m_pDest;
+    off_t           m_iSize;
+    time_t          m_tmLastMod;
+    long            m_ret;
+    char            m_type;
+} sfcd_compress_task_t;
+
+
+static int sfcdCompressPerform(ls_offload_t *pTask)
+{
+    sfcd_compress_task_t *pJob = (sfcd_compress_task_t *)pTask;
+    pJob->m_ret = compressFileTo(pJob->m_pSrc, pJob->m_pDest,
+                                 pJob->m_type, pJob->m_iSize,
+                                 pJob->m_tmLastMod);
+    int len = strlen(pJob->m_pDest);
+    pJob->m_pDest[len] = 'l';   //lock file, "*.lszl"
+    unlink(pJob->m_pDest);
+    pJob->m_pDest[len] = 0;
+    return 0;
+}
+
+
+static void sfcdCompressRelease(ls_offload_t *pTask)
+{
+    sfcd_compress_task_t *pJob = (sfcd_compress_task_t *)pTask;
+    if (--pJob->m_header.ref_cnt > 0)
+        return;
+    free(pJob->m_pSrc);
+    free(pJob->m_pDest);
+    free(pJob);
+}
+
+
+static void sfcdCompressDone(void *param)
+{
+    sfcd_compress_task_t *pJob = (sfcd_compress_task_t *)param;
+    --s_iPendingCompress;
+    if (pJob->m_ret == LS_FAIL)
+        LS_WARN("Failed to compress file %s, file size %ld!",
+                pJob->m_pSrc, (long)pJob->m_iSize);
+    else
+        LS_DBG_H("Compressed file %s to %s, %ld -> %ld.", pJob->m_pSrc,
+                 pJob->m_pDest, (long)pJob->m_iSize, pJob->m_ret);
+}
+
+
+static ls_offload_api s_compressApi =
+{
+    sfcdCompressPerform,
+    sfcdCompressRelease,
+    sfcdCompressDone
+};
+
+
+static struct Offloader *getCompressOffloader()
+{
+    if (!s_pCompressOffloader && MultiplexerFactory::getMultiplexer())
+        s_pCompressOffloader = offloader_new("COMPRESS",
+                                             SFCD_COMPRESS_WORKERS);
+    return s_pCompressOffloader;
+}
+
+
+static int offloadCompress(struct Offloader *pOffloader, const char *pSrc,
+                           const char *pDest, char type, off_t size,
+                           time_t tmLastMod)
+{
+    sfcd_compress_task_t *pJob = (sfcd_compress_task_t *)calloc(1,
+                                 sizeof(sfcd_compress_task_t));
+    if (!pJob)
+        return LS_FAIL;
+    pJob->m_header.ref_cnt = 1;
+    pJob->m_header.api = &s_compressApi;
+    pJob->m_header.param_task_done = pJob;
+    pJob->m_pSrc = strdup(pSrc);
+    //room for the lock file suffix
+    pJob->m_pDest = (char *)malloc(strlen(pDest) + 2);
+    pJob->m_iSize = size;
+    pJob->m_tmLastMod = tmLastMod;
+    pJob->m_type = type;
+    int ret = LS_FAIL;
+    if (pJob->m_pSrc && pJob->m_pDest)
+    {
+        strcpy(pJob->m_pDest, pDest);
+        ret = offloader_enqueue(pOffloader, &pJob->m_header);
+        if (ret != -1)
+            ++s_iPendingCompress;
+    }
+    sfcdCompressRelease(&pJob->m_header);
+    return (ret == -1) ? LS_FAIL : LS_OK;
+}
+
+
+typedef struct sfcd_prewarm_task
+{
+    ls_offload_t    m_header;
+    int             m_iFiles;
+    int             m_iCompressed;
+    char            m_modes;
+    StringList     *m_pSuffixes;    //compressible, taken on the event loop
+    char            m_achDir[SFCD_MAX_PATH_LEN];
+} sfcd_prewarm_task_t;
+
+
+static void prewarmFile(sfcd_prewarm_task_t *pJob, const char *pPath,
+                        int pathLen, const struct stat &st)
+{
+    if ((st.st_size > s_iMaxFileSize) || (st.st_size < s_iMinFileSize))
+        return;
+    const char *pSuffix = strrchr(pPath, '.');
+    if (!pSuffix || !pJob->m_pSuffixes->bfind(pSuffix + 1))
+        return;
+    ++pJob->m_iFiles;
+
+    char achDest[SFCD_MAX_PATH_LEN];
+    int n = buildCompressedBasePath(pPath, pathLen, achDest, sizeof(achDest));
+    if (n == LS_FAIL)
+        return;
+    for (int type = 0; type < SFCD_COMPRESS_TYPES; ++type)
+    {
+        struct stat stComp;
+        if (!(pJob->m_modes & (1 << type)))
+            continue;
+        memcpy(&achDest[n], s_compressSuffix[type], 5);
+        if ((ls_fio_stat(achDest, &stComp) == 0)
+            && (stComp.st_mtime == st.st_mtime))
+            continue;
+        int fd = createLockFile(achDest, &achDest[n + 4]);
+        if (fd == -1)
+            continue;
+        close(fd);
+        if (compressFileTo(pPath, achDest, type, st.st_size,
+                           st.st_mtime) != LS_FAIL)
+            ++pJob->m_iCompressed;
+        achDest[n + 4] = 'l';
+        unlink(achDest);
+        achDest[n + 4] = 0;
+    }
+}
+
+
+static void prewarmDir(sfcd_prewarm_task_t *pJob, char *pPath, int len)
+{
+    DIR *pDir = opendir(pPath);
+    if (!pDir)
+        return;
+    struct dirent *pEntry;
+    struct stat st;
+    pPath[len++] = '/';
+    while ((pEntry = readdir(pDir)) != NULL)
+    {
+        if (pEntry->d_name[0] == '.')
+            continue;
+        int nameLen = strlen(pEntry->d_name);
+        if (len + nameLen >= SFCD_MAX_PATH_LEN)
+            continue;
+        memcpy(pPath + len, pEntry->d_name, nameLen + 1);
+        if (lstat(pPath, &st) == -1)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            prewarmDir(pJob, pPath, len + nameLen);
+        else if (S_ISREG(st.st_mode))
+            prewarmFile(pJob, pPath, len + nameLen, st);
+    }
+    pPath[len - 1] = 0;
+    closedir(pDir);
+}
+
+
+static int sfcdPrewarmPerform(ls_offload_t *pTask)
+{
+    sfcd_prewarm_task_t *pJob = (sfcd_prewarm_task_t *)pTask;
+    char achPath[SFCD_MAX_PATH_LEN];
+    int len = strlen(pJob->m_achDir);
+    while ((len > 1) && (pJob->m_achDir[len - 1] == '/'))
+        --len;
+    memcpy(achPath, pJob->m_achDir, len);
+    achPath[len] = 0;
+    prewarmDir(pJob, achPath, len);
+    return 0;
+}
+
+
+static void sfcdPrewarmRelease(ls_offload_t *pTask)
+{
+    sfcd_prewarm_task_t *pJob = (sfcd_prewarm_task_t *)pTask;
+    if (--pTask->ref_cnt > 0)
+        return;
+    if (pJob->m_pSuffixes)
+        delete pJob->m_pSuffixes;
+    free(pJob);
+}
+
+
+static void sfcdPrewarmDone(void *param)
+{
+    sfcd_prewarm_task_t *pJob = (sfcd_prewarm_task_t *)param;
+    LS_NOTICE("[Compress] Pre-warmed %s, %d compressible files, "
+              "%d compressed files created.", pJob->m_achDir,
+              pJob->m_iFiles, pJob->m_iCompressed);
+}
+
+
+static ls_offload_api s_prewarmApi =
+{
+    sfcdPrewarmPerform,
+    sfcdPrewarmRelease,
+    sfcdPrewarmDone
+};
+
+
+int StaticFileCacheData::tryCreateCompressed(char type)
 {
     AutoStr2 *pPath;
     if (!s_iAutoUpdateStaticGzip)
@@ -545,19 +883,43 @@ int StaticFileCacheData::tryCreateCompressed(char useBrotli)
         return LS_FAIL;
     }
     
-    pPath = useBrotli ? &m_bredPath : &m_gzippedPath;
+    struct Offloader *pOffloader = getCompressOffloader();
+    if (pOffloader && s_iPendingCompress >= SFCD_MAX_PENDING_COMPRESS)
+    {
+        LS_DBG_H("Too many pending compress jobs, skip file %s.",
+                 m_real.c_str());
+        return LS_FAIL;
+    }
+
+    pPath = getCompressedPath(type);
     char *p = pPath->buf() + pPath->len() + 4;
     int fd = createLockFile(pPath->buf(), p);
     if (fd == -1)
     {
-        LS_WARN("createLockFile for file %s failed!", m_real.c_str());
+        LS_DBG_L("createLockFile for file %s failed, compression in "
+                 "progress?", pPath->c_str());
         return LS_FAIL;
     }
     close(fd);
+    if (pOffloader)
+    {
+        //the compressed file is picked up by a later request once ready,
+        //this one is served uncompressed or with dynamic compression.
+        if (offloadCompress(pOffloader, m_real.c_str(), pPath->c_str(),
+                            type, size, getLastMod()) == LS_OK)
+        {
+            LS_DBG_H("Queued compression of file %s.", m_real.c_str());
+            return LS_FAIL;
+        }
+        *p = 'l';
+        unlink(pPath->buf());
+        *p = 0;
+        return LS_FAIL;
+    }
     if (size < 409600)
     {
 
-        long ret = compressFile(useBrotli);
+        long ret = compressFile(type);
         if (ret == -1)
             LS_WARN("Failed to compress file %s, file size %ld!",
                     m_real.c_str(), (long)size);
@@ -582,7 +944,7 @@ int StaticFileCacheData::tryCreateCompressed(char useBrotli)
         //child process
         setpriority(PRIO_PROCESS, 0, 5);
 
-        long ret = compressFile(useBrotli);
+        long ret = compressFile(type);
         if (ret == -1)
             LS_WARN("Failed to compress file %s, file size %ld!",
                     m_real.c_str(), (long)size);
@@ -624,99 +986,122 @@ int StaticFileCacheData::detectTrancate()
 }
 
 
-int StaticFileCacheData::compressFile(char useBrotli)
+static long compressFileTo(const char *pSrc, const char *pDest,
+                           char type, off_t size, time_t tmLastMod)
 {
     int ret;
-    AutoStr2 *pPath;
-
     GzipBuf gzBuf;
     Compressor *pCompressor;
     VMemBuf compressedFile;
     int iCompressLevel;
-
 #ifdef USE_BROTLI
     BrotliBuf brBuf;
-    if (useBrotli)
-    {
-        pCompressor = &brBuf;
-        pPath = &m_bredPath;
-        iCompressLevel = s_iBrCompressLevel;
-    }
-    else
-    {
 #endif
+#ifdef USE_ZSTD
+    ZstdBuf zstdBuf;
+#endif
+
+    switch (type)
+    {
+    case SFCD_COMPRESS_GZIP:
         pCompressor = &gzBuf;
-        pPath = &m_gzippedPath;
         iCompressLevel = s_iGzipCompressLevel;
+        break;
 #ifdef USE_BROTLI
-    }
+    case SFCD_COMPRESS_BROTLI:
+        pCompressor = &brBuf;
+        iCompressLevel = s_iBrCompressLevel;
+        break;
+#endif
+#ifdef USE_ZSTD
+    case SFCD_COMPRESS_ZSTD:
+        pCompressor = &zstdBuf;
+        iCompressLevel = s_iZstdCompressLevel;
+        break;
 #endif
+    default:
+        return LS_FAIL;
+    }
 
-    if (    //detectTrancate() ||
-        (0 != pCompressor->init(Compressor::COMPRESSOR_COMPRESS, iCompressLevel)))
+    if (0 != pCompressor->init(Compressor::COMPRESSOR_COMPRESS, iCompressLevel))
+        return LS_FAIL;
+    int fdSrc;
+    if (openFile(pSrc, fdSrc) != 0)
         return LS_FAIL;
-    if ((!m_fileData.isCached() &&
-         (m_fileData.getfd() == -1)))
+    struct stat st;
+    if ((fstat(fdSrc, &st) == -1) || (st.st_size != size)
+        || (st.st_mtime != tmLastMod))
     {
-        if (m_fileData.readyData(m_real.c_str()) != 0)
-            return LS_FAIL;
+        close(fdSrc);
+        return LS_FAIL;
     }
 
     char achFileName[4096];
-    snprintf(achFileName, 4096, "%s.XXXXXX", pPath->c_str());
+    snprintf(achFileName, 4096, "%s.XXXXXX", pDest);
     int fd = mkstemp(achFileName);
+    if (fd == -1)
+    {
+        close(fdSrc);
+        return LS_FAIL;
+    }
     ret = compressedFile.setFd(achFileName, fd);
     if (ret)
     {
         close(fd);
+        unlink(achFileName);
+        close(fdSrc);
         return ret;
     }
     pCompressor->setCompressCache(&compressedFile);
-    if (pCompressor->beginStream())
-        return LS_FAIL;
     off_t offset = 0;
-    int len;
-    off_t wanted;
-    const char *pData;
-    char achBuf[8192];
-    while (true)
-    {
-        wanted = getFileSize() - offset;
-        if (wanted <= 0)
-            break;
-        if (wanted < 8192)
-            len = wanted;
-        else
-            len = 8192;
-        pData = m_fileData.getCacheData(offset, wanted, achBuf, len);
-        if (wanted <= 0)
-            return LS_FAIL;
-        if (pCompressor->write(pData, wanted) == LS_FAIL)
-            return LS_FAIL;
-        offset += wanted;
-
+    int len = 0;
+    char achBuf[16384];
+    if (pCompressor->beginStream() == 0)
+    {
+        while (offset < size)
+        {
+            len = pread(fdSrc, achBuf, sizeof(achBuf), offset);
+            if ((len <= 0) || (pCompressor->write(achBuf, len) == LS_FAIL))
+            {
+                len = -1;
+                break;
+            }
+            offset += len;
+        }
     }
-    if (0 == pCompressor->endStream())
+    else
+        len = -1;
+    close(fdSrc);
+    if ((len != -1) && (0 == pCompressor->endStream()))
     {
-        off_t size;
-        if (compressedFile.exactSize(&size) == 0)
+        off_t compressedSize;
+        if (compressedFile.exactSize(&compressedSize) == 0)
         {
             compressedFile.close();
-            unlink(pPath->buf());
-            rename(achFileName, pPath->buf());
+            unlink(pDest);
+            rename(achFileName, pDest);
 
             struct utimbuf utmbuf;
-            utmbuf.actime = m_fileData.getLastMod();
-            utmbuf.modtime = m_fileData.getLastMod();
-            utime(pPath->buf(), &utmbuf);
+            utmbuf.actime = tmLastMod;
+            utmbuf.modtime = tmLastMod;
+            utime(pDest, &utmbuf);
 
-            return size;
+            return compressedSize;
         }
     }
+    //VMemBuf removes the temporary file.
     return LS_FAIL;
 }
 
 
+int StaticFileCacheData::compressFile(char type)
+{
+    AutoStr2 *pPath = getCompressedPath(type);
+    return compressFileTo(m_real.c_str(), pPath->c_str(), type,
+                          getFileSize(), getLastMod());
+}
+
+
 int StaticFileCacheData::buildCompressedCache(FileCacheDataEx *&pData,
                                               const struct stat &st)
 {
@@ -740,69 +1125,91 @@ int StaticFileCacheData::buildCompressedCache(FileCacheDataEx *&pData,
 }
 
 
-int StaticFileCacheData::buildCompressedPaths()
+//Path of the compressed copy without the ".lsz"/".lsb"/".zst" suffix,
+//n + 6 bytes of pBuf are needed for suffix and lock file name.
+static int buildCompressedBasePath(const char *pReal, int len,
+                                   char *pBuf, int bufLen)
 {
     unsigned char achHash[MD5_DIGEST_LENGTH];
-    char achPath[4096];
-    StringTool::getMd5(m_real.c_str(), m_real.len(), achHash);
+    StringTool::getMd5(pReal, len, achHash);
     struct stat st;
-    int n = snprintf(achPath, 4096, "%s/%x/%x/", s_compressCachePath,
+    int n = snprintf(pBuf, bufLen, "%s/%x/%x/", s_compressCachePath,
                      achHash[0] >> 4, achHash[0] & 0xf);
-    if ((ls_fio_stat(achPath, &st) == -1) && (errno == ENOENT))
+    if (n + 30 + 6 > bufLen)
+        return LS_FAIL;
+    if ((ls_fio_stat(pBuf, &st) == -1) && (errno == ENOENT))
     {
-        achPath[n - 3] = 0;
-        mkdir(achPath, 0700);
-        achPath[n - 3] = '/';
-        if ((mkdir(achPath, 0700) == -1) && (errno != EEXIST))
+        pBuf[n - 3] = 0;
+        mkdir(pBuf, 0700);
+        pBuf[n - 3] = '/';
+        if ((mkdir(pBuf, 0700) == -1) && (errno != EEXIST))
             return LS_FAIL;
     }
 
     StringTool::hexEncode((const char *)&achHash[1], MD5_DIGEST_LENGTH - 1,
-                          &achPath[n]);
-    n += 30;
-    char *pReal = m_gzippedPath.prealloc(n + 6);
-    if ((!pReal) || (!m_bredPath.prealloc(n + 6)))
-        return LS_FAIL;
-    strncpy(pReal, achPath, n);
-    m_gzippedPath.setLen(n);
-    memmove(pReal + n , ".lsz\0\0", 6);
-    if (!m_bredPath.setStr(pReal, n + 6))
+                          &pBuf[n]);
+    return n + 30;
+}
+
+
+static int setCompressedPath(AutoStr2 &path, char *pBase, int n,
+                             const char *pSuffix)
+{
+    memcpy(pBase + n, pSuffix, 4);
+    if (!path.setStr(pBase, n + 6))
         return LS_FAIL;
-    char *pBred = m_bredPath.buf();
-    pBred[n + 3] = 'b'; // .lsb
-    m_bredPath.setLen(n);
+    path.setLen(n);
+    return 0;
+}
+
 
+int StaticFileCacheData::buildCompressedPaths()
+{
+    char achPath[4096];
+    int n = buildCompressedBasePath(m_real.c_str(), m_real.len(), achPath,
+                                    sizeof(achPath));
+    if (n == LS_FAIL)
+        return LS_FAIL;
+    achPath[n + 4] = achPath[n + 5] = 0;
+    // m_bredPath tells whether the paths have been built, set it last.
+    if ((setCompressedPath(m_gzippedPath, achPath, n,
+                           s_compressSuffix[SFCD_COMPRESS_GZIP]) == LS_FAIL)
+        || (setCompressedPath(m_zstdPath, achPath, n,
+                              s_compressSuffix[SFCD_COMPRESS_ZSTD]) == LS_FAIL)
+        || (setCompressedPath(m_bredPath, achPath, n,
+                              s_compressSuffix[SFCD_COMPRESS_BROTLI]) == LS_FAIL))
+        return LS_FAIL;
     return 0;
 }
 
 
-int StaticFileCacheData::setReadiedCompressData(char compressMode)
+FileCacheDataEx *StaticFileCacheData::setReadiedCompressData(
+    char compressMode)
 {
-    if ((compressMode & SFCD_MODE_BROTLI) && (m_pBrotli))
-    {
-        if ((m_pBrotli->isCached() ||
-            (m_pBrotli->getfd() != -1)))
-            return 0;
-        return m_pBrotli->readyData(m_bredPath.c_str());
-    }
-    if (m_pGzip)
+    for (int i = 0; i < SFCD_COMPRESS_TYPES; ++i)
     {
-        if ((m_pGzip->isCached() ||
-             (m_pGzip->getfd() != -1)))
-            return 0;
-        return m_pGzip->readyData(m_gzippedPath.c_str());
+        char type = s_compressOrder[i];
+        FileCacheDataEx *pData = getCompressedData(type);
+        //skip copies of an older version of the file
+        if (!(compressMode & (1 << type)) || !pData
+            || (pData->getLastMod() != getLastMod()))
+            continue;
+        if ((pData->isCached() || (pData->getfd() != -1))
+            || (pData->readyData(getCompressedPath(type)->c_str()) == 0))
+            return pData;
+        return NULL;
     }
-    return LS_FAIL;
+    return NULL;
 }
 
 
 int StaticFileCacheData::compressHelper(AutoStr2 &path, FileCacheDataEx *&pData,
-    struct stat &st, int exists, char isBrotli)
+    struct stat &st, int exists, char type)
 {
     int ret;
     if (exists != -1)
         unlink(path.c_str());
-    ret = tryCreateCompressed(isBrotli);
+    ret = tryCreateCompressed(type);
     if (ret == -1)
     {
         if (pData)
@@ -822,90 +1229,72 @@ int StaticFileCacheData::compressHelper(AutoStr2 &path, FileCacheDataEx *&pData,
 }
 
 
-int StaticFileCacheData::readyCompressed(char compressMode)
+FileCacheDataEx *StaticFileCacheData::readyCompressed(char compressMode)
 {
     LS_DBG_H("readyCompressed() compressMode %d", compressMode);
 
     time_t tm = time(NULL);
     if (tm == getLastMod())
-        return LS_FAIL;
+        return NULL;
 
     if (tm == m_tmLastCheck)
         return setReadiedCompressData(compressMode);
-    
-    int statBr = -1, retGz = -1, statGz = -1;
-    struct stat stGzip;
-    struct stat stBr;
+
+    struct stat st[SFCD_COMPRESS_TYPES];
+    int statRet[SFCD_COMPRESS_TYPES];
+    int preferred = -1, ready = -1;
     m_tmLastCheck = tm;
-    // Both paths matter, but bredPath is set last.
+    // All paths matter, but bredPath is set last.
     if (!m_bredPath.c_str() || !*m_bredPath.c_str())
     {
         if (buildCompressedPaths() == -1)
         {
             LS_ERROR("readyCompressed() buildCompressedPaths error.");
-            return LS_FAIL;
+            return NULL;
         }
     }
 
-    if (compressMode & SFCD_MODE_BROTLI)
+    for (int i = 0; i < SFCD_COMPRESS_TYPES; ++i)
     {
-        statBr = ls_fio_stat(m_bredPath.c_str(), &stBr);
-        LS_DBG_H("readyCompressed() path %s statBr %d",
-                 m_bredPath.c_str(), statBr);
+        int type = s_compressOrder[i];
+        if (!(compressMode & (1 << type)))
+            continue;
+        const char *pPath = getCompressedPath(type)->c_str();
+        statRet[type] = ls_fio_stat(pPath, &st[type]);
+        LS_DBG_H("readyCompressed() path %s stat %d", pPath, statRet[type]);
+        if (preferred == -1)
+            preferred = type;
+        if ((ready == -1) && (statRet[type] != -1)
+            && (st[type].st_mtime == getLastMod()))
+            ready = type;
     }
-    if (compressMode & SFCD_MODE_GZIP)
+    if (preferred == -1)
     {
-        statGz = ls_fio_stat(m_gzippedPath.c_str(), &stGzip);
-        retGz = ((statGz == -1)
-                || (stGzip.st_mtime != getLastMod()));
-        LS_DBG_H("readyCompressed() path %s statGz %d retGz %d",
-                 m_gzippedPath.c_str(), statGz, retGz);
+        LS_ERROR("Compress with all encodings turned off.");
+        return NULL;
     }
 
-    if (compressMode & SFCD_MODE_BROTLI) // brotli active AND not valid
+    if (ready != preferred)
     {
-        if ((statBr != -1) && (stBr.st_mtime == getLastMod()))
-        {
-            // use br
-        }
-        else if (!(compressMode & SFCD_MODE_GZIP) || retGz)
+        // (re)create the preferred copy, an up to date copy in another
+        // acceptable encoding is served until it is ready.
+        if (compressHelper(*getCompressedPath(preferred),
+                           getCompressedData(preferred), st[preferred],
+                           statRet[preferred], preferred) == LS_OK)
+            ready = preferred;
+        else if (ready == -1)
         {
-            // update br
-            if ((statBr = compressHelper(m_bredPath, m_pBrotli, stBr, statBr, 1)))
-            {
-                LS_DBG_H("readyCompressed compress br error %s.",
-                         m_bredPath.c_str());
-                return LS_FAIL;
-            }
-        }
-        else
-        {
-            compressMode &= ~SFCD_MODE_BROTLI;
-        }
-    }
-    else if (compressMode & SFCD_MODE_GZIP)
-    {
-        if (retGz && (statGz = compressHelper(m_gzippedPath, m_pGzip, stGzip, statGz, 0)))
-        {
-            LS_DBG_H("readyCompressed() compress gzip error %s or file size not suitable for gzip.",
-                    m_gzippedPath.c_str());
-            return LS_FAIL;
+            LS_DBG_H("readyCompressed() compress error %s or file size not "
+                     "suitable for compression.",
+                     getCompressedPath(preferred)->c_str());
+            return NULL;
         }
-        // else use gz
-    }
-    else
-    {
-        LS_ERROR("Compress with both Brotli and Gzip turned off.");
-        return LS_FAIL;
     }
 
-    if ((compressMode & SFCD_MODE_BROTLI)
-        && (statBr != -1) && ((!m_pBrotli) || (m_pBrotli->isDirty(stBr))))
-        buildCompressedCache(m_pBrotli, stBr);
-    else if ((compressMode & SFCD_MODE_GZIP)
-        && (statGz != -1) && ((!m_pGzip) || (m_pGzip->isDirty(stGzip))))
-        buildCompressedCache(m_pGzip, stGzip);
-    return setReadiedCompressData(compressMode);
+    FileCacheDataEx *&pData = getCompressedData(ready);
+    if ((!pData) || (pData->isDirty(st[ready])))
+        buildCompressedCache(pData, st[ready]);
+    return setReadiedCompressData(1 << ready);
 }
 
 
@@ -916,6 +1305,8 @@ int StaticFileCacheData::release()
         m_pGzip->release();
     if (m_pBrotli)
         m_pBrotli->release();
+    if (m_pZstd)
+        m_pZstd->release();
     return 0;
 }
 
@@ -940,3 +1331,56 @@ void StaticFileCacheData::setStaticBrOptions(int level)
 {
     s_iBrCompressLevel = level;
 }
+
+
+void StaticFileCacheData::setStaticZstdOptions(int level)
+{
+    s_iZstdCompressLevel = level;
+}
+
+
+void StaticFileCacheData::setCompressPrewarmDir(const char *pDir)
+{
+    if (s_compressPrewarmDir)
+        free((void *)s_compressPrewarmDir);
+    s_compressPrewarmDir = (pDir && *pDir) ? strdup(pDir) : NULL;
+}
+
+
+int StaticFileCacheData::startCompressPrewarm()
+{
+    if (!s_compressPrewarmDir || !s_iAutoUpdateStaticGzip)
+        return 0;
+    struct Offloader *pOffloader = getCompressOffloader();
+    if (!pOffloader)
+        return LS_FAIL;
+    sfcd_prewarm_task_t *pJob = (sfcd_prewarm_task_t *)calloc(1,
+                                sizeof(sfcd_prewarm_task_t));
+    if (!pJob)
+        return LS_FAIL;
+    pJob->m_header.ref_cnt = 1;
+    pJob->m_header.api = &s_prewarmApi;
+    pJob->m_header.param_task_done = pJob;
+    pJob->m_modes = SFCD_MODE_GZIP;
+#ifdef USE_BROTLI
+    if (HttpServerConfig::getInstance().getBrCompress() > 0)
+        pJob->m_modes |= SFCD_MODE_BROTLI;
+#endif
+#ifdef USE_ZSTD
+    if (HttpServerConfig::getInstance().getZstdCompress() > 0)
+        pJob->m_modes |= SFCD_MODE_ZSTD;
+#endif
+    //the MIME map is not thread safe, the worker only gets the suffixes
+    pJob->m_pSuffixes = new StringList();
+    if (HttpMime::getMime()->getCompressibleSuffixes(pJob->m_pSuffixes) == 0)
+    {
+        sfcdPrewarmRelease(&pJob->m_header);
+        return 0;
+    }
+    snprintf(pJob->m_achDir, sizeof(pJob->m_achDir), "%s", s_compressPrewarmDir);
+    LS_INFO("[Compress] Start pre-warming compressed files under %s.",
+            pJob->m_achDir);
+    int ret = offloader_enqueue(pOffloader, &pJob->m_header);
+    sfcdPrewarmRelease(&pJob->m_header);
+    return ret;
+}
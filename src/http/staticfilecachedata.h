@@ -33,6 +33,7 @@
 #define  DEFAULT_TOTAL_MMAP_CACHE  (1024 * 1024 * 20)     // 20M
 
 class HttpReq;
+class HttpRespHeaders;
 class StaticFileCacheData;
 class MimeSetting;
 class SsiScript;
@@ -113,15 +114,26 @@ public:
 
 };
 
-#define SFCD_MODE_GZIP      (1<<0)
-#define SFCD_MODE_BROTLI    (1<<1)
+enum
+{
+    SFCD_COMPRESS_GZIP,
+    SFCD_COMPRESS_BROTLI,
+    SFCD_COMPRESS_ZSTD,
+    SFCD_COMPRESS_TYPES
+};
+
+#define SFCD_MODE_GZIP      (1<<SFCD_COMPRESS_GZIP)
+#define SFCD_MODE_BROTLI    (1<<SFCD_COMPRESS_BROTLI)
+#define SFCD_MODE_ZSTD      (1<<SFCD_COMPRESS_ZSTD)
 
 class StaticFileCacheData : public CacheElement
 {
     AutoStr2        m_real;
     AutoStr2        m_gzippedPath;
     AutoStr2        m_bredPath;
+    AutoStr2        m_zstdPath;
     AutoStr2        m_sHeaders;
+    AutoStr2        m_sHpackHeaders;
 
     const MimeSetting *m_pMimeType;
     const AutoStr2     *m_pCharset;
@@ -131,6 +143,8 @@ class StaticFileCacheData : public CacheElement
     short           m_iFileETag;
     short           m_bypassModsec;
     int             m_iValidateHeaderLen;
+    short           m_iHpackETagLen;
+    short           m_iHpackRangeLen;
     SsiScript      *m_pSSIScript;
 
 
@@ -142,24 +156,42 @@ class StaticFileCacheData : public CacheElement
     time_t          m_tmLastCheck;
     FileCacheDataEx *m_pGzip;
     FileCacheDataEx *m_pBrotli;
+    FileCacheDataEx *m_pZstd;
     FileCacheDataEx m_fileData;
 
     StaticFileCacheData(const StaticFileCacheData &rhs);
     void operator=(const StaticFileCacheData &rhs);
 
     int buildFixedHeaders(int etag);
+    int buildHpackHeaders(const char *pContentType, int ctLen,
+                          const char *pLastMod);
     int buildCompressedCache(FileCacheDataEx *&pData, const struct stat &st);
-    int tryCreateCompressed(char useBrotli);
+    int tryCreateCompressed(char type);
     
     int buildCompressedPaths();
     int detectTrancate();
 
-    int setReadiedCompressData(char compressMode);
+    FileCacheDataEx *setReadiedCompressData(char compressMode);
     int compressHelper(AutoStr2 &path, FileCacheDataEx *&pData,
-        struct stat &st, int exists, char isBrotli);
+        struct stat &st, int exists, char type);
+
+    AutoStr2 *getCompressedPath(char type)
+    {
+        return (type == SFCD_COMPRESS_BROTLI) ? &m_bredPath :
+               (type == SFCD_COMPRESS_ZSTD) ? &m_zstdPath : &m_gzippedPath;
+    }
+    FileCacheDataEx *&getCompressedData(char type)
+    {
+        return (type == SFCD_COMPRESS_BROTLI) ? m_pBrotli :
+               (type == SFCD_COMPRESS_ZSTD) ? m_pZstd : m_pGzip;
+    }
 public:
 
-    int readyCompressed(char compressMode);
+    /**
+     * Returns the up to date compressed copy in the most preferred
+     * encoding of compressMode, or NULL if none is ready.
+     */
+    FileCacheDataEx *readyCompressed(char compressMode);
     const AutoStr2 * getRealPath() { return  &m_real; }
     off_t getFileSize() const   {   return m_fileData.getFileSize();    }
 
@@ -172,6 +204,8 @@ public:
     const char *getHeaderBuf() const    {   return m_sHeaders.c_str();  }
     int  getValidateHeaderLen() const   {   return m_iValidateHeaderLen;}
     int  getETagHeaderLen() const       {   return m_iETagLen + 8;      }
+    void attachHpackHeaders(HttpRespHeaders *pHeaders, int withETag,
+                            int withAcceptRange) const;
 
     StaticFileCacheData();
     ~StaticFileCacheData();
@@ -181,6 +215,7 @@ public:
 
     FileCacheDataEx *getGzip() const    {   return m_pGzip;             }
     FileCacheDataEx *getBrotli() const  {   return m_pBrotli;           }
+    FileCacheDataEx *getZstd() const    {   return m_pZstd;             }
     const FileCacheDataEx *getFileData() const {   return &m_fileData;  }
     FileCacheDataEx *getFileData()      {   return &m_fileData;         }
 
@@ -210,7 +245,7 @@ public:
         return (pMIME != m_pMimeType) || (pCharset != m_pCharset)
                || (m_iFileETag != etag);
     }
-    int compressFile(char useBrotli);
+    int compressFile(char type);
 
     int buildHeaders(const MimeSetting *pMIME,
                      const AutoStr2 *pCharset, short etag);
@@ -225,6 +260,14 @@ public:
     static void setCompressCachePath(const char *pPath);
 
     static void setStaticBrOptions(int level);
+    static void setStaticZstdOptions(int level);
+
+    /**
+     * Compressed copies of the compressible files under this directory
+     * tree are created in the background by startCompressPrewarm().
+     */
+    static void setCompressPrewarmDir(const char *pDir);
+    static int  startCompressPrewarm();
 };
 
 #endif
@@ -111,6 +111,8 @@ inline int buildStaticFileHeaders(HttpResp *pResp, HttpReq *pReq,
 
     pResp->getRespHeaders().appendAcceptRange();
 
+    pData->attachHpackHeaders(&pResp->getRespHeaders(),
+                        pSendfileInfo->getECache() == pData->getFileData(), 1);
     return 0;
 }
 
@@ -511,15 +513,17 @@ int StaticFileHandler::process(HttpSession *pSession,
     }
 
     char compressed = (((pReq->gzipAcceptable() == GZIP_REQUIRED)
-                        || (pReq->brAcceptable() == BR_REQUIRED)) &&
+                        || (pReq->brAcceptable() == BR_REQUIRED)
+                        || (pReq->zstdAcceptable() == ZSTD_REQUIRED)) &&
                        ((pSession->getSessionHooks()->getFlag(LSI_HKPT_RECV_RESP_BODY)
                          | pSession->getSessionHooks()->getFlag(LSI_HKPT_SEND_RESP_BODY))
                         & LSI_FLAG_DECOMPRESS_REQUIRED) == 0);
 
     char mode = (pReq->brAcceptable() == BR_REQUIRED ? SFCD_MODE_BROTLI : 0);
-    if (pReq->gzipAcceptable() == GZIP_REQUIRED &&
-        pReq->brAcceptable() != BR_REQUIRED)
+    if (pReq->gzipAcceptable() == GZIP_REQUIRED)
         mode |= SFCD_MODE_GZIP;
+    if (pReq->zstdAcceptable() == ZSTD_REQUIRED)
+        mode |= SFCD_MODE_ZSTD;
 
     ret = pInfo->readyCacheData(compressed, mode);
     LS_DBG_L(pReq->getLogSession(), "readyCacheData(%d, %d) return %d",
@@ -570,6 +574,11 @@ int StaticFileHandler::process(HttpSession *pSession,
                     pResp->addBrotliEncodingHeader();
                     pReq->orBr(UPSTREAM_BR);
                 }
+                if (pECache == pCache->getZstd())
+                {
+                    pResp->addZstdEncodingHeader();
+                    pReq->orZstd(UPSTREAM_ZSTD);
+                }
                 if (pECache == pCache->getGzip())
                 {
                     pResp->addGzipEncodingHeader();
@@ -671,6 +680,7 @@ static int buildRangeHeaders(HttpSession *pSession, HttpRange &range)
         pResp->getRespHeaders().add(HttpRespHeaders::H_CONTENT_TYPE,
                                     p + 14, pData->getHeaderLen() -
                                     (p - pData->getHeaderBuf()) - 14 - 2);
+        pData->attachHpackHeaders(&buf, 1, 0);
 
         off_t begin, end;
         int ret = range.getContentOffset(0, begin, end);
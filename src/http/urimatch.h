@@ -33,6 +33,7 @@ public:
     int set(const char *pExp, const char *subst);
     int match(const char *pURI, int uriLen,  char *pResult, int &len);
     int match(const char *pStr, int strLen);
+    const char *getPattern() const  {   return m_regex.getPattern();    }
     LS_NO_COPY_ASSIGN(URIMatch);
 };
 
@@ -18,7 +18,11 @@
 #include "userdir.h"
 
 #include <http/htpasswd.h>
+#include <http/httpsession.h>
 #include <http/httpstatuscode.h>
+#include <edio/multiplexerfactory.h>
+#include <log4cxx/logger.h>
+#include <lsr/ls_offload.h>
 #include <util/datetime.h>
 #include <util/pool.h>
 
@@ -26,13 +30,33 @@
     !defined(macintosh) && !defined(__APPLE__) && !defined(__APPLE_CC__)
 
 #include <crypt.h>
+#define USERDIR_CRYPT_R
 #else
 #include <unistd.h>
 #endif
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
 #include <openssl/md5.h>
+#include <openssl/rand.h>
 #include <openssl/sha.h>
+#include <stdlib.h>
 #include <string.h>
 
+//direct mapped, must be a power of 2
+#define AUTH_VERIFIED_SLOTS     1024
+
+typedef struct auth_verified_s
+{
+    unsigned char   m_key[AUTH_VERIFIED_KEY_LEN];
+    time_t          m_tmExpire;
+} auth_verified_t;
+
+static auth_verified_t  *s_pVerified = NULL;
+static unsigned char     s_achVerifiedSecret[32];
+static int               s_iVerifyCacheTimeout = 60;
+static int               s_iVerifyWorkers = 2;
+static struct Offloader *s_pVerifyOffloader = NULL;
+
 
 
 UserDir::~UserDir()
@@ -406,6 +430,272 @@ static int verifyApMD5(const char *pStored, const char *pPasswd)
 }
 
 
+static int verifyCrypt(const char *pStored, const char *pPasswd,
+                       int reentrant)
+{
+    const char *pResult;
+#ifdef USERDIR_CRYPT_R
+    if (reentrant)
+    {
+        struct crypt_data data;
+        memset(&data, 0, sizeof(data));
+        pResult = crypt_r(pPasswd, pStored, &data);
+        return (pResult == NULL) || strcmp(pStored, pResult);
+    }
+#endif
+    pResult = crypt(pPasswd, pStored);
+    return (pResult == NULL) || strcmp(pStored, pResult);
+}
+
+
+/**
+ * Returns 0 if pPasswd matches the stored password. reentrant must be set
+ * when called off the event loop thread.
+ */
+int UserDir::verifyPasswd(int method, const char *pStored,
+                          const char *pPasswd, int reentrant)
+{
+    switch (method)
+    {
+    case ENCRYPT_UNKNOWN:
+    case ENCRYPT_PLAIN:
+        if (strcmp(pPasswd, pStored) == 0)
+            return 0;
+    //fall through
+    case ENCRYPT_CRYPT:
+        return verifyCrypt(pStored, pPasswd, reentrant);
+    case ENCRYPT_MD5:
+        return verifyMD5(pStored, pPasswd, 0);
+    case ENCRYPT_APMD5:
+        return verifyApMD5(pStored, pPasswd);
+    case ENCRYPT_SHA:
+        return verifySHA(pStored, pPasswd, 0);
+    case ENCRYPT_SMD5:
+        return verifyMD5(pStored, pPasswd, 1);
+    case ENCRYPT_SSHA:
+        return verifySHA(pStored, pPasswd, 1);
+    }
+    return 1;
+}
+
+
+//"$2y$", "$5$", "$6$"... costs milliseconds per check, DES crypt and
+//the digests below do not
+static int isSlowHash(int method, const char *pStored)
+{
+    return (method == ENCRYPT_UNKNOWN || method == ENCRYPT_PLAIN
+            || method == ENCRYPT_CRYPT) && *pStored == '$';
+}
+
+
+void UserDir::setVerifyCacheTimeout(int sec)
+{
+    s_iVerifyCacheTimeout = sec;
+}
+
+
+void UserDir::setVerifyWorkers(int n)
+{
+    s_iVerifyWorkers = n;
+}
+
+
+/**
+ * Derives the cache key of a verified credential, an HMAC over the user,
+ * the password and the stored hash with a per process secret. A changed
+ * password file invalidates the entry, and the cache never holds anything
+ * a password could be recovered from.
+ */
+int UserDir::getVerifiedKey(const char *pUser, int userLen,
+                            const char *pPasswd, const char *pStored,
+                            unsigned char *pKey)
+{
+    char achBuf[1024];
+    unsigned char achMac[EVP_MAX_MD_SIZE];
+    unsigned int macLen;
+    int passLen = strlen(pPasswd);
+    int storedLen = strlen(pStored);
+    if (s_iVerifyCacheTimeout <= 0
+        || userLen + passLen + storedLen + 2 > (int)sizeof(achBuf))
+        return LS_FAIL;
+    if (!s_pVerified)
+    {
+        if (RAND_bytes(s_achVerifiedSecret, sizeof(s_achVerifiedSecret)) != 1)
+            return LS_FAIL;
+        s_pVerified = (auth_verified_t *)calloc(AUTH_VERIFIED_SLOTS,
+                                                sizeof(auth_verified_t));
+        if (!s_pVerified)
+            return LS_FAIL;
+    }
+    char *p = achBuf;
+    memcpy(p, pUser, userLen);
+    p += userLen;
+    *p++ = 0;
+    memcpy(p, pPasswd, passLen);
+    p += passLen;
+    *p++ = 0;
+    memcpy(p, pStored, storedLen);
+    p += storedLen;
+    HMAC(EVP_sha256(), s_achVerifiedSecret, sizeof(s_achVerifiedSecret),
+         (const unsigned char *)achBuf, p - achBuf, achMac, &macLen);
+    memset(achBuf, 0, p - achBuf);
+    memcpy(pKey, achMac, AUTH_VERIFIED_KEY_LEN);
+    return LS_OK;
+}
+
+
+static auth_verified_t *getVerifiedSlot(const unsigned char *pKey)
+{
+    uint32_t slot;
+    memcpy(&slot, pKey, sizeof(slot));
+    return &s_pVerified[slot & (AUTH_VERIFIED_SLOTS - 1)];
+}
+
+
+int UserDir::isVerified(const unsigned char *pKey)
+{
+    auth_verified_t *pEntry = getVerifiedSlot(pKey);
+    return (pEntry->m_tmExpire > DateTime::s_curTime
+            && memcmp(pEntry->m_key, pKey, AUTH_VERIFIED_KEY_LEN) == 0);
+}
+
+
+void UserDir::addVerified(const unsigned char *pKey)
+{
+    auth_verified_t *pEntry = getVerifiedSlot(pKey);
+    memcpy(pEntry->m_key, pKey, AUTH_VERIFIED_KEY_LEN);
+    pEntry->m_tmExpire = DateTime::s_curTime + s_iVerifyCacheTimeout;
+}
+
+
+typedef struct auth_verify_task
+{
+    ls_offload_t    m_header;
+    HttpSession    *m_pSession;
+    int             m_iMethod;
+    int             m_iResult;
+    int             m_iCache;
+    unsigned char   m_key[AUTH_VERIFIED_KEY_LEN];
+    char           *m_pStored;
+    char           *m_pPasswd;
+} auth_verify_task_t;
+
+
+static int authVerifyPerform(ls_offload_t *pTask)
+{
+    auth_verify_task_t *pJob = (auth_verify_task_t *)pTask;
+    pJob->m_iResult = UserDir::verifyPasswd(pJob->m_iMethod, pJob->m_pStored,
+                                            pJob->m_pPasswd, 1);
+    return 0;
+}
+
+
+static void authVerifyRelease(ls_offload_t *pTask)
+{
+    auth_verify_task_t *pJob = (auth_verify_task_t *)pTask;
+    if (--pJob->m_header.ref_cnt > 0)
+        return;
+    if (pJob->m_pPasswd)
+    {
+        memset(pJob->m_pPasswd, 0, strlen(pJob->m_pPasswd));
+        free(pJob->m_pPasswd);
+    }
+    free(pJob->m_pStored);
+    free(pJob);
+}
+
+
+static void authVerifyDone(void *param)
+{
+    auth_verify_task_t *pJob = (auth_verify_task_t *)param;
+    if (pJob->m_iResult == 0 && pJob->m_iCache)
+        UserDir::addVerified(pJob->m_key);
+    if (pJob->m_pSession)
+        pJob->m_pSession->authVerified(pJob->m_iResult ? SC_401 : 0);
+}
+
+
+static ls_offload_api s_verifyApi =
+{
+    authVerifyPerform,
+    authVerifyRelease,
+    authVerifyDone
+};
+
+
+static struct Offloader *getVerifyOffloader()
+{
+    if (!s_pVerifyOffloader && s_iVerifyWorkers > 0
+        && MultiplexerFactory::getMultiplexer())
+        s_pVerifyOffloader = offloader_new("AUTH", s_iVerifyWorkers);
+    return s_pVerifyOffloader;
+}
+
+
+/**
+ * Drops the reference the session holds on a pending verification. If the
+ * worker is not done yet its result is discarded.
+ */
+void UserDir::releaseVerify(struct ls_offload *pTask)
+{
+    auth_verify_task_t *pJob = (auth_verify_task_t *)pTask;
+    pJob->m_pSession = NULL;
+    pJob->m_header.is_canceled = 1;
+    authVerifyRelease(pTask);
+}
+
+
+/**
+ * Hands a slow password hash to a worker thread. Returns 1 if the request
+ * is suspended until HttpSession::authVerified(), 0 if the caller has to
+ * verify in place.
+ */
+static int offloadVerify(HttpSession *pSession, int method,
+                         const char *pStored, const char *pPasswd,
+                         const unsigned char *pKey)
+{
+#ifdef USERDIR_CRYPT_R
+    struct Offloader *pOffloader = getVerifyOffloader();
+    if (!pOffloader)
+        return 0;
+    auth_verify_task_t *pJob = (auth_verify_task_t *)calloc(1,
+                               sizeof(auth_verify_task_t));
+    if (!pJob)
+        return 0;
+    pJob->m_header.ref_cnt = 1;
+    pJob->m_header.api = &s_verifyApi;
+    pJob->m_header.param_task_done = pJob;
+    pJob->m_pSession = pSession;
+    pJob->m_iMethod = method;
+    pJob->m_pStored = strdup(pStored);
+    pJob->m_pPasswd = strdup(pPasswd);
+    if (pKey)
+    {
+        memcpy(pJob->m_key, pKey, AUTH_VERIFIED_KEY_LEN);
+        pJob->m_iCache = 1;
+    }
+    if (!pJob->m_pStored || !pJob->m_pPasswd
+        || offloader_enqueue(pOffloader, &pJob->m_header) == -1)
+    {
+        authVerifyRelease(&pJob->m_header);
+        return 0;
+    }
+    pSession->setAuthTask(&pJob->m_header);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ * Returns 0 if authenticated, -1 if the request has to wait for the
+ * password check done by a worker thread, or an HTTP status code.
+ *
+ * A password matching a slow crypt() hash is remembered for the verify
+ * cache timeout, so a client sending the same credentials with every
+ * request costs one hash computation, not one per request.
+ */
 int UserDir::authenticate(HttpSession *pSession, const char *pUserName,
                           int len,
                           const char *pPasswd, int encryptMethod,
@@ -421,42 +711,25 @@ int UserDir::authenticate(HttpSession *pSession, const char *pUserName,
     const char *pStored = pUser->getPasswd();
 //    if (( encryptMethod == m_encryptMethod )||
 //        ( m_encryptMethod == AuthUser::ENCRYPT_UNKNOWN ))
-    if (pStored)
-    {
-        switch (pUser->getEncMethod())
-        {
-        case ENCRYPT_UNKNOWN:
-        case ENCRYPT_PLAIN:
-            if (strcmp(pPasswd, pUser->getPasswd()) == 0)
-                return 0;
-        //fall through
-        case ENCRYPT_CRYPT:
-            if (strcmp(pStored, crypt(pPasswd, pStored)) == 0)
-                return 0;
-            break;
-        case ENCRYPT_MD5:
-            if (verifyMD5(pStored, pPasswd, 0) == 0)
-                return 0;
-            break;
-        case ENCRYPT_APMD5:
-            if (verifyApMD5(pStored, pPasswd) == 0)
-                return 0;
-            break;
-        case ENCRYPT_SHA:
-            if (verifySHA(pStored, pPasswd, 0) == 0)
-                return 0;
-            break;
-        case ENCRYPT_SMD5:
-            if (verifyMD5(pStored, pPasswd, 1) == 0)
-                return 0;
-            break;
-        case ENCRYPT_SSHA:
-            if (verifySHA(pStored, pPasswd, 1) == 0)
-                return 0;
-            break;
-        }
-    }
-    return SC_401;
+    if (!pStored)
+        return SC_401;
+    int method = pUser->getEncMethod();
+    if (!isSlowHash(method, pStored))
+        return verifyPasswd(method, pStored, pPasswd, 0) ? SC_401 : 0;
+
+    unsigned char achKey[AUTH_VERIFIED_KEY_LEN];
+    int cache = (getVerifiedKey(pUserName, len, pPasswd, pStored, achKey)
+                 == LS_OK);
+    if (cache && isVerified(achKey))
+        return 0;
+    if (pSession && offloadVerify(pSession, method, pStored, pPasswd,
+                                  cache ? achKey : NULL))
+        return -1;
+    if (verifyPasswd(method, pStored, pPasswd, 0) != 0)
+        return SC_401;
+    if (cache)
+        addVerified(achKey);
+    return 0;
 }
 
 
@@ -25,6 +25,9 @@
 
 class AutoStr2;
 class HttpSession;
+struct ls_offload;
+
+#define AUTH_VERIFIED_KEY_LEN   16
 
 class AuthRequired
 {
@@ -88,6 +91,18 @@ public:
                              const char *pPasswd, int encryptMethod,
                              const AuthRequired *pRequired);
 
+    static void setVerifyCacheTimeout(int sec);
+    static void setVerifyWorkers(int n);
+    static void releaseVerify(struct ls_offload *pTask);
+
+    static int  verifyPasswd(int method, const char *pStored,
+                             const char *pPasswd, int reentrant);
+    static int  getVerifiedKey(const char *pUser, int userLen,
+                               const char *pPasswd, const char *pStored,
+                               unsigned char *pKey);
+    static int  isVerified(const unsigned char *pKey);
+    static void addVerified(const unsigned char *pKey);
+
     virtual AuthUser *getUserFromStore(HttpSession *pSession,
                                        HashDataCache *pCache,
                                        const char *pUser, int len, int *ready) = 0;
@@ -20,16 +20,19 @@
 #include <lsdef.h>
 #include <http/httpvhost.h>
 #include <http/httpvhostlist.h>
+#include <http/vhostsslcache.h>
 #include <log4cxx/logger.h>
 #include <lsr/ls_strtool.h>
 #include <main/zconfmanager.h>
 #include <socket/gsockaddr.h>
 #include <sslpp/sslcontext.h>
 #include <util/autobuf.h>
+#include <util/domaintrie.h>
 #include <util/stringlist.h>
 #include <util/stringtool.h>
 
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -40,11 +43,13 @@ class WildMatch
     HttpVHost        *m_pVHost;
     StringList       *m_pParsed;
     const char       *m_pPattern;
+    int               m_iSeq;
 public:
-    WildMatch(HttpVHost *pVHost, const char *pPattern)
+    WildMatch(HttpVHost *pVHost, const char *pPattern, int seq)
         : m_pVHost(pVHost)
         , m_pParsed(NULL)
         , m_pPattern(pPattern)
+        , m_iSeq(seq)
     {
         m_pParsed = StringTool::parseMatchPattern(pPattern);
     }
@@ -59,6 +64,7 @@ public:
     HttpVHost   *getVHost()   const {   return m_pVHost;    }
     const char *getPattern() const {   return m_pPattern;  }
     StringList *getParsed()  const {   return m_pParsed;   }
+    int getSeq()             const {   return m_iSeq;      }
     int match(const char *pHostName, const char *pEnd) const
     {
         return StringTool::strMatch(pHostName, pEnd,
@@ -72,6 +78,9 @@ VHostMap::VHostMap()
     : m_pCatchAll(NULL)
     , m_pDedicated(NULL)
     , m_pWildMatches(NULL)
+    , m_pWildOthers(NULL)
+    , m_pWildTrie(NULL)
+    , m_iWildSeq(0)
     , m_pSslContext(NULL)
     , m_pQuicListener(NULL)
     , m_iNamedVH(0)
@@ -90,18 +99,45 @@ VHostMap::~VHostMap()
 }
 
 
+/**
+ * "*.suffix" patterns are looked up in the label trie, the other patterns
+ * are kept in configuration order and matched one by one. The earliest
+ * configured pattern wins either way, so the scan stops as soon as it
+ * passes the sequence number of the trie match.
+ */
 HttpVHost *VHostMap::wildMatch(const char *pHost, const char *pEnd) const
 {
+    int seq = INT_MAX;
+    WildMatch *pMatch = (WildMatch *)m_pWildTrie->match(pHost, pEnd, &seq);
     WildMatchList::iterator iter;
-    for (iter = m_pWildMatches->begin(); iter != m_pWildMatches->end(); ++iter)
+    for (iter = m_pWildOthers->begin(); iter != m_pWildOthers->end(); ++iter)
     {
+        if ((*iter)->getSeq() > seq)
+            break;
         if ((*iter)->match(pHost, pEnd) == 0)
             return (*iter)->getVHost();
     }
+    if (pMatch)
+        return pMatch->getVHost();
     return m_pCatchAll;
 }
 
 
+WildMatch *VHostMap::findWildMatch(const char *pPattern) const
+{
+    const char *pSuffix = DomainTrie::getSuffix(pPattern);
+    if (pSuffix)
+        return (WildMatch *)m_pWildTrie->find(pSuffix);
+    WildMatchList::iterator iter;
+    for (iter = m_pWildOthers->begin(); iter != m_pWildOthers->end(); ++iter)
+    {
+        if (strcasecmp((*iter)->getPattern(), pPattern) == 0)
+            return *iter;
+    }
+    return NULL;
+}
+
+
 static inline int isWildMatch(const char *pchKey)
 {
     return (strpbrk(pchKey, "*?") != NULL);
@@ -110,35 +146,35 @@ static inline int isWildMatch(const char *pchKey)
 
 int VHostMap::addWildMatch(const char *pchKey, HttpVHost *pHost)
 {
+    WildMatch *pMatch;
     if (!m_pWildMatches)
     {
         m_pWildMatches = new WildMatchList();
-        if (!m_pWildMatches)
-            return LS_FAIL;
+        m_pWildOthers = new WildMatchList();
+        m_pWildTrie = new DomainTrie();
     }
-    else
+    else if ((pMatch = findWildMatch(pchKey)) != NULL)
     {
-        WildMatchList::iterator iter;
-        for (iter = m_pWildMatches->begin(); iter != m_pWildMatches->end(); ++iter)
-        {
-            if (strcasecmp((*iter)->getPattern(), pchKey) == 0)
-            {
-                if ((*iter)->getVHost() == pHost)
-                    return 0;
-                HttpVHostMap::decRef((*iter)->getVHost());
-                (*iter)->setVHost(pHost);
-            }
-        }
+        if (pMatch->getVHost() == pHost)
+            return 0;
+        HttpVHostMap::decRef(pMatch->getVHost());
+        pMatch->setVHost(pHost);
+        pMatch->setPattern(pchKey);
+        HttpVHostMap::incRef(pHost);
+        return 0;
     }
-    WildMatch *pMatch = new WildMatch(pHost, pchKey);
-    if (!pMatch)
-        return LS_FAIL;
+    pMatch = new WildMatch(pHost, pchKey, m_iWildSeq++);
     if ((!pMatch->getParsed()) ||
         (m_pWildMatches->push_back(pMatch) != 0))
     {
         delete pMatch;
         return LS_FAIL;
     }
+    const char *pSuffix = DomainTrie::getSuffix(pchKey);
+    if (pSuffix)
+        m_pWildTrie->add(pSuffix, pMatch, pMatch->getSeq());
+    else
+        m_pWildOthers->push_back(pMatch);
     HttpVHostMap::incRef(pHost);
     return 0;
 }
@@ -147,6 +183,25 @@ int VHostMap::addWildMatch(const char *pchKey, HttpVHost *pHost)
 void VHostMap::removeWildMatch(WildMatchList::iterator iter)
 {
     WildMatch *pMatch = *iter;
+    const char *pSuffix = DomainTrie::getSuffix(pMatch->getPattern());
+    if (pSuffix)
+        m_pWildTrie->remove(pSuffix);
+    else
+    {
+        //keep the configuration order wildMatch() relies on
+        WildMatchList::iterator other;
+        for (other = m_pWildOthers->begin(); other != m_pWildOthers->end();
+             ++other)
+        {
+            if (*other == pMatch)
+            {
+                memmove(other, other + 1,
+                        (m_pWildOthers->end() - other - 1) * sizeof(*other));
+                m_pWildOthers->pop_back();
+                break;
+            }
+        }
+    }
     HttpVHostMap::decRef(pMatch->getVHost());
     m_pWildMatches->erase(iter);
     delete pMatch;
@@ -316,6 +371,10 @@ void VHostMap::clear()
         m_pWildMatches->release_objects();
         delete m_pWildMatches;
         m_pWildMatches = NULL;
+        delete m_pWildOthers;
+        m_pWildOthers = NULL;
+        delete m_pWildTrie;
+        m_pWildTrie = NULL;
     }
 
 }
@@ -434,12 +493,9 @@ HttpVHost *VHostMap::exactMatchVHost(const char *pHost) const
         return iter1.second();
     if (m_pWildMatches)
     {
-        WildMatchList::iterator iter;
-        for (iter = m_pWildMatches->begin(); iter != m_pWildMatches->end(); ++iter)
-        {
-            if (strcasecmp(pHost, (*iter)->getPattern()) == 0)
-                return (*iter)->getVHost();
-        }
+        WildMatch *pMatch = findWildMatch(pHost);
+        if (pMatch)
+            return pMatch->getVHost();
     }
     return NULL;
 }
@@ -704,8 +760,12 @@ SslContext *VHostMapFindSslContext(void *arg, const char *pName)
             pVHost = pMap->matchVHost(pHost, pHostEnd);
         }
     }
-    if (pVHost && pVHost->getSslContext())
-        return pVHost->getSslContext();
+    if (pVHost)
+    {
+        SslContext *pCtx = pVHost->loadSslContext();
+        if (pCtx)
+            return pCtx;
+    }
     return pMap->getSslContext();
 
 }
@@ -756,10 +816,17 @@ static int zconfForEachVHostSSL(const void *pKey, void *pData, void *pUData)
 {
     HttpVHost *pVHost = (HttpVHost *)pKey;
     AutoBuf *pVHostBuf = (AutoBuf *)pData;
-    ZConfManager::getInstance().appendSslContext(
-        pVHostBuf->begin(),
-        pVHostBuf->size() - 1, // Remove trailing comma
-        pVHost->getSslContext());
+    LazySslContext *pLazy = pVHost->getLazySslContext();
+    if (pLazy)
+        ZConfManager::getInstance().appendSslConfig(
+            pVHostBuf->begin(),
+            pVHostBuf->size() - 1, // Remove trailing comma
+            pLazy->getConfig());
+    else
+        ZConfManager::getInstance().appendSslContext(
+            pVHostBuf->begin(),
+            pVHostBuf->size() - 1, // Remove trailing comma
+            pVHost->getSslContext());
 
     return zconfForEachVHost(NULL, pData, pUData);
 }
@@ -28,6 +28,7 @@
 #include <inttypes.h>
 
 class AutoBuf;
+class DomainTrie;
 class HttpVHost;
 class HttpVHostMap;
 class WildMatch;
@@ -39,6 +40,9 @@ class VHostMap : private HashStringMap< HttpVHost * >, public RefCounter
     HttpVHost        *m_pCatchAll;
     HttpVHost        *m_pDedicated;
     WildMatchList    *m_pWildMatches;
+    WildMatchList    *m_pWildOthers;
+    DomainTrie       *m_pWildTrie;
+    int               m_iWildSeq;
     SslContext       *m_pSslContext;
     UdpListener      *m_pQuicListener;
     AutoStr2          m_sAddr;
@@ -54,6 +58,7 @@ class VHostMap : private HashStringMap< HttpVHost * >, public RefCounter
     int addWildMatch(const char *pchKey, HttpVHost *pHost);
     int removeWildMatch(const char *pName);
     HttpVHost *wildMatch(const char *pHost, const char *pEnd) const;
+    WildMatch *findWildMatch(const char *pPattern) const;
     void removeWildMatch(WildMatchList::iterator iter);
 
     void zconfAppendWildMatchList(GHash *pHash);
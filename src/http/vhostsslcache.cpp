@@ -0,0 +1,188 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "vhostsslcache.h"
+
+#include <http/shmmetrics.h>
+#include <log4cxx/logger.h>
+#include <sslpp/sslcontext.h>
+#include <sslpp/sslcontextconfig.h>
+#include <util/datetime.h>
+
+#include <sys/time.h>
+
+LS_SINGLETON(VHostSslCache);
+
+int VHostSslCache::s_iMaxContexts = 0;
+int VHostSslCache::s_iIdleTimeout = 600;
+
+
+LazySslContext::LazySslContext(SslContextConfig *pConfig)
+    : m_pConfig(pConfig)
+    , m_pCtx(NULL)
+    , m_tmLastAccess(0)
+    , m_tmFailed(0)
+{
+}
+
+
+LazySslContext::~LazySslContext()
+{
+    if (m_pCtx)
+        delete m_pCtx;
+    delete m_pConfig;
+}
+
+
+const char *LazySslContext::getName() const
+{
+    return m_pConfig->m_sName.c_str();
+}
+
+
+VHostSslCache::VHostSslCache()
+{
+}
+
+
+VHostSslCache::~VHostSslCache()
+{
+}
+
+
+static long long nowUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+SslContext *VHostSslCache::build(LazySslContext *pLazy)
+{
+    long long start = nowUs();
+    SslContext *pCtx = SslContext::config(NULL, pLazy->m_pConfig);
+    long long us = nowUs() - start;
+    if (!pCtx)
+    {
+        LS_ERROR("[SSL] [%s] failed to create SSLContext on demand, "
+                 "retry in %d seconds.", pLazy->getName(),
+                 SSLCTX_RETRY_INTERVAL);
+        ShmMetrics::incTlsCtx(ShmMetrics::TLS_CTX_FAIL);
+        return NULL;
+    }
+#ifdef _ENTERPRISE_
+    const SslContextConfig *pConfig = pLazy->m_pConfig;
+    if (pConfig->m_iClientVerify)
+    {
+        pCtx->setClientVerify(pConfig->m_iClientVerify,
+                              pConfig->m_iVerifyDepth);
+        if (pConfig->m_sCRLFile.c_str() || pConfig->m_sCRLPath.c_str())
+            pCtx->addCRL(pConfig->m_sCRLFile.c_str(),
+                         pConfig->m_sCRLPath.c_str());
+    }
+#endif
+    ShmMetrics::addTlsCtxBuild(us);
+    LS_DBG_L("[SSL] [%s] created SSLContext on demand in %lld us, "
+             "%d contexts loaded.", pLazy->getName(), us, m_lru.size() + 1);
+    return pCtx;
+}
+
+
+/**
+ * Returns the SslContext of a lazy vhost, building it on the first call.
+ * A failed build is not retried for SSLCTX_RETRY_INTERVAL seconds, so a
+ * broken certificate does not cost a file load on every handshake.
+ */
+SslContext *VHostSslCache::get(LazySslContext *pLazy)
+{
+    long tmNow = DateTime::s_curTime;
+    if (pLazy->m_pCtx)
+    {
+        ShmMetrics::incTlsCtx(ShmMetrics::TLS_CTX_HIT);
+        pLazy->m_tmLastAccess = tmNow;
+        if (m_lru.begin() != pLazy)
+        {
+            m_lru.remove(pLazy);
+            m_lru.push_front(pLazy);
+        }
+        return pLazy->m_pCtx;
+    }
+    if (pLazy->m_tmFailed
+        && tmNow - pLazy->m_tmFailed < SSLCTX_RETRY_INTERVAL)
+        return NULL;
+
+    ShmMetrics::incTlsCtx(ShmMetrics::TLS_CTX_MISS);
+    pLazy->m_pCtx = build(pLazy);
+    if (!pLazy->m_pCtx)
+    {
+        pLazy->m_tmFailed = tmNow;
+        return NULL;
+    }
+    pLazy->m_tmFailed = 0;
+    pLazy->m_tmLastAccess = tmNow;
+    m_lru.push_front(pLazy);
+    if (m_lru.size() > s_iMaxContexts)
+        evict(tmNow);
+    return pLazy->m_pCtx;
+}
+
+
+void VHostSslCache::release(LazySslContext *pLazy)
+{
+    m_lru.remove(pLazy);
+    delete pLazy->m_pCtx;
+    pLazy->m_pCtx = NULL;
+}
+
+
+/**
+ * Releases contexts from the LRU end that are idle for longer than the
+ * idle timeout, or while the cache is over its limit, but only those
+ * unused for SSLCTX_MIN_IDLE seconds. The cache stays over the limit while
+ * the context at the LRU end is more recent than that.
+ */
+void VHostSslCache::evict(long tmNow)
+{
+    while (!m_lru.empty())
+    {
+        LazySslContext *pLazy = (LazySslContext *)m_lru.rbegin();
+        long idle = tmNow - pLazy->m_tmLastAccess;
+        if (idle < SSLCTX_MIN_IDLE)
+            break;
+        if (idle < s_iIdleTimeout && m_lru.size() <= s_iMaxContexts)
+            break;
+        LS_DBG_L("[SSL] [%s] release SSLContext idle for %ld seconds.",
+                 pLazy->getName(), idle);
+        release(pLazy);
+        ShmMetrics::incTlsCtx(ShmMetrics::TLS_CTX_EVICT);
+    }
+}
+
+
+void VHostSslCache::remove(LazySslContext *pLazy)
+{
+    if (pLazy->m_pCtx)
+        release(pLazy);
+}
+
+
+void VHostSslCache::onTimer()
+{
+    if (!m_lru.empty())
+        evict(DateTime::s_curTime);
+}
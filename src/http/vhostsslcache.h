@@ -0,0 +1,103 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef VHOSTSSLCACHE_H
+#define VHOSTSSLCACHE_H
+
+#include <lsdef.h>
+#include <util/linkedobj.h>
+#include <util/dlinkqueue.h>
+#include <util/tsingleton.h>
+
+//an evicted context may still be in use by a handshake started before
+#define SSLCTX_MIN_IDLE         120
+#define SSLCTX_RETRY_INTERVAL   60
+
+class SslContext;
+class SslContextConfig;
+
+
+/**
+ * The certificate settings of a vhost whose SslContext is built on the
+ * first handshake that asks for it, rather than at startup. Only the
+ * parsed config is kept until then.
+ */
+class LazySslContext : public DLinkedObj
+{
+    friend class VHostSslCache;
+
+public:
+    explicit LazySslContext(SslContextConfig *pConfig);
+    ~LazySslContext();
+
+    const char *getName() const;
+    const SslContextConfig *getConfig() const   {   return m_pConfig;   }
+    SslContext *getContext() const  {   return m_pCtx;          }
+
+private:
+    SslContextConfig   *m_pConfig;
+    SslContext         *m_pCtx;
+    long                m_tmLastAccess;
+    long                m_tmFailed;
+
+    LS_NO_COPY_ASSIGN(LazySslContext);
+};
+
+
+/**
+ * Keeps the SslContexts built for LazySslContexts in LRU order. Contexts
+ * idle for longer than the idle timeout are released by onTimer(), and the
+ * least recently used ones are released when the cache is over its limit.
+ *
+ * The limit is a soft one: a context used within the last SSLCTX_MIN_IDLE
+ * seconds is never released, as a handshake may still refer to it, so the
+ * cache holds every certificate used in that window even if there are more
+ * than the limit. It shrinks back once they go idle.
+ */
+class VHostSslCache : public TSingleton<VHostSslCache>
+{
+    friend class TSingleton<VHostSslCache>;
+
+public:
+    static void setMaxContexts(int n)   {   s_iMaxContexts = n;     }
+    static int  getMaxContexts()        {   return s_iMaxContexts;  }
+    static void setIdleTimeout(int sec) {   s_iIdleTimeout = sec;   }
+    static int  isEnabled()             {   return s_iMaxContexts > 0;  }
+
+    SslContext *get(LazySslContext *pLazy);
+    void remove(LazySslContext *pLazy);
+    void onTimer();
+
+    int getCount() const                {   return m_lru.size();    }
+
+private:
+    VHostSslCache();
+    ~VHostSslCache();
+
+    SslContext *build(LazySslContext *pLazy);
+    void release(LazySslContext *pLazy);
+    void evict(long tmNow);
+
+    DLinkQueue  m_lru;      //most recently used first
+
+    static int  s_iMaxContexts;
+    static int  s_iIdleTimeout;
+
+    LS_NO_COPY_ASSIGN(VHostSslCache);
+};
+
+#endif // VHOSTSSLCACHE_H
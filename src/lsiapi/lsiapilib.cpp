@@ -1539,6 +1539,8 @@ static int get_resp_buffer_compress_method(const lsi_session_t *session)
 
     if (pSession->getFlag(HSF_RESP_BODY_BRCOMPRESSED))
         return LSI_BR_COMPRESS;
+    else if (pSession->getFlag(HSF_RESP_BODY_ZSTDCOMPRESSED))
+        return LSI_ZSTD_COMPRESS;
     else if (pSession->getFlag(HSF_RESP_BODY_GZIPCOMPRESSED))
         return LSI_GZIP_COMPRESS;
     return LSI_NO_COMPRESS;//0
@@ -1553,8 +1555,11 @@ static int set_resp_buffer_compress_method(const lsi_session_t *session, int met
 
     pSession->clearFlag(HSF_RESP_BODY_BRCOMPRESSED);
     pSession->clearFlag(HSF_RESP_BODY_GZIPCOMPRESSED);
+    pSession->clearFlag(HSF_RESP_BODY_ZSTDCOMPRESSED);
     if (method == LSI_BR_COMPRESS)
         pSession->setFlag(HSF_RESP_BODY_BRCOMPRESSED);
+    else if (method == LSI_ZSTD_COMPRESS)
+        pSession->setFlag(HSF_RESP_BODY_ZSTDCOMPRESSED);
     else if (method == LSI_GZIP_COMPRESS)
         pSession->setFlag(HSF_RESP_BODY_GZIPCOMPRESSED);
 
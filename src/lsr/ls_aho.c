@@ -349,9 +349,12 @@ unsigned int ls_aho_search(ls_aho_t *pThis, ls_aho_state_t *start_state,
             }
             if (iChildPtr == iNumChildren)
             {
-                start_state = start_state->fail;
+                // the zero state's children must be tried as well, or a
+                // pattern starting right where a partial match failed is
+                // missed, "ac" in "aac".
                 if (start_state == pZero)
                     break;
+                start_state = start_state->fail;
             }
         }
         while (iChildPtr == iNumChildren);
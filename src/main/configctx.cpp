@@ -21,6 +21,7 @@
 #include <http/httplog.h>
 #include <http/httpserverconfig.h>
 #include <http/serverprocessconfig.h>
+#include <http/vhostsslcache.h>
 #include <log4cxx/level.h>
 #include <log4cxx/logger.h>
 #include <lsr/ls_fileio.h>
@@ -731,7 +732,11 @@ int ConfigCtx::configSecurity(AccessControl *pCtrl, const XmlNode *pNode)
 
 
 
-void ConfigCtx::configCRL(const XmlNode *pNode, SslContext *pSsl)
+/**
+ * Keeps the CRL file and path in pConfig, they are added to the SslContext
+ * when it is built.
+ */
+void ConfigCtx::configCRL(const XmlNode *pNode, SslContextConfig *pConfig)
 {
     char achCrlFile[MAX_PATH_LEN];
     char achCrlPath[MAX_PATH_LEN];
@@ -743,28 +748,27 @@ void ConfigCtx::configCRL(const XmlNode *pNode, SslContext *pSsl)
     {
         if (getValidPath(achCrlPath, pCrlPath, "CRL path") != 0)
             return;
-        pCrlPath = achCrlPath;
     }
     if (pCrlFile)
     {
         if (getValidFile(achCrlFile, pCrlFile, "CRL file") != 0)
             return;
-        pCrlFile = achCrlFile;
     }
-
-#ifdef _ENTERPRISE_
-    if (pCrlPath || pCrlFile)
-        pSsl->addCRL(achCrlFile, achCrlPath);
-#endif
+    if (pCrlPath)
+        pConfig->m_sCRLPath = achCrlPath;
+    if (pCrlFile)
+        pConfig->m_sCRLFile = achCrlFile;
 }
 
 
-SslContext *ConfigCtx::newSSLContext(const XmlNode *pNode,
-                                    const char *pName, SslContext *pOldContext)
+/**
+ * Fills pConfig from a "vhssl" or listener SSL node, checking that the
+ * configured files exist. Nothing is loaded yet.
+ */
+int ConfigCtx::configSSLContext(const XmlNode *pNode, const char *pName,
+                                SslContextConfig *pConfig)
 {
-    SslContextConfig config;
     int cv;
-    SslContext *pSsl;
     const char *pTag, *pCertFile, *pKey;
     char achCert[MAX_PATH_LEN], achKey[MAX_PATH_LEN],
          achCAPath[MAX_PATH_LEN], achCAFile[MAX_PATH_LEN],
@@ -774,61 +778,61 @@ SslContext *ConfigCtx::newSSLContext(const XmlNode *pNode,
     {
         LS_NOTICE( "[%s] No SSL certificate configured for [%s]",
                   getLogId(), pName);
-        return NULL;
+        return LS_FAIL;
     }
     if ((pCertFile = getTag(pNode, "certFile")) == NULL)
-        return NULL;
+        return LS_FAIL;
     else if ((pKey = getTag(pNode, "keyFile")) == NULL)
-        return NULL;
+        return LS_FAIL;
     if (m_iEnableMultiCerts != 0)
     {
         if (getAbsoluteFile(achCert, pCertFile) != 0)
-            return NULL;
+            return LS_FAIL;
         else if (getAbsoluteFile(achKey, pKey) != 0)
-            return NULL;
+            return LS_FAIL;
     }
     else
     {
         if (getValidFile(achCert, pCertFile, "certificate file") != 0)
-            return NULL;
+            return LS_FAIL;
         else if (getValidFile(achKey, pKey, "key file") != 0)
-            return NULL;
+            return LS_FAIL;
     }
-    config.m_sCertFile[0] = achCert;
-    config.m_sKeyFile[0] = achKey;
-    config.m_iEnableMultiCerts = m_iEnableMultiCerts;
+    pConfig->m_sCertFile[0] = achCert;
+    pConfig->m_sKeyFile[0] = achKey;
+    pConfig->m_iEnableMultiCerts = m_iEnableMultiCerts;
 
-    config.m_sName = pName;
+    pConfig->m_sName = pName;
 
     const char *pCipher = pNode->getChildValue( "ciphers" );
     if (pCipher == NULL)
         pCipher = "ALL:!ADH:!EXPORT56:RC4+RSA:+HIGH:+MEDIUM:+SSLv2:+EXP";
-    config.m_sCiphers = pCipher;
+    pConfig->m_sCiphers = pCipher;
 
     if (( pTag = pNode->getChildValue( "CACertPath" )) != NULL )
     {
         if ( getValidFile(achCAPath, pTag, "CA Certificate path" ) != 0 )
-            return NULL;
-        config.m_sCAPath = achCAPath;
+            return LS_FAIL;
+        pConfig->m_sCAPath = achCAPath;
     }
 
     if (( pTag = pNode->getChildValue( "CACertFile" )) != NULL )
     {
         if ( getValidFile(achCAFile, pTag, "CA Certificate file" ) != 0 )
-            return NULL;
-        config.m_sCAFile = achCAFile;
+            return LS_FAIL;
+        pConfig->m_sCAFile = achCAFile;
     }
 
 
     cv = getLongValue( pNode, "clientVerify", 0, 3, 0 );
-    config.m_iClientVerify = cv;
+    pConfig->m_iClientVerify = cv;
 
-    config.m_iCertChain = getLongValue( pNode, "certChain", 0, 1, 0 );
-    config.m_iProtocol = getLongValue(pNode, "sslProtocol", 1, 31, 28);
-    config.m_iEnableECDHE = getLongValue(pNode, "enableECDHE", 0, 1, 1);
-    config.m_iEnableDHE = getLongValue(pNode, "enableDHE", 0, 1, 0);
+    pConfig->m_iCertChain = getLongValue( pNode, "certChain", 0, 1, 0 );
+    pConfig->m_iProtocol = getLongValue(pNode, "sslProtocol", 1, 31, 28);
+    pConfig->m_iEnableECDHE = getLongValue(pNode, "enableECDHE", 0, 1, 1);
+    pConfig->m_iEnableDHE = getLongValue(pNode, "enableDHE", 0, 1, 0);
 
-    if ( config.m_iEnableDHE != 0 )
+    if ( pConfig->m_iEnableDHE != 0 )
     {
         if (( pTag = pNode->getChildValue("DHParam")) != NULL )
         {
@@ -839,20 +843,38 @@ SslContext *ConfigCtx::newSSLContext(const XmlNode *pNode,
                          getLogId(), pTag );
             }
             else
-                config.m_sDHParam = achDHParam;
+                pConfig->m_sDHParam = achDHParam;
         }
     }
 
-    config.m_iEnableSpdy = getLongValue(pNode, "enableSpdy", 0, 15, 15);
-    config.m_iEnableCache = getLongValue(pNode, "sslSessionCache", 0, 1, 0);
-    config.m_iInsecReneg = !getLongValue(pNode, "regenProtection", 0, 1, 1);
-    config.m_iEnableTicket = getLongValue(pNode, "sslSessionTickets",
+    pConfig->m_iEnableSpdy = getLongValue(pNode, "enableSpdy", 0, 15, 15);
+    pConfig->m_iEnableCache = getLongValue(pNode, "sslSessionCache", 0, 1, 0);
+    pConfig->m_iInsecReneg = !getLongValue(pNode, "regenProtection", 0, 1, 1);
+    pConfig->m_iEnableTicket = getLongValue(pNode, "sslSessionTickets",
                                                0, 1, 1);
     int enableStapling = getLongValue(pNode, "enableStapling", 0, 1, 0);
     if ((enableStapling) && (pCertFile != NULL))
-        if (configStapling(pNode, &config) != -1)
-            config.m_iEnableStapling = enableStapling;
+        if (configStapling(pNode, pConfig) != -1)
+            pConfig->m_iEnableStapling = enableStapling;
+
+    if (cv)
+    {
+        pConfig->m_iVerifyDepth = getLongValue(pNode, "verifyDepth", 1,
+                                               INT_MAX, 1);
+        configCRL(pNode, pConfig);
+    }
+    return LS_OK;
+}
+
+
+SslContext *ConfigCtx::newSSLContext(const XmlNode *pNode,
+                                    const char *pName, SslContext *pOldContext)
+{
+    SslContextConfig config;
+    SslContext *pSsl;
 
+    if (configSSLContext(pNode, pName, &config) != LS_OK)
+        return NULL;
     pSsl = SslContext::config(pOldContext, &config);
     if ( pSsl == NULL )
     {
@@ -861,19 +883,36 @@ SslContext *ConfigCtx::newSSLContext(const XmlNode *pNode,
         return NULL;
     }
 
-    if (cv)
-    {
 #ifdef _ENTERPRISE_
-        pSsl->setClientVerify(cv, getLongValue(pNode, "verifyDepth", 1, INT_MAX,
-                                               1));
-#endif
-        configCRL(pNode, pSsl);
+    if (config.m_iClientVerify)
+    {
+        pSsl->setClientVerify(config.m_iClientVerify, config.m_iVerifyDepth);
+        if (config.m_sCRLFile.c_str() || config.m_sCRLPath.c_str())
+            pSsl->addCRL(config.m_sCRLFile.c_str(), config.m_sCRLPath.c_str());
     }
+#endif
 
     return pSsl;
 }
 
 
+/**
+ * Keeps the parsed SSL settings of a vhost to build its SslContext on the
+ * first handshake, see VHostSslCache.
+ */
+LazySslContext *ConfigCtx::newLazySSLContext(const XmlNode *pNode,
+                                             const char *pName)
+{
+    SslContextConfig *pConfig = new SslContextConfig();
+    if (configSSLContext(pNode, pName, pConfig) != LS_OK)
+    {
+        delete pConfig;
+        return NULL;
+    }
+    return new LazySslContext(pConfig);
+}
+
+
 int ConfigCtx::initOcspCachePath()
 {
     if (SslOcspStapling::getCachePath() == NULL)
@@ -31,6 +31,7 @@ class HttpHandler;
 class AccessControl;
 class SslContext;
 class SslContextConfig;
+class LazySslContext;
 class AutoBuf;
 
 #define MAX_PATH_LEN                4096
@@ -104,7 +105,11 @@ public:
     
     SslContext *newSSLContext(const XmlNode *pNode, const char *pName,
                               SslContext *pOldContext);
-    void configCRL(const XmlNode *pNode, SslContext *pSSL);
+    LazySslContext *newLazySSLContext(const XmlNode *pNode,
+                                      const char *pName);
+    int configSSLContext(const XmlNode *pNode, const char *pName,
+                         SslContextConfig *pConfig);
+    void configCRL(const XmlNode *pNode, SslContextConfig *pConfig);
     int initOcspCachePath();
     int configStapling(const XmlNode *pNode, SslContextConfig *pConf);
     
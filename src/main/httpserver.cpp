@@ -37,6 +37,7 @@
 #include <extensions/registry/appconfig.h>
 
 #include <http/accesslog.h>
+#include <http/accesslogwriter.h>
 #include <http/clientcache.h>
 #include <http/connlimitctrl.h>
 #include <http/contextlist.h>
@@ -66,12 +67,17 @@
 #include <http/ntwkiolink.h>
 #include <http/platforms.h>
 #include <http/recaptcha.h>
+#include <http/rewriteengine.h>
 #include <http/serverprocessconfig.h>
+#include <http/shmmetrics.h>
 #include <http/staticfilecache.h>
 #include <http/staticfilecachedata.h>
+#include <http/statcache.h>
 #include <http/stderrlogger.h>
 #include <http/vhostmap.h>
+#include <http/vhostsslcache.h>
 #include <http/clientinfo.h>
+#include <extensions/lsapi/lsapiconfig.h>
 
 #include <log4cxx/appender.h>
 #include <log4cxx/logger.h>
@@ -90,6 +96,7 @@
 
 #include <shm/lsshm.h>
 #include <sslpp/sslcontext.h>
+#include <sslpp/sslconnection.h>
 #include <sslpp/sslcontextconfig.h>
 #include <sslpp/sslengine.h>
 #include <sslpp/sslocspstapling.h>
@@ -917,6 +924,8 @@ void HttpServerImpl::onTimer10Secs()
 {
     ExtAppRegistry::onTimer();
     HttpResourceManager::getInstance().onTimer();
+    AccessLogWriter::getInstance().onTimer();
+    VHostSslCache::getInstance().onTimer();
     static int s_timeOut = 3;
     s_timeOut --;
     if (!s_timeOut)
@@ -1193,6 +1202,8 @@ void HttpServerImpl::releaseAll()
     m_toBeReleasedListeners.clear();
     m_vhosts.release_objects();
     m_toBeReleasedVHosts.release_objects();
+    HttpLog::getAccessLog()->flush();
+    AccessLogWriter::getInstance().stop();
     ::signal(SIGCHLD, SIG_DFL);
     ExtAppRegistry::shutdown();
     ClientCache::clearObjPool();
@@ -1287,18 +1298,33 @@ int HttpServerImpl::reinitMultiplexer()
             &StdErrLogger::getInstance(), POLLIN | POLLHUP | POLLERR);
     }
     int n = m_listeners.size();
+    int iIncomingCpu = -1;
     iProcNo = HttpServerConfig::getInstance().getProcNo();
+    if (HttpServerConfig::getInstance().getReusePort()
+        && HttpServerConfig::getInstance().getCpuAffinity() > 0)
+    {
+        cpu_set_t cpu_affinity;
+        PCUtil::getAffinityMask(PCUtil::getNumProcessors(), iProcNo - 1,
+                                HttpServerConfig::getInstance().getCpuAffinity(),
+                                &cpu_affinity);
+        iIncomingCpu = PCUtil::getFirstCpu(&cpu_affinity);
+    }
     for (int i = 0; i < n; ++i)
     {
         if (!(m_listeners[i]->getBinding() & (1L << (iProcNo - 1))))
             m_listeners[i]->stop();
-        else if (MultiplexerFactory::s_iMultiplexerType)
-            MultiplexerFactory::getMultiplexer()->add(m_listeners[i],
-                    POLLIN | POLLHUP | POLLERR);
+        else
+        {
+            m_listeners[i]->useReusePortSock(iProcNo, iIncomingCpu);
+            if (MultiplexerFactory::s_iMultiplexerType)
+                MultiplexerFactory::getMultiplexer()->add(m_listeners[i],
+                        POLLIN | POLLHUP | POLLERR);
+        }
         {
             UdpListener *pUdp = m_listeners[i]->getVHostMap()->getQuicListener();
             if (pUdp && pUdp->getfd() != -1)
             {
+                pUdp->useReusePortSock(iProcNo);
                 MultiplexerFactory::getMultiplexer()->add(pUdp,
                     POLLIN | POLLHUP | POLLERR);
             }
@@ -2209,6 +2235,24 @@ int HttpServerImpl::configTuning(const XmlNode *pRoot)
 #endif
     config.setUseSendfile(val);
 
+    AccessLogWriter::setMode(currentCtx.getLongValue(pNode,
+                             "accessLogWriter", 0, 2, 0));
+    AccessLogWriter::setMaxChunks(currentCtx.getLongValue(pNode,
+                                  "accessLogWriterChunks", 16, 4096,
+                                  ALW_DEFAULT_MAX_CHUNKS));
+    UserDir::setVerifyCacheTimeout(currentCtx.getLongValue(pNode,
+                                   "authVerifyCacheTimeout", 0, 3600, 60));
+    UserDir::setVerifyWorkers(currentCtx.getLongValue(pNode,
+                              "authVerifyWorkers", 0, 32, 2));
+    RewriteEngine::setMemoSize(currentCtx.getLongValue(pNode,
+                               "rewriteCacheSize", 0, 1000000, 2048));
+    StatCache::setSize(currentCtx.getLongValue(pNode,
+                       "statCacheSize", 0, 1000000, 0));
+    StatCache::setTimeout(currentCtx.getLongValue(pNode,
+                          "statCacheTimeout", 0, 3600, 1));
+    LsapiConfig::setShmRingSize(currentCtx.getLongValue(pNode,
+                                "lsapiShmRingSize", 0, 64 * 1024 * 1024, 0));
+
 //     if (val)
 //         FileCacheDataEx::setMaxMMapCacheSize(0);
 
@@ -2221,6 +2265,13 @@ int HttpServerImpl::configTuning(const XmlNode *pRoot)
     }
     SslContext::setUseStrongDH(currentCtx.getLongValue(pNode, "SSLStrongDhKey",
                                0, 1, 1));
+    SslConnection::setKtlsTxEnabled(currentCtx.getLongValue(pNode, "sslKtls",
+                                    0, 1, 0));
+    VHostSslCache::setMaxContexts(currentCtx.getLongValue(pNode,
+                                  "sslCtxCacheSize", 0, 1000000, 0));
+    VHostSslCache::setIdleTimeout(currentCtx.getLongValue(pNode,
+                                  "sslCtxIdleTimeout", SSLCTX_MIN_IDLE,
+                                  86400, 600));
 
     // GZIP compression
     config.setGzipCompress(currentCtx.getLongValue(pNode, "enableGzipCompress",
@@ -2237,6 +2288,13 @@ int HttpServerImpl::configTuning(const XmlNode *pRoot)
         0
 #endif
     );
+#ifdef USE_ZSTD
+    config.setZstdCompress(config.getGzipCompress()
+                           && currentCtx.getLongValue(pNode,
+                                   "enableZstdCompress", 0, 1, 1));
+    config.setZstdCompressLevel(currentCtx.getLongValue(pNode,
+                                "zstdCompressLevel", 1, 19, 3));
+#endif
     pValue = pNode->getChildValue("compressibleTypes");
     if (pValue == NULL)
         pValue = "default";
@@ -2252,6 +2310,9 @@ int HttpServerImpl::configTuning(const XmlNode *pRoot)
     StaticFileCacheData::setStaticBrOptions(
         currentCtx.getLongValue(pNode, "brStaticCompressLevel", 1, 11, 6)
     );
+    StaticFileCacheData::setStaticZstdOptions(
+        currentCtx.getLongValue(pNode, "zstdStaticCompressLevel", 1, 19, 12)
+    );
 
 
     pValue = pNode->getChildValue("gzipCacheDir");
@@ -2287,6 +2348,25 @@ int HttpServerImpl::configTuning(const XmlNode *pRoot)
 
     StaticFileCacheData::setCompressCachePath(pValue);
 
+    pValue = pNode->getChildValue("gzipPrewarmDir");
+    if (pValue)
+    {
+        char achBuf[MAX_PATH_LEN];
+
+        if (currentCtx.getAbsolutePath(achBuf, pValue) == -1)
+        {
+            LS_WARN(&currentCtx, "path of gzip pre-warm directory is invalid, "
+                    "ignore.");
+            pValue = NULL;
+        }
+        else
+        {
+            pValue = achBuf;
+            pValue += MainServerConfig::getInstance().getChrootlen();
+        }
+    }
+    StaticFileCacheData::setCompressPrewarmDir(pValue);
+
 
     // shm
     const char *pShmDir = pNode->getChildValue("shmDefaultDir");
@@ -2616,6 +2696,7 @@ int HttpServerImpl::configServerBasic2(const XmlNode *pRoot,
 
         m_serverContext.setModuleConfig(ModuleManager::getInstance().getGlobalModuleConfig(), 0);
         m_serverContext.initExternalSessionHooks();
+        m_serverContext.buildMatchFilters();
         return 0;
     }
 
@@ -3071,6 +3152,10 @@ int HttpServerImpl::configServerBasics(int reconfig, const XmlNode *pRoot)
             ConfigCtx::getCurConfigCtx()->getLongValue(pRoot, "cpuAffinity", 0,
                                                        64, 0));
 
+        HttpServerConfig::getInstance().setReusePort(
+            ConfigCtx::getCurConfigCtx()->getLongValue(pRoot, "reusePort", 0,
+                                                       1, 0));
+
         //this value can only be set once when server start.
         if (MainServerConfigObj.getCrashGuard() == 2)
             MainServerConfigObj.setCrashGuard(1);
@@ -3588,6 +3673,8 @@ int HttpServerImpl::initQuic(const XmlNode *pNode)
 
     settings.es_cc_algo = GET_VAL(pNode, "quicCongestionCtrl", 0, 2, 0);
 
+    UdpListener::setGso(GET_VAL(pNode, "quicGso", 0, 1, 1));
+
     settings.es_proc_time_thresh = 100000;
     settings.es_pace_packets = 1;
 
@@ -4908,6 +4995,7 @@ void HttpServer::offsetChroot()
 void HttpServer::setProcNo(int proc)
 {
     HttpServerConfig::getInstance().setProcNo(proc);
+    ShmMetrics::setSlot(proc);
     m_impl->setRTReportName(proc);
 }
 
@@ -4938,6 +5026,45 @@ void HttpServer::recoverListeners()
 }
 
 
+void HttpServer::setupReusePort(int iProcNo)
+{
+    HttpServerConfig &config = HttpServerConfig::getInstance();
+    int iWorkers = config.getReusePort() ? config.getChildren() : 0;
+    m_impl->m_listeners.setupReusePort(iWorkers, iProcNo);
+    for (int i = 0; i < m_impl->m_listeners.size(); ++i)
+    {
+        UdpListener *pUdp = m_impl->m_listeners[i]->getVHostMap()
+                                ->getQuicListener();
+        if (pUdp)
+            pUdp->setupReusePort(iWorkers, iProcNo);
+    }
+}
+
+
+void HttpServer::releaseReusePort()
+{
+    for (int i = 0; i < m_impl->m_listeners.size(); ++i)
+    {
+        UdpListener *pUdp = m_impl->m_listeners[i]->getVHostMap()
+                                ->getQuicListener();
+        if (pUdp)
+            pUdp->releaseReusePortSock();
+    }
+}
+
+
+void HttpServer::onWorkerExit(int iProcNo)
+{
+    for (int i = 0; i < m_impl->m_listeners.size(); ++i)
+    {
+        UdpListener *pUdp = m_impl->m_listeners[i]->getVHostMap()
+                                ->getQuicListener();
+        if (pUdp)
+            pUdp->onWorkerExit(iProcNo);
+    }
+}
+
+
 int HttpServer::initMultiplexer(const char *pType)
 {
     return m_impl->m_dispatcher.init(pType);
@@ -113,6 +113,9 @@ public:
     void setBlackBoard(char *pBuf);
     void passListeners();
     void recoverListeners();
+    void setupReusePort(int iProcNo);
+    void releaseReusePort();
+    void onWorkerExit(int iProcNo);
 
     int  initMultiplexer(const char *pType);
     int  reinitMultiplexer();
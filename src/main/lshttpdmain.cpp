@@ -18,12 +18,16 @@
 #include "lshttpdmain.h"
 
 #include <adns/adns.h>
+#include <http/accesslogwriter.h>
 #include <http/httpaiosendfile.h>
 #include <http/httplog.h>
 #include <http/httpserverconfig.h>
 #include <http/httpserverversion.h>
 #include <http/httpsignals.h>
+#include <http/staticfilecachedata.h>
+#include <http/statcache.h>
 #include <http/serverprocessconfig.h>
+#include <http/shmmetrics.h>
 #include <http/stderrlogger.h>
 #include <log4cxx/logger.h>
 #include <log4cxx/logrotate.h>
@@ -978,6 +982,7 @@ int LshttpdMain::init(int argc, char *argv[])
     }
 
     removeOldRtreport();
+    ShmMetrics::init(HttpServerConfig::getInstance().getChildren() + 1);
     {
         char achBuf[8192];
 
@@ -1019,12 +1024,14 @@ int LshttpdMain::init(int argc, char *argv[])
         allocatePidTracker();
         m_pServer->initAdns();
         m_pServer->enableAioLogging();
+        AccessLogWriter::getInstance().start();
         cleanEnvVars();
         WorkCrew * pGWC = ModuleHandler::getGlobalWorkCrew();
         pGWC->startProcessing();
         if ((HttpServerConfig::getInstance().getUseSendfile() == 2)
             && (m_pServer->initAioSendFile() != 0))
             return LS_FAIL;
+        StaticFileCacheData::startCompressPrewarm();
     }
     //if ( fcntl( 5, F_GETFD, 0 ) > 0 )
     //    printf( "find it!\n" );
@@ -1237,11 +1244,14 @@ void LshttpdMain::onNewChildStart(ChildProc * pProc)
     releaseExcept(pProc);
     m_pServer->reinitMultiplexer();
     m_pServer->enableAioLogging();
+    AccessLogWriter::getInstance().start();
     if ((HttpServerConfig::getInstance().getUseSendfile() == 2)
         && (m_pServer->initAioSendFile() != 0))
     {
         HttpServerConfig::getInstance().setUseSendfile(1);
     }
+    if (pProc->m_iProcNo == 1)
+        StaticFileCacheData::startCompressPrewarm();
     close(m_fdAdmin);
 
 #ifdef IS_LSCPD
@@ -1252,6 +1262,7 @@ void LshttpdMain::onNewChildStart(ChildProc * pProc)
 
     LsShmPool::setPid(pProc->m_pid);
     QuicEngine::setpid(pProc->m_pid);
+    StatCache::setpid(pProc->m_pid);
 }
 
 int LshttpdMain::startChild(ChildProc *pProc)
@@ -1265,10 +1276,12 @@ int LshttpdMain::startChild(ChildProc *pProc)
     pProc->m_iProcNo = getFirstAvailSlot();
     if (pProc->m_iProcNo > HttpServerConfig::getInstance().getChildren())
         return LS_FAIL;
+    m_pServer->setupReusePort(pProc->m_iProcNo);
     preFork();
     pProc->m_pid = fork();
     if (pProc->m_pid == -1)
     {
+        m_pServer->releaseReusePort();
         forkError(errno);
         return LS_FAIL;
     }
@@ -1283,6 +1296,7 @@ int LshttpdMain::startChild(ChildProc *pProc)
     if (GlobalServerSessionHooks->isEnabled(LSI_HKPT_MAIN_POSTFORK))
         GlobalServerSessionHooks->runCallbackNoParam(LSI_HKPT_MAIN_POSTFORK, NULL);
     postFork(pProc->m_pid);
+    m_pServer->releaseReusePort();
     m_childrenList.push(pProc);
     pProc->m_iState = CP_RUNNING;
     setChildSlot(pProc->m_iProcNo, 1);
@@ -1396,6 +1410,8 @@ int LshttpdMain::childDead(int pid)
             {
                 setChildSlot(pProc->m_iProcNo, 0);
                 --m_curChildren;
+                if (s_iRunning > 0)
+                    m_pServer->onWorkerExit(pProc->m_iProcNo);
             }
             m_childrenList.removeNext(pPrev);
             m_pool.recycle(pProc);
@@ -140,6 +140,7 @@ plainconfKeywords plainconf::sKeywords[] =
     {"enablespdy",                               NULL},
     {"enablestapling",                           NULL},
     {"enablestderrlog",                          NULL},
+    {"enablezstdcompress",                       NULL},
     {"env",                                      NULL},
     {"errcode",                                  NULL},
     {"errorlog",                                 NULL},
@@ -172,6 +173,7 @@ plainconfKeywords plainconf::sKeywords[] =
     {"gzipcompresslevel",                        NULL},
     {"gzipmaxfilesize",                          NULL},
     {"gzipminfilesize",                          NULL},
+    {"gzipprewarmdir",                           NULL},
     {"gzipstaticcompresslevel",                  NULL},
     {"handler",                                  NULL},
     {"hardlimit",                                NULL},
@@ -282,6 +284,7 @@ plainconfKeywords plainconf::sKeywords[] =
     {"ssldefaultcafile",                         NULL},
     {"ssldefaultcapath",                         NULL},
     {"sslenablemulticerts",                      NULL},
+    {"sslktls",                                  NULL},
     {"sslsessioncache",                          NULL},
     {"sslsessioncachesize",                      NULL},
     {"sslsessioncachetimeout",                   NULL},
@@ -349,6 +352,8 @@ plainconfKeywords plainconf::sKeywords[] =
     {"zconfname",                                NULL},
     {"zconfportlist",                            NULL},
     {"zconfsend",                                NULL},
+    {"zstdcompresslevel",                        NULL},
+    {"zstdstaticcompresslevel",                  NULL},
 
 
     {"disableinitlogrotation",                   NULL},
@@ -419,6 +424,7 @@ plainconfKeywords plainconf::sKeywords[] =
     {"appserverenv", NULL},
     {"enablelve",  NULL},
     {"cpuaffinity", NULL},
+    {"reuseport", NULL},
  
     {"enablequic", NULL},
     {"quicenable", NULL},
@@ -433,6 +439,17 @@ plainconfKeywords plainconf::sKeywords[] =
     {"quicidletimeout", NULL},
     {"quicpush", NULL},
     {"quiccongestionctrl", NULL},
+    {"quicgso", NULL},
+    {"accesslogwriter", NULL},
+    {"accesslogwriterchunks", NULL},
+    {"sslctxcachesize", NULL},
+    {"sslctxidletimeout", NULL},
+    {"authverifycachetimeout", NULL},
+    {"authverifyworkers", NULL},
+    {"rewritecachesize", NULL},
+    {"statcachesize", NULL},
+    {"statcachetimeout", NULL},
+    {"lsapishmringsize", NULL},
 };
 
 static HashStringMap<plainconfKeywords *> allKeyword(29, GHash::hfCiString,
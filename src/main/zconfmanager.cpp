@@ -33,6 +33,7 @@
 #include <lsr/xxhash.h>
 
 #include <sslpp/sslcontext.h>
+#include <sslpp/sslcontextconfig.h>
 #include <sslpp/sslutil.h>
 
 #include <util/autobuf.h>
@@ -44,6 +45,9 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <openssl/err.h>
+#include <openssl/pem.h>
+
 static const char *ZCONFMGR_LOG_PREFIX = "ZConfManager";
 
 
@@ -271,6 +275,107 @@ int ZConfManager::appendSslContext(const char *pDomainList, int iListLen,
 }
 
 
+//copies the certificates left in pIn to pOut
+static void copyCertChain(BIO *pIn, BIO *pOut)
+{
+    X509 *pCert;
+    while ((pCert = PEM_read_bio_X509(pIn, NULL, NULL, NULL)) != NULL)
+    {
+        PEM_write_bio_X509(pOut, pCert);
+        X509_free(pCert);
+    }
+    ERR_clear_error();
+}
+
+
+//appends the PEM data of pBio without its trailing newline
+static int appendPem(AutoBuf *pBuf, BIO *pBio)
+{
+    char *pData;
+    long len = BIO_get_mem_data(pBio, &pData);
+    if (len <= 0)
+        return 0;
+    pBuf->append(pData, len - 1);
+    return len;
+}
+
+
+/**
+ * Same as appendSslContext(), for a vhost whose certificate is loaded on
+ * demand. The key and certificates are read from the configured files, so
+ * its SslContext is not built just to be sent to the zconf servers.
+ *
+ * Returns 1 if appended, 0 if the domains were added to the listener list.
+ */
+int ZConfManager::appendSslConfig(const char *pDomainList, int iListLen,
+                                  const SslContextConfig *pConfig)
+{
+    EVP_PKEY *pKey = NULL;
+    X509 *pCert = NULL;
+    BIO *pIn;
+    BIO *pOut;
+    BIO *pChain = BIO_new(BIO_s_mem());
+
+    if ((pIn = BIO_new_file(pConfig->m_sKeyFile[0].c_str(), "r")) != NULL)
+    {
+        pKey = PEM_read_bio_PrivateKey(pIn, NULL, NULL, NULL);
+        BIO_free(pIn);
+    }
+    if ((pIn = BIO_new_file(pConfig->m_sCertFile[0].c_str(), "r")) != NULL)
+    {
+        pCert = PEM_read_bio_X509(pIn, NULL, NULL, NULL);
+        if (pConfig->m_iCertChain)
+            copyCertChain(pIn, pChain);
+        BIO_free(pIn);
+    }
+    if (pConfig->m_sCaChainFile.c_str()
+        && (pIn = BIO_new_file(pConfig->m_sCaChainFile.c_str(), "r")) != NULL)
+    {
+        copyCertChain(pIn, pChain);
+        BIO_free(pIn);
+    }
+    ERR_clear_error();
+
+    if (!pKey || !pCert || X509_check_private_key(pCert, pKey) != 1)
+    {
+        if (pKey)
+            EVP_PKEY_free(pKey);
+        if (pCert)
+            X509_free(pCert);
+        BIO_free(pChain);
+        ERR_clear_error();
+        return appendToTmpDomainList(pDomainList, iListLen);
+    }
+
+    m_pSslConf->reserve(m_pSslConf->size() + iListLen + 31);
+    m_pSslConf->used(
+        snprintf(m_pSslConf->end(), iListLen + 31,
+            "{\n\"domain_list\":\n[%.*s],\n\"key\" : \"",
+            iListLen, pDomainList)
+    );
+    pOut = BIO_new(BIO_s_mem());
+    PEM_write_bio_PrivateKey(pOut, pKey, NULL, NULL, 0, NULL, NULL);
+    appendPem(m_pSslConf, pOut);
+    BIO_free(pOut);
+    m_pSslConf->append("\",\n\"cert\" : \"");
+    pOut = BIO_new(BIO_s_mem());
+    PEM_write_bio_X509(pOut, pCert);
+    appendPem(m_pSslConf, pOut);
+    BIO_free(pOut);
+    if (BIO_pending(pChain) > 0)
+    {
+        m_pSslConf->append("\",\n\"ca_bundle\" : \"");
+        appendPem(m_pSslConf, pChain);
+    }
+    m_pSslConf->append("\"\n},\n");
+
+    EVP_PKEY_free(pKey);
+    X509_free(pCert);
+    BIO_free(pChain);
+    return 1;
+}
+
+
 /**
  * Appends the SslContext associated with the listener. This should be called
  * once the vhost mapping configuration for this listener is completed. This will
@@ -26,6 +26,7 @@ class AutoStr2;
 class HttpListener;
 class HttpVHost;
 class SslContext;
+class SslContextConfig;
 class ZConfClient;
 
 #define ZCMF_SENDZCUP       (1<<0)
@@ -54,6 +55,9 @@ public:
 
     int appendSslContext(const char *pDomainList, int iListLen, SslContext *pCtx);
 
+    int appendSslConfig(const char *pDomainList, int iListLen,
+                        const SslContextConfig *pConfig);
+
     int appendSslListener(SslContext *pCtx);
 
     void prepareServerUp();
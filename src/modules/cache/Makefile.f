@@ -25,7 +25,7 @@ else
 endif
 
 
-SOURCES =cache.cpp cacheentry.cpp cachehash.cpp cachestore.cpp \
+SOURCES =cache.cpp cacheentry.cpp cachehash.cpp cachefillqueue.cpp cachehottier.cpp cachestore.cpp \
         ceheader.cpp dirhashcacheentry.cpp dirhashcachestore.cpp \
         cacheconfig.cpp cachectrl.cpp  \
         cachemanager.cpp shmcachemanager.cpp
@@ -18,6 +18,7 @@
 #include "cacheconfig.h"
 #include "cachectrl.h"
 #include "cacheentry.h"
+#include "cachefillqueue.h"
 #include "cachehash.h"
 #include "dirhashcachestore.h"
 
@@ -47,6 +48,7 @@
 #include <http/httpvhost.h>
 #include <http/httpmime.h>
 #include <http/serverprocessconfig.h>
+#include <http/shmmetrics.h>
 #include <util/autostr.h>
 #include <sys/uio.h>
 #include <zlib.h>
@@ -68,6 +70,9 @@
 #define VALMAXSIZE          4096
 #define MAX_HEADER_LEN      16384
 #define Z_BUF_SIZE          16384
+#define HOT_CACHE_OBJ_SIZE  (256 * 1024)
+#define FILL_POLL_MS        100
+#define FILL_MAX_WAIT_MS    60000
     
 /////////////////////////////////////////////////////////////////////////////
 extern lsi_module_t MNAME;
@@ -175,14 +180,18 @@ struct MyMData
     CacheKey        cacheKey;
     int16_t         hkptIndex;
     unsigned char   hasCacheFrontend;
-    unsigned char   reqCompressType; //0, no, 1: gzip, 2:br
+    unsigned char   reqCompressType; //0, no, 1: gzip, 2:br, 3:zstd
     XXH64_state_t   contentState;
     z_stream       *zstream;
     off_t           orgFileLength;
-
+    struct FillWaiter *pFillWaiter;
+    unsigned char   iFillLeader;
 
 };
 
+static CacheFillQueue s_fillWaiters;
+static int s_fillTimerId = -1;
+
 
 static lsi_config_key_t paramArray[] =
 {
@@ -216,7 +225,10 @@ static lsi_config_key_t paramArray[] =
     {"addEtag",                 17, 0},
     {"purgeUri",                18, 0},
     {"reqHeaderVary",           19, 0},
-    
+    {"hotCacheSize",            20, 0},
+    {"hotCacheMaxObjSize",      21, 0},
+    {"coalesceWaitMs",          22, 0},
+
     {NULL, 0, 0} //Must have NULL in the last item
 };
 
@@ -450,6 +462,9 @@ static int parseLine(CacheConfig *pConfig, int param_id,
     case 15:
     case 18:
     case 19:
+    case 20:
+    case 21:
+    case 22:
         return i; //return the index for next step parsing
 
     case 16:
@@ -615,6 +630,8 @@ static void *ParseConfig(module_param_info_t *param, int param_count,
         return (void *)pConfig;
     }
 
+    long hotCacheSize = -1;
+    long hotCacheMaxObjSize = HOT_CACHE_OBJ_SIZE;
     for (int i=0 ;i<param_count; ++i)
     {
         int ret = parseLine(pConfig, param[i].key_index,
@@ -637,11 +654,41 @@ static void *ParseConfig(module_param_info_t *param, int param_count,
             pConfig->setPurgeUri(param[i].val, param[i].val_len);
         else if (ret == 19)
             setVaryList(pConfig, param[i].val, param[i].val_len);
+        else if (ret == 20)
+            hotCacheSize = strtol(param[i].val, NULL, 10);
+        else if (ret == 21)
+            hotCacheMaxObjSize = strtol(param[i].val, NULL, 10);
+        else if (ret == 22)
+        {
+            int waitMs = atoi(param[i].val);
+            if (waitMs < 0)
+                waitMs = 0;
+            else if (waitMs > FILL_MAX_WAIT_MS)
+                waitMs = FILL_MAX_WAIT_MS;
+            pConfig->setFillWait(waitMs);
+        }
 
     }
 
     parseNoCacheUrlFinal(pConfig);
     verifyStoreReady(pConfig);
+    if (hotCacheSize >= 0)
+    {
+        //The memory tier belongs to the store, only its owner may size it
+        if (pConfig->getOwnStore() && pConfig->getStore())
+        {
+            pConfig->getStore()->getHotTier()->setLimits(hotCacheSize,
+                                                        hotCacheMaxObjSize);
+            g_api->log(NULL, LSI_LOG_DEBUG,
+                       "[%s]parseConfig hotCacheSize %ld, hotCacheMaxObjSize"
+                       " %ld for level %d[name: %s].\n", ModuleNameStr,
+                       hotCacheSize, hotCacheMaxObjSize, level, name);
+        }
+        else
+            g_api->log(NULL, LSI_LOG_INFO,
+                       "[%s][%s] shares the cache store of its parent, "
+                       "'hotCacheSize' ignored.\n", ModuleNameStr, name);
+    }
     return (void *)pConfig;
 }
 
@@ -1303,11 +1350,123 @@ short lookUpCache(lsi_param_t *rec, MyMData *myData, int no_vary,
 }
 
 
+static long curTimeMs()
+{
+    return (long)DateTime_s_curTime * 1000 + DateTime_s_curTimeMs;
+}
+
+
+static int assignHandler(lsi_param_t *rec, MyMData *myData, int mayWait);
+
+static void removeFillWaiter(MyMData *myData)
+{
+    s_fillWaiters.remove(myData->pFillWaiter);
+    myData->pFillWaiter = NULL;
+}
+
+
+static int resumeFillWaiter(lsi_session_t *session, const long lParam,
+                            void *pParam)
+{
+    MyMData *myData = (MyMData *)g_api->get_module_data(session, &MNAME,
+                      LSI_DATA_HTTP);
+    if (!myData || !myData->pFillWaiter)
+        return 0;
+    removeFillWaiter(myData);
+
+    lsi_param_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.session = session;
+    g_api->log(session, LSI_LOG_DEBUG, "[%s]fill wait over, look up again.\n",
+               ModuleNameStr);
+    assignHandler(&rec, myData, 0);
+    g_api->resume(session, 0);
+    return 0;
+}
+
+
+//The session is resumed from its own event so that it is not re-entered
+//from here.
+static void scheduleFillWaiter(FillWaiter *pWaiter)
+{
+    g_api->create_event(resumeFillWaiter, pWaiter->session, 0, NULL, 1);
+}
+
+
+/**
+ * Wakes the waiters on pHash, or when pHash is NULL, every waiter whose
+ * fetch finished in another worker or whose wait timed out.
+ */
+static void wakeFillWaiters(const CacheHash *pHash)
+{
+    s_fillWaiters.wake(pHash, curTimeMs(), scheduleFillWaiter);
+}
+
+
+static void pollFillWaiters(const void *param)
+{
+    if (s_fillWaiters.size() == 0)
+    {
+        g_api->remove_timer(s_fillTimerId);
+        s_fillTimerId = -1;
+        return;
+    }
+    wakeFillWaiters(NULL);
+}
+
+
+/**
+ * Coalesces a cache miss with a fetch already in flight for the same public
+ * entry. The first miss claims the fill in the shm index and goes to the
+ * backend; later ones wait for it to publish, up to the configured time.
+ * Returns 1 when the request has been parked.
+ */
+static int waitForFill(lsi_param_t *rec, MyMData *myData)
+{
+    int waitMs = myData->pConfig->getFillWait();
+    CacheStore *pStore = myData->pConfig->getStore();
+    if (waitMs <= 0 || !pStore || !pStore->getManager()
+        || g_api->get_hook_level(rec) != LSI_HKPT_URI_MAP)
+        return 0;
+
+    CacheManager *pManager = pStore->getManager();
+    if (pManager->beginFill(myData->cePublicHash,
+                            DateTime_s_curTime + waitMs / 1000 + 1))
+    {
+        myData->iFillLeader = 1;
+        return 0;
+    }
+    if (!pManager->isFilling(myData->cePublicHash))
+        return 0;
+
+    myData->pFillWaiter = s_fillWaiters.add(rec->session, pManager,
+                                            myData->cePublicHash,
+                                            curTimeMs() + waitMs);
+    if (s_fillTimerId == -1)
+        s_fillTimerId = g_api->set_timer(FILL_POLL_MS, 1, pollFillWaiters,
+                                         NULL);
+    return 1;
+}
+
+
+static void endFill(MyMData *myData)
+{
+    myData->iFillLeader = 0;
+    myData->pConfig->getStore()->getManager()->endFill(myData->cePublicHash);
+    wakeFillWaiters(&myData->cePublicHash);
+}
+
+
 static int releaseMData(void *data)
 {
     MyMData *myData = (MyMData *)data;
     if (myData)
     {
+        if (myData->iFillLeader)
+            endFill(myData);
+        if (myData->pFillWaiter)
+            removeFillWaiter(myData);
+
         if (myData->pOrgUri)
             delete []myData->pOrgUri;
         
@@ -1546,6 +1705,7 @@ static int endCache(lsi_param_t *rec)
 
                 myData->pConfig->getStore()->publish(myData->pEntry);
                 myData->iCacheState = CE_STATE_CACHED;  //Succeed
+                ShmMetrics::incCache(ShmMetrics::CACHE_STORE);
                 g_api->log(NULL, LSI_LOG_DEBUG,
                            "[%s]published %s, content length %ld.\n",
                            ModuleNameStr, myData->pOrgUri,
@@ -1805,6 +1965,7 @@ static int createEntry(lsi_param_t *rec)
 
     //Now we can store it
     myData->iCacheState = CE_STATE_WILLCACHE;
+    ShmMetrics::incCache(ShmMetrics::CACHE_MISS);
 
     int ids = myData->hkptIndex;
     g_api->enable_hook(rec->session, &MNAME, 1, &ids, 1);
@@ -2378,6 +2539,15 @@ static int sessionBegin(lsi_param_t *rec)
     return 0;
 }
 
+
+//A zstd entry is only served to clients accepting zstd, other entries
+//keep the existing behavior.
+static int isEncodingAcceptable(MyMData *myData)
+{
+    return (myData->pEntry->getCompressType() != LSI_ZSTD_COMPRESS
+            || myData->reqCompressType == LSI_ZSTD_COMPRESS);
+}
+
 static int checkAssignHandler(lsi_param_t *rec)
 {
     char val[3] = {0};
@@ -2511,19 +2681,40 @@ static int checkAssignHandler(lsi_param_t *rec)
             cacheCtrl.parse(buf, bufLen);
     }
 
-    //Set to true but not the below just for not to re-check cache state or
-    //re-store it
-    //bool doPublic = cacheCtrl.isPublicCacheable() || myData->pConfig->isCheckPublic();
-    bool doPublic = true;
     int encodingLen;
     const char *encoding = g_api->get_req_header_by_id(rec->session,
                                                        LSI_HDR_ACC_ENCODING,
                                                        &encodingLen);
-    myData->reqCompressType = (encodingLen >= 4 && strcasestr(encoding, "gzip"));
+    myData->reqCompressType = LSI_NO_COMPRESS;
+#ifdef USE_ZSTD
+    //zstd entries only exist when the server compresses with zstd
+    if (HttpServerConfig::getInstance().getZstdCompress() > 0
+        && encodingLen >= 4 && strcasestr(encoding, "zstd"))
+        myData->reqCompressType = LSI_ZSTD_COMPRESS;
+#endif
+    if (myData->reqCompressType == LSI_NO_COMPRESS)
+        myData->reqCompressType = (encodingLen >= 4 && strcasestr(encoding, "gzip"));
     if (myData->reqCompressType == LSI_NO_COMPRESS &&
         encodingLen >= 2 && strcasestr(encoding, "br"))
         myData->reqCompressType = LSI_BR_COMPRESS;
 
+    return assignHandler(rec, myData, 1);
+}
+
+
+//Look up the cache and either register the handler to serve the entry or
+//add the hooks to store the response. A request parked by waitForFill()
+//comes back here with mayWait 0.
+static int assignHandler(lsi_param_t *rec, MyMData *myData, int mayWait)
+{
+    char val[3] = {0};
+    CacheConfig *pConfig = myData->pConfig;
+    CacheCtrl &cacheCtrl = myData->cacheCtrl;
+    //Set to true but not the below just for not to re-check cache state or
+    //re-store it
+    //bool doPublic = cacheCtrl.isPublicCacheable() || myData->pConfig->isCheckPublic();
+    bool doPublic = true;
+
     myData->iCacheState = lookUpCache(rec, myData,
                                    cacheCtrl.getFlags() & CacheCtrl::no_vary,
                                    myData->pOrgUri, strlen(myData->pOrgUri),
@@ -2555,6 +2746,7 @@ static int checkAssignHandler(lsi_param_t *rec)
             ||
             (myData->iCacheState == CE_STATE_HAS_PUBLIC_CACHE
              && myData->pConfig->isCheckPublic()))
+            && isEncodingAcceptable(myData)
 #ifdef USE_RECV_REQ_HEADER_HOOK
             && myData->pEntry->getNeedDelay() == 0
 #endif
@@ -2577,6 +2769,7 @@ static int checkAssignHandler(lsi_param_t *rec)
                 
                 //myData->pEntry->incHits();
                 myData->iHaveAddedHook = 3; //state of using handler
+                ShmMetrics::incCache(ShmMetrics::CACHE_HIT);
                 g_api->log(rec->session, LSI_LOG_DEBUG,
                            "[%s]checkAssignHandler register_req_handler OK.\n",
                            ModuleNameStr);
@@ -2601,6 +2794,13 @@ static int checkAssignHandler(lsi_param_t *rec)
         if (!myData->cacheCtrl.isCacheOff()
             || (myData->pConfig->isCheckPublic() || myData->pConfig->isPrivateCheck()))
         {
+            if (mayWait && waitForFill(rec, myData))
+            {
+                g_api->log(rec->session, LSI_LOG_DEBUG,
+                           "[%s]checkAssignHandler wait for the request "
+                           "fetching it.\n", ModuleNameStr);
+                return LSI_SUSPEND;
+            }
             myData->iHaveAddedHook = 1;
 
             //g_api->set_session_hook_flag( rec->_session, LSI_HKPT_RCVD_RESP_BODY, &MNAME, 1 );
@@ -3214,13 +3414,27 @@ static int handlerProcess(const lsi_session_t *session)
     char *pBuffOrg = NULL;
     int part1offset = myData->pEntry->getPart1Offset();
     int part2offset = myData->pEntry->getPart2Offset();
+
+    const CacheHotData *pHot = NULL;
+    CacheStore *pStore = myData->pConfig->getStore();
+    CacheHotTier *pHotTier = pStore->getHotTier();
+    if (pHotTier->isEnabled())
+    {
+        uint64_t key;
+        memcpy(&key, myData->pEntry->getHashKey().getKey(), sizeof(key));
+        pHotTier->recordAccess(key);
+        pHot = pHotTier->get(myData->pEntry);
+    }
+
     if (part2offset - part1offset > 0)
     {
+        if (pHot)
+            buff = (char *)pHot->getBuf() + part1offset;
 #ifdef CACHE_RESP_HEADER
-        if (myData->m_pEntry->m_sRespHeader.len() > 0) //has it
+        else if (myData->m_pEntry->m_sRespHeader.len() > 0) //has it
             buff = (char *)(myData->m_pEntry->m_sRespHeader.c_str());
-        else
 #endif
+        else
         {
             buff  = (char *)mmap((caddr_t)0, part2offset,
                                  PROT_READ, MAP_SHARED, fd, 0);
@@ -3365,20 +3579,50 @@ static int handlerProcess(const lsi_session_t *session)
                        "[%s]set_resp_header [Content-Encoding: br].\n",
                        ModuleNameStr);
         }
+        else if (compressType == LSI_ZSTD_COMPRESS)
+        {
+            g_api->set_resp_header(session, LSI_RSPHDR_CONTENT_ENCODING,
+                                   NULL, 0, "zstd", 4, LSI_HEADEROP_SET);
+            g_api->log(session, LSI_LOG_DEBUG,
+                       "[%s]set_resp_header [Content-Encoding: zstd].\n",
+                       ModuleNameStr);
+        }
         g_api->set_resp_buffer_compress_method(session, compressType);
 
 
         g_api->set_resp_content_length(session, length);
-        int fd = myData->pEntry->getFdStore();
-        
-        g_api->log(session, LSI_LOG_DEBUG,
-                   "[%s]handlerProcess fd %d, offset %d, length %ld\n",
-                   ModuleNameStr, fd, part2offset, length);
 
-        if (g_api->send_file2(session, fd, part2offset, length) == 0)
-            g_api->end_resp(session);
+        //only load bodies that are sent, not ones a 304 answered
+        if (!pHot && pHotTier->isEnabled())
+            pHot = pHotTier->admit(myData->pEntry, fd,
+                                   part2offset + myData->pEntry->getPart2Len());
+        if (pHot)
+        {
+            g_api->log(session, LSI_LOG_DEBUG,
+                       "[%s]handlerProcess memory tier, offset %d, length %ld\n",
+                       ModuleNameStr, part2offset, length);
+            pStore->getManager()->addTierStats(
+                offsetof(cachetierstats_t, memHits), 1);
+            if (length <= 0 || g_api->append_resp_body(session,
+                    pHot->getBuf() + part2offset, length) >= 0)
+                g_api->end_resp(session);
+            else
+                ret = 500;
+        }
         else
-            ret = 500;
+        {
+            int fd = myData->pEntry->getFdStore();
+
+            g_api->log(session, LSI_LOG_DEBUG,
+                       "[%s]handlerProcess fd %d, offset %d, length %ld\n",
+                       ModuleNameStr, fd, part2offset, length);
+            pStore->getManager()->addTierStats(
+                offsetof(cachetierstats_t, diskHits), 1);
+            if (g_api->send_file2(session, fd, part2offset, length) == 0)
+                g_api->end_resp(session);
+            else
+                ret = 500;
+        }
         
         /**
          * For testing, disable the code 
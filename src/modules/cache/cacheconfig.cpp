@@ -31,6 +31,7 @@ CacheConfig::CacheConfig()
       //, m_iBypassPercentage(5)
     , m_iLevele(0)
     , m_iAddEtag(0)
+    , m_iFillWait(0)
     , m_iOnlyUseOwnUrlExclude(0)
     , m_iOwnStore(0)
     , m_iOwnPurgeUri(0)
@@ -91,6 +92,7 @@ void CacheConfig::inherit(const CacheConfig *pParent)
         m_pStore = pParent->getStore();
         m_iOwnStore = 0;
         m_iAddEtag = pParent->getAddEtagType();
+        m_iFillWait = pParent->getFillWait();
         m_pPurgeUri = pParent->getPurgeUri();
         m_iOwnPurgeUri = 0;
         m_pVaryList = pParent->getVaryList();
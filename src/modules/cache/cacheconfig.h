@@ -84,6 +84,8 @@ public:
     long getMaxObjSize() const      {   return m_lMaxObjSize;   }
     void setAddEtagType(int v)      {   m_iAddEtag = v;     }
     int getAddEtagType() const      { return m_iAddEtag;    }
+    void setFillWait(int ms)        {   m_iFillWait = ms;   }
+    int getFillWait() const         {   return m_iFillWait; }
     char *getPurgeUri() const       { return m_pPurgeUri;   };
     
     StringList *getVaryList() const {   return m_pVaryList;    }
@@ -112,7 +114,7 @@ public:
     int isOnlyUseOwnUrlExclude()    { return m_iOnlyUseOwnUrlExclude; }
 
     void setOwnStore(int v)    { m_iOwnStore = v; }
-    //int getOwnStore()    { return m_iOwnStore; }
+    int getOwnStore()    { return m_iOwnStore; }
     void setOwnPurgeUri(int v)    { m_iOwnPurgeUri = v; }
 
     Aho *getUrlExclude() const         {   return m_pUrlExclude;     }
@@ -143,6 +145,7 @@ private:
 
     int8_t  m_iLevele;  //SERVER, VHOST or context
     int8_t  m_iAddEtag;  //0, no, 1: add size-mtime; 2: xxhash64
+    int     m_iFillWait; //ms a miss waits for another request fetching it
     int     m_iOnlyUseOwnUrlExclude  : 4;
     int     m_iOwnStore : 4;
     int     m_iOwnPurgeUri : 4;
@@ -16,6 +16,7 @@
 *    along with this program. If not, see http://www.gnu.org/licenses/.      *
 *****************************************************************************/
 #include "cacheentry.h"
+#include "cachehottier.h"
 
 #include <string.h>
 #include <unistd.h>
@@ -33,6 +34,7 @@ CacheEntry::CacheEntry()
     , m_fdStore(-1)
     , m_iVaryFlag(0)
     , m_pWaitQue(NULL)
+    , m_pHotData(NULL)
 {
 }
 
@@ -43,6 +45,8 @@ CacheEntry::~CacheEntry()
         close(m_fdStore);
     if (m_pWaitQue)
         delete m_pWaitQue;
+    if (m_pHotData)
+        m_pHotData->getTier()->remove(this);
 }
 
 
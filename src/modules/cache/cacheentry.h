@@ -37,6 +37,7 @@
 #define CE_UPDATING     (1<<0)
 #define CE_STALE        (1<<1)
 
+class CacheHotData;
 class DLinkedObj;
 class DLinkQueue;
 class HttpRespHeaders;
@@ -124,18 +125,23 @@ public:
     void markReady(int compressed_method)
     {
         m_header.m_flag = (m_header.m_flag & ~CeHeader::CEH_IN_CONSTRUCT);
-        m_header.m_flag &= (~CeHeader::CEH_BR & ~CeHeader::CEH_GZIP);
+        m_header.m_flag &= (~CeHeader::CEH_BR & ~CeHeader::CEH_GZIP
+                            & ~CeHeader::CEH_ZSTD);
         
-        if (compressed_method == 2)
+        if (compressed_method == 3)
+            m_header.m_flag |= CeHeader::CEH_ZSTD;
+        else if (compressed_method == 2)
             m_header.m_flag |= CeHeader::CEH_BR;
         else if (compressed_method == 1)
             m_header.m_flag |= CeHeader::CEH_GZIP;
     }
 
-    //Return 0, no compressed, 1 Gzip, 2 Br
+    //Return 0, no compressed, 1 Gzip, 2 Br, 3 Zstd
     int getCompressType() const
     {
-        if (m_header.m_flag & CeHeader::CEH_BR)
+        if (m_header.m_flag & CeHeader::CEH_ZSTD)
+            return 3;
+        else if (m_header.m_flag & CeHeader::CEH_BR)
             return 2;
         else if (m_header.m_flag & CeHeader::CEH_GZIP)
             return 1;
@@ -189,6 +195,9 @@ public:
     int getVaryIndexSet(int index)   {  return m_iVaryFlag & (1 << index);   }
     void setVaryIndex(int index)     { m_iVaryFlag |= (1 << index);   }
 
+    CacheHotData *getHotData() const        {   return m_pHotData;  }
+    void setHotData(CacheHotData *pData)    {   m_pHotData = pData; }
+
 
 private:
     long        m_lastAccess;
@@ -208,6 +217,7 @@ private:
 
     AutoStr     m_sTag;
     DLinkQueue *m_pWaitQue;
+    CacheHotData *m_pHotData;
     LS_NO_COPY_ASSIGN(CacheEntry);
 };
 
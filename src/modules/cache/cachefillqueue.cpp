@@ -0,0 +1,77 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "cachefillqueue.h"
+#include "cachemanager.h"
+
+#include <string.h>
+
+
+CacheFillQueue::~CacheFillQueue()
+{
+    DLinkedObj *pObj;
+    while ((pObj = m_waiters.pop_front()) != NULL)
+        delete (FillWaiter *)pObj;
+}
+
+
+FillWaiter *CacheFillQueue::add(const lsi_session_t *session,
+                                CacheManager *pManager,
+                                const CacheHash &hash, long deadline)
+{
+    FillWaiter *pWaiter = new FillWaiter;
+    pWaiter->session = session;
+    pWaiter->pManager = pManager;
+    pWaiter->hash.copy(hash);
+    pWaiter->deadline = deadline;
+    pWaiter->woken = 0;
+    m_waiters.append(pWaiter);
+    return pWaiter;
+}
+
+
+void CacheFillQueue::remove(FillWaiter *pWaiter)
+{
+    m_waiters.remove(pWaiter);
+    delete pWaiter;
+}
+
+
+int CacheFillQueue::wake(const CacheHash *pHash, long now, wake_fn fn)
+{
+    int count = 0;
+    DLinkedObj *pObj = m_waiters.begin();
+    for (; pObj != m_waiters.end(); pObj = pObj->next())
+    {
+        FillWaiter *pWaiter = (FillWaiter *)pObj;
+        if (pWaiter->woken)
+            continue;
+        if (pHash)
+        {
+            if (memcmp(pHash->getKey(), pWaiter->hash.getKey(),
+                       HASH_KEY_LEN) != 0)
+                continue;
+        }
+        else if (now < pWaiter->deadline
+                 && pWaiter->pManager->isFilling(pWaiter->hash))
+            continue;
+        pWaiter->woken = 1;
+        ++count;
+        (*fn)(pWaiter);
+    }
+    return count;
+}
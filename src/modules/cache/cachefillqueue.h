@@ -0,0 +1,76 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef CACHEFILLQUEUE_H
+#define CACHEFILLQUEUE_H
+
+
+#include <lsdef.h>
+#include <ls.h>
+#include <util/dlinkqueue.h>
+#include "cachehash.h"
+
+class CacheManager;
+
+/**
+ * A cache miss parked at URI_MAP while another request fetches the same
+ * public entry from the backend.
+ */
+struct FillWaiter : public DLinkedObj
+{
+    const lsi_session_t *session;
+    CacheManager        *pManager;
+    CacheHash            hash;
+    long                 deadline;   //ms
+    int                  woken;
+};
+
+
+/**
+ * The waiters of one worker. A waiter is woken once, when the fetch of its
+ * entry ends in this worker, when the fills table no longer has a live
+ * fetch for it, or when its deadline passes; it stays queued until the
+ * resumed session removes it.
+ */
+class CacheFillQueue
+{
+public:
+    typedef void (*wake_fn)(FillWaiter *pWaiter);
+
+    CacheFillQueue()    {}
+    ~CacheFillQueue();
+
+    FillWaiter *add(const lsi_session_t *session, CacheManager *pManager,
+                    const CacheHash &hash, long deadline);
+    void remove(FillWaiter *pWaiter);
+
+    /**
+     * With pHash, wakes the waiters of that entry. Without, wakes the
+     * waiters whose deadline is not after now or whose fetch is over.
+     * Returns the number of waiters woken.
+     */
+    int  wake(const CacheHash *pHash, long now, wake_fn fn);
+
+    int  size() const               {   return m_waiters.size();    }
+
+private:
+    DLinkQueue      m_waiters;
+
+    LS_NO_COPY_ASSIGN(CacheFillQueue);
+};
+
+#endif
@@ -0,0 +1,309 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include <ls.h>
+#include "cachehottier.h"
+#include "cacheentry.h"
+#include "cachemanager.h"
+
+#include <util/ni_fio.h>
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define HOT_MIN_WIDTH       256
+#define HOT_MAX_WIDTH       (1 << 20)
+#define HOT_ADMIT_FREQ      2
+#define HOT_MAX_VICTIMS     8
+#define HOT_COUNTER_MAX     15
+
+static const uint64_t s_seeds[HOT_SKETCH_DEPTH] =
+{
+    0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL,
+    0x165667b19e3779f9ULL, 0x27d4eb2f165667c5ULL
+};
+
+
+static inline int toKBytes(int len)
+{
+    return (len + 1023) >> 10;
+}
+
+
+CacheHotData::~CacheHotData()
+{
+    if (m_pBuf)
+        free(m_pBuf);
+}
+
+
+CacheHotTier::CacheHotTier()
+    : m_lMaxBytes(0)
+    , m_lMaxObjSize(0)
+    , m_lBytes(0)
+    , m_pManager(NULL)
+    , m_pCounters(NULL)
+    , m_pDoorKeeper(NULL)
+    , m_iWidthMask(0)
+    , m_iSamples(0)
+    , m_iSampleLimit(0)
+{
+}
+
+
+CacheHotTier::~CacheHotTier()
+{
+    clear();
+    if (m_pCounters)
+        free(m_pCounters);
+    if (m_pDoorKeeper)
+        free(m_pDoorKeeper);
+}
+
+
+void CacheHotTier::setLimits(long maxBytes, long maxObjSize)
+{
+    m_lMaxBytes = (maxBytes > 0) ? maxBytes : 0;
+    m_lMaxObjSize = (maxObjSize < m_lMaxBytes) ? maxObjSize : m_lMaxBytes;
+
+    //entries already loaded obey the new limits, least recently used first
+    DLinkedObj *pObj = m_lru.begin();
+    while (pObj != m_lru.end())
+    {
+        CacheHotData *pData = (CacheHotData *)pObj;
+        pObj = pObj->next();
+        if (m_lBytes > m_lMaxBytes || pData->getLen() > m_lMaxObjSize)
+        {
+            evict(pData);
+            addStats(offsetof(cachetierstats_t, evicted), 1);
+        }
+    }
+
+    if (m_pCounters)
+    {
+        free(m_pCounters);
+        m_pCounters = NULL;
+    }
+    if (m_pDoorKeeper)
+    {
+        free(m_pDoorKeeper);
+        m_pDoorKeeper = NULL;
+    }
+    m_iWidthMask = 0;
+    m_iSamples = 0;
+    if (!m_lMaxBytes)
+        return;
+
+    //One counter column per 4KB of memory tier, entries are rarely smaller
+    uint32_t width = HOT_MIN_WIDTH;
+    while (width < HOT_MAX_WIDTH && (long)width * 4096 < m_lMaxBytes)
+        width <<= 1;
+    m_pCounters = (uint8_t *)calloc(HOT_SKETCH_DEPTH, width);
+    m_pDoorKeeper = (uint64_t *)calloc(width / 64, sizeof(uint64_t));
+    if (!m_pCounters || !m_pDoorKeeper)
+    {
+        m_lMaxBytes = 0;
+        clear();
+        return;
+    }
+    m_iWidthMask = width - 1;
+    m_iSampleLimit = width * 10;
+}
+
+
+inline uint32_t CacheHotTier::slot(uint64_t key, int row) const
+{
+    uint64_t h = (key + row) * s_seeds[row];
+    return (uint32_t)(h >> 32) & m_iWidthMask;
+}
+
+
+int CacheHotTier::estimate(uint64_t key) const
+{
+    if (!m_pCounters)
+        return 0;
+    uint32_t door = slot(key, 0);
+    int min = HOT_COUNTER_MAX;
+    for (int i = 0; i < HOT_SKETCH_DEPTH; ++i)
+    {
+        int c = m_pCounters[i * (m_iWidthMask + 1) + slot(key, i)];
+        if (c < min)
+            min = c;
+    }
+    if (m_pDoorKeeper[door >> 6] & (1ULL << (door & 63)))
+        ++min;
+    return min;
+}
+
+
+void CacheHotTier::recordAccess(uint64_t key)
+{
+    if (!m_pCounters)
+        return;
+    uint32_t door = slot(key, 0);
+    uint64_t bit = 1ULL << (door & 63);
+    if (!(m_pDoorKeeper[door >> 6] & bit))
+        m_pDoorKeeper[door >> 6] |= bit;
+    else
+    {
+        //conservative update, only raise the counters holding the minimum
+        uint8_t *pSlots[HOT_SKETCH_DEPTH];
+        int min = HOT_COUNTER_MAX;
+        for (int i = 0; i < HOT_SKETCH_DEPTH; ++i)
+        {
+            pSlots[i] = &m_pCounters[i * (m_iWidthMask + 1) + slot(key, i)];
+            if (*pSlots[i] < min)
+                min = *pSlots[i];
+        }
+        if (min < HOT_COUNTER_MAX)
+        {
+            for (int i = 0; i < HOT_SKETCH_DEPTH; ++i)
+                if (*pSlots[i] == min)
+                    ++*pSlots[i];
+        }
+    }
+    if (++m_iSamples >= m_iSampleLimit)
+        age();
+}
+
+
+void CacheHotTier::age()
+{
+    uint32_t total = HOT_SKETCH_DEPTH * (m_iWidthMask + 1);
+    for (uint32_t i = 0; i < total; ++i)
+        m_pCounters[i] >>= 1;
+    memset(m_pDoorKeeper, 0, (m_iWidthMask + 1) / 8);
+    m_iSamples >>= 1;
+}
+
+
+const CacheHotData *CacheHotTier::get(CacheEntry *pEntry)
+{
+    CacheHotData *pData = pEntry->getHotData();
+    if (pData)
+    {
+        m_lru.remove(pData);
+        m_lru.append(pData);
+    }
+    return pData;
+}
+
+
+/**
+ * Loads the first len bytes of fd into memory if the TinyLFU estimate of
+ * pEntry beats the LRU entries that have to be evicted to make room.
+ * Returns NULL when the entry is not admitted.
+ */
+const CacheHotData *CacheHotTier::admit(CacheEntry *pEntry, int fd,
+                                        int len)
+{
+    if (pEntry->getHotData())
+        return pEntry->getHotData();
+    if (!isEnabled() || len <= 0 || len > m_lMaxObjSize || fd == -1)
+        return NULL;
+
+    uint64_t key;
+    memcpy(&key, pEntry->getHashKey().getKey(), sizeof(key));
+    int freq = estimate(key);
+    if (freq < HOT_ADMIT_FREQ)
+        return NULL;
+
+    CacheHotData *victims[HOT_MAX_VICTIMS];
+    int nVictims = 0;
+    long need = m_lBytes + len - m_lMaxBytes;
+    DLinkedObj *pObj = m_lru.begin();
+    while (need > 0)
+    {
+        if (nVictims >= HOT_MAX_VICTIMS || pObj == m_lru.end())
+        {
+            addStats(offsetof(cachetierstats_t, rejected), 1);
+            return NULL;
+        }
+        CacheHotData *pVictim = (CacheHotData *)pObj;
+        uint64_t victimKey;
+        memcpy(&victimKey, pVictim->getEntry()->getHashKey().getKey(),
+               sizeof(victimKey));
+        if (estimate(victimKey) >= freq)
+        {
+            addStats(offsetof(cachetierstats_t, rejected), 1);
+            return NULL;
+        }
+        victims[nVictims++] = pVictim;
+        need -= pVictim->getLen();
+        pObj = pObj->next();
+    }
+
+    char *pBuf = (char *)malloc(len);
+    if (!pBuf)
+        return NULL;
+    if (pread(fd, pBuf, len, 0) != len)
+    {
+        free(pBuf);
+        return NULL;
+    }
+    for (int i = 0; i < nVictims; ++i)
+    {
+        evict(victims[i]);
+        addStats(offsetof(cachetierstats_t, evicted), 1);
+    }
+
+    CacheHotData *pData = new CacheHotData(this, pEntry, pBuf, len);
+    pEntry->setHotData(pData);
+    m_lru.append(pData);
+    m_lBytes += len;
+    addStats(offsetof(cachetierstats_t, admitted), 1);
+    addStats(offsetof(cachetierstats_t, memEntries), 1);
+    addStats(offsetof(cachetierstats_t, memKBytes), toKBytes(len));
+    return pData;
+}
+
+
+void CacheHotTier::evict(CacheHotData *pData)
+{
+    m_lru.remove(pData);
+    m_lBytes -= pData->getLen();
+    pData->getEntry()->setHotData(NULL);
+    addStats(offsetof(cachetierstats_t, memEntries), -1);
+    addStats(offsetof(cachetierstats_t, memKBytes),
+             -toKBytes(pData->getLen()));
+    delete pData;
+}
+
+
+void CacheHotTier::remove(CacheEntry *pEntry)
+{
+    CacheHotData *pData = pEntry->getHotData();
+    if (pData)
+        evict(pData);
+}
+
+
+void CacheHotTier::clear()
+{
+    DLinkedObj *pObj;
+    while ((pObj = m_lru.begin()) != m_lru.end())
+        evict((CacheHotData *)pObj);
+}
+
+
+void CacheHotTier::addStats(int offset, int32_t delta)
+{
+    if (m_pManager)
+        m_pManager->addTierStats(offset, delta);
+}
@@ -0,0 +1,121 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef CACHEHOTTIER_H
+#define CACHEHOTTIER_H
+
+
+#include <lsdef.h>
+#include <util/dlinkqueue.h>
+#include <inttypes.h>
+
+#define HOT_SKETCH_DEPTH    4
+
+class CacheEntry;
+class CacheHotTier;
+class CacheManager;
+
+/**
+ * In-memory copy of a cache file, from the start of the file to the end
+ * of the response body, so that the CeHeader/key/header offsets of the
+ * CacheEntry apply to the buffer as they do to the file.
+ */
+class CacheHotData : public DLinkedObj
+{
+public:
+    CacheHotData(CacheHotTier *pTier, CacheEntry *pEntry, char *pBuf,
+                 int len)
+        : m_pTier(pTier)
+        , m_pEntry(pEntry)
+        , m_pBuf(pBuf)
+        , m_iLen(len)
+    {}
+    ~CacheHotData();
+
+    CacheHotTier *getTier() const   {   return m_pTier;     }
+    CacheEntry   *getEntry() const  {   return m_pEntry;    }
+    const char   *getBuf() const    {   return m_pBuf;      }
+    int           getLen() const    {   return m_iLen;      }
+
+private:
+    CacheHotTier   *m_pTier;
+    CacheEntry     *m_pEntry;
+    char           *m_pBuf;
+    int             m_iLen;
+
+    LS_NO_COPY_ASSIGN(CacheHotData);
+};
+
+
+/**
+ * Per-worker memory tier in front of the disk cache store.
+ *
+ * Admission follows TinyLFU: a count-min sketch estimates how often a key
+ * has been requested recently, a doorkeeper bitmap keeps one-hit keys out
+ * of the sketch, and an entry is only loaded when it has been seen more
+ * than once and is more popular than every LRU entry it would push out.
+ * The counters are halved after 10 x width accesses so old popularity
+ * fades.
+ */
+class CacheHotTier
+{
+public:
+    CacheHotTier();
+
+    ~CacheHotTier();
+
+    void setLimits(long maxBytes, long maxObjSize);
+    int  isEnabled() const          {   return m_lMaxBytes > 0;     }
+    long getMaxBytes() const        {   return m_lMaxBytes;         }
+    long getMaxObjSize() const      {   return m_lMaxObjSize;       }
+
+    void setManager(CacheManager *pManager) {   m_pManager = pManager;  }
+
+    long getBytes() const           {   return m_lBytes;            }
+    int  getCount() const           {   return m_lru.size();        }
+
+    void recordAccess(uint64_t key);
+    int  estimate(uint64_t key) const;
+
+    const CacheHotData *get(CacheEntry *pEntry);
+    const CacheHotData *admit(CacheEntry *pEntry, int fd, int len);
+    void remove(CacheEntry *pEntry);
+
+    void clear();
+
+private:
+    uint32_t slot(uint64_t key, int row) const;
+    void age();
+    void evict(CacheHotData *pData);
+    void addStats(int offset, int32_t delta);
+
+    long            m_lMaxBytes;
+    long            m_lMaxObjSize;
+    long            m_lBytes;
+    DLinkQueue      m_lru;
+    CacheManager   *m_pManager;
+
+    uint8_t        *m_pCounters;
+    uint64_t       *m_pDoorKeeper;
+    uint32_t        m_iWidthMask;
+    uint32_t        m_iSamples;
+    uint32_t        m_iSampleLimit;
+
+    LS_NO_COPY_ASSIGN(CacheHotTier);
+};
+
+#endif
@@ -77,5 +77,21 @@ void CacheManager::generateRpt(const char *name, AutoBuf *pBuf)
                     );
     pBuf->append(achBuf, n);
 
+    cachetierstats_t *pTier = pInfo->getTierStats();
+    int lookups = pTier->memHits + pTier->diskHits + pPublic->misses
+                  + pPrivate->misses;
+    if (lookups <= 0)
+        lookups = 1;
+    n = snprintf(achBuf, 4096,
+                 "[%s] MEM_HITS: %d, MEM_HIT_RATIO: %.1f%%, "
+                 "DISK_HITS: %d, DISK_HIT_RATIO: %.1f%%, "
+                 "MEM_ENTRIES: %d, MEM_KBYTES: %d, MEM_ADMITTED: %d, "
+                 "MEM_REJECTED: %d, MEM_EVICTED: %d\n",
+                 name, pTier->memHits, pTier->memHits * 100.0 / lookups,
+                 pTier->diskHits, pTier->diskHits * 100.0 / lookups,
+                 pTier->memEntries, pTier->memKBytes, pTier->admitted,
+                 pTier->rejected, pTier->evicted);
+    pBuf->append(achBuf, n);
+
 }
 
@@ -25,6 +25,7 @@
 #include <inttypes.h>
 
 class AutoBuf;
+class CacheHash;
 class PurgeData2;
 struct CacheKey;
 class CacheEntry;
@@ -72,6 +73,22 @@ typedef struct cachestats_s
 
 } cachestats_t;
 
+/**
+ * Per-tier counters, memEntries and memKBytes add up the memory tier of
+ * every worker.
+ */
+typedef struct cachetierstats_s
+{
+    int32_t     memHits;
+    int32_t     diskHits;
+    int32_t     admitted;
+    int32_t     rejected;
+    int32_t     evicted;
+    int32_t     memEntries;
+    int32_t     memKBytes;
+    int32_t     unused;
+} cachetierstats_t;
+
 
 class CacheInfo
 {
@@ -112,6 +129,9 @@ public:
     cachestats_t *getStats(int isPrivate)
     {   return &m_stats[isPrivate != 0];  }
 
+    cachetierstats_t *getTierStats()
+    {   return &m_tierStats;    }
+
     int32_t     getFullPageHits() const     {   return m_iPageHits[1];  }
     int32_t     getPartialPageHits() const  {   return m_iPageHits[0];  }
 
@@ -168,7 +188,8 @@ private:
     uint32_t        m_tmLastCleanDiskCache;
     uint32_t        m_iLastCleanSessPurge;
     uint32_t        m_iFlags;
-    char            m_reserved[252] __attribute__ ((unused)); /* Padding, do not remove */
+    cachetierstats_t m_tierStats;
+    char            m_reserved[252 - sizeof(cachetierstats_t)] __attribute__ ((unused)); /* Padding, do not remove */
 };
 
 
@@ -219,6 +240,15 @@ public:
     virtual int findTagId(const char *pTag, int len) = 0;
     virtual int getTagId(const char *pTag, int len) = 0;
 
+    /**
+     * Marks the entry of hash as being fetched from the backend until
+     * tmExpire. Returns 1 if the caller now owns the fetch, 0 if another
+     * request, in any worker, is already fetching it.
+     */
+    virtual int beginFill(const CacheHash &hash, int32_t tmExpire) = 0;
+    virtual int isFilling(const CacheHash &hash) = 0;
+    virtual void endFill(const CacheHash &hash) = 0;
+
     void incStats(int isPrivate, int offset)
     {
         cachestats_t *pInfo = getCacheInfo()->getStats(isPrivate);
@@ -226,6 +256,13 @@ public:
         ls_atomic_add(pCounter, 1);
     }
 
+    void addTierStats(int offset, int32_t delta)
+    {
+        cachetierstats_t *pInfo = getCacheInfo()->getTierStats();
+        int32_t *pCounter = (int32_t *)((char *)pInfo + offset);
+        ls_atomic_add(pCounter, delta);
+    }
+
     void generateRpt(const char *name, AutoBuf *pBuf);
     virtual int getPrivateSessionCount() const = 0;
 
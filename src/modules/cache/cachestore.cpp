@@ -40,6 +40,8 @@ CacheStore::CacheStore()
 CacheStore::~CacheStore()
 {
     m_dirtyList.release_objects();
+    m_hotTier.clear();
+    m_hotTier.setManager(NULL);
     if (m_pManager)
         delete m_pManager;
 }
@@ -68,6 +70,7 @@ int CacheStore::initManager()
         m_pManager = NULL;
         return LS_FAIL;
     }
+    m_hotTier.setManager(m_pManager);
     return LS_OK;
 }
 
@@ -91,6 +94,7 @@ int CacheStore::dispose(CacheStore::iterator iter, int isRemovePermEntry)
 {
     CacheEntry *pEntry = iter.second();
     erase(iter);
+    m_hotTier.remove(pEntry);
     if (isRemovePermEntry)
         removePermEntry(pEntry);
     if (pEntry->getRef() <= 0)
@@ -25,6 +25,7 @@
 #include <util/autostr.h>
 #include <inttypes.h>
 #include "cachemanager.h"
+#include "cachehottier.h"
 
 #define MAX_STALE_AGE 600
 
@@ -92,6 +93,8 @@ public:
 
     CacheManager *getManager()   {   return m_pManager;    }
 
+    CacheHotTier *getHotTier()   {   return &m_hotTier;    }
+
 
     const AutoStr2 *getName() const {   return &m_sName;     }
 
@@ -117,6 +120,7 @@ private:
 
     TPointerList< CacheEntry >       m_dirtyList;
     CacheManager                    *m_pManager;
+    CacheHotTier                     m_hotTier;
 
 
     AutoStr2  m_sRoot;
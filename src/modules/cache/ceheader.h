@@ -41,7 +41,8 @@ public:
         CEH_STALE        = 1 << 4,
         CEH_UPDATING     = 1 << 5,
         CEH_ESI          = 1 << 6,
-        CEH_BR           = 1 << 7
+        CEH_BR           = 1 << 7,
+        CEH_ZSTD         = 1 << 8
     };
 
     int32_t m_tmCreated;        //Created Time
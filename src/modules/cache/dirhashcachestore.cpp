@@ -174,6 +174,7 @@ CacheEntry *DirHashCacheStore::getCacheEntry(CacheHash &hash,
 
                 //updated by another process, do not remove current object on disk
                 erase(iter);
+                getHotTier()->remove(pEntry);
                 addToDirtyList(pEntry);
                 pEntry = NULL;
                 iter = end();
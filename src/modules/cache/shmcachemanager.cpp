@@ -18,12 +18,15 @@
 
 #include "shmcachemanager.h"
 #include "cacheentry.h"
+#include "cachehash.h"
 #include <log4cxx/logger.h>
 #include <shm/lsshmhash.h>
 #include <util/datetime.h>
 #include <util/pcutil.h>
 
 #include <ctype.h>
+#include <signal.h>
+#include <unistd.h>
 
 typedef struct shm_purgedata_s
 {
@@ -31,6 +34,12 @@ typedef struct shm_purgedata_s
     LsShmOffset_t       x_offNext;
 } shm_purgedata_t;
 
+typedef struct shm_filldata_s
+{
+    int32_t             x_tmExpire;
+    int32_t             x_pid;
+} shm_filldata_t;
+
 
 /*
  */
@@ -313,6 +322,8 @@ ShmCacheManager::~ShmCacheManager()
         m_pStr2IdHash->close();
     if (m_pId2VaryStr != NULL)
         m_pId2VaryStr->close();
+    if (m_pFills != NULL)
+        m_pFills->close();
     m_id2StrList.release_objects();
 }
 
@@ -415,6 +426,8 @@ void ShmCacheManager::cleanupExpiredSessions()
                                   PRIVATE_SESSION_TIMEOUT,
                                   shm_privpurgedata_cleanup, m_pSessions);
     getCacheInfo()->incSessionPurged(count);
+    //fills left behind by a worker that died while fetching
+    m_pFills->trim(DateTime::s_curTime - 60, NULL, NULL);
 }
 
 
@@ -506,23 +519,62 @@ const char *ShmCacheManager::getVerifyKey(void *pPrivatePurgeData,
 
 int ShmCacheManager::findTagId(const char *pTag, int len)
 {
-    int valLen;
-    LsShmOffset_t offVal;
-    offVal = m_pStr2IdHash->find(pTag, len, &valLen);
-    if (offVal != 0)
-        return *(int32_t *)m_pStr2IdHash->offset2ptr(offVal);
+    int32_t id;
+    if (m_pStr2IdHash->findCopy(pTag, len, &id, sizeof(id)) > 0)
+        return id;
     return -1;
 }
 
 
+int ShmCacheManager::beginFill(const CacheHash &hash, int32_t tmExpire)
+{
+    ls_strpair_t parms;
+    int flag = LSSHM_VAL_NONE;
+    shm_filldata_t *pFill;
+    LsShmHashLocker locker(m_pFills);
+
+    LsShmHash::iteroffset offIter = m_pFills->getIterator(
+        m_pFills->setParms(&parms, hash.getKey(), HASH_KEY_LEN, NULL,
+                           sizeof(shm_filldata_t)), &flag);
+    if (offIter.m_iOffset == 0)
+        return 0;
+    pFill = (shm_filldata_t *)m_pFills->offset2iteratorData(offIter);
+    if (!(flag & LSSHM_VAL_CREATED)
+        && pFill->x_tmExpire >= DateTime::s_curTime
+        && (pFill->x_pid == getpid() || kill(pFill->x_pid, 0) == 0))
+        return 0;
+    pFill->x_tmExpire = tmExpire;
+    pFill->x_pid = getpid();
+    m_pFills->linkMvTopTime(offIter, DateTime::s_curTime);
+    return 1;
+}
+
+
+int ShmCacheManager::isFilling(const CacheHash &hash)
+{
+    shm_filldata_t fill;
+    if (m_pFills->findCopy(hash.getKey(), HASH_KEY_LEN, &fill,
+                           sizeof(fill)) != sizeof(fill))
+        return 0;
+    return fill.x_tmExpire >= DateTime::s_curTime
+           && (fill.x_pid == getpid() || kill(fill.x_pid, 0) == 0);
+}
+
+
+void ShmCacheManager::endFill(const CacheHash &hash)
+{
+    m_pFills->remove(hash.getKey(), HASH_KEY_LEN);
+}
+
+
 int ShmCacheManager::getTagId(const char *pTag, int len)
 {
     int valLen;
     LsShmOffset_t offVal;
-    offVal = m_pStr2IdHash->find(pTag, len, &valLen);
-    if (offVal != 0)
-        return *(int32_t *)m_pStr2IdHash->offset2ptr(offVal);
-    int id = getNextPrivateTagId() - 1;
+    int32_t id;
+    if (m_pStr2IdHash->findCopy(pTag, len, &id, sizeof(id)) > 0)
+        return id;
+    id = getNextPrivateTagId() - 1;
     int initflag = LSSHM_VAL_NONE;
     valLen = sizeof(int32_t);
     if ((offVal = m_pStr2IdHash->get(pTag, len, &valLen, &initflag)) != 0)
@@ -926,6 +978,9 @@ int ShmCacheManager::initTables(LsShmPool *pPool)
                                         memcmp,  0);
     if (!m_pStr2IdHash)
         return -1;
+    // tag and vary ids are looked up on every cache hit, read them
+    // lock free and keep the rare inserts apart
+    m_pStr2IdHash->setupShards(8);
 
     m_pUrlVary = (TShmHash<int32_t> *)pPool->getNamedHash("urlVary", 1000,
                  LsShmHash::hashXXH32, memcmp, 0);
@@ -938,6 +993,11 @@ int ShmCacheManager::initTables(LsShmPool *pPool)
     if (!m_pId2VaryStr)
         return -1;
 
+    m_pFills = pPool->getNamedHash("fills", 100, LsShmHash::hashXXH32,
+                                   memcmp, LSSHM_FLAG_LRU);
+    if (!m_pFills)
+        return -1;
+
     populatePrivateTag();
     return 0;
 }
@@ -1034,10 +1094,10 @@ int ShmCacheManager::getVaryId(const char *pVary, int varyLen)
 {
     int valLen;
     LsShmOffset_t offVal;
-    offVal = m_pStr2IdHash->find(pVary, varyLen, &valLen);
-    if (offVal != 0)
-        return *(int32_t *)m_pStr2IdHash->offset2ptr(offVal);
-    int id = getNextVaryId() - 1;
+    int32_t id;
+    if (m_pStr2IdHash->findCopy(pVary, varyLen, &id, sizeof(id)) > 0)
+        return id;
+    id = getNextVaryId() - 1;
     int initflag = LSSHM_VAL_NONE;
     valLen = sizeof(int32_t);
     if ((offVal = m_pStr2IdHash->get(pVary, varyLen, &valLen, &initflag)) != 0)
@@ -39,6 +39,7 @@ public:
         , m_pStr2IdHash(NULL)
         , m_pUrlVary(NULL)
         , m_pId2VaryStr(NULL)
+        , m_pFills(NULL)
         , m_CacheInfoOff(0)
         , m_attempts(0)
     {}
@@ -84,6 +85,10 @@ public:
 
     int findTagId(const char *pTag, int len);
     int getTagId(const char *pTag, int len);
+
+    int beginFill(const CacheHash &hash, int32_t tmExpire);
+    int isFilling(const CacheHash &hash);
+    void endFill(const CacheHash &hash);
     void incStats(int isPrivate, int offset);
     virtual int getPrivateSessionCount() const;
 
@@ -97,6 +102,7 @@ private:
     LsShmHash               *m_pStr2IdHash;
     TShmHash<int32_t>       *m_pUrlVary;
     LsShmHash               *m_pId2VaryStr;
+    LsShmHash               *m_pFills;
     TPointerList<AutoStr2>   m_id2StrList;
     LsShmOffset_t            m_CacheInfoOff;
     int                      m_attempts;
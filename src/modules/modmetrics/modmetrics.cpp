@@ -0,0 +1,62 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include <ls.h>
+#include <http/shmmetrics.h>
+#include <util/autobuf.h>
+
+/**
+ * Request handler for Prometheus scraping. It only reads the shared
+ * memory slots of ShmMetrics, so any worker can answer for all of them.
+ * Map it with a context, for example:
+ *
+ *   context /metrics {
+ *     type        module
+ *     handler     modmetrics
+ *     accessControl { allow 127.0.0.1 }
+ *   }
+ */
+
+#define MODULE_VERSION      "1.0"
+#define METRICS_CONTENT_TYPE    "text/plain; version=0.0.4; charset=utf-8"
+
+
+static int begin_process(const lsi_session_t *session)
+{
+    if (!ShmMetrics::isEnabled())
+        return 503;
+    AutoBuf buf(16384);
+    if (ShmMetrics::writePrometheus(&buf) != LS_OK)
+        return 500;
+    g_api->set_resp_header(session, LSI_RSPHDR_CONTENT_TYPE, NULL, 0,
+                           METRICS_CONTENT_TYPE,
+                           sizeof(METRICS_CONTENT_TYPE) - 1,
+                           LSI_HEADEROP_SET);
+    g_api->set_resp_header(session, LSI_RSPHDR_CACHE_CTRL, NULL, 0,
+                           "no-store", 8, LSI_HEADEROP_SET);
+    g_api->append_resp_body(session, buf.begin(), buf.size());
+    g_api->end_resp(session);
+    return 0;
+}
+
+
+static lsi_reqhdlr_t metricshandler =
+{ begin_process, NULL, NULL, NULL, NULL, NULL, NULL };
+
+lsi_module_t modmetrics = { LSI_MODULE_SIGNATURE, NULL, &metricshandler, NULL,
+                            MODULE_VERSION, NULL, {0}
+                          };
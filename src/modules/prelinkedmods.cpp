@@ -21,6 +21,7 @@
 
 extern lsi_module_t modcompress;
 extern lsi_module_t moddecompress;
+extern lsi_module_t modmetrics;
 extern int addModgzipFilter(lsi_session_t *session, int isSend,
                             uint8_t compressLevel);
 struct Prelinked_Module
@@ -33,6 +34,7 @@ Prelinked_Module g_prelinked[] =
 {
     { "modcompress",    &modcompress   },
     { "moddecompress",  &moddecompress },
+    { "modmetrics",     &modmetrics    },
 };
 
 int getPrelinkedModuleCount()
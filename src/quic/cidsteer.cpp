@@ -0,0 +1,445 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "cidsteer.h"
+
+#include <log4cxx/logger.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#if defined(__linux__)
+#include <linux/bpf.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_bpf)
+#define CID_STEER_SUPPORTED 1
+#else
+#define CID_STEER_SUPPORTED 0
+#endif
+
+
+/* Older kernel headers miss these, the values are kernel ABI */
+#define STEER_PROG_TYPE_SK_REUSEPORT        21
+#define STEER_MAP_TYPE_LRU_HASH             9
+#define STEER_MAP_TYPE_REUSEPORT_SOCKARRAY  20
+#define STEER_FUNC_map_lookup_elem          1
+#define STEER_FUNC_skb_load_bytes           26
+#define STEER_FUNC_sk_select_reuseport      82
+#define STEER_SK_PASS                       1
+#ifndef SO_ATTACH_REUSEPORT_EBPF
+#define SO_ATTACH_REUSEPORT_EBPF            52
+#endif
+
+/* CID map size: lsquic keeps up to 8 SCIDs of a connection active. The
+ * least recently used CIDs are dropped beyond it. */
+#define CID_STEER_CIDS_PER_CONN 8
+#define CID_STEER_MIN_CIDS      4096
+#define CID_STEER_MAX_CIDS      (1024 * 1024)
+
+
+int CidSteer::s_iCidMapFd = -1;
+
+
+CidSteer::CidSteer()
+    : m_iSockMapFd(-1)
+    , m_iProgFd(-1)
+    , m_iWorkers(0)
+{
+}
+
+
+CidSteer::~CidSteer()
+{
+    detach();
+}
+
+
+void CidSteer::detach()
+{
+    if (m_iProgFd != -1)
+        close(m_iProgFd);
+    if (m_iSockMapFd != -1)
+        close(m_iSockMapFd);
+    m_iProgFd = -1;
+    m_iSockMapFd = -1;
+    m_iWorkers = 0;
+}
+
+
+#if CID_STEER_SUPPORTED
+
+static int sys_bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+
+static int createMap(int type, int keySize, int valueSize, int maxEntries)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type    = type;
+    attr.key_size    = keySize;
+    attr.value_size  = valueSize;
+    attr.max_entries = maxEntries;
+    return sys_bpf(BPF_MAP_CREATE, &attr);
+}
+
+
+static int updateElem(int fd, const void *pKey, const void *pValue)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = fd;
+    attr.key    = (uint64_t)(unsigned long)pKey;
+    attr.value  = (uint64_t)(unsigned long)pValue;
+    attr.flags  = BPF_ANY;
+    return sys_bpf(BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+
+static int deleteElem(int fd, const void *pKey)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = fd;
+    attr.key    = (uint64_t)(unsigned long)pKey;
+    return sys_bpf(BPF_MAP_DELETE_ELEM, &attr);
+}
+
+
+static int lookupElem(int fd, const void *pKey, void *pValue)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = fd;
+    attr.key    = (uint64_t)(unsigned long)pKey;
+    attr.value  = (uint64_t)(unsigned long)pValue;
+    return sys_bpf(BPF_MAP_LOOKUP_ELEM, &attr);
+}
+
+
+//pKey NULL gets the first key
+static int nextKey(int fd, const void *pKey, void *pNextKey)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd   = fd;
+    attr.key      = (uint64_t)(unsigned long)pKey;
+    attr.next_key = (uint64_t)(unsigned long)pNextKey;
+    return sys_bpf(BPF_MAP_GET_NEXT_KEY, &attr);
+}
+
+
+/**
+ * The map is created once in the main process and shared by all workers,
+ * it is sized by the first attach().
+ */
+int CidSteer::initCidMap(int iMaxConns)
+{
+    if (s_iCidMapFd == -1)
+    {
+        long entries = (long)iMaxConns * CID_STEER_CIDS_PER_CONN;
+        if (entries < CID_STEER_MIN_CIDS)
+            entries = CID_STEER_MIN_CIDS;
+        else if (entries > CID_STEER_MAX_CIDS)
+            entries = CID_STEER_MAX_CIDS;
+        s_iCidMapFd = createMap(STEER_MAP_TYPE_LRU_HASH, CID_STEER_LEN,
+                                sizeof(uint32_t), entries);
+        if (s_iCidMapFd == -1)
+            return LS_FAIL;
+    }
+    return LS_OK;
+}
+
+
+#define INSN(code, dst, src, off, imm)  { (uint8_t)(code), (dst), (src), \
+                                          (int16_t)(off), (int32_t)(imm) }
+#define MOV_REG(dst, src)   INSN(BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0)
+#define MOV_IMM(dst, imm)   INSN(BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm)
+#define ADD_IMM(dst, imm)   INSN(BPF_ALU64 | BPF_ADD | BPF_K, dst, 0, 0, imm)
+#define LDX(size, dst, src, off) \
+                            INSN(BPF_LDX | BPF_MEM | size, dst, src, off, 0)
+#define STX(size, dst, src, off) \
+                            INSN(BPF_STX | BPF_MEM | size, dst, src, off, 0)
+#define JEQ_IMM(dst, imm, off)  INSN(BPF_JMP | BPF_JEQ | BPF_K, dst, 0, off, imm)
+#define JNE_IMM(dst, imm, off)  INSN(BPF_JMP | BPF_JNE | BPF_K, dst, 0, off, imm)
+#define JSET_IMM(dst, imm, off) INSN(BPF_JMP | BPF_JSET | BPF_K, dst, 0, off, imm)
+#define JA(off)             INSN(BPF_JMP | BPF_JA, 0, 0, off, 0)
+#define CALL(func)          INSN(BPF_JMP | BPF_CALL, 0, 0, 0, func)
+#define EXIT()              INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+#define LD_MAP_FD(dst, fd)  INSN(BPF_LD | BPF_DW | BPF_IMM, dst, \
+                                 BPF_PSEUDO_MAP_FD, 0, fd), \
+                            INSN(0, 0, 0, 0, 0)
+
+//R10 is the frame pointer
+#define FP  10
+
+//skb data of SK_REUSEPORT programs starts at the UDP header
+#define UDP_HDR_LEN         8
+//QUIC long header: flags, version, DCID length, DCID
+#define LONG_DCID_LEN_OFF   (UDP_HDR_LEN + 5)
+#define LONG_DCID_OFF       (UDP_HDR_LEN + 6)
+//QUIC short header: flags, DCID
+#define SHORT_DCID_OFF      (UDP_HDR_LEN + 1)
+
+
+int CidSteer::loadProg()
+{
+    /*
+     * if (load_bytes(0, &flags, 1)) return SK_PASS;
+     * if (flags & 0x80)
+     * {
+     *     if (load_bytes(5, &len, 1) || len != CID_STEER_LEN)
+     *         return SK_PASS;
+     *     off = 6;
+     * }
+     * else
+     *     off = 1;
+     * if (load_bytes(off, cid, CID_STEER_LEN)) return SK_PASS;
+     * if ((worker = lookup(cid_map, cid)))
+     *     sk_select_reuseport(ctx, sock_map, worker, 0);
+     * return SK_PASS;
+     *
+     * SK_PASS with no socket selected leaves the choice to the kernel hash.
+     */
+    struct bpf_insn prog[] =
+    {
+        MOV_REG(6, 1),
+        /* 1 */
+        MOV_REG(1, 6),
+        MOV_IMM(2, UDP_HDR_LEN),
+        MOV_REG(3, FP),
+        ADD_IMM(3, -16),
+        MOV_IMM(4, 1),
+        CALL(STEER_FUNC_skb_load_bytes),
+        JNE_IMM(0, 0, 35),
+        LDX(BPF_B, 1, FP, -16),
+        MOV_IMM(2, SHORT_DCID_OFF),
+        JSET_IMM(1, 0x80, 1),
+        JA(10),
+        /* 12: long header */
+        MOV_REG(1, 6),
+        MOV_IMM(2, LONG_DCID_LEN_OFF),
+        MOV_REG(3, FP),
+        ADD_IMM(3, -16),
+        MOV_IMM(4, 1),
+        CALL(STEER_FUNC_skb_load_bytes),
+        JNE_IMM(0, 0, 24),
+        LDX(BPF_B, 1, FP, -16),
+        JNE_IMM(1, CID_STEER_LEN, 22),
+        MOV_IMM(2, LONG_DCID_OFF),
+        /* 22: load the CID */
+        MOV_REG(1, 6),
+        MOV_REG(3, FP),
+        ADD_IMM(3, -8),
+        MOV_IMM(4, CID_STEER_LEN),
+        CALL(STEER_FUNC_skb_load_bytes),
+        JNE_IMM(0, 0, 15),
+        LD_MAP_FD(1, s_iCidMapFd),
+        MOV_REG(2, FP),
+        ADD_IMM(2, -8),
+        CALL(STEER_FUNC_map_lookup_elem),
+        JEQ_IMM(0, 0, 9),
+        LDX(BPF_W, 1, 0, 0),
+        STX(BPF_W, FP, 1, -12),
+        MOV_REG(1, 6),
+        LD_MAP_FD(2, m_iSockMapFd),
+        MOV_REG(3, FP),
+        ADD_IMM(3, -12),
+        MOV_IMM(4, 0),
+        CALL(STEER_FUNC_sk_select_reuseport),
+        /* 43 */
+        MOV_IMM(0, STEER_SK_PASS),
+        EXIT(),
+    };
+    char achLog[4096];
+    union bpf_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = STEER_PROG_TYPE_SK_REUSEPORT;
+    attr.insns     = (uint64_t)(unsigned long)prog;
+    attr.insn_cnt  = sizeof(prog) / sizeof(prog[0]);
+    attr.license   = (uint64_t)(unsigned long)"GPL";
+    attr.log_buf   = (uint64_t)(unsigned long)achLog;
+    attr.log_size  = sizeof(achLog);
+    attr.log_level = 1;
+    achLog[0] = 0;
+    m_iProgFd = sys_bpf(BPF_PROG_LOAD, &attr);
+    if (m_iProgFd == -1)
+    {
+        LS_DBG_L("[CidSteer] failed to load steering program: %s %s",
+                 strerror(errno), achLog);
+        return LS_FAIL;
+    }
+    return LS_OK;
+}
+
+
+int CidSteer::attach(int groupFd, int iWorkers, int iMaxConns)
+{
+    detach();
+    if (initCidMap(iMaxConns) != LS_OK)
+    {
+        LS_NOTICE("[CidSteer] cannot create CID map: %s, QUIC packets are "
+                  "steered by address only.", strerror(errno));
+        return LS_FAIL;
+    }
+    m_iSockMapFd = createMap(STEER_MAP_TYPE_REUSEPORT_SOCKARRAY,
+                             sizeof(uint32_t), sizeof(uint64_t), iWorkers);
+    if (m_iSockMapFd == -1 || loadProg() != LS_OK)
+    {
+        LS_NOTICE("[CidSteer] SK_REUSEPORT programs are not supported: %s, "
+                  "QUIC packets are steered by address only.",
+                  strerror(errno));
+        detach();
+        return LS_FAIL;
+    }
+    //The program belongs to the whole SO_REUSEPORT group
+    if (setsockopt(groupFd, SOL_SOCKET, SO_ATTACH_REUSEPORT_EBPF,
+                   &m_iProgFd, sizeof(m_iProgFd)) != 0)
+    {
+        LS_NOTICE("[CidSteer] cannot attach steering program: %s",
+                  strerror(errno));
+        detach();
+        return LS_FAIL;
+    }
+    m_iWorkers = iWorkers;
+    LS_DBG_L("[CidSteer] steering QUIC packets of %d workers by CID.",
+             iWorkers);
+    return LS_OK;
+}
+
+
+/**
+ * The socket of a worker leaves the array by itself once it is closed,
+ * the main process only keeps the primary socket open.
+ */
+int CidSteer::setSock(int iWorker, int fd)
+{
+    uint32_t idx = iWorker;
+    uint64_t val = fd;
+    if ((m_iSockMapFd == -1) || (iWorker < 0) || (iWorker >= m_iWorkers))
+        return LS_FAIL;
+    if (updateElem(m_iSockMapFd, &idx, &val) != 0)
+    {
+        LS_NOTICE("[CidSteer] cannot add socket of worker #%d: %s",
+                  iWorker + 1, strerror(errno));
+        return LS_FAIL;
+    }
+    return LS_OK;
+}
+
+
+void CidSteer::removeSock(int iWorker)
+{
+    uint32_t idx = iWorker;
+    if ((m_iSockMapFd == -1) || (iWorker < 0) || (iWorker >= m_iWorkers))
+        return;
+    deleteElem(m_iSockMapFd, &idx);
+}
+
+
+/**
+ * Called in the main process when a worker exits, its connections are
+ * gone and the CIDs would steer packets to its slot otherwise. Returns
+ * the number of CIDs removed.
+ */
+int CidSteer::removeWorkerCids(int iWorker)
+{
+    uint8_t key[CID_STEER_LEN];
+    uint8_t next[CID_STEER_LEN];
+    uint32_t worker;
+    int removed = 0;
+    int more;
+
+    if (s_iCidMapFd == -1)
+        return 0;
+    more = (nextKey(s_iCidMapFd, NULL, key) == 0);
+    while (more)
+    {
+        //get the next key first, the current one may go away
+        more = (nextKey(s_iCidMapFd, key, next) == 0);
+        if ((lookupElem(s_iCidMapFd, key, &worker) == 0)
+            && (worker == (uint32_t)iWorker)
+            && (deleteElem(s_iCidMapFd, key) == 0))
+            ++removed;
+        memcpy(key, next, sizeof(key));
+    }
+    LS_DBG_L("[CidSteer] removed %d CIDs of worker #%d.", removed,
+             iWorker + 1);
+    return removed;
+}
+
+
+int CidSteer::addCid(const lsquic_cid_t *pCid, int iWorker)
+{
+    uint32_t worker = iWorker;
+    if (s_iCidMapFd == -1 || pCid->len != CID_STEER_LEN)
+        return LS_FAIL;
+    return (updateElem(s_iCidMapFd, pCid->idbuf, &worker) == 0)
+           ? LS_OK : LS_FAIL;
+}
+
+
+void CidSteer::removeCid(const lsquic_cid_t *pCid)
+{
+    if (s_iCidMapFd == -1 || pCid->len != CID_STEER_LEN)
+        return;
+    deleteElem(s_iCidMapFd, pCid->idbuf);
+}
+
+#else
+
+int CidSteer::attach(int groupFd, int iWorkers, int iMaxConns)
+{
+    return LS_FAIL;
+}
+
+
+int CidSteer::setSock(int iWorker, int fd)
+{
+    return LS_FAIL;
+}
+
+
+void CidSteer::removeSock(int iWorker)
+{
+}
+
+
+int CidSteer::addCid(const lsquic_cid_t *pCid, int iWorker)
+{
+    return LS_FAIL;
+}
+
+
+void CidSteer::removeCid(const lsquic_cid_t *pCid)
+{
+}
+
+
+int CidSteer::removeWorkerCids(int iWorker)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef CIDSTEER_H
+#define CIDSTEER_H
+
+#include <lsdef.h>
+#include <lsquic_types.h>
+
+/* Length of the server chosen CIDs, lsquic default */
+#define CID_STEER_LEN   8
+
+
+/**
+ * Steers QUIC packets to the worker owning their connection.
+ *
+ * Every worker reads its own SO_REUSEPORT UDP socket. An eBPF
+ * SK_REUSEPORT program attached to the group reads the destination CID
+ * of each datagram, looks it up in a map from CID to worker index shared
+ * by all workers, and picks the socket of that worker. Packets with an
+ * unknown CID, such as the first Initial of a connection, are left to the
+ * kernel hash of the 4-tuple. A worker adds the CIDs lsquic issues for
+ * its connections and removes them when they retire; the main process
+ * removes the CIDs of a worker that exits.
+ */
+class CidSteer
+{
+public:
+    CidSteer();
+    ~CidSteer();
+
+    /**
+     * Called in the main process, attaches the program to the
+     * SO_REUSEPORT group of groupFd. The CID map holds the CIDs of up to
+     * iMaxConns connections. Returns LS_FAIL when the kernel does not
+     * support it, the sockets then fall back to hashing.
+     */
+    int attach(int groupFd, int iWorkers, int iMaxConns);
+    void detach();
+    bool isAttached() const     {   return m_iProgFd != -1;     }
+
+    /** Steer to fd the packets of worker iWorker, 0 based. */
+    int  setSock(int iWorker, int fd);
+    void removeSock(int iWorker);
+
+    static int  addCid(const lsquic_cid_t *pCid, int iWorker);
+    static void removeCid(const lsquic_cid_t *pCid);
+    static int  removeWorkerCids(int iWorker);
+
+private:
+    int     m_iSockMapFd;
+    int     m_iProgFd;
+    int     m_iWorkers;
+
+    static int s_iCidMapFd;
+
+    static int initCidMap(int iMaxConns);
+    int loadProg();
+
+    LS_NO_COPY_ASSIGN(CidSteer);
+};
+
+#endif // CIDSTEER_H
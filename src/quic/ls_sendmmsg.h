@@ -32,6 +32,14 @@ struct mmsghdr
 
 #endif  //__NR_sendmmsg
 
+#ifndef __NR_recvmmsg
+#if defined(__i386__)
+#define __NR_recvmmsg 337
+#elif defined( __x86_64 )||defined( __x86_64__ )
+#define __NR_recvmmsg 299
+#endif
+#endif  //__NR_recvmmsg
+
 
 static inline int ls_sendmmsg(int __fd, struct mmsghdr *__vmessages,
                      unsigned int __vlen, int __flags)
@@ -47,6 +55,20 @@ static inline bool is_sendmmsg_available()
 }
 
 
+static inline int ls_recvmmsg(int __fd, struct mmsghdr *__vmessages,
+                     unsigned int __vlen, int __flags)
+{
+    return (syscall(__NR_recvmmsg, __fd, __vmessages, __vlen, __flags, NULL));
+}
+
+
+static inline bool is_recvmmsg_available()
+{
+    ls_recvmmsg(-1, NULL, 0, 0);
+    return (errno != ENOSYS);
+}
+
+
 #else   //__linux__
 
 #define ls_sendmmsg sendmmsg
@@ -56,6 +78,11 @@ static inline bool is_sendmmsg_available()
     return false;
 }
 
+static inline bool is_recvmmsg_available()
+{
+    return false;
+}
+
 #endif  //__linux__
 
 #endif  //__LS_SENDMMSG__
@@ -16,6 +16,7 @@
 #include <lsr/ls_str.h>
 #include <http/ntwkiolink.h>
 
+#include <quic/cidsteer.h>
 #include <quic/quicstream.h>
 #include <quic/udplistener.h>
 #include <quicshm.h>
@@ -210,7 +211,10 @@ void QuicEngine::removeOldSCIDs(void *ctx, void **peer_ctx,
     QuicShm::getInstance().markBadCidItems(cids, count, -1);
     const lsquic_cid_t *const end = cids + count;
     for( ; cids < end; ++cids)
+    {
         UdpListener::deleteCidListenerEntry(cids);
+        CidSteer::removeCid(cids);
+    }
 
 }
 
@@ -227,11 +231,12 @@ void QuicEngine::addNewSCIDs(void *ctx, void **peer_ctx,
     QuicShm::getInstance().lookupCidPids(cids, pids, count);
 
     for(n = 0; n < count; ++n)
+    {
+        pUdpListener = (UdpListener *) peer_ctx[n];
         if (pids[n].pid > 0)
-        {
-            pUdpListener = (UdpListener *) peer_ctx[n];
             pUdpListener->updateCidListenerMap(&cids[n], &pids[n]);
-        }
+        pUdpListener->steerCid(&cids[n]);
+    }
 }
 
 
@@ -255,6 +260,7 @@ void QuicEngine::onConnClosed(lsquic_conn_t *c)
     cid = lsquic_conn_id(c);
     QuicShm::getInstance().markClosedCidItem(cid);
     UdpListener::deleteCidListenerEntry(cid);
+    CidSteer::removeCid(cid);
 }
 
 
@@ -10,6 +10,7 @@
 #include <util/datetime.h>
 #include <http/clientinfo.h>
 #include <http/hiohandlerfactory.h>
+#include <http/httppriority.h>
 #include <http/httpstatuscode.h>
 #include <http/httprespheaders.h>
 #include <log4cxx/logger.h>
@@ -43,14 +44,7 @@ int QuicStream::init(lsquic_stream_t *s)
 
     setState(HIOS_CONNECTED);
 
-    int pri = HIO_PRIORITY_HTML;
-//     if (pPriority)
-//     {
-//         if (pPriority->m_weight <= 32)
-//             pri = (32 - pPriority->m_weight) >> 2;
-//         else
-//             pri = (256 - pPriority->m_weight) >> 5;
-//     }
+    int pri = HTTP_PRI_URGENCY_DEFAULT;
     setPriority(pri);
 
     LS_DBG_L(this, "QuicStream::init(), id: %" PRIu64 ", priority: %d, flag: %d. ",
@@ -68,6 +62,11 @@ int QuicStream::processUpkdHdrs(QuicUpkdHdrs *hdrs)
 
     pHandler->attachStream(this);
 
+    int urgency = getPriority();
+    int incremental = 0;
+    if (HttpPriority::parse(&hdrs->headers, &urgency, &incremental))
+        applyExtPriority(urgency, incremental);
+
     m_pHeaders = &hdrs->headers;
     pHandler->onInitConnected();
     m_pHeaders = NULL;
@@ -79,6 +78,28 @@ int QuicStream::processUpkdHdrs(QuicUpkdHdrs *hdrs)
 }
 
 
+/**
+ * Hands the RFC 9218 urgency and incremental flag to lsquic as they are;
+ * it only accepts them on HTTP/3 streams.
+ */
+void QuicStream::applyExtPriority(int urgency, int incremental)
+{
+    LS_DBG_L(this, "QuicStream::applyExtPriority(), urgency: %d, "
+             "incremental: %d", urgency, incremental);
+    setPriority(urgency);
+    setFlag(HIO_FLAG_INCREMENTAL, incremental);
+    if (m_pStream)
+    {
+        struct lsquic_ext_http_prio prio;
+        prio.urgency = urgency;
+        prio.incremental = incremental;
+        if (lsquic_stream_set_http_prio(m_pStream, &prio) != 0)
+            LS_DBG_L(this, "lsquic_stream_set_http_prio() failed, "
+                     "priority not applied.");
+    }
+}
+
+
 int QuicStream::shutdown()
 {
     LS_DBG_L(this, "QuicStream::shutdown()");
@@ -89,6 +89,7 @@ public:
 
 private:
     int checkReadRet(int ret);
+    void applyExtPriority(int urgency, int incremental);
 
     UnpackedHeaders * m_pHeaders;
 };
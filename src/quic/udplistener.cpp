@@ -7,6 +7,7 @@
 #   define __APPLE_USE_RFC_3542 1
 #endif
 
+#include "cidsteer.h"
 #include "quicshm.h"
 #include "udplistener.h"
 #include "quicengine.h"
@@ -16,6 +17,9 @@
 #include "quiclog.h"
 #include <errno.h>
 #include <netinet/ip.h>
+#if __linux__
+#include <netinet/udp.h>
+#endif
 #include <sys/time.h>
 #include <edio/multiplexer.h>
 #include <edio/multiplexerfactory.h>
@@ -24,6 +28,8 @@
 #include <util/ghash.h>
 #include <log4cxx/logger.h>
 #include <lsr/xxhash.h>
+#include <http/connlimitctrl.h>
+#include <http/httpserverconfig.h>
 #include <http/vhostmap.h>
 #include <sslpp/sslcontext.h>
 
@@ -63,7 +69,66 @@
 
 #define CTL_SZ CMSG_SPACE(MAX(DST_MSG_SZ, sizeof(struct in6_pktinfo)) +  ECN_SZ)
 
+#if __linux__ && !defined(_NOT_USE_SHM_)
+#   define RECVMMSG_SUPPORTED 1
+#else
+#   define RECVMMSG_SUPPORTED 0
+#endif
+
+#if __linux__
+#ifndef SOL_UDP
+#   define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#   define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#   define UDP_GRO 104
+#endif
+
+/* Kernel limits of one UDP_SEGMENT send */
+#define GSO_MAX_SEGMENTS    64
+#define GSO_MAX_BYTES       (65535 - 8 - 40)
+#define GSO_CTL_SZ          CMSG_SPACE(sizeof(uint16_t))
+#endif
+
+#if RECVMMSG_SUPPORTED
+
+/* How packets are read from the socket, picked by initRecvMode() */
+enum recv_mode
+{
+    RM_ONE,     /* recvmsg(), one packet per syscall */
+    RM_MMSG,    /* recvmmsg() straight into the SHM packet buffers */
+    RM_GRO,     /* recvmmsg() of UDP_GRO super-datagrams, which are split
+                 * into SHM packet buffers */
+};
+
+/* The kernel coalesces up to 64 segments and 64 KB into one super-datagram,
+ * so these cannot be received into packet buffers directly.
+ */
+#define GRO_MSGS    8
+#define GRO_BUF_SZ  65535
+#define GRO_CTL_SZ  (CTL_SZ + CMSG_SPACE(sizeof(int)))
+
+struct gro_batch
+{
+    struct mmsghdr          mmsgs[GRO_MSGS];
+    struct iovec            vecs[GRO_MSGS];
+    struct sockaddr_storage peer_addresses[GRO_MSGS];
+    struct sockaddr_storage local_addresses[GRO_MSGS];
+    unsigned                seg_sizes[GRO_MSGS];    /* 0: not coalesced */
+    uint8_t                 ecns[GRO_MSGS];
+    unsigned                n_msgs;     /* Read by the last recvmmsg() */
+    unsigned                msg_idx;    /* Message being split */
+    unsigned                msg_off;    /* Offset of its next segment */
+    bool                    drained;    /* Last recvmmsg() came up short */
+    unsigned char           ctlmsg_data[GRO_MSGS][GRO_CTL_SZ];
+    unsigned char           data[GRO_MSGS][GRO_BUF_SZ];
+};
+#endif
+
 int UdpListener::s_rtsigNo = -1;
+int UdpListener::s_iGso = 1;
 
 static hash_key_t hash_cid(const void *__s)
 {
@@ -154,6 +219,15 @@ struct packets_in
 #endif
     unsigned                 n_avail;   /* n_avail = n_alloc in non-SHM mode */
     unsigned                 n_alloc;
+#if RECVMMSG_SUPPORTED
+    enum recv_mode           recv_mode;
+    struct mmsghdr          *mmsgs;     /* RM_MMSG: n_alloc elements */
+    struct iovec            *mmsg_vecs;
+    unsigned char           *mmsg_ctl;  /* RM_MMSG: n_alloc * CTL_SZ */
+    struct gro_batch        *gro;       /* RM_GRO only */
+#endif
+    uint64_t                 n_total_packets;
+    uint64_t                 n_total_syscalls;
 };
 
 
@@ -213,15 +287,9 @@ void UdpListener::deleteCidListenerEntry(const lsquic_cid_t *cid)
 }
 
 
-int UdpListener::start()
+int UdpListener::initSockOpts(int fd)
 {
-    //unsigned versions;
-    int saved_errno;
-    int fd;//, n;
-
-    int ret = CoreSocket::bind(m_addr, SOCK_DGRAM, &fd);
-    if (ret != 0)
-        return -1;
+    int ret;
     int val = 1;
     if (AF_INET == m_addr.get()->sa_family)
         ret = setsockopt(fd, IPPROTO_IP,
@@ -245,12 +313,7 @@ int UdpListener::start()
         val = 1;
         ret = setsockopt(fd, IPPROTO_IP, IP_PKTINFO, &val, sizeof(val));
         if (0 != ret)
-        {
-            saved_errno = errno;
-            close(fd);
-            errno = saved_errno;
             return -1;
-        }
     }
 #elif IP_RECVDSTADDR != IP_SENDSRCADDR
     /* On FreeBSD, IP_RECVDSTADDR is the same as IP_SENDSRCADDR, but I do not
@@ -261,12 +324,7 @@ int UdpListener::start()
         val = 1;
         ret = setsockopt(fd, IPPROTO_IP, IP_SENDSRCADDR, &val, sizeof(val));
         if (0 != ret)
-        {
-            saved_errno = errno;
-            close(fd);
-            errno = saved_errno;
             return -1;
-        }
     }
 #endif
 
@@ -277,12 +335,17 @@ int UdpListener::start()
     else
         ret = setsockopt(fd, IPPROTO_IPV6, IPV6_RECVTCLASS, &val, sizeof(val));
     if (0 != ret)
-    {
-        saved_errno = errno;
-        close(fd);
-        errno = saved_errno;
         return -1;
-    }
+#endif
+
+#if __linux__
+    /* Setting a zero segment size only checks that the kernel has GSO, it is
+     * set per send by sendPackets().
+     */
+    val = 0;
+    if (s_iGso)
+        m_iGso = (0 == setsockopt(fd, SOL_UDP, UDP_SEGMENT, &val, sizeof(val)));
+    LS_DBG_L(this, "UDP GSO is %s", m_iGso ? "on" : "off");
 #endif
 
     val = 1 * 1024 * 1024;
@@ -295,7 +358,28 @@ int UdpListener::start()
 
     ::fcntl(fd, F_SETFD, FD_CLOEXEC);
     ::fcntl(fd, F_SETFL, MultiplexerFactory::getMultiplexer()->getFLTag());
-    
+    return 0;
+}
+
+
+int UdpListener::start()
+{
+    //unsigned versions;
+    int saved_errno;
+    int fd;//, n;
+
+    int ret = CoreSocket::bind(m_addr, SOCK_DGRAM, &fd,
+                               HttpServerConfig::getInstance().getReusePort());
+    if (ret != 0)
+        return -1;
+    if (initSockOpts(fd) != 0)
+    {
+        saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
     setfd(fd);
     
 #ifndef  _NOT_USE_SHM_
@@ -315,6 +399,169 @@ int UdpListener::start()
 }
 
 
+int UdpListener::newReusePortSock()
+{
+    int fd;
+    int ret = CoreSocket::bind(m_addr, SOCK_DGRAM, &fd, 1);
+    if (ret != 0)
+    {
+        errno = ret;
+        return LS_FAIL;
+    }
+    if (initSockOpts(fd) != 0)
+    {
+        ret = errno;
+        close(fd);
+        errno = ret;
+        return LS_FAIL;
+    }
+    return fd;
+}
+
+
+/**
+ * Called in the main process before forking worker iProcNo, like
+ * HttpListener::setupReusePort(): every worker gets a SO_REUSEPORT socket
+ * of its own and packets are steered to the worker owning their CID, so
+ * forwarding through QuicShm is only needed when steering misses, e.g.
+ * after a client migrates or a worker restarts. The first worker forked
+ * takes the primary socket, only that one stays open in the main process,
+ * so the socket of a dead worker leaves the group together with it.
+ * iWorkers <= 1 keeps one socket shared by all workers.
+ */
+int UdpListener::setupReusePort(int iWorkers, int iProcNo)
+{
+    int flag = 0;
+    socklen_t len = sizeof(flag);
+    int fd;
+
+    releaseReusePortSock();
+    if ((iWorkers <= 1) || (getfd() == -1))
+    {
+        if (m_pCidSteer)
+        {
+            delete m_pCidSteer;
+            m_pCidSteer = NULL;
+        }
+        m_iReusePortOwner = 0;
+        return 0;
+    }
+#ifdef SO_REUSEPORT
+    if (getsockopt(getfd(), SOL_SOCKET, SO_REUSEPORT, &flag, &len) != 0)
+        flag = 0;
+#endif
+    if (!flag)
+    {
+        LS_NOTICE(this, "UDP socket was created without SO_REUSEPORT, "
+                  "full server restart is required to enable reusePort.");
+        return 0;
+    }
+    if (!m_pCidSteer)
+    {
+        m_pCidSteer = new CidSteer();
+        m_pCidSteer->attach(getfd(), iWorkers,
+                            ConnLimitCtrl::getInstance().getMaxConns());
+    }
+    if ((iProcNo < 1) || (iProcNo > iWorkers))
+        return 0;
+    if (!m_iReusePortOwner || (m_iReusePortOwner == iProcNo))
+    {
+        m_iReusePortOwner = iProcNo;
+        fd = getfd();
+    }
+    else if ((fd = newReusePortSock()) == -1)
+    {
+        LS_ERROR(this, "Failed to create SO_REUSEPORT socket for "
+                 "worker #%d: %s, fall back to shared UDP socket.",
+                 iProcNo, strerror(errno));
+        return LS_FAIL;
+    }
+    m_iReusePortFd = fd;
+    m_pCidSteer->setSock(iProcNo - 1, fd);
+    return 0;
+}
+
+
+/**
+ * Called in the main process after fork, the new worker has its own copy
+ * of the reserved socket.
+ */
+void UdpListener::releaseReusePortSock()
+{
+    if ((m_iReusePortFd != -1) && (m_iReusePortFd != getfd()))
+        close(m_iReusePortFd);
+    m_iReusePortFd = -1;
+}
+
+
+/**
+ * Called in the main process when worker iProcNo exits. Its CIDs are
+ * dropped, so their packets go by the address hash until the connections
+ * have moved on. If it read the primary socket, the next worker forked
+ * takes the primary socket over, packets queued on it meanwhile are read
+ * by that worker.
+ */
+void UdpListener::onWorkerExit(int iProcNo)
+{
+    if (!m_pCidSteer)
+        return;
+    CidSteer::removeWorkerCids(iProcNo - 1);
+    if (iProcNo == m_iReusePortOwner)
+    {
+        m_pCidSteer->removeSock(iProcNo - 1);
+        m_iReusePortOwner = 0;
+    }
+}
+
+
+/**
+ * Called in a newly forked worker, switch to the socket reserved for this
+ * worker by setupReusePort().
+ */
+void UdpListener::useReusePortSock(int iProcNo)
+{
+    int fd = m_iReusePortFd;
+    int steer = (m_pCidSteer && m_pCidSteer->isAttached());
+    m_iReusePortFd = -1;
+    //the main process keeps the steering program and the socket array
+    if (m_pCidSteer)
+    {
+        delete m_pCidSteer;
+        m_pCidSteer = NULL;
+    }
+    if ((fd == -1) || (getfd() == -1))
+        return;
+    if (fd != getfd())
+    {
+        //HttpServerImpl::reinitMultiplexer() adds it back
+        if (!MultiplexerFactory::s_iMultiplexerType)
+            MultiplexerFactory::getMultiplexer()->remove(this);
+        close(getfd());
+        setfd(fd);
+#if RECVMMSG_SUPPORTED
+        int val = 1;
+        if (m_pPacketsIn && (m_pPacketsIn->recv_mode == RM_GRO)
+            && (setsockopt(fd, SOL_UDP, UDP_GRO, &val, sizeof(val)) != 0))
+        {
+            //Keep reading with the GRO buffers, they work for plain
+            //datagrams as well.
+            LS_DBG_L(this, "cannot enable UDP_GRO: %s", strerror(errno));
+        }
+#endif
+    }
+    m_iWorker = steer ? iProcNo - 1 : -1;
+    LS_DBG_L(this, "Worker #%d reads SO_REUSEPORT UDP socket %d.",
+             iProcNo, fd);
+}
+
+
+void UdpListener::steerCid(const lsquic_cid_t *pCid)
+{
+    if (m_iWorker >= 0)
+        CidSteer::addCid(pCid, m_iWorker);
+}
+
+
 /* Replace IP address part of `sa' with that provided in ancillary messages
  * in `msg'.
  */
@@ -617,14 +864,126 @@ ssize_t UdpListener::send(struct iovec *iov, size_t iovlen,
 }
 
 
+#if __linux__
+static size_t
+spec_size (const struct lsquic_out_spec *spec)
+{
+    size_t size = 0;
+    for (size_t n = 0; n < spec->iovlen; ++n)
+        size += spec->iov[n].iov_len;
+    return size;
+}
+
+
+static bool
+same_sockaddr (const struct sockaddr *a, const struct sockaddr *b)
+{
+    if (a->sa_family != b->sa_family)
+        return false;
+    if (AF_INET == a->sa_family)
+        return ((const struct sockaddr_in *) a)->sin_port
+                            == ((const struct sockaddr_in *) b)->sin_port
+            && ((const struct sockaddr_in *) a)->sin_addr.s_addr
+                            == ((const struct sockaddr_in *) b)->sin_addr.s_addr;
+    if (AF_INET6 == a->sa_family)
+        return ((const struct sockaddr_in6 *) a)->sin6_port
+                            == ((const struct sockaddr_in6 *) b)->sin6_port
+            && 0 == memcmp(&((const struct sockaddr_in6 *) a)->sin6_addr,
+                           &((const struct sockaddr_in6 *) b)->sin6_addr,
+                           sizeof(struct in6_addr));
+    return true;
+}
+
+
+/* Returns how many packets starting at `spec' can go out as one UDP_SEGMENT
+ * send: same peer, source address and ECN, and all but the last one of the
+ * same size.  lsquic hands out the packets of a bulk transfer like that.
+ */
+unsigned UdpListener::gsoRunLength(const struct lsquic_out_spec *spec,
+                                   const struct lsquic_out_spec *end,
+                                   unsigned max_iov, size_t *seg_size)
+{
+    const struct lsquic_out_spec *next;
+    size_t size, next_size, total;
+    unsigned n, n_iov;
+
+    size = spec_size(spec);
+    total = size;
+    n_iov = spec->iovlen;
+    for (n = 1, next = spec + 1; next < end && n < GSO_MAX_SEGMENTS;
+                                                                ++n, ++next)
+    {
+        next_size = spec_size(next);
+        if (next_size > size || next_size == 0
+            || total + next_size > GSO_MAX_BYTES
+            || n_iov + next->iovlen > max_iov
+            || next->ecn != spec->ecn
+            || !same_sockaddr(next->dest_sa, spec->dest_sa)
+            || !same_sockaddr(next->local_sa, spec->local_sa))
+            break;
+        total += next_size;
+        n_iov += next->iovlen;
+        if (next_size < size)
+        {
+            ++n;
+            break;
+        }
+    }
+    *seg_size = size;
+    return n;
+}
+
+
+static void
+add_segment_cmsg (struct msghdr *msg, unsigned char *buf, size_t bufsz,
+                  uint16_t seg_size)
+{
+    struct cmsghdr *cmsg;
+
+    /* setup_control_msg() leaves msg_controllen CMSG_SPACE() aligned */
+    assert(msg->msg_controllen + GSO_CTL_SZ <= bufsz);
+    cmsg = (struct cmsghdr *) (buf + msg->msg_controllen);
+    memset(cmsg, 0, GSO_CTL_SZ);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type  = UDP_SEGMENT;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(seg_size));
+    memcpy(CMSG_DATA(cmsg), &seg_size, sizeof(seg_size));
+    msg->msg_control     = buf;
+    msg->msg_controllen += GSO_CTL_SZ;
+}
+
+
+/* The kernel refuses UDP_SEGMENT with EIO when the route or the device
+ * cannot segment, send the run one packet at a time instead.
+ */
+unsigned UdpListener::sendWithoutGso(const struct lsquic_out_spec *spec,
+                                     unsigned n)
+{
+    unsigned sent;
+
+    for (sent = 0; sent < n; ++sent, ++spec)
+        if (sendPacket(spec->iov, spec->iovlen, spec->local_sa,
+                                            spec->dest_sa, spec->ecn) < 0)
+            break;
+    m_nSendMsgs += sent;
+    m_nSendPackets += sent;
+    return sent;
+}
+#endif
+
+
 int UdpListener::sendPackets(const struct lsquic_out_spec *spec,
                              unsigned count)
 {
 #if __linux__
+    const struct lsquic_out_spec *const begin = spec;
     const struct lsquic_out_spec *const end = spec + count;
-    unsigned i;
+    unsigned i, k, n_iov, run, n_sent;
+    size_t seg_size;
     int cw;
     struct mmsghdr mmsgs[1024];
+    unsigned msg_packets[ sizeof(mmsgs) / sizeof(mmsgs[0]) ];
+    struct iovec iovs[ sizeof(mmsgs) / sizeof(mmsgs[0]) ];
     union {
         /* cmsg(3) recommends union for proper alignment */
         unsigned char buf[ CMSG_SPACE(
@@ -638,22 +997,45 @@ int UdpListener::sendPackets(const struct lsquic_out_spec *spec,
 #if ECN_SUPPORTED
             + ECN_SZ
 #endif
-                                                                  ) ];
+                                                                  )
+            + GSO_CTL_SZ ];
         struct cmsghdr cmsg;
     } ancil [ sizeof(mmsgs) / sizeof(mmsgs[0]) ];
 
     if (getEvents() & POLLOUT)
         return -1;
 
-    for (i = 0; spec < end && i < sizeof(mmsgs) / sizeof(mmsgs[0]); ++i, ++spec)
+    n_iov = 0;
+    for (i = 0; spec < end && i < sizeof(mmsgs) / sizeof(mmsgs[0]); ++i)
     {
+        if (m_iGso)
+            run = gsoRunLength(spec, end,
+                        sizeof(iovs) / sizeof(iovs[0]) - n_iov, &seg_size);
+        else
+            run = 1;
         mmsgs[i].msg_hdr.msg_name       = (void *) spec->dest_sa;
         mmsgs[i].msg_hdr.msg_namelen    = (AF_INET == spec->dest_sa->sa_family ?
                                             sizeof(struct sockaddr_in) :
                                             sizeof(struct sockaddr_in6)),
-        mmsgs[i].msg_hdr.msg_iov        = spec->iov;
-        mmsgs[i].msg_hdr.msg_iovlen     = spec->iovlen;
         mmsgs[i].msg_hdr.msg_flags      = 0;
+        if (run > 1)
+        {
+            /* One buffer made of the iovecs of all packets of the run */
+            mmsgs[i].msg_hdr.msg_iov    = &iovs[n_iov];
+            mmsgs[i].msg_hdr.msg_iovlen = 0;
+            for (k = 0; k < run; ++k)
+            {
+                memcpy(&iovs[n_iov], spec[k].iov,
+                       spec[k].iovlen * sizeof(iovs[0]));
+                n_iov += spec[k].iovlen;
+                mmsgs[i].msg_hdr.msg_iovlen += spec[k].iovlen;
+            }
+        }
+        else
+        {
+            mmsgs[i].msg_hdr.msg_iov    = spec->iov;
+            mmsgs[i].msg_hdr.msg_iovlen = spec->iovlen;
+        }
         if (spec->local_sa->sa_family)
             cw = CW_SENDADDR;
         else
@@ -670,17 +1052,54 @@ int UdpListener::sendPackets(const struct lsquic_out_spec *spec,
             mmsgs[i].msg_hdr.msg_control = NULL;
             mmsgs[i].msg_hdr.msg_controllen = 0;
         }
+        if (run > 1)
+            add_segment_cmsg(&mmsgs[i].msg_hdr, ancil[i].buf,
+                             sizeof(ancil[i].buf), seg_size);
+        msg_packets[i] = run;
+        spec += run;
     }
 
     int ret = ls_sendmmsg(getfd(), mmsgs, i, 0);
-    if (ret < (int) count)
+    n_sent = 0;
+    for (k = 0; (int) k < ret; ++k)
+        n_sent += msg_packets[k];
+    m_nSendMsgs += k;
+    m_nSendPackets += n_sent;
+
+    /* sendmmsg() stops at the first message it cannot send; when that is a
+     * UDP_SEGMENT one, find out whether it was refused.
+     */
+    if (k < i && msg_packets[k] > 1)
+    {
+        if (sendmsg(getfd(), &mmsgs[k].msg_hdr, 0) >= 0)
+        {
+            n_sent += msg_packets[k];
+            ++m_nSendMsgs;
+            m_nSendPackets += msg_packets[k];
+        }
+        else if (errno == EIO)
+        {
+            LS_DBG_L(this, "%s: UDP_SEGMENT send of %u packets failed, "
+                     "send them one by one", __func__, msg_packets[k]);
+            n_sent += sendWithoutGso(begin + n_sent, msg_packets[k]);
+        }
+    }
+
+    LS_DBG_H(this, "%s: sent %u of %u packets in %u sends, %.2f segments/send "
+             "(%.2f since start)", __func__, n_sent, count, k,
+             k ? (double) n_sent / k : 0.0,
+             m_nSendMsgs ? (double) m_nSendPackets / m_nSendMsgs : 0.0);
+
+    if (n_sent < count)
     {
         if (errno == EPERM)
-            ret = count;
+            n_sent = count;
         else
             MultiplexerFactory::getMultiplexer()->continueWrite(this);
     }
-    return ret;
+    if (n_sent == 0 && count > 0)
+        return -1;
+    return n_sent;
 #else
     return -1;
 #endif //__linux__
@@ -690,6 +1109,7 @@ int UdpListener::sendPackets(const struct lsquic_out_spec *spec,
 struct read_iter
 {
     unsigned                 ri_idx;    /* Current element */
+    unsigned                 ri_syscalls;
 #ifdef _NOT_USE_SHM_
     unsigned                 ri_off;    /* Offset into packet_data */
 #endif
@@ -1265,6 +1685,7 @@ enum rop UdpListener::readOnePacket(struct read_iter *iter)
 #endif
 
     nread = recvmsg(getfd(), &msg, 0);
+    ++iter->ri_syscalls;
     if (-1 == nread) {
         if (!(EAGAIN == errno || EWOULDBLOCK == errno))
             LS_ERROR("recvmsg: %s", strerror(errno));
@@ -1311,13 +1732,323 @@ enum rop UdpListener::readOnePacket(struct read_iter *iter)
 }
 
 
+#if RECVMMSG_SUPPORTED
+/* Returns the segment size of a UDP_GRO super-datagram, 0 if the kernel did
+ * not coalesce it.
+ */
+static unsigned
+gro_segment_size (struct msghdr *msg)
+{
+    struct cmsghdr *cmsg;
+    int seg_size;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+        {
+            memcpy(&seg_size, CMSG_DATA(cmsg), sizeof(seg_size));
+            return seg_size > 0 ? seg_size : 0;
+        }
+    return 0;
+}
+
+
+/* Prefers UDP_GRO, then plain recvmmsg(), then recvmsg().  UDP_GRO is only
+ * turned on once its buffers are allocated: from then on a read into a
+ * packet buffer would truncate super-datagrams.
+ */
+void UdpListener::initRecvMode()
+{
+    int val = 1;
+
+    m_pPacketsIn->recv_mode = RM_ONE;
+    if (!is_recvmmsg_available())
+    {
+        LS_INFO(this, "%s: recvmmsg() is not available", __func__);
+        return;
+    }
+
+    m_pPacketsIn->gro = (struct gro_batch *) malloc(sizeof(struct gro_batch));
+    if (m_pPacketsIn->gro)
+    {
+        if (0 == setsockopt(getfd(), SOL_UDP, UDP_GRO, &val, sizeof(val)))
+        {
+            m_pPacketsIn->gro->n_msgs = 0;
+            m_pPacketsIn->gro->msg_idx = 0;
+            m_pPacketsIn->gro->msg_off = 0;
+            m_pPacketsIn->gro->drained = false;
+            m_pPacketsIn->recv_mode = RM_GRO;
+            LS_INFO(this, "%s: use recvmmsg() with UDP_GRO", __func__);
+            return;
+        }
+        LS_DBG_L(this, "%s: cannot enable UDP_GRO: %s", __func__,
+                 strerror(errno));
+        free(m_pPacketsIn->gro);
+        m_pPacketsIn->gro = NULL;
+    }
+
+    m_pPacketsIn->mmsgs = (struct mmsghdr *) calloc(m_pPacketsIn->n_alloc,
+                                            sizeof(m_pPacketsIn->mmsgs[0]));
+    m_pPacketsIn->mmsg_vecs = (struct iovec *) calloc(m_pPacketsIn->n_alloc,
+                                            sizeof(m_pPacketsIn->mmsg_vecs[0]));
+    m_pPacketsIn->mmsg_ctl = (unsigned char *) malloc(
+                                            m_pPacketsIn->n_alloc * CTL_SZ);
+    if (m_pPacketsIn->mmsgs && m_pPacketsIn->mmsg_vecs
+        && m_pPacketsIn->mmsg_ctl)
+    {
+        m_pPacketsIn->recv_mode = RM_MMSG;
+        LS_INFO(this, "%s: use recvmmsg()", __func__);
+    }
+}
+
+
+/* Receives as many packets as there are packet buffers left in the batch
+ * with a single recvmmsg().  Returns ROP_ERROR once the socket has been
+ * drained.
+ */
+enum rop UdpListener::readPacketBatch(struct read_iter *iter)
+{
+    unsigned n, base, count;
+    lsquic_cid_t cid;
+    int nread;
+
+    if (iter->ri_idx >= m_pPacketsIn->n_avail)
+    {
+        LS_DBG_M(this, "%s: out of room in packets_in", __func__);
+        return ROP_NOROOM;
+    }
+
+    base = iter->ri_idx;
+    count = m_pPacketsIn->n_avail - base;
+    for (n = 0; n < count; ++n)
+    {
+        packet_buf_t *const packet_buf = m_pPacketsIn->packet_bufs[base + n];
+        struct msghdr *const msg = &m_pPacketsIn->mmsgs[n].msg_hdr;
+        m_pPacketsIn->mmsg_vecs[n].iov_base = packet_buf->data;
+        m_pPacketsIn->mmsg_vecs[n].iov_len  = sizeof(packet_buf->data);
+        msg->msg_name       = &packet_buf->peer_addr;
+        msg->msg_namelen    = sizeof(packet_buf->peer_addr);
+        msg->msg_iov        = &m_pPacketsIn->mmsg_vecs[n];
+        msg->msg_iovlen     = 1;
+        msg->msg_control    = m_pPacketsIn->mmsg_ctl + n * CTL_SZ;
+        msg->msg_controllen = CTL_SZ;
+        msg->msg_flags      = 0;
+    }
+
+    nread = ls_recvmmsg(getfd(), m_pPacketsIn->mmsgs, count, 0);
+    ++iter->ri_syscalls;
+    if (-1 == nread)
+    {
+        if (!(EAGAIN == errno || EWOULDBLOCK == errno))
+            LS_ERROR("recvmmsg: %s", strerror(errno));
+        return ROP_ERROR;
+    }
+
+    for (n = 0; n < (unsigned) nread; ++n)
+    {
+        packet_buf_t *packet_buf = m_pPacketsIn->packet_bufs[base + n];
+        struct msghdr *const msg = &m_pPacketsIn->mmsgs[n].msg_hdr;
+
+        /* Drop packets that are obviously bad, see readOnePacket() */
+        if (0 != lsquic_cid_from_packet(packet_buf->data,
+                                        m_pPacketsIn->mmsgs[n].msg_len, &cid))
+            continue;
+
+        /* Keep the good packets contiguous, the buffers of dropped ones are
+         * reused by the next read.
+         */
+        if (iter->ri_idx != base + n)
+        {
+            m_pPacketsIn->packet_bufs[base + n] =
+                                m_pPacketsIn->packet_bufs[iter->ri_idx];
+            m_pPacketsIn->packet_bufs[iter->ri_idx] = packet_buf;
+        }
+
+        memcpy(&packet_buf->local_addr, m_addr.get(),
+               AF_INET == m_addr.get()->sa_family ?
+                    sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6));
+        packet_buf->ecn = 0;
+        proc_ancillary(msg, &packet_buf->local_addr
+#if ECN_SUPPORTED
+            , &packet_buf->ecn
+#endif
+        );
+        packet_buf->data_len = m_pPacketsIn->mmsgs[n].msg_len;
+        m_pPacketsIn->cids[iter->ri_idx] = cid;
+        LS_DBG_MC(this, "%s: read in packet for CID %" CID_FMT ", size: %d",
+                  __func__, CID_BITS(&cid), packet_buf->data_len);
+        iter->ri_idx += 1;
+    }
+
+    return (unsigned) nread < count ? ROP_ERROR : ROP_OK;
+}
+
+
+/* Returns the length of the segment at `*off' of a `len' byte datagram
+ * coalesced from `seg_size' byte segments, the last one may be shorter.
+ * `*off' moves to the next segment, back to 0 after the last one.
+ */
+unsigned UdpListener::groNextSegment(unsigned len, unsigned seg_size,
+                                     unsigned *off)
+{
+    unsigned seg_len = len - *off;
+    if (seg_size && seg_size < seg_len)
+        seg_len = seg_size;
+    *off += seg_len;
+    if (*off >= len)
+        *off = 0;
+    return seg_len;
+}
+
+
+bool UdpListener::hasPendingGroSegments() const
+{
+    return m_pPacketsIn->gro
+        && m_pPacketsIn->gro->msg_idx < m_pPacketsIn->gro->n_msgs;
+}
+
+
+/* Receives up to GRO_MSGS super-datagrams with a single recvmmsg() and
+ * copies their segments into the packet buffers of the batch.  Segments
+ * that do not fit are kept and handed out to the next batch before the
+ * socket is read again.
+ */
+enum rop UdpListener::readGroBatch(struct read_iter *iter)
+{
+    struct gro_batch *const gro = m_pPacketsIn->gro;
+    unsigned n, seg_len;
+    lsquic_cid_t cid;
+    int nread;
+
+    if (!hasPendingGroSegments())
+    {
+        if (iter->ri_idx >= m_pPacketsIn->n_avail)
+        {
+            LS_DBG_M(this, "%s: out of room in packets_in", __func__);
+            return ROP_NOROOM;
+        }
+
+        for (n = 0; n < GRO_MSGS; ++n)
+        {
+            struct msghdr *const msg = &gro->mmsgs[n].msg_hdr;
+            gro->vecs[n].iov_base = gro->data[n];
+            gro->vecs[n].iov_len  = GRO_BUF_SZ;
+            msg->msg_name       = &gro->peer_addresses[n];
+            msg->msg_namelen    = sizeof(gro->peer_addresses[n]);
+            msg->msg_iov        = &gro->vecs[n];
+            msg->msg_iovlen     = 1;
+            msg->msg_control    = gro->ctlmsg_data[n];
+            msg->msg_controllen = GRO_CTL_SZ;
+            msg->msg_flags      = 0;
+        }
+
+        nread = ls_recvmmsg(getfd(), gro->mmsgs, GRO_MSGS, 0);
+        ++iter->ri_syscalls;
+        if (-1 == nread)
+        {
+            if (!(EAGAIN == errno || EWOULDBLOCK == errno))
+                LS_ERROR("recvmmsg: %s", strerror(errno));
+            return ROP_ERROR;
+        }
+
+        for (n = 0; n < (unsigned) nread; ++n)
+        {
+            struct msghdr *const msg = &gro->mmsgs[n].msg_hdr;
+            memcpy(&gro->local_addresses[n], m_addr.get(),
+                   AF_INET == m_addr.get()->sa_family ?
+                    sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6));
+            gro->ecns[n] = 0;
+            proc_ancillary(msg, &gro->local_addresses[n]
+#if ECN_SUPPORTED
+                , &gro->ecns[n]
+#endif
+            );
+            gro->seg_sizes[n] = gro_segment_size(msg);
+        }
+        gro->n_msgs = nread;
+        gro->msg_idx = 0;
+        gro->msg_off = 0;
+        gro->drained = nread < GRO_MSGS;
+    }
+
+    while (gro->msg_idx < gro->n_msgs)
+    {
+        if (iter->ri_idx >= m_pPacketsIn->n_avail)
+        {
+            LS_DBG_M(this, "%s: out of room in packets_in, %u GRO "
+                     "datagram%.*s pending", __func__,
+                     gro->n_msgs - gro->msg_idx,
+                     gro->n_msgs - gro->msg_idx != 1, "s");
+            return ROP_NOROOM;
+        }
+
+        n = gro->msg_idx;
+        const unsigned char *const seg = gro->data[n] + gro->msg_off;
+        seg_len = groNextSegment(gro->mmsgs[n].msg_len, gro->seg_sizes[n],
+                                 &gro->msg_off);
+        if (gro->msg_off == 0)
+            ++gro->msg_idx;
+
+        packet_buf_t *const packet_buf =
+                                m_pPacketsIn->packet_bufs[iter->ri_idx];
+        if (seg_len > sizeof(packet_buf->data))
+        {
+            LS_DBG_M(this, "%s: drop %u byte packet, larger than packet "
+                     "buffer", __func__, seg_len);
+            continue;
+        }
+        if (0 != lsquic_cid_from_packet(seg, seg_len, &cid))
+            continue;
+
+        memcpy(packet_buf->data, seg, seg_len);
+        packet_buf->data_len = seg_len;
+        packet_buf->peer_addr = gro->peer_addresses[n];
+        packet_buf->local_addr = gro->local_addresses[n];
+        packet_buf->ecn = gro->ecns[n];
+        m_pPacketsIn->cids[iter->ri_idx] = cid;
+        LS_DBG_MC(this, "%s: read in packet for CID %" CID_FMT ", size: %u",
+                  __func__, CID_BITS(&cid), seg_len);
+        iter->ri_idx += 1;
+    }
+
+    return gro->drained ? ROP_ERROR : ROP_OK;
+}
+#endif
+
+
+enum rop UdpListener::readPackets(struct read_iter *iter)
+{
+    enum rop rop;
+
+#if RECVMMSG_SUPPORTED
+    if (m_pPacketsIn->recv_mode == RM_GRO)
+    {
+        do
+            rop = readGroBatch(iter);
+        while (ROP_OK == rop);
+        return rop;
+    }
+    if (m_pPacketsIn->recv_mode == RM_MMSG)
+    {
+        do
+            rop = readPacketBatch(iter);
+        while (ROP_OK == rop);
+        return rop;
+    }
+#endif
+    do
+        rop = readOnePacket(iter);
+    while (ROP_OK == rop);
+    return rop;
+}
+
+
 int UdpListener::onRead()
 {
     /* The code below assumes this value is smaller than one second */
 #define MAX_USEC_PER_LOOP 25000
 
     struct read_ctx rctx;
-    unsigned n_batches, n_packets;
+    unsigned n_batches, n_packets, n_syscalls;
     enum rop rop;
     struct timeval start, end;
 
@@ -1345,9 +2076,7 @@ int UdpListener::onRead()
 #endif
         rctx.rc_riter.ri_idx = 0;
 
-        do
-            rop = readOnePacket(&rctx.rc_riter);
-        while (ROP_OK == rop);
+        rop = readPackets(&rctx.rc_riter);
 
         LS_DBG_L(this, "%s: read %u packet%.*s", __func__,
             rctx.rc_riter.ri_idx, rctx.rc_riter.ri_idx != 1, "s");
@@ -1364,6 +2093,13 @@ int UdpListener::onRead()
                 start.tv_usec + MAX_USEC_PER_LOOP <= end.tv_usec + 1000000) ||
             (start.tv_sec <  end.tv_sec - 1))
         {
+#if RECVMMSG_SUPPORTED
+            /* These are no longer in the socket: no POLLIN would come
+             * for them.
+             */
+            if (hasPendingGroSegments())
+                continue;
+#endif
             LS_DBG_M(this, "%s: take a breather reading packets "
                 "after exceeding timer", __func__);
             break;
@@ -1373,9 +2109,18 @@ int UdpListener::onRead()
 
     finishReading(&rctx);
 
-    LS_DBG_L(this, "%s: done; in total, read %u packet%.*s in %u batch%.*s", 
+    n_syscalls = rctx.rc_riter.ri_syscalls;
+    m_pPacketsIn->n_total_packets += n_packets;
+    m_pPacketsIn->n_total_syscalls += n_syscalls;
+    LS_DBG_L(this, "%s: done; in total, read %u packet%.*s in %u batch%.*s "
+             "and %u syscall%.*s, %.2f packets/syscall (%.2f since start)",
              __func__, n_packets, n_packets != 1,         "s",
-                     n_batches, (n_batches != 1) << 1, "es");
+                     n_batches, (n_batches != 1) << 1, "es",
+                     n_syscalls, n_syscalls != 1,         "s",
+             n_syscalls ? (double) n_packets / n_syscalls : 0.0,
+             m_pPacketsIn->n_total_syscalls ?
+                (double) m_pPacketsIn->n_total_packets
+                            / m_pPacketsIn->n_total_syscalls : 0.0);
 
     return 0;
 }
@@ -1433,6 +2178,15 @@ int UdpListener::initPacketsIn(void)
     }
 
     m_pPacketsIn->n_alloc     = n_alloc;
+    m_pPacketsIn->n_total_packets  = 0;
+    m_pPacketsIn->n_total_syscalls = 0;
+#if RECVMMSG_SUPPORTED
+    m_pPacketsIn->recv_mode = RM_ONE;
+    m_pPacketsIn->mmsgs     = NULL;
+    m_pPacketsIn->mmsg_vecs = NULL;
+    m_pPacketsIn->mmsg_ctl  = NULL;
+    m_pPacketsIn->gro       = NULL;
+#endif
 #ifndef _NOT_USE_SHM_
     m_pPacketsIn->n_avail = 0;
     m_pPacketsIn->cids        = (lsquic_cid_t  *) calloc(n_alloc, sizeof(m_pPacketsIn->cids[0]));
@@ -1464,6 +2218,9 @@ int UdpListener::initPacketsIn(void)
                                                     )
     {
         LS_INFO(this, "%s: allocated %u packets", __func__, n_alloc);
+#if RECVMMSG_SUPPORTED
+        initRecvMode();
+#endif
         return 0;
     }
     else
@@ -1477,6 +2234,12 @@ void UdpListener::cleanupPacketsIn(void)
 #ifndef _NOT_USE_SHM_
         free(m_pPacketsIn->cids);
         free(m_pPacketsIn->packet_bufs);
+#if RECVMMSG_SUPPORTED
+        free(m_pPacketsIn->mmsgs);
+        free(m_pPacketsIn->mmsg_vecs);
+        free(m_pPacketsIn->mmsg_ctl);
+        free(m_pPacketsIn->gro);
+#endif
 #else
         free(m_pPacketsIn->packet_data);
         free(m_pPacketsIn->ctlmsg_data);
@@ -1504,6 +2267,9 @@ UdpListener::~UdpListener()
 //         releaseSomePacketsToSHM();
 // #endif
     cleanupPacketsIn();
+    releaseReusePortSock();
+    if (m_pCidSteer)
+        delete m_pCidSteer;
 }
 
 
@@ -9,6 +9,7 @@
 #include <quic/pbset.h>
 #include <quic/quicshm.h>   /* For _NOT_USE_SHM_ definition */
 
+class CidSteer;
 class QuicEngine;
 class VHostMap;
 class GHash;
@@ -19,8 +20,20 @@ struct read_iter;
 struct quicshm_packet_buf;
 enum rop { ROP_OK, ROP_NOROOM, ROP_ERROR, };    /* ROP: Read One Packet */
 
+#ifdef RUN_TEST
+namespace SuiteUdpListener {
+    class TestGsoRunLength;
+    class TestGroSegments;
+};
+#endif
+
 class UdpListener : public EventReactor, public LogSession
 {
+#ifdef RUN_TEST
+    friend class SuiteUdpListener::TestGsoRunLength;
+    friend class SuiteUdpListener::TestGroSegments;
+#endif
+
 public:
     UdpListener()
         : EventReactor(-1)
@@ -28,6 +41,13 @@ public:
         , m_pTcpPeer(NULL)
         , m_pVHostMap(NULL)
         , m_id(-1)
+        , m_iGso(0)
+        , m_nSendMsgs(0)
+        , m_nSendPackets(0)
+        , m_iReusePortFd(-1)
+        , m_iReusePortOwner(0)
+        , m_iWorker(-1)
+        , m_pCidSteer(NULL)
         , m_pPacketsIn(NULL)
     {}
 
@@ -37,6 +57,13 @@ public:
         , m_pTcpPeer(pTcpPeer)
         , m_pVHostMap(pMap)
         , m_id(-1)
+        , m_iGso(0)
+        , m_nSendMsgs(0)
+        , m_nSendPackets(0)
+        , m_iReusePortFd(-1)
+        , m_iReusePortOwner(0)
+        , m_iWorker(-1)
+        , m_pCidSteer(NULL)
         , m_pPacketsIn(NULL)
     {}
         
@@ -45,6 +72,12 @@ public:
     int setAddr(const char *pAddr);
 
     int start();
+
+    int setupReusePort(int iWorkers, int iProcNo);
+    void releaseReusePortSock();
+    void useReusePortSock(int iProcNo);
+    void onWorkerExit(int iProcNo);
+    void steerCid(const lsquic_cid_t *pCid);
     
     ssize_t sendPacket(struct iovec *, size_t iovlen, const struct sockaddr *,
                                         const struct sockaddr *, int ecn);
@@ -57,6 +90,7 @@ public:
     int onRead();
     
     static void onMyEvent(int signo, void *param);
+    static void setGso(int enable)      {   s_iGso = enable;    }
     
     QuicEngine *getEngine() { return m_pEngine; }
 
@@ -85,6 +119,10 @@ private:
     int feedOwnedPacketToEngine(CidInfo *, unsigned);
     int feedOwnedPacketToEngine(UdpListener *,
                                             const struct quicshm_packet_buf *);
+    void initRecvMode();
+    enum rop readPacketBatch(struct read_iter *);
+    enum rop readGroBatch(struct read_iter *);
+    bool hasPendingGroSegments() const;
 #endif
 
 private:
@@ -93,15 +131,35 @@ private:
     VHostMap       *m_pVHostMap;
     GSockAddr       m_addr;
     int             m_id;
+    int             m_iGso;
+    uint64_t        m_nSendMsgs;
+    uint64_t        m_nSendPackets;
+
+    //SO_REUSEPORT socket reserved for the worker being forked, the first
+    //worker forked, m_iReusePortOwner, uses getfd().
+    int             m_iReusePortFd;
+    int             m_iReusePortOwner;
+    int             m_iWorker;
+    CidSteer       *m_pCidSteer;
 
     static int      s_rtsigNo;
+    static int      s_iGso;
 
     struct packets_in
                    *m_pPacketsIn;
+    int initSockOpts(int fd);
+    int newReusePortSock();
     int initPacketsIn();
     void cleanupPacketsIn();
 
     enum rop readOnePacket(struct read_iter *);
+    enum rop readPackets(struct read_iter *);
+    unsigned sendWithoutGso(const struct lsquic_out_spec *spec, unsigned n);
+    static unsigned gsoRunLength(const struct lsquic_out_spec *spec,
+                                 const struct lsquic_out_spec *end,
+                                 unsigned max_iov, size_t *seg_size);
+    static unsigned groNextSegment(unsigned len, unsigned seg_size,
+                                   unsigned *off);
     void startReading(struct read_ctx *);
     void processPacketsInBatch(struct read_ctx *);
     void finishReading(struct read_ctx *);
@@ -42,6 +42,25 @@ struct LsHashLruInfo_s
 };
 
 
+// Shard info, kept at the front of x_reserved; zero means not sharded.
+typedef struct
+{
+    int32_t         x_iSeq;         // odd while a writer holds the lock
+    uint16_t        x_iShards;
+    uint16_t        x_unused;
+    LsShmOffset_t   x_iShardTbl;    // array of shard table offsets
+} LsShmHShardInfo;
+
+
+// Incremental rehash state, follows the shard info in x_reserved.
+typedef struct
+{
+    LsShmSize_t     x_iMigrateIdx;  // next bucket of the old index to move
+    uint32_t        x_iIncremental; // zero if left over by a full rehash
+    LsShmSize_t     x_iZeroed;      // bytes of the new index cleared
+} LsShmHRehashInfo;
+
+
 static int s_tidOffset[2] = { 
     sizeof(LsShmTidInfo), 
     sizeof(LsShmTidInfo) + sizeof(LsHashLruInfo_s)   
@@ -75,6 +94,12 @@ typedef struct ls_shmhtable_s
     LsShmTidInfo    *getTidInfo()
     {   return (LsShmTidInfo *)&x_reserved[sizeof(x_reserved) 
                           - s_tidOffset[x_iMode & LSSHM_FLAG_LRU]]; }
+
+    LsShmHShardInfo *getShardInfo()
+    {   return (LsShmHShardInfo *)x_reserved;   }
+
+    LsShmHRehashInfo *getRehashInfo()
+    {   return (LsShmHRehashInfo *)&x_reserved[sizeof(LsShmHShardInfo)];  }
 } LsShmHTable;
 
 
@@ -96,6 +121,11 @@ const size_t s_bitsPerChar =
 // minimum element count for bloom bitmap (approx 1Mb table size)
 #define MINSZ_FOR_BITMAP    (1024*1024/sizeof(LsShmHIterOff))
 
+// buckets of the old index moved per operation during a rehash
+#define LSSHM_REHASH_STEP   16
+// bytes of the new index cleared per bucket of a step
+#define LSSHM_REHASH_ZERO_UNIT  4096
+
 const size_t s_bitsPerLsShmHIdx =
     s_bitsPerChar * sizeof(LsShmHIterOff);
 
@@ -272,14 +302,16 @@ inline uint8_t *LsShmHash::getBitMap(uint32_t idx) const
 
 void LsShmHash::lockChkRehash()
 {
-    if ((lock() < 0) && (getHTable()->x_iHIdx != getHTable()->x_iHIdxNew))
+    lock();
+    if (!m_iAutoLock && isRehashing())
         rehash();
 }
 
 
 void LsShmHash::autoLockChkRehash()
 {
-    if ((autoLock() < 0) && (getHTable()->x_iHIdx != getHTable()->x_iHIdxNew))
+    autoLock();
+    if (isRehashing())
         rehash();
 }
 
@@ -335,13 +367,16 @@ void LsShmHash::release2(LsShmOffset_t offset, LsShmSize_t size)
 
 bool LsShmHash::empty() const
 {
-    return getHTable()->x_iSize == 0;
+    return size() == 0;
 }
 
 
 LsShmSize_t LsShmHash::size() const
 {
-    return getHTable()->x_iSize;
+    LsShmSize_t size = getHTable()->x_iSize;
+    for (int i = 0; i < m_iShards; ++i)
+        size += m_pShards[i]->size();
+    return size;
 }
 
 
@@ -363,6 +398,71 @@ LsShmSize_t LsShmHash::capacity() const
 }
 
 
+int LsShmHash::isRehashing() const
+{
+    return getHTable()->x_iHIdx != getHTable()->x_iHIdxNew;
+}
+
+
+LsShmHIterOff *LsShmHash::getBucket(LsShmHKey key, int *pBitIdx) const
+{
+    LsShmHTable *pTable = getHTable();
+    uint32_t idx = getIndex(key, pTable->x_iCapacity);
+    if (pTable->x_iHIdx == pTable->x_iHIdxNew)
+    {
+        *pBitIdx = idx;
+        return getHidx(idx);
+    }
+    if (idx >= pTable->getRehashInfo()->x_iMigrateIdx)
+    {
+        *pBitIdx = -1;
+        return getHidx(idx);
+    }
+    idx = getIndex(key, pTable->x_iCapacityNew);
+    *pBitIdx = idx;
+    return (LsShmHIterOff *)m_pPool->offset2ptr(pTable->x_iHIdxNew
+                                                + idx * sizeof(LsShmHIterOff));
+}
+
+
+uint32_t LsShmHash::bucketCount() const
+{
+    LsShmHTable *pTable = getHTable();
+    if (pTable->x_iHIdx == pTable->x_iHIdxNew)
+        return pTable->x_iCapacity;
+    return pTable->x_iCapacity - pTable->getRehashInfo()->x_iMigrateIdx
+           + pTable->x_iCapacityNew;
+}
+
+
+LsShmHIterOff *LsShmHash::bucketAt(uint32_t pos) const
+{
+    LsShmHTable *pTable = getHTable();
+    if (pTable->x_iHIdx == pTable->x_iHIdxNew)
+        return getHidx(pos);
+    uint32_t migrated = pTable->getRehashInfo()->x_iMigrateIdx;
+    if (pos < pTable->x_iCapacity - migrated)
+        return getHidx(pos + migrated);
+    pos -= pTable->x_iCapacity - migrated;
+    return (LsShmHIterOff *)m_pPool->offset2ptr(pTable->x_iHIdxNew
+                                                + pos * sizeof(LsShmHIterOff));
+}
+
+
+uint32_t LsShmHash::bucketPos(LsShmHKey key) const
+{
+    LsShmHTable *pTable = getHTable();
+    uint32_t idx = getIndex(key, pTable->x_iCapacity);
+    if (pTable->x_iHIdx == pTable->x_iHIdxNew)
+        return idx;
+    uint32_t migrated = pTable->getRehashInfo()->x_iMigrateIdx;
+    if (idx >= migrated)
+        return idx - migrated;
+    return pTable->x_iCapacity - migrated
+           + getIndex(key, pTable->x_iCapacityNew);
+}
+
+
 inline int LsShmHash::getBitMapEnt(uint32_t indx)
 {
     uint8_t *pBitMap = getBitMap(indx);
@@ -423,6 +523,9 @@ LsShmHash::LsShmHash(LsShmPool *pool, const char *name,
     , m_iFlags(flags)
     , m_pLruAddon(NULL)
     , m_pObservers(NULL)
+    , m_pSeq(NULL)
+    , m_pShards(NULL)
+    , m_iShards(0)
     , m_pTidMgr(NULL)
 {
     obj.m_pName = strdup(name);
@@ -544,8 +647,11 @@ int LsShmHash::init(LsShmOffset_t offset)
                 + ((char *)pTable->getTidInfo() - (char *)pTable);
         m_pTidMgr->init(this, tidMgrOff, 0);
     }
+    m_pSeq = &pTable->getShardInfo()->x_iSeq;
     m_iRef = 1;
     m_status = LSSHM_READY;
+    if ((pTable->getShardInfo()->x_iShards != 0) && (attachShards() != LS_OK))
+        return LS_FAIL;
     return LS_OK;
 }
 
@@ -567,6 +673,7 @@ LsShmHash::~LsShmHash()
     }
     if (m_pTidMgr != NULL)
         delete m_pTidMgr;
+    releaseShards();
 }
 
 
@@ -687,109 +794,183 @@ void LsShmHash::destroy()
         // all elements
         clear();
 
+        if (m_pShards != NULL)
+        {
+            LsShmHShardInfo *pInfo = getHTable()->getShardInfo();
+            for (int i = 0; i < m_iShards; ++i)
+                m_pShards[i]->releaseHTableShm();
+            m_pPool->release2(pInfo->x_iShardTbl,
+                              sizeof(LsShmOffset_t) * pInfo->x_iShards);
+            releaseShards();
+        }
         releaseHTableShm();
     }
 }
 
 
+//
+//  Growing the index is spread over the operations on the table: rehash()
+//  allocates the larger index and every later call moves at most
+//  LSSHM_REHASH_STEP buckets, so the lock is never held for a pass over
+//  the whole table.
+//
 int LsShmHash::rehash()
 {
+    LsShmHTable *pTable = getHTable();
+    if (pTable->x_iHIdx == pTable->x_iHIdxNew)
+        return startRehash();
+
+    recoverRehashIter();
+    LsShmHRehashInfo *pInfo = pTable->getRehashInfo();
+    if (pInfo->x_iIncremental == 0)
+    {
+        // interrupted full rehash, moved entries are only in the new index
+        pInfo->x_iZeroed = pTable->x_iBitMapSz
+                           + sz2TableSz(pTable->x_iCapacityNew);
+        finishRehash();
+        return 0;
+    }
+    return rehashStep(LSSHM_REHASH_STEP);
+}
+
+
+int LsShmHash::startRehash()
+{
+    int remapped;
     LsShmSize_t oldSize = capacity();
-    LsShmSize_t newSize;
-    LsShmOffset_t newIdxOff;
-    LsShmOffset_t newBitOff;
-    LsShmHIterOff *pIdxOld;
-    LsShmHIterOff *pIdxNew;
-    LsShmHIterOff *opIdx;
-    LsShmHIterOff *npIdx;
-    iterator iter;
-    iteroffset iterOff;
-    iteroffset iterNextOff;
-    int szTable;
-    int szBitMap;
-    uint count = 0;
+    LsShmSize_t newSize = s_primeList[findRange(oldSize) + growFactor()];
 #ifdef DEBUG_RUN
     SHM_NOTICE("LsShmHash::rehash %6d %X size %d cap %d NEW %d",
                getpid(), m_pPool->getShmMap(),
                size(),
                oldSize,
-               s_primeList[findRange(oldSize) + growFactor()]
+               newSize
               );
 #endif
+    int szTable = sz2TableSz(newSize);
+    int szBitMap = sz2BitMapSz(newSize);
+    LsShmOffset_t newBitOff;
+    if ((newBitOff = alloc2(szTable + szBitMap, remapped)) == 0)
+        return LS_FAIL;
+    // the new index is cleared by the following steps, nothing is
+    // moved into it before that is done
+    LsShmHTable *pTable = getHTable();
+    LsShmHRehashInfo *pInfo = pTable->getRehashInfo();
+    pInfo->x_iMigrateIdx = 0;
+    pInfo->x_iIncremental = 1;
+    pInfo->x_iZeroed = 0;
+    pTable->x_iWorkIterOff = 0;
+    pTable->x_iBitMap = newBitOff;
+    pTable->x_iBitMapSz = szBitMap;
+    pTable->x_iCapacityNew = newSize;
+    pTable->x_iHIdxNew = newBitOff + szBitMap;
+    return rehashStep(LSSHM_REHASH_STEP);
+}
+
+
+//
+//  Completes the move of an element interrupted by a dead lock holder.
+//
+void LsShmHash::recoverRehashIter()
+{
     LsShmHTable *pTable = getHTable();
-    pIdxOld = (LsShmHIterOff *)m_pPool->offset2ptr(pTable->x_iHIdx);
-    if (pTable->x_iHIdx != pTable->x_iHIdxNew)          // rehash in progress
+    iteroffset iterOff;
+    if ((iterOff.m_iOffset = pTable->x_iWorkIterOff) == 0)
+        return;
+    iterator iter = offset2iterator(iterOff);
+    uint32_t hashIndx = getIndex(iter->x_hkey, pTable->x_iCapacityNew);
+    LsShmHIterOff *pIdxOld = getHidx(0);
+    LsShmHIterOff *npIdx = (LsShmHIterOff *)offset2ptr(pTable->x_iHIdxNew)
+                           + hashIndx;
+    if (npIdx->m_iOffset != iterOff.m_iOffset)            // not there yet
+    {
+        LsShmHIterOff *opIdx = pIdxOld
+                               + getIndex(iter->x_hkey, pTable->x_iCapacity);
+        if (opIdx->m_iOffset == iterOff.m_iOffset)
+            opIdx->m_iOffset = iter->x_iNext.m_iOffset;   // remove from old
+        iter->x_iNext.m_iOffset = npIdx->m_iOffset;
+        npIdx->m_iOffset = iterOff.m_iOffset;
+        setBitMapEnt(hashIndx);
+    }
+    pTable->x_iWorkIterOff = 0;
+}
+
+
+int LsShmHash::rehashStep(uint32_t maxBuckets)
+{
+    LsShmHTable *pTable = getHTable();
+    LsShmHRehashInfo *pInfo = pTable->getRehashInfo();
+    LsShmSize_t oldSize = pTable->x_iCapacity;
+    LsShmSize_t newSize = pTable->x_iCapacityNew;
+    LsShmHIterOff *pIdxOld = getHidx(0);
+    LsShmHIterOff *pIdxNew = (LsShmHIterOff *)offset2ptr(pTable->x_iHIdxNew);
+    LsShmHIterOff *opIdx;
+    LsShmHIterOff *npIdx;
+    iterator iter;
+    iteroffset iterOff;
+    uint count = 0;
+
+    LsShmSize_t total = pTable->x_iBitMapSz + sz2TableSz(newSize);
+    if (pInfo->x_iZeroed < total)
+    {
+        LsShmSize_t len = total - pInfo->x_iZeroed;
+        if (len / LSSHM_REHASH_ZERO_UNIT >= maxBuckets)
+            len = maxBuckets * LSSHM_REHASH_ZERO_UNIT;
+        ::memset(offset2ptr(pTable->x_iBitMap + pInfo->x_iZeroed), 0, len);
+        pInfo->x_iZeroed += len;
+        return 0;
+    }
+
+    while ((pInfo->x_iMigrateIdx < oldSize) && (maxBuckets-- > 0))
     {
-        newSize = pTable->x_iCapacityNew;
-        newIdxOff = pTable->x_iHIdxNew;
-        pIdxNew = (LsShmHIterOff *)m_pPool->offset2ptr(newIdxOff);
-        if ((iterOff.m_iOffset = pTable->x_iWorkIterOff) != 0)    // iter in progress
+        opIdx = pIdxOld + pInfo->x_iMigrateIdx;
+        while (opIdx->m_iOffset != 0)
         {
+            uint32_t hashIndx;
+            iterOff = *opIdx;
             iter = offset2iterator(iterOff);
-            npIdx = pIdxNew + getIndex(iter->x_hkey, newSize);
-            if (npIdx->m_iOffset != iterOff.m_iOffset)            // not there yet
+            hashIndx = getIndex(iter->x_hkey, newSize);
+            npIdx = pIdxNew + hashIndx;
+            pTable->x_iWorkIterOff = iterOff.m_iOffset;
+            opIdx->m_iOffset = iter->x_iNext.m_iOffset;
+            iter->x_iNext.m_iOffset = npIdx->m_iOffset;
+            npIdx->m_iOffset = iterOff.m_iOffset;
+            setBitMapEnt(hashIndx);
+            if (++count > pTable->x_iSize)
             {
-                opIdx = pIdxOld + getIndex(iter->x_hkey, oldSize);
-                if (opIdx->m_iOffset == iterOff.m_iOffset)
-                    opIdx->m_iOffset = iter->x_iNext.m_iOffset;   // remove from old
-                iter->x_iNext.m_iOffset = npIdx->m_iOffset;
-                npIdx->m_iOffset = iterOff.m_iOffset;
+                fprintf(stderr, "LsShmHash::rehash() is in a infinity loop, likely due to SHM corruption. remove corrupted file.");
+                getPool()->getShm()->tryRecoverCorruption();
+                abort();
             }
-
-        }
-    }
-    else
-    {
-        int remapped;
-        newSize = s_primeList[findRange(oldSize) + growFactor()];
-        szTable = sz2TableSz(newSize);
-        szBitMap = sz2BitMapSz(newSize);
-        if ((newBitOff = alloc2(szTable + szBitMap, remapped)) == 0)
-            return LS_FAIL;
-        uint8_t *ptr = (uint8_t *)offset2ptr(newBitOff);
-        ::memset(ptr, 0, szTable + szBitMap);
-        newIdxOff = newBitOff + szBitMap;
-        pIdxNew = (LsShmHIterOff *)(ptr + szBitMap);
-        pTable = getHTable();
-        pTable->x_iBitMap = newBitOff;
-        pTable->x_iBitMapSz = szBitMap;
-        pTable->x_iCapacityNew = newSize;
-        pTable->x_iHIdxNew = newIdxOff;
-        iterOff = begin();
-    }
-
-    pIdxOld = (LsShmHIterOff *)m_pPool->offset2ptr(pTable->x_iHIdx);
-    while(iterOff.m_iOffset != 0)
-    {
-        uint32_t hashIndx;
-        iter = offset2iterator(iterOff);
-        iterNextOff = next(iterOff);
-        hashIndx = getIndex(iter->x_hkey, newSize);
-        npIdx = pIdxNew + hashIndx;
-        setBitMapEnt(hashIndx);
-        pTable->x_iWorkIterOff = iterOff.m_iOffset;
-        (pIdxOld + getIndex(iter->x_hkey, oldSize))->m_iOffset = iter->x_iNext.m_iOffset;
-        iter->x_iNext.m_iOffset = npIdx->m_iOffset;
-        npIdx->m_iOffset = iterOff.m_iOffset;
-        iterOff = iterNextOff;
-        if (++count > oldSize + oldSize / 2)
-        {
-            fprintf(stderr, "LsShmHash::rehash() is in a infinity loop, likely due to SHM corruption. remove corrupted file.");
-            getPool()->getShm()->tryRecoverCorruption();
-            abort();
         }
+        ++pInfo->x_iMigrateIdx;
     }
     pTable->x_iWorkIterOff = 0;
+    if (pInfo->x_iMigrateIdx < oldSize)
+        return 0;
 
-    szTable = sz2TableSz(oldSize);
-    szBitMap = sz2BitMapSz(oldSize);
+    int szTable = sz2TableSz(oldSize);
+    int szBitMap = sz2BitMapSz(oldSize);
     release2(pTable->x_iHIdx - szBitMap, szTable + szBitMap);
     pTable->x_iCapacity = newSize;
-    pTable->x_iHIdx = newIdxOff;
+    pTable->x_iHIdx = pTable->x_iHIdxNew;
+    pInfo->x_iMigrateIdx = 0;
+    pInfo->x_iIncremental = 0;
+    pInfo->x_iZeroed = 0;
     return 0;
 }
 
 
+void LsShmHash::finishRehash()
+{
+    if (!isRehashing())
+        return;
+    recoverRehashIter();
+    while (isRehashing())
+        rehashStep(capacity());
+}
+
+
 int LsShmHash::release_hash_elem(LsShmHash::iteroffset iterOff,
                                  void *pUData)
 {
@@ -802,6 +983,13 @@ int LsShmHash::release_hash_elem(LsShmHash::iteroffset iterOff,
 
 void LsShmHash::clear()
 {
+    for (int i = 0; i < m_iShards; ++i)
+    {
+        m_pShards[i]->lock();
+        m_pShards[i]->clear();
+        m_pShards[i]->unlock();
+    }
+    finishRehash();
     LsShmHTable *pTable = getHTable();
     int n = for_each2(begin(), end(), release_hash_elem, this);
     assert(n == (int)size());
@@ -925,8 +1113,9 @@ uint64_t LsShmHash::doUpdateTid(iteroffset iterOff)
 void LsShmHash::remove(iteroffset iterOff, iterator iter)
 {
 
-    uint32_t hashIndx = getIndex(iter->x_hkey, capacity());
-    LsShmHIterOff *pIdx = getHidx(hashIndx);
+    LsShmHKey key = iter->x_hkey;
+    int hashIndx;
+    LsShmHIterOff *pIdx = getBucket(key, &hashIndx);
     LsShmOffset_t offset = pIdx->m_iOffset;
     LsShmHElem *pElem;
     LsShmOffset_t next = iter->x_iNext.m_iOffset;     // in case of remap in tid list
@@ -955,11 +1144,11 @@ void LsShmHash::remove(iteroffset iterOff, iterator iter)
     if (m_pTidMgr != NULL)
     {
         m_pTidMgr->eraseIterCb(iter);
-        pIdx = getHidx(hashIndx);
+        pIdx = getBucket(key, &hashIndx);
     }
     if (offset == iterOff.m_iOffset)
     {
-        if ((pIdx->m_iOffset = next) == 0) // last one
+        if (((pIdx->m_iOffset = next) == 0) && (hashIndx >= 0)) // last one
             clrBitMapEnt(hashIndx);
     }
     else
@@ -1019,10 +1208,10 @@ LsShmHash::iteroffset LsShmHash::find2(LsShmHKey key,
 {
     assert(m_pPool->getShm()->isLocked(m_pShmLock));
 
-    uint32_t hashIndx = getIndex(key, capacity());
-    if (getBitMapEnt(hashIndx) == 0)     // quick check
+    int hashIndx;
+    LsShmHIterOff *pIdx = getBucket(key, &hashIndx);
+    if ((hashIndx >= 0) && (getBitMapEnt(hashIndx) == 0))     // quick check
         return end();
-    LsShmHIterOff *pIdx = getHidx(hashIndx);
 
 #ifdef DEBUG_RUN
     SHM_NOTICE("LsShmHash::find %6d %X size %d cap %d <%p> %d",
@@ -1118,11 +1307,12 @@ LsShmHash::iteroffset LsShmHash::insertCopy2(LsShmHKey key,
 
 void LsShmHash::insertAlloced(iteroffset iterOff, iterator iter)
 {
-    uint32_t hashIndx = getIndex(iter->x_hkey, capacity());
-    LsShmHIterOff *pIdx = getHidx(hashIndx);
+    int hashIndx;
+    LsShmHIterOff *pIdx = getBucket(iter->x_hkey, &hashIndx);
     iter->x_iNext.m_iOffset = pIdx->m_iOffset;
     pIdx->m_iOffset = iterOff.m_iOffset;
-    setBitMapEnt(hashIndx);
+    if (hashIndx >= 0)
+        setBitMapEnt(hashIndx);
 
 #ifdef DEBUG_RUN
     SHM_NOTICE("LsShmHash::insert %6d %X size %d cap %d <%p> %d",
@@ -1161,8 +1351,9 @@ void LsShmHash::replace(iteroffset oldIterOff, iterator oldIter,
         return;
 
     LsShmSize_t size = oldIter->x_iLen;
-    uint32_t hashIndx = getIndex(oldIter->x_hkey, capacity());
-    LsShmHIterOff *pIdx = getHidx(hashIndx);
+    LsShmHKey key = oldIter->x_hkey;
+    int hashIndx;
+    LsShmHIterOff *pIdx = getBucket(key, &hashIndx);
     LsShmOffset_t offset = pIdx->m_iOffset;
     LsShmHElem *pElem;
     LsShmOffset_t next = oldIter->x_iNext.m_iOffset;     // in case of remap in tid list
@@ -1191,7 +1382,7 @@ void LsShmHash::replace(iteroffset oldIterOff, iterator oldIter,
     if (m_pTidMgr != NULL)
     {
         m_pTidMgr->eraseIterCb(oldIter);
-        pIdx = getHidx(hashIndx);
+        pIdx = getBucket(key, &hashIndx);
     }
 
     if (offset == oldIterOff.m_iOffset)
@@ -1275,11 +1466,12 @@ LsShmHash::iteroffset LsShmHash::iterGrowValue(iteroffset iterOff,
         pNew = offset2iterator(offset);
     }
 
-    uint32_t hashIndx = getIndex(pNew->x_hkey, capacity());
-    LsShmHIterOff *pIdx = getHidx(hashIndx);
+    int hashIndx;
+    LsShmHIterOff *pIdx = getBucket(pNew->x_hkey, &hashIndx);
     pNew->x_iNext.m_iOffset = pIdx->m_iOffset;
     pIdx->m_iOffset = offset.m_iOffset;
-    setBitMapEnt(hashIndx);
+    if (hashIndx >= 0)
+        setBitMapEnt(hashIndx);
 
     incrTableSize();
     return offset;
@@ -1293,10 +1485,10 @@ LsShmHash::iteroffset LsShmHash::findNum(LsShmHash *pThis, ls_strpair_t *pParms)
 {
     LsShmHash::iteroffset offset = {0};
     LsShmHKey key = (LsShmHKey)(long)ls_str_buf(&pParms->key);
-    uint32_t hashIndx = pThis->getIndex(key, pThis->capacity());
-    if (pThis->getBitMapEnt(hashIndx) == 0)     // quick check
+    int hashIndx;
+    LsShmHIterOff *pIdx = pThis->getBucket(key, &hashIndx);
+    if ((hashIndx >= 0) && (pThis->getBitMapEnt(hashIndx) == 0))     // quick check
         return offset;
-    LsShmHIterOff *pIdx = pThis->getHidx(hashIndx);
     offset = *pIdx;
     LsShmHElem *pElem;
 
@@ -1455,15 +1647,15 @@ LsShmHash::iteroffset LsShmHash::begin()
 {
     assert(m_pPool->getShm()->isLocked(m_pShmLock));
 
-    if (size() == 0)
+    if (getHTable()->x_iSize == 0)
         return end();
 
     LsShmHIterOff *p;
-    int i = 0;
-    int n = capacity();
+    uint32_t i = 0;
+    uint32_t n = bucketCount();
     while (i < n)
     {
-        p = getHidx(i);
+        p = bucketAt(i);
         if (p->m_iOffset != 0)
             return *p;
         ++i;
@@ -1490,11 +1682,11 @@ LsShmHash::iteroffset LsShmHash::next(iteroffset iterOff)
             return iter->x_iNext;
     }
     LsShmHIterOff *p;
-    int i = getIndex(iter->x_hkey, capacity()) + 1;
-    int n = capacity();
+    uint32_t i = bucketPos(iter->x_hkey) + 1;
+    uint32_t n = bucketCount();
     while (i < n)
     {
-        p = getHidx(i);
+        p = bucketAt(i);
         if (p->m_iOffset != 0)
         {
 #ifdef DEBUG_RUN
@@ -1579,6 +1771,20 @@ int LsShmHash::trim(time_t tmCutoff, LsShmHash::TrimCb func, void *arg)
 {
     if ((m_iFlags & LSSHM_FLAG_LRU) == 0)
         return LS_FAIL;
+    if (m_pShards != NULL)
+    {
+        int del = 0;
+        for (int i = 0; i < m_iShards; ++i)
+        {
+            m_pShards[i]->lock();
+            int ret = m_pShards[i]->trim(tmCutoff, func, arg);
+            m_pShards[i]->unlock();
+            if (ret < 0)
+                return ret;
+            del += ret;
+        }
+        return del;
+    }
     int del = 0;
     LsShmHElem *pElem;
     iteroffset next;
@@ -1627,6 +1833,22 @@ int LsShmHash::trimsize(int need, LsShmHash::TrimCb func, void *arg)
 {
     if ((m_iFlags & LSSHM_FLAG_LRU) == 0)
         return LS_FAIL;
+    if (m_pShards != NULL)
+    {
+        // each shard has its own LRU, take an even share from each
+        int del = 0;
+        int share = need / m_iShards + 1;
+        for (int i = 0; i < m_iShards; ++i)
+        {
+            m_pShards[i]->lock();
+            int ret = m_pShards[i]->trimsize(share, func, arg);
+            m_pShards[i]->unlock();
+            if (ret < 0)
+                return ret;
+            del += ret;
+        }
+        return del;
+    }
     int del = 0;
     LsShmHElem *pElem;
     iteroffset next;
@@ -1661,6 +1883,20 @@ int LsShmHash::trimByCb(int maxCnt, LsShmHash::TrimCb func, void *arg)
 {
     if ((m_iFlags & LSSHM_FLAG_LRU) == 0)
         return LS_FAIL;
+    if (m_pShards != NULL)
+    {
+        int del = 0;
+        for (int i = 0; i < m_iShards; ++i)
+        {
+            m_pShards[i]->lock();
+            int ret = m_pShards[i]->trimByCb(maxCnt, func, arg);
+            m_pShards[i]->unlock();
+            if (ret < 0)
+                return ret;
+            del += ret;
+        }
+        return del;
+    }
     int del = 0;
     LsShmHElem *pElem;
     iteroffset next;
@@ -1705,6 +1941,8 @@ int LsShmHash::touchLru(iteroffset iterOff)
         return 0;
     if (iterOff.m_iOffset == 0)
         return 0;
+    if (m_pShards != NULL)
+        return shardOfIter(iterOff)->touchLru(iterOff);
     autoLockChkRehash();
     lruMarkNewest(offset2iterator(iterOff), iterOff);
     autoUnlock();
@@ -1789,6 +2027,8 @@ int LsShmHash::lruSetNewestTime(iteroffset offset, time_t lasttime)
 {
     if (m_iFlags & LSSHM_FLAG_LRU)
     {
+        if (m_pShards != NULL)
+            return shardOfIter(offset)->lruSetNewestTime(offset, lasttime);
         autoLockChkRehash();
         LsShmLruLink *pLink = offset2iterator(offset)->getLruLinkPtr();
         if ((pLink->x_iLinkNext.m_iOffset != 0) || (lasttime > time((time_t *)NULL)))
@@ -1815,6 +2055,8 @@ int LsShmHash::linkMvTopTime(iteroffset offset, time_t lasttime)
     int ret = LS_OK;
     if (!(m_iFlags & LSSHM_FLAG_LRU))
         return ret;
+    if (m_pShards != NULL)
+        return shardOfIter(offset)->linkMvTopTime(offset, lasttime);
     autoLockChkRehash();
 
     assert(m_pPool->getShm()->isLocked(m_pShmLock));
@@ -2115,11 +2357,11 @@ int LsShmHash::stat(LsHashStat *pHashStat, for_each_fn2 fun, void *pData)
     autoLockChkRehash();
     // search each idx
     LsShmHIterOff *p;
-    int i = 0;
-    int n = capacity();
+    uint32_t i = 0;
+    uint32_t n = bucketCount();
     while (i < n)
     {
-        p = getHidx(i);
+        p = bucketAt(i);
         ++pHashStat->numIdx;
         if (p->m_iOffset != 0)
         {
@@ -2205,3 +2447,263 @@ int LsShmHash::move(iteroffset iterOff, LsShmHash *pSrcHash,
 
     return LS_OK;
 }
+
+
+#define LSSHM_FINDCOPY_RETRY    4
+#define LSSHM_FINDCOPY_MAXHOPS  1024
+
+int LsShmHash::setupShards(int nShards)
+{
+    if ((m_pShards != NULL) || (nShards <= 1))
+        return LS_OK;
+    if (nShards > LSSHM_MAX_SHARDS)
+        nShards = LSSHM_MAX_SHARDS;
+
+    int ret = LS_OK;
+    lockEx();
+    finishRehash();
+    if (getHTable()->getShardInfo()->x_iShards == 0)
+        ret = allocShards(nShards);
+    if (ret == LS_OK)
+        ret = attachShards();
+    if (ret == LS_OK)
+        migrateToShards();
+    unlockEx();
+    return ret;
+}
+
+
+int LsShmHash::allocShards(int nShards)
+{
+    int remapped;
+    LsShmOffset_t *pOffs;
+    LsShmOffset_t tblOff = m_pPool->alloc2(sizeof(LsShmOffset_t) * nShards,
+                                           remapped);
+    if (tblOff == 0)
+        return LS_FAIL;
+    int initSize = capacity() / nShards + 1;
+    for (int i = 0; i < nShards; ++i)
+    {
+        LsShmOffset_t offset = m_pPool->allocateNewHash(initSize, m_iMode,
+                                                        m_iFlags);
+        if (offset == 0)
+        {
+            m_pPool->release2(tblOff, sizeof(LsShmOffset_t) * nShards);
+            return LS_FAIL;
+        }
+        pOffs = (LsShmOffset_t *)m_pPool->offset2ptr(tblOff);
+        pOffs[i] = offset;
+    }
+    LsShmHShardInfo *pInfo = getHTable()->getShardInfo();
+    pInfo->x_iShardTbl = tblOff;
+    pInfo->x_iShards = nShards;
+    return LS_OK;
+}
+
+
+int LsShmHash::attachShards()
+{
+    LsShmHShardInfo *pInfo = getHTable()->getShardInfo();
+    int nShards = pInfo->x_iShards;
+    if (nShards > LSSHM_MAX_SHARDS)
+        return LS_FAIL;
+    LsShmHash **pShards = new LsShmHash *[nShards];
+    int nameLen = strlen(name()) + 8;
+    char *pName = (char *)malloc(nameLen);
+    if (pShards == NULL || pName == NULL)
+    {
+        delete[] pShards;
+        free(pName);
+        return LS_FAIL;
+    }
+    LsShmOffset_t *pOffs = (LsShmOffset_t *)m_pPool->offset2ptr(
+                               pInfo->x_iShardTbl);
+    int i;
+    for (i = 0; i < nShards; ++i)
+    {
+        snprintf(pName, nameLen, "%s#%d", name(), i);
+        // shards are owned by this object and not listed in the object base
+        pShards[i] = new LsShmHash(m_pPool, pName, m_hf, m_vc, m_iFlags);
+        if (pShards[i]->init(pOffs[i]) == LS_FAIL)
+        {
+            delete pShards[i];
+            break;
+        }
+        if (!m_iAutoLock)
+            pShards[i]->disableAutoLock();
+    }
+    free(pName);
+    if (i < nShards)
+    {
+        while (--i >= 0)
+            delete pShards[i];
+        delete[] pShards;
+        return LS_FAIL;
+    }
+    m_pShards = pShards;
+    m_iShards = nShards;
+    return LS_OK;
+}
+
+
+//
+//  Move the elements stored in the parent table before it was sharded.
+//  The parent lock is held, shard locks are taken in order.
+//
+void LsShmHash::migrateToShards()
+{
+    if (getHTable()->x_iSize == 0)
+        return;
+    int i;
+    for (i = 0; i < m_iShards; ++i)
+    {
+        m_pShards[i]->m_iAutoLock = 0;
+        m_pShards[i]->lockEx();
+    }
+    for (uint32_t idx = 0; idx < capacity(); ++idx)
+    {
+        iteroffset iterOff;
+        while ((iterOff = *getHidx(idx)).m_iOffset != 0)
+        {
+            if (move(iterOff, this, shardOfIter(iterOff)) != LS_OK)
+                break;
+        }
+    }
+    for (i = 0; i < m_iShards; ++i)
+    {
+        m_pShards[i]->unlockEx();
+        m_pShards[i]->m_iAutoLock = m_iAutoLock;
+    }
+}
+
+
+void LsShmHash::releaseShards()
+{
+    if (m_pShards == NULL)
+        return;
+    for (int i = 0; i < m_iShards; ++i)
+        delete m_pShards[i];
+    delete[] m_pShards;
+    m_pShards = NULL;
+    m_iShards = 0;
+}
+
+
+static inline int isReadable(LsShm *pShm, LsShmOffset_t offset,
+                             LsShmXSize_t len)
+{
+    return (offset >= pShm->xdataOffset())
+           && ((LsShmXSize_t)offset + len <= pShm->oldMaxSize());
+}
+
+
+//
+//  Walks the bucket without the lock. Every offset is checked against the
+//  local mapping before it is touched, a concurrent writer can only make
+//  the walk return garbage, which the sequence check in findCopy() drops.
+//  Returns -2 if the walk ran into an inconsistent state.
+//
+int LsShmHash::findCopyUnlocked(LsShmHKey key, const void *pKey, int keyLen,
+                                void *pBuf, int bufLen)
+{
+    LsShm *pShm = m_pPool->getShm();
+    LsShmHTable *pTable = getHTable();
+    LsShmSize_t cap = pTable->x_iCapacity;
+    LsShmOffset_t offIdx = pTable->x_iHIdx;
+    LsShmOffset_t offIdxNew = pTable->x_iHIdxNew;
+    if (cap == 0)
+        return LS_FAIL;
+    uint32_t idx = getIndex(key, cap);
+    if ((offIdxNew != offIdx)
+        && (idx < pTable->getRehashInfo()->x_iMigrateIdx))
+    {
+        // bucket already moved to the new index
+        if ((cap = pTable->x_iCapacityNew) == 0)
+            return -2;
+        offIdx = offIdxNew;
+        idx = getIndex(key, cap);
+    }
+    offIdx += idx * sizeof(LsShmHIterOff);
+    if (!isReadable(pShm, offIdx, sizeof(LsShmHIterOff)))
+        return -2;
+    LsShmOffset_t offset =
+        ((LsShmHIterOff *)pShm->offset2ptr(offIdx))->m_iOffset;
+    int hops = 0;
+    while (offset != 0)
+    {
+        if ((++hops > LSSHM_FINDCOPY_MAXHOPS)
+            || !isReadable(pShm, offset,
+                           sizeof(LsShmHElem) + sizeof(ls_vardata_t)))
+            return -2;
+        LsShmHElem *pElem = (LsShmHElem *)pShm->offset2ptr(offset);
+        LsShmXSize_t len = (LsShmXSize_t)pElem->x_iLen;
+        if ((len < sizeof(LsShmHElem) + sizeof(ls_vardata_t))
+            || !isReadable(pShm, offset, len))
+            return -2;
+        if (pElem->x_hkey == key)
+        {
+            int match;
+            if (m_hf == NULL)
+                match = (*(LsShmHKey *)pElem->getKey() == key);
+            else
+                match = (pElem->getKeyLen() == keyLen)
+                        && (sizeof(LsShmHElem) + sizeof(ls_vardata_t)
+                            + keyLen <= len)
+                        && ((*m_vc)(pKey, pElem->getKey(), keyLen) == 0);
+            if (match)
+            {
+                if ((LsShmXSize_t)pElem->x_iValOff + sizeof(LsShmHElem)
+                    + sizeof(ls_vardata_t) > len)
+                    return -2;
+                int valLen = pElem->getValLen();
+                if ((valLen < 0) || ((LsShmSize_t)valLen > pElem->realValLen()))
+                    return -2;
+                ::memcpy(pBuf, pElem->getVal(),
+                         (valLen < bufLen) ? valLen : bufLen);
+                return valLen;
+            }
+        }
+        offset = pElem->x_iNext.m_iOffset;
+    }
+    return LS_FAIL;
+}
+
+
+int LsShmHash::findCopy(const void *pKey, int keyLen, void *pBuf, int bufLen)
+{
+    LsShmHKey key = hashKey(pKey, keyLen);
+    LsShmHash *pHash = shardOfKey(key);
+    volatile int32_t *pSeq = pHash->m_pSeq;
+    int ret;
+
+    for (int i = 0; i < LSSHM_FINDCOPY_RETRY; ++i)
+    {
+        int32_t seq = *pSeq;
+        if ((seq & 1) == 0)
+        {
+            ls_barrier();
+            ret = pHash->findCopyUnlocked(key, pKey, keyLen, pBuf, bufLen);
+            ls_barrier();
+            if ((ret != -2) && (*pSeq == seq))
+                return ret;
+        }
+        m_pPool->chkRemap();
+    }
+
+    // writers keep the table busy, take the lock
+    ls_strpair_t parms;
+    ls_str_set(&parms.key, (char *)pKey, keyLen);
+    pHash->lockEx();
+    if (pHash->isRehashing())
+        pHash->rehash();
+    iteroffset iterOff = (*pHash->m_find)(pHash, &parms);
+    ret = LS_FAIL;
+    if (iterOff.m_iOffset != 0)
+    {
+        iterator iter = pHash->offset2iterator(iterOff);
+        ret = iter->getValLen();
+        ::memcpy(pBuf, iter->getVal(), (ret < bufLen) ? ret : bufLen);
+    }
+    pHash->unlockEx();
+    return ret;
+}
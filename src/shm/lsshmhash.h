@@ -23,6 +23,7 @@ class debugBase;
 #endif
 
 #include <lsdef.h>
+#include <lsr/ls_atomic.h>
 #include <lsr/ls_str.h>
 #include <shm/lsshm.h>
 #include <shm/lsshmpool.h>
@@ -32,6 +33,8 @@ class debugBase;
 #define LSSHM_FLAG_TID          (1<<1)    // `transaction' id
 #define LSSHM_FLAG_TID_SLAVE    (1<<2)    // do *not* generate new tid, nor notify
 
+#define LSSHM_MAX_SHARDS        64
+
 /**
  * @file
  *  HASH element
@@ -279,6 +282,61 @@ public:
 
     void clear();
 
+    //
+    //  Sharding splits the hash into independently locked sub-tables,
+    //  each with its own LRU list; an element lives in the shard selected
+    //  by its hash key. The shard count is recorded in SHM by the first
+    //  caller, later callers attach to the existing shards, and elements
+    //  already in the hash are moved into their shards.
+    //
+    //  Keyed operations on a sharded hash are forwarded to the shard.
+    //  Callers managing the lock themselves must lock and use the shard
+    //  returned by shardOf(); iteration and stat() work per shard.
+    //
+    int setupShards(int nShards);
+
+    int getShardCount() const
+    {   return m_iShards;   }
+
+    LsShmHash *getShard(int idx) const
+    {   return m_pShards[idx];  }
+
+    LsShmHKey hashKey(const void *pKey, int keyLen) const
+    {   return (m_hf != NULL) ? (*m_hf)(pKey, keyLen) : (LsShmHKey)(long)pKey;  }
+
+    LsShmHash *shardOfKey(LsShmHKey key) const
+    {
+        if (m_pShards == NULL)
+            return (LsShmHash *)this;
+        // mix the key so the shard does not correlate with the bucket index
+        return m_pShards[((key * 0x9e3779b1) >> 16) % m_iShards];
+    }
+
+    LsShmHash *shardOf(const void *pKey, int keyLen) const
+    {
+        if (m_pShards == NULL)
+            return (LsShmHash *)this;
+        return shardOfKey(hashKey(pKey, keyLen));
+    }
+
+    LsShmHash *shardOfIter(iteroffset iterOff) const
+    {
+        if (m_pShards == NULL)
+            return (LsShmHash *)this;
+        return shardOfKey(offset2iterator(iterOff)->x_hkey);
+    }
+
+    //
+    //  @brief findCopy
+    //  @brief lock-free lookup, copies at most bufLen bytes of the value.
+    //  Returns the value length, or -1 if the key is not found.
+    //  The walk is validated against the sequence counter of the table
+    //  and retried while a writer holds the lock; after a few failed
+    //  attempts it falls back to a locked lookup, so it must not be
+    //  called with the lock held.
+    //
+    int findCopy(const void *pKey, int keyLen, void *pBuf, int bufLen);
+
     static ls_strpair_t *setParms(ls_strpair_t *pParms,
                             const void *pKey, int keyLen, const void *pValue, int valueLen)
     {
@@ -293,6 +351,8 @@ public:
         ls_strpair_t parms;
         ls_str_set(&parms.key, (char *)pKey, keyLen);
         
+        if (m_pShards != NULL)
+            return shardOf(pKey, keyLen)->remove(pKey, keyLen);
         autoLockChkRehash();
         iterOff = (*m_find)(this, &parms);
         if (iterOff.m_iOffset != 0)
@@ -373,6 +433,8 @@ public:
         uint64_t tid = 0;
         ls_str_set(&parms.key, (char *)pKey, keyLen);
 
+        if (m_pShards != NULL)
+            return shardOf(pKey, keyLen)->getTid(pKey, keyLen);
         autoLockChkRehash();
         iterOff = (*m_find)(this, &parms);
         if (iterOff.m_iOffset != 0)
@@ -391,12 +453,16 @@ public:
 
     void eraseIterator(iteroffset iterOff)
     {
+        if (m_pShards != NULL)
+            return shardOfIter(iterOff)->eraseIterator(iterOff);
         eraseIteratorHelper(iterOff);
     }
 
     iteroffset  insertCopy(LsShmHKey key, ls_strpair_t *pParms)
     {
         iteroffset off;
+        if (m_pShards != NULL)
+            return shardOfKey(key)->insertCopy(key, pParms);
         autoLockChkRehash();
         off = insertCopy2(key, pParms);
         autoUnlock();
@@ -409,6 +475,9 @@ public:
     //
     iteroffset findIterator(ls_strpair_t *pParms)
     {
+        if (m_pShards != NULL)
+            return shardOf(ls_str_buf(&pParms->key), ls_str_len(&pParms->key))
+                   ->findIterator(pParms);
         autoLockChkRehash();
         iteroffset iterOff = (*m_find)(this, pParms);
         autoUnlock();
@@ -417,6 +486,9 @@ public:
 
     iteroffset getIterator(ls_strpair_t *pParms, int *pFlag)
     {
+        if (m_pShards != NULL)
+            return shardOf(ls_str_buf(&pParms->key), ls_str_len(&pParms->key))
+                   ->getIterator(pParms, pFlag);
         autoLockChkRehash();
         iteroffset iterOff = (*m_get)(this, pParms, pFlag);
         autoUnlock();
@@ -425,6 +497,9 @@ public:
 
     iteroffset insertIterator(ls_strpair_t *pParms)
     {
+        if (m_pShards != NULL)
+            return shardOf(ls_str_buf(&pParms->key), ls_str_len(&pParms->key))
+                   ->insertIterator(pParms);
         autoLockChkRehash();
         iteroffset iterOff = (*m_insert)(this, pParms);
         autoUnlock();
@@ -433,6 +508,9 @@ public:
 
     iteroffset setIterator(ls_strpair_t *pParms)
     {
+        if (m_pShards != NULL)
+            return shardOf(ls_str_buf(&pParms->key), ls_str_len(&pParms->key))
+                   ->setIterator(pParms);
         autoLockChkRehash();
         iteroffset iterOff = (*m_set)(this, pParms);
         autoUnlock();
@@ -441,6 +519,9 @@ public:
 
     iteroffset updateIterator(ls_strpair_t *pParms)
     {
+        if (m_pShards != NULL)
+            return shardOf(ls_str_buf(&pParms->key), ls_str_len(&pParms->key))
+                   ->updateIterator(pParms);
         autoLockChkRehash();
         iteroffset iterOff = (*m_update)(this, pParms);
         autoUnlock();
@@ -449,6 +530,8 @@ public:
 
     iteroffset findIteratorWithKey(LsShmHKey key, ls_strpair_t *pParms)
     {
+        if (m_pShards != NULL)
+            return shardOfKey(key)->findIteratorWithKey(key, pParms);
         autoLockChkRehash();
         iteroffset iterOff = find2(key, pParms);
         autoUnlock();
@@ -458,6 +541,8 @@ public:
     iteroffset getIteratorWithKey(LsShmHKey key, ls_strpair_t *pParms,
                                   int *pFlag)
     {
+        if (m_pShards != NULL)
+            return shardOfKey(key)->getIteratorWithKey(key, pParms, pFlag);
         autoLockChkRehash();
         iteroffset iterOff = find2(key, pParms);
         iterOff = doGet(iterOff, key, pParms, pFlag);
@@ -467,6 +552,8 @@ public:
 
     iteroffset insertIteratorWithKey(LsShmHKey key, ls_strpair_t *pParms)
     {
+        if (m_pShards != NULL)
+            return shardOfKey(key)->insertIteratorWithKey(key, pParms);
         autoLockChkRehash();
         iteroffset iterOff = find2(key, pParms);
         iterOff = doInsert(iterOff, key, pParms);
@@ -476,6 +563,8 @@ public:
 
     iteroffset setIteratorWithKey(LsShmHKey key, ls_strpair_t *pParms)
     {
+        if (m_pShards != NULL)
+            return shardOfKey(key)->setIteratorWithKey(key, pParms);
         autoLockChkRehash();
         iteroffset iterOff = find2(key, pParms);
         iterOff = doSet(iterOff, key, pParms);
@@ -485,6 +574,8 @@ public:
 
     iteroffset updateIteratorWithKey(LsShmHKey key, ls_strpair_t *pParms)
     {
+        if (m_pShards != NULL)
+            return shardOfKey(key)->updateIteratorWithKey(key, pParms);
         autoLockChkRehash();
         iteroffset iterOff = find2(key, pParms);
         iterOff = doUpdate(iterOff, key, pParms);
@@ -579,6 +670,8 @@ public:
     bool empty() const;
     LsShmSize_t size() const;
     LsShmSize_t capacity() const;
+    // a larger index is being filled, a few buckets per operation
+    int isRehashing() const;
 
     void incrTableSize();
     void decrTableSize();
@@ -614,10 +707,18 @@ public:
     int checkLruLink();
 
     void enableAutoLock()
-    {   m_iAutoLock = 1; };
+    {
+        m_iAutoLock = 1;
+        for (int i = 0; i < m_iShards; ++i)
+            m_pShards[i]->enableAutoLock();
+    }
 
     void disableAutoLock()
-    {   m_iAutoLock = 0; };
+    {
+        m_iAutoLock = 0;
+        for (int i = 0; i < m_iShards; ++i)
+            m_pShards[i]->disableAutoLock();
+    }
 
     int isAutoLock() const
     {   return m_iAutoLock;   }
@@ -626,19 +727,24 @@ public:
     {
         if (m_iAutoLock != 0)
             return 0;
-        return getPool()->getShm()->lockRemap(m_pShmLock);
+        return lockEx();
     }
 
     int unlock()
-    {   return m_iAutoLock ? 0 : ls_shmlock_unlock(m_pShmLock); }
+    {   return m_iAutoLock ? 0 : unlockEx(); }
 
     int lockEx()
     {
-        return getPool()->getShm()->lockRemap(m_pShmLock);
+        int ret = getPool()->getShm()->lockRemap(m_pShmLock);
+        seqWriteBegin();
+        return ret;
     }
 
     int unlockEx()
-    {   return ls_shmlock_unlock(m_pShmLock); }
+    {
+        seqWriteEnd();
+        return ls_shmlock_unlock(m_pShmLock);
+    }
 
     void lockChkRehash();
 
@@ -673,12 +779,28 @@ protected:
 
     ls_attr_inline LsShmHIterOff *getHidx(uint32_t idx) const;
 
+    //
+    //  While a rehash is in progress, buckets of the old index below the
+    //  migration cursor have been moved to the new index. getBucket()
+    //  returns the slot currently holding the key and its bitmap index,
+    //  or -1 for an old bucket, which has no bitmap. Iteration walks the
+    //  old buckets not migrated yet first, then the new index.
+    //
+    LsShmHIterOff *getBucket(LsShmHKey key, int *pBitIdx) const;
+    LsShmHIterOff *bucketAt(uint32_t pos) const;
+    uint32_t    bucketCount() const;
+    uint32_t    bucketPos(LsShmHKey key) const;
+
     ls_attr_inline uint8_t *getBitMap(uint32_t indx) const;
     int getBitMapEnt(uint32_t indx);
     void setBitMapEnt(uint32_t indx);
     void clrBitMapEnt(uint32_t indx);
 
     int         rehash();
+    int         startRehash();
+    void        recoverRehashIter();
+    int         rehashStep(uint32_t maxBuckets);
+    void        finishRehash();
     iteroffset  find2(LsShmHKey key, ls_strpair_t *pParms);
     iteroffset  insert2(LsShmHKey key, ls_strpair_t *pParms);
     iteroffset  insertCopy2(LsShmHKey key, ls_strpair_t *pParms);
@@ -728,12 +850,36 @@ protected:
             assert(m_pPool->getShm()->isLocked(m_pShmLock));
             return 0;
         }
-        return getPool()->getShm()->lockRemap(m_pShmLock);
+        return lockEx();
     }
 
     int autoUnlock()
     {   assert(m_pPool->getShm()->isLocked(m_pShmLock));
-        return m_iAutoLock && ls_shmlock_unlock(m_pShmLock); }
+        return m_iAutoLock && unlockEx(); }
+
+    //
+    //  The sequence counter in the table is odd while the lock is held,
+    //  lock-free readers retry when it is odd or has changed.
+    //
+    void seqWriteBegin()
+    {
+        // an odd count left by a dead lock holder is skipped over
+        if (m_pSeq != NULL)
+            ls_atomic_add(m_pSeq, (*m_pSeq & 1) ? 2 : 1);
+    }
+
+    void seqWriteEnd()
+    {
+        if (m_pSeq != NULL)
+            ls_atomic_add(m_pSeq, 1);
+    }
+
+    int findCopyUnlocked(LsShmHKey key, const void *pKey, int keyLen,
+                         void *pBuf, int bufLen);
+    int  allocShards(int nShards);
+    int  attachShards();
+    void migrateToShards();
+    void releaseShards();
 
     void autoLockChkRehash();
 
@@ -788,6 +934,9 @@ protected:
     LsShmStatus_t       m_status;
     LsShmHashLruAddon  *m_pLruAddon;
     LsShmObsIter_t     *m_pObservers;
+    int32_t            *m_pSeq;         // sequence counter in SHM
+    LsShmHash         **m_pShards;
+    int                 m_iShards;
 
     // house keeping
     int m_iRef;
@@ -108,10 +108,10 @@ int CoreSocket::listen(const char *pURL, int backlog, int *fd, int sndBuf,
 
 
 int CoreSocket::listen(const GSockAddr &server, int backLog, int *fd,
-                       int sndBuf, int rcvBuf)
+                       int sndBuf, int rcvBuf, int reusePort)
 {
     int ret;
-    ret = bind(server, SOCK_STREAM, fd);
+    ret = bind(server, SOCK_STREAM, fd, reusePort);
     if (ret)
         return ret;
 
@@ -145,7 +145,8 @@ int CoreSocket::listen(const GSockAddr &server, int backLog, int *fd,
 }
 
 
-int CoreSocket::bind(const GSockAddr &server, int type, int *fd)
+int CoreSocket::bind(const GSockAddr &server, int type, int *fd,
+                     int reusePort)
 {
     int ret;
     if (!server.get())
@@ -154,6 +155,18 @@ int CoreSocket::bind(const GSockAddr &server, int type, int *fd)
     if (*fd == -1)
         return errno;
     int flag = 1;
+#ifdef SO_REUSEPORT
+    //SO_REUSEPORT must be set before bind(), every socket sharing the
+    //address has to carry it, otherwise bind() fails with EADDRINUSE.
+    if (reusePort && setsockopt(*fd, SOL_SOCKET, SO_REUSEPORT,
+                                (char *)(&flag), sizeof(flag)) != 0)
+    {
+        ret = errno;
+        ::close(*fd);
+        *fd = -1;
+        return ret;
+    }
+#endif
     if (setsockopt(*fd, SOL_SOCKET, SO_REUSEADDR,
                    (char *)(&flag), sizeof(flag)) == 0)
     {
@@ -92,11 +92,12 @@ public:
                         int dnslookup = 0, int nodelay = 1);
     static int  connect(const GSockAddr &server, int iFLTag, int *fd,
                         int nodelay = 1);
-    static int  bind(const GSockAddr &server, int type, int *fd);
+    static int  bind(const GSockAddr &server, int type, int *fd,
+                     int reusePort = 0);
     static int  listen(const char *pURL, int backlog, int *fd,
                        int sndBuf = -1, int rcvBuf = -1);
     static int  listen(const GSockAddr &addr, int backlog, int *fd,
-                       int sndBuf = -1, int rcvBuf = -1);
+                       int sndBuf = -1, int rcvBuf = -1, int reusePort = 0);
 
 
     LS_NO_COPY_ASSIGN(CoreSocket);
@@ -18,6 +18,7 @@
 #include "h2connection.h"
 #include <http/hiohandlerfactory.h>
 #include <http/httpheader.h>
+#include <http/httppriority.h>
 #include <http/httprespheaders.h>
 #include <http/httpstatuscode.h>
 #include <http/httpserverconfig.h>
@@ -81,6 +82,7 @@ H2Connection::H2Connection()
     , m_iMaxPushStreams(100)
     , m_iPeerMaxFrameSize(H2_DEFAULT_DATAFRAME_SIZE)
     , m_tmIdleBegin(0)
+    , m_iPendingPriority(0)
 {
     m_timevalPing.tv_sec = 0;
     m_pCurH2Header = (H2FrameHeader *)m_iaH2HeaderMem;
@@ -113,6 +115,7 @@ int H2Connection::init()
     m_iCurPushStreams = 0;
     m_iCurrentFrameRemain = -H2_FRAME_HEADER_SIZE;
     m_pCurH2Header = (H2FrameHeader *)m_iaH2HeaderMem;
+    m_iPendingPriority = 0;
     return 0;
 }
 
@@ -340,6 +343,8 @@ int H2Connection::processFrame(H2FrameHeader *pHeader)
         return processContinuationFrame(pHeader);
     case H2_FRAME_PING:
         return processPingFrame(pHeader);
+    case H2_FRAME_PRIORITY_UPDATE:
+        return processPriorityUpdateFrame(pHeader);
     default:
         sendPingFrame(H2_FLAG_ACK, (uint8_t *)"\0\0\0\0\0\0\0\0");
         break;
@@ -383,6 +388,103 @@ int H2Connection::processPriorityFrame(H2FrameHeader *pHeader)
 }
 
 
+int H2Connection::processPriorityUpdateFrame(H2FrameHeader *pHeader)
+{
+    char achBuf[256];
+    int len = pHeader->getLength();
+    if (pHeader->getStreamId() != 0)
+    {
+        LS_DBG_L(getLogSession(), "bad PRIORITY_UPDATE frame, stream ID is not zero.");
+        return H2_ERROR_PROTOCOL_ERROR;
+    }
+    if (len < 4)
+        return H2_ERROR_FRAME_SIZE_ERROR;
+    if (++m_iControlFrames > MAX_CONTROL_FRAMES_RATE)
+    {
+        LS_INFO(getLogSession(), "PRIORITY_UPDATE frame abuse detected, close connection.");
+        return LS_FAIL;
+    }
+    //a longer value cannot be a priority we understand
+    if (len > (int)sizeof(achBuf))
+        return 0;
+    m_bufInput.moveTo(achBuf, len);
+    m_iCurrentFrameRemain -= len;
+    m_iFlag |= H2_CONN_FLAG_EXT_PRIORITY;
+
+    uint32_t id = beReadUint32((const unsigned char *)achBuf) & 0x7FFFFFFFu;
+    LS_DBG_L(getLogger(), "[%s-%d] PRIORITY_UPDATE: '%.*s'", getLogId(), id,
+             len - 4, achBuf + 4);
+    if (id == 0)
+        return H2_ERROR_PROTOCOL_ERROR;
+    H2Stream *pH2Stream = findStream(id);
+    if (!pH2Stream)
+    {
+        //RFC 9218 7.1, the frame may arrive before the HEADERS of its
+        //stream, keep it until then. Lower IDs are closed already.
+        int urgency = HTTP_PRI_URGENCY_DEFAULT;
+        int incremental = 0;
+        if ((id & 1) && id > m_uiLastStreamId
+            && HttpPriority::parse(achBuf + 4, achBuf + len, &urgency,
+                                   &incremental) == LS_OK)
+            savePendingPriority(id, urgency, incremental);
+        return 0;
+    }
+    int urgency = pH2Stream->getPriority();
+    int incremental = pH2Stream->getFlag(HIO_FLAG_INCREMENTAL) != 0;
+    if (HttpPriority::parse(achBuf + 4, achBuf + len, &urgency,
+                            &incremental) == LS_OK)
+        pH2Stream->applyExtPriority(urgency, incremental);
+    return 0;
+}
+
+
+void H2Connection::savePendingPriority(uint32_t id, int urgency,
+                                       int incremental)
+{
+    int i;
+    for (i = 0; i < m_iPendingPriority; ++i)
+        if (m_pendingPriority[i].m_uiStreamId == id)
+            break;
+    if (i == H2_PENDING_PRIORITY_UPDATES)
+    {
+        //full, the oldest one goes
+        memmove(m_pendingPriority, m_pendingPriority + 1,
+                sizeof(m_pendingPriority[0]) * (--i));
+    }
+    else if (i == m_iPendingPriority)
+        ++m_iPendingPriority;
+    m_pendingPriority[i].m_uiStreamId = id;
+    m_pendingPriority[i].m_iUrgency = urgency;
+    m_pendingPriority[i].m_iIncremental = incremental;
+}
+
+
+/**
+ * Gets the PRIORITY_UPDATE kept for a new stream, returns 1 if there was
+ * one. Those of the lower IDs skipped by the client are dropped too.
+ */
+int H2Connection::takePendingPriority(uint32_t id, int *pUrgency,
+                                      int *pIncremental)
+{
+    int found = 0;
+    int n = 0;
+    for (int i = 0; i < m_iPendingPriority; ++i)
+    {
+        H2PendingPriority *pPending = &m_pendingPriority[i];
+        if (pPending->m_uiStreamId == id)
+        {
+            *pUrgency = pPending->m_iUrgency;
+            *pIncremental = pPending->m_iIncremental;
+            found = 1;
+        }
+        else if (pPending->m_uiStreamId > id)
+            m_pendingPriority[n++] = *pPending;
+    }
+    m_iPendingPriority = n;
+    return found;
+}
+
+
 int H2Connection::processPushPromiseFrame(H2FrameHeader *pHeader)
 {
     doGoAway(H2_ERROR_PROTOCOL_ERROR);
@@ -871,6 +973,18 @@ int H2Connection::decodeHeaders(unsigned char *pSrc, int length,
                  headers->getBuf()->begin() + 4);
     }
 
+    int urgency = pStream->getPriority();
+    int incremental = 0;
+    if (HttpPriority::parse(headers, &urgency, &incremental))
+    {
+        m_iFlag |= H2_CONN_FLAG_EXT_PRIORITY;
+        pStream->applyExtPriority(urgency, incremental);
+    }
+    //an earlier PRIORITY_UPDATE overrides the header
+    if (m_iPendingPriority
+        && takePendingPriority(pStream->getStreamID(), &urgency, &incremental))
+        pStream->applyExtPriority(urgency, incremental);
+
     pStream->setFlag(HIO_FLAG_INIT_SESS, 1);
     add2PriorityQue(pStream);
     //pStream->onInitConnected(NULL, 0);
@@ -912,7 +1026,9 @@ int H2Connection::processPriority(uint32_t id)
         }
         else
             pH2Stream->setFlag(HIO_FLAG_PRI_SET, 1);
-        pH2Stream->apply_priority(&m_priority);
+        //RFC 9218 signals from the client replace RFC 7540 ones
+        if (!(m_iFlag & H2_CONN_FLAG_EXT_PRIORITY))
+            pH2Stream->apply_priority(&m_priority);
     }
     return 0;
 }
@@ -975,6 +1091,8 @@ int H2Connection::processHeadersFrame(H2FrameHeader *pHeader)
     }
     else
         memset(&m_priority, 0, sizeof(m_priority));
+    if (m_iFlag & H2_CONN_FLAG_EXT_PRIORITY)
+        m_priority.m_weight = 0;
 
     if ((iHeaderFlag & H2_FLAG_END_HEADERS) == 0)
         m_iFlag |= H2_CONN_HEADERS_START;
@@ -1243,6 +1361,9 @@ int H2Connection::getWeightedPriority(H2Stream* s)
         if (m_priQue[i].size() > 0)
             return 16;
     }
+    //not incremental, the stream does not share the bandwidth
+    if (!s->getFlag(HIO_FLAG_INCREMENTAL))
+        return 1;
     ret = m_priQue[pri].size() + 1;
     if (ret > 16)
         ret = 16;
@@ -1672,6 +1793,18 @@ int H2Connection::encodeHeaders(HttpRespHeaders *pRespHeaders,
 
     pRespHeaders->dropConnectionHeaders();
 
+    //fixed headers of a cached static file, already encoded
+    int preLen;
+    uint32_t preMask = 0;
+    const char *pPre = pRespHeaders->getHpackBlock(&preLen, &preMask);
+    if (pPre)
+    {
+        if (preLen > pBufEnd - pCur)
+            return LS_FAIL;
+        memcpy(pCur, pPre, preLen);
+        pCur += preLen;
+    }
+
     for (int pos = pRespHeaders->HeaderBeginPos();
          pos != pRespHeaders->HeaderEndPos();
          pos = pRespHeaders->nextHeaderPos(pos))
@@ -1683,6 +1816,8 @@ int H2Connection::encodeHeaders(HttpRespHeaders *pRespHeaders,
 
         if (count <= 0)
             continue;
+        if (hdr_idx >= 0 && hdr_idx < 32 && (preMask & (1 << hdr_idx)))
+            continue;
 
         hpack_idx = HttpRespHeaders::toHpackIdx(hdr_idx);
         char *p = (char *)hdr.name.iov_base;
@@ -1888,14 +2023,36 @@ void H2Connection::removePriQue(H2Stream *pH2Stream)
 }
 
 
+/**
+ * Streams that are not incremental go first, in stream ID order, so each
+ * is sent completely before the next one starts. Incremental streams are
+ * appended and take turns.
+ */
+void H2Connection::queueStream(H2Stream *pH2Stream)
+{
+    TDLinkQueue<H2Stream> *pQue = &m_priQue[pH2Stream->getPriority()];
+    if (pH2Stream->getFlag(HIO_FLAG_INCREMENTAL))
+    {
+        pQue->append(pH2Stream);
+        return;
+    }
+    H2Stream *pNext = pQue->begin();
+    while (pNext != pQue->end() && !pNext->getFlag(HIO_FLAG_INCREMENTAL)
+           && pNext->getStreamID() < pH2Stream->getStreamID())
+        pNext = pQue->next(pNext);
+    pQue->insert(pNext, pH2Stream);
+}
+
+
 void H2Connection::add2PriorityQue(H2Stream *pH2Stream)
 {
     if (pH2Stream->next())
         removePriQue(pH2Stream);
-    LS_DBG_H(getLogger(), "[%s-%d] add to priority queue: %d",
-             getLogId(), pH2Stream->getStreamID(), pH2Stream->getPriority());
+    LS_DBG_H(getLogger(), "[%s-%d] add to priority queue: %d, incremental: %d",
+             getLogId(), pH2Stream->getStreamID(), pH2Stream->getPriority(),
+             pH2Stream->getFlag(HIO_FLAG_INCREMENTAL) != 0);
 
-    m_priQue[pH2Stream->getPriority()].append(pH2Stream);
+    queueStream(pH2Stream);
     m_iFlag |= H2_CONN_FLAG_WAIT_PROCESS;
     if ((m_iFlag & H2_CONN_FLAG_IN_EVENT) == 0
         && m_iCurDataOutWindow > 0 && !getStream()->isWantWrite())
@@ -1966,7 +2123,7 @@ int H2Connection::onWriteEx2()
             {
                 ++wantWrite;
                 if (!pH2Stream->next())
-                    m_priQue[pH2Stream->getPriority()].append(pH2Stream);
+                    queueStream(pH2Stream);
             }
 
             if (pH2Stream->getState() != HIOS_CONNECTED)
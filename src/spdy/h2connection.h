@@ -45,14 +45,40 @@
 #define H2_CONN_FLAG_WANT_FLUSH     (1<<9)
 #define H2_CONN_FLAG_IN_EVENT       (1<<10)
 #define H2_CONN_FLAG_PAUSE_READ     (1<<11)
+#define H2_CONN_FLAG_EXT_PRIORITY   (1<<12)
 
 #define H2_STREAM_PRIORITYS         (8)
 
+//PRIORITY_UPDATE frames kept for streams not opened yet
+#define H2_PENDING_PRIORITY_UPDATES (8)
+
+struct H2PendingPriority
+{
+    uint32_t    m_uiStreamId;
+    uint8_t     m_iUrgency;
+    uint8_t     m_iIncremental;
+};
+
 
 class H2Stream;
 
+#ifdef RUN_TEST
+namespace SuiteH2HpackBlock {
+    class TestSplicedBlockDecodes;
+    class TestChangedHeaderFallsBack;
+};
+namespace SuiteH2PriorityUpdate {
+    class TestPendingStreams;
+};
+#endif
+
 class H2Connection: public HioHandler, public BufferedOS
 {
+#ifdef RUN_TEST
+    friend class SuiteH2HpackBlock::TestSplicedBlockDecodes;
+    friend class SuiteH2HpackBlock::TestChangedHeaderFallsBack;
+    friend class SuiteH2PriorityUpdate::TestPendingStreams;
+#endif
 public:
     H2Connection();
     virtual ~H2Connection();
@@ -194,6 +220,7 @@ private:
     int decodeHeaders(unsigned char *src, int length,
                       unsigned char iHeaderFlag);
     int processPriorityFrame(H2FrameHeader *pHeader);
+    int processPriorityUpdateFrame(H2FrameHeader *pHeader);
     int processSettingFrame(H2FrameHeader *pHeader);
     int processHeadersFrame(H2FrameHeader *pHeader);
     int processHeaderFrame(H2FrameHeader *pHeader);
@@ -206,6 +233,9 @@ private:
 
     int processReqHeader(unsigned char iHeaderFlag);
     int processPriority(uint32_t id);
+    void savePendingPriority(uint32_t id, int urgency, int incremental);
+    int takePendingPriority(uint32_t id, int *pUrgency, int *pIncremental);
+    void queueStream(H2Stream *pH2Stream);
 
     int sendPingFrame(uint8_t flags, uint8_t *pPayload);
     int sendSettingsFrame();
@@ -282,6 +312,8 @@ private:
     int32_t         m_tmIdleBegin;
     int32_t         m_iaH2HeaderMem[10];
     H2FrameHeader  *m_pCurH2Header;
+    H2PendingPriority m_pendingPriority[H2_PENDING_PRIORITY_UPDATES];
+    int32_t         m_iPendingPriority;
 
 private:
     struct lshpack_enc  m_hpack_enc;
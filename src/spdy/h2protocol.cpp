@@ -36,6 +36,8 @@ const char *getH2FrameName(unsigned char bframeType)
 {
     if (bframeType < H2_FRAME_MAX_TYPE)
         return s_sH2FrameName[bframeType];
+    if (bframeType == H2_FRAME_PRIORITY_UPDATE)
+        return "PRIORITY_UPDATE";
     return "UNKONWN";
 }
 
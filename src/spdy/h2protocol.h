@@ -40,6 +40,10 @@ enum H2FrameType
     H2_FRAME_CONTINUATION,  //9,
     H2_FRAME_MAX_TYPE,      //10
 };
+
+//RFC 9218, outside of the RFC 7540 range above
+#define H2_FRAME_PRIORITY_UPDATE    0x10
+
 // Flags on data packets.
 enum H2DataFlags
 {
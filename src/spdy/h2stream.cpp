@@ -21,6 +21,7 @@
 #include "unpackedheaders.h"
 
 #include <http/hiohandlerfactory.h>
+#include <http/httppriority.h>
 
 #include <util/datetime.h>
 #include <log4cxx/logger.h>
@@ -60,24 +61,44 @@ const char *H2Stream::buildLogId()
 
 void H2Stream::apply_priority(Priority_st *pPriority)
 {
-    int pri = HIO_PRIORITY_HTML;
-    if (pPriority)
+    int pri = HTTP_PRI_URGENCY_DEFAULT;
+    if (pPriority && pPriority->m_weight)
     {
         if (pPriority->m_weight <= 32)
             pri = (32 - pPriority->m_weight) >> 2;
         else
             pri = (256 - pPriority->m_weight) >> 5;
     }
-    if (pri != getPriority())
+    updatePriority(pri, getFlag(HIO_FLAG_INCREMENTAL));
+}
+
+
+void H2Stream::applyExtPriority(int urgency, int incremental)
+{
+    LS_DBG_L(this, "H2Stream::applyExtPriority(), urgency: %d, incremental: %d",
+             urgency, incremental);
+    updatePriority(urgency, incremental);
+}
+
+
+void H2Stream::updatePriority(int pri, int incremental)
+{
+    if (incremental)
+        incremental = HIO_FLAG_INCREMENTAL;
+    if (pri == getPriority() && (uint32_t)incremental
+                                == getFlag(HIO_FLAG_INCREMENTAL))
+        return;
+    if (next())
     {
-        if (next())
-        {
-            m_pH2Conn->removePriQue(this);
-            setPriority(pri);
-            m_pH2Conn->add2PriorityQue(this);
-        }
-        else
-            setPriority(pri);
+        m_pH2Conn->removePriQue(this);
+        setPriority(pri);
+        setFlag(HIO_FLAG_INCREMENTAL, incremental);
+        m_pH2Conn->add2PriorityQue(this);
+    }
+    else
+    {
+        setPriority(pri);
+        setFlag(HIO_FLAG_INCREMENTAL, incremental);
     }
 }
 
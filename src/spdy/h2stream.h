@@ -115,6 +115,7 @@ public:
     int getDataFrameSize(int wanted);
 
     void apply_priority(Priority_st *priority);
+    void applyExtPriority(int urgency, int incremental);
 
     void appendInputData(char ch)
     {
@@ -125,6 +126,7 @@ private:
     bool operator==(const H2Stream &other) const;
 
     int dataSent(int ret);
+    void updatePriority(int pri, int incremental);
     void shutdownEx();
     void markShutdown();
 
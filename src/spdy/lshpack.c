@@ -6108,6 +6108,41 @@ lshpack_enc_encode (struct lshpack_enc *henc, unsigned char *dst,
 }
 
 
+unsigned char *
+lshpack_enc_encode_literal (unsigned char *dst, unsigned char *dst_end,
+                            int hpack_idx, const lshpack_header_t *hdr)
+{
+    unsigned char *const dst_org = dst;
+    int rc;
+
+    if (dst_end <= dst)
+        return dst_org;
+
+    *dst = 0x00;
+    if (hpack_idx > 0)
+    {
+        dst = lshpack_enc_enc_int(dst, dst_end, hpack_idx, 4);
+        if (dst == dst_org)
+            return dst_org;
+    }
+    else
+    {
+        ++dst;
+        rc = lshpack_enc_enc_str(dst, dst_end - dst,
+                    (const unsigned char *)hdr->name.iov_base, hdr->name.iov_len);
+        if (rc < 0)
+            return dst_org;
+        dst += rc;
+    }
+
+    rc = lshpack_enc_enc_str(dst, dst_end - dst,
+                (const unsigned char *)hdr->value.iov_base, hdr->value.iov_len);
+    if (rc < 0)
+        return dst_org;
+    return dst + rc;
+}
+
+
 void
 lshpack_enc_set_max_capacity (struct lshpack_enc *enc, unsigned max_capacity)
 {
@@ -171,6 +171,25 @@ lshpack_enc_encode (struct lshpack_enc *henc, unsigned char *dst,
                      unsigned char *dst_end, int hpack_idx,
                      const lshpack_header_t *hdr, int indexed_type);
 
+/**
+ * @brief Encode one name/value pair as a literal without indexing
+ *
+ * No encoder state is used or changed, the output can be saved and sent
+ * on any connection.
+ *
+ * @param[out] dst - A pointer to destination buffer
+ * @param[out] dst_end - A pointer to end of destination buffer
+ * @param[in] hpack_idx - The position of header name in static table,
+ *              <= 0 the name is not in static table
+ * @param[in] hdr - the header name and value
+ *
+ * @return The (possibly advanced) dst pointer.  If the destination
+ * pointer was not advanced, an error must have occurred.
+ */
+unsigned char *
+lshpack_enc_encode_literal (unsigned char *dst, unsigned char *dst_end,
+                            int hpack_idx, const lshpack_header_t *hdr);
+
 void
 lshpack_enc_set_max_capacity (struct lshpack_enc *, unsigned);
 
@@ -375,6 +375,12 @@ static int bio_fd_write(BIO *b, const char *in, int inl)
         errno = EAGAIN;
         return -1;
     }
+    if (fdbio->m_flag & LS_FDBIO_KTLS_TX)
+    {
+        DEBUG_MESSAGE("[FDBIO] bio_fd_write, kTLS TX is active, refuse record\n");
+        errno = EPROTO;
+        return -1;
+    }
 
     if (fdbio->m_flag & LS_FDBIO_BUFFERING)
     {
@@ -35,6 +35,8 @@ typedef struct ls_fdbio_data {
 
 #define LS_FDBIO_WBLOCK         1
 #define LS_FDBIO_BUFFERING      2
+/* TX records are encrypted by kernel TLS, user space records are refused. */
+#define LS_FDBIO_KTLS_TX        4
 
 
 /**
@@ -15,6 +15,7 @@
 #include <openssl/ssl.h>
 #include <openssl/bio.h>
 #include <openssl/err.h>
+#include <openssl/hmac.h>
 
 #include <sslpp/sslerror.h>
 #include <sslpp/sslsesscache.h>
@@ -28,6 +29,24 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+
+#if defined(OPENSSL_IS_BORINGSSL) && defined(__linux__) \
+    && defined(__has_include)
+#if __has_include(<linux/tls.h>)
+#define LS_SSL_KTLS
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+#ifndef SOL_TLS
+#define SOL_TLS     282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP     31
+#endif
+#endif
+#endif
+
+#define KTLS_MAX_SECRET     48
 
 #define DEBUGGING
 
@@ -49,6 +68,7 @@
 #endif
 
 int32_t SslConnection::s_iConnIdx = -1;
+int32_t SslConnection::s_iKtlsTx = 0;
 
 SslConnection::SslConnection()
     : m_ssl(NULL)
@@ -56,6 +76,7 @@ SslConnection::SslConnection()
     , m_flag(0)
     , m_iStatus(DISCONNECTED)
     , m_iWant(0)
+    , m_pKtlsSecret(NULL)
 {
     ls_fdbuf_bio_init(&m_bio);
 }
@@ -93,6 +114,8 @@ void SslConnection::release()
     SSL_free(m_ssl);
     m_ssl = NULL;
     m_iWant = 0;
+    m_bio.m_flag &= ~LS_FDBIO_KTLS_TX;
+    releaseKtlsSecret();
 }
 
 
@@ -152,6 +175,19 @@ int SslConnection::write(const char *pBuf, int len)
     m_iWant = 0;
     if (len <= 0)
         return 0;
+    if (isKtlsTx())
+    {
+        int ret = ::write(SSL_get_fd(m_ssl), pBuf, len);
+        if (ret > 0)
+            return ret;
+        if ((ret == -1) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                            || (errno == EINTR)))
+        {
+            m_iWant = LAST_WRITE | WANT_WRITE;
+            return 0;
+        }
+        return LS_FAIL;
+    }
     int ret = SSL_write(m_ssl, pBuf, len);
 
     LS_DBG_M("SSL_write( %p, %p, %d) return %d, pending %d\n",
@@ -184,7 +220,28 @@ int SslConnection::writev(const struct iovec *vect, int count,
     char *pBufEnd;
     char *pCurEnd;
     char achBuf[4096];
-    
+
+    if (isKtlsTx())
+    {
+        m_iWant = 0;
+        ret = ::writev(SSL_get_fd(m_ssl), vect, count);
+        if (ret == -1)
+        {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+                return LS_FAIL;
+            m_iWant = LAST_WRITE | WANT_WRITE;
+            ret = 0;
+        }
+        if (finished)
+        {
+            int left = ret;
+            for (; vect < pEnd && left >= (int)vect->iov_len; ++vect)
+                left -= vect->iov_len;
+            *finished = (vect == pEnd);
+        }
+        return ret;
+    }
+
     pBufEnd = achBuf + 4096;
     pCurEnd = achBuf;
     for (; vect < pEnd ;)
@@ -253,7 +310,8 @@ int SslConnection::flush()
 int SslConnection::shutdown(int bidirectional)
 {
     assert(m_ssl);
-    
+
+    int ktls = isKtlsTx();
     m_flag = 0;
     if (m_iStatus == ACCEPTING)
     {
@@ -264,6 +322,14 @@ int SslConnection::shutdown(int bidirectional)
     if (m_iStatus != DISCONNECTED)
     {
         m_iWant = 0;
+        if (ktls)
+        {
+            //SSL_shutdown() would write the alert with the user space keys.
+            sendKtlsCloseNotify();
+            SSL_set_quiet_shutdown(m_ssl, 1);
+            m_iStatus = DISCONNECTED;
+            return 0;
+        }
         setWriteBuffering(0);
         SSL_set_shutdown(m_ssl, SSL_RECEIVED_SHUTDOWN);
         //SSL_set_quiet_shutdown( m_ssl, !bidirectional );
@@ -732,3 +798,269 @@ void SslConnection::releaseIdleBuffer()
 }
 
 
+
+
+void SslConnection::releaseKtlsSecret()
+{
+    if (m_pKtlsSecret)
+    {
+        OPENSSL_cleanse(m_pKtlsSecret, KTLS_MAX_SECRET + 1);
+        ls_pfree(m_pKtlsSecret);
+        m_pKtlsSecret = NULL;
+    }
+}
+
+
+/**
+ * BoringSSL has no C API for the TLS 1.3 traffic secrets, the server
+ * application traffic secret is taken from the key log callback, which is
+ * only installed when kTLS is enabled.
+ */
+void SslConnection::ktlsKeylogCb(const SSL *ssl, const char *line)
+{
+    static const char s_label[] = "SERVER_TRAFFIC_SECRET_0 ";
+    if (strncmp(line, s_label, sizeof(s_label) - 1) != 0)
+        return;
+    SslConnection *pConn = get(ssl);
+    if (!pConn || !SSL_is_server(ssl))
+        return;
+    //skip client random
+    const char *pSecret = strchr(line + sizeof(s_label) - 1, ' ');
+    if (!pSecret)
+        return;
+    ++pSecret;
+    int len = strlen(pSecret);
+    if ((len & 1) || (len / 2 > KTLS_MAX_SECRET))
+        return;
+    if (!pConn->m_pKtlsSecret)
+    {
+        pConn->m_pKtlsSecret = (uint8_t *)ls_palloc(KTLS_MAX_SECRET + 1);
+        if (!pConn->m_pKtlsSecret)
+            return;
+    }
+    pConn->m_pKtlsSecret[0] = StringTool::hexDecode(pSecret, len,
+                                        (char *)pConn->m_pKtlsSecret + 1);
+}
+
+
+//HKDF-Expand-Label() of RFC 8446 with an empty context, out_len must not
+//exceed the digest size, so a single HMAC block is enough.
+int SslConnection::ktlsExpandLabel(const EVP_MD *md, const uint8_t *secret,
+                                   int secretLen, const char *label,
+                                   uint8_t *out, int outLen)
+{
+    uint8_t info[32];
+    uint8_t block[EVP_MAX_MD_SIZE];
+    unsigned int blockLen;
+    int labelLen = strlen(label);
+    int n = 0;
+
+    if (outLen > (int)EVP_MD_size(md))
+        return LS_FAIL;
+    info[n++] = 0;
+    info[n++] = outLen;
+    info[n++] = 6 + labelLen;
+    memcpy(&info[n], "tls13 ", 6);
+    n += 6;
+    memcpy(&info[n], label, labelLen);
+    n += labelLen;
+    info[n++] = 0;
+    info[n++] = 1;
+    if (!HMAC(md, secret, secretLen, info, n, block, &blockLen))
+        return LS_FAIL;
+    memcpy(out, block, outLen);
+    OPENSSL_cleanse(block, sizeof(block));
+    return LS_OK;
+}
+
+
+
+#ifdef LS_SSL_KTLS
+
+union KtlsCryptoInfo
+{
+    struct tls_crypto_info                  info;
+    struct tls12_crypto_info_aes_gcm_128    gcm128;
+    struct tls12_crypto_info_aes_gcm_256    gcm256;
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    struct tls12_crypto_info_chacha20_poly1305  chacha;
+#endif
+};
+
+
+static int buildKtlsTxInfo(SSL *ssl, const uint8_t *pSecret,
+                           KtlsCryptoInfo *pInfo)
+{
+    const SSL_CIPHER *pCipher = SSL_get_current_cipher(ssl);
+    if (!pCipher)
+        return 0;
+    uint8_t key[32];
+    uint8_t iv[12];
+    uint8_t seq[8];
+    int keyLen, ivLen, infoLen;
+    int nid = SSL_CIPHER_get_cipher_nid(pCipher);
+    switch (nid)
+    {
+    case NID_aes_128_gcm:
+        keyLen = 16;
+        break;
+    case NID_aes_256_gcm:
+        keyLen = 32;
+        break;
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    case NID_chacha20_poly1305:
+        keyLen = 32;
+        break;
+#endif
+    default:
+        return 0;
+    }
+
+    int version = SSL_version(ssl);
+    if (version == TLS1_3_VERSION)
+    {
+        const EVP_MD *md = SSL_CIPHER_get_handshake_digest(pCipher);
+        if (!pSecret || !md
+            || SslConnection::ktlsExpandLabel(md, pSecret + 1, pSecret[0],
+                                              "key", key, keyLen) != LS_OK
+            || SslConnection::ktlsExpandLabel(md, pSecret + 1, pSecret[0],
+                                              "iv", iv, sizeof(iv)) != LS_OK)
+            return 0;
+        ivLen = sizeof(iv);
+    }
+    else if (version == TLS1_2_VERSION)
+    {
+        //AEAD key block: client key, server key, client iv, server iv
+        uint8_t block[2 * (32 + 12)];
+        size_t blockLen = SSL_get_key_block_len(ssl);
+        ivLen = (nid == NID_aes_128_gcm || nid == NID_aes_256_gcm) ? 4 : 12;
+        if (blockLen != (size_t)(2 * (keyLen + ivLen))
+            || !SSL_generate_key_block(ssl, block, blockLen))
+            return 0;
+        memcpy(key, block + keyLen, keyLen);
+        memcpy(iv, block + 2 * keyLen + ivLen, ivLen);
+        OPENSSL_cleanse(block, sizeof(block));
+    }
+    else
+        return 0;
+
+    uint64_t seqNum = SSL_get_write_sequence(ssl);
+    for (int i = 7; i >= 0; --i, seqNum >>= 8)
+        seq[i] = seqNum & 0xff;
+
+    memset(pInfo, 0, sizeof(*pInfo));
+    pInfo->info.version = (version == TLS1_3_VERSION) ? TLS_1_3_VERSION
+                                                      : TLS_1_2_VERSION;
+    switch (nid)
+    {
+    case NID_aes_128_gcm:
+        pInfo->info.cipher_type = TLS_CIPHER_AES_GCM_128;
+        memcpy(pInfo->gcm128.key, key, keyLen);
+        memcpy(pInfo->gcm128.salt, iv, 4);
+        //TLS 1.2 explicit nonce starts from the sequence number as well
+        memcpy(pInfo->gcm128.iv, (ivLen == 12) ? iv + 4 : seq, 8);
+        memcpy(pInfo->gcm128.rec_seq, seq, 8);
+        infoLen = sizeof(pInfo->gcm128);
+        break;
+    case NID_aes_256_gcm:
+        pInfo->info.cipher_type = TLS_CIPHER_AES_GCM_256;
+        memcpy(pInfo->gcm256.key, key, keyLen);
+        memcpy(pInfo->gcm256.salt, iv, 4);
+        memcpy(pInfo->gcm256.iv, (ivLen == 12) ? iv + 4 : seq, 8);
+        memcpy(pInfo->gcm256.rec_seq, seq, 8);
+        infoLen = sizeof(pInfo->gcm256);
+        break;
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    default:
+        pInfo->info.cipher_type = TLS_CIPHER_CHACHA20_POLY1305;
+        memcpy(pInfo->chacha.key, key, keyLen);
+        memcpy(pInfo->chacha.iv, iv, 12);
+        memcpy(pInfo->chacha.rec_seq, seq, 8);
+        infoLen = sizeof(pInfo->chacha);
+        break;
+#endif
+    }
+    OPENSSL_cleanse(key, sizeof(key));
+    OPENSSL_cleanse(iv, sizeof(iv));
+    return infoLen;
+}
+
+#endif //LS_SSL_KTLS
+
+
+int SslConnection::enableKtlsTx()
+{
+#ifdef LS_SSL_KTLS
+    if (!s_iKtlsTx || isKtlsTx() || m_iStatus != CONNECTED
+        || !SSL_is_server(m_ssl))
+        return 0;
+    //records already produced in user space must reach the socket first.
+    if (wpending() > 0)
+    {
+        releaseKtlsSecret();
+        return 0;
+    }
+    KtlsCryptoInfo info;
+    int infoLen = buildKtlsTxInfo(m_ssl, m_pKtlsSecret, &info);
+    releaseKtlsSecret();
+    if (infoLen <= 0)
+    {
+        DEBUG_MESSAGE("[SSL: %p] kTLS: cipher %s not supported.\n", this,
+                      getCipherName());
+        return 0;
+    }
+    int fd = SSL_get_fd(m_ssl);
+    int ret = setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls"));
+    if (ret == 0)
+        ret = setsockopt(fd, SOL_TLS, TLS_TX, &info, infoLen);
+    else if (errno == ENOENT || errno == ENOPROTOOPT)
+    {
+        LS_NOTICE("[SSL] kernel TLS is not available: %s, "
+                  "kTLS is disabled.", strerror(errno));
+        s_iKtlsTx = 0;
+    }
+    OPENSSL_cleanse(&info, sizeof(info));
+    if (ret != 0)
+    {
+        DEBUG_MESSAGE("[SSL: %p] kTLS: failed to enable TX: %s\n", this,
+                      strerror(errno));
+        return 0;
+    }
+    DEBUG_MESSAGE("[SSL: %p] kTLS TX enabled, cipher: %s\n", this,
+                  getCipherName());
+    m_bio.m_flag |= LS_FDBIO_KTLS_TX;
+    setFlag(F_KTLS_TX, 1);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+
+int SslConnection::sendKtlsCloseNotify()
+{
+#ifdef LS_SSL_KTLS
+    static const char s_alert[2] = { 1, 0 };   //warning, close_notify
+    char cbuf[CMSG_SPACE(sizeof(unsigned char))];
+    struct iovec iov;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(cbuf, 0, sizeof(cbuf));
+    iov.iov_base = (void *)s_alert;
+    iov.iov_len = sizeof(s_alert);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_TLS;
+    cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+    *CMSG_DATA(cmsg) = 21;                      //alert
+    return sendmsg(SSL_get_fd(m_ssl), &msg, MSG_DONTWAIT);
+#else
+    return 0;
+#endif
+}
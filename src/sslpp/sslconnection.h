@@ -39,6 +39,7 @@ public:
         F_ASYNC_CERT        = 4,
         F_ASYNC_PK          = 8,
         F_ASYNC_CERT_FAIL   = 16,
+        F_KTLS_TX           = 32,
     };
 
     char wantRead() const   {   return m_iWant & WANT_READ;     }
@@ -129,6 +130,23 @@ public:
 
     void releaseIdleBuffer();
 
+    /**
+     * Hand the TX direction of an established server connection to kernel
+     * TLS, plain text written to the socket is then encrypted by the
+     * kernel, which makes sendfile() usable for HTTPS.
+     * @return 1 if kTLS TX is active, 0 if the connection stays in user
+     * space (disabled, unsupported cipher/kernel, pending data).
+     */
+    int  enableKtlsTx();
+    bool isKtlsTx() const       {   return m_flag & F_KTLS_TX;      }
+
+    static void setKtlsTxEnabled(int enable)    {   s_iKtlsTx = enable; }
+    static int  isKtlsTxEnabled()               {   return s_iKtlsTx;   }
+    static void ktlsKeylogCb(const SSL *ssl, const char *line);
+    static int  ktlsExpandLabel(const EVP_MD *md, const uint8_t *secret,
+                                int secretLen, const char *label,
+                                uint8_t *out, int outLen);
+
     bool isWaitingAsyncCert() const
     {   return (getFlag(F_ASYNC_CERT | F_ASYNC_CERT_FAIL) == F_ASYNC_CERT); }
     bool wantAsyncCtx(SSL_CTX *&pInput);
@@ -140,7 +158,12 @@ private:
     char    m_iStatus;
     char    m_iWant;
     static int32_t s_iConnIdx;
+    static int32_t s_iKtlsTx;
     ls_fdbio_data m_bio;
+    uint8_t *m_pKtlsSecret;
+
+    int  sendKtlsCloseNotify();
+    void releaseKtlsSecret();
 
     LS_NO_COPY_ASSIGN(SslConnection);
 };
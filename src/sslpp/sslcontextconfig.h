@@ -18,6 +18,8 @@ public:
     AutoStr     m_sCAFile;
     AutoStr     m_sDHParam;
     AutoStr     m_sCaChainFile;
+    AutoStr     m_sCRLFile;
+    AutoStr     m_sCRLPath;
     AutoStr     m_sOcspResponder;
     //AutoStr     m_sOcspCa;
     char        m_iKeyCerts;
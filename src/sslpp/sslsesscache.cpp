@@ -37,6 +37,7 @@
 
 #define shmSslCache "SSLCache"
 #define shmSsl  "SSL"
+#define SSL_SESS_SHARDS 16
 static int s_numNew = 0;
 
 
@@ -99,6 +100,11 @@ int SslSessCache::initShm(int uid, int gid)
     if ((m_pSessStore = pPool->getNamedHash(shmSslCache, 10000,
                         LsShmHash::hash32id, memcmp, LSSHM_FLAG_LRU | LSSHM_FLAG_TID)) != NULL)
     {
+        // new sessions and resumptions from all workers hit this table,
+        // spread them over independently locked shards
+        if (m_pSessStore->setupShards(SSL_SESS_SHARDS) != LS_OK)
+            LS_NOTICE("[SSL_SESS] Failed to shard session cache, "
+                      "using a single table.");
         m_pSessStore->disableAutoLock(); // we will be responsible for the lock
         s_numNew = 0;
         sessionFlush();
@@ -270,6 +276,7 @@ LsShmOffset_t SslSessCache::addSessionEx(LsShmHash *pHash, time_t lruTm,
     if (!(s_numNew % 0x400))
         sessionFlush(); // Will only flush the normal table.
 
+    pHash = pHash->shardOf(pId, idLen);
     pHash->lock();
     iIterOff = pHash->insertIterator( pHash->setParms(&parms, pId, idLen, pData, iDataLen));
     if (iIterOff.m_iOffset != 0)
@@ -302,6 +309,7 @@ int SslSessCache::deleteSession(const char * pId, int len)
 
 int SslSessCache::deleteSessionEx(LsShmHash *pHash, const char * pId, int len)
 {
+    pHash = pHash->shardOf(pId, len);
     pHash->lock();
     int ret = pHash->remove(pId, len);
     pHash->unlock();
@@ -319,18 +327,23 @@ void SslSessCache::unlock(LsShmHash *pHash)
  * getLockedSessionData() will attempt to get the session data from
  * the hash given the id and length.
  *
- * NOTICE: if this function succeeds, the hash table \b must be unlocked
- * afterwards.
+ * NOTICE: if this function succeeds, the hash table returned in pHash
+ * \b must be unlocked afterwards; it is the shard holding the session.
  */
 SslSessData_t *SslSessCache::getLockedSessionData(const unsigned char *id,
         int len, LsShmHash *&pHash)
 {
-    pHash = NULL;
-    SslSessData_t *pObj = getLockedSessionDataEx(m_pSessStore, id, len);
+    pHash = m_pSessStore->shardOf(id, len);
+    SslSessData_t *pObj = getLockedSessionDataEx(pHash, id, len);
     if (pObj)
-        pHash = m_pSessStore;
-    else if (m_pRemoteStore && (pObj = getLockedSessionDataEx(m_pRemoteStore, id, len)))
-        pHash = m_pRemoteStore;
+        return pObj;
+    pHash = NULL;
+    if (m_pRemoteStore)
+    {
+        LsShmHash *pRemote = m_pRemoteStore->shardOf(id, len);
+        if ((pObj = getLockedSessionDataEx(pRemote, id, len)) != NULL)
+            pHash = pRemote;
+    }
     return pObj;
 }
 
@@ -363,11 +376,18 @@ SslSessData_t *SslSessCache::getLockedSessionDataEx(LsShmHash *pHash,
  */
 int SslSessCache::sessionFlush()
 {
-    int num;
+    int num = 0;
+    int shards = m_pSessStore->getShardCount();
+    LsShmHash *pHash = m_pSessStore;
 
-    m_pSessStore->lock();
-    num = m_pSessStore->trim(DateTime::s_curTime - m_expireSec, NULL, NULL);
-    m_pSessStore->unlock();
+    for (int i = 0; i < (shards ? shards : 1); ++i)
+    {
+        if (shards)
+            pHash = m_pSessStore->getShard(i);
+        pHash->lock();
+        num += pHash->trim(DateTime::s_curTime - m_expireSec, NULL, NULL);
+        pHash->unlock();
+    }
 
     return num;
 }
@@ -379,19 +399,26 @@ int SslSessCache::sessionFlush()
 int SslSessCache::stat()
 {
     LsHashStat stat;
+    int shards = m_pSessStore->getShardCount();
+    LsShmHash *pHash = m_pSessStore;
 
-    // lock
-    m_pSessStore->lock();
-    m_pSessStore->stat(&stat, checkStatElem, m_pSessStore);
     LS_DBG_L("NEWSESSION STATISTIC <%p> " , this);
-    LS_DBG_L("HASH STATISTIC NUM %3d DUP %3d EXPIRED %d IDX [%d %d %d]",
-             stat.num, stat.numDup, stat.numExpired, stat.numIdx,
-             stat.numIdxOccupied, stat.maxLink);
-    LS_DBG_L("HASH STATISTIC TOP %d %d %d %d %d [%d %d %d %d %d]",
-             stat.top[0], stat.top[1], stat.top[2], stat.top[3], stat.top[4],
-             stat.top[5], stat.top[6], stat.top[7], stat.top[8], stat.top[9]);
-    // unlock
-    m_pSessStore->unlock();
+    for (int i = 0; i < (shards ? shards : 1); ++i)
+    {
+        if (shards)
+            pHash = m_pSessStore->getShard(i);
+        // lock
+        pHash->lock();
+        pHash->stat(&stat, checkStatElem, pHash);
+        LS_DBG_L("HASH STATISTIC [%d] NUM %3d DUP %3d EXPIRED %d IDX [%d %d %d]",
+                 i, stat.num, stat.numDup, stat.numExpired, stat.numIdx,
+                 stat.numIdxOccupied, stat.maxLink);
+        LS_DBG_L("HASH STATISTIC TOP %d %d %d %d %d [%d %d %d %d %d]",
+                 stat.top[0], stat.top[1], stat.top[2], stat.top[3], stat.top[4],
+                 stat.top[5], stat.top[6], stat.top[7], stat.top[8], stat.top[9]);
+        // unlock
+        pHash->unlock();
+    }
     return 0;
 }
 
@@ -399,10 +426,20 @@ int SslSessCache::stat()
 uint32_t SslSessCache::getSessCnt() const
 {
     LsHashStat stat;
-    m_pSessStore->lock();
-    m_pSessStore->stat(&stat, checkStatElem, m_pSessStore);
-    m_pSessStore->unlock();
-    return stat.num;
+    uint32_t num = 0;
+    int shards = m_pSessStore->getShardCount();
+    LsShmHash *pHash = m_pSessStore;
+
+    for (int i = 0; i < (shards ? shards : 1); ++i)
+    {
+        if (shards)
+            pHash = m_pSessStore->getShard(i);
+        pHash->lock();
+        pHash->stat(&stat, checkStatElem, pHash);
+        pHash->unlock();
+        num += stat.num;
+    }
+    return num;
 }
 
 
@@ -738,6 +738,8 @@ void SslUtil::initCtx(SSL_CTX *pCtx, int method, char renegProtect)
     }
 #ifdef OPENSSL_IS_BORINGSSL
     //SSL_CTX_set_early_data_enabled(pCtx, 1);
+    if (SslConnection::isKtlsTxEnabled())
+        SSL_CTX_set_keylog_callback(pCtx, SslConnection::ktlsKeylogCb);
 #endif // OPENSSL_IS_BORINGSSL
 
 }
@@ -0,0 +1,275 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "domaintrie.h"
+
+#include <util/autostr.h>
+#include <util/hashstringmap.h>
+
+#include <string.h>
+
+#define DOMAINTRIE_MAX_DEPTH    128
+
+
+class DomainTrieNode
+{
+public:
+    typedef HashStringMap<DomainTrieNode *> Children;
+
+    explicit DomainTrieNode(const char *pLabel)
+        : m_sLabel(pLabel)
+        , m_pObj(NULL)
+        , m_iSeq(0)
+        , m_pChildren(NULL)
+    {}
+
+    ~DomainTrieNode()
+    {
+        if (m_pChildren)
+        {
+            m_pChildren->release_objects();
+            delete m_pChildren;
+        }
+    }
+
+    DomainTrieNode *findChild(const char *pLabel) const
+    {
+        if (!m_pChildren)
+            return NULL;
+        Children::iterator iter = m_pChildren->find(pLabel);
+        if (iter == m_pChildren->end())
+            return NULL;
+        return iter.second();
+    }
+
+    DomainTrieNode *addChild(const char *pLabel)
+    {
+        if (!m_pChildren)
+            m_pChildren = new Children(13, GHash::hfCiString,
+                                       GHash::cmpCiString);
+        DomainTrieNode *pChild = new DomainTrieNode(pLabel);
+        m_pChildren->insert(pChild->m_sLabel.c_str(), pChild);
+        return pChild;
+    }
+
+    void removeChild(DomainTrieNode *pChild)
+    {
+        m_pChildren->remove(pChild->m_sLabel.c_str());
+        delete pChild;
+        if (m_pChildren->size() == 0)
+        {
+            delete m_pChildren;
+            m_pChildren = NULL;
+        }
+    }
+
+    AutoStr2    m_sLabel;
+    void       *m_pObj;
+    int         m_iSeq;
+    Children   *m_pChildren;
+
+    LS_NO_COPY_ASSIGN(DomainTrieNode);
+};
+
+
+/**
+ * Copies the label ending at pEnd into achLabel and returns its start,
+ * NULL if it is too long to be in the trie.
+ */
+static const char *prevLabel(const char *pBegin, const char *pEnd,
+                             char *achLabel)
+{
+    const char *pLabel = pEnd;
+    while ((pLabel > pBegin) && (*(pLabel - 1) != '.'))
+        --pLabel;
+    if (pEnd - pLabel > DOMAINTRIE_MAX_LABEL)
+        return NULL;
+    memmove(achLabel, pLabel, pEnd - pLabel);
+    achLabel[pEnd - pLabel] = 0;
+    return pLabel;
+}
+
+
+DomainTrie::DomainTrie()
+    : m_pRoot(new DomainTrieNode(""))
+    , m_iCount(0)
+{
+}
+
+
+DomainTrie::~DomainTrie()
+{
+    delete m_pRoot;
+}
+
+
+const char *DomainTrie::getSuffix(const char *pPattern)
+{
+    const char *p;
+    int len = 0;
+    if ((*pPattern != '*') || (*(pPattern + 1) != '.'))
+        return NULL;
+    for (p = pPattern + 2; *p; ++p)
+    {
+        switch (*p)
+        {
+        case '*':
+        case '?':
+        case '\\':
+            return NULL;
+        case '.':
+            if (len == 0)
+                return NULL;
+            len = 0;
+            break;
+        default:
+            if (++len > DOMAINTRIE_MAX_LABEL)
+                return NULL;
+        }
+    }
+    if (len == 0)
+        return NULL;
+    return pPattern + 2;
+}
+
+
+int DomainTrie::add(const char *pSuffix, void *pObj, int seq)
+{
+    char achLabel[DOMAINTRIE_MAX_LABEL + 1];
+    DomainTrieNode *pNode = m_pRoot, *pChild;
+    const char *pEnd = pSuffix + strlen(pSuffix);
+    const char *pLabel;
+    while (pEnd > pSuffix)
+    {
+        if ((pLabel = prevLabel(pSuffix, pEnd, achLabel)) == NULL)
+            return LS_FAIL;
+        if ((pChild = pNode->findChild(achLabel)) == NULL)
+            pChild = pNode->addChild(achLabel);
+        pNode = pChild;
+        if (pLabel == pSuffix)
+            break;
+        pEnd = pLabel - 1;
+    }
+    if (pNode == m_pRoot)
+        return LS_FAIL;
+    if (!pNode->m_pObj)
+        ++m_iCount;
+    pNode->m_pObj = pObj;
+    pNode->m_iSeq = seq;
+    return LS_OK;
+}
+
+
+DomainTrieNode *DomainTrie::findNode(const char *pSuffix) const
+{
+    char achLabel[DOMAINTRIE_MAX_LABEL + 1];
+    DomainTrieNode *pNode = m_pRoot;
+    const char *pEnd = pSuffix + strlen(pSuffix);
+    const char *pLabel;
+    while (pEnd > pSuffix)
+    {
+        if (((pLabel = prevLabel(pSuffix, pEnd, achLabel)) == NULL)
+            || ((pNode = pNode->findChild(achLabel)) == NULL))
+            return NULL;
+        if (pLabel == pSuffix)
+            break;
+        pEnd = pLabel - 1;
+    }
+    return pNode;
+}
+
+
+void *DomainTrie::find(const char *pSuffix) const
+{
+    DomainTrieNode *pNode = findNode(pSuffix);
+    if (!pNode)
+        return NULL;
+    return pNode->m_pObj;
+}
+
+
+void *DomainTrie::remove(const char *pSuffix)
+{
+    char achLabel[DOMAINTRIE_MAX_LABEL + 1];
+    DomainTrieNode *path[DOMAINTRIE_MAX_DEPTH];
+    DomainTrieNode *pNode = m_pRoot;
+    const char *pEnd = pSuffix + strlen(pSuffix);
+    const char *pLabel;
+    void *pObj;
+    int depth = 0;
+    while (pEnd > pSuffix)
+    {
+        if ((depth == DOMAINTRIE_MAX_DEPTH)
+            || ((pLabel = prevLabel(pSuffix, pEnd, achLabel)) == NULL)
+            || ((pNode = pNode->findChild(achLabel)) == NULL))
+            return NULL;
+        path[depth++] = pNode;
+        if (pLabel == pSuffix)
+            break;
+        pEnd = pLabel - 1;
+    }
+    if ((depth == 0) || ((pObj = pNode->m_pObj) == NULL))
+        return NULL;
+    pNode->m_pObj = NULL;
+    --m_iCount;
+
+    //drop the branch that no longer leads to any pattern
+    while (depth > 0)
+    {
+        pNode = path[--depth];
+        if (pNode->m_pObj || pNode->m_pChildren)
+            break;
+        ((depth > 0) ? path[depth - 1] : m_pRoot)->removeChild(pNode);
+    }
+    return pObj;
+}
+
+
+void *DomainTrie::match(const char *pHost, const char *pEnd,
+                        int *pSeq) const
+{
+    char achLabel[DOMAINTRIE_MAX_LABEL + 1];
+    const DomainTrieNode *pNode = m_pRoot;
+    const char *pLabel;
+    void *pObj = NULL;
+    if (!pEnd)
+        pEnd = pHost + strlen(pHost);
+    while (pEnd > pHost)
+    {
+        if (((pLabel = prevLabel(pHost, pEnd, achLabel)) == NULL)
+            || ((pNode = pNode->findChild(achLabel)) == NULL))
+            break;
+        //"*." needs the dot in front of the suffix
+        if (pNode->m_pObj && (pLabel > pHost) && (pNode->m_iSeq < *pSeq))
+        {
+            pObj = pNode->m_pObj;
+            *pSeq = pNode->m_iSeq;
+        }
+        if (pLabel == pHost)
+            break;
+        pEnd = pLabel - 1;
+    }
+    return pObj;
+}
+
+
+void DomainTrie::clear()
+{
+    delete m_pRoot;
+    m_pRoot = new DomainTrieNode("");
+    m_iCount = 0;
+}
@@ -0,0 +1,72 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef DOMAINTRIE_H
+#define DOMAINTRIE_H
+
+#include <lsdef.h>
+
+#define DOMAINTRIE_MAX_LABEL    255
+
+class DomainTrieNode;
+
+/**
+ * Index of "*.suffix" domain patterns as a trie over the reversed DNS
+ * labels of the suffix, "*.shop.example.com" is stored under
+ * com -> example -> shop. A lookup walks the labels of the host name from
+ * the right, so it costs one hash probe per label no matter how many
+ * patterns there are. Labels compare case-insensitively.
+ *
+ * Every pattern carries a sequence number. When several patterns match,
+ * the one with the lowest number wins, which lets a caller keep the "first
+ * match in configuration order" rule of a linear wildcard list.
+ */
+class DomainTrie
+{
+public:
+    DomainTrie();
+    ~DomainTrie();
+
+    /**
+     * Returns the suffix part of pPattern if it is a plain "*.suffix"
+     * pattern the trie can hold, NULL for any other wildcard pattern.
+     */
+    static const char *getSuffix(const char *pPattern);
+
+    int add(const char *pSuffix, void *pObj, int seq);
+    void *remove(const char *pSuffix);
+    void *find(const char *pSuffix) const;
+
+    /**
+     * Finds the pattern with the lowest sequence number below *pSeq that
+     * matches the host name, *pSeq is updated to its sequence number.
+     */
+    void *match(const char *pHost, const char *pEnd, int *pSeq) const;
+
+    void clear();
+    int getCount() const            {   return m_iCount;    }
+
+private:
+    DomainTrieNode *findNode(const char *pSuffix) const;
+
+    DomainTrieNode *m_pRoot;
+    int             m_iCount;
+
+    LS_NO_COPY_ASSIGN(DomainTrie);
+};
+
+#endif //DOMAINTRIE_H
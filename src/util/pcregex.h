@@ -98,6 +98,8 @@ public:
 
     int  getSubStrCount() const  {   return substr;   }
 
+    const char *getPattern() const  {   return pattern;  }
+
 
 
     LS_NO_COPY_ASSIGN(Pcregex);
@@ -123,6 +123,16 @@ int PCUtil::setCpuAffinity(cpu_set_t *mask)
     return 0;
 }
 
+int PCUtil::getFirstCpu(const cpu_set_t *mask)
+{
+#if defined(linux) || defined(__linux) || defined(__linux__)
+    for (int i = 0; i < CPU_SETSIZE; ++i)
+        if (CPU_ISSET(i, mask))
+            return i;
+#endif
+    return -1;
+}
+
 void PCUtil::setCpuAffinityAll()
 {
     if (s_nCpu < 0)
@@ -66,6 +66,7 @@ public:
     static void getAffinityMask(int iCpuCount, int iProcessNum,
                                 int iNumCoresToUse, cpu_set_t *_mask);
     static int setCpuAffinity(cpu_set_t *mask);
+    static int getFirstCpu(const cpu_set_t *mask);
     static void setCpuAffinityAll();
 
 private:
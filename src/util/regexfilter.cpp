@@ -0,0 +1,358 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include "regexfilter.h"
+
+#include <lsdef.h>
+#include <util/aho.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+RegexFilter::RegexFilter()
+    : m_pAho(NULL)
+    , m_pIds(NULL)
+    , m_iCount(0)
+{}
+
+
+RegexFilter::~RegexFilter()
+{
+    release();
+}
+
+
+void RegexFilter::release()
+{
+    if (m_pAho)
+    {
+        delete m_pAho;
+        m_pAho = NULL;
+    }
+    if (m_pIds)
+    {
+        free(m_pIds);
+        m_pIds = NULL;
+    }
+    m_iCount = 0;
+}
+
+
+static void endRun(const char *pRun, int runLen, char *pBuf, int &bestLen)
+{
+    if (runLen > bestLen)
+    {
+        memmove(pBuf, pRun, runLen);
+        bestLen = runLen;
+    }
+}
+
+
+//returns the end of the "[...]" class at p, NULL if not terminated
+static const char *skipClass(const char *p)
+{
+    ++p;
+    if (*p == '^')
+        ++p;
+    if (*p == ']')
+        ++p;
+    while (*p && *p != ']')
+    {
+        if (*p == '\\' && p[1])
+            ++p;
+        else if (*p == '[' && p[1] == ':')
+        {
+            const char *pEnd = strstr(p + 2, ":]");
+            if (pEnd)
+                p = pEnd + 1;
+        }
+        ++p;
+    }
+    return (*p == ']') ? p + 1 : NULL;
+}
+
+
+//returns the end of the "(...)" group at p, NULL if not terminated or
+//if it turns on extended mode
+static const char *skipGroup(const char *p)
+{
+    int depth = 0;
+    if (p[1] == '?')
+    {
+        if (p[2] == '#')
+        {
+            p = strchr(p, ')');
+            return p ? p + 1 : NULL;
+        }
+        for (const char *pOpt = p + 2; isalpha(*pOpt) || *pOpt == '-'; ++pOpt)
+        {
+            if (*pOpt == '-')
+                break;
+            if (*pOpt == 'x')
+                return NULL;
+        }
+    }
+    while (*p)
+    {
+        switch (*p)
+        {
+        case '\\':
+            if (!*++p)
+                return NULL;
+            break;
+        case '[':
+            p = skipClass(p);
+            if (!p)
+                return NULL;
+            continue;
+        case '(':
+            ++depth;
+            break;
+        case ')':
+            if (--depth == 0)
+                return p + 1;
+            break;
+        }
+        ++p;
+    }
+    return NULL;
+}
+
+
+/**
+ * Finds the longest literal that every match of a pattern has to contain,
+ * lowercased into pBuf. Only top level literals are considered, groups,
+ * classes and quantified characters end a literal. Returns the length, 0 if
+ * the pattern has no usable literal, or uses a construct not understood
+ * here; such a pattern is run against every subject.
+ */
+int RegexFilter::getRequiredLiteral(const char *pPattern, char *pBuf,
+                                    int bufLen)
+{
+    char achRun[REGEX_FILTER_MAX_LITERAL_LEN];
+    int runLen = 0;
+    int bestLen = 0;
+    const char *p = pPattern;
+    if (bufLen > (int)sizeof(achRun))
+        bufLen = sizeof(achRun);
+    while (*p)
+    {
+        int literal = -1;
+        switch (*p)
+        {
+        case '\\':
+            if (!p[1])
+                return 0;
+            if (isalnum(p[1]))
+            {
+                //single character classes and assertions, anything else
+                //like back references, \x.., \Q...\E is not worth it
+                if (!strchr("dDwWsShHvVRNXbBAzZGntrfea", p[1]))
+                    return 0;
+            }
+            else
+                literal = (unsigned char)p[1];
+            p += 2;
+            break;
+        case '[':
+            p = skipClass(p);
+            if (!p)
+                return 0;
+            break;
+        case '(':
+            p = skipGroup(p);
+            if (!p)
+                return 0;
+            break;
+        case ')':
+        case '|':
+            return 0;
+        case '.':
+        case '^':
+        case '$':
+        case ' ':
+        case '\t':
+        case '#':
+            ++p;
+            break;
+        default:
+            if (!(*p & 0x80))
+                literal = (unsigned char)*p;
+            ++p;
+            break;
+        }
+        if (literal != -1 && runLen < bufLen)
+            achRun[runLen++] = tolower(literal);
+        else if (literal == -1)
+        {
+            endRun(achRun, runLen, pBuf, bestLen);
+            runLen = 0;
+        }
+        if (*p == '?' || *p == '*' || *p == '+' || *p == '{')
+        {
+            //the quantified character is optional unless it is "+"
+            if (literal != -1 && *p != '+' && runLen > 0)
+                --runLen;
+            endRun(achRun, runLen, pBuf, bestLen);
+            runLen = 0;
+            if (*p == '{')
+            {
+                p = strchr(p, '}');
+                if (!p)
+                    return 0;
+            }
+            ++p;
+            if (*p == '?' || *p == '+')
+                ++p;
+        }
+    }
+    endRun(achRun, runLen, pBuf, bestLen);
+    if (bestLen < REGEX_FILTER_MIN_LITERAL_LEN)
+        return 0;
+    return bestLen;
+}
+
+
+
+
+/**
+ * Compiles the literals required by the patterns into one Aho-Corasick
+ * automaton, so a single pass over the subject tells which patterns cannot
+ * match. A literal containing another one is replaced by the shorter one,
+ * which keeps the literal set free of substrings; the automaton then
+ * reports every literal in the subject without following output links.
+ * NULL patterns are never filtered. Returns the number of literals.
+ */
+int RegexFilter::build(const char *const *pPatterns, int count)
+{
+    typedef struct
+    {
+        int     m_index;
+        int     m_len;
+        char    m_achLiteral[REGEX_FILTER_MAX_LITERAL_LEN + 1];
+    } pattern_literal_t;
+
+    release();
+    if (count <= 0)
+        return 0;
+    m_pIds = (int *)malloc(count * sizeof(int));
+    pattern_literal_t *pLiterals = (pattern_literal_t *)malloc(
+                                       count * sizeof(pattern_literal_t));
+    pattern_literal_t **pSorted = (pattern_literal_t **)malloc(
+                                      count * sizeof(pattern_literal_t *));
+    int *pIds = (int *)malloc(count * sizeof(int));
+    if (!m_pIds || !pLiterals || !pSorted || !pIds)
+    {
+        free(pLiterals);
+        free(pSorted);
+        free(pIds);
+        release();
+        return LS_FAIL;
+    }
+    m_iCount = count;
+    int n = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        m_pIds[i] = -1;
+        if (!pPatterns[i])
+            continue;
+        pattern_literal_t *pLit = &pLiterals[n];
+        pLit->m_index = i;
+        pLit->m_len = getRequiredLiteral(pPatterns[i], pLit->m_achLiteral,
+                                         REGEX_FILTER_MAX_LITERAL_LEN);
+        if (pLit->m_len <= 0)
+            continue;
+        pLit->m_achLiteral[pLit->m_len] = 0;
+        //insertion sort by length, shortest first
+        int j = n++;
+        while (j > 0 && pSorted[j - 1]->m_len > pLit->m_len)
+        {
+            pSorted[j] = pSorted[j - 1];
+            --j;
+        }
+        pSorted[j] = pLit;
+    }
+
+    Aho *pAho = NULL;
+    int literals = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        pattern_literal_t *pLit = pSorted[i];
+        int id = -1;
+        for (int j = 0; j < i; ++j)
+        {
+            if (pIds[j] != -1
+                && strstr(pLit->m_achLiteral, pSorted[j]->m_achLiteral))
+            {
+                id = pIds[j];
+                break;
+            }
+        }
+        if (id == -1 && literals < REGEX_FILTER_MAX_LITERALS)
+        {
+            if (!pAho)
+                pAho = new Aho(0);
+            if (pAho && pAho->addPattern(pLit->m_achLiteral, pLit->m_len,
+                                         (void *)(long)(literals + 1)))
+                id = literals++;
+        }
+        pIds[i] = id;
+    }
+    if (pAho && (!literals || !pAho->makeTree()))
+    {
+        delete pAho;
+        pAho = NULL;
+        literals = 0;
+    }
+    if (pAho)
+    {
+        m_pAho = pAho;
+        for (int i = 0; i < n; ++i)
+            m_pIds[pSorted[i]->m_index] = pIds[i];
+    }
+    free(pLiterals);
+    free(pSorted);
+    free(pIds);
+    return literals;
+}
+
+
+/**
+ * Sets the bit of every literal found in the subject, pSeen must hold
+ * REGEX_FILTER_MAX_LITERALS bits.
+ */
+void RegexFilter::scan(const char *pStr, int len, unsigned char *pSeen) const
+{
+    AhoState *pState = NULL;
+    size_t pos = 0;
+    size_t start, end;
+    void *pCtx;
+    memset(pSeen, 0, REGEX_FILTER_MAX_LITERALS / 8);
+    if (!m_pAho)
+        return;
+    while (pos < (size_t)len
+           && m_pAho->search(pState, pStr, len, pos, &start, &end,
+                             &pState, &pCtx))
+    {
+        int id = (long)pCtx - 1;
+        pSeen[id >> 3] |= 1 << (id & 7);
+        pos = end;
+    }
+}
+
@@ -0,0 +1,73 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef REGEXFILTER_H
+#define REGEXFILTER_H
+
+#include <stddef.h>
+
+
+//distinct literals a filter tracks, patterns beyond are always tried
+#define REGEX_FILTER_MAX_LITERALS       256
+#define REGEX_FILTER_MAX_LITERAL_LEN    64
+#define REGEX_FILTER_MIN_LITERAL_LEN    2
+
+class Aho;
+
+/**
+ * Rules out, in one scan of the subject, the regular expressions of an
+ * ordered set that cannot match it, by looking for the literal each one
+ * requires. Patterns that survive still have to be run, in set order.
+ */
+class RegexFilter
+{
+public:
+    RegexFilter();
+    ~RegexFilter();
+
+    int  build(const char *const *pPatterns, int count);
+    void release();
+    int  hasLiterals() const        {   return m_pAho != NULL;  }
+    int  getCount() const           {   return m_iCount;        }
+    int  getLiteralId(int i) const
+    {   return (m_pIds && i < m_iCount) ? m_pIds[i] : -1;   }
+
+    void scan(const char *pStr, int len, unsigned char *pSeen) const;
+
+    static int isSeen(int id, const unsigned char *pSeen)
+    {   return pSeen[id >> 3] & (1 << (id & 7));    }
+
+    //0 if the pattern at index i cannot match the scanned subject
+    int  mayMatch(int i, const unsigned char *pSeen) const
+    {
+        int id = getLiteralId(i);
+        return id == -1 || isSeen(id, pSeen);
+    }
+
+    static int getRequiredLiteral(const char *pPattern, char *pBuf,
+                                  int bufLen);
+
+private:
+    Aho    *m_pAho;
+    int    *m_pIds;
+    int     m_iCount;
+
+    RegexFilter(const RegexFilter &rhs);
+    void operator=(const RegexFilter &rhs);
+};
+
+#endif // REGEXFILTER_H
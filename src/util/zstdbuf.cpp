@@ -0,0 +1,235 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#include <util/zstdbuf.h>
+
+#ifdef USE_ZSTD
+
+#include <util/vmembuf.h>
+
+#include <assert.h>
+#include <string.h>
+
+
+ZstdBuf::ZstdBuf()
+    : m_pCCtx(NULL)
+    , m_iTotalIn(0)
+    , m_iRemain(0)
+    , m_iLastError(0)
+{
+    memset(&m_in, 0, sizeof(m_in));
+    memset(&m_out, 0, sizeof(m_out));
+}
+
+
+ZstdBuf::ZstdBuf(int type, int level)
+    : m_pCCtx(NULL)
+    , m_iTotalIn(0)
+    , m_iRemain(0)
+    , m_iLastError(0)
+{
+    memset(&m_in, 0, sizeof(m_in));
+    memset(&m_out, 0, sizeof(m_out));
+    init(type, level);
+}
+
+
+ZstdBuf::~ZstdBuf()
+{
+    release();
+}
+
+
+int ZstdBuf::release()
+{
+    if (m_iType == COMPRESSOR_DECOMPRESS)
+        ZSTD_freeDCtx(m_pDCtx);
+    else
+        ZSTD_freeCCtx(m_pCCtx);
+    m_pCCtx = NULL;
+    return 0;
+}
+
+
+int ZstdBuf::init(int type, int level)
+{
+    if (type != COMPRESSOR_DECOMPRESS)
+        type = COMPRESSOR_COMPRESS;
+    if ((m_pCCtx != NULL) && (type != m_iType))
+        release();
+    m_iType = type;
+    m_iTotalIn = 0;
+    m_iLastFlush = 0;
+    m_iRemain = 0;
+    if (m_iType == COMPRESSOR_COMPRESS)
+    {
+        if (!m_pCCtx)
+            m_pCCtx = ZSTD_createCCtx();
+        else
+            ZSTD_CCtx_reset(m_pCCtx, ZSTD_reset_session_only);
+        if (!m_pCCtx)
+            return LS_FAIL;
+        m_iLastError = ZSTD_CCtx_setParameter(m_pCCtx,
+                                              ZSTD_c_compressionLevel, level);
+    }
+    else
+    {
+        if (!m_pDCtx)
+            m_pDCtx = ZSTD_createDCtx();
+        else
+            ZSTD_DCtx_reset(m_pDCtx, ZSTD_reset_session_only);
+        if (!m_pDCtx)
+            return LS_FAIL;
+        m_iLastError = 0;
+    }
+    return (ZSTD_isError(m_iLastError) ? LS_FAIL : LS_OK);
+}
+
+
+int ZstdBuf::reinit()
+{
+    int ret = reset();
+    m_iStreamStarted = 1;
+    return ret;
+}
+
+
+int ZstdBuf::reset()
+{
+    if (!m_pCCtx)
+        return LS_FAIL;
+    m_iTotalIn = 0;
+    m_iLastFlush = 0;
+    m_iRemain = 0;
+    if (m_iType == COMPRESSOR_COMPRESS)
+        m_iLastError = ZSTD_CCtx_reset(m_pCCtx, ZSTD_reset_session_only);
+    else
+        m_iLastError = ZSTD_DCtx_reset(m_pDCtx, ZSTD_reset_session_only);
+    return (ZSTD_isError(m_iLastError) ? LS_FAIL : LS_OK);
+}
+
+
+int ZstdBuf::beginStream()
+{
+    if (!m_pCompressCache)
+        return LS_FAIL;
+    size_t size;
+
+    m_in.src = NULL;
+    m_in.size = m_in.pos = 0;
+
+    m_out.dst = m_pCompressCache->getWriteBuffer(size);
+    m_out.size = size;
+    m_out.pos = 0;
+    if (!m_out.dst)
+        return LS_FAIL;
+    m_iStreamStarted = 1;
+    return 0;
+}
+
+
+int ZstdBuf::compress(const char *pBuf, int len)
+{
+    if (!m_iStreamStarted)
+        return LS_FAIL;
+    m_in.src = pBuf;
+    m_in.size = len;
+    m_in.pos = 0;
+    m_iTotalIn += len;
+    return process(ZSTD_e_continue);
+}
+
+
+//Returns 0 once a flush/end directive has been completed, or the frame
+//being decompressed is finished, 1 if more is left in zstd.
+int ZstdBuf::process(ZSTD_EndDirective op)
+{
+    size_t ret;
+    size_t size;
+    do
+    {
+        if (m_out.pos >= m_out.size)
+        {
+            m_out.dst = m_pCompressCache->getWriteBuffer(size);
+            m_out.size = size;
+            m_out.pos = 0;
+            if (!m_out.dst)
+                return LS_FAIL;
+        }
+        if (m_iType == COMPRESSOR_COMPRESS)
+            ret = ZSTD_compressStream2(m_pCCtx, &m_out, &m_in, op);
+        else
+            ret = ZSTD_decompressStream(m_pDCtx, &m_out, &m_in);
+        if (ZSTD_isError(ret))
+        {
+            m_iLastError = ret;
+            return LS_FAIL;
+        }
+        m_iRemain = ret;
+        m_pCompressCache->writeUsed((char *)m_out.dst + m_out.pos
+                                    - m_pCompressCache->getCurWPos());
+        //ret == 0: the frame or the flush is complete and nothing is left
+        //in zstd, calling again may start a new frame.
+        if ((m_iType == COMPRESSOR_DECOMPRESS) || (op == ZSTD_e_continue))
+        {
+            if ((m_in.pos >= m_in.size)
+                && ((ret == 0) || (m_out.pos < m_out.size)))
+                return (ret != 0);
+        }
+        else if (ret == 0)
+            return 0;
+    }
+    while (true);
+}
+
+
+int ZstdBuf::endStream()
+{
+    int ret;
+    if (m_iType == COMPRESSOR_COMPRESS)
+        ret = process(ZSTD_e_end);
+    else    //all input has been decoded by write()
+        ret = (m_iRemain != 0);
+    m_iStreamStarted = 0;
+    if (ret != 0)
+        return LS_FAIL;
+    return 0;
+}
+
+
+int ZstdBuf::resetCompressCache()
+{
+    m_pCompressCache->rewindReadBuf();
+    m_pCompressCache->rewindWriteBuf();
+    size_t size;
+    m_out.dst = m_pCompressCache->getWriteBuffer(size);
+    m_out.size = size;
+    m_out.pos = 0;
+    return 0;
+}
+
+
+const char *ZstdBuf::getLastError() const
+{
+    if (!ZSTD_isError(m_iLastError))
+        return NULL;
+    return ZSTD_getErrorName(m_iLastError);
+}
+
+
+#endif // USE_ZSTD
+
@@ -0,0 +1,75 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifndef ZSTDBUF_H
+#define ZSTDBUF_H
+
+#include <config.h>
+
+#ifdef USE_ZSTD
+#include <lsdef.h>
+#include <util/compressor.h>
+
+#include <zstd.h>
+
+
+class VMemBuf;
+
+class ZstdBuf : public Compressor
+{
+    union {
+        ZSTD_CCtx  *m_pCCtx;
+        ZSTD_DCtx  *m_pDCtx;
+    };
+    ZSTD_inBuffer   m_in;
+    ZSTD_outBuffer  m_out;
+    uint32_t        m_iTotalIn;
+    size_t          m_iRemain;
+    size_t          m_iLastError;
+
+    int process(ZSTD_EndDirective op);
+    int compress(const char *pBuf, int len);
+
+public:
+    ZstdBuf();
+    ~ZstdBuf();
+
+    explicit ZstdBuf(int type, int level);
+
+    int init(int type, int level);
+    int reinit();
+    int beginStream();
+    int write(const char *pBuf, int len)
+    {   return (compress(pBuf, len) < 0) ? -1 : len;  }
+    int shouldFlush()
+    {   return m_iTotalIn - m_iLastFlush > m_iFlushWindowSize;  }
+    int flush()
+    {   m_iLastFlush = m_iTotalIn; return process(ZSTD_e_flush);  }
+    int endStream();
+    int reset();
+
+    int release();
+
+    int resetCompressCache();
+    const char *getLastError() const;
+
+    LS_NO_COPY_ASSIGN(ZstdBuf);
+};
+
+#endif // USE_ZSTD
+
+#endif
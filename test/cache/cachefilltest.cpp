@@ -0,0 +1,215 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <modules/cache/cachefillqueue.h>
+#include <modules/cache/shmcachemanager.h>
+#include <util/datetime.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "unittest-cpp/UnitTest++.h"
+
+static const char *g_pFillDir = "/tmp/cachefilltest";
+
+#define MAX_WOKEN   8
+static FillWaiter *s_woken[MAX_WOKEN];
+static int s_iWoken = 0;
+
+static void onWake(FillWaiter *pWaiter)
+{
+    if (s_iWoken < MAX_WOKEN)
+        s_woken[s_iWoken++] = pWaiter;
+}
+
+
+static ShmCacheManager *openManager()
+{
+    char achCmd[256];
+    snprintf(achCmd, sizeof(achCmd), "rm -rf %s", g_pFillDir);
+    system(achCmd);
+    mkdir(g_pFillDir, 0700);
+    DateTime::s_curTime = time(NULL);
+
+    ShmCacheManager *pManager = new ShmCacheManager();
+    if (pManager->init(g_pFillDir) != 0)
+    {
+        delete pManager;
+        return NULL;
+    }
+    return pManager;
+}
+
+
+static void closeManager(ShmCacheManager *pManager)
+{
+    char achCmd[256];
+    delete pManager;
+    snprintf(achCmd, sizeof(achCmd), "rm -rf %s", g_pFillDir);
+    system(achCmd);
+}
+
+
+static CacheHash makeHash(uint64_t key)
+{
+    CacheHash hash;
+    hash.setKey(key);
+    return hash;
+}
+
+
+TEST(CacheFillTest_claim)
+{
+    ShmCacheManager *pManager = openManager();
+    CHECK(pManager != NULL);
+    if (!pManager)
+        return;
+    CacheHash h1 = makeHash(0x1111111111111111ULL);
+    CacheHash h2 = makeHash(0x2222222222222222ULL);
+    int32_t tmExpire = DateTime::s_curTime + 5;
+
+    CHECK(pManager->isFilling(h1) == 0);
+    CHECK(pManager->beginFill(h1, tmExpire) == 1);
+    CHECK(pManager->isFilling(h1) == 1);
+    CHECK(pManager->isFilling(h2) == 0);
+
+    //a second miss for the same entry waits
+    CHECK(pManager->beginFill(h1, tmExpire) == 0);
+    CHECK(pManager->beginFill(h2, tmExpire) == 1);
+
+    pManager->endFill(h1);
+    CHECK(pManager->isFilling(h1) == 0);
+    CHECK(pManager->isFilling(h2) == 1);
+    CHECK(pManager->beginFill(h1, tmExpire) == 1);
+    closeManager(pManager);
+}
+
+
+TEST(CacheFillTest_fillerTimeout)
+{
+    ShmCacheManager *pManager = openManager();
+    CHECK(pManager != NULL);
+    if (!pManager)
+        return;
+    CacheHash h1 = makeHash(0x3333333333333333ULL);
+
+    //the leader did not finish in time, the next miss takes over
+    CHECK(pManager->beginFill(h1, DateTime::s_curTime - 1) == 1);
+    CHECK(pManager->isFilling(h1) == 0);
+    CHECK(pManager->beginFill(h1, DateTime::s_curTime + 5) == 1);
+    CHECK(pManager->isFilling(h1) == 1);
+    closeManager(pManager);
+}
+
+
+TEST(CacheFillTest_fillerAbort)
+{
+    ShmCacheManager *pManager = openManager();
+    CHECK(pManager != NULL);
+    if (!pManager)
+        return;
+    CacheHash h1 = makeHash(0x4444444444444444ULL);
+
+    //a worker claims the fill and dies without ending it
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(pManager->beginFill(h1, DateTime::s_curTime + 60) == 1 ? 0 : 1);
+    CHECK(pid > 0);
+    int status = -1;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    CHECK(pManager->isFilling(h1) == 0);
+    CHECK(pManager->beginFill(h1, DateTime::s_curTime + 5) == 1);
+    closeManager(pManager);
+}
+
+
+TEST(CacheFillTest_waiterTimeout)
+{
+    ShmCacheManager *pManager = openManager();
+    CHECK(pManager != NULL);
+    if (!pManager)
+        return;
+    CacheHash h1 = makeHash(0x5555555555555555ULL);
+    CHECK(pManager->beginFill(h1, DateTime::s_curTime + 5) == 1);
+
+    CacheFillQueue queue;
+    FillWaiter *pWaiter = queue.add(NULL, pManager, h1, 10000);
+    CHECK(queue.size() == 1);
+
+    //still filling and not due, the poll leaves it parked
+    s_iWoken = 0;
+    CHECK(queue.wake(NULL, 9999, onWake) == 0);
+    CHECK(s_iWoken == 0);
+
+    //the wait ran out, it goes to the backend itself
+    CHECK(queue.wake(NULL, 10000, onWake) == 1);
+    CHECK(s_iWoken == 1 && s_woken[0] == pWaiter);
+    CHECK(pWaiter->woken == 1);
+
+    //woken once only, it stays queued until the session removes it
+    CHECK(queue.wake(NULL, 20000, onWake) == 0);
+    CHECK(queue.wake(&h1, 20000, onWake) == 0);
+    CHECK(queue.size() == 1);
+    queue.remove(pWaiter);
+    CHECK(queue.size() == 0);
+    closeManager(pManager);
+}
+
+
+TEST(CacheFillTest_resume)
+{
+    ShmCacheManager *pManager = openManager();
+    CHECK(pManager != NULL);
+    if (!pManager)
+        return;
+    CacheHash h1 = makeHash(0x6666666666666666ULL);
+    CacheHash h2 = makeHash(0x7777777777777777ULL);
+    CHECK(pManager->beginFill(h1, DateTime::s_curTime + 5) == 1);
+    CHECK(pManager->beginFill(h2, DateTime::s_curTime + 5) == 1);
+
+    CacheFillQueue queue;
+    FillWaiter *pW1 = queue.add(NULL, pManager, h1, 10000);
+    FillWaiter *pW2 = queue.add(NULL, pManager, h2, 10000);
+    FillWaiter *pW3 = queue.add(NULL, pManager, h1, 10000);
+
+    //the leader in this worker published h1
+    pManager->endFill(h1);
+    s_iWoken = 0;
+    CHECK(queue.wake(&h1, 0, onWake) == 2);
+    CHECK(s_iWoken == 2 && s_woken[0] == pW1 && s_woken[1] == pW3);
+    CHECK(pW2->woken == 0);
+
+    //the leader of h2 in another worker ended, found by the poll
+    CHECK(queue.wake(NULL, 0, onWake) == 0);
+    pManager->endFill(h2);
+    CHECK(queue.wake(NULL, 0, onWake) == 1);
+    CHECK(s_iWoken == 3 && s_woken[2] == pW2);
+
+    queue.remove(pW1);
+    queue.remove(pW3);
+    CHECK(queue.size() == 1);
+    closeManager(pManager);
+}
+
+#endif
@@ -0,0 +1,216 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <modules/cache/cacheentry.h>
+#include <modules/cache/cachehottier.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+class HotTestEntry : public CacheEntry
+{
+public:
+    explicit HotTestEntry(uint64_t key)
+    {
+        CacheHash hash;
+        hash.setKey(key);
+        setHashKey(hash);
+    }
+    int loadCeHeader()                  {   return 0;   }
+    int saveCeHeader()                  {   return 0;   }
+    int allocate(int size)              {   return 0;   }
+    int releaseTmpResource()            {   return 0;   }
+    int saveRespHeaders(HttpRespHeaders *pHeader)   {   return 0;   }
+};
+
+
+static void accessTimes(CacheHotTier &tier, uint64_t key, int times)
+{
+    for (int i = 0; i < times; ++i)
+        tier.recordAccess(key);
+}
+
+
+TEST(CacheHotTierTest_sketch)
+{
+    CacheHotTier tier;
+    CHECK(tier.estimate(1) == 0);
+    tier.setLimits(1024 * 1024, 64 * 1024);
+    CHECK(tier.isEnabled());
+
+    uint64_t key = 0x1234567890abcdefULL;
+    CHECK(tier.estimate(key) == 0);
+    accessTimes(tier, key, 5);
+    CHECK(tier.estimate(key) == 5);
+    CHECK(tier.estimate(key + 1) == 0);
+
+    //counters saturate instead of wrapping
+    accessTimes(tier, key, 100);
+    CHECK(tier.estimate(key) == 16);
+}
+
+
+TEST(CacheHotTierTest_doorkeeper)
+{
+    CacheHotTier tier;
+    tier.setLimits(1024 * 1024, 64 * 1024);
+
+    //the first access only sets the doorkeeper bit
+    uint64_t key = 0x0badc0ffee0ddf00ULL;
+    tier.recordAccess(key);
+    CHECK(tier.estimate(key) == 1);
+
+    //a one-hit key is not admitted
+    HotTestEntry entry(key);
+    CHECK(tier.admit(&entry, 0, 100) == NULL);
+    CHECK(tier.getCount() == 0);
+}
+
+
+TEST(CacheHotTierTest_aging)
+{
+    //a large tier keeps unrelated keys from sharing counters
+    CacheHotTier tier;
+    tier.setLimits(1024L * 1024 * 1024, 64 * 1024);
+
+    uint64_t hot = 0x5555aaaa5555aaaaULL;
+    accessTimes(tier, hot, 9);
+    CHECK(tier.estimate(hot) == 9);
+
+    //one-hit keys up to the sample limit of 10 x width halve the counters
+    //and clear the doorkeeper
+    for (uint64_t i = 0; i < 10 * (1 << 18); ++i)
+        tier.recordAccess(i * 0x9e3779b97f4a7c15ULL + 1);
+    CHECK(tier.estimate(hot) == 4);
+}
+
+
+TEST(CacheHotTierTest_victims)
+{
+    const char *pPath = "/tmp/cachehottiertest.data";
+    char achData[4000];
+    for (int i = 0; i < (int)sizeof(achData); ++i)
+        achData[i] = 'a' + i % 26;
+    int fd = open(pPath, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd != -1);
+    CHECK(write(fd, achData, sizeof(achData)) == (int)sizeof(achData));
+
+    CacheHotTier tier;
+    tier.setLimits(3000, 1000);
+
+    HotTestEntry a(0x1000000000000001ULL);
+    HotTestEntry b(0x2000000000000002ULL);
+    HotTestEntry c(0x3000000000000003ULL);
+    HotTestEntry d(0x4000000000000004ULL);
+    HotTestEntry *pE = new HotTestEntry(0x5000000000000005ULL);
+
+    //larger than hotCacheMaxObjSize
+    accessTimes(tier, 0x1000000000000001ULL, 2);
+    CHECK(tier.admit(&a, fd, 1001) == NULL);
+
+    const CacheHotData *pData = tier.admit(&a, fd, 1000);
+    CHECK(pData != NULL);
+    CHECK(pData != NULL && memcmp(pData->getBuf(), achData, 1000) == 0);
+    accessTimes(tier, 0x2000000000000002ULL, 2);
+    CHECK(tier.admit(&b, fd, 1000) != NULL);
+    accessTimes(tier, 0x3000000000000003ULL, 2);
+    CHECK(tier.admit(&c, fd, 1000) != NULL);
+    CHECK(tier.getCount() == 3);
+    CHECK(tier.getBytes() == 3000);
+
+    //no more popular than the LRU entry it would evict
+    accessTimes(tier, 0x4000000000000004ULL, 2);
+    CHECK(tier.admit(&d, fd, 1000) == NULL);
+    CHECK(a.getHotData() != NULL);
+
+    //more popular, the LRU entry goes
+    accessTimes(tier, 0x4000000000000004ULL, 2);
+    CHECK(tier.admit(&d, fd, 1000) != NULL);
+    CHECK(a.getHotData() == NULL);
+    CHECK(tier.getCount() == 3);
+
+    //a hit moves the entry to the end of the LRU list, c is evicted next
+    CHECK(tier.get(&b) == b.getHotData());
+    accessTimes(tier, 0x5000000000000005ULL, 5);
+    CHECK(tier.admit(pE, fd, 1000) != NULL);
+    CHECK(b.getHotData() != NULL);
+    CHECK(c.getHotData() == NULL);
+    CHECK(tier.getBytes() == 3000);
+
+    //the copy goes away with its entry
+    delete pE;
+    CHECK(tier.getCount() == 2);
+    CHECK(tier.getBytes() == 2000);
+
+    tier.clear();
+    CHECK(b.getHotData() == NULL);
+    CHECK(d.getHotData() == NULL);
+    close(fd);
+    unlink(pPath);
+}
+
+
+TEST(CacheHotTierTest_setLimits)
+{
+    const char *pPath = "/tmp/cachehottiertest.data";
+    char achData[2000];
+    memset(achData, 'x', sizeof(achData));
+    int fd = open(pPath, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd != -1);
+    CHECK(write(fd, achData, sizeof(achData)) == (int)sizeof(achData));
+
+    CacheHotTier tier;
+    tier.setLimits(4000, 2000);
+
+    HotTestEntry a(0x1000000000000001ULL);
+    HotTestEntry b(0x2000000000000002ULL);
+    HotTestEntry c(0x3000000000000003ULL);
+    accessTimes(tier, 0x1000000000000001ULL, 2);
+    CHECK(tier.admit(&a, fd, 1000) != NULL);
+    accessTimes(tier, 0x2000000000000002ULL, 2);
+    CHECK(tier.admit(&b, fd, 2000) != NULL);
+    accessTimes(tier, 0x3000000000000003ULL, 2);
+    CHECK(tier.admit(&c, fd, 1000) != NULL);
+    CHECK(tier.getBytes() == 4000);
+
+    //a smaller object size limit drops b, the tier fits without touching a
+    tier.setLimits(4000, 1500);
+    CHECK(tier.getCount() == 2);
+    CHECK(tier.getBytes() == 2000);
+    CHECK(b.getHotData() == NULL);
+
+    //a smaller tier drops from the LRU end
+    tier.setLimits(1000, 1000);
+    CHECK(tier.getCount() == 1);
+    CHECK(a.getHotData() == NULL);
+    CHECK(c.getHotData() != NULL);
+
+    //turning the tier off empties it
+    tier.setLimits(0, 0);
+    CHECK(tier.getCount() == 0);
+    CHECK(tier.getBytes() == 0);
+    CHECK(c.getHotData() == NULL);
+    close(fd);
+    unlink(pPath);
+}
+
+#endif
@@ -18,6 +18,324 @@
 #ifdef RUN_TEST
 
 //#include "multiplexertest.h"
+#include <edio/iouring.h>
+
+#ifdef LS_HAS_IO_URING
+
+#include <edio/eventreactor.h>
+#include <lsdef.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "unittest-cpp/UnitTest++.h"
+
+class UringTestReactor : public EventReactor
+{
+public:
+    int     m_iCalls;
+    short   m_iLastEvents;
+    int     m_iDrain;
+
+    explicit UringTestReactor(int fd)
+        : m_iCalls(0)
+        , m_iLastEvents(0)
+        , m_iDrain(0)
+    {   setfd(fd);  }
+
+    int handleEvents(short event)
+    {
+        char buf[64];
+        ++m_iCalls;
+        m_iLastEvents = event;
+        if (!(event & POLLIN))
+            return 0;
+        //like EdStream, read until EAGAIN and clear the event
+        while (m_iDrain && (read(getfd(), buf, sizeof(buf)) > 0))
+            ;
+        if (m_iDrain)
+            resetRevent(POLLIN);
+        else
+            read(getfd(), buf, sizeof(buf));
+        return 0;
+    }
+};
+
+
+TEST(IoUringLevelTriggerTest)
+{
+    if (!IoUring::isSupported())
+        return;
+    IoUring ring;
+    int fds[2];
+    CHECK(ring.init(64) == 0);
+    CHECK(pipe(fds) == 0);
+    UringTestReactor reactor(fds[0]);
+    CHECK(ring.add(&reactor, POLLIN) == 0);
+    CHECK(ring.waitAndProcessEvents(0) == 0);
+
+    write(fds[1], "abc", 3);
+    CHECK(ring.waitAndProcessEvents(100) == 1);
+    CHECK(reactor.m_iCalls == 1);
+    CHECK(reactor.m_iLastEvents & POLLIN);
+    CHECK(ring.waitAndProcessEvents(10) == 0);
+
+    //data left unread must be reported again after re-arm
+    write(fds[1], "abc", 3);
+    ring.suspendRead(&reactor);
+    CHECK(ring.waitAndProcessEvents(10) == 0);
+    ring.continueRead(&reactor);
+    CHECK(ring.waitAndProcessEvents(100) == 1);
+    CHECK(reactor.m_iCalls == 2);
+
+    ring.remove(&reactor);
+    write(fds[1], "x", 1);
+    CHECK(ring.waitAndProcessEvents(10) == 0);
+    CHECK(reactor.m_iCalls == 2);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+
+TEST(IoUringMultishotTest)
+{
+    if (!IoUring::isSupported())
+        return;
+    IoUring ring;
+    char achBuf[200];
+    int fds[2];
+    int i;
+    CHECK(ring.init(64) == 0);
+    CHECK(pipe(fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    UringTestReactor reactor(fds[0]);
+    CHECK(ring.add(&reactor, POLLIN) == 0);
+    memset(achBuf, 'a', sizeof(achBuf));
+
+    //64 bytes per call without reaching EAGAIN: reported until drained
+    write(fds[1], achBuf, sizeof(achBuf));
+    for (i = 0; i < 10; ++i)
+        ring.waitAndProcessEvents(100);
+    CHECK(reactor.m_iCalls == 4);
+
+    //a reactor draining the fd is called once per write, the poll stays
+    //armed in between
+    reactor.m_iDrain = 1;
+    for (i = 0; i < 3; ++i)
+    {
+        write(fds[1], achBuf, sizeof(achBuf));
+        CHECK(ring.waitAndProcessEvents(100) == 1);
+        CHECK(ring.waitAndProcessEvents(10) == 0);
+    }
+    CHECK(reactor.m_iCalls == 7);
+
+    ring.remove(&reactor);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+
+class UringIoReactor : public EventReactor
+{
+public:
+    IoUring    *m_pRing;
+    int         m_iCalls;
+    int         m_iReadSize;
+    int         m_iEof;
+    int         m_iSuspend;
+    int         m_iDataLen;
+    char        m_achData[256];
+
+    UringIoReactor(IoUring *pRing, int fd)
+        : m_pRing(pRing)
+        , m_iCalls(0)
+        , m_iReadSize(64)
+        , m_iEof(0)
+        , m_iSuspend(0)
+        , m_iDataLen(0)
+    {   setfd(fd);  }
+
+    int handleEvents(short event)
+    {
+        ++m_iCalls;
+        if (!(event & POLLIN))
+            return 0;
+        int ret = m_pRing->read(this, m_achData + m_iDataLen, m_iReadSize);
+        if (ret > 0)
+            m_iDataLen += ret;
+        else if (ret == 0)
+            m_iEof = 1;
+        //like NtwkIOLink::checkReadRet()
+        if (ret < m_iReadSize)
+            resetRevent(POLLIN);
+        if (m_iSuspend)
+            m_pRing->suspendRead(this);
+        return 0;
+    }
+};
+
+
+static int pairNonblock(int *fds)
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        return -1;
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    return 0;
+}
+
+
+static int writeStr(IoUring *pRing, EventReactor *pReactor, const char *p)
+{
+    struct iovec iov;
+    iov.iov_base = (void *)p;
+    iov.iov_len = strlen(p);
+    return pRing->writev(pReactor, &iov, 1);
+}
+
+
+TEST(IoUringReadAheadTest)
+{
+    if (!IoUring::isSupported())
+        return;
+    IoUring ring;
+    int fds[2];
+    int calls;
+    CHECK(ring.init(64) == 0);
+    CHECK(pairNonblock(fds) == 0);
+    UringIoReactor reactor(&ring, fds[0]);
+    CHECK(ring.add(&reactor, POLLIN) == 0);
+
+    //the first read goes to the socket, it makes the fd read ahead
+    write(fds[1], "hello", 5);
+    CHECK(ring.waitAndProcessEvents(100) == 1);
+    write(fds[1], "world", 5);
+    CHECK(ring.waitAndProcessEvents(100) == 1);
+    CHECK(reactor.m_iDataLen == 10);
+    CHECK(memcmp(reactor.m_achData, "helloworld", 10) == 0);
+    CHECK(ring.waitAndProcessEvents(10) == 0);
+
+    //what the reactor leaves in the buffer is reported until taken
+    reactor.m_iReadSize = 2;
+    write(fds[1], "abcdef", 6);
+    calls = reactor.m_iCalls;
+    while (ring.waitAndProcessEvents(100) > 0)
+        ;
+    CHECK(reactor.m_iCalls == calls + 3);
+    CHECK(reactor.m_iDataLen == 16);
+    CHECK(memcmp(reactor.m_achData + 10, "abcdef", 6) == 0);
+
+    //not while reading is suspended
+    write(fds[1], "gh", 2);
+    reactor.m_iReadSize = 1;
+    reactor.m_iSuspend = 1;
+    CHECK(ring.waitAndProcessEvents(100) == 1);
+    CHECK(ring.waitAndProcessEvents(10) == 0);
+    reactor.m_iSuspend = 0;
+    ring.continueRead(&reactor);
+    CHECK(ring.waitAndProcessEvents(10) == 1);
+    CHECK(reactor.m_iDataLen == 18);
+    CHECK(memcmp(reactor.m_achData + 16, "gh", 2) == 0);
+
+    shutdown(fds[1], SHUT_WR);
+    reactor.m_iReadSize = 64;
+    ring.waitAndProcessEvents(100);
+    CHECK(reactor.m_iEof == 1);
+
+    ring.remove(&reactor);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+
+TEST(IoUringQueuedWriteTest)
+{
+    if (!IoUring::isSupported())
+        return;
+    IoUring ring;
+    char achBuf[64];
+    int fds[2];
+    CHECK(ring.init(64) == 0);
+    CHECK(pairNonblock(fds) == 0);
+    UringIoReactor reactor(&ring, fds[0]);
+    CHECK(ring.add(&reactor, POLLIN) == 0);
+
+    //queued, written together with the next wait
+    CHECK(writeStr(&ring, &reactor, "abc") == 3);
+    CHECK(writeStr(&ring, &reactor, "def") == 3);
+    CHECK(recv(fds[1], achBuf, sizeof(achBuf), 0) == -1);
+    ring.waitAndProcessEvents(0);
+    CHECK(recv(fds[1], achBuf, sizeof(achBuf), 0) == 6);
+    CHECK(memcmp(achBuf, "abcdef", 6) == 0);
+
+    //sendfile() and the like go after the queue
+    CHECK(writeStr(&ring, &reactor, "gh") == 2);
+    CHECK(ring.flushWrite(&reactor) == LS_OK);
+    CHECK(recv(fds[1], achBuf, sizeof(achBuf), 0) == 2);
+
+    //the shutdown waits for the queue
+    CHECK(writeStr(&ring, &reactor, "xyz") == 3);
+    CHECK(ring.shutdownWrite(&reactor) == 0);
+    CHECK(recv(fds[1], achBuf, sizeof(achBuf), 0) == -1);
+    ring.waitAndProcessEvents(0);
+    CHECK(recv(fds[1], achBuf, sizeof(achBuf), 0) == 3);
+    CHECK(recv(fds[1], achBuf, sizeof(achBuf), 0) == 0);
+
+    ring.remove(&reactor);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+
+TEST(IoUringRemoveWithQueueTest)
+{
+    if (!IoUring::isSupported())
+        return;
+    IoUring ring;
+    char achBuf[4096];
+    char achTail[4] = { 0, 0, 0, 0 };
+    int fds[2];
+    int filled = 0, total = 0, eof = 0, i, j, ret;
+    CHECK(ring.init(64) == 0);
+    CHECK(pairNonblock(fds) == 0);
+    memset(achBuf, 'a', sizeof(achBuf));
+    while ((ret = write(fds[0], achBuf, sizeof(achBuf))) > 0)
+        filled += ret;
+
+    UringIoReactor reactor(&ring, fds[0]);
+    CHECK(ring.add(&reactor, POLLIN) == 0);
+    CHECK(writeStr(&ring, &reactor, "tail") == 4);
+    //the socket is full, the queue is written after it is closed
+    ring.remove(&reactor);
+    close(fds[0]);
+
+    for (i = 0; (i < 1000) && !eof; ++i)
+    {
+        while ((ret = read(fds[1], achBuf, sizeof(achBuf))) > 0)
+        {
+            total += ret;
+            for (j = 0; j < ret; ++j)
+            {
+                memmove(achTail, achTail + 1, 3);
+                achTail[3] = achBuf[j];
+            }
+        }
+        if (ret == 0)
+            eof = 1;
+        ring.waitAndProcessEvents(1);
+    }
+    CHECK(eof == 1);
+    CHECK(total == filled + 4);
+    CHECK(memcmp(achTail, "tail", 4) == 0);
+    close(fds[1]);
+}
+
+#endif
 
 #endif
 
@@ -0,0 +1,334 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+// Throughput benchmark of the LSAPI shared memory transport against a stub
+// backend forked on the other end of a UNIX domain socket pair. The stub
+// answers each request with a stream of 16K LSAPI_RESP_STREAM packets, sent
+// over the socket in the first run and through the response ring in the
+// second one, where the socket only carries the doorbells. The server side
+// waits in poll() and reads the stream into a 16K buffer in both runs, the
+// way LsapiConn does.
+//
+// usage: lsapishmbench [requests] [response size] [ring size]
+
+#include <extensions/lsapi/lsapishm.h>
+#include <extensions/lsapi/lsapireq.h>
+#include <util/fdpass.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define REQ_SIZE    1024
+
+
+static long long nowUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+static int fullWrite(int fd, const char *pBuf, int len)
+{
+    int total = 0;
+    while (total < len)
+    {
+        int ret = write(fd, pBuf + total, len - total);
+        if (ret <= 0)
+            return -1;
+        total += ret;
+    }
+    return total;
+}
+
+
+static int fullRead(int fd, char *pBuf, int len)
+{
+    int total = 0;
+    while (total < len)
+    {
+        int ret = read(fd, pBuf + total, len - total);
+        if (ret <= 0)
+            return -1;
+        total += ret;
+    }
+    return total;
+}
+
+
+static void waitDoorbell(int fd)
+{
+    char achBuf[256];
+    if (read(fd, achBuf, sizeof(achBuf)) <= 0)
+        _exit(0);
+}
+
+
+static void ringDoorbell(int fd)
+{
+    char ch = 0;
+    write(fd, &ch, 1);
+}
+
+
+//response of the stub: header packets of up to 16K payload, then the end
+static int buildResp(char *pBuf, int respSize)
+{
+    char *p = pBuf;
+    while (respSize > 0)
+    {
+        int len = (respSize > LSAPI_MAX_DATA_PACKET_LEN)
+                  ? LSAPI_MAX_DATA_PACKET_LEN : respSize;
+        LsapiReq::buildPacketHeader((struct lsapi_packet_header *)p,
+                                    LSAPI_RESP_STREAM,
+                                    len + LSAPI_PACKET_HEADER_LEN);
+        memset(p + LSAPI_PACKET_HEADER_LEN, 'x', len);
+        p += len + LSAPI_PACKET_HEADER_LEN;
+        respSize -= len;
+    }
+    LsapiReq::buildPacketHeader((struct lsapi_packet_header *)p,
+                                LSAPI_RESP_END, LSAPI_PACKET_HEADER_LEN);
+    return p + LSAPI_PACKET_HEADER_LEN - pBuf;
+}
+
+
+static void stubSocket(int fd, const char *pResp, int respLen)
+{
+    char achReq[REQ_SIZE];
+    while (fullRead(fd, achReq, REQ_SIZE) == REQ_SIZE)
+    {
+        const char *p = pResp;
+        const char *pEnd = pResp + respLen;
+        while (p < pEnd)
+        {
+            int len = ((struct lsapi_packet_header *)p)->m_packetLen.m_iLen;
+            if (fullWrite(fd, p, len) != len)
+                return;
+            p += len;
+        }
+    }
+}
+
+
+static void stubShm(int fd, const char *pResp, int respLen)
+{
+    struct lsapi_packet_header header;
+    struct lsapi_shm_offer offer;
+    char achReq[REQ_SIZE];
+    LsapiShm shm;
+    int shmFd = -1;
+
+    LsapiReq::buildPacketHeader(&header, LSAPI_SHM_SUPPORTED,
+                                LSAPI_PACKET_HEADER_LEN);
+    if ((fullWrite(fd, (char *)&header, sizeof(header)) == -1)
+        || (FDPass::readFd(fd, &offer, sizeof(offer), &shmFd)
+            != (int)sizeof(offer))
+        || (shmFd == -1) || (shm.attach(shmFd, &offer) == LS_FAIL))
+        return;
+    close(shmFd);
+
+    LsapiShmRing &req = shm.getReqRing();
+    LsapiShmRing &resp = shm.getRespRing();
+    while (true)
+    {
+        int n = 0;
+        while (n < REQ_SIZE)
+        {
+            int ret = req.read(achReq + n, REQ_SIZE - n);
+            if (req.needWakeProducer())
+                ringDoorbell(fd);
+            if (ret == 0)
+                waitDoorbell(fd);
+            n += ret;
+        }
+        struct iovec iov;
+        iov.iov_base = (void *)pResp;
+        iov.iov_len = respLen;
+        while (iov.iov_len > 0)
+        {
+            int ret = resp.writev(&iov, 1);
+            if (resp.needWakeConsumer())
+                ringDoorbell(fd);
+            iov.iov_base = (char *)iov.iov_base + ret;
+            iov.iov_len -= ret;
+            if (iov.iov_len > 0)
+                waitDoorbell(fd);
+        }
+    }
+}
+
+
+static int waitReadable(int fd)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    return poll(&pfd, 1, -1);
+}
+
+
+static long long runSocket(int fd, int requests, int respLen)
+{
+    char achReq[REQ_SIZE];
+    char achBuf[LSAPI_MAX_DATA_PACKET_LEN];
+    long long total = 0;
+    memset(achReq, 'r', sizeof(achReq));
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    for (int i = 0; i < requests; ++i)
+    {
+        if (write(fd, achReq, REQ_SIZE) != REQ_SIZE)
+            return -1;
+        int n = 0;
+        while (n < respLen)
+        {
+            int ret = read(fd, achBuf, sizeof(achBuf));
+            if (ret > 0)
+                n += ret;
+            else if ((ret == -1) && (errno == EAGAIN))
+                waitReadable(fd);
+            else
+                return -1;
+        }
+        total += n;
+    }
+    return total;
+}
+
+
+static long long runShm(int fd, int requests, int respLen, int ringSize)
+{
+    struct lsapi_packet_header header;
+    struct lsapi_shm_offer offer;
+    char achReq[REQ_SIZE];
+    char achBuf[LSAPI_MAX_DATA_PACKET_LEN];
+    long long total = 0;
+    LsapiShm shm;
+
+    if (fullRead(fd, (char *)&header, sizeof(header)) != sizeof(header)
+        || (header.m_type != LSAPI_SHM_SUPPORTED))
+        return -1;
+    int shmFd = shm.create(ringSize);
+    if (shmFd == -1)
+        return -1;
+    shm.buildOffer(&offer);
+    if (FDPass::writeFd(fd, &offer, sizeof(offer), shmFd)
+        != (int)sizeof(offer))
+        return -1;
+    close(shmFd);
+
+    LsapiShmRing &req = shm.getReqRing();
+    LsapiShmRing &resp = shm.getRespRing();
+    memset(achReq, 'r', sizeof(achReq));
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    for (int i = 0; i < requests; ++i)
+    {
+        if (req.write(achReq, REQ_SIZE) != REQ_SIZE)
+            return -1;
+        if (req.needWakeConsumer())
+            ringDoorbell(fd);
+        int n = 0;
+        while (n < respLen)
+        {
+            int ret = resp.read(achBuf, sizeof(achBuf));
+            if (resp.needWakeProducer())
+                ringDoorbell(fd);
+            if (ret > 0)
+            {
+                n += ret;
+                continue;
+            }
+            waitReadable(fd);
+            while (read(fd, achBuf, sizeof(achBuf)) > 0)
+                ;
+        }
+        total += n;
+    }
+    return total;
+}
+
+
+static void report(const char *pName, long long bytes, int requests,
+                   long long us)
+{
+    if (bytes < 0)
+    {
+        printf("%-8s failed: %s\n", pName, strerror(errno));
+        return;
+    }
+    printf("%-8s %8.1f MB/s %9.0f req/s\n", pName,
+           (double)bytes / us, (double)requests * 1000000 / us);
+}
+
+
+static long long bench(int shm, int requests, int respSize, int ringSize,
+                       long long *pBytes)
+{
+    int fds[2];
+    char *pResp = (char *)malloc(respSize + respSize / 1000 + 64);
+    int respLen = buildResp(pResp, respSize);
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        return -1;
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        if (shm)
+            stubShm(fds[1], pResp, respLen);
+        else
+            stubSocket(fds[1], pResp, respLen);
+        _exit(0);
+    }
+    close(fds[1]);
+    long long start = nowUs();
+    *pBytes = shm ? runShm(fds[0], requests, respLen, ringSize)
+              : runSocket(fds[0], requests, respLen);
+    long long us = nowUs() - start;
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    free(pResp);
+    return us;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int requests = (argc > 1) ? atoi(argv[1]) : 20000;
+    int respSize = (argc > 2) ? atoi(argv[2]) : 200 * 1024;
+    int ringSize = (argc > 3) ? atoi(argv[3]) : 256 * 1024;
+    long long bytes;
+    long long us;
+
+    signal(SIGPIPE, SIG_IGN);
+    printf("%d requests, %d bytes responses, %d bytes rings\n",
+           requests, respSize, ringSize);
+    us = bench(0, requests, respSize, ringSize, &bytes);
+    report("socket", bytes, requests, us);
+    us = bench(1, requests, respSize, ringSize, &bytes);
+    report("shm", bytes, requests, us);
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <extensions/lsapi/lsapishm.h>
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+TEST(LsapiShmTest_ring)
+{
+    LsapiShm server;
+    LsapiShm backend;
+    struct lsapi_shm_offer offer;
+    char achOut[LSAPI_SHM_MIN_RING_SIZE];
+    char achIn[LSAPI_SHM_MIN_RING_SIZE];
+    int i;
+    for (i = 0; i < (int)sizeof(achOut); ++i)
+        achOut[i] = (char)(i * 7);
+
+    int fd = server.create(1000);
+    CHECK(fd != -1);
+    server.buildOffer(&offer);
+    CHECK(offer.m_ringSize == LSAPI_SHM_MIN_RING_SIZE);
+    CHECK(backend.attach(fd, &offer) == LS_OK);
+    close(fd);
+
+    LsapiShmRing &req = server.getReqRing();
+    LsapiShmRing &peer = backend.getReqRing();
+    CHECK(req.getSpace() == LSAPI_SHM_MIN_RING_SIZE);
+
+    //the backend starts out waiting for data
+    CHECK(req.needWakeConsumer() == 0);
+    CHECK(req.write(achOut, 100) == 100);
+    CHECK(req.needWakeConsumer() == 1);
+    CHECK(req.needWakeConsumer() == 0);
+    CHECK(peer.getDataLen() == 100);
+    CHECK(peer.read(achIn, 60) == 60);
+    CHECK(memcmp(achIn, achOut, 60) == 0);
+    CHECK(peer.read(achIn, sizeof(achIn)) == 40);
+    CHECK(memcmp(achIn, achOut + 60, 40) == 0);
+
+    //a drained ring arms the wait flag again
+    CHECK(req.write(achOut, 10) == 10);
+    CHECK(req.needWakeConsumer() == 1);
+    CHECK(peer.read(achIn, sizeof(achIn)) == 10);
+
+    //fill it up across the end of the buffer
+    struct iovec iov[2];
+    iov[0].iov_base = achOut;
+    iov[0].iov_len = 30000;
+    iov[1].iov_base = achOut + 30000;
+    iov[1].iov_len = sizeof(achOut) - 30000;
+    CHECK(req.writev(iov, 2) == (int)sizeof(achOut));
+    CHECK(req.getSpace() == 0);
+    CHECK(peer.needWakeProducer() == 0);
+    CHECK(req.write(achOut, 1) == 0);
+    CHECK(peer.read(achIn, 1000) == 1000);
+    CHECK(memcmp(achIn, achOut, 1000) == 0);
+    CHECK(peer.needWakeProducer() == 1);
+    CHECK(peer.needWakeProducer() == 0);
+    CHECK(req.write(achOut, 2000) == 1000);
+    CHECK(peer.read(achIn, sizeof(achIn)) == (int)sizeof(achIn));
+    CHECK(memcmp(achIn, achOut + 1000, sizeof(achOut) - 1000) == 0);
+    CHECK(memcmp(achIn + sizeof(achOut) - 1000, achOut, 1000) == 0);
+    CHECK(peer.needWakeProducer() == 1);
+
+    //the response ring is separate
+    CHECK(backend.getRespRing().write(achOut, 500) == 500);
+    CHECK(req.getDataLen() == 0);
+    CHECK(server.getRespRing().read(achIn, sizeof(achIn)) == 500);
+    CHECK(memcmp(achIn, achOut, 500) == 0);
+}
+
+
+TEST(LsapiShmTest_attach)
+{
+    LsapiShm server;
+    LsapiShm backend;
+    struct lsapi_shm_offer offer;
+    int fd = server.create(LSAPI_SHM_MIN_RING_SIZE * 2);
+    CHECK(fd != -1);
+    server.buildOffer(&offer);
+    CHECK(offer.m_pktHeader.m_type == LSAPI_SHM_OFFER);
+    CHECK(offer.m_ringSize == LSAPI_SHM_MIN_RING_SIZE * 2);
+
+    offer.m_ringSize = LSAPI_SHM_MIN_RING_SIZE * 4;
+    CHECK(backend.attach(fd, &offer) == LS_FAIL);
+    offer.m_ringSize = LSAPI_SHM_MIN_RING_SIZE + 1;
+    CHECK(backend.attach(fd, &offer) == LS_FAIL);
+    offer.m_ringSize = LSAPI_SHM_MIN_RING_SIZE * 2;
+    CHECK(backend.attach(fd, &offer) == LS_OK);
+    close(fd);
+}
+
+
+TEST(LsapiShmTest_corruptedCtrl)
+{
+    LsapiShm server;
+    struct lsapi_shm_offer offer;
+    char achBuf[256];
+    memset(achBuf, 'a', sizeof(achBuf));
+
+    int fd = server.create(LSAPI_SHM_MIN_RING_SIZE);
+    CHECK(fd != -1);
+    server.buildOffer(&offer);
+    //the backend gets the same memory through its own mapping
+    char *pMap = (char *)mmap(NULL, offer.m_dataOff + 2 * offer.m_ringSize,
+                              PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    CHECK(pMap != MAP_FAILED);
+    close(fd);
+    struct lsapi_shm_ring_ctrl *pCtrl = (struct lsapi_shm_ring_ctrl *)pMap;
+
+    //response ring: a head beyond the ring size from the local tail
+    LsapiShmRing &resp = server.getRespRing();
+    pCtrl[1].m_head = LSAPI_SHM_MIN_RING_SIZE + 1;
+    CHECK(resp.getDataLen() == LS_FAIL);
+    CHECK(resp.isCorrupted());
+    CHECK(resp.read(achBuf, sizeof(achBuf)) == LS_FAIL);
+    //sticky, even once the value looks sane again
+    pCtrl[1].m_head = 0;
+    CHECK(resp.read(achBuf, sizeof(achBuf)) == LS_FAIL);
+    CHECK(resp.needWakeProducer() == 0);
+
+    //request ring: the backend's tail moved past the local head
+    LsapiShmRing &req = server.getReqRing();
+    CHECK(req.write(achBuf, 100) == 100);
+    pCtrl[0].m_tail = 200;
+    CHECK(req.getSpace() == LS_FAIL);
+    CHECK(req.write(achBuf, 10) == LS_FAIL);
+    //the head published before is kept, the ring is not touched again
+    CHECK(pCtrl[0].m_head == 100);
+
+    //a tail further behind than the ring size, with the counters wrapped
+    LsapiShm server2;
+    fd = server2.create(LSAPI_SHM_MIN_RING_SIZE);
+    CHECK(fd != -1);
+    char *pMap2 = (char *)mmap(NULL, offer.m_dataOff
+                               + 2 * offer.m_ringSize,
+                               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    CHECK(pMap2 != MAP_FAILED);
+    close(fd);
+    pCtrl = (struct lsapi_shm_ring_ctrl *)pMap2;
+    pCtrl[0].m_tail = (uint32_t)-(LSAPI_SHM_MIN_RING_SIZE + 1);
+    CHECK(server2.getReqRing().write(achBuf, 10) == LS_FAIL);
+
+    munmap(pMap, offer.m_dataOff + 2 * offer.m_ringSize);
+    munmap(pMap2, offer.m_dataOff + 2 * offer.m_ringSize);
+}
+
+#endif
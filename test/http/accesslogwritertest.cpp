@@ -0,0 +1,233 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <http/accesslogwriter.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+static int readLog(const char *pPath, char *pBuf, int len)
+{
+    int fd = open(pPath, O_RDONLY);
+    if (fd == -1)
+        return -1;
+    int n = read(fd, pBuf, len - 1);
+    close(fd);
+    if (n >= 0)
+        pBuf[n] = 0;
+    return n;
+}
+
+
+TEST(AccessLogWriterTest_ordering)
+{
+    const char *pPath1 = "/tmp/accesslogwritertest1.log";
+    const char *pPath2 = "/tmp/accesslogwritertest2.log";
+    char achLine[100];
+    char achExpect1[4096];
+    char achExpect2[4096];
+    char achRead[8192];
+    int len1 = 0, len2 = 0, n, i;
+    unlink(pPath1);
+    unlink(pPath2);
+
+    AccessLogWriter &writer = AccessLogWriter::getInstance();
+    AccessLogWriter::setMode(AccessLogWriter::MODE_BLOCK_THEN_DROP);
+    CHECK(writer.start() == 0);
+    CHECK(writer.isRunning());
+
+    AlwTarget *pTarget1 = writer.getTarget(pPath1, 0);
+    AlwTarget *pTarget2 = writer.getTarget(pPath2, 0);
+    CHECK(pTarget1 != pTarget2);
+    //vhosts logging to the same file share one target
+    CHECK(writer.getTarget(pPath1, 0) == pTarget1);
+
+    for (i = 0; i < 200; ++i)
+    {
+        n = snprintf(achLine, sizeof(achLine), "line %d\n", i);
+        if (i % 3)
+        {
+            CHECK(writer.submit(pTarget1, achLine, n) == 0);
+            memcpy(&achExpect1[len1], achLine, n);
+            len1 += n;
+        }
+        else
+        {
+            CHECK(writer.submit(pTarget2, achLine, n) == 0);
+            memcpy(&achExpect2[len2], achLine, n);
+            len2 += n;
+        }
+    }
+    writer.stop();
+    CHECK(!writer.isRunning());
+    CHECK(writer.getDropped() == 0);
+
+    CHECK(readLog(pPath1, achRead, sizeof(achRead)) == len1);
+    CHECK(memcmp(achRead, achExpect1, len1) == 0);
+    CHECK(readLog(pPath2, achRead, sizeof(achRead)) == len2);
+    CHECK(memcmp(achRead, achExpect2, len2) == 0);
+    unlink(pPath1);
+    unlink(pPath2);
+}
+
+
+static long elapsedUsec(const struct timeval *pBegin)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - pBegin->tv_sec) * 1000000L
+           + (now.tv_usec - pBegin->tv_usec);
+}
+
+
+TEST(AccessLogWriterTest_blockBounded)
+{
+    const char *pPath = "/tmp/accesslogwritertest3.log";
+    static char achChunk[ALW_CHUNK_SIZE];
+    char achRead[100];
+    struct timeval begin;
+    int i, queued;
+    unlink(pPath);
+    memset(achChunk, 'a', sizeof(achChunk));
+    achChunk[sizeof(achChunk) - 1] = '\n';
+
+    AccessLogWriter &writer = AccessLogWriter::getInstance();
+    AccessLogWriter::setMode(AccessLogWriter::MODE_BLOCK_THEN_DROP);
+    AccessLogWriter::setMaxChunks(16);
+    AlwTarget *pTarget = writer.getTarget(pPath, 0);
+    long dropped = writer.getDropped();
+
+    //the writer is not running, nothing hands chunks back
+    for (queued = 0; queued < 10000; ++queued)
+    {
+        gettimeofday(&begin, NULL);
+        if (writer.submit(pTarget, achChunk, sizeof(achChunk)) != 0)
+            break;
+    }
+    CHECK(queued >= 16);
+    CHECK(queued < 10000);
+    CHECK(elapsedUsec(&begin) >= ALW_BLOCK_WAIT_USEC);
+    CHECK(writer.getDropped() == dropped + 1);
+
+    //stalled, no more waiting until the writer catches up
+    gettimeofday(&begin, NULL);
+    for (i = 0; i < 10; ++i)
+        CHECK(writer.submit(pTarget, achChunk, sizeof(achChunk)) != 0);
+    CHECK(elapsedUsec(&begin) < ALW_BLOCK_WAIT_USEC);
+    CHECK(writer.getDropped() == dropped + 11);
+
+    CHECK(writer.start() == 0);
+    writer.stop();
+    CHECK(writer.submit(pTarget, "ok\n", 3) == 0);
+    CHECK(writer.start() == 0);
+    writer.stop();
+
+    int fd = open(pPath, O_RDONLY);
+    CHECK(fd != -1);
+    CHECK(lseek(fd, 0, SEEK_END) == (off_t)queued * ALW_CHUNK_SIZE + 3);
+    CHECK(pread(fd, achRead, 3, (off_t)queued * ALW_CHUNK_SIZE) == 3);
+    CHECK(memcmp(achRead, "ok\n", 3) == 0);
+    close(fd);
+    AccessLogWriter::setMaxChunks(ALW_DEFAULT_MAX_CHUNKS);
+    unlink(pPath);
+}
+
+
+static void submitLines(AccessLogWriter &writer, AlwTarget *pTarget,
+                        const char *pLine, int count)
+{
+    for (int i = 0; i < count; ++i)
+        CHECK(writer.submit(pTarget, pLine, strlen(pLine)) == 0);
+}
+
+
+TEST(AccessLogWriterTest_wholeLines)
+{
+    const char *pPath = "/tmp/accesslogwritertest4.log";
+    static char achLines[ALW_CHUNK_SIZE * 3];
+    static char achLong[ALW_CHUNK_SIZE + 1000];
+    char achRead[100];
+    int queued, len, i;
+    off_t size;
+    unlink(pPath);
+    for (i = 0; i + 100 <= (int)sizeof(achLines); i += 100)
+    {
+        memset(achLines + i, 'a' + i / 100 % 26, 99);
+        achLines[i + 99] = '\n';
+    }
+    len = i;
+    memset(achLong, 'b', sizeof(achLong));
+    achLong[sizeof(achLong) - 1] = '\n';
+
+    AccessLogWriter &writer = AccessLogWriter::getInstance();
+    AccessLogWriter::setMode(AccessLogWriter::MODE_DROP);
+    AccessLogWriter::setMaxChunks(16);
+    AlwTarget *pTarget = writer.getTarget(pPath, 0);
+
+    //every chunk in flight, then all of them handed back
+    for (queued = 0; queued < 10000; ++queued)
+        if (writer.submit(pTarget, "x\n", 2) != 0)
+            break;
+    CHECK(queued >= 16);
+    CHECK(writer.start() == 0);
+    writer.stop();
+    size = queued * 2;
+
+    //2 chunks left, the lines that do not fit in them are dropped whole
+    long dropped = writer.getDropped();
+    submitLines(writer, pTarget, "y\n", queued - 2);
+    CHECK(writer.submit(pTarget, achLines, len) != 0);
+    int written = ALW_CHUNK_SIZE / 100 * 100 * 2;
+    CHECK(writer.getDropped() == dropped + (len - written) / 100);
+    CHECK(writer.start() == 0);
+    writer.stop();
+    size += (queued - 2) * 2 + written;
+
+    //a line longer than a chunk goes in full or not at all
+    dropped = writer.getDropped();
+    submitLines(writer, pTarget, "z\n", queued - 1);
+    CHECK(writer.submit(pTarget, achLong, sizeof(achLong)) != 0);
+    CHECK(writer.getDropped() == dropped + 1);
+    CHECK(writer.submit(pTarget, "ok\n", 3) == 0);
+    CHECK(writer.start() == 0);
+    writer.stop();
+    size += (queued - 1) * 2 + 3;
+
+    int fd = open(pPath, O_RDONLY);
+    CHECK(fd != -1);
+    CHECK(lseek(fd, 0, SEEK_END) == size);
+    CHECK(pread(fd, achRead, 3, size - 3) == 3);
+    CHECK(memcmp(achRead, "ok\n", 3) == 0);
+    //the last line that made it is followed by the next submit
+    off_t off = size - 3 - (queued - 1) * 2 - 100;
+    CHECK(pread(fd, achRead, 100, off) == 100);
+    CHECK(achRead[0] != '\n' && achRead[99] == '\n');
+    CHECK(pread(fd, achRead, 2, off + 100) == 2);
+    CHECK(memcmp(achRead, "z\n", 2) == 0);
+    close(fd);
+    AccessLogWriter::setMaxChunks(ALW_DEFAULT_MAX_CHUNKS);
+    unlink(pPath);
+}
+
+#endif
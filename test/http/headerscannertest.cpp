@@ -0,0 +1,191 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <http/headerscanner.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+static int isBadChar(unsigned char ch)
+{
+    return (ch < 0x20 && ch != '\t' && ch != '\r' && ch != '\n')
+           || ch == 0x7f;
+}
+
+
+//byte by byte reference of HeaderScanner::scan()
+static int refScan(const char *pBegin, const char *pEnd, hdr_line_t *pLines,
+                   int maxLines)
+{
+    const char *pLine = pBegin;
+    int colon = HDR_LINE_NO_COLON;
+    int n = 0;
+    for (const char *p = pBegin; p < pEnd && n < maxLines; ++p)
+    {
+        if (isBadChar(*p))
+        {
+            pLines[n].colon = HDR_LINE_ILLEGAL;
+            pLines[n].end = p - pBegin;
+            return n + 1;
+        }
+        if (*p == ':' && colon == HDR_LINE_NO_COLON)
+            colon = p - pBegin;
+        else if (*p == '\n')
+        {
+            pLines[n].colon = colon;
+            pLines[n].end = p - pBegin;
+            ++n;
+            if (p == pLine + 1 && *pLine == '\r')
+                break;
+            pLine = p + 1;
+            colon = HDR_LINE_NO_COLON;
+        }
+    }
+    return n;
+}
+
+
+static void compareWithRef(const char *pBegin, const char *pEnd, int maxLines)
+{
+    hdr_line_t lines[200], refLines[200];
+    int n = HeaderScanner::scan(pBegin, pEnd, lines, maxLines);
+    int ref = refScan(pBegin, pEnd, refLines, maxLines);
+    CHECK(n == ref);
+    if (n != ref)
+        return;
+    for (int i = 0; i < n; ++i)
+    {
+        CHECK(lines[i].colon == refLines[i].colon);
+        CHECK(lines[i].end == refLines[i].end);
+    }
+}
+
+
+TEST(HeaderScannerTest_lines)
+{
+    const char *pBlock =
+        "Host: www.example.com\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:120.0) Gecko/20100101"
+        " Firefox/120.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+        "image/avif,image/webp,*/*;q=0.8\r\n"
+        "no colon here\r\n"
+        "X-Long: "
+        "0123456789012345678901234567890123456789012345678901234567890123:\r\n"
+        "\r\n"
+        "body: not a header";
+    const char *pEnd = pBlock + strlen(pBlock);
+    const char *names[] = { "Host", "User-Agent", "Accept", NULL, "X-Long" };
+    int saved = HeaderScanner::getImpl();
+
+    for (int impl = HeaderScanner::SCAN_SCALAR;
+         impl <= HeaderScanner::SCAN_AVX2; ++impl)
+    {
+        if (HeaderScanner::setImpl(impl) != LS_OK)
+            continue;
+        hdr_line_t lines[10];
+        const char *pLineBegin = pBlock;
+        CHECK(HeaderScanner::scan(pBlock, pEnd, lines, 10) == 6);
+        for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); ++i)
+        {
+            CHECK(pBlock[lines[i].end] == '\n');
+            if (names[i])
+            {
+                CHECK(lines[i].colon == pLineBegin - pBlock
+                                        + (int)strlen(names[i]));
+                CHECK(strncmp(pLineBegin, names[i], strlen(names[i])) == 0);
+            }
+            else
+                CHECK(lines[i].colon == HDR_LINE_NO_COLON);
+            pLineBegin = pBlock + lines[i].end + 1;
+        }
+        //the blank line ends the scan
+        CHECK(lines[5].end == pLineBegin + 1 - pBlock);
+        CHECK(lines[5].colon == HDR_LINE_NO_COLON);
+
+        //stops at maxLines
+        CHECK(HeaderScanner::scan(pBlock, pEnd, lines, 2) == 2);
+        CHECK(lines[1].colon == lines[0].end + 1 + 10);
+    }
+    HeaderScanner::setImpl(saved);
+}
+
+
+TEST(HeaderScannerTest_illegal)
+{
+    char achBuf[] = "Host: localhost\r\nX-Bad: a\x01z\r\nAccept: */*\r\n\r\n";
+    int saved = HeaderScanner::getImpl();
+    for (int impl = HeaderScanner::SCAN_SCALAR;
+         impl <= HeaderScanner::SCAN_AVX2; ++impl)
+    {
+        if (HeaderScanner::setImpl(impl) != LS_OK)
+            continue;
+        hdr_line_t lines[10];
+        CHECK(HeaderScanner::scan(achBuf, achBuf + sizeof(achBuf) - 1,
+                                  lines, 10) == 2);
+        CHECK(lines[1].colon == HDR_LINE_ILLEGAL);
+        CHECK(achBuf[lines[1].end] == '\x01');
+
+        //obs-text is allowed, DEL and NUL are not
+        const char achObs[] = "X-Name: caf\xc3\xa9\r\n";
+        CHECK(HeaderScanner::scan(achObs, achObs + sizeof(achObs) - 1,
+                                  lines, 10) == 1);
+        CHECK(lines[0].colon == 6);
+        const char achDel[] = "X-Name: a\x7f\r\n";
+        CHECK(HeaderScanner::scan(achDel, achDel + sizeof(achDel) - 1,
+                                  lines, 10) == 1);
+        CHECK(lines[0].colon == HDR_LINE_ILLEGAL);
+        const char achNul[] = "X-Name: a\0b\r\n";
+        CHECK(HeaderScanner::scan(achNul, achNul + sizeof(achNul) - 1,
+                                  lines, 10) == 1);
+        CHECK(lines[0].colon == HDR_LINE_ILLEGAL);
+        CHECK(lines[0].end == 9);
+    }
+    HeaderScanner::setImpl(saved);
+}
+
+
+TEST(HeaderScannerTest_random)
+{
+    static const char achChars[] = "ab:\n\r\t \x01\x7f\xe9";
+    char achBuf[1500];
+    int saved = HeaderScanner::getImpl();
+    srand(1234);
+    for (int round = 0; round < 2000; ++round)
+    {
+        int len = rand() % sizeof(achBuf);
+        for (int i = 0; i < len; ++i)
+        {
+            //mostly plain characters so that lines get long
+            int r = rand() % ((round & 1) ? 64 : 400);
+            achBuf[i] = (r < (int)sizeof(achChars) - 1) ? achChars[r] : 'x';
+        }
+        for (int impl = HeaderScanner::SCAN_SCALAR;
+             impl <= HeaderScanner::SCAN_AVX2; ++impl)
+        {
+            if (HeaderScanner::setImpl(impl) == LS_OK)
+                compareWithRef(achBuf, achBuf + len, 1 + round % 200);
+        }
+    }
+    HeaderScanner::setImpl(saved);
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+// Micro benchmark of the HTTP/2 response header encoding of a small static
+// file: lshpack_enc_encode() of ETag, Content-Type, Last-Modified and
+// Accept-Ranges on a warm connection encoder, as H2Connection::encodeHeaders()
+// did for every response, against copying the block StaticFileCacheData
+// builds once and checking the values it stands for, as
+// HttpRespHeaders::getHpackBlock() does.
+//
+// usage: hpackstaticbench [loops]
+
+#include <spdy/lshpack.h>
+#include <lsr/xxhash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+struct static_hdr
+{
+    int         hpack_idx;
+    const char *name;
+    const char *value;
+};
+
+//in HttpRespHeaders::INDEX order, the order values are hashed in
+static static_hdr s_hdrs[] =
+{
+    { LSHPACK_HDR_ACCEPT_RANGES,  "accept-ranges",  "bytes" },
+    { LSHPACK_HDR_CONTENT_TYPE,   "content-type",   "text/css" },
+    { LSHPACK_HDR_ETAG,           "etag",           "\"1f3a-6553a1b7;;;\"" },
+    { LSHPACK_HDR_LAST_MODIFIED,  "last-modified",
+      "Tue, 14 Nov 2023 08:12:31 GMT" },
+};
+#define HDR_COUNT   (int)(sizeof(s_hdrs) / sizeof(s_hdrs[0]))
+
+
+static long long nowUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+static int encodeAll(struct lshpack_enc *pEnc, unsigned char *buf,
+                     unsigned char *pEnd)
+{
+    lshpack_header_t hdr;
+    unsigned char *p = buf;
+    for (int i = 0; i < HDR_COUNT; ++i)
+    {
+        hdr.name.iov_base = (char *)s_hdrs[i].name;
+        hdr.name.iov_len = strlen(s_hdrs[i].name);
+        hdr.value.iov_base = (char *)s_hdrs[i].value;
+        hdr.value.iov_len = strlen(s_hdrs[i].value);
+        p = lshpack_enc_encode(pEnc, p, pEnd, s_hdrs[i].hpack_idx, &hdr, 0);
+    }
+    return p - buf;
+}
+
+
+static int buildBlock(unsigned char *buf, unsigned char *pEnd,
+                      uint32_t *pHash)
+{
+    lshpack_header_t hdr;
+    unsigned char *p = buf;
+    *pHash = 0;
+    for (int i = 0; i < HDR_COUNT; ++i)
+    {
+        hdr.name.iov_base = NULL;
+        hdr.name.iov_len = 0;
+        hdr.value.iov_base = (char *)s_hdrs[i].value;
+        hdr.value.iov_len = strlen(s_hdrs[i].value);
+        p = lshpack_enc_encode_literal(p, pEnd, s_hdrs[i].hpack_idx, &hdr);
+        *pHash = XXH32(s_hdrs[i].value, hdr.value.iov_len, *pHash);
+    }
+    return p - buf;
+}
+
+
+static int spliceBlock(const unsigned char *pBlock, int len, uint32_t hash,
+                       unsigned char *buf)
+{
+    uint32_t h = 0;
+    for (int i = 0; i < HDR_COUNT; ++i)
+        h = XXH32(s_hdrs[i].value, strlen(s_hdrs[i].value), h);
+    if (h != hash)
+        return -1;
+    memcpy(buf, pBlock, len);
+    return len;
+}
+
+
+static int checkDecode(const unsigned char *buf, int len)
+{
+    struct lshpack_dec dec;
+    char out[256];
+    unsigned nameLen, valLen;
+    uint32_t idx;
+    const unsigned char *p = buf;
+    int ret = 0;
+    lshpack_dec_init(&dec);
+    for (int i = 0; i < HDR_COUNT && ret == 0; ++i)
+    {
+        if (lshpack_dec_decode(&dec, &p, buf + len, out, out + sizeof(out),
+                               &nameLen, &valLen, &idx) != 0
+            || nameLen != strlen(s_hdrs[i].name)
+            || memcmp(out, s_hdrs[i].name, nameLen) != 0
+            || valLen != strlen(s_hdrs[i].value)
+            || memcmp(out + nameLen, s_hdrs[i].value, valLen) != 0)
+            ret = -1;
+    }
+    if (p != buf + len)
+        ret = -1;
+    lshpack_dec_cleanup(&dec);
+    return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int loops = (argc > 1) ? atoi(argv[1]) : 10000000;
+    unsigned char block[256], buf[256];
+    uint32_t hash;
+    struct lshpack_enc enc;
+    long sum;
+    long long begin, used;
+
+    int blockLen = buildBlock(block, block + sizeof(block), &hash);
+    if (checkDecode(block, blockLen) != 0)
+    {
+        printf("pre-encoded block does not decode\n");
+        return 1;
+    }
+
+    lshpack_enc_init(&enc);
+    int first = encodeAll(&enc, buf, buf + sizeof(buf));
+    sum = 0;
+    begin = nowUs();
+    for (int i = 0; i < loops; ++i)
+        sum += encodeAll(&enc, buf, buf + sizeof(buf));
+    used = nowUs() - begin;
+    printf("encode   %8lld us, %6.1f ns/response, %d bytes first, "
+           "%ld bytes after\n", used, used * 1000.0 / loops, first,
+           sum / loops);
+    lshpack_enc_cleanup(&enc);
+
+    sum = 0;
+    begin = nowUs();
+    for (int i = 0; i < loops; ++i)
+        sum += spliceBlock(block, blockLen, hash, buf);
+    used = nowUs() - begin;
+    printf("splice   %8lld us, %6.1f ns/response, %ld bytes%s\n", used,
+           used * 1000.0 / loops, sum / loops,
+           (sum == (long)blockLen * loops) ? "" : "  MISMATCH");
+    return 0;
+}
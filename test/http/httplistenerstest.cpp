@@ -21,7 +21,15 @@
 #include <http/httplistener.h>
 #include <edio/multiplexer.h>
 #include <edio/multiplexerfactory.h>
+#include <http/httpserverconfig.h>
 #include <socket/tcpserversocket.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include "unittest-cpp/UnitTest++.h"
 
 TEST(HttpListenersTest_testHttpSockListener)
@@ -62,4 +70,96 @@ TEST(HttpListenersTest_testHttpSockListener)
     MultiplexerFactory::recycle(pMultiplexer);
 }
 
+
+static int isListening(int fd)
+{
+    int val = 0;
+    socklen_t len = sizeof(val);
+    getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &val, &len);
+    return val;
+}
+
+
+static int acceptOne(int fd)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    poll(&pfd, 1, 1000);
+    int conn = accept(fd, NULL, NULL);
+    if (conn == -1)
+        return 0;
+    close(conn);
+    return 1;
+}
+
+
+TEST(HttpListenersTest_reusePort)
+{
+    HttpListener listener("127.0.0.1:3881", "127.0.0.1:3881");
+    HttpListener recovered;
+    struct sockaddr_in addr;
+    int i, conn, worker2, accepted = 0;
+    int conns[20];
+
+    Multiplexer *pOld = MultiplexerFactory::getMultiplexer();
+    Multiplexer *pMultiplexer =
+        MultiplexerFactory::getNew(MultiplexerFactory::getType("poll"));
+    pMultiplexer->init(1024);
+    MultiplexerFactory::setMultiplexer(pMultiplexer);
+    HttpServerConfig::getInstance().setReusePort(1);
+
+    CHECK(listener.start() == 0);
+    CHECK(listener.getfd() != -1);
+
+    //worker #1 takes the primary socket, worker #2 a new one
+    CHECK(listener.setupReusePort(2, 1) == 0);
+    CHECK(listener.getReusePortSlots() == 2);
+    CHECK(listener.getReusePortFd(0) == listener.getfd());
+    CHECK(listener.setupReusePort(2, 2) == 0);
+    worker2 = listener.getReusePortFd(1);
+    CHECK(worker2 != -1 && worker2 != listener.getfd());
+
+    //both workers exited, connections queue on the sockets kept open
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(3881);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    for (i = 0; i < 20; ++i)
+    {
+        conns[i] = socket(AF_INET, SOCK_STREAM, 0);
+        CHECK(connect(conns[i], (struct sockaddr *)&addr, sizeof(addr)) == 0);
+        //the listener defers accept until the request arrives
+        CHECK(write(conns[i], "G", 1) == 1);
+    }
+
+    //the replacement of worker #2 takes over the same socket
+    CHECK(listener.setupReusePort(2, 2) == 0);
+    CHECK(listener.getReusePortFd(1) == worker2);
+    CHECK(isListening(listener.getfd()));
+
+    //graceful restart, the new instance gets both sockets back
+    recovered.assign(dup(listener.getfd()), (struct sockaddr *)&addr);
+    CHECK(recovered.addReusePortFd(dup(worker2)) == 0);
+    listener.stop();
+    CHECK(recovered.setupReusePort(2, 1) == 0);
+    CHECK(recovered.getReusePortFd(0) == recovered.getfd());
+    CHECK(recovered.getReusePortFd(1) != -1);
+    CHECK(recovered.setupReusePort(2, 2) == 0);
+    fcntl(recovered.getfd(), F_SETFL, O_NONBLOCK);
+    fcntl(recovered.getReusePortFd(1), F_SETFL, O_NONBLOCK);
+
+    //nothing queued was lost
+    while (acceptOne(recovered.getfd()))
+        ++accepted;
+    while (acceptOne(recovered.getReusePortFd(1)))
+        ++accepted;
+    CHECK(accepted == 20);
+
+    for (i = 0; i < 20; ++i)
+        close(conns[i]);
+    recovered.stop();
+    HttpServerConfig::getInstance().setReusePort(0);
+    MultiplexerFactory::setMultiplexer(pOld);
+    MultiplexerFactory::recycle(pMultiplexer);
+}
+
 #endif
@@ -0,0 +1,114 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <http/httppriority.h>
+#include <spdy/unpackedheaders.h>
+
+#include <string.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+static int parseStr(const char *pValue, int *pUrgency, int *pIncremental)
+{
+    *pUrgency = HTTP_PRI_URGENCY_DEFAULT;
+    *pIncremental = 0;
+    return HttpPriority::parse(pValue, pValue + strlen(pValue), pUrgency,
+                               pIncremental);
+}
+
+
+TEST(HttpPriorityTest_parse)
+{
+    int u, i;
+    CHECK(parseStr("", &u, &i) == LS_OK);
+    CHECK(u == 3 && i == 0);
+    CHECK(parseStr("u=0", &u, &i) == LS_OK);
+    CHECK(u == 0 && i == 0);
+    CHECK(parseStr("u=5, i", &u, &i) == LS_OK);
+    CHECK(u == 5 && i == 1);
+    CHECK(parseStr("i=?1,u=1", &u, &i) == LS_OK);
+    CHECK(u == 1 && i == 1);
+    CHECK(parseStr("i=?0", &u, &i) == LS_OK);
+    CHECK(u == 3 && i == 0);
+    //the last member wins
+    CHECK(parseStr("u=1, u=6", &u, &i) == LS_OK);
+    CHECK(u == 6);
+    CHECK(parseStr("  u=2 ,\ti  ", &u, &i) == LS_OK);
+    CHECK(u == 2 && i == 1);
+}
+
+
+TEST(HttpPriorityTest_ignored)
+{
+    int u, i;
+    //out of range or of the wrong type
+    CHECK(parseStr("u=8", &u, &i) == LS_OK);
+    CHECK(u == 3);
+    CHECK(parseStr("u=-1, i=1", &u, &i) == LS_OK);
+    CHECK(u == 3 && i == 0);
+    CHECK(parseStr("u=1.5, i=\"?1\"", &u, &i) == LS_OK);
+    CHECK(u == 3 && i == 0);
+    CHECK(parseStr("u=?1", &u, &i) == LS_OK);
+    CHECK(u == 3);
+
+    //unknown members and parameters
+    CHECK(parseStr("foo=\"a,b\", bar=(1 2 x);p=:aGk=:, u=4;x=y, i;q", &u,
+                   &i) == LS_OK);
+    CHECK(u == 4 && i == 1);
+    CHECK(parseStr("u=2;foo, x=*tok/en", &u, &i) == LS_OK);
+    CHECK(u == 2);
+}
+
+
+TEST(HttpPriorityTest_invalid)
+{
+    const char *values[] =
+    {
+        "U=1", "u=1,", ",u=1", "u=1 i", "u=", "u=1;", "u=\"abc",
+        "u=(1 2", "x=?2", "u=1, 2", "u=1\x01",
+    };
+    for (int n = 0; n < (int)(sizeof(values) / sizeof(values[0])); ++n)
+    {
+        int u = 1, i = 1;
+        const char *p = values[n];
+        CHECK(HttpPriority::parse(p, p + strlen(p), &u, &i) == LS_FAIL);
+        CHECK(u == 1 && i == 1);
+    }
+}
+
+
+TEST(HttpPriorityTest_headers)
+{
+    UnpackedHeaders headers;
+    int u = HTTP_PRI_URGENCY_DEFAULT, i = 0;
+    headers.appendReqLine("GET", 3, "/style.css", 10);
+    headers.appendHeader(UPK_HDR_UNKNOWN, "accept", 6, "text/css", 8);
+    CHECK(HttpPriority::parse(&headers, &u, &i) == 0);
+    CHECK(u == 3 && i == 0);
+
+    headers.appendHeader(UPK_HDR_UNKNOWN, "priority", 8, "u=0", 3);
+    CHECK(HttpPriority::parse(&headers, &u, &i) == 1);
+    CHECK(u == 0 && i == 0);
+
+    headers.appendHeader(UPK_HDR_UNKNOWN, "Priority", 8, "i", 1);
+    CHECK(HttpPriority::parse(&headers, &u, &i) == 1);
+    CHECK(u == 0 && i == 1);
+}
+
+#endif
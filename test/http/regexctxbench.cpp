@@ -0,0 +1,183 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+// Micro benchmark of regex context matching on a virtual host with 50
+// "exp:" contexts: the one by one URIMatch::match() walk that
+// HttpContext::match() used to do, against the same walk skipping the
+// contexts a RegexFilter rules out in one scan of the URI.
+//
+// usage: regexctxbench [loops]
+
+#include <http/urimatch.h>
+#include <util/regexfilter.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define CONTEXTS    50
+
+
+static long long nowUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+static int listMatch(URIMatch **pMatches, const RegexFilter *pFilter,
+                     const char *pURI, int len, char *pBuf, int &bufLen)
+{
+    unsigned char achSeen[REGEX_FILTER_MAX_LITERALS / 8];
+    if (pFilter)
+        pFilter->scan(pURI, len, achSeen);
+    for (int i = 0; i < CONTEXTS; ++i)
+    {
+        if (pFilter && !pFilter->mayMatch(i, achSeen))
+            continue;
+        int n = bufLen;
+        if (pMatches[i]->match(pURI, len, pBuf, n) == 0)
+        {
+            bufLen = n;
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int loops = (argc > 1) ? atoi(argv[1]) : 200000;
+    char achPattern[256];
+    char achSubst[256];
+    const char *pPatterns[CONTEXTS];
+    URIMatch *pMatches[CONTEXTS];
+    int i, n;
+    long long hits = 0;
+
+    //API versions, per app front controllers and static trees, then a few
+    //catch-alls like the ones usually found at the end of such a list
+    for (i = 0; i < CONTEXTS - 5; ++i)
+    {
+        switch (i % 3)
+        {
+        case 0:
+            snprintf(achPattern, sizeof(achPattern),
+                     "^/api/v%d/([a-z]+)/(\\d+)$", i);
+            snprintf(achSubst, sizeof(achSubst),
+                     "/backend/v%d.php?res=$1&id=$2", i);
+            break;
+        case 1:
+            snprintf(achPattern, sizeof(achPattern),
+                     "^/app%d/(.*)$", i);
+            snprintf(achSubst, sizeof(achSubst), "/app%d/index.php/$1", i);
+            break;
+        default:
+            snprintf(achPattern, sizeof(achPattern),
+                     "^/assets-%d/(.+)\\.(css|js)$", i);
+            snprintf(achSubst, sizeof(achSubst), "/min/%d/$1.$2", i);
+            break;
+        }
+        pMatches[i] = new URIMatch();
+        pMatches[i]->set(achPattern, achSubst);
+    }
+    static const char *s_pTail[][2] =
+    {
+        { "^/~([a-z][a-z0-9]+)(/.*)?$", "/home/$1/public_html$2" },
+        { "/\\.well-known/acme-challenge/(.+)$", "/acme/$1" },
+        { "^/(wp-admin|wp-includes)/(.*)$", "/wordpress/$1/$2" },
+        { "\\.(jpe?g|png|gif|webp)$", "/images$0" },
+        { "\\.php$", "/php$0" },
+    };
+    for (n = 0; i < CONTEXTS; ++i, ++n)
+    {
+        pMatches[i] = new URIMatch();
+        pMatches[i]->set(s_pTail[n][0], s_pTail[n][1]);
+    }
+    for (i = 0; i < CONTEXTS; ++i)
+        pPatterns[i] = pMatches[i]->getPattern();
+
+    RegexFilter filter;
+    int literals = filter.build(pPatterns, CONTEXTS);
+
+    static const char *s_pURIs[] =
+    {
+        "/api/v3/users/1024",
+        "/api/v42/orders/77",
+        "/app22/dashboard/settings",
+        "/assets-44/theme/main.css",
+        "/~alice/projects/index.html",
+        "/.well-known/acme-challenge/Xk3s9d",
+        "/wp-admin/options.php",
+        "/uploads/2023/11/photo-1024x768.jpg",
+        "/index.php",
+        "/blog/2023/11/some-article-title/",
+        "/about-us/",
+        "/api/v999/users/1",
+        NULL
+    };
+
+    //results and substitutions must agree before timing anything
+    char achBuf1[1024], achBuf2[1024];
+    int uris = 0;
+    for (const char **p = s_pURIs; *p; ++p, ++uris)
+    {
+        int len = strlen(*p);
+        int len1 = sizeof(achBuf1), len2 = sizeof(achBuf2);
+        int n1 = listMatch(pMatches, NULL, *p, len, achBuf1, len1);
+        int n2 = listMatch(pMatches, &filter, *p, len, achBuf2, len2);
+        if (n1 != n2 || (n1 != -1 && (len1 != len2
+                                      || memcmp(achBuf1, achBuf2, len1))))
+        {
+            printf("mismatch for %s: serial %d, filtered %d\n", *p, n1, n2);
+            return 1;
+        }
+    }
+
+    long long start = nowUs();
+    for (i = 0; i < loops; ++i)
+    {
+        const char *pURI = s_pURIs[i % uris];
+        int len = sizeof(achBuf1);
+        hits += (listMatch(pMatches, NULL, pURI, strlen(pURI), achBuf1, len)
+                 >= 0);
+    }
+    long long serialUs = nowUs() - start;
+
+    start = nowUs();
+    for (i = 0; i < loops; ++i)
+    {
+        const char *pURI = s_pURIs[i % uris];
+        int len = sizeof(achBuf2);
+        hits += (listMatch(pMatches, &filter, pURI, strlen(pURI), achBuf2,
+                           len) >= 0);
+    }
+    long long filterUs = nowUs() - start;
+
+    printf("%d regex contexts, %d literals\n", CONTEXTS, literals);
+    printf("one by one: %8.1f ns/URI\n", serialUs * 1000.0 / loops);
+    printf("filtered:   %8.1f ns/URI\n", filterUs * 1000.0 / loops);
+    printf("(%lld hits)\n", hits);
+
+    for (i = 0; i < CONTEXTS; ++i)
+        delete pMatches[i];
+    return 0;
+}
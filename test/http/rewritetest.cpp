@@ -19,11 +19,16 @@
 
 #include "rewritetest.h"
 #include <http/rewriterule.h>
+#include <http/rewriterulelist.h>
 #include <http/rewritemap.h>
+#include <http/rewritememo.h>
 #include <http/httpheader.h>
 #include <http/httpstatuscode.h>
 #include "unittest-cpp/UnitTest++.h"
 
+#include <stdio.h>
+#include <sys/time.h>
+
 
 
 void testParseCond()
@@ -194,5 +199,252 @@ TEST(RewriteTest_testParse)
     testParseCond();
     testParseRule();
 }
+
+
+//A WordPress + WooCommerce .htaccess plus a block of legacy redirects
+static void buildRuleSet(RewriteRuleList &list)
+{
+    static const char *s_pRules[] =
+    {
+        "RewriteRule ^index\\.php$ - [L]",
+        "RewriteRule ^wp-admin$ wp-admin/ [R=301,L]",
+        "RewriteCond %{REQUEST_FILENAME} -f [OR]\n"
+        "RewriteCond %{REQUEST_FILENAME} -d\n"
+        "RewriteRule ^ - [L]",
+        "RewriteRule ^(wp-(content|admin|includes).*) $1 [L]",
+        "RewriteRule ^(.*\\.php)$ $1 [L]",
+        "RewriteRule ^shop/page/([0-9]+)/?$ index.php?post_type=product&paged=$1 [L]",
+        "RewriteRule ^product-category/(.+?)/?$ index.php?product_cat=$1 [L]",
+        "RewriteRule ^feed/(feed|rdf|rss|rss2|atom)/?$ index.php?feed=$1 [L]",
+        "RewriteRule ^sitemap_index\\.xml$ index.php?sitemap=1 [L]",
+        "RewriteRule ^([^/]+?)-sitemap([0-9]+)?\\.xml$ index.php?sitemap=$1 [L]",
+        "RewriteRule ^static/(.+)\\.(css|js)$ min/$1.$2 [L]",
+        "RewriteRule ^media/catalog/product/cache/(.*)$ get.php [L]",
+        NULL
+    };
+    char achRule[256];
+    for (const char **p = s_pRules; *p; ++p)
+    {
+        strcpy(achRule, *p);
+        char *pRule = achRule;
+        RewriteRule *pNew = new RewriteRule();
+        CHECK(pNew->parse(pRule, NULL) == 0);
+        list.append(pNew);
+    }
+    for (int i = 0; i < 200; ++i)
+    {
+        snprintf(achRule, sizeof(achRule),
+                 "RewriteRule ^old-section-%d/article-%d\\.html$ "
+                 "/blog/article-%d/ [R=301,L]", i % 17, i, i);
+        char *pRule = achRule;
+        RewriteRule *pNew = new RewriteRule();
+        CHECK(pNew->parse(pRule, NULL) == 0);
+        list.append(pNew);
+    }
+}
+
+
+static int ruleMatch(const RewriteRule *pRule, const char *pURI, int len)
+{
+    int vec[30];
+    return pRule->getRegex()->exec(pURI, len, 0, 0, vec, 30) >= 0;
+}
+
+
+static int prefilterMatch(const RewriteRule *pRule, const char *pURI,
+                          int len, const unsigned char *pSeen)
+{
+    int id = pRule->getLiteralId();
+    if (pRule->getPrefilter() && !(pSeen[id >> 3] & (1 << (id & 7))))
+        return 0;
+    return ruleMatch(pRule, pURI, len);
+}
+
+
+static long elapsedUs(struct timeval &begin)
+{
+    struct timeval end;
+    gettimeofday(&end, NULL);
+    return (end.tv_sec - begin.tv_sec) * 1000000L
+           + end.tv_usec - begin.tv_usec;
+}
+
+
+TEST(RewriteTest_prefilter)
+{
+    static const char *s_pURIs[] =
+    {
+        "index.php",
+        "wp-admin",
+        "wp-content/uploads/2023/11/photo-1024x768.jpg",
+        "wp-login.php",
+        "shop/page/3/",
+        "product-category/shoes/running/",
+        "feed/rss2/",
+        "post-sitemap2.xml",
+        "static/theme/main.css",
+        "old-section-5/article-124.html",
+        "Old-Section-5/Article-124.HTML",
+        "2023/11/some-article-title/",
+        "about-us/",
+        "media/catalog/product/cache/1/image/abc.jpg",
+        "",
+        NULL
+    };
+    RewriteRuleList list;
+    unsigned char achSeen[REGEX_FILTER_MAX_LITERALS / 8];
+    buildRuleSet(list);
+    CHECK(list.buildPrefilter() > 0);
+    CHECK(list.hasPrefilter());
+
+    int rules = 0;
+    for (const RewriteRule *pRule = list.begin(); pRule;
+         pRule = (const RewriteRule *)pRule->next())
+        ++rules;
+
+    //a rule skipped by the prefilter must never be one that matches
+    for (const char **p = s_pURIs; *p; ++p)
+    {
+        int len = strlen(*p);
+        list.scanLiterals(*p, len, achSeen);
+        for (const RewriteRule *pRule = list.begin(); pRule;
+             pRule = (const RewriteRule *)pRule->next())
+            CHECK(ruleMatch(pRule, *p, len)
+                  == prefilterMatch(pRule, *p, len, achSeen));
+    }
+
+    int loops = 100;
+    int matches[2] = { 0, 0 };
+    struct timeval begin;
+    gettimeofday(&begin, NULL);
+    for (int i = 0; i < loops; ++i)
+        for (const char **p = s_pURIs; *p; ++p)
+        {
+            int len = strlen(*p);
+            for (const RewriteRule *pRule = list.begin(); pRule;
+                 pRule = (const RewriteRule *)pRule->next())
+                matches[0] += ruleMatch(pRule, *p, len);
+        }
+    long full = elapsedUs(begin);
+
+    gettimeofday(&begin, NULL);
+    for (int i = 0; i < loops; ++i)
+        for (const char **p = s_pURIs; *p; ++p)
+        {
+            int len = strlen(*p);
+            list.scanLiterals(*p, len, achSeen);
+            for (const RewriteRule *pRule = list.begin(); pRule;
+                 pRule = (const RewriteRule *)pRule->next())
+                matches[1] += prefilterMatch(pRule, *p, len, achSeen);
+        }
+    long filtered = elapsedUs(begin);
+    CHECK(matches[0] == matches[1]);
+
+    int uris = loops * (sizeof(s_pURIs) / sizeof(char *) - 1);
+    printf("rewrite rule set, %d rules: every pattern %.2f us/URI, "
+           "prefiltered %.2f us/URI\n", rules, (double)full / uris,
+           (double)filtered / uris);
+}
+
+
+TEST(RewriteTest_memo)
+{
+    RewriteMemo memo;
+    const char *pKey1 = "/blog/article-1/";
+    const char *pKey2 = "/blog/article-2/";
+    int len1 = strlen(pKey1);
+    int len2 = strlen(pKey2);
+    uint64_t hash1 = RewriteMemo::hashKey(pKey1, len1);
+    uint64_t hash2 = RewriteMemo::hashKey(pKey2, len2);
+    int dataLen;
+
+    //disabled until sized
+    CHECK(memo.store(pKey1, len1, hash1, "abc", 3) == LS_FAIL);
+    CHECK(memo.find(pKey1, len1, hash1, dataLen) == NULL);
+
+    CHECK(memo.setSize(100) == LS_OK);
+    CHECK(memo.getSize() == 64);
+    CHECK(memo.store(pKey1, len1, hash1, "abc", 3) == LS_OK);
+    const char *pData = memo.find(pKey1, len1, hash1, dataLen);
+    CHECK(pData != NULL);
+    CHECK(dataLen == 3 && memcmp(pData, "abc", 3) == 0);
+    CHECK(memo.find(pKey2, len2, hash2, dataLen) == NULL);
+    //same slot, different key
+    CHECK(memo.find(pKey2, len2, hash1, dataLen) == NULL);
+
+    CHECK(memo.store(pKey1, len1, hash1, "defgh", 5) == LS_OK);
+    pData = memo.find(pKey1, len1, hash1, dataLen);
+    CHECK(pData != NULL);
+    CHECK(dataLen == 5 && memcmp(pData, "defgh", 5) == 0);
+    CHECK(memo.getCount() == 1);
+
+    //a colliding key replaces the old entry
+    CHECK(memo.store(pKey2, len2, hash1, "xyz", 3) == LS_OK);
+    CHECK(memo.find(pKey1, len1, hash1, dataLen) == NULL);
+    CHECK(memo.find(pKey2, len2, hash1, dataLen) != NULL);
+    CHECK(memo.getCount() == 1);
+
+    char achBig[REWRITE_MEMO_MAX_DATA + 1];
+    memset(achBig, 'a', sizeof(achBig));
+    CHECK(memo.store(pKey1, len1, hash2, achBig, sizeof(achBig)) == LS_FAIL);
+
+    memo.clear();
+    CHECK(memo.getCount() == 0);
+    CHECK(memo.find(pKey2, len2, hash1, dataLen) == NULL);
+}
+
+
+//1 if memoizable with the expected number of key inputs
+static int memoizable(const char *pRules, int keyItems)
+{
+    char achRules[512];
+    RewriteRuleList list;
+    strcpy(achRules, pRules);
+    char *pRule = achRules;
+    RewriteRule *pNew = new RewriteRule();
+    if (pNew->parse(pRule, NULL) != 0)
+    {
+        delete pNew;
+        return -1;
+    }
+    list.append(pNew);
+    list.compile();
+    if (!list.isMemoizable())
+        return 0;
+    return list.getKeyItemCount() == keyItems;
+}
+
+
+TEST(RewriteTest_memoizable)
+{
+    CHECK(memoizable("RewriteRule ^index\\.php$ - [L]", 0) == 1);
+    CHECK(memoizable("RewriteCond %{HTTP_HOST} ^www\\.(.+)$\n"
+                     "RewriteRule ^(.*)$ http://%1/$1 [R=301,L]", 1) == 1);
+    CHECK(memoizable("RewriteCond %{HTTP:Accept} webp\n"
+                     "RewriteCond %{HTTP_USER_AGENT} Chrome\n"
+                     "RewriteRule ^(.*)\\.jpg$ $1.webp [L]", 2) == 1);
+    CHECK(memoizable("RewriteCond %{REQUEST_FILENAME} !-f\n"
+                     "RewriteRule . /index.php [L]", 0) == 0);
+    CHECK(memoizable("RewriteCond %{TIME_HOUR} ^0\n"
+                     "RewriteRule ^ /night.html [L]", 0) == 0);
+    CHECK(memoizable("RewriteRule ^app/ - [E=no-gzip:1]", 0) == 1);
+    CHECK(memoizable("RewriteRule ^app/ - [E=host:%{HTTP_HOST}]", 1) == 1);
+    CHECK(memoizable("RewriteRule ^app/ - [CO=app:1:.example.com]", 0) == 0);
+    CHECK(memoizable("RewriteRule \\.svgz$ - [T=image/svg+xml]", 0) == 0);
+}
+
+
+TEST(RewriteTest_memoSerial)
+{
+    RewriteRuleList list1;
+    RewriteRuleList list2;
+    CHECK(list1.getSerial() != list2.getSerial());
+
+    //a recompiled list does not hit entries of its earlier rules
+    uint32_t serial = list1.getSerial();
+    list1.compile();
+    CHECK(list1.getSerial() != serial);
+    CHECK(list1.getSerial() != list2.getSerial());
+}
 #endif
 
@@ -0,0 +1,113 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <http/shmmetrics.h>
+#include <util/autobuf.h>
+
+#include <string.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+TEST(ShmMetricsTest_buckets)
+{
+    CHECK(ShmMetrics::getBucket(0) == 0);
+    CHECK(ShmMetrics::getBucket(15) == 0);
+    CHECK(ShmMetrics::getBucket(16) == 1);
+    CHECK(ShmMetrics::getBucket(1LL << 40) == METRICS_HIST_BUCKETS - 1);
+    CHECK(ShmMetrics::getBucketBound(METRICS_HIST_BUCKETS - 1) == -1);
+
+    //every value falls below the bound of its bucket and at or above the
+    //bound of the one before
+    for (long long us = 1; us < (1LL << METRICS_HIST_MAX_SHIFT); us += us / 7 + 1)
+    {
+        int b = ShmMetrics::getBucket(us);
+        CHECK(us < ShmMetrics::getBucketBound(b));
+        if (b > 0)
+            CHECK(us >= ShmMetrics::getBucketBound(b - 1));
+    }
+    for (int b = 1; b < METRICS_HIST_BUCKETS - 1; ++b)
+        CHECK(ShmMetrics::getBucketBound(b) > ShmMetrics::getBucketBound(b - 1));
+}
+
+
+TEST(ShmMetricsTest_prometheus)
+{
+    CHECK(ShmMetrics::init(3) == LS_OK);
+    int id = ShmMetrics::getVHostId("example");
+    CHECK(id != ShmMetrics::VHOST_OTHER);
+    CHECK(ShmMetrics::getVHostId("example") == id);
+    CHECK(ShmMetrics::getVHostId("other.com") != id);
+
+    //two workers, the sums are merged
+    ShmMetrics::setSlot(1);
+    ShmMetrics::addRequest(id, HandlerType::HT_STATIC, 100, 1000);
+    ShmMetrics::addTtfb(id, 50);
+    ShmMetrics::setSlot(2);
+    ShmMetrics::addRequest(id, HandlerType::HT_LSAPI, 3000000, 500);
+    ShmMetrics::addBackendWait(HandlerType::HT_LSAPI, 2000000);
+    ShmMetrics::incCache(ShmMetrics::CACHE_HIT);
+
+    AutoBuf buf(4096);
+    CHECK(ShmMetrics::writePrometheus(&buf) == LS_OK);
+    buf.append("", 1);
+    const char *p = buf.begin();
+    CHECK(strstr(p, "litespeed_requests_total{vhost=\"example\"} 2\n") != NULL);
+    CHECK(strstr(p, "litespeed_response_bytes_total{vhost=\"example\"} 1500\n")
+          != NULL);
+    CHECK(strstr(p, "litespeed_request_duration_seconds_count{vhost=\"example\"}"
+                 " 2\n") != NULL);
+    CHECK(strstr(p, "litespeed_request_duration_seconds_sum{vhost=\"example\"}"
+                 " 3.000100\n") != NULL);
+    CHECK(strstr(p, "litespeed_request_duration_seconds_bucket{vhost=\"example\""
+                 ",le=\"+Inf\"} 2\n") != NULL);
+    CHECK(strstr(p, "litespeed_request_duration_seconds_bucket{vhost=\"example\""
+                 ",le=\"0.000128\"} 1\n") != NULL);
+    CHECK(strstr(p, "litespeed_ttfb_seconds_count{vhost=\"example\"} 1\n")
+          != NULL);
+    CHECK(strstr(p, "litespeed_handler_requests_total{handler=\"lsapi\"} 1\n")
+          != NULL);
+    CHECK(strstr(p, "litespeed_backend_wait_seconds_count{handler=\"lsapi\"}"
+                 " 1\n") != NULL);
+    CHECK(strstr(p, "litespeed_backend_wait_seconds_count{handler=\"static\"}")
+          == NULL);
+    CHECK(strstr(p, "litespeed_cache_hits_total 1\n") != NULL);
+    //vhosts without requests are left out
+    CHECK(strstr(p, "other.com") == NULL);
+    //TLS context counters only show up once a context was loaded on demand
+    CHECK(strstr(p, "litespeed_tls_ctx") == NULL);
+
+    ShmMetrics::incTlsCtx(ShmMetrics::TLS_CTX_MISS);
+    ShmMetrics::addTlsCtxBuild(5000);
+    ShmMetrics::setSlot(1);
+    ShmMetrics::incTlsCtx(ShmMetrics::TLS_CTX_HIT);
+    ShmMetrics::incTlsCtx(ShmMetrics::TLS_CTX_HIT);
+    buf.clear();
+    CHECK(ShmMetrics::writePrometheus(&buf) == LS_OK);
+    buf.append("", 1);
+    p = buf.begin();
+    CHECK(strstr(p, "litespeed_tls_ctx_hits_total 2\n") != NULL);
+    CHECK(strstr(p, "litespeed_tls_ctx_misses_total 1\n") != NULL);
+    CHECK(strstr(p, "litespeed_tls_ctx_evictions_total 0\n") != NULL);
+    CHECK(strstr(p, "litespeed_tls_ctx_load_seconds_count 1\n") != NULL);
+    CHECK(strstr(p, "litespeed_tls_ctx_load_seconds_sum 0.005000\n") != NULL);
+    CHECK(strstr(p, "litespeed_tls_ctx_load_seconds_bucket{le=\"+Inf\"} 1\n")
+          != NULL);
+}
+
+#endif
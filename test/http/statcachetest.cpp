@@ -0,0 +1,110 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <http/statcache.h>
+
+#include <edio/multiplexer.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+static void writeFile(const char *pPath, const char *pData, int flag)
+{
+    int fd = open(pPath, O_WRONLY | O_CREAT | flag, 0644);
+    if (fd != -1)
+    {
+        write(fd, pData, strlen(pData));
+        close(fd);
+    }
+}
+
+
+TEST(StatCacheTest_invalidate)
+{
+    //a fixed path keeps the slots of the entries apart
+    const char *pDir = "/tmp/statcachetest";
+    char achFile[256], achMissing[256], achSub[256], achSubFile[256],
+         achMoved[256], achMovedFile[256];
+    struct stat st;
+    snprintf(achFile, sizeof(achFile), "rm -rf %s", pDir);
+    system(achFile);
+    CHECK(mkdir(pDir, 0755) == 0);
+    snprintf(achFile, sizeof(achFile), "%s/a.html", pDir);
+    snprintf(achMissing, sizeof(achMissing), "%s/b.html", pDir);
+    snprintf(achSub, sizeof(achSub), "%s/sub", pDir);
+    snprintf(achSubFile, sizeof(achSubFile), "%s/sub/c.html", pDir);
+    snprintf(achMoved, sizeof(achMoved), "%s/moved", pDir);
+    snprintf(achMovedFile, sizeof(achMovedFile), "%s/moved/c.html", pDir);
+    writeFile(achFile, "abc", O_TRUNC);
+    mkdir(achSub, 0755);
+    writeFile(achSubFile, "x", O_TRUNC);
+
+    StatCache::setSize(1024);
+    StatCache::setTimeout(1);
+    StatCache &cache = StatCache::getInstance();
+
+    CHECK(StatCache::cachedStat(achFile, &st) == 0);
+    CHECK(st.st_size == 3);
+    CHECK(StatCache::cachedStat(achMissing, &st) == -1);
+    CHECK(errno == ENOENT);
+    CHECK(StatCache::cachedStat(achSubFile, &st) == 0);
+    CHECK(cache.getCount() == 3);
+    CHECK(cache.getWatchCount() > 0);
+
+    //served from the cache until the inotify events are processed
+    writeFile(achFile, "def", O_APPEND);
+    writeFile(achMissing, "", O_TRUNC);
+    CHECK(StatCache::cachedStat(achFile, &st) == 0);
+    CHECK(st.st_size == 3);
+    CHECK(StatCache::cachedStat(achMissing, &st) == -1);
+
+    cache.handleEvents(POLLIN);
+    CHECK(StatCache::cachedStat(achFile, &st) == 0);
+    CHECK(st.st_size == 6);
+    CHECK(StatCache::cachedStat(achMissing, &st) == 0);
+    CHECK(st.st_size == 0);
+
+    //renaming a directory drops everything below it
+    CHECK(rename(achSub, achMoved) == 0);
+    cache.handleEvents(POLLIN);
+    CHECK(StatCache::cachedStat(achSubFile, &st) == -1);
+    CHECK(errno == ENOENT);
+    CHECK(StatCache::cachedStat(achMovedFile, &st) == 0);
+
+    unlink(achMovedFile);
+    rmdir(achMoved);
+    unlink(achFile);
+    unlink(achMissing);
+    rmdir(pDir);
+    cache.handleEvents(POLLIN);
+    CHECK(StatCache::cachedStat(achFile, &st) == -1);
+    CHECK(errno == ENOENT);
+
+    cache.clear();
+    CHECK(cache.getCount() == 0);
+    StatCache::setSize(0);
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <http/authuser.h>
+#include <http/userdir.h>
+#include <lsdef.h>
+#include <util/datetime.h>
+
+#include <string.h>
+#include <time.h>
+#include "unittest-cpp/UnitTest++.h"
+
+static const char *s_pSha512 = "$6$saltsalt$TVLlQcbpFVof5W3Yz4DTP6gRstiNuHwwTt6"
+                               "GLc1E5n0U0aDehy0S5knV8wiOQSpT0Y77vwPZN.Pq.H91p5"
+                               "hVO1";
+
+
+static int verifyUser(const char *pHtpasswd, const char *pPasswd)
+{
+    AuthUser user;
+    user.setPasswd(pHtpasswd);
+    user.updatePasswdEncMethod();
+    return UserDir::verifyPasswd(user.getEncMethod(), user.getPasswd(),
+                                 pPasswd, 0);
+}
+
+
+TEST(UserDirTest_verifyPasswd)
+{
+    CHECK(verifyUser("secret", "secret") == 0);
+    CHECK(verifyUser("abNANd1rDfiNc", "secret") == 0);
+    CHECK(verifyUser("abNANd1rDfiNc", "secreT") != 0);
+    CHECK(verifyUser(s_pSha512, "secret") == 0);
+    CHECK(verifyUser(s_pSha512, "secret2") != 0);
+    CHECK(verifyUser("$apr1$abcdefgh$h9FWgUz3n9YxylKLlR5SQ/", "secret") == 0);
+    CHECK(verifyUser("$apr1$abcdefgh$h9FWgUz3n9YxylKLlR5SQ/", "Secret") != 0);
+    CHECK(verifyUser("{SHA}5en6G6MezRroT3XKqkdPOmY/BfQ=", "secret") == 0);
+    CHECK(verifyUser("{SHA}5en6G6MezRroT3XKqkdPOmY/BfQ=", "secre") != 0);
+
+    //the reentrant path used by the worker threads agrees
+    CHECK(UserDir::verifyPasswd(ENCRYPT_CRYPT, s_pSha512, "secret", 1) == 0);
+    CHECK(UserDir::verifyPasswd(ENCRYPT_CRYPT, s_pSha512, "bad", 1) != 0);
+}
+
+
+TEST(UserDirTest_verifiedCache)
+{
+    unsigned char achKey[AUTH_VERIFIED_KEY_LEN];
+    unsigned char achKey2[AUTH_VERIFIED_KEY_LEN];
+    long tmStart = time(NULL);
+    DateTime::s_curTime = tmStart;
+    UserDir::setVerifyCacheTimeout(60);
+
+    CHECK(UserDir::getVerifiedKey("alice", 5, "secret", s_pSha512, achKey)
+          == LS_OK);
+    CHECK(UserDir::isVerified(achKey) == 0);
+    UserDir::addVerified(achKey);
+    CHECK(UserDir::isVerified(achKey) != 0);
+
+    //the same credentials map to the same entry
+    CHECK(UserDir::getVerifiedKey("alice", 5, "secret", s_pSha512, achKey2)
+          == LS_OK);
+    CHECK(memcmp(achKey, achKey2, AUTH_VERIFIED_KEY_LEN) == 0);
+    CHECK(UserDir::isVerified(achKey2) != 0);
+
+    //another password or user does not hit
+    CHECK(UserDir::getVerifiedKey("alice", 5, "secreT", s_pSha512, achKey2)
+          == LS_OK);
+    CHECK(UserDir::isVerified(achKey2) == 0);
+    CHECK(UserDir::getVerifiedKey("alicE", 5, "secret", s_pSha512, achKey2)
+          == LS_OK);
+    CHECK(UserDir::isVerified(achKey2) == 0);
+
+    //a changed password file invalidates the entry
+    CHECK(UserDir::getVerifiedKey("alice", 5, "secret",
+                                  "$6$saltsalt$changed", achKey2) == LS_OK);
+    CHECK(memcmp(achKey, achKey2, AUTH_VERIFIED_KEY_LEN) != 0);
+    CHECK(UserDir::isVerified(achKey2) == 0);
+
+    //expires after the verify cache timeout
+    DateTime::s_curTime = tmStart + 59;
+    CHECK(UserDir::isVerified(achKey) != 0);
+    DateTime::s_curTime = tmStart + 60;
+    CHECK(UserDir::isVerified(achKey) == 0);
+
+    //a timeout of 0 turns the cache off
+    UserDir::setVerifyCacheTimeout(0);
+    CHECK(UserDir::getVerifiedKey("alice", 5, "secret", s_pSha512, achKey)
+          == LS_FAIL);
+    UserDir::setVerifyCacheTimeout(60);
+}
+
+#endif
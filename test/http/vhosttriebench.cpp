@@ -0,0 +1,134 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+// Micro benchmark of wildcard virtual host lookup on a listener with many
+// "*.customerN.tld" mappings: the linear glob walk VHostMap::wildMatch()
+// used to do, one StringTool::strMatch() per pattern, against the
+// DomainTrie lookup over reversed labels.
+//
+// usage: vhosttriebench [patterns] [loops]
+
+#include <util/domaintrie.h>
+#include <util/stringlist.h>
+#include <util/stringtool.h>
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+
+static long long nowUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+static int listMatch(StringList **pList, int count, const char *pHost,
+                     const char *pEnd)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (StringTool::strMatch(pHost, pEnd, pList[i]->begin(),
+                                 pList[i]->end(), 0) == 0)
+            return i;
+    }
+    return -1;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 10000;
+    int loops = (argc > 2) ? atoi(argv[2]) : 200000;
+    char achBuf[256];
+    int i, n, seq;
+    long long hits = 0;
+
+    StringList **pList = new StringList *[count];
+    DomainTrie trie;
+    for (i = 0; i < count; ++i)
+    {
+        snprintf(achBuf, sizeof(achBuf), "*.customer%d.tld", i);
+        pList[i] = StringTool::parseMatchPattern(achBuf);
+        trie.add(DomainTrie::getSuffix(achBuf), (void *)(long)(i + 1), i);
+    }
+
+    //hosts spread over the whole list, one in eight matches nothing
+    const int nHosts = 64;
+    char achHosts[nHosts][64];
+    int hostLen[nHosts];
+    for (i = 0; i < nHosts; ++i)
+    {
+        if (i % 8 == 7)
+            hostLen[i] = snprintf(achHosts[i], 64, "www.unknown%d.net", i);
+        else
+            hostLen[i] = snprintf(achHosts[i], 64, "www.customer%d.tld",
+                                  (int)((long long)count * i / nHosts));
+    }
+
+    //results must agree before timing anything
+    for (i = 0; i < nHosts; ++i)
+    {
+        seq = INT_MAX;
+        long obj = (long)trie.match(achHosts[i], achHosts[i] + hostLen[i],
+                                    &seq);
+        n = listMatch(pList, count, achHosts[i], achHosts[i] + hostLen[i]);
+        if (obj - 1 != n)
+        {
+            printf("mismatch for %s: list %d, trie %ld\n", achHosts[i], n,
+                   obj - 1);
+            return 1;
+        }
+    }
+
+    int listLoops = loops / 100 + 1;
+    long long start = nowUs();
+    for (i = 0; i < listLoops; ++i)
+    {
+        n = i % nHosts;
+        hits += (listMatch(pList, count, achHosts[n], achHosts[n] + hostLen[n])
+                 >= 0);
+    }
+    long long listUs = nowUs() - start;
+
+    start = nowUs();
+    for (i = 0; i < loops; ++i)
+    {
+        n = i % nHosts;
+        seq = INT_MAX;
+        hits += (trie.match(achHosts[n], achHosts[n] + hostLen[n], &seq)
+                 != NULL);
+    }
+    long long trieUs = nowUs() - start;
+
+    printf("%d wildcard patterns\n", count);
+    printf("linear list: %8.1f ns/lookup (%d lookups)\n",
+           listUs * 1000.0 / listLoops, listLoops);
+    printf("label trie:  %8.1f ns/lookup (%d lookups)\n",
+           trieUs * 1000.0 / loops, loops);
+    printf("(%lld hits)\n", hits);
+
+    for (i = 0; i < count; ++i)
+        delete pList[i];
+    delete [] pList;
+    return 0;
+}
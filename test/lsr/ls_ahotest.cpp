@@ -62,6 +62,25 @@ TEST(ls_AhoTest_test)
 
 }
 
+//a pattern starting where a partial match fails, "ac" in "aac"
+TEST(ls_AhoTest_restart)
+{
+    size_t iOutStart, iOutEnd;
+    ls_aho_state_t *pLast;
+    ls_aho_t *pThis = ls_aho_new(0);
+    CHECK(pThis != NULL);
+    CHECK(ls_aho_addpattern(pThis, "ac", 2, NULL) == 1);
+    CHECK(ls_aho_addpattern(pThis, "xyz", 3, NULL) == 1);
+    CHECK(ls_aho_maketree(pThis, 1) == 1);
+    CHECK(ls_aho_search(pThis, NULL, "aac", 3, 0, &iOutStart, &iOutEnd,
+                        &pLast, NULL) != 0);
+    CHECK(iOutStart == 1 && iOutEnd == 3);
+    CHECK(ls_aho_search(pThis, NULL, "xxyAxyZ", 7, 0, &iOutStart, &iOutEnd,
+                        &pLast, NULL) != 0);
+    CHECK(iOutStart == 4 && iOutEnd == 7);
+    ls_aho_delete(pThis);
+}
+
 ls_aho_t *ls_aho_initTree(const char *acceptBuf[], int bufCount,
                           int sensitive, int seq)
 {
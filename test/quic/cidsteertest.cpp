@@ -0,0 +1,179 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <quic/cidsteer.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+static int newReusePortSock(struct sockaddr_in *pAddr)
+{
+    int one = 1;
+    socklen_t len = sizeof(*pAddr);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd == -1)
+        return -1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)pAddr, sizeof(*pAddr)) != 0
+        || getsockname(fd, (struct sockaddr *)pAddr, &len) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+static void setCid(lsquic_cid_t *pCid, unsigned char first)
+{
+    memset(pCid, 0, sizeof(*pCid));
+    pCid->len = CID_STEER_LEN;
+    for (int i = 0; i < CID_STEER_LEN; ++i)
+        pCid->idbuf[i] = first + i;
+}
+
+
+//a 1-RTT packet carries the DCID right after the flags
+static int buildShort(unsigned char *pBuf, const lsquic_cid_t *pCid)
+{
+    memset(pBuf, 0xab, 64);
+    pBuf[0] = 0x40;
+    memcpy(pBuf + 1, pCid->idbuf, pCid->len);
+    return 64;
+}
+
+
+//a long header packet has flags, version and the DCID length first
+static int buildLong(unsigned char *pBuf, const lsquic_cid_t *pCid)
+{
+    memset(pBuf, 0xab, 64);
+    pBuf[0] = 0xc0;
+    pBuf[1] = pBuf[2] = pBuf[3] = 0;
+    pBuf[4] = 1;
+    pBuf[5] = pCid->len;
+    memcpy(pBuf + 6, pCid->idbuf, pCid->len);
+    return 64;
+}
+
+
+//Returns the index of the worker socket the packet went to
+static int sendTo(int client, const struct sockaddr_in *pAddr,
+                  const unsigned char *pBuf, int len, int *fds)
+{
+    struct pollfd pfds[2];
+    unsigned char achBuf[256];
+    if (sendto(client, pBuf, len, 0, (const struct sockaddr *)pAddr,
+               sizeof(*pAddr)) != len)
+        return -1;
+    for (int i = 0; i < 2; ++i)
+    {
+        pfds[i].fd = fds[i];
+        pfds[i].events = POLLIN;
+    }
+    if (poll(pfds, 2, 1000) <= 0)
+        return -1;
+    for (int i = 0; i < 2; ++i)
+        if (pfds[i].revents & POLLIN)
+        {
+            recv(fds[i], achBuf, sizeof(achBuf), 0);
+            return i;
+        }
+    return -1;
+}
+
+
+TEST(CidSteerTest_steer)
+{
+    struct sockaddr_in addr;
+    unsigned char achPkt[64];
+    lsquic_cid_t cid0, cid1, cidShort;
+    int fds[2];
+    int len;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fds[0] = newReusePortSock(&addr);
+    fds[1] = newReusePortSock(&addr);
+    int client = socket(AF_INET, SOCK_DGRAM, 0);
+    CHECK(fds[0] != -1 && fds[1] != -1 && client != -1);
+    setCid(&cid0, 0x10);
+    setCid(&cid1, 0x20);
+
+    CidSteer steer;
+    //needs CAP_BPF, or CAP_SYS_ADMIN on older kernels
+    if (steer.attach(fds[0], 2, 16) != LS_OK)
+    {
+        CHECK(CidSteer::addCid(&cid0, 0) == LS_FAIL);
+        close(fds[0]);
+        close(fds[1]);
+        close(client);
+        return;
+    }
+    CHECK(steer.isAttached());
+    CHECK(steer.setSock(0, fds[0]) == LS_OK);
+    CHECK(steer.setSock(1, fds[1]) == LS_OK);
+    CHECK(steer.setSock(2, fds[1]) == LS_FAIL);
+
+    CHECK(CidSteer::addCid(&cid0, 0) == LS_OK);
+    CHECK(CidSteer::addCid(&cid1, 1) == LS_OK);
+
+    //the same 4-tuple hashes to one socket, the CID picks the other one
+    for (int i = 0; i < 4; ++i)
+    {
+        len = buildShort(achPkt, &cid0);
+        CHECK(sendTo(client, &addr, achPkt, len, fds) == 0);
+        len = buildShort(achPkt, &cid1);
+        CHECK(sendTo(client, &addr, achPkt, len, fds) == 1);
+        len = buildLong(achPkt, &cid0);
+        CHECK(sendTo(client, &addr, achPkt, len, fds) == 0);
+        len = buildLong(achPkt, &cid1);
+        CHECK(sendTo(client, &addr, achPkt, len, fds) == 1);
+    }
+
+    //other CID lengths are not tracked, but still delivered
+    setCid(&cidShort, 0x30);
+    cidShort.len = 5;
+    CHECK(CidSteer::addCid(&cidShort, 1) == LS_FAIL);
+    len = buildLong(achPkt, &cidShort);
+    CHECK(sendTo(client, &addr, achPkt, len, fds) != -1);
+
+    //a retired CID and the CIDs of an exited worker are gone
+    CidSteer::removeCid(&cid0);
+    CHECK(CidSteer::removeWorkerCids(0) == 0);
+    CHECK(CidSteer::removeWorkerCids(1) == 1);
+    CHECK(CidSteer::removeWorkerCids(1) == 0);
+    len = buildShort(achPkt, &cid1);
+    CHECK(sendTo(client, &addr, achPkt, len, fds) != -1);
+
+    steer.removeSock(1);
+    steer.detach();
+    CHECK(!steer.isAttached());
+    close(fds[0]);
+    close(fds[1]);
+    close(client);
+}
+
+#endif
@@ -0,0 +1,149 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <quic/udplistener.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/uio.h>
+#include "unittest-cpp/UnitTest++.h"
+
+#if __linux__
+
+#define MAX_SPECS   80
+
+struct gso_specs
+{
+    struct lsquic_out_spec  specs[MAX_SPECS];
+    struct iovec            iovs[MAX_SPECS];
+    struct sockaddr_in      local;
+    struct sockaddr_in      peer;
+    struct sockaddr_in      other;
+    char                    data[1500];
+};
+
+
+static void initSpecs(gso_specs *p, int count, size_t size)
+{
+    memset(p, 0, sizeof(*p));
+    p->local.sin_family = AF_INET;
+    p->local.sin_port = htons(443);
+    p->local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    p->peer = p->local;
+    p->peer.sin_port = htons(40000);
+    p->other = p->peer;
+    p->other.sin_port = htons(40001);
+    for (int i = 0; i < count; ++i)
+    {
+        p->iovs[i].iov_base = p->data;
+        p->iovs[i].iov_len = size;
+        p->specs[i].iov = &p->iovs[i];
+        p->specs[i].iovlen = 1;
+        p->specs[i].local_sa = (struct sockaddr *)&p->local;
+        p->specs[i].dest_sa = (struct sockaddr *)&p->peer;
+    }
+}
+
+
+SUITE(UdpListener)
+{
+    TEST(GsoRunLength)
+    {
+        gso_specs *p = new gso_specs;
+        size_t segSize = 0;
+
+        //equal sizes to the same peer go out together
+        initSpecs(p, 10, 1200);
+        CHECK(UdpListener::gsoRunLength(p->specs, p->specs + 10, 1024,
+                                        &segSize) == 10);
+        CHECK(segSize == 1200);
+
+        //a shorter packet ends the run and belongs to it
+        p->iovs[4].iov_len = 300;
+        CHECK(UdpListener::gsoRunLength(p->specs, p->specs + 10, 1024,
+                                        &segSize) == 5);
+
+        //a larger one does not
+        initSpecs(p, 10, 1200);
+        p->iovs[3].iov_len = 1300;
+        CHECK(UdpListener::gsoRunLength(p->specs, p->specs + 10, 1024,
+                                        &segSize) == 3);
+
+        //another peer, port included, or another ECN codepoint
+        initSpecs(p, 10, 1200);
+        p->specs[6].dest_sa = (struct sockaddr *)&p->other;
+        CHECK(UdpListener::gsoRunLength(p->specs, p->specs + 10, 1024,
+                                        &segSize) == 6);
+        initSpecs(p, 10, 1200);
+        p->specs[2].ecn = 1;
+        CHECK(UdpListener::gsoRunLength(p->specs, p->specs + 10, 1024,
+                                        &segSize) == 2);
+
+        //the kernel takes 64 segments, and no more than 64 KB
+        initSpecs(p, MAX_SPECS, 100);
+        CHECK(UdpListener::gsoRunLength(p->specs, p->specs + MAX_SPECS,
+                                        1024, &segSize) == 64);
+        initSpecs(p, MAX_SPECS, 1400);
+        CHECK(UdpListener::gsoRunLength(p->specs, p->specs + MAX_SPECS,
+                                        1024, &segSize) == 46);
+
+        //and the iovecs left in the send batch
+        initSpecs(p, 10, 1200);
+        CHECK(UdpListener::gsoRunLength(p->specs, p->specs + 10, 3,
+                                        &segSize) == 3);
+
+        //a lone packet
+        CHECK(UdpListener::gsoRunLength(p->specs + 9, p->specs + 10, 1024,
+                                        &segSize) == 1);
+        delete p;
+    }
+
+
+#ifndef _NOT_USE_SHM_
+    TEST(GroSegments)
+    {
+        unsigned off = 0;
+
+        //3 full segments and a short one
+        CHECK(UdpListener::groNextSegment(3900, 1200, &off) == 1200);
+        CHECK(off == 1200);
+        CHECK(UdpListener::groNextSegment(3900, 1200, &off) == 1200);
+        CHECK(UdpListener::groNextSegment(3900, 1200, &off) == 1200);
+        CHECK(off == 3600);
+        CHECK(UdpListener::groNextSegment(3900, 1200, &off) == 300);
+        CHECK(off == 0);
+
+        //the last segment is a full one
+        CHECK(UdpListener::groNextSegment(2400, 1200, &off) == 1200);
+        CHECK(UdpListener::groNextSegment(2400, 1200, &off) == 1200);
+        CHECK(off == 0);
+
+        //not coalesced, or a single segment
+        CHECK(UdpListener::groNextSegment(1350, 0, &off) == 1350);
+        CHECK(off == 0);
+        CHECK(UdpListener::groNextSegment(1000, 1200, &off) == 1000);
+        CHECK(off == 0);
+    }
+#endif
+}
+
+#endif
+
+#endif
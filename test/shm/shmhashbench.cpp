@@ -0,0 +1,157 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+// Contention benchmark for LsShmHash: several processes hammer the same
+// table with a mix of lookups and updates, once with a single lock, once
+// sharded, and once sharded with lock-free lookups.
+//
+// usage: shmhashbench [processes] [ops per process] [read percent]
+
+#include <shm/lsshm.h>
+#include <shm/lsshmpool.h>
+#include <shm/lsshmhash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define BENCH_KEYS      10000
+#define BENCH_SHARDS    16
+
+static const char *g_pShmDirName = "/tmp";
+static const char *g_pShmName = "SHMHASHBENCH";
+
+static const char *s_aModes[] =
+{
+    "single lock",
+    "sharded",
+    "sharded + findCopy",
+};
+
+
+static int mkKey(char *pBuf, int idx)
+{
+    return snprintf(pBuf, 32, "/bench/key/%d", idx);
+}
+
+
+static void runWorker(LsShmHash *pHash, int mode, int ops, int readPct)
+{
+    char achKey[32];
+    unsigned int seed = getpid();
+    int valLen, len, val = 0;
+
+    for (int i = 0; i < ops; ++i)
+    {
+        int r = rand_r(&seed);
+        len = mkKey(achKey, r % BENCH_KEYS);
+        if ((r >> 8) % 100 < readPct)
+        {
+            if (mode == 2)
+                pHash->findCopy(achKey, len, &val, sizeof(val));
+            else
+            {
+                LsShmOffset_t off = pHash->find(achKey, len, &valLen);
+                if (off != 0)
+                    val = *(int *)pHash->offset2ptr(off);
+            }
+        }
+        else
+            pHash->set(achKey, len, &r, sizeof(r));
+    }
+}
+
+
+static double runMode(LsShmPool *pPool, int mode, int procs, int ops,
+                      int readPct)
+{
+    char achName[12];
+    char achKey[32];
+    struct timeval tvBegin, tvEnd;
+
+    snprintf(achName, sizeof(achName), "bench%d", mode);
+    LsShmHash *pHash = pPool->getNamedHash(achName, BENCH_KEYS,
+                       LsShmHash::hashXXH32, memcmp, LSSHM_FLAG_LRU);
+    if (pHash == NULL)
+        return 0;
+    if ((mode != 0) && (pHash->setupShards(BENCH_SHARDS) != LS_OK))
+        return 0;
+    for (int i = 0; i < BENCH_KEYS; ++i)
+    {
+        int len = mkKey(achKey, i);
+        pHash->set(achKey, len, &i, sizeof(i));
+    }
+
+    gettimeofday(&tvBegin, NULL);
+    for (int i = 0; i < procs; ++i)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            runWorker(pHash, mode, ops, readPct);
+            _exit(0);
+        }
+        else if (pid < 0)
+            perror("fork");
+    }
+    while (wait(NULL) > 0)
+        ;
+    gettimeofday(&tvEnd, NULL);
+    pHash->close();
+
+    double secs = (tvEnd.tv_sec - tvBegin.tv_sec)
+                  + (tvEnd.tv_usec - tvBegin.tv_usec) / 1000000.0;
+    return (double)procs * ops / secs;
+}
+
+
+int main(int argc, char *argv[])
+{
+    char achShmFileName[255];
+    char achLockFileName[255];
+    int procs = (argc > 1) ? atoi(argv[1]) : 8;
+    int ops = (argc > 2) ? atoi(argv[2]) : 200000;
+    int readPct = (argc > 3) ? atoi(argv[3]) : 90;
+
+    snprintf(achShmFileName, sizeof(achShmFileName), "%s/%s.shm",
+             g_pShmDirName, g_pShmName);
+    snprintf(achLockFileName, sizeof(achLockFileName), "%s/%s.lock",
+             g_pShmDirName, g_pShmName);
+    unlink(achShmFileName);
+    unlink(achLockFileName);
+
+    LsShm *pShm = LsShm::open(g_pShmName, 0, g_pShmDirName);
+    LsShmPool *pPool;
+    if ((pShm == NULL) || ((pPool = pShm->getGlobalPool()) == NULL))
+    {
+        fprintf(stderr, "Failed to open SHM: %s\n", LsShm::getErrMsg());
+        return 1;
+    }
+
+    printf("%d processes, %d ops each, %d%% reads\n", procs, ops, readPct);
+    for (int mode = 0; mode < 3; ++mode)
+        printf("%-20s %12.0f ops/sec\n", s_aModes[mode],
+               runMode(pPool, mode, procs, ops, readPct));
+
+    unlink(achShmFileName);
+    unlink(achLockFileName);
+    return 0;
+}
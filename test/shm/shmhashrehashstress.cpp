@@ -0,0 +1,158 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+
+// Stress test for the incremental rehash of LsShmHash: one process grows
+// a table to several million entries while reader processes keep looking
+// up keys; every process reports its worst-case operation time, which
+// includes waiting for and holding the hash lock.
+//
+// usage: shmhashrehashstress [entries] [readers]
+
+#include <shm/lsshm.h>
+#include <shm/lsshmpool.h>
+#include <shm/lsshmhash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const char *g_pShmDirName = "/tmp";
+static const char *g_pShmName = "SHMREHASHSTRESS";
+
+
+static long long nowUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+static int mkKey(char *pBuf, int idx)
+{
+    return snprintf(pBuf, 32, "/stress/key/%d", idx);
+}
+
+
+static void runReader(LsShmHash *pHash, int entries, int fd)
+{
+    char achKey[32];
+    unsigned int seed = getpid();
+    long long maxUs = 0, ops = 0;
+    int valLen;
+
+    // stop when the writer is done: the last key shows up
+    int len = mkKey(achKey, entries - 1);
+    while (pHash->find(achKey, len, &valLen) == 0)
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            int k = rand_r(&seed) % entries;
+            int klen = mkKey(achKey, k);
+            long long t = nowUs();
+            pHash->find(achKey, klen, &valLen);
+            t = nowUs() - t;
+            if (t > maxUs)
+                maxUs = t;
+            ++ops;
+        }
+        len = mkKey(achKey, entries - 1);
+    }
+    long long res[2] = { maxUs, ops };
+    if (write(fd, res, sizeof(res)) != sizeof(res))
+        perror("write");
+}
+
+
+int main(int argc, char *argv[])
+{
+    char achShmFileName[255];
+    char achLockFileName[255];
+    char achKey[32];
+    int entries = (argc > 1) ? atoi(argv[1]) : 4000000;
+    int readers = (argc > 2) ? atoi(argv[2]) : 2;
+    int fds[2];
+
+    snprintf(achShmFileName, sizeof(achShmFileName), "%s/%s.shm",
+             g_pShmDirName, g_pShmName);
+    snprintf(achLockFileName, sizeof(achLockFileName), "%s/%s.lock",
+             g_pShmDirName, g_pShmName);
+    unlink(achShmFileName);
+    unlink(achLockFileName);
+
+    LsShm *pShm = LsShm::open(g_pShmName, 0, g_pShmDirName);
+    LsShmPool *pPool;
+    LsShmHash *pHash;
+    if ((pShm == NULL) || ((pPool = pShm->getGlobalPool()) == NULL)
+        || ((pHash = pPool->getNamedHash("stress", 100, LsShmHash::hashXXH32,
+                                         memcmp, LSSHM_FLAG_LRU)) == NULL)
+        || (pipe(fds) != 0))
+    {
+        fprintf(stderr, "Failed to open SHM: %s\n", LsShm::getErrMsg());
+        return 1;
+    }
+
+    for (int i = 0; i < readers; ++i)
+    {
+        if (fork() == 0)
+        {
+            runReader(pHash, entries, fds[1]);
+            _exit(0);
+        }
+    }
+
+    long long maxUs = 0, total = nowUs();
+    int rehashes = 0, rehashing = 0;
+    int slow = 0;
+    for (int i = 0; i < entries; ++i)
+    {
+        int len = mkKey(achKey, i);
+        long long t = nowUs();
+        pHash->insert(achKey, len, &i, sizeof(i));
+        t = nowUs() - t;
+        if (t > maxUs)
+            maxUs = t;
+        if (t > 1000)
+            ++slow;
+        if (pHash->isRehashing() != rehashing)
+        {
+            rehashing = !rehashing;
+            rehashes += rehashing;
+        }
+    }
+    total = nowUs() - total;
+
+    printf("%d inserts in %lld ms, %d rehashes, final capacity %d\n",
+           entries, total / 1000, rehashes, (int)pHash->capacity());
+    printf("writer: max insert %lld us, %d inserts over 1 ms\n", maxUs, slow);
+    for (int i = 0; i < readers; ++i)
+    {
+        long long res[2];
+        if (read(fds[0], res, sizeof(res)) == sizeof(res))
+            printf("reader %d: max find %lld us over %lld finds\n",
+                   i, res[0], res[1]);
+    }
+    while (wait(NULL) > 0)
+        ;
+    unlink(achShmFileName);
+    unlink(achLockFileName);
+    return 0;
+}
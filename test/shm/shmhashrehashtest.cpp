@@ -0,0 +1,175 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <shm/lsshmpool.h>
+#include <shm/lsshmhash.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "unittest-cpp/UnitTest++.h"
+
+static const char *g_pShmDirName = "/tmp";
+static const char *g_pShmName = "SHMREHASHTEST";
+static const char *g_pHashName = "REHASHHASH";
+
+#define MAX_KEYS        20000
+
+static int mkKey(char *pBuf, int idx)
+{
+    return snprintf(pBuf, 32, "rehashkey-%d", idx);
+}
+
+
+static int countAll(LsShmHash *pHash)
+{
+    int cnt = 0;
+    pHash->lockEx();
+    LsShmHash::iteroffset iterOff = pHash->begin();
+    while (iterOff.m_iOffset != 0)
+    {
+        ++cnt;
+        iterOff = pHash->next(iterOff);
+    }
+    pHash->unlockEx();
+    return cnt;
+}
+
+
+static int checkAll(LsShmHash *pHash, int num, int step)
+{
+    char achKey[32];
+    int i, len, val, valLen, bad = 0;
+    for (i = 0; i < num; ++i)
+    {
+        len = mkKey(achKey, i);
+        LsShmOffset_t off = pHash->find(achKey, len, &valLen);
+        if ((i % step) != 0)
+        {
+            if (off != 0)
+                ++bad;
+            continue;
+        }
+        if ((off == 0) || (*(int *)pHash->offset2ptr(off) != i))
+            ++bad;
+        if ((pHash->findCopy(achKey, len, &val, sizeof(val)) != sizeof(val))
+            || (val != i))
+            ++bad;
+    }
+    return bad;
+}
+
+
+TEST(shmHashRehash_test)
+{
+    char achShmFileName[255];
+    char achLockFileName[255];
+    char achKey[32];
+    LsShm *pShm;
+    LsShmPool *pGPool;
+    LsShmHash *pHash;
+    int i, len;
+
+    snprintf(achShmFileName, sizeof(achShmFileName), "%s/%s.shm",
+             g_pShmDirName, g_pShmName);
+    snprintf(achLockFileName, sizeof(achLockFileName), "%s/%s.lock",
+             g_pShmDirName, g_pShmName);
+    unlink(achShmFileName);
+    unlink(achLockFileName);
+
+    fprintf(stdout, "shmhashrehashtest: [%s/%s]\n", g_pShmName, g_pHashName);
+    CHECK((pShm = LsShm::open(g_pShmName, 0, g_pShmDirName)) != NULL);
+    if (pShm == NULL)
+        return;
+    unlink(achShmFileName);
+    unlink(achLockFileName);
+    CHECK((pGPool = pShm->getGlobalPool()) != NULL);
+    if (pGPool == NULL)
+        return;
+    CHECK((pHash = pGPool->getNamedHash(g_pHashName, 10,
+                       LsShmHash::hashXXH32, memcmp, LSSHM_FLAG_LRU)) != NULL);
+    if (pHash == NULL)
+        return;
+
+    // every lookup and iteration must see all entries at any point of
+    // an incremental rehash
+    int rehashSeen = 0;
+    int midChecks = 0;
+    LsShmSize_t cap = pHash->capacity();
+    for (i = 0; i < MAX_KEYS; ++i)
+    {
+        len = mkKey(achKey, i);
+        CHECK(pHash->insert(achKey, len, &i, sizeof(i)) != 0);
+        if (pHash->isRehashing())
+        {
+            ++rehashSeen;
+            if ((midChecks < 8) && ((i & 0x3f) == 0))
+            {
+                ++midChecks;
+                CHECK(checkAll(pHash, i + 1, 1) == 0);
+                CHECK(countAll(pHash) == i + 1);
+            }
+        }
+    }
+    CHECK(rehashSeen > 0);
+    CHECK(midChecks > 0);
+    CHECK(pHash->capacity() > cap);
+    CHECK(pHash->size() == MAX_KEYS);
+    CHECK(checkAll(pHash, MAX_KEYS, 1) == 0);
+
+    // removal while migrating, the insert above may have left a rehash
+    // running; drive a new one with more inserts first
+    for (i = 0; !pHash->isRehashing() && (i < MAX_KEYS * 4); ++i)
+    {
+        len = mkKey(achKey, MAX_KEYS + i);
+        int val = MAX_KEYS + i;
+        pHash->insert(achKey, len, &val, sizeof(val));
+    }
+    int extra = i;
+    CHECK(pHash->isRehashing());
+    for (i = 0; i < MAX_KEYS; ++i)
+    {
+        if ((i % 3) == 0)
+            continue;
+        len = mkKey(achKey, i);
+        CHECK(pHash->remove(achKey, len) == 1);
+    }
+    for (i = 0; i < extra; ++i)
+    {
+        len = mkKey(achKey, MAX_KEYS + i);
+        CHECK(pHash->remove(achKey, len) == 1);
+    }
+    CHECK(checkAll(pHash, MAX_KEYS, 3) == 0);
+    CHECK(countAll(pHash) == (MAX_KEYS + 2) / 3);
+    CHECK((int)pHash->size() == (MAX_KEYS + 2) / 3);
+
+    // lookups alone finish the migration
+    for (i = 0; pHash->isRehashing() && (i < MAX_KEYS * 4); ++i)
+    {
+        len = mkKey(achKey, i);
+        int valLen;
+        pHash->find(achKey, len, &valLen);
+    }
+    CHECK(!pHash->isRehashing());
+    CHECK(checkAll(pHash, MAX_KEYS, 3) == 0);
+
+    pHash->close();
+}
+
+#endif
@@ -0,0 +1,148 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <shm/lsshmpool.h>
+#include <shm/lsshmhash.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "unittest-cpp/UnitTest++.h"
+
+static const char *g_pShmDirName = "/tmp";
+static const char *g_pShmName = "SHMSHARDTEST";
+static const char *g_pHashName = "SHARDHASH";
+
+#define NUM_KEYS        400
+#define NUM_SHARDS      8
+
+static int mkKey(char *pBuf, int idx)
+{
+    return snprintf(pBuf, 32, "shardkey-%d", idx);
+}
+
+
+TEST(shmHashShard_test)
+{
+    char achShmFileName[255];
+    char achLockFileName[255];
+    char achKey[32];
+    LsShm *pShm;
+    LsShmPool *pGPool;
+    LsShmHash *pHash;
+    int i, len, val, valLen;
+    LsShmHKey hkey;
+
+    snprintf(achShmFileName, sizeof(achShmFileName), "%s/%s.shm",
+             g_pShmDirName, g_pShmName);
+    snprintf(achLockFileName, sizeof(achLockFileName), "%s/%s.lock",
+             g_pShmDirName, g_pShmName);
+    unlink(achShmFileName);
+    unlink(achLockFileName);
+
+    fprintf(stdout, "shmhashshardtest: [%s/%s]\n", g_pShmName, g_pHashName);
+    CHECK((pShm = LsShm::open(g_pShmName, 0, g_pShmDirName)) != NULL);
+    if (pShm == NULL)
+        return;
+    unlink(achShmFileName);
+    unlink(achLockFileName);
+    CHECK((pGPool = pShm->getGlobalPool()) != NULL);
+    if (pGPool == NULL)
+        return;
+    CHECK((pHash = pGPool->getNamedHash(g_pHashName, 100,
+                       LsShmHash::hashXXH32, memcmp, LSSHM_FLAG_LRU)) != NULL);
+    if (pHash == NULL)
+        return;
+
+    // entries added before sharding must be moved into their shards
+    for (i = 0; i < NUM_KEYS / 2; ++i)
+    {
+        len = mkKey(achKey, i);
+        CHECK(pHash->insert(achKey, len, &i, sizeof(i)) != 0);
+    }
+    CHECK(pHash->getShardCount() == 0);
+    CHECK(pHash->shardOf(achKey, len) == pHash);
+    CHECK(pHash->setupShards(NUM_SHARDS) == LS_OK);
+    CHECK(pHash->getShardCount() == NUM_SHARDS);
+    CHECK(pHash->setupShards(NUM_SHARDS * 2) == LS_OK);
+    CHECK(pHash->getShardCount() == NUM_SHARDS);
+    CHECK(pHash->size() == NUM_KEYS / 2);
+
+    for (i = NUM_KEYS / 2; i < NUM_KEYS; ++i)
+    {
+        len = mkKey(achKey, i);
+        CHECK(pHash->insert(achKey, len, &i, sizeof(i)) != 0);
+    }
+    CHECK(pHash->size() == NUM_KEYS);
+
+    int total = 0;
+    for (i = 0; i < NUM_SHARDS; ++i)
+    {
+        CHECK(pHash->getShard(i)->size() > 0);
+        total += pHash->getShard(i)->size();
+    }
+    CHECK(total == NUM_KEYS);
+
+    for (i = 0; i < NUM_KEYS; ++i)
+    {
+        len = mkKey(achKey, i);
+        val = -1;
+        CHECK(pHash->findCopy(achKey, len, &val, sizeof(val))
+              == (int)sizeof(val));
+        CHECK(val == i);
+        LsShmOffset_t off = pHash->find(achKey, len, &valLen);
+        CHECK(off != 0);
+        CHECK(*(int *)pHash->offset2ptr(off) == i);
+
+        // the element lives in the shard picked by its hash key
+        hkey = pHash->hashKey(achKey, len);
+        CHECK(pHash->shardOf(achKey, len) == pHash->shardOfKey(hkey));
+        CHECK(pHash->shardOf(achKey, len)->find(achKey, len, &valLen) == off);
+    }
+
+    // a short buffer still reports the full value length
+    len = mkKey(achKey, 7);
+    char ch;
+    CHECK(pHash->findCopy(achKey, len, &ch, 1) == (int)sizeof(int));
+
+    for (i = 0; i < NUM_KEYS; i += 2)
+    {
+        len = mkKey(achKey, i);
+        CHECK(pHash->remove(achKey, len) == 1);
+    }
+    CHECK(pHash->size() == NUM_KEYS / 2);
+    for (i = 0; i < NUM_KEYS; ++i)
+    {
+        len = mkKey(achKey, i);
+        if (i & 1)
+            CHECK(pHash->findCopy(achKey, len, &val, sizeof(val))
+                  == (int)sizeof(val));
+        else
+            CHECK(pHash->findCopy(achKey, len, &val, sizeof(val)) == -1);
+    }
+
+    // trim walks the LRU of every shard
+    CHECK(pHash->trim(time(NULL) + 1, NULL, NULL) == NUM_KEYS / 2);
+    CHECK(pHash->empty());
+
+    pHash->close();
+}
+
+#endif
@@ -0,0 +1,226 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <spdy/h2connection.h>
+#include <spdy/lshpack.h>
+#include <http/httpcontext.h>
+#include <http/httpmime.h>
+#include <http/httprespheaders.h>
+#include <http/httpstatuscode.h>
+#include <http/staticfilecachedata.h>
+#include <lsr/ls_xpool.h>
+#include <util/autostr.h>
+#include <util/datetime.h>
+
+#include <string.h>
+#include <sys/stat.h>
+#include "unittest-cpp/UnitTest++.h"
+
+#define MAX_DECODED 32
+
+struct decoded_hdr
+{
+    char name[64];
+    char value[128];
+};
+
+
+static int decodeBlock(const unsigned char *buf, int len,
+                       decoded_hdr *pHdrs)
+{
+    struct lshpack_dec dec;
+    char out[256];
+    unsigned nameLen, valLen;
+    uint32_t idx;
+    const unsigned char *p = buf;
+    int n = 0;
+    lshpack_dec_init(&dec);
+    while (p < buf + len && n < MAX_DECODED)
+    {
+        if (lshpack_dec_decode(&dec, &p, buf + len, out, out + sizeof(out),
+                               &nameLen, &valLen, &idx) != 0)
+        {
+            n = -1;
+            break;
+        }
+        memcpy(pHdrs[n].name, out, nameLen);
+        pHdrs[n].name[nameLen] = 0;
+        memcpy(pHdrs[n].value, out + nameLen, valLen);
+        pHdrs[n].value[valLen] = 0;
+        ++n;
+    }
+    lshpack_dec_cleanup(&dec);
+    return n;
+}
+
+
+static int countHeader(decoded_hdr *pHdrs, int n, const char *pName,
+                       const char *pValue)
+{
+    int count = 0;
+    for (int i = 0; i < n; ++i)
+        if (strcmp(pHdrs[i].name, pName) == 0)
+        {
+            CHECK_EQUAL(pValue, pHdrs[i].value);
+            ++count;
+        }
+    return count;
+}
+
+
+//Adds the fixed headers of pData the way buildStaticFileHeaders() does
+static void addStaticHeaders(HttpRespHeaders *pHeaders,
+                             StaticFileCacheData *pData)
+{
+    const char *p = pData->getHeaderBuf();
+    int iETagLen = pData->getETagHeaderLen() - 8;
+    pHeaders->add(HttpRespHeaders::H_ETAG, p + 6, iETagLen);
+    p += 6 + iETagLen + 2;
+    pHeaders->add(HttpRespHeaders::H_LAST_MODIFIED, p + 15,
+                  RFC_1123_TIME_LEN);
+    p += 15 + RFC_1123_TIME_LEN + 2;
+    pHeaders->add(HttpRespHeaders::H_CONTENT_TYPE, p + 14,
+                  pData->getHeaderLen() - (p - pData->getHeaderBuf())
+                  - 14 - 2);
+    pHeaders->add(HttpRespHeaders::H_CONTENT_LENGTH, "6553", 4);
+    pHeaders->appendAcceptRange();
+    pHeaders->add(HttpRespHeaders::H_SERVER, "LiteSpeed", 9);
+    pData->attachHpackHeaders(pHeaders, 1, 1);
+}
+
+
+static void buildCacheData(StaticFileCacheData *pData, MimeSetting *pMime)
+{
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_size = 6553;
+    st.st_mtime = 1699949551;
+    st.st_ino = 1234567;
+    st.st_mode = S_IFREG | 0644;
+    pData->build(-1, "/var/www/style.css", 18, st);
+    pData->buildHeaders(pMime, NULL, ETAG_ALL);
+}
+
+
+SUITE(H2HpackBlock)
+{
+    TEST(SplicedBlockDecodes)
+    {
+        HttpRespHeaders::buildCommonHeaders();
+        static AutoStr2 s_mime("text/css");
+        MimeSetting mime;
+        mime.setMIME(&s_mime);
+        StaticFileCacheData data;
+        buildCacheData(&data, &mime);
+
+        ls_xpool_t *pool = ls_xpool_new();
+        HttpRespHeaders headers(pool);
+        headers.reset();
+        headers.addStatusLine(0, SC_200, 0);
+        addStaticHeaders(&headers, &data);
+
+        int blockLen;
+        uint32_t mask;
+        CHECK(headers.getHpackBlock(&blockLen, &mask) != NULL);
+
+        char etag[128], lastMod[64];
+        int len;
+        const char *pVal = headers.getHeader(HttpRespHeaders::H_ETAG, &len);
+        memcpy(etag, pVal, len);
+        etag[len] = 0;
+        pVal = headers.getHeader(HttpRespHeaders::H_LAST_MODIFIED, &len);
+        memcpy(lastMod, pVal, len);
+        lastMod[len] = 0;
+
+        H2Connection *pConn = (H2Connection *)H2Connection::get();
+        unsigned char buf[1024];
+        int ret = pConn->encodeHeaders(&headers, buf, sizeof(buf));
+        CHECK(ret > 0);
+
+        decoded_hdr hdrs[MAX_DECODED];
+        int n = decodeBlock(buf, ret, hdrs);
+        CHECK_EQUAL(7, n);
+        CHECK_EQUAL(1, countHeader(hdrs, n, ":status", "200"));
+        CHECK_EQUAL(1, countHeader(hdrs, n, "etag", etag));
+        CHECK_EQUAL(1, countHeader(hdrs, n, "content-type", "text/css"));
+        CHECK_EQUAL(1, countHeader(hdrs, n, "last-modified", lastMod));
+        CHECK_EQUAL(1, countHeader(hdrs, n, "accept-ranges", "bytes"));
+        CHECK_EQUAL(1, countHeader(hdrs, n, "content-length", "6553"));
+        CHECK_EQUAL(1, countHeader(hdrs, n, "server", "LiteSpeed"));
+
+        delete pConn;
+        ls_xpool_delete(pool);
+    }
+
+
+    TEST(ChangedHeaderFallsBack)
+    {
+        HttpRespHeaders::buildCommonHeaders();
+        static AutoStr2 s_mime("text/css");
+        MimeSetting mime;
+        mime.setMIME(&s_mime);
+        StaticFileCacheData data;
+        buildCacheData(&data, &mime);
+
+        ls_xpool_t *pool = ls_xpool_new();
+        HttpRespHeaders headers(pool);
+        headers.reset();
+        headers.addStatusLine(0, SC_200, 0);
+        addStaticHeaders(&headers, &data);
+
+        //a module rewrites the content type after the block is attached
+        headers.add(HttpRespHeaders::H_CONTENT_TYPE,
+                    "text/css; charset=UTF-8", 23);
+        int blockLen;
+        uint32_t mask;
+        CHECK(headers.getHpackBlock(&blockLen, &mask) == NULL);
+
+        H2Connection *pConn = (H2Connection *)H2Connection::get();
+        unsigned char buf[1024];
+        int ret = pConn->encodeHeaders(&headers, buf, sizeof(buf));
+        CHECK(ret > 0);
+
+        decoded_hdr hdrs[MAX_DECODED];
+        int n = decodeBlock(buf, ret, hdrs);
+        CHECK_EQUAL(7, n);
+        CHECK_EQUAL(1, countHeader(hdrs, n, "content-type",
+                                   "text/css; charset=UTF-8"));
+        CHECK_EQUAL(1, countHeader(hdrs, n, "accept-ranges", "bytes"));
+
+        delete pConn;
+
+        //a removed header must not come back from the block either
+        headers.reset();
+        headers.addStatusLine(0, SC_200, 0);
+        addStaticHeaders(&headers, &data);
+        headers.del(HttpRespHeaders::H_ETAG);
+        CHECK(headers.getHpackBlock(&blockLen, &mask) == NULL);
+        pConn = (H2Connection *)H2Connection::get();
+        ret = pConn->encodeHeaders(&headers, buf, sizeof(buf));
+        CHECK(ret > 0);
+        n = decodeBlock(buf, ret, hdrs);
+        CHECK_EQUAL(6, n);
+        CHECK_EQUAL(0, countHeader(hdrs, n, "etag", ""));
+
+        delete pConn;
+        ls_xpool_delete(pool);
+    }
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <spdy/h2connection.h>
+#include <spdy/h2protocol.h>
+
+#include <string.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+static int buildPriorityUpdate(char *pFrame, uint32_t id, const char *pValue)
+{
+    int len = 4 + strlen(pValue);
+    pFrame[0] = id >> 24;
+    pFrame[1] = (id >> 16) & 0xff;
+    pFrame[2] = (id >> 8) & 0xff;
+    pFrame[3] = id & 0xff;
+    memcpy(pFrame + 4, pValue, len - 4);
+    return len;
+}
+
+
+//the frame header has been parsed, the payload is in the input buffer
+#define PRIORITY_UPDATE(pConn, id, pValue, ret) \
+    do { \
+        char achFrame[64]; \
+        int len = buildPriorityUpdate(achFrame, id, pValue); \
+        H2FrameHeader header(len, (H2FrameType)H2_FRAME_PRIORITY_UPDATE, \
+                             0, 0); \
+        pConn->m_bufInput.append(achFrame, len); \
+        pConn->m_iCurrentFrameRemain = len; \
+        ret = pConn->processPriorityUpdateFrame(&header); \
+    } while (0)
+
+
+SUITE(H2PriorityUpdate)
+{
+    TEST(PendingStreams)
+    {
+        H2Connection *pConn = (H2Connection *)H2Connection::get();
+        int urgency, incremental, ret;
+
+        //kept for streams not opened yet, with the defaults filled in
+        PRIORITY_UPDATE(pConn, 5, "u=1", ret);
+        CHECK(ret == 0);
+        PRIORITY_UPDATE(pConn, 3, "i", ret);
+        CHECK(ret == 0);
+        CHECK(pConn->m_iPendingPriority == 2);
+
+        //a later frame for the same stream replaces the earlier one
+        PRIORITY_UPDATE(pConn, 5, "u=0, i", ret);
+        CHECK(ret == 0);
+        CHECK(pConn->m_iPendingPriority == 2);
+
+        //not for closed, server initiated or unparsable ones
+        pConn->m_uiLastStreamId = 1;
+        PRIORITY_UPDATE(pConn, 1, "u=1", ret);
+        CHECK(ret == 0);
+        PRIORITY_UPDATE(pConn, 4, "u=1", ret);
+        CHECK(ret == 0);
+        PRIORITY_UPDATE(pConn, 7, "u=(", ret);
+        CHECK(ret == 0);
+        CHECK(pConn->m_iPendingPriority == 2);
+
+        CHECK(pConn->takePendingPriority(3, &urgency, &incremental) == 1);
+        CHECK(urgency == 3 && incremental == 1);
+        CHECK(pConn->takePendingPriority(3, &urgency, &incremental) == 0);
+        CHECK(pConn->m_iPendingPriority == 1);
+
+        //stream 5 was skipped by the client, 7 drops it
+        CHECK(pConn->takePendingPriority(7, &urgency, &incremental) == 0);
+        CHECK(pConn->m_iPendingPriority == 0);
+
+        //a full table drops the oldest
+        for (int i = 0; i <= H2_PENDING_PRIORITY_UPDATES; ++i)
+        {
+            PRIORITY_UPDATE(pConn, 101 + 2 * i, "u=2", ret);
+            CHECK(ret == 0);
+        }
+        CHECK(pConn->m_iPendingPriority == H2_PENDING_PRIORITY_UPDATES);
+        CHECK(pConn->takePendingPriority(101, &urgency, &incremental) == 0);
+        CHECK(pConn->m_iPendingPriority == H2_PENDING_PRIORITY_UPDATES);
+        CHECK(pConn->takePendingPriority(103, &urgency, &incremental) == 1);
+        CHECK(urgency == 2 && incremental == 0);
+
+        //stream ID zero is a connection error
+        PRIORITY_UPDATE(pConn, 0, "u=1", ret);
+        CHECK(ret == H2_ERROR_PROTOCOL_ERROR);
+        delete pConn;
+    }
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <sslpp/sslconnection.h>
+
+#include <lsdef.h>
+#include <openssl/evp.h>
+
+#include <string.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+//RFC 8448, 3. Simple 1-RTT Handshake, server application traffic keys
+static const uint8_t s_serverAppSecret[32] =
+{
+    0xa1, 0x1a, 0xf9, 0xf0, 0x55, 0x31, 0xf8, 0x56,
+    0xad, 0x47, 0x11, 0x6b, 0x45, 0xa9, 0x50, 0x32,
+    0x82, 0x04, 0xb4, 0xf4, 0x4b, 0xfb, 0x6b, 0x3a,
+    0x4b, 0x4f, 0x1f, 0x3f, 0xcb, 0x63, 0x16, 0x43
+};
+
+static const uint8_t s_serverAppKey[16] =
+{
+    0x9f, 0x02, 0x28, 0x3b, 0x6c, 0x9c, 0x07, 0xef,
+    0xc2, 0x6b, 0xb9, 0xf2, 0xac, 0x92, 0xe3, 0x56
+};
+
+static const uint8_t s_serverAppIv[12] =
+{
+    0xcf, 0x78, 0x2b, 0x88, 0xdd, 0x83, 0x54, 0x9a,
+    0xad, 0xf1, 0xe9, 0x84
+};
+
+
+TEST(SslKtlsTest_expandLabel)
+{
+    uint8_t key[32];
+    uint8_t iv[12];
+
+    memset(key, 0, sizeof(key));
+    CHECK(SslConnection::ktlsExpandLabel(EVP_sha256(), s_serverAppSecret,
+                                         sizeof(s_serverAppSecret), "key",
+                                         key, 16) == LS_OK);
+    CHECK(memcmp(key, s_serverAppKey, 16) == 0);
+    //nothing beyond the requested length is touched
+    CHECK(key[16] == 0);
+
+    CHECK(SslConnection::ktlsExpandLabel(EVP_sha256(), s_serverAppSecret,
+                                         sizeof(s_serverAppSecret), "iv",
+                                         iv, sizeof(iv)) == LS_OK);
+    CHECK(memcmp(iv, s_serverAppIv, sizeof(iv)) == 0);
+
+    //a single HMAC block only, longer output is refused
+    uint8_t big[EVP_MAX_MD_SIZE];
+    CHECK(SslConnection::ktlsExpandLabel(EVP_sha256(), s_serverAppSecret,
+                                         sizeof(s_serverAppSecret), "key",
+                                         big, 33) == LS_FAIL);
+}
+
+
+TEST(SslKtlsTest_fallback)
+{
+    SslConnection conn;
+    int enabled = SslConnection::isKtlsTxEnabled();
+
+    //disabled by configuration, stays in user space
+    SslConnection::setKtlsTxEnabled(0);
+    CHECK(conn.enableKtlsTx() == 0);
+    CHECK(!conn.isKtlsTx());
+
+    //enabled, but the handshake has not completed
+    SslConnection::setKtlsTxEnabled(1);
+    CHECK(conn.enableKtlsTx() == 0);
+    CHECK(!conn.isKtlsTx());
+
+    SslConnection::setKtlsTxEnabled(enabled);
+}
+
+#endif
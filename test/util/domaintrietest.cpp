@@ -0,0 +1,96 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <util/domaintrie.h>
+
+#include <limits.h>
+#include <string.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+static void *lookup(DomainTrie &trie, const char *pHost, int *pSeq = NULL)
+{
+    int seq = INT_MAX;
+    void *pObj = trie.match(pHost, pHost + strlen(pHost), &seq);
+    if (pSeq)
+        *pSeq = seq;
+    return pObj;
+}
+
+
+TEST(DomainTrieTest_getSuffix)
+{
+    CHECK(strcmp(DomainTrie::getSuffix("*.example.com"), "example.com") == 0);
+    CHECK(strcmp(DomainTrie::getSuffix("*.localhost"), "localhost") == 0);
+    CHECK(DomainTrie::getSuffix("*") == NULL);
+    CHECK(DomainTrie::getSuffix("*.") == NULL);
+    CHECK(DomainTrie::getSuffix("*example.com") == NULL);
+    CHECK(DomainTrie::getSuffix("www.*.com") == NULL);
+    CHECK(DomainTrie::getSuffix("*.exa?ple.com") == NULL);
+    CHECK(DomainTrie::getSuffix("*.*.example.com") == NULL);
+    CHECK(DomainTrie::getSuffix("*.example..com") == NULL);
+    CHECK(DomainTrie::getSuffix("*.example.com.") == NULL);
+    CHECK(DomainTrie::getSuffix("example.com") == NULL);
+}
+
+
+TEST(DomainTrieTest_match)
+{
+    DomainTrie trie;
+    int a, b, c, seq;
+    CHECK(trie.add("example.com", &a, 0) == 0);
+    CHECK(trie.add("shop.example.com", &b, 1) == 0);
+    CHECK(trie.add("example.org", &c, 2) == 0);
+    CHECK(trie.getCount() == 3);
+
+    //same as the glob "*.example.com", anything in front of ".example.com"
+    CHECK(lookup(trie, "www.example.com") == &a);
+    CHECK(lookup(trie, "a.b.c.example.com") == &a);
+    CHECK(lookup(trie, "WWW.Example.COM") == &a);
+    CHECK(lookup(trie, ".example.com") == &a);
+    CHECK(lookup(trie, "example.com") == NULL);
+    CHECK(lookup(trie, "myexample.com") == NULL);
+    CHECK(lookup(trie, "www.example.net") == NULL);
+    CHECK(lookup(trie, "") == NULL);
+
+    //the pattern configured first wins over the more specific one
+    CHECK(lookup(trie, "www.shop.example.com", &seq) == &a);
+    CHECK(seq == 0);
+    CHECK(trie.find("shop.example.com") == &b);
+    CHECK(trie.remove("example.com") == &a);
+    CHECK(lookup(trie, "www.shop.example.com", &seq) == &b);
+    CHECK(seq == 1);
+    CHECK(lookup(trie, "www.example.com") == NULL);
+
+    //a caller holding an earlier match keeps it
+    seq = 1;
+    CHECK(trie.match("x.example.org", NULL, &seq) == NULL);
+    CHECK(seq == 1);
+
+    CHECK(trie.remove("example.com") == NULL);
+    CHECK(trie.remove("shop.example.com") == &b);
+    CHECK(trie.find("shop.example.com") == NULL);
+    CHECK(lookup(trie, "x.example.org") == &c);
+    CHECK(trie.getCount() == 1);
+    trie.clear();
+    CHECK(trie.getCount() == 0);
+    CHECK(lookup(trie, "x.example.org") == NULL);
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#include <util/regexfilter.h>
+
+#include <string.h>
+#include "unittest-cpp/UnitTest++.h"
+
+
+static int requiredLiteral(const char *pPattern, const char *pExpect)
+{
+    char achBuf[REGEX_FILTER_MAX_LITERAL_LEN + 1];
+    int len = RegexFilter::getRequiredLiteral(pPattern, achBuf,
+              REGEX_FILTER_MAX_LITERAL_LEN);
+    achBuf[len] = 0;
+    return strcmp(achBuf, pExpect) == 0;
+}
+
+
+TEST(RegexFilterTest_requiredLiteral)
+{
+    CHECK(requiredLiteral("^index\\.php$", "index.php"));
+    CHECK(requiredLiteral("^wp-admin/(.*)$", "wp-admin/"));
+    CHECK(requiredLiteral("^/Media/[^/]+\\.js", "/media/"));
+    CHECK(requiredLiteral("^/foo(bar)?baz", "/foo"));
+    CHECK(requiredLiteral("abc?d", "ab"));
+    CHECK(requiredLiteral("x{2,3}yz", "yz"));
+    CHECK(requiredLiteral("\\d+lsapi", "lsapi"));
+    CHECK(requiredLiteral("^/api/v\\d+/users", "/api/v"));
+    CHECK(requiredLiteral("(?i)^/Shop/", "/shop/"));
+    //no literal, or nothing that can be relied on
+    CHECK(requiredLiteral("^(.*)\\.(jpe?g|png)$", ""));
+    CHECK(requiredLiteral("wp-login|xmlrpc", ""));
+    CHECK(requiredLiteral("(?x)foo bar", ""));
+    CHECK(requiredLiteral("^(\\w+)/\\1$", ""));
+    CHECK(requiredLiteral("\\Qa.b\\E", ""));
+    CHECK(requiredLiteral(".*", ""));
+    CHECK(requiredLiteral("^$", ""));
+}
+
+
+TEST(RegexFilterTest_filter)
+{
+    static const char *s_pPatterns[] =
+    {
+        "^/api/v1/(\\w+)$",
+        "^/api/v1/users/(\\d+)$",
+        "\\.php$",
+        NULL,               //not a regex, never filtered
+        "^/(.*)$",
+        "^/Static/(.+)\\.css$",
+        "^/ab",
+        "^/abc",
+    };
+    int count = sizeof(s_pPatterns) / sizeof(char *);
+    unsigned char achSeen[REGEX_FILTER_MAX_LITERALS / 8];
+    RegexFilter filter;
+
+    CHECK(filter.build(s_pPatterns, count) == 4);
+    CHECK(filter.hasLiterals());
+    CHECK(filter.getCount() == count);
+    //"/api/v1/users/" shares the literal of "/api/v1/"
+    CHECK(filter.getLiteralId(0) != -1);
+    CHECK(filter.getLiteralId(1) == filter.getLiteralId(0));
+    CHECK(filter.getLiteralId(3) == -1);
+    CHECK(filter.getLiteralId(4) == -1);
+    CHECK(filter.getLiteralId(7) == filter.getLiteralId(6));
+
+    const char *pURI = "/api/v1/users/42";
+    filter.scan(pURI, strlen(pURI), achSeen);
+    CHECK(filter.mayMatch(0, achSeen));
+    CHECK(filter.mayMatch(1, achSeen));
+    CHECK(!filter.mayMatch(2, achSeen));
+    CHECK(filter.mayMatch(3, achSeen));
+    CHECK(filter.mayMatch(4, achSeen));
+    CHECK(!filter.mayMatch(5, achSeen));
+    CHECK(!filter.mayMatch(6, achSeen));
+
+    //case insensitive, overlapping literals
+    pURI = "/STATIC/site.css/abc.php";
+    filter.scan(pURI, strlen(pURI), achSeen);
+    CHECK(!filter.mayMatch(0, achSeen));
+    CHECK(filter.mayMatch(2, achSeen));
+    CHECK(filter.mayMatch(5, achSeen));
+    CHECK(filter.mayMatch(6, achSeen));
+
+    filter.scan("", 0, achSeen);
+    CHECK(!filter.mayMatch(0, achSeen));
+    CHECK(filter.mayMatch(3, achSeen));
+
+    //nothing to filter on
+    static const char *s_pNone[] = { "^/(.*)$", ".*", NULL };
+    CHECK(filter.build(s_pNone, 3) == 0);
+    CHECK(!filter.hasLiterals());
+    CHECK(filter.mayMatch(0, achSeen));
+}
+
+#endif
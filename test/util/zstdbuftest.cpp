@@ -0,0 +1,125 @@
+/*****************************************************************************
+*    Open LiteSpeed is an open source HTTP server.                           *
+*    Copyright (C) 2013 - 2018  LiteSpeed Technologies, Inc.                 *
+*                                                                            *
+*    This program is free software: you can redistribute it and/or modify    *
+*    it under the terms of the GNU General Public License as published by    *
+*    the Free Software Foundation, either version 3 of the License, or       *
+*    (at your option) any later version.                                     *
+*                                                                            *
+*    This program is distributed in the hope that it will be useful,         *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+*    GNU General Public License for more details.                            *
+*                                                                            *
+*    You should have received a copy of the GNU General Public License       *
+*    along with this program. If not, see http://www.gnu.org/licenses/.      *
+*****************************************************************************/
+#ifdef RUN_TEST
+
+#ifdef USE_ZSTD
+
+#include <util/zstdbuf.h>
+#include <util/vmembuf.h>
+#include "unittest-cpp/UnitTest++.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+static int readAll(VMemBuf &buf, char *pOut, int max)
+{
+    size_t size;
+    int total = 0;
+    char *p;
+    buf.rewindReadBuf();
+    while (((p = buf.getReadBuffer(size)) != NULL) && (size > 0))
+    {
+        if (total + (int)size > max)
+            return -1;
+        memcpy(pOut + total, p, size);
+        buf.readUsed(size);
+        total += size;
+    }
+    return total;
+}
+
+
+TEST(ZstdBufTest_testRoundTrip)
+{
+    static char achSrc[65536];
+    static char achComp[65536];
+    static char achOut[65536];
+    for (int i = 0; i < (int)sizeof(achSrc); ++i)
+        achSrc[i] = (rand() % 4) ? 'a' + i % 7 : rand();
+
+    VMemBuf compBuf;
+    CHECK(0 == compBuf.set(VMBUF_ANON_MAP, 4096));
+    ZstdBuf zBuf;
+    CHECK(0 == zBuf.init(ZstdBuf::COMPRESSOR_COMPRESS, 3));
+    zBuf.setCompressCache(&compBuf);
+    CHECK(0 == zBuf.beginStream());
+    int off = 0;
+    for (int i = 1; off < (int)sizeof(achSrc); ++i)
+    {
+        int len = (i * 37) % 3000 + 1;
+        if (len > (int)sizeof(achSrc) - off)
+            len = sizeof(achSrc) - off;
+        CHECK(len == zBuf.write(achSrc + off, len));
+        if (zBuf.shouldFlush())
+            CHECK(0 == zBuf.flush());
+        off += len;
+    }
+    CHECK(0 == zBuf.endStream());
+    int compLen = readAll(compBuf, achComp, sizeof(achComp));
+    CHECK(compLen > 0);
+    CHECK(compLen < (int)sizeof(achSrc));
+
+    VMemBuf outBuf;
+    CHECK(0 == outBuf.set(VMBUF_ANON_MAP, 4096));
+    ZstdBuf zDec;
+    CHECK(0 == zDec.init(ZstdBuf::COMPRESSOR_DECOMPRESS, 0));
+    zDec.setCompressCache(&outBuf);
+    CHECK(0 == zDec.beginStream());
+    for (off = 0; off < compLen; off += 100)
+    {
+        int len = (compLen - off < 100) ? compLen - off : 100;
+        CHECK(len == zDec.write(achComp + off, len));
+    }
+    CHECK(0 == zDec.endStream());
+    CHECK((int)sizeof(achSrc) == readAll(outBuf, achOut, sizeof(achOut)));
+    CHECK(0 == memcmp(achSrc, achOut, sizeof(achSrc)));
+
+    //a truncated frame must not be reported as complete
+    outBuf.rewindWriteBuf();
+    CHECK(0 == zDec.init(ZstdBuf::COMPRESSOR_DECOMPRESS, 0));
+    CHECK(0 == zDec.beginStream());
+    CHECK(compLen / 2 == zDec.write(achComp, compLen / 2));
+    CHECK(0 != zDec.endStream());
+}
+
+
+TEST(ZstdBufTest_testReuse)
+{
+    VMemBuf zFile;
+    zFile.set("zstdbuftest.zst", -1);
+    ZstdBuf zBuf(ZstdBuf::COMPRESSOR_COMPRESS, 9);
+    zBuf.setCompressCache(&zFile);
+
+    char achBuf[8192];
+    memset(achBuf, 'A', 4096);
+    memset(achBuf + 4096, 'b', 4096);
+    for (int round = 0; round < 3; ++round)
+    {
+        CHECK(0 == zBuf.reinit());
+        CHECK(0 == zBuf.beginStream());
+        CHECK(8192 == zBuf.write(achBuf, 8192));
+        CHECK(0 == zBuf.endStream());
+        CHECK(NULL == zBuf.getLastError());
+    }
+    zFile.exactSize();
+    zFile.close();
+}
+
+#endif
+#endif